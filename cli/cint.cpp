@@ -1,19 +1,36 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Dec 26 17:03:54 PST 2010
-// Last Modified: Wed May 31 16:06:49 CEST 2017
+// Last Modified: Fri Oct 16 18:50:12 PDT 2026
 // Filename:      cint.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/cli/cint.cpp
 // Syntax:        C++11
 // vim:           ts=3 noexpandtab nowrap
 //
 // Description:   Calculates counterpoint interval modules in polyphonic
-//                music.
+//                music.  With the --module-count option, the input stream
+//                is given to the tool as a whole (as in RAW_STREAM_INTERFACE)
+//                so that modules are counted over all files; otherwise
+//                files are processed one at a time as in STREAM_INTERFACE.
 //
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_cint)
+using namespace std;
+using namespace hum;
+
+int main(int argc, char** argv) {
+	Tool_cint interface;
+	interface.allowSegmentPrefetch();
+	if (!interface.process(argc, argv)) {
+		interface.getError(cerr);
+		return -1;
+	}
+	if (interface.hasModuleCountMode()) {
+		return runRawStreamInterface<Tool_cint>(interface);
+	}
+	return runStreamInterface<Tool_cint>(interface, argc, argv);
+}
 
 
 
@@ -1,18 +1,34 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Aug 27 07:22:47 PDT 2017
-// Last Modified: Sun Aug 27 07:22:50 PDT 2017
+// Last Modified: Fri Oct 16 18:41:55 PDT 2026
 // Filename:      msearch.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/cli/msearch.cpp
 // Syntax:        C++11
 // vim:           ts=3 noexpandtab nowrap
 //
-// Description:   Search musical content of Humdrum files.
+// Description:   Search musical content of Humdrum files.  With the
+//                --build-index and --index options, the input stream
+//                is given to the tool as a whole (as in RAW_STREAM_INTERFACE);
+//                otherwise each file is searched as in STREAM_INTERFACE.
 //
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_msearch)
+using namespace std;
+using namespace hum;
 
+int main(int argc, char** argv) {
+	Tool_msearch interface;
+	interface.allowSegmentPrefetch();
+	if (!interface.process(argc, argv)) {
+		interface.getError(cerr);
+		return -1;
+	}
+	if (interface.hasIndexMode()) {
+		return runRawStreamInterface<Tool_msearch>(interface);
+	}
+	return runStreamInterface<Tool_msearch>(interface, argc, argv);
+}
 
 
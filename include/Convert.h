@@ -39,6 +39,9 @@ class Convert {
 		static HumNum  recipToDurationNoDots(std::string* recip,
 		                                     HumNum scale = 4,
 		                                     const std::string& separator = " ");
+		static HumNum  recipToDuration      (const HumdrumToken* token,
+		                                     HumNum scale = 4,
+		                                     const std::string& separator = " ");
 		static std::string  durationToRecip      (HumNum duration,
 		                                     HumNum scale = HumNum(1,4));
 		static std::string  durationFloatToRecip (double duration,
@@ -53,41 +56,41 @@ class Convert {
 		static std::string  base40ToIntervalAbbr (int b40);
 		static int     kernToOctaveNumber   (const std::string& kerndata);
 		static int     kernToOctaveNumber   (HTp token)
-				{ return kernToOctaveNumber((std::string)*token); }
+				{ return token->getKernNote().getOctaveNumber(); }
 		static int     kernToAccidentalCount(const std::string& kerndata);
 		static int     kernToAccidentalCount(HTp token)
-				{ return kernToAccidentalCount((std::string)*token); }
+				{ return token->getKernNote().getAccidentalCount(); }
 		static int     kernToDiatonicPC     (const std::string& kerndata);
 		static int     kernToDiatonicPC     (HTp token)
-				{ return kernToDiatonicPC     ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicPC(); }
 		static char    kernToDiatonicUC     (const std::string& kerndata);
 		static int     kernToDiatonicUC     (HTp token)
-				{ return kernToDiatonicUC     ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicUC(); }
 		static char    kernToDiatonicLC     (const std::string& kerndata);
 		static int     kernToDiatonicLC     (HTp token)
-				{ return kernToDiatonicLC     ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicLC(); }
 		static int     kernToBase40PC       (const std::string& kerndata);
 		static int     kernToBase40PC       (HTp token)
-				{ return kernToBase40PC       ((std::string)*token); }
+				{ return token->getKernNote().getBase40PC(); }
 		static int     kernToBase12PC       (const std::string& kerndata);
 		static int     kernToBase12PC       (HTp token)
-				{ return kernToBase12PC       ((std::string)*token); }
+				{ return token->getKernNote().getBase12PC(); }
 		static int     kernToBase7PC        (const std::string& kerndata) {
 		                                     return kernToDiatonicPC(kerndata); }
 		static int     kernToBase7PC        (HTp token)
-				{ return kernToBase7PC        ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicPC(); }
 		static int     kernToBase40         (const std::string& kerndata);
 		static int     kernToBase40         (HTp token)
-				{ return kernToBase40         ((std::string)*token); }
+				{ return token->getKernNote().getBase40(); }
 		static int     kernToBase12         (const std::string& kerndata);
 		static int     kernToBase12         (HTp token)
-				{ return kernToBase12         ((std::string)*token); }
+				{ return token->getKernNote().getBase12(); }
 		static int     kernToBase7          (const std::string& kerndata);
 		static int     kernToBase7          (HTp token)
-				{ return kernToBase7          ((std::string)*token); }
+				{ return token->getKernNote().getBase7(); }
 		static int     kernToMidiNoteNumber (const std::string& kerndata);
 		static int     kernToMidiNoteNumber(HTp token)
-				{ return kernToMidiNoteNumber((std::string)*token); }
+				{ return token->getKernNote().getMidiNoteNumber(); }
 		static std::string  kernToScientificPitch(const std::string& kerndata,
 		                                     std::string flat = "b",
 		                                     std::string sharp = "#",
@@ -172,6 +175,19 @@ class Convert {
 		static char hasKernStemDirection    (const std::string& kerndata);
 
 		static bool isKernSecondaryTiedNote (const std::string& kerndata);
+
+		// HTp versions, which use the parsed notes of the token (see
+		// HumdrumToken::getKernNote()):
+		static bool isKernRest              (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_REST; }
+		static bool isKernNote              (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_PITCH; }
+		static bool isKernNoteAttack        (HTp token);
+		static bool hasKernSlurStart        (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_SLUR_START; }
+		static bool hasKernSlurEnd          (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_SLUR_END; }
+		static bool isKernSecondaryTiedNote (HTp token);
 		static std::string getKernPitchAttributes(const std::string& kerndata);
 
 		// String processing, defined in Convert-string.cpp
@@ -200,6 +216,7 @@ class Convert {
 
 		// Mathematical processing, defined in Convert-math.cpp
 		static int     getLcm               (const std::vector<int>& numbers);
+		static long long getLcm64           (const std::vector<int>& numbers);
 		static int     getGcd               (int a, int b);
 		static void    primeFactors         (std::vector<int>& output, int n);
 		static double  nearIntQuantize      (double value,
@@ -102,6 +102,8 @@
 #ifndef _HUMHASH_H_INCLUDED
 #define _HUMHASH_H_INCLUDED
 
+#include "HumNum.h"
+
 #include <iostream>
 #include <string>
 #include <vector>
@@ -109,7 +111,6 @@
 
 namespace hum {
 
-class HumNum;
 class HumdrumToken;
 typedef HumdrumToken* HTp;
 
@@ -126,11 +127,38 @@ typedef std::map<std::string, std::map<std::string, std::map<std::string, HumPar
 typedef std::map<std::string, std::map<std::string, HumParameter> > MapNKV;
 typedef std::map<std::string, HumParameter> MapKV;
 
+
+// HumHashEntry: Storage for a single parameter in a HumHash.  The
+// namespaces and key are interned ids (see HumHash::getParameterId()),
+// and integer, fraction and token values are stored without converting
+// them to text.  Floating-point values are stored both as text and as
+// the value which the text represents.  Other values are stored as a
+// string.
+class HumHashEntry {
+	public:
+		enum { TYPE_STRING, TYPE_INT, TYPE_FRACTION, TYPE_HTP, TYPE_FLOAT };
+
+		int           ns1;     // interned first namespace
+		int           ns2;     // interned second namespace
+		int           key;     // interned key
+		int           type;    // TYPE_* value
+		HumNum        number;  // value for TYPE_INT and TYPE_FRACTION
+		HTp           token;   // value for TYPE_HTP
+		double        real;    // value for TYPE_FLOAT
+		HumdrumToken* origin;  // token which the parameter comes from
+		std::string   text;    // value for TYPE_STRING and TYPE_FLOAT
+
+		std::string   getText  (void) const;
+};
+
 class HumHash {
 	public:
 		               HumHash             (void);
+		               HumHash             (const HumHash& hash);
 		              ~HumHash             ();
 
+		HumHash&       operator=           (const HumHash& hash);
+
 		std::string    getValue            (const std::string& key) const;
 		std::string    getValue            (const std::string& ns2,
 		                                    const std::string& key) const;
@@ -209,6 +237,8 @@ class HumHash {
 		void           deleteValue         (const std::string& ns2, const std::string& key);
 		void           deleteValue         (const std::string& ns1, const std::string& ns2,
 		                                    const std::string& key);
+		void           deleteValues        (const std::string& ns1,
+		                                    const std::string& ns2);
 		std::vector<std::string> getKeys             (void) const;
 		std::vector<std::string> getKeys             (const std::string& ns) const;
 		std::vector<std::string> getKeys             (const std::string& ns1,
@@ -250,13 +280,46 @@ class HumHash {
 		                                    const std::string& ns2,
 		                                    const std::string& parameter) const;
 
+		// Access by interned namespace/key ids, which avoids converting
+		// the namespace and key strings on each call:
+		static int     getParameterId      (const std::string& name);
+		static int     findParameterId     (const std::string& name);
+		static std::string getParameterName (int id);
+		std::string    getValue            (int ns1, int ns2, int key) const;
+		int            getValueInt         (int ns1, int ns2, int key) const;
+		HumNum         getValueFraction    (int ns1, int ns2, int key) const;
+		double         getValueFloat       (int ns1, int ns2, int key) const;
+		HTp            getValueHTp         (int ns1, int ns2, int key) const;
+		bool           getValueBool        (int ns1, int ns2, int key) const;
+		bool           isDefined           (int ns1, int ns2, int key) const;
+		void           setValue            (int ns1, int ns2, int key,
+		                                    const std::string& value);
+		void           setValue            (int ns1, int ns2, int key, int value);
+		void           setValue            (int ns1, int ns2, int key, HTp value);
+		void           setValue            (int ns1, int ns2, int key,
+		                                    HumNum value);
+		void           setValue            (int ns1, int ns2, int key, double value);
+
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
+		HumHashEntry*            findEntry             (int ns1, int ns2,
+		                                                int key) const;
+		HumHashEntry*            findEntry             (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		HumHashEntry&            insertEntry           (int ns1, int ns2, int key);
+		void                     getSortedParameters   (MapNNKV& output) const;
 
 	private:
-		MapNNKV*    parameters;
-		std::string prefix;
+		// parameters: The list of parameters, which is allocated when the
+		// first parameter is set.  Most tokens do not have any parameters,
+		// and the ones that do typically have only a few, so a linear
+		// search is faster than a map.
+		std::vector<HumHashEntry>* parameters;
+
+		// prefix: Interned id of the prefix string for operator<<.
+		int prefix;
 
 	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
 };
@@ -23,32 +23,32 @@ namespace hum {
 
 class HumNum {
 	public:
-		         HumNum             (void);
-		         HumNum             (int value);
+		constexpr HumNum          (void) : top(0), bot(1) { }
+		constexpr HumNum          (int value) : top(value), bot(1) { }
 		         HumNum             (int numerator, int denominator);
-		         HumNum             (const HumNum& rat);
+		         HumNum             (const HumNum& rat) = default;
 		         HumNum             (const std::string& ratstring);
 		         HumNum             (const char* ratstring);
-		        ~HumNum             ();
-
-		bool     isNegative         (void) const;
-		bool     isPositive         (void) const;
-		bool     isZero             (void) const;
-		bool     isNonZero          (void) const;
-		bool     isNonNegative      (void) const;
-		bool     isNonPositive      (void) const;
-		bool     isInfinite         (void) const;
-		bool     isFinite           (void) const;
-		bool     isNaN              (void) const;
-		bool     isInteger          (void) const;
+		        ~HumNum             () = default;
+
+		constexpr bool isNegative   (void) const { return isFinite() && (top < 0); }
+		constexpr bool isPositive   (void) const { return isFinite() && (top > 0); }
+		constexpr bool isZero       (void) const { return isFinite() && (top == 0); }
+		constexpr bool isNonZero    (void) const { return isFinite() && (top != 0); }
+		constexpr bool isNonNegative(void) const { return isFinite() && (top >= 0); }
+		constexpr bool isNonPositive(void) const { return isFinite() && (top <= 0); }
+		constexpr bool isInfinite   (void) const { return (bot == 0) && (top != 0); }
+		constexpr bool isFinite     (void) const { return bot != 0; }
+		constexpr bool isNaN        (void) const { return (bot == 0) && (top == 0); }
+		constexpr bool isInteger    (void) const { return bot == 1; }
 		bool     isPowerOfTwo       (void) const;
-		double   getFloat           (void) const;
-		double   toFloat  (void) const { return getFloat(); }
+		constexpr double getFloat   (void) const { return (double)top / (double)bot; }
+		constexpr double toFloat    (void) const { return getFloat(); }
 		int      getInteger         (double round = 0.0) const;
 		int      toInteger (double round = 0.0) const {
 		                                            return getInteger(round); }
-		int      getNumerator       (void) const;
-		int      getDenominator     (void) const;
+		constexpr int getNumerator  (void) const { return top; }
+		constexpr int getDenominator(void) const { return bot; }
 		HumNum   getRemainder       (void) const;
 		void     setValue           (int numerator);
 		void     setValue           (int numerator, int denominator);
@@ -57,7 +57,7 @@ class HumNum {
 		void     invert             (void);
 		HumNum   getAbs             (void) const;
 		HumNum&  makeAbs            (void);
-		HumNum&  operator=          (const HumNum& value);
+		HumNum&  operator=          (const HumNum& value) = default;
 		HumNum&  operator=          (int value);
 		HumNum&  operator+=         (const HumNum& value);
 		HumNum&  operator+=         (int value);
@@ -100,10 +100,19 @@ class HumNum {
 		std::ostream& printList          (std::ostream& out) const;
 		std::ostream& printTwoPart  (std::ostream& out, const std::string& spacer = "+") const;
 
+		static int  getOverflowCount   (void);
+		static void clearOverflowCount (void);
+
 	protected:
 		void     reduce             (void);
 		int      gcdIterative       (int a, int b);
 		int      gcdRecursive       (int a, int b);
+		void     setWide            (long long numerator, long long denominator);
+		void     setWideReduced     (long long numerator, long long denominator);
+		void     setOverflow        (long long numerator, long long denominator);
+		static unsigned long long gcdBinary (unsigned long long a,
+		                                     unsigned long long b);
+		static int& overflowCount   (void);
 
 	private:
 		int top;
@@ -111,6 +120,410 @@ class HumNum {
 };
 
 
+
+//////////////////////////////
+//
+// HumNum::setWideReduced -- Store a fraction which is known to be in
+//    lowest terms with a positive denominator.  The 64-bit intermediate
+//    values of the arithmetic operators are checked here for overflow
+//    of the 32-bit numerator and denominator.
+//
+
+inline void HumNum::setWideReduced(long long numerator, long long denominator) {
+	if ((numerator >= -2147483647LL) && (numerator <= 2147483647LL) &&
+			(denominator <= 2147483647LL)) {
+		top = (int)numerator;
+		bot = (int)denominator;
+	} else {
+		setOverflow(numerator, denominator);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator+ -- Addition operator which adds HumNum
+//    to another HumNum or with a integers.  Products are calculated
+//    with 64-bit integers.  Fractions with the same denominator are
+//    added without cross multiplication, and adding an integer to a
+//    reduced fraction does not need a gcd.
+//
+
+inline HumNum HumNum::operator+(const HumNum& value) const {
+	HumNum output;
+	if ((bot == value.bot) && (bot > 0)) {
+		if (bot == 1) {
+			output.setWideReduced((long long)top + value.top, 1);
+		} else {
+			output.setWide((long long)top + value.top, bot);
+		}
+	} else {
+		output.setWide((long long)top * value.bot + (long long)value.top * bot,
+				(long long)bot * value.bot);
+	}
+	return output;
+}
+
+
+inline HumNum HumNum::operator+(int value) const {
+	HumNum output;
+	if (bot > 0) {
+		output.setWideReduced((long long)value * bot + top, bot);
+	} else {
+		output.setWide((long long)value * bot + top, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator- -- Subtraction operator to subtract
+//     HumNums from each other and to subtrack integers from
+//     HumNums.
+//
+
+inline HumNum HumNum::operator-(const HumNum& value) const {
+	HumNum output;
+	if ((bot == value.bot) && (bot > 0)) {
+		if (bot == 1) {
+			output.setWideReduced((long long)top - value.top, 1);
+		} else {
+			output.setWide((long long)top - value.top, bot);
+		}
+	} else {
+		output.setWide((long long)top * value.bot - (long long)value.top * bot,
+				(long long)bot * value.bot);
+	}
+	return output;
+}
+
+
+inline HumNum HumNum::operator-(int value) const {
+	HumNum output;
+	if (bot > 0) {
+		output.setWideReduced((long long)top - (long long)value * bot, bot);
+	} else {
+		output.setWide((long long)top - (long long)value * bot, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator- -- Unary negation operator to generate
+//   the negative version of a HumNum.
+//
+
+inline HumNum HumNum::operator-(void) const {
+	HumNum output;
+	if (bot > 0) {
+		output.setWideReduced(-(long long)top, bot);
+	} else {
+		output.setWide(-(long long)top, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator* -- Multiplication operator to multiply
+//   two HumNums together or a HumNum and an integer.
+//
+
+inline HumNum HumNum::operator*(const HumNum& value) const {
+	HumNum output;
+	if ((bot == 1) && (value.bot == 1)) {
+		output.setWideReduced((long long)top * value.top, 1);
+	} else {
+		output.setWide((long long)top * value.top, (long long)bot * value.bot);
+	}
+	return output;
+}
+
+
+inline HumNum HumNum::operator*(int value) const {
+	HumNum output;
+	if (bot == 1) {
+		output.setWideReduced((long long)top * value, 1);
+	} else {
+		output.setWide((long long)top * value, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator/ -- Division operator to divide two
+//     HumNums together or divide a HumNum by an integer.
+//
+
+inline HumNum HumNum::operator/(const HumNum& value) const {
+	HumNum output;
+	output.setWide((long long)top * value.bot, (long long)bot * value.top);
+	return output;
+}
+
+
+inline HumNum HumNum::operator/(int value) const {
+	HumNum output;
+	output.setWide(top, (long long)bot * value);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator+= -- Add a HumNum or integer to a HumNum.
+//
+
+inline HumNum& HumNum::operator+=(const HumNum& value) {
+	*this = *this + value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator+=(int value) {
+	*this = *this + value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator-= -- Subtract a HumNum or an integer from
+//    a HumNum.
+//
+
+inline HumNum& HumNum::operator-=(const HumNum& value) {
+	*this = *this - value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator-=(int value) {
+	*this = *this - value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator*= -- Multiply a HumNum by a HumNum or integer.
+//
+
+inline HumNum& HumNum::operator*=(const HumNum& value) {
+	*this = *this * value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator*=(int value) {
+	*this = *this * value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator/= -- Divide a HumNum by a HumNum or integer.
+//
+
+inline HumNum& HumNum::operator/=(const HumNum& value) {
+	*this = *this / value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator/=(int value) {
+	*this = *this / value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator= -- Assign an integer to a HumNum.
+//
+
+inline HumNum& HumNum::operator=(int value) {
+	top = value;
+	bot = 1;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator< -- Less-than equality for a HumNum and
+//   a HumNum, integer, or float.  Finite values are compared exactly
+//   by cross multiplication, and infinite values as floats.
+//
+
+inline bool HumNum::operator<(const HumNum& value) const {
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot < (long long)value.top * bot;
+	}
+	return getFloat() < value.getFloat();
+}
+
+
+inline bool HumNum::operator<(int value) const {
+	if (bot > 0) {
+		return top < (long long)value * bot;
+	}
+	return getFloat() < value;
+}
+
+
+inline bool HumNum::operator<(double value) const {
+	return getFloat() < value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator<= -- Less-than-or-equal equality for a
+//     HumNum with a HumNum, integer or float.
+//
+
+inline bool HumNum::operator<=(const HumNum& value) const {
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot <= (long long)value.top * bot;
+	}
+	return getFloat() <= value.getFloat();
+}
+
+
+inline bool HumNum::operator<=(int value) const {
+	if (bot > 0) {
+		return top <= (long long)value * bot;
+	}
+	return getFloat() <= value;
+}
+
+
+inline bool HumNum::operator<=(double value) const {
+	return getFloat() <= value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator> -- Greater-than equality for a HumNum
+//     compared to a HumNum, integer, or float.
+//
+
+inline bool HumNum::operator>(const HumNum& value) const {
+	return value < *this;
+}
+
+
+inline bool HumNum::operator>(int value) const {
+	if (bot > 0) {
+		return top > (long long)value * bot;
+	}
+	return getFloat() > value;
+}
+
+
+inline bool HumNum::operator>(double value) const {
+	return getFloat() > value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator>= -- Greater-than-or-equal equality
+//    comparison for a HumNum to another HumNum, integer, or float.
+//
+
+inline bool HumNum::operator>=(const HumNum& value) const {
+	return value <= *this;
+}
+
+
+inline bool HumNum::operator>=(int value) const {
+	if (bot > 0) {
+		return top >= (long long)value * bot;
+	}
+	return getFloat() >= value;
+}
+
+
+inline bool HumNum::operator>=(double value) const {
+	return getFloat() >= value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator== -- Equality test for HumNums compared to
+//   another HumNum, integer or float.
+//
+
+inline bool HumNum::operator==(const HumNum& value) const {
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot == (long long)value.top * bot;
+	}
+	return getFloat() == value.getFloat();
+}
+
+
+inline bool HumNum::operator==(int value) const {
+	if (bot > 0) {
+		return top == (long long)value * bot;
+	}
+	return getFloat() == value;
+}
+
+
+inline bool HumNum::operator==(double value) const {
+	return getFloat() == value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator!= -- Inequality test for HumNums compared
+//   to other HumNums, integers or floats.
+//
+
+inline bool HumNum::operator!=(const HumNum& value) const {
+	return !(*this == value);
+}
+
+
+inline bool HumNum::operator!=(int value) const {
+	return !(*this == value);
+}
+
+
+inline bool HumNum::operator!=(double value) const {
+	return getFloat() != value;
+}
+
+
+
 std::ostream& operator<<(std::ostream& out, const HumNum& number);
 
 template <typename A>
@@ -0,0 +1,293 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Fri Oct 16 09:57:39 PDT 2026
+// Last Modified: Fri Oct 16 18:53:37 PDT 2026
+// Filename:      HumPool.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumPool.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Fixed-size block allocator used for HumdrumLine and
+//                HumdrumToken objects.  Blocks are carved out of large
+//                contiguous chunks, and deleted objects are placed on
+//                a free list so that the next file which is read can
+//                reuse them without going through the system allocator.
+//                Each thread keeps its own free list, so allocation
+//                does not require a lock except when the list runs
+//                out.  Objects are often freed by a different thread
+//                than the one which allocated them (such as when
+//                segments are parsed by worker threads), so once a
+//                thread's free list grows past a limit the surplus is
+//                moved to a shared list, and a thread which runs out
+//                takes one chunk's worth of blocks from the shared list
+//                before it allocates a new chunk.  A new chunk is only
+//                allocated when the shared list is empty, so the pool
+//                never holds more than the peak number of live objects
+//                plus the per-thread limits.
+//
+//                Memory is never returned to the system: a chunk stays
+//                allocated after all of its objects are deleted, and is
+//                only reused for later HumdrumLine or HumdrumToken
+//                objects.  A program which reads one very large file and
+//                then continues with other work keeps that memory until
+//                it exits.  Compile with NO_HUMPOOL to use the default
+//                allocator instead (such as in that case, or when
+//                debugging with valgrind).
+//
+
+#ifndef _HUMPOOL_H_INCLUDED
+#define _HUMPOOL_H_INCLUDED
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace hum {
+
+// START_MERGE
+
+template <size_t SIZE>
+class HumPool {
+	public:
+		static void*   allocate       (void);
+		static void    deallocate     (void* ptr);
+
+	private:
+		struct Block {
+			Block* next;
+		};
+
+		// FreeList: trivially destructible so that it can still be used
+		// while thread-local and static objects are being destroyed.
+		struct FreeList {
+			Block* head;
+			size_t count;
+			bool   dead;
+		};
+
+		// Reaper: hands the thread's free list back to the shared list
+		// when the thread exits.
+		struct Reaper {
+			~Reaper() {
+				FreeList& list = getFreeList();
+				release(list.head, list.count);
+				list.head = NULL;
+				list.count = 0;
+				list.dead = true;
+			}
+		};
+
+		static FreeList&   getFreeList    (void);
+		static FreeList&   getShared      (void);
+		static std::mutex& getMutex       (void);
+		static Block*      acquire        (size_t& count);
+		static void        release        (Block* list, size_t count);
+		static void        spill          (FreeList& list);
+
+		// m_minsize: a block must be able to hold a free-list link.
+		static const size_t m_minsize = SIZE < sizeof(Block) ? sizeof(Block) : SIZE;
+
+		// m_blocksize: size of each block, rounded up so that every block
+		// is aligned for any object type.
+		static const size_t m_blocksize = (m_minsize + alignof(std::max_align_t) - 1)
+				/ alignof(std::max_align_t) * alignof(std::max_align_t);
+
+		// m_blockcount: number of blocks allocated together in each chunk.
+		static const size_t m_blockcount = (65536 / m_blocksize) < 16 ? 16 :
+				(65536 / m_blocksize);
+
+		// m_locallimit: maximum number of blocks kept on a thread's free
+		// list.  When it is exceeded, one chunk's worth of blocks is moved
+		// to the shared list.
+		static const size_t m_locallimit = 2 * m_blockcount;
+};
+
+
+
+//////////////////////////////
+//
+// HumPool::allocate -- Return a block of memory of SIZE bytes.
+//
+
+template <size_t SIZE>
+void* HumPool<SIZE>::allocate(void) {
+#ifdef NO_HUMPOOL
+	return ::operator new(SIZE);
+#else
+	FreeList& list = getFreeList();
+	if (list.head == NULL) {
+		list.head = acquire(list.count);
+	}
+	Block* block = list.head;
+	list.head = block->next;
+	list.count--;
+	return block;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::deallocate -- Place a block back onto the calling thread's
+//     free list.  If the list is longer than m_locallimit, move the
+//     surplus to the shared list.
+//
+
+template <size_t SIZE>
+void HumPool<SIZE>::deallocate(void* ptr) {
+#ifdef NO_HUMPOOL
+	::operator delete(ptr);
+#else
+	if (ptr == NULL) {
+		return;
+	}
+	Block* block = static_cast<Block*>(ptr);
+	FreeList& list = getFreeList();
+	if (list.dead) {
+		// Thread-local storage is being torn down.
+		block->next = NULL;
+		release(block, 1);
+		return;
+	}
+	block->next = list.head;
+	list.head = block;
+	if (++list.count > m_locallimit) {
+		spill(list);
+	}
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::getFreeList -- Return the free list for the calling thread.
+//
+
+template <size_t SIZE>
+typename HumPool<SIZE>::FreeList& HumPool<SIZE>::getFreeList(void) {
+	static thread_local FreeList list = { NULL, 0, false };
+	static thread_local Reaper reaper;
+	(void)reaper;
+	return list;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::getShared -- Free blocks moved off of the thread free lists,
+//     either because a list was too long or because its thread exited.
+//     Only accessed while holding the mutex.
+//
+
+template <size_t SIZE>
+typename HumPool<SIZE>::FreeList& HumPool<SIZE>::getShared(void) {
+	static FreeList shared = { NULL, 0, false };
+	return shared;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::getMutex -- Lock for chunk allocation and the shared list.
+//
+
+template <size_t SIZE>
+std::mutex& HumPool<SIZE>::getMutex(void) {
+	static std::mutex* lock = new std::mutex;
+	return *lock;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::acquire -- Return a list of free blocks, up to one chunk's
+//     worth taken from the shared list, or else a newly allocated chunk.
+//     The number of blocks in the list is stored in count.  New chunks
+//     are not tracked, since they are never deleted.
+//
+
+template <size_t SIZE>
+typename HumPool<SIZE>::Block* HumPool<SIZE>::acquire(size_t& count) {
+	std::lock_guard<std::mutex> lock(getMutex());
+	FreeList& shared = getShared();
+	if (shared.head) {
+		Block* output = shared.head;
+		Block* tail = output;
+		count = 1;
+		while ((count < m_blockcount) && tail->next) {
+			tail = tail->next;
+			count++;
+		}
+		shared.head = tail->next;
+		shared.count -= count;
+		tail->next = NULL;
+		return output;
+	}
+	char* chunk = static_cast<char*>(::operator new(m_blocksize * m_blockcount));
+	for (size_t i=0; i<m_blockcount - 1; i++) {
+		reinterpret_cast<Block*>(chunk + i * m_blocksize)->next =
+				reinterpret_cast<Block*>(chunk + (i + 1) * m_blocksize);
+	}
+	reinterpret_cast<Block*>(chunk + (m_blockcount - 1) * m_blocksize)->next = NULL;
+	count = m_blockcount;
+	return reinterpret_cast<Block*>(chunk);
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::spill -- Move one chunk's worth of blocks from the front of
+//     a thread's free list to the shared list.
+//
+
+template <size_t SIZE>
+void HumPool<SIZE>::spill(FreeList& list) {
+	Block* output = list.head;
+	Block* tail = output;
+	for (size_t i=1; i<m_blockcount; i++) {
+		tail = tail->next;
+	}
+	list.head = tail->next;
+	list.count -= m_blockcount;
+	tail->next = NULL;
+	release(output, m_blockcount);
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::release -- Move a list of count blocks to the shared free list.
+//
+
+template <size_t SIZE>
+void HumPool<SIZE>::release(Block* list, size_t count) {
+	if (list == NULL) {
+		return;
+	}
+	Block* tail = list;
+	while (tail->next) {
+		tail = tail->next;
+	}
+	std::lock_guard<std::mutex> lock(getMutex());
+	FreeList& shared = getShared();
+	tail->next = shared.head;
+	shared.head = list;
+	shared.count += count;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMPOOL_H_INCLUDED */
+
+
+
@@ -14,14 +14,20 @@
 #ifndef _HUMREGEX_H_INCLUDED
 #define _HUMREGEX_H_INCLUDED
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace hum {
 
 // START_MERGE
 
+class HumdrumToken;
+
 class HumRegex {
 	public:
 		            HumRegex           (void);
@@ -29,6 +35,18 @@ class HumRegex {
 		                                const std::string& options = "");
 		           ~HumRegex           ();
 
+		// precompiled regular expression (used by the functions below
+		// which do not have an expression parameter)
+		void        compile            (const std::string& exp,
+		                                const std::string& options = "");
+		int         search             (const std::string& input);
+		int         search             (const std::string& input, int startindex);
+		bool        match              (const std::string& input);
+		std::string&     replaceDestructive (std::string& input,
+		                                const std::string& replacement);
+		std::string      replaceCopy        (const std::string& input,
+		                                const std::string& replacement);
+
 		// setting persistent options for regular expression contruction
 		void        setIgnoreCase      (void);
 		bool        getIgnoreCase      (void);
@@ -58,6 +76,12 @@ class HumRegex {
 		std::string&     replaceDestructive (std::string* input, const std::string& replacement,
 		                                const std::string& exp,
 		                                const std::string& options);
+		// HumdrumToken versions, which change the text with setText():
+		std::string&     replaceDestructive (HumdrumToken* token, const std::string& replacement,
+		                                const std::string& exp);
+		std::string&     replaceDestructive (HumdrumToken* token, const std::string& replacement,
+		                                const std::string& exp,
+		                                const std::string& options);
 		std::string      replaceCopy        (std::string* input, const std::string& replacement,
 		                                const std::string& exp);
 		std::string      replaceCopy        (std::string* input, const std::string& replacement,
@@ -115,17 +139,30 @@ class HumRegex {
 				getTemporaryRegexFlags(const std::string& sflags);
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
+		const std::regex& setRegex     (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
+
+		static std::shared_ptr<const std::regex> getCompiledRegex(
+				const std::string& exp,
+				std::regex_constants::syntax_option_type flags);
 
 
 	private:
 
 		// m_regex: stores the regular expression to use as a default.
+		// Compiled expressions are shared between all HumRegex objects
+		// through a cache (see getCompiledRegex()), so they must not be
+		// modified.
 		//
 		// http://en.cppreference.com/w/cpp/regex/basic_regex
-		// .assign(string) == set the regular expression.
-		// operator=       == set the regular expression.
 		// .flags()        == return syntax_option_type used to construct.
-		std::regex m_regex;
+		std::shared_ptr<const std::regex> m_regex;
+
+		// m_exp: the text of the expression stored in m_regex, and
+		// m_expflags: the syntax options it was compiled with.  Used to
+		// skip the cache lookup when the same expression is used again.
+		std::string m_exp;
+		std::regex_constants::syntax_option_type m_expflags;
 
 		// m_matches: stores the matches from a search:
 		//
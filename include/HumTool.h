@@ -15,9 +15,13 @@
 
 #include "Options.h"
 #include "HumdrumFileSet.h"
+#include "HumdrumFileStream.h"
 
+#include <atomic>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace hum {
 
@@ -55,8 +59,11 @@ class HumTool : public Options {
 		std::string   getError        (void);
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
+		void          allowSegmentPrefetch(void);
 
 	protected:
+		void          allowParallelSegments(void);
+
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
 		std::stringstream m_free_text;     // output for plain text content.
@@ -68,6 +75,160 @@ class HumTool : public Options {
 };
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// runStreamParallel -- Process the segments of a HumdrumFileStream with
+//    several threads for STREAM_INTERFACE.  Segments are read in batches
+//    and parsed concurrently, then each thread runs its own copy of
+//    the tool (set up with the same command-line options) on segments
+//    from the batch.  Output is written in the input order, and
+//    processing stops at the first segment which gives an error.
+//    Only used for tools which call HumTool::allowParallelSegments(),
+//    since tools which keep state between segments would give different
+//    results depending on which segments each copy of the tool is given.
+//
+
+template <class TOOL>
+int runStreamParallel(HumdrumFileStream& instream, int argc, char** argv,
+		int threads) {
+	instream.setThreadCount(threads);
+	threads = instream.getThreadCount();
+	std::vector<TOOL> tools(threads);
+	for (int i=0; i<threads; i++) {
+		tools[i].process(argc, argv);
+	}
+	int batchsize = threads * 4;
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (true) {
+		int count = instream.readSegments(infiles, batchsize);
+		if (count == 0) {
+			break;
+		}
+		std::vector<std::string> output(count);
+		std::vector<std::string> warning(count);
+		std::vector<std::string> error(count);
+		std::vector<char> success(count, 1);
+		std::vector<char> failure(count, 0);
+		std::atomic<int> next(0);
+		auto worker = [&](TOOL& tool) {
+			int index;
+			while ((index = next++) < count) {
+				HumdrumFileSet single;
+				single.appendHumdrumPointer(&infiles[index]);
+				success[index] = tool.run(single);
+				single.clearNoFree();
+				warning[index] = tool.getWarning();
+				if (tool.hasError()) {
+					failure[index] = 1;
+					error[index] = tool.getError();
+				}
+				if (tool.hasAnyText()) {
+					output[index] = tool.getAllText();
+				} else if (!failure[index]) {
+					std::stringstream text;
+					text << infiles[index];
+					output[index] = text.str();
+				}
+				tool.clearOutput();
+			}
+		};
+		std::vector<std::thread> workers;
+		for (int i=1; i<threads; i++) {
+			workers.emplace_back(worker, std::ref(tools[i]));
+		}
+		worker(tools[0]);
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+		for (int i=0; i<count; i++) {
+			status &= success[i] ? true : false;
+			std::cerr << warning[i];
+			std::cout << output[i];
+			if (failure[i]) {
+				std::cerr << error[i];
+				return -1;
+			}
+		}
+	}
+	return !status;
+}
+
+
+
+//////////////////////////////
+//
+// runStreamInterface -- Run a tool on each segment of the input files
+//    (or standard input) for STREAM_INTERFACE, after the command-line
+//    options have been processed.  Output for each segment is printed
+//    after the tool has processed it.  Segments are read ahead if the
+//    tool has the --prefetch option (see HumTool::allowSegmentPrefetch()).
+//
+
+template <class TOOL>
+int runStreamInterface(TOOL& interface, int argc, char** argv) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	if (interface.isDefined("prefetch")) {
+		instream.setPrefetch(interface.getInteger("prefetch"),
+				(size_t)interface.getInteger("prefetch-memory") << 20);
+	}
+	if (interface.isDefined("threads") && (interface.getInteger("threads") != 1)) {
+		return runStreamParallel<TOOL>(instream, argc, argv,
+				interface.getInteger("threads"));
+	}
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (instream.readSingleSegment(infiles)) {
+		status &= interface.run(infiles);
+		if (interface.hasWarning()) {
+			interface.getWarning(std::cerr);
+		}
+		if (interface.hasAnyText()) {
+			interface.getAllText(std::cout);
+		}
+		if (interface.hasError()) {
+			interface.getError(std::cerr);
+			return -1;
+		}
+		if (!interface.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				std::cout << infiles[i];
+			}
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
+
+
+
+//////////////////////////////
+//
+// runRawStreamInterface -- Give the whole input stream (the input files
+//    or standard input) to a tool for RAW_STREAM_INTERFACE, after the
+//    command-line options have been processed, and print its output.
+//
+
+template <class TOOL>
+int runRawStreamInterface(TOOL& interface) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	bool status = interface.run(instream);
+	if (interface.hasWarning()) {
+		interface.getWarning(std::cerr);
+	}
+	if (interface.hasAnyText()) {
+		interface.getAllText(std::cout);
+	}
+	if (interface.hasError()) {
+		interface.getError(std::cerr);
+		return -1;
+	}
+	interface.clearOutput();
+	return !status;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // common command-line Interfaces
@@ -116,7 +277,11 @@ int main(int argc, char** argv) {                      \
 //////////////////////////////
 //
 // STREAM_INTERFACE -- Use HumdrumFileStream (low-memory
-//    usage implementation).
+//    usage implementation).  For tools which allow it, segments are
+//    processed in parallel when --threads is set to a value other than 1
+//    (see runStreamParallel).
+//    With --prefetch, segments are read and parsed in a separate thread
+//    while the current segment is processed.
 //
 
 #define STREAM_INTERFACE(CLASS)                                  \
@@ -124,33 +289,12 @@ using namespace std;                                             \
 using namespace hum;                                             \
 int main(int argc, char** argv) {                                \
 	CLASS interface;                                              \
+	interface.allowSegmentPrefetch();                             \
 	if (!interface.process(argc, argv)) {                         \
 		interface.getError(cerr);                                  \
 		return -1;                                                 \
 	}                                                             \
-	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	HumdrumFileSet infiles;                                       \
-	bool status = true;                                           \
-	while (instream.readSingleSegment(infiles)) {                 \
-		status &= interface.run(infiles);                          \
-		if (interface.hasWarning()) {                              \
-			interface.getWarning(cerr);                             \
-		}                                                          \
-		if (interface.hasAnyText()) {                              \
-		   interface.getAllText(cout);                             \
-		}                                                          \
-		if (interface.hasError()) {                                \
-			interface.getError(cerr);                               \
-         return -1;                                              \
-		}                                                          \
-		if (!interface.hasAnyText()) {                             \
-			for (int i=0; i<infiles.getCount(); i++) {              \
-				cout << infiles[i];                                  \
-			}                                                       \
-		}                                                          \
-		interface.clearOutput();                                   \
-	}                                                             \
-	return !status;                                               \
+	return runStreamInterface<CLASS>(interface, argc, argv);      \
 }
 
 
@@ -171,20 +315,7 @@ int main(int argc, char** argv) {                                \
 		interface.getError(cerr);                                  \
 		return -1;                                                 \
 	}                                                             \
-	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	bool status = interface.run(instream);                        \
-	if (interface.hasWarning()) {                                 \
-		interface.getWarning(cerr);                                \
-	}                                                             \
-	if (interface.hasAnyText()) {                                 \
-	   interface.getAllText(cout);                                \
-	}                                                             \
-	if (interface.hasError()) {                                   \
-		interface.getError(cerr);                                  \
-        return -1;                                               \
-	}                                                             \
-	interface.clearOutput();                                      \
-	return !status;                                               \
+	return runRawStreamInterface<CLASS>(interface);               \
 }
 
 
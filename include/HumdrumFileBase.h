@@ -38,6 +38,20 @@
 	#include <sstream>
 #endif
 
+// USING_MMAP is defined on POSIX systems so that files are read by
+// mapping them into memory rather than through an ifstream.  Define
+// NO_MMAP to read files with an ifstream on all systems.
+#if !defined(USING_MMAP) && !defined(NO_MMAP) && !defined(__EMSCRIPTEN__) \
+		&& (defined(__unix__) || defined(__APPLE__))
+	#define USING_MMAP
+#endif
+#ifdef USING_MMAP
+	#include <fcntl.h>       /* open            */
+	#include <sys/mman.h>    /* mmap, munmap    */
+	#include <sys/stat.h>    /* fstat           */
+	#include <unistd.h>      /* close           */
+#endif
+
 #include "HumSignifiers.h"
 #include "HumdrumLine.h"
 
@@ -79,6 +93,53 @@ namespace hum {
 #define OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
 #define OPT_ATTACKS   (OPT_DATA | OPT_NOREST | OPT_NOTIE | OPT_NONULL)
 
+// The following analysis levels are used with setAnalysisLevel() to
+// select which analyses are done when a file is read.  Skipped analyses
+// are done when analyze() is called, or automatically by the file, line
+// and token accessors which depend on them: spine/track and strand
+// accessors, rhythm accessors (durations, ticks, barlines), token links,
+// layout parameters, HumdrumToken::getStrandIndex() and the slur token
+// accessors.  Values read directly from the "auto" parameters with
+// getValue() (such as those set by the tie and accidental analyses) are
+// not lazy, so call analyze() with the needed levels before reading them:
+// * ANALYZE_TOKENS       => split lines into tokens.
+// * ANALYZE_SPINES       => spine info, data types and track numbers.
+// * ANALYZE_LINKS        => links between tokens on adjacent lines.
+// * ANALYZE_STRANDS      => spine strands and null token resolution.
+// * ANALYZE_GLOBALPARAMS => global (!!LO:) layout parameters.
+// * ANALYZE_LOCALPARAMS  => local (!LO:) layout parameters.
+// * ANALYZE_RHYTHM       => durations and timestamps of lines.
+// * ANALYZE_SLURS        => slur start/end linking.
+// * ANALYZE_TIES         => tie start/end linking.
+// * ANALYZE_ACCIDENTALS  => visual and cautionary accidentals.
+//
+// Compound levels:
+// * ANALYZE_BASE      (ANALYZE_TOKENS | ANALYZE_SPINES | ANALYZE_LINKS)
+//     Analyses done by HumdrumFileBase::read().
+// * ANALYZE_STRUCTURE (ANALYZE_BASE | ANALYZE_STRANDS | ANALYZE_GLOBALPARAMS
+//                      | ANALYZE_LOCALPARAMS | ANALYZE_RHYTHM)
+//     Analyses done by HumdrumFileStructure::read() (the default level).
+// * ANALYZE_CONTENT   (ANALYZE_STRUCTURE | ANALYZE_SLURS | ANALYZE_TIES
+//                      | ANALYZE_ACCIDENTALS)
+//     All analyses.
+//
+#define ANALYZE_TOKENS       0x001
+#define ANALYZE_SPINES       0x002
+#define ANALYZE_LINKS        0x004
+#define ANALYZE_STRANDS      0x008
+#define ANALYZE_GLOBALPARAMS 0x010
+#define ANALYZE_LOCALPARAMS  0x020
+#define ANALYZE_RHYTHM       0x040
+#define ANALYZE_SLURS        0x080
+#define ANALYZE_TIES         0x100
+#define ANALYZE_ACCIDENTALS  0x200
+#define ANALYZE_BASE         (ANALYZE_TOKENS | ANALYZE_SPINES | ANALYZE_LINKS)
+#define ANALYZE_STRUCTURE    (ANALYZE_BASE | ANALYZE_STRANDS | \
+                              ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS | \
+                              ANALYZE_RHYTHM)
+#define ANALYZE_CONTENT      (ANALYZE_STRUCTURE | ANALYZE_SLURS | \
+                              ANALYZE_TIES | ANALYZE_ACCIDENTALS)
+
 
 class TokenPair {
 	public:
@@ -102,7 +163,7 @@ class HumdrumFileBase : public HumHash {
 		              HumdrumFileBase          (HumdrumFileBase& infile);
 		              HumdrumFileBase          (const std::string& contents);
 		              HumdrumFileBase          (std::istream& contents);
-		             ~HumdrumFileBase          ();
+		virtual      ~HumdrumFileBase          ();
 
 		HumdrumFileBase& operator=             (HumdrumFileBase& infile);
 		bool          read                     (std::istream& contents);
@@ -117,6 +178,8 @@ class HumdrumFileBase : public HumHash {
 
 		bool          readString               (const char* contents);
 		bool          readString               (const std::string& contents);
+		bool          readBuffer               (const char* contents,
+		                                        size_t size);
 		bool          readStringCsv            (const char* contents,
 		                                        const std::string& separator=",");
 		bool          readStringCsv            (const std::string& contents,
@@ -130,6 +193,10 @@ class HumdrumFileBase : public HumHash {
 		bool          isStructureAnalyzed      (void);
 		bool          isRhythmAnalyzed         (void);
 		bool          areStrandsAnalyzed       (void);
+		void          setAnalysisLevel         (int levels);
+		int           getAnalysisLevel         (void) const;
+		bool          isAnalyzed               (int levels) const;
+		virtual bool  analyze                  (int levels);
 
     	template <class TYPE>
 		   void       initializeArray          (std::vector<std::vector<TYPE>>& array, TYPE value);
@@ -227,6 +294,9 @@ class HumdrumFileBase : public HumHash {
 		void          insertLine               (int index, HumdrumLine* line);
 
 		void          deleteLine               (int index);
+		void          markLineEdited           (int index);
+		bool          hasEdits                 (void) const;
+		virtual bool  reanalyzeEdits           (void);
 //		void          adjustMergeSpineLines    (void);
 
 		HumdrumLine*  back                     (void);
@@ -309,6 +379,18 @@ class HumdrumFileBase : public HumHash {
 		bool          processNonNullDataTokensForTrackBackward(HTp starttoken,
 		                                         std::vector<HTp> ptokens);
 		bool          setParseError             (std::stringstream& err);
+		void          checkSpines               (void) const;
+		bool          repairEditedSpines        (int startline, int endline);
+		void          getEditedRegion           (int startline, int endline,
+		                                         std::vector<HumdrumLine*>& region,
+		                                         HumdrumLine*& previous,
+		                                         HumdrumLine*& next);
+		void          clearEdits                (void);
+		std::string   getEditedText             (void);
+		void          appendLineText            (const char* text, size_t size);
+#ifdef USING_MMAP
+		bool          readMappedFile            (const char* filename);
+#endif
 		bool          setParseError             (const std::string& err);
 		bool          setParseError             (const char* format, ...);
 //		void          fixMerges                 (int linei);
@@ -374,22 +456,29 @@ class HumdrumFileBase : public HumHash {
 		// file structure has been analyzed.
 		bool m_structure_analyzed = false;
 
-		// m_rhythm_analyzed: Used to keep track of whether or not
-		// rhythm structure has been analyzed.
-		bool m_rhythm_analyzed = false;
-
-		// m_strands_analyzed: Used to keep track of whether or not
-		// file strands have been analyzed.
-		bool m_strands_analyzed = false;
+		// m_analysisLevel: ANALYZE_* analyses which are done when
+		// reading a file.
+		int m_analysisLevel = ANALYZE_STRUCTURE;
 
-		// m_slurs_analyzed: Used to keep track of whether or not
-		// slur endpoints have been linked or not.
-		bool m_slurs_analyzed = false;
+		// m_analyzed: ANALYZE_* analyses which have been done (or
+		// which are being done) on the current contents of the file.
+		int m_analyzed = 0;
 
 		// m_nulls_analyzed: Used to keep track of wheter or not
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_editStart: index of the first line which has been edited
+		// since the file was analyzed, or -1 if there are no edits.
+		int m_editStart = -1;
+
+		// m_editEnd: index of the last line which has been edited.
+		int m_editEnd = -1;
+
+		// m_editReparse: Set when an edit cannot be repaired locally
+		// by reanalyzeEdits(), such as deleting a spine manipulator.
+		bool m_editReparse = false;
+
 	public:
 		// Dummy functions to allow the HumdrumFile class's inheritance
 		// to be shifted between HumdrumFileContent (the top-level default),
@@ -16,10 +16,12 @@
 
 #include "HumdrumFileStructure.h"
 
+#include <atomic>
 #include <iostream>
 #include <cmath>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 
@@ -34,6 +36,11 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		       HumdrumFileContent         (std::istream& contents);
 		      ~HumdrumFileContent         ();
 
+		virtual bool analyze              (int levels);
+
+		void   setThreadCount             (int count);
+		int    getThreadCount             (void) const;
+
 		bool   analyzeSlurs               (void);
 	private:
 		bool   analyzeMensSlurs           (void);
@@ -100,9 +107,17 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		                                   std::vector<std::pair<HTp, HTp>>& labels,
 		                                   std::vector<int>& endings,
 		                                   const std::string& linksig = "");
+		bool   analyzeSlurSpines          (std::vector<HTp>& spinestarts,
+		                                   std::vector<HTp>& linkstarts,
+		                                   std::vector<HTp>& linkends,
+		                                   std::vector<std::pair<HTp, HTp>>& labels,
+		                                   std::vector<int>& endings,
+		                                   const std::string& linksig);
 		bool   analyzeKernTies            (std::vector<std::pair<HTp, int>>& linkedtiestarts,
 		                                   std::vector<std::pair<HTp, int>>& linkedtieends,
 		                                   std::string& linkSignifier);
+		bool   analyzeKernAccidentals     (std::vector<HTp>& tokens,
+		                                   std::vector<char>& barlines);
 		void   fillKeySignature           (std::vector<int>& states,
 		                                   const std::string& keysig);
 		void   resetDiatonicStatesWithKeySignature(std::vector<int>& states,
@@ -126,6 +141,14 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		void    checkDataForCrossStaffStems(HTp token, std::string& above, std::string& below);
 		void    prepareStaffAboveNoteStems (HTp token);
 		void    prepareStaffBelowNoteStems (HTp token);
+
+		template <class TASK>
+		void    runSpineTasks             (int count, TASK task);
+
+	private:
+		// m_threads: number of threads used to analyze spines concurrently
+		// in the content analyses.
+		int m_threads = 1;
 };
 
 
@@ -134,6 +157,45 @@ class HumdrumFileContent : public HumdrumFileStructure {
 //
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::runSpineTasks -- Run task(0) to task(count-1),
+//    using the number of threads given by setThreadCount().  Each task
+//    should only change the tokens of its own spine (or strand), and
+//    store any other results in its own slot so that the caller can
+//    merge them in spine order afterwards.  Analyses which are done
+//    on demand (such as rhythm or null-token resolution) must be done
+//    before the tasks are run.
+//
+
+template <class TASK>
+void HumdrumFileContent::runSpineTasks(int count, TASK task) {
+	int threads = m_threads < count ? m_threads : count;
+	if (threads <= 1) {
+		for (int i=0; i<count; i++) {
+			task(i);
+		}
+		return;
+	}
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			task(index);
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileContent::prependDataSpine -- prepend a data spine
@@ -22,9 +22,14 @@
 #include "Options.h"
 
 
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace hum {
@@ -40,11 +45,13 @@ class HumdrumFileStream {
 		                HumdrumFileStream  (const std::vector<std::string>& list);
 		                HumdrumFileStream  (Options& options);
 		                HumdrumFileStream  (const string& datastream);
+		               ~HumdrumFileStream  ();
 
 		void            loadString         (const string& data);
 
 		int             setFileList        (char** list);
 		int             setFileList        (const std::vector<std::string>& list);
+		const std::vector<std::string>& getFileList(void) const;
 
 		void            clear              (void);
 		int             eof                (void);
@@ -53,6 +60,29 @@ class HumdrumFileStream {
 		int             read               (HumdrumFile& infile);
 		int             read               (HumdrumFileSet& infiles);
 		int             readSingleSegment  (HumdrumFileSet& infiles);
+		int             readSegments       (HumdrumFileSet& infiles, int count);
+
+		void            setThreadCount     (int count);
+		int             getThreadCount     (void) const;
+
+		void            setPrefetch        (int count, size_t maxbytes = 0);
+		int             getPrefetchCount   (void) const;
+
+		// Random access to the segments of a single file (see
+		// HumdrumFileStream-index.cpp):
+		int             buildSegmentIndex  (const std::string& filename);
+		bool            writeSegmentIndex  (std::ostream& out);
+		bool            writeSegmentIndex  (const std::string& filename);
+		bool            readSegmentIndex   (std::istream& input);
+		bool            readSegmentIndex   (const std::string& filename);
+		int             getSegmentCount    (void) const;
+		int             getSegmentNumber   (const std::string& name) const;
+		std::string     getSegmentName     (int index) const;
+		int             getSegmentLevel    (int index) const;
+		long long       getSegmentOffset   (int index) const;
+		bool            readSegment        (HumdrumFile& infile, int index);
+		bool            readSegment        (HumdrumFile& infile,
+		                                    const std::string& name);
 
 	protected:
 		std::stringstream m_stringbuffer;   // used to read files from a string
@@ -66,6 +96,81 @@ class HumdrumFileStream {
 
 		std::vector<std::string>  m_universals;     // storage for universal comments
 
+		// m_threads: number of threads used to parse segments in readSegments().
+		int m_threads = 1;
+
+		// SegmentEntry: the reading state of the stream at the start of
+		// a segment, which is enough to read the segment without reading
+		// the ones before it.
+		struct SegmentEntry {
+			long long   offset;      // byte offset after the pending line
+			int         level;       // !!!!SEGMENT level
+			int         universals;  // index into m_segmentuniversals
+			std::string pending;     // m_newfilebuffer contents
+			std::string name;        // filename of the segment
+		};
+
+		// m_indexfile: the file described by the segment index.
+		std::string m_indexfile;
+
+		// m_segments: the segment index created by buildSegmentIndex().
+		std::vector<SegmentEntry> m_segments;
+
+		// m_segmentuniversals: universal comments which are in effect
+		// for segments in the index.
+		std::vector<std::vector<std::string>> m_segmentuniversals;
+
+		// m_segmentnames: segment index for each segment name.
+		std::map<std::string, int> m_segmentnames;
+
+		// PrefetchEntry: a segment read by the prefetch thread.
+		struct PrefetchEntry {
+			HumdrumFile* infile;   // filename and level, plus contents if parsed
+			std::string  contents; // text of the segment if not parsed
+			bool         parsed;   // true if infile has been parsed
+			size_t       size;     // parsed size if parsed, else text length
+		};
+
+		// m_prefetchcount: maximum number of segments read ahead of the
+		// caller (0 to read segments only when requested).
+		int m_prefetchcount = 0;
+
+		// m_prefetchbytes: maximum total size of the segments which have
+		// been read ahead (0 for no limit).  Parsed segments are counted
+		// by getParsedSize(), unparsed ones by the length of their text.
+		size_t m_prefetchbytes = 0;
+
+		// m_prefetchsize: total size of the segments in m_prefetchqueue.
+		size_t m_prefetchsize = 0;
+
+		// m_prefetchparse: true if the prefetch thread also parses segments.
+		bool m_prefetchparse = true;
+
+		// m_prefetchdone: true when the prefetch thread has reached the end
+		// of the input.
+		bool m_prefetchdone = false;
+
+		// m_prefetchstop: set to ask the prefetch thread to exit.
+		bool m_prefetchstop = false;
+
+		std::deque<PrefetchEntry> m_prefetchqueue;
+		std::thread               m_prefetchthread;
+		std::mutex                m_prefetchlock;
+		std::condition_variable   m_prefetchready;  // queue is not empty or done
+		std::condition_variable   m_prefetchroom;   // queue has space or stop
+
+		void     startPrefetch            (bool parse);
+		void     stopPrefetch             (void);
+		void     prefetchSegments         (void);
+		HumdrumFile* takeSegment          (std::string& contents, bool& parsed);
+		static size_t getParsedSize       (HumdrumFile& infile);
+
+		int      getFileText              (HumdrumFile& infile, std::string& contents);
+		static void parseFileText         (HumdrumFile& infile,
+		                                   const std::string& contents);
+		static std::string escapeIndexText   (const std::string& text);
+		static std::string unescapeIndexText (const std::string& text);
+
 		// Automatic URL downloading of data from internet in read():
 		void     fillUrlBuffer            (std::stringstream& uribuffer,
 		                                   const std::string& uriname);
@@ -28,6 +28,12 @@ namespace hum {
 
 // START_MERGE
 
+// Records of the binary .humb file format (see HumdrumFileStructure-binary.cpp).
+struct HumbHeader;
+struct HumbString;
+struct HumbLine;
+struct HumbToken;
+
 class HumdrumFileStructure : public HumdrumFileBase {
 	public:
 		              HumdrumFileStructure         (void);
@@ -81,10 +87,20 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          readStringNoRhythmCsv        (const std::string& contents,
 		                                            const std::string& separator = ",");
 
+		// binary cache (.humb) of analyzed files:
+		bool          writeBinary                  (const std::string& filename);
+		bool          writeBinary                  (std::ostream& out);
+		bool          readBinary                   (const std::string& filename);
+		bool          readBinary                   (const char* filename);
+		bool          readBinaryBuffer             (const char* data, size_t size);
+		static bool   isBinaryBuffer               (const char* data, size_t size);
+
 		// rhythmic analysis related functionality:
 		HumNum        getScoreDuration             (void) const;
 		std::ostream&      printDurationInfo       (std::ostream& out = std::cout);
 		int           tpq                          (void);
+		long long     durationToTicks              (HumNum duration);
+		HumNum        ticksToDuration              (long long ticks);
 
 		// strand functionality:
 		HTp           getStrandStart               (int index);
@@ -111,6 +127,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          analyzeStructureNoRhythm     (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
+		virtual bool  analyze                      (int levels);
+		virtual bool  reanalyzeEdits               (void);
 
 		// signifier access
 		std::string   getKernLinkSignifier         (void);
@@ -136,12 +154,14 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          assignDurationsToTrack       (HTp starttoken,
 		                                            HumNum startdur);
 		bool          prepareDurations             (HTp token, int state,
-		                                            HumNum startdur);
+		                                            HumNum startdur,
+		                                            std::vector<std::pair<HTp, HumNum>>& worklist);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
 		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
 		bool          analyzeNullLineRhythms       (void);
 		void          fillInNegativeStartTimes     (void);
 		void          assignLineDurations          (void);
+		void          assignLineTicks              (void);
 		void          assignStrandsToTokens        (void);
 		std::set<HumNum>   getNonZeroLineDurations      (void);
 		std::set<HumNum>   getPositiveLineDurations     (void);
@@ -153,6 +173,45 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            HTp starttok);
 		void          analyzeSignifiers            (void);
 		void          setLineRhythmAnalyzed        (void);
+		void          checkRhythm                  (void) const;
+		bool          repairEditedStructure        (int startline, int endline);
+		void          repairEditedStrands          (std::vector<HumdrumLine*>& region,
+		                                            HumdrumLine* next,
+		                                            int startline, int endline);
+		HTp           getEditedStrandStart         (HTp token, int startline,
+		                                            int endline);
+		bool          isTimedLine                  (HumdrumLine* line);
+		bool          repairEditedRhythm           (HumdrumLine* first, int endline);
+		void          repairNonRhythmicDurations   (HumdrumLine* first,
+		                                            int startindex, int endindex);
+		void          repairMeter                  (int startindex, int endindex);
+		void          repairNonNullDataTokens      (HumdrumLine* first,
+		                                            int startline, int endline);
+		void          repairNullResolutions        (HumdrumLine* first,
+		                                            int endline);
+		static void   setBinaryNumber              (int* output, const HumNum& value);
+		int           getBinaryTokenIndex          (HTp token,
+		                                            const std::vector<int>& lineoffsets);
+		bool          storeBinaryLinks             (HumbString& output,
+		                                            const std::vector<HTp>& tokens,
+		                                            std::vector<int>& links,
+		                                            const std::vector<int>& lineoffsets);
+		static void   loadBinaryLinks              (std::vector<HTp>& output,
+		                                            const HumbString& range,
+		                                            const int* links,
+		                                            const std::vector<HTp>& tokens);
+		static bool   checkBinaryTables            (const HumbHeader& header,
+		                                            const HumbLine* lines,
+		                                            const HumbToken* tokens,
+		                                            const int* links,
+		                                            const HumbString* infos,
+		                                            const int* trackstarts,
+		                                            const int* trackendcounts,
+		                                            const int* trackends,
+		                                            const int* strands,
+		                                            const int* strand2dcounts,
+		                                            const int* strands2d,
+		                                            const int* barlines);
 };
 
 
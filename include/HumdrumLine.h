@@ -16,6 +16,7 @@
 
 #include "HumdrumToken.h"
 #include "HumHash.h"
+#include "HumPool.h"
 
 #include <iostream>
 #include <string>
@@ -38,6 +39,9 @@ class HumdrumLine : public std::string, public HumHash {
 		            HumdrumLine            (HumdrumLine& line, void* owner);
 		           ~HumdrumLine            ();
 
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr, size_t size);
+
 		HumdrumLine& operator=             (HumdrumLine& line);
 		bool        isComment              (void) const;
 		bool        isCommentLocal         (void) const;
@@ -115,6 +119,11 @@ class HumdrumLine : public std::string, public HumHash {
 		HumNum      getDurationFromBarline (HumNum scale);
 		HumNum      getDurationToBarline   (HumNum scale);
 		HumNum      getBarlineDuration     (HumNum scale);
+
+		long long   getTickDuration        (void);
+		long long   getTicksFromStart      (void);
+		long long   getTicksFromBarline    (void);
+		long long   getTicksToBarline      (void);
 		int         getKernNoteAttacks     (void);
 		int         addLinkedParameter     (HTp token);
 
@@ -126,7 +135,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     setLineFromCsv         (const std::string& csv,
 		                                 const std::string& separator = ",");
 
-		// low-level editing functions (need to re-analyze structure after using)
+		// low-level editing functions (call HumdrumFile::reanalyzeEdits() after using)
 		void     appendToken            (HTp token, int tabcount = 1);
 		void     appendToken            (const HumdrumToken& token, int tabcount = 1);
 		void     appendToken            (const std::string& token, int tabcount = 1);
@@ -141,6 +150,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     insertToken            (int index, const HumdrumToken& token, int tabcount = 1);
 		void     insertToken            (int index, const std::string& token, int tabcount = 1);
 		void     insertToken            (int index, const char* token, int tabcount = 1);
+		void     markEdited             (void);
 
 		void     setDuration            (HumNum aDur);
 		void     setDurationFromStart   (HumNum dur);
@@ -154,6 +164,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     clear                  (void);
 		void     setOwner               (void* hfile);
 		int      createTokensFromLine   (void);
+		void     checkTokens            (void) const;
 		void     setLayoutParameters    (void);
 		void     setParameters          (const std::string& pdata);
 		void     storeGlobalLinkedParameters(void);
@@ -182,7 +193,9 @@ class HumdrumLine : public std::string, public HumHash {
 		// createLineFromTokens() in that case.  The second case is more
 		// useful: you can read in a HumdrumFile, tweak the tokens, then
 		// reconstruct the full line and print out again.
-		// This variable is filled by HumdrumFile::read().
+		// This variable is filled by HumdrumFile::read(), or when the tokens
+		// are first accessed if the ANALYZE_TOKENS analysis level was not
+		// used when reading the file.
 		// The contents of this vector should be deleted when deconstructing
 		// a HumdrumLine object.
 		std::vector<HumdrumToken*> m_tokens;
@@ -218,6 +231,17 @@ class HumdrumLine : public std::string, public HumHash {
 		// This variable is filled by HumdrumFileStructure::analyzeMeter().
 		HumNum m_durationToBarline;
 
+		// m_tickDuration, m_ticksFromStart, m_ticksFromBarline,
+		// m_ticksToBarline: The above durations in ticks (see
+		// HumdrumFileStructure::tpq()), so that times can be compared
+		// and added as integers.  These variables are filled by
+		// HumdrumFileStructure::assignLineTicks() and are -1 if rhythm
+		// has not been analyzed.
+		long long m_tickDuration = -1;
+		long long m_ticksFromStart = -1;
+		long long m_ticksFromBarline = -1;
+		long long m_ticksToBarline = -1;
+
 		// m_linkedParameters: List of Humdrum tokens which are parameters
 		// (mostly only layout parameters at the moment)
 		std::vector<HTp> m_linkedParameters;
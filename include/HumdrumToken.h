@@ -13,6 +13,7 @@
 #ifndef _HUMDRUMTOKEN_H_INCLUDED
 #define _HUMDRUMTOKEN_H_INCLUDED
 
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -23,6 +24,8 @@ class HumParamSet;
 #include "HumAddress.h"
 #include "HumHash.h"
 #include "HumParamSet.h"
+#include "HumPool.h"
+#include "KernNote.h"
 
 namespace hum {
 
@@ -44,6 +47,9 @@ class HumdrumToken : public std::string, public HumHash {
 		         HumdrumToken              (const std::string& token);
 		        ~HumdrumToken              ();
 
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr, size_t size);
+
 		bool     isNull                    (void) const;
 		bool     isManipulator             (void) const;
 
@@ -115,6 +121,7 @@ class HumdrumToken : public std::string, public HumHash {
 
 		HumNum   getDuration               (void);
 		HumNum   getDuration               (HumNum scale);
+		bool     hasStaleDuration          (void) const;
 		HumNum   getTiedDuration           (void);
 		HumNum   getTiedDuration           (HumNum scale);
 		HumNum   getDurationNoDots         (void);
@@ -124,6 +131,9 @@ class HumdrumToken : public std::string, public HumHash {
 		HumNum   getDurationFromStart      (void);
 		HumNum   getDurationFromStart      (HumNum scale);
 
+		long long getTickDuration          (void);
+		long long getTicksFromStart        (void);
+
 		HumNum   getDurationToEnd          (void);
 		HumNum   getDurationToEnd          (HumNum scale);
 
@@ -158,6 +168,10 @@ class HumdrumToken : public std::string, public HumHash {
 		bool     noteInLowerSubtrack       (void);
 		std::string   getTrackString       (void) const;
 		int      getSubtokenCount          (const std::string& separator = " ") const;
+		const KernNote& getKernNote        (int index = 0) const;
+		int      getKernNoteCount          (void) const;
+		unsigned int getKernNoteFlags      (void) const;
+		HumNum   getRecipDuration          (void) const;
 		std::string   getSubtoken          (int index,
 		                                    const std::string& separator = " ") const;
 		std::vector<std::string> getSubtokens (const std::string& separator = " ") const;
@@ -252,6 +266,8 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setStrandIndex            (int index);
 
 		bool     analyzeDuration           (void);
+		void     checkAnalysis             (int levels) const;
+		bool     getDurationFromText       (HumNum& duration) const;
 		std::ostream& printXmlBaseInfo     (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlContentInfo  (std::ostream& out = std::cout, int level = 0,
@@ -264,6 +280,36 @@ class HumdrumToken : public std::string, public HumHash {
 		                                    const std::string& indent = "\t");
 
 	private:
+		unsigned int getTextFlags          (void) const;
+		int      getDataTypeClass          (void) const;
+		void     clearCachedState          (void);
+		void     analyzeKernNotes          (void) const;
+		static void invalidateDataTypes    (void);
+		static std::atomic<int>& getDataTypeEpoch (void);
+
+		// Bit flags for m_textflags, describing characters found in the
+		// text of the token.
+		enum {
+			TEXT_ANALYZED     = 1 << 0,  // flags below have been calculated
+			TEXT_NULL         = 1 << 1,  // ".", "*" or "!"
+			TEXT_PITCH        = 1 << 2,  // a-g or A-G
+			TEXT_REST         = 1 << 3,  // r
+			TEXT_TIE_CONTINUE = 1 << 4,  // _ or ]
+			TEXT_GRACE        = 1 << 5,  // q
+			TEXT_CHORD        = 1 << 6,  // space
+			TEXT_SLUR_START   = 1 << 7,  // (
+			TEXT_SLUR_END     = 1 << 8,  // )
+			TEXT_BEAM         = 1 << 9   // L, J, k or K
+		};
+
+		// Values for m_datatype.
+		enum {
+			DATATYPE_OTHER = 0,
+			DATATYPE_KERN,
+			DATATYPE_MENS,
+			DATATYPE_RECIP
+		};
+
 		// address: The address contains information about the location of
 		// the token on a HumdrumLine and in a HumdrumFile.
 		HumAddress m_address;
@@ -321,6 +367,28 @@ class HumdrumToken : public std::string, public HumHash {
 		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
 		bool m_rhythm_analyzed = false;
 
+		// m_textflags: Classification of the token text which is used by
+		// isNote(), isRest(), isNull() and similar functions.  Calculated
+		// in a single pass over the text the first time that it is needed,
+		// and cleared by setText().  Use setText() (or the HumRegex
+		// replaceDestructive() functions which take an HTp) rather than
+		// std::string functions to change the text of a token so that the
+		// flags are not left stale.
+		mutable unsigned int m_textflags = 0;
+
+		// m_datatype: Cached class of the exclusive interpretation of the
+		// token's spine, so that isKern() and similar functions do not
+		// have to look up the data type each time.  The cached value is
+		// valid while m_datatypeEpoch matches getDataTypeEpoch(), which
+		// changes whenever an exclusive interpretation is added or edited.
+		mutable int m_datatype = DATATYPE_OTHER;
+		mutable int m_datatypeEpoch = -1;
+
+		// m_kernnotes: Parsed **kern subtokens (see getKernNote()), filled
+		// in the first time that they are requested and cleared along with
+		// m_textflags.
+		mutable std::vector<KernNote> m_kernnotes;
+
 	friend class HumdrumLine;
 	friend class HumdrumFileBase;
 	friend class HumdrumFileStructure;
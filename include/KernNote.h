@@ -0,0 +1,135 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Fri Oct 16 10:13:17 PDT 2026
+// Last Modified: Fri Oct 16 10:13:17 PDT 2026
+// Filename:      KernNote.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/KernNote.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Parsed contents of a single **kern subtoken (one note or
+//                rest of a chord).  The subtoken text is scanned once and
+//                the pitch, rhythm and notational markers are stored so
+//                that they can be queried without rescanning the text.
+//                The pitch values are identical to those returned by the
+//                Convert::kernTo*() functions for the same subtoken.
+//
+
+#ifndef _KERNNOTE_H_INCLUDED
+#define _KERNNOTE_H_INCLUDED
+
+#include "HumNum.h"
+
+namespace hum {
+
+// START_MERGE
+
+class KernNote {
+	public:
+		              KernNote             (void);
+		              KernNote             (const char* text, int length);
+
+		void          parse                (const char* text, int length);
+
+		// Bit flags for notational markers (see hasFlag()).
+		enum {
+			NOTE_TIE_START      = 1 << 0,  // [
+			NOTE_TIE_CONTINUE   = 1 << 1,  // _
+			NOTE_TIE_END        = 1 << 2,  // ]
+			NOTE_SLUR_START     = 1 << 3,  // (
+			NOTE_SLUR_END       = 1 << 4,  // )
+			NOTE_BEAM_START     = 1 << 5,  // L
+			NOTE_BEAM_END       = 1 << 6,  // J
+			NOTE_BEAM_PARTIAL   = 1 << 7,  // k or K
+			NOTE_GRACE          = 1 << 8,  // q
+			NOTE_STACCATO       = 1 << 9,  // '
+			NOTE_STACCATISSIMO  = 1 << 10, // `
+			NOTE_ACCENT         = 1 << 11, // ^
+			NOTE_TENUTO         = 1 << 12, // ~
+			NOTE_FERMATA        = 1 << 13, // ;
+			NOTE_NATURAL        = 1 << 14, // n
+			NOTE_PITCH          = 1 << 15, // a-g or A-G
+			NOTE_REST           = 1 << 16  // r
+		};
+
+		bool          hasFlag              (unsigned int flag) const
+		                                       { return (m_flags & flag) != 0; }
+		unsigned int  getFlags             (void) const { return m_flags; }
+
+		bool          isRest               (void) const
+		                                       { return hasFlag(NOTE_REST); }
+		bool          isNote               (void) const
+		                                       { return hasFlag(NOTE_PITCH); }
+		bool          isGrace              (void) const
+		                                       { return hasFlag(NOTE_GRACE); }
+		bool          isSecondaryTiedNote  (void) const;
+		bool          hasSlurStart         (void) const
+		                                       { return hasFlag(NOTE_SLUR_START); }
+		bool          hasSlurEnd           (void) const
+		                                       { return hasFlag(NOTE_SLUR_END); }
+
+		int           getDiatonicPC        (void) const { return m_diatonic; }
+		char          getDiatonicUC        (void) const { return m_letter; }
+		char          getDiatonicLC        (void) const;
+		int           getAccidentalCount   (void) const { return m_accidental; }
+		int           getOctaveNumber      (void) const { return m_octave; }
+		int           getBase40            (void) const { return m_base40; }
+		int           getBase40PC          (void) const;
+		int           getBase12            (void) const;
+		int           getBase12PC          (void) const;
+		int           getBase7             (void) const;
+		int           getMidiNoteNumber    (void) const;
+
+		HumNum        getDuration          (void) const { return m_duration; }
+		HumNum        getVisualDuration    (void) const { return m_visual; }
+		int           getDotCount          (void) const { return m_dots; }
+		char          getStemDirection     (void) const { return m_stem; }
+
+	private:
+		// m_duration: Logical duration in quarter notes, as returned by
+		// Convert::recipToDuration().  Grace notes have a zero duration.
+		HumNum m_duration;
+
+		// m_visual: Printed duration in quarter notes, which is the same as
+		// m_duration except for grace notes.
+		HumNum m_visual;
+
+		// m_diatonic: Diatonic pitch class (C=0 to B=6), or -1000 for a
+		// rest and -2000 if there is no pitch.
+		int m_diatonic;
+
+		// m_accidental: Sum of sharps (+1) and flats (-1).
+		int m_accidental;
+
+		// m_octave: Octave number with middle C in octave 4, or -1000 if
+		// the subtoken is a rest or has no valid pitch.
+		int m_octave;
+
+		// m_base40: Base-40 pitch, or the (negative) diatonic value if
+		// there is no pitch.
+		int m_base40;
+
+		// m_flags: NOTE_* flags for markers found in the subtoken.
+		unsigned int m_flags;
+
+		// m_dots: Number of augmentation dots.
+		unsigned char m_dots;
+
+		// m_letter: Uppercase diatonic letter, 'R' for rests, or 'X' if
+		// there is no pitch.
+		char m_letter;
+
+		// m_stem: First stem direction in the subtoken: '/' for up,
+		// '\\' for down, or '\0' if none.
+		char m_stem;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _KERNNOTE_H_INCLUDED */
+
+
+
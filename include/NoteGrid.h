@@ -15,6 +15,10 @@
 
 #include "NoteCell.h"
 
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
 using namespace std;
 
 namespace hum {
@@ -71,15 +75,147 @@ class NoteGrid {
 	protected:
 		void       buildAttackIndexes    (void);
 		void       buildAttackIndex      (int vindex);
+		void       buildDurations        (void);
+		void       calculateNumericPitches(int index);
+		int        getIndex              (int vindex, int sindex);
 
 	private:
-		vector<vector<NoteCell*> > m_grid;
+		// Cell flags:
+		enum {
+			CELL_REST    = 1,  // no pitch (base-40 pitch is NaN).
+			CELL_NOPITCH = 2   // no diatonic/MIDI pitch or accidental.
+		};
+
+		// m_cells: one NoteCell view for each cell of the grid.  All of the
+		// per-cell arrays below are stored by voice and then by slice:
+		// index = vindex * m_slices + sindex.
+		vector<NoteCell>           m_cells;
+
+		// m_tokens: the note (or null/rest) token of each cell.
+		vector<HTp>                m_tokens;
+
+		// m_b7, m_b12, m_b40, m_accidental: diatonic, MIDI and base-40 pitch
+		// and chromatic alteration of each cell.  Values are negative for
+		// sustained notes; see m_flags for rests.
+		vector<int>                m_b7;
+		vector<int>                m_b12;
+		vector<int>                m_b40;
+		vector<int>                m_accidental;
+
+		// m_flags: CELL_* flags for each cell.
+		vector<unsigned char>      m_flags;
+
+		// m_prevattack, m_currattack, m_nextattack: slice indexes of the
+		// previous, current and next note attacks (or first rests of
+		// rest sequences) in the voice; -1 for none.
+		vector<int>                m_prevattack;
+		vector<int>                m_currattack;
+		vector<int>                m_nextattack;
+
+		// m_durations: duration of the note (or rest) in each cell, from
+		// its attack to the next attack in the voice.  Calculated when
+		// first needed.
+		vector<HumNum>             m_durations;
+
+		// m_metertops, m_meterbots: prevailing meter signature of each cell.
+		vector<int>                m_metertops;
+		vector<HumNum>             m_meterbots;
+
+		// m_voices, m_slices: size of the grid.
+		int                        m_voices = 0;
+		int                        m_slices = 0;
+
 		vector<HTp>                m_kernspines;
 		vector<double>             m_metriclevels;
-		HumdrumFile*               m_infile;
+		HumdrumFile*               m_infile = NULL;
+
+	friend NoteCell;
 };
 
 
+
+//////////////////////////////
+//
+// NoteGrid::getIndex -- Return the index of a cell in the grid arrays.
+//
+
+inline int NoteGrid::getIndex(int vindex, int sindex) {
+	if (((unsigned)vindex >= (unsigned)m_voices) ||
+			((unsigned)sindex >= (unsigned)m_slices)) {
+		throw std::out_of_range("NoteGrid cell index out of range");
+	}
+	return vindex * m_slices + sindex;
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell accessors -- These read the NoteGrid arrays for the cell.
+//
+
+inline double NoteCell::getSgnDiatonicPitch(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) ? GRIDREST
+			: m_owner->m_b7[m_index];
+}
+
+inline double NoteCell::getSgnMidiPitch(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) ? GRIDREST
+			: m_owner->m_b12[m_index];
+}
+
+inline double NoteCell::getSgnBase40Pitch(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) ? GRIDREST
+			: m_owner->m_b40[m_index];
+}
+
+inline double NoteCell::getSgnAccidental(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) ? GRIDREST
+			: m_owner->m_accidental[m_index];
+}
+
+inline double NoteCell::getAbsDiatonicPitch(void) {
+	return fabs(getSgnDiatonicPitch());
+}
+
+inline double NoteCell::getAbsMidiPitch(void) {
+	return fabs(getSgnMidiPitch());
+}
+
+inline double NoteCell::getAbsBase40Pitch(void) {
+	return fabs(getSgnBase40Pitch());
+}
+
+inline double NoteCell::getAbsAccidental(void) {
+	return fabs(getSgnAccidental());
+}
+
+inline HTp NoteCell::getToken(void) {
+	return m_owner->m_tokens[m_index];
+}
+
+inline int NoteCell::getNextAttackIndex(void) {
+	return m_owner->m_nextattack[m_index];
+}
+
+inline int NoteCell::getPrevAttackIndex(void) {
+	return m_owner->m_prevattack[m_index];
+}
+
+inline int NoteCell::getCurrAttackIndex(void) {
+	return m_owner->m_currattack[m_index];
+}
+
+inline bool NoteCell::isRest(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) ? true : false;
+}
+
+inline bool NoteCell::isAttack(void) {
+	return !isRest() && (m_owner->m_b40[m_index] > 0);
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
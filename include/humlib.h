@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Thu Oct 17 00:23:09 PDT 2019
+// Last Modified: Sat Oct 17 01:53:46 UTC 2026
 // Filename:      humlib.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/humlib.h
 // Syntax:        C++11
@@ -39,24 +39,35 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _HUMLIB_H_INCLUDED
 
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstddef>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <list>
 #include <locale>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <regex>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -90,27 +101,548 @@ using std::vector;
    #include <sstream>
 #endif
 
+#if !defined(USING_MMAP) && !defined(NO_MMAP) && !defined(__EMSCRIPTEN__) \
+		&& (defined(__unix__) || defined(__APPLE__))
+	#define USING_MMAP
+#endif
+#ifdef USING_MMAP
+	#include <fcntl.h>       /* open            */
+	#include <sys/mman.h>    /* mmap, munmap    */
+	#include <sys/stat.h>    /* fstat           */
+	#include <unistd.h>      /* close           */
+#endif
+
 #include "pugiconfig.hpp"
 #include "pugixml.hpp"
 
-using pugi::xml_node;
-using pugi::xml_attribute;
-using pugi::xml_document;
-using pugi::xpath_node;
+using pugi::xml_node;
+using pugi::xml_attribute;
+using pugi::xml_document;
+using pugi::xpath_node;
+
+namespace hum {
+
+class Convert;
+class HumNum;
+class HumAddress;
+class HumdrumToken;
+typedef HumdrumToken* HTp;
+class HumdrumLine;
+class HumdrumFileBase;
+class HumdrumFileStructure;
+class HumdrumFileContent;
+class HumdrumFile;
+class GridVoice;
+
+
+class HumNum {
+	public:
+		constexpr HumNum          (void) : top(0), bot(1) { }
+		constexpr HumNum          (int value) : top(value), bot(1) { }
+		         HumNum             (int numerator, int denominator);
+		         HumNum             (const HumNum& rat) = default;
+		         HumNum             (const std::string& ratstring);
+		         HumNum             (const char* ratstring);
+		        ~HumNum             () = default;
+
+		constexpr bool isNegative   (void) const { return isFinite() && (top < 0); }
+		constexpr bool isPositive   (void) const { return isFinite() && (top > 0); }
+		constexpr bool isZero       (void) const { return isFinite() && (top == 0); }
+		constexpr bool isNonZero    (void) const { return isFinite() && (top != 0); }
+		constexpr bool isNonNegative(void) const { return isFinite() && (top >= 0); }
+		constexpr bool isNonPositive(void) const { return isFinite() && (top <= 0); }
+		constexpr bool isInfinite   (void) const { return (bot == 0) && (top != 0); }
+		constexpr bool isFinite     (void) const { return bot != 0; }
+		constexpr bool isNaN        (void) const { return (bot == 0) && (top == 0); }
+		constexpr bool isInteger    (void) const { return bot == 1; }
+		bool     isPowerOfTwo       (void) const;
+		constexpr double getFloat   (void) const { return (double)top / (double)bot; }
+		constexpr double toFloat    (void) const { return getFloat(); }
+		int      getInteger         (double round = 0.0) const;
+		int      toInteger (double round = 0.0) const {
+		                                            return getInteger(round); }
+		constexpr int getNumerator  (void) const { return top; }
+		constexpr int getDenominator(void) const { return bot; }
+		HumNum   getRemainder       (void) const;
+		void     setValue           (int numerator);
+		void     setValue           (int numerator, int denominator);
+		void     setValue           (const std::string& ratstring);
+		void     setValue           (const char* ratstring);
+		void     invert             (void);
+		HumNum   getAbs             (void) const;
+		HumNum&  makeAbs            (void);
+		HumNum&  operator=          (const HumNum& value) = default;
+		HumNum&  operator=          (int value);
+		HumNum&  operator+=         (const HumNum& value);
+		HumNum&  operator+=         (int value);
+		HumNum&  operator-=         (const HumNum& value);
+		HumNum&  operator-=         (int value);
+		HumNum&  operator*=         (const HumNum& value);
+		HumNum&  operator*=         (int value);
+		HumNum&  operator/=         (const HumNum& value);
+		HumNum&  operator/=         (int value);
+		HumNum   operator-          (void) const;
+		HumNum   operator+          (const HumNum& value) const;
+		HumNum   operator+          (int value) const;
+		HumNum   operator-          (const HumNum& value) const;
+		HumNum   operator-          (int value) const;
+		HumNum   operator*          (const HumNum& value) const;
+		HumNum   operator*          (int value) const;
+		HumNum   operator/          (const HumNum& value) const;
+		HumNum   operator/          (int value) const;
+		bool     operator==         (const HumNum& value) const;
+		bool     operator==         (double value) const;
+		bool     operator==         (int value) const;
+		bool     operator!=         (const HumNum& value) const;
+		bool     operator!=         (double value) const;
+		bool     operator!=         (int value) const;
+		bool     operator<          (const HumNum& value) const;
+		bool     operator<          (double value) const;
+		bool     operator<          (int value) const;
+		bool     operator<=         (const HumNum& value) const;
+		bool     operator<=         (double value) const;
+		bool     operator<=         (int value) const;
+		bool     operator>          (const HumNum& value) const;
+		bool     operator>          (double value) const;
+		bool     operator>          (int value) const;
+		bool     operator>=         (const HumNum& value) const;
+		bool     operator>=         (double value) const;
+		bool     operator>=         (int value) const;
+		std::ostream& printFraction      (std::ostream& = std::cout) const;
+		std::ostream& printMixedFraction (std::ostream& out = std::cout,
+		                             std::string separator = "_") const;
+		std::ostream& printList          (std::ostream& out) const;
+		std::ostream& printTwoPart  (std::ostream& out, const std::string& spacer = "+") const;
+
+		static int  getOverflowCount   (void);
+		static void clearOverflowCount (void);
+
+	protected:
+		void     reduce             (void);
+		int      gcdIterative       (int a, int b);
+		int      gcdRecursive       (int a, int b);
+		void     setWide            (long long numerator, long long denominator);
+		void     setWideReduced     (long long numerator, long long denominator);
+		void     setOverflow        (long long numerator, long long denominator);
+		static unsigned long long gcdBinary (unsigned long long a,
+		                                     unsigned long long b);
+		static int& overflowCount   (void);
+
+	private:
+		int top;
+		int bot;
+};
+
+
+
+//////////////////////////////
+//
+// HumNum::setWideReduced -- Store a fraction which is known to be in
+//    lowest terms with a positive denominator.  The 64-bit intermediate
+//    values of the arithmetic operators are checked here for overflow
+//    of the 32-bit numerator and denominator.
+//
+
+inline void HumNum::setWideReduced(long long numerator, long long denominator) {
+	if ((numerator >= -2147483647LL) && (numerator <= 2147483647LL) &&
+			(denominator <= 2147483647LL)) {
+		top = (int)numerator;
+		bot = (int)denominator;
+	} else {
+		setOverflow(numerator, denominator);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator+ -- Addition operator which adds HumNum
+//    to another HumNum or with a integers.  Products are calculated
+//    with 64-bit integers.  Fractions with the same denominator are
+//    added without cross multiplication, and adding an integer to a
+//    reduced fraction does not need a gcd.
+//
+
+inline HumNum HumNum::operator+(const HumNum& value) const {
+	HumNum output;
+	if ((bot == value.bot) && (bot > 0)) {
+		if (bot == 1) {
+			output.setWideReduced((long long)top + value.top, 1);
+		} else {
+			output.setWide((long long)top + value.top, bot);
+		}
+	} else {
+		output.setWide((long long)top * value.bot + (long long)value.top * bot,
+				(long long)bot * value.bot);
+	}
+	return output;
+}
+
+
+inline HumNum HumNum::operator+(int value) const {
+	HumNum output;
+	if (bot > 0) {
+		output.setWideReduced((long long)value * bot + top, bot);
+	} else {
+		output.setWide((long long)value * bot + top, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator- -- Subtraction operator to subtract
+//     HumNums from each other and to subtrack integers from
+//     HumNums.
+//
+
+inline HumNum HumNum::operator-(const HumNum& value) const {
+	HumNum output;
+	if ((bot == value.bot) && (bot > 0)) {
+		if (bot == 1) {
+			output.setWideReduced((long long)top - value.top, 1);
+		} else {
+			output.setWide((long long)top - value.top, bot);
+		}
+	} else {
+		output.setWide((long long)top * value.bot - (long long)value.top * bot,
+				(long long)bot * value.bot);
+	}
+	return output;
+}
+
+
+inline HumNum HumNum::operator-(int value) const {
+	HumNum output;
+	if (bot > 0) {
+		output.setWideReduced((long long)top - (long long)value * bot, bot);
+	} else {
+		output.setWide((long long)top - (long long)value * bot, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator- -- Unary negation operator to generate
+//   the negative version of a HumNum.
+//
+
+inline HumNum HumNum::operator-(void) const {
+	HumNum output;
+	if (bot > 0) {
+		output.setWideReduced(-(long long)top, bot);
+	} else {
+		output.setWide(-(long long)top, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator* -- Multiplication operator to multiply
+//   two HumNums together or a HumNum and an integer.
+//
+
+inline HumNum HumNum::operator*(const HumNum& value) const {
+	HumNum output;
+	if ((bot == 1) && (value.bot == 1)) {
+		output.setWideReduced((long long)top * value.top, 1);
+	} else {
+		output.setWide((long long)top * value.top, (long long)bot * value.bot);
+	}
+	return output;
+}
+
+
+inline HumNum HumNum::operator*(int value) const {
+	HumNum output;
+	if (bot == 1) {
+		output.setWideReduced((long long)top * value, 1);
+	} else {
+		output.setWide((long long)top * value, bot);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator/ -- Division operator to divide two
+//     HumNums together or divide a HumNum by an integer.
+//
+
+inline HumNum HumNum::operator/(const HumNum& value) const {
+	HumNum output;
+	output.setWide((long long)top * value.bot, (long long)bot * value.top);
+	return output;
+}
+
+
+inline HumNum HumNum::operator/(int value) const {
+	HumNum output;
+	output.setWide(top, (long long)bot * value);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator+= -- Add a HumNum or integer to a HumNum.
+//
+
+inline HumNum& HumNum::operator+=(const HumNum& value) {
+	*this = *this + value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator+=(int value) {
+	*this = *this + value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator-= -- Subtract a HumNum or an integer from
+//    a HumNum.
+//
+
+inline HumNum& HumNum::operator-=(const HumNum& value) {
+	*this = *this - value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator-=(int value) {
+	*this = *this - value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator*= -- Multiply a HumNum by a HumNum or integer.
+//
+
+inline HumNum& HumNum::operator*=(const HumNum& value) {
+	*this = *this * value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator*=(int value) {
+	*this = *this * value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator/= -- Divide a HumNum by a HumNum or integer.
+//
+
+inline HumNum& HumNum::operator/=(const HumNum& value) {
+	*this = *this / value;
+	return *this;
+}
+
+
+inline HumNum& HumNum::operator/=(int value) {
+	*this = *this / value;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator= -- Assign an integer to a HumNum.
+//
+
+inline HumNum& HumNum::operator=(int value) {
+	top = value;
+	bot = 1;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator< -- Less-than equality for a HumNum and
+//   a HumNum, integer, or float.  Finite values are compared exactly
+//   by cross multiplication, and infinite values as floats.
+//
+
+inline bool HumNum::operator<(const HumNum& value) const {
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot < (long long)value.top * bot;
+	}
+	return getFloat() < value.getFloat();
+}
+
+
+inline bool HumNum::operator<(int value) const {
+	if (bot > 0) {
+		return top < (long long)value * bot;
+	}
+	return getFloat() < value;
+}
+
+
+inline bool HumNum::operator<(double value) const {
+	return getFloat() < value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator<= -- Less-than-or-equal equality for a
+//     HumNum with a HumNum, integer or float.
+//
+
+inline bool HumNum::operator<=(const HumNum& value) const {
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot <= (long long)value.top * bot;
+	}
+	return getFloat() <= value.getFloat();
+}
+
+
+inline bool HumNum::operator<=(int value) const {
+	if (bot > 0) {
+		return top <= (long long)value * bot;
+	}
+	return getFloat() <= value;
+}
+
+
+inline bool HumNum::operator<=(double value) const {
+	return getFloat() <= value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator> -- Greater-than equality for a HumNum
+//     compared to a HumNum, integer, or float.
+//
+
+inline bool HumNum::operator>(const HumNum& value) const {
+	return value < *this;
+}
+
+
+inline bool HumNum::operator>(int value) const {
+	if (bot > 0) {
+		return top > (long long)value * bot;
+	}
+	return getFloat() > value;
+}
+
+
+inline bool HumNum::operator>(double value) const {
+	return getFloat() > value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator>= -- Greater-than-or-equal equality
+//    comparison for a HumNum to another HumNum, integer, or float.
+//
+
+inline bool HumNum::operator>=(const HumNum& value) const {
+	return value <= *this;
+}
+
+
+inline bool HumNum::operator>=(int value) const {
+	if (bot > 0) {
+		return top >= (long long)value * bot;
+	}
+	return getFloat() >= value;
+}
+
+
+inline bool HumNum::operator>=(double value) const {
+	return getFloat() >= value;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::operator== -- Equality test for HumNums compared to
+//   another HumNum, integer or float.
+//
+
+inline bool HumNum::operator==(const HumNum& value) const {
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot == (long long)value.top * bot;
+	}
+	return getFloat() == value.getFloat();
+}
+
+
+inline bool HumNum::operator==(int value) const {
+	if (bot > 0) {
+		return top == (long long)value * bot;
+	}
+	return getFloat() == value;
+}
+
+
+inline bool HumNum::operator==(double value) const {
+	return getFloat() == value;
+}
+
 
-namespace hum {
 
-class Convert;
-class HumNum;
-class HumAddress;
-class HumdrumToken;
-typedef HumdrumToken* HTp;
-class HumdrumLine;
-class HumdrumFileBase;
-class HumdrumFileStructure;
-class HumdrumFileContent;
-class HumdrumFile;
-class GridVoice;
+//////////////////////////////
+//
+// HumNum::operator!= -- Inequality test for HumNums compared
+//   to other HumNums, integers or floats.
+//
+
+inline bool HumNum::operator!=(const HumNum& value) const {
+	return !(*this == value);
+}
+
+
+inline bool HumNum::operator!=(int value) const {
+	return !(*this == value);
+}
+
+
+inline bool HumNum::operator!=(double value) const {
+	return getFloat() != value;
+}
+
+
+
+std::ostream& operator<<(std::ostream& out, const HumNum& number);
+
+template <typename A>
+std::ostream& operator<<(std::ostream& out, const std::vector<A>& v);
+
 
 
 class HumParameter : public std::string {
@@ -124,11 +656,38 @@ typedef std::map<std::string, std::map<std::string, std::map<std::string, HumPar
 typedef std::map<std::string, std::map<std::string, HumParameter> > MapNKV;
 typedef std::map<std::string, HumParameter> MapKV;
 
+
+// HumHashEntry: Storage for a single parameter in a HumHash.  The
+// namespaces and key are interned ids (see HumHash::getParameterId()),
+// and integer, fraction and token values are stored without converting
+// them to text.  Floating-point values are stored both as text and as
+// the value which the text represents.  Other values are stored as a
+// string.
+class HumHashEntry {
+	public:
+		enum { TYPE_STRING, TYPE_INT, TYPE_FRACTION, TYPE_HTP, TYPE_FLOAT };
+
+		int           ns1;     // interned first namespace
+		int           ns2;     // interned second namespace
+		int           key;     // interned key
+		int           type;    // TYPE_* value
+		HumNum        number;  // value for TYPE_INT and TYPE_FRACTION
+		HTp           token;   // value for TYPE_HTP
+		double        real;    // value for TYPE_FLOAT
+		HumdrumToken* origin;  // token which the parameter comes from
+		std::string   text;    // value for TYPE_STRING and TYPE_FLOAT
+
+		std::string   getText  (void) const;
+};
+
 class HumHash {
 	public:
 		               HumHash             (void);
+		               HumHash             (const HumHash& hash);
 		              ~HumHash             ();
 
+		HumHash&       operator=           (const HumHash& hash);
+
 		std::string    getValue            (const std::string& key) const;
 		std::string    getValue            (const std::string& ns2,
 		                                    const std::string& key) const;
@@ -207,6 +766,8 @@ class HumHash {
 		void           deleteValue         (const std::string& ns2, const std::string& key);
 		void           deleteValue         (const std::string& ns1, const std::string& ns2,
 		                                    const std::string& key);
+		void           deleteValues        (const std::string& ns1,
+		                                    const std::string& ns2);
 		std::vector<std::string> getKeys             (void) const;
 		std::vector<std::string> getKeys             (const std::string& ns) const;
 		std::vector<std::string> getKeys             (const std::string& ns1,
@@ -248,115 +809,53 @@ class HumHash {
 		                                    const std::string& ns2,
 		                                    const std::string& parameter) const;
 
+		// Access by interned namespace/key ids, which avoids converting
+		// the namespace and key strings on each call:
+		static int     getParameterId      (const std::string& name);
+		static int     findParameterId     (const std::string& name);
+		static std::string getParameterName (int id);
+		std::string    getValue            (int ns1, int ns2, int key) const;
+		int            getValueInt         (int ns1, int ns2, int key) const;
+		HumNum         getValueFraction    (int ns1, int ns2, int key) const;
+		double         getValueFloat       (int ns1, int ns2, int key) const;
+		HTp            getValueHTp         (int ns1, int ns2, int key) const;
+		bool           getValueBool        (int ns1, int ns2, int key) const;
+		bool           isDefined           (int ns1, int ns2, int key) const;
+		void           setValue            (int ns1, int ns2, int key,
+		                                    const std::string& value);
+		void           setValue            (int ns1, int ns2, int key, int value);
+		void           setValue            (int ns1, int ns2, int key, HTp value);
+		void           setValue            (int ns1, int ns2, int key,
+		                                    HumNum value);
+		void           setValue            (int ns1, int ns2, int key, double value);
+
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
+		HumHashEntry*            findEntry             (int ns1, int ns2,
+		                                                int key) const;
+		HumHashEntry*            findEntry             (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		HumHashEntry&            insertEntry           (int ns1, int ns2, int key);
+		void                     getSortedParameters   (MapNNKV& output) const;
 
 	private:
-		MapNNKV*    parameters;
-		std::string prefix;
-
-	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
-};
-
-
-
-class HumNum {
-	public:
-		         HumNum             (void);
-		         HumNum             (int value);
-		         HumNum             (int numerator, int denominator);
-		         HumNum             (const HumNum& rat);
-		         HumNum             (const std::string& ratstring);
-		         HumNum             (const char* ratstring);
-		        ~HumNum             ();
-
-		bool     isNegative         (void) const;
-		bool     isPositive         (void) const;
-		bool     isZero             (void) const;
-		bool     isNonZero          (void) const;
-		bool     isNonNegative      (void) const;
-		bool     isNonPositive      (void) const;
-		bool     isInfinite         (void) const;
-		bool     isFinite           (void) const;
-		bool     isNaN              (void) const;
-		bool     isInteger          (void) const;
-		bool     isPowerOfTwo       (void) const;
-		double   getFloat           (void) const;
-		double   toFloat  (void) const { return getFloat(); }
-		int      getInteger         (double round = 0.0) const;
-		int      toInteger (double round = 0.0) const {
-		                                            return getInteger(round); }
-		int      getNumerator       (void) const;
-		int      getDenominator     (void) const;
-		HumNum   getRemainder       (void) const;
-		void     setValue           (int numerator);
-		void     setValue           (int numerator, int denominator);
-		void     setValue           (const std::string& ratstring);
-		void     setValue           (const char* ratstring);
-		void     invert             (void);
-		HumNum   getAbs             (void) const;
-		HumNum&  makeAbs            (void);
-		HumNum&  operator=          (const HumNum& value);
-		HumNum&  operator=          (int value);
-		HumNum&  operator+=         (const HumNum& value);
-		HumNum&  operator+=         (int value);
-		HumNum&  operator-=         (const HumNum& value);
-		HumNum&  operator-=         (int value);
-		HumNum&  operator*=         (const HumNum& value);
-		HumNum&  operator*=         (int value);
-		HumNum&  operator/=         (const HumNum& value);
-		HumNum&  operator/=         (int value);
-		HumNum   operator-          (void) const;
-		HumNum   operator+          (const HumNum& value) const;
-		HumNum   operator+          (int value) const;
-		HumNum   operator-          (const HumNum& value) const;
-		HumNum   operator-          (int value) const;
-		HumNum   operator*          (const HumNum& value) const;
-		HumNum   operator*          (int value) const;
-		HumNum   operator/          (const HumNum& value) const;
-		HumNum   operator/          (int value) const;
-		bool     operator==         (const HumNum& value) const;
-		bool     operator==         (double value) const;
-		bool     operator==         (int value) const;
-		bool     operator!=         (const HumNum& value) const;
-		bool     operator!=         (double value) const;
-		bool     operator!=         (int value) const;
-		bool     operator<          (const HumNum& value) const;
-		bool     operator<          (double value) const;
-		bool     operator<          (int value) const;
-		bool     operator<=         (const HumNum& value) const;
-		bool     operator<=         (double value) const;
-		bool     operator<=         (int value) const;
-		bool     operator>          (const HumNum& value) const;
-		bool     operator>          (double value) const;
-		bool     operator>          (int value) const;
-		bool     operator>=         (const HumNum& value) const;
-		bool     operator>=         (double value) const;
-		bool     operator>=         (int value) const;
-		std::ostream& printFraction      (std::ostream& = std::cout) const;
-		std::ostream& printMixedFraction (std::ostream& out = std::cout,
-		                             std::string separator = "_") const;
-		std::ostream& printList          (std::ostream& out) const;
-		std::ostream& printTwoPart  (std::ostream& out, const std::string& spacer = "+") const;
+		// parameters: The list of parameters, which is allocated when the
+		// first parameter is set.  Most tokens do not have any parameters,
+		// and the ones that do typically have only a few, so a linear
+		// search is faster than a map.
+		std::vector<HumHashEntry>* parameters;
 
-	protected:
-		void     reduce             (void);
-		int      gcdIterative       (int a, int b);
-		int      gcdRecursive       (int a, int b);
+		// prefix: Interned id of the prefix string for operator<<.
+		int prefix;
 
-	private:
-		int top;
-		int bot;
+	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
 };
 
 
-std::ostream& operator<<(std::ostream& out, const HumNum& number);
-
-template <typename A>
-std::ostream& operator<<(std::ostream& out, const std::vector<A>& v);
-
 
+class HumdrumToken;
 
 class HumRegex {
 	public:
@@ -365,6 +864,18 @@ class HumRegex {
 		                                const std::string& options = "");
 		           ~HumRegex           ();
 
+		// precompiled regular expression (used by the functions below
+		// which do not have an expression parameter)
+		void        compile            (const std::string& exp,
+		                                const std::string& options = "");
+		int         search             (const std::string& input);
+		int         search             (const std::string& input, int startindex);
+		bool        match              (const std::string& input);
+		std::string&     replaceDestructive (std::string& input,
+		                                const std::string& replacement);
+		std::string      replaceCopy        (const std::string& input,
+		                                const std::string& replacement);
+
 		// setting persistent options for regular expression contruction
 		void        setIgnoreCase      (void);
 		bool        getIgnoreCase      (void);
@@ -394,6 +905,12 @@ class HumRegex {
 		std::string&     replaceDestructive (std::string* input, const std::string& replacement,
 		                                const std::string& exp,
 		                                const std::string& options);
+		// HumdrumToken versions, which change the text with setText():
+		std::string&     replaceDestructive (HumdrumToken* token, const std::string& replacement,
+		                                const std::string& exp);
+		std::string&     replaceDestructive (HumdrumToken* token, const std::string& replacement,
+		                                const std::string& exp,
+		                                const std::string& options);
 		std::string      replaceCopy        (std::string* input, const std::string& replacement,
 		                                const std::string& exp);
 		std::string      replaceCopy        (std::string* input, const std::string& replacement,
@@ -451,17 +968,30 @@ class HumRegex {
 				getTemporaryRegexFlags(const std::string& sflags);
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
+		const std::regex& setRegex     (const std::string& exp,
+		                                std::regex_constants::syntax_option_type flags);
+
+		static std::shared_ptr<const std::regex> getCompiledRegex(
+				const std::string& exp,
+				std::regex_constants::syntax_option_type flags);
 
 
 	private:
 
 		// m_regex: stores the regular expression to use as a default.
+		// Compiled expressions are shared between all HumRegex objects
+		// through a cache (see getCompiledRegex()), so they must not be
+		// modified.
 		//
 		// http://en.cppreference.com/w/cpp/regex/basic_regex
-		// .assign(string) == set the regular expression.
-		// operator=       == set the regular expression.
 		// .flags()        == return syntax_option_type used to construct.
-		std::regex m_regex;
+		std::shared_ptr<const std::regex> m_regex;
+
+		// m_exp: the text of the expression stored in m_regex, and
+		// m_expflags: the syntax options it was compiled with.  Used to
+		// skip the cache lookup when the same expression is used again.
+		std::string m_exp;
+		std::regex_constants::syntax_option_type m_expflags;
 
 		// m_matches: stores the matches from a search:
 		//
@@ -626,70 +1156,410 @@ class HumAddress {
 		// Other more complicated mergers may be simplified in the future.
 		std::string m_spining;
 
-		// track: This is the track number of the spine.  It is the first
-		// number found in the spineinfo string.
-		int m_track;
+		// track: This is the track number of the spine.  It is the first
+		// number found in the spineinfo string.
+		int m_track;
+
+		// subtrack: This is the subtrack number for the spine.  When a spine
+		// is not split, it will be 0, if the spine has been split with *^,
+		// then the left-subspine will be in subtrack 1 and the right-spine
+		// will be subtrack 2.  If subspines are exchanged with *x, then their
+		// subtrack assignments will also change.
+		int m_subtrack;
+
+		// subtrackcount: The number of currently active subtracks tokens
+		// on the owning HumdrumLine (in the same track).  The subtrack range
+		// is from 1 (if there is only a primary spine), to a larger number.
+		// if subtrackcount is 0, then the variable is not set, or there are
+		// no tokens in the track (such as for global comments).
+		int m_subtrackcount;
+
+		// owner: This is the line which manages the given token.
+		HumdrumLine* m_owner;
+
+	friend class HumdrumToken;
+	friend class HumdrumLine;
+	friend class HumdrumFile;
+};
+
+
+
+class HumParamSet {
+
+	public:
+		              HumParamSet        (void);
+		              HumParamSet        (const std::string& token);
+		              HumParamSet        (HTp token);
+		             ~HumParamSet        ();
+
+		const std::string& getNamespace1      (void);
+		const std::string& getNamespace2      (void);
+		std::string   getNamespace       (void);
+		void          setNamespace1      (const std::string& name);
+		void          setNamespace2      (const std::string& name);
+		void          setNamespace       (const std::string& name);
+		void          setNamespace       (const std::string& name1, const std::string& name2);
+
+		void          clear              (void);
+		int           getCount           (void);
+		const std::string& getParameterName   (int index);
+		const std::string& getParameterValue  (int index);
+		int           addParameter       (const std::string& name, const std::string& value);
+		int           setParameter       (const std::string& name, const std::string& value);
+		void          readString         (const std::string& text);
+		std::ostream& printXml           (std::ostream& out = std::cout, int level = 0,
+		                                  const std::string& indent = "\t");
+
+	private:
+		std::string m_ns1;
+		std::string m_ns2;
+		std::vector<std::pair<std::string, std::string>> m_parameters;
+
+};
+
+
+std::ostream& operator<<(std::ostream& out, HumParamSet* hps);
+std::ostream& operator<<(std::ostream& out, HumParamSet& hps);
+
+
+
+template <size_t SIZE>
+class HumPool {
+	public:
+		static void*   allocate       (void);
+		static void    deallocate     (void* ptr);
+
+	private:
+		struct Block {
+			Block* next;
+		};
+
+		// FreeList: trivially destructible so that it can still be used
+		// while thread-local and static objects are being destroyed.
+		struct FreeList {
+			Block* head;
+			size_t count;
+			bool   dead;
+		};
+
+		// Reaper: hands the thread's free list back to the shared list
+		// when the thread exits.
+		struct Reaper {
+			~Reaper() {
+				FreeList& list = getFreeList();
+				release(list.head, list.count);
+				list.head = NULL;
+				list.count = 0;
+				list.dead = true;
+			}
+		};
+
+		static FreeList&   getFreeList    (void);
+		static FreeList&   getShared      (void);
+		static std::mutex& getMutex       (void);
+		static Block*      acquire        (size_t& count);
+		static void        release        (Block* list, size_t count);
+		static void        spill          (FreeList& list);
+
+		// m_minsize: a block must be able to hold a free-list link.
+		static const size_t m_minsize = SIZE < sizeof(Block) ? sizeof(Block) : SIZE;
+
+		// m_blocksize: size of each block, rounded up so that every block
+		// is aligned for any object type.
+		static const size_t m_blocksize = (m_minsize + alignof(std::max_align_t) - 1)
+				/ alignof(std::max_align_t) * alignof(std::max_align_t);
+
+		// m_blockcount: number of blocks allocated together in each chunk.
+		static const size_t m_blockcount = (65536 / m_blocksize) < 16 ? 16 :
+				(65536 / m_blocksize);
+
+		// m_locallimit: maximum number of blocks kept on a thread's free
+		// list.  When it is exceeded, one chunk's worth of blocks is moved
+		// to the shared list.
+		static const size_t m_locallimit = 2 * m_blockcount;
+};
+
+
+
+//////////////////////////////
+//
+// HumPool::allocate -- Return a block of memory of SIZE bytes.
+//
+
+template <size_t SIZE>
+void* HumPool<SIZE>::allocate(void) {
+#ifdef NO_HUMPOOL
+	return ::operator new(SIZE);
+#else
+	FreeList& list = getFreeList();
+	if (list.head == NULL) {
+		list.head = acquire(list.count);
+	}
+	Block* block = list.head;
+	list.head = block->next;
+	list.count--;
+	return block;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::deallocate -- Place a block back onto the calling thread's
+//     free list.  If the list is longer than m_locallimit, move the
+//     surplus to the shared list.
+//
+
+template <size_t SIZE>
+void HumPool<SIZE>::deallocate(void* ptr) {
+#ifdef NO_HUMPOOL
+	::operator delete(ptr);
+#else
+	if (ptr == NULL) {
+		return;
+	}
+	Block* block = static_cast<Block*>(ptr);
+	FreeList& list = getFreeList();
+	if (list.dead) {
+		// Thread-local storage is being torn down.
+		block->next = NULL;
+		release(block, 1);
+		return;
+	}
+	block->next = list.head;
+	list.head = block;
+	if (++list.count > m_locallimit) {
+		spill(list);
+	}
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::getFreeList -- Return the free list for the calling thread.
+//
+
+template <size_t SIZE>
+typename HumPool<SIZE>::FreeList& HumPool<SIZE>::getFreeList(void) {
+	static thread_local FreeList list = { NULL, 0, false };
+	static thread_local Reaper reaper;
+	(void)reaper;
+	return list;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::getShared -- Free blocks moved off of the thread free lists,
+//     either because a list was too long or because its thread exited.
+//     Only accessed while holding the mutex.
+//
+
+template <size_t SIZE>
+typename HumPool<SIZE>::FreeList& HumPool<SIZE>::getShared(void) {
+	static FreeList shared = { NULL, 0, false };
+	return shared;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::getMutex -- Lock for chunk allocation and the shared list.
+//
+
+template <size_t SIZE>
+std::mutex& HumPool<SIZE>::getMutex(void) {
+	static std::mutex* lock = new std::mutex;
+	return *lock;
+}
+
+
+
+//////////////////////////////
+//
+// HumPool::acquire -- Return a list of free blocks, up to one chunk's
+//     worth taken from the shared list, or else a newly allocated chunk.
+//     The number of blocks in the list is stored in count.  New chunks
+//     are not tracked, since they are never deleted.
+//
+
+template <size_t SIZE>
+typename HumPool<SIZE>::Block* HumPool<SIZE>::acquire(size_t& count) {
+	std::lock_guard<std::mutex> lock(getMutex());
+	FreeList& shared = getShared();
+	if (shared.head) {
+		Block* output = shared.head;
+		Block* tail = output;
+		count = 1;
+		while ((count < m_blockcount) && tail->next) {
+			tail = tail->next;
+			count++;
+		}
+		shared.head = tail->next;
+		shared.count -= count;
+		tail->next = NULL;
+		return output;
+	}
+	char* chunk = static_cast<char*>(::operator new(m_blocksize * m_blockcount));
+	for (size_t i=0; i<m_blockcount - 1; i++) {
+		reinterpret_cast<Block*>(chunk + i * m_blocksize)->next =
+				reinterpret_cast<Block*>(chunk + (i + 1) * m_blocksize);
+	}
+	reinterpret_cast<Block*>(chunk + (m_blockcount - 1) * m_blocksize)->next = NULL;
+	count = m_blockcount;
+	return reinterpret_cast<Block*>(chunk);
+}
+
 
-		// subtrack: This is the subtrack number for the spine.  When a spine
-		// is not split, it will be 0, if the spine has been split with *^,
-		// then the left-subspine will be in subtrack 1 and the right-spine
-		// will be subtrack 2.  If subspines are exchanged with *x, then their
-		// subtrack assignments will also change.
-		int m_subtrack;
 
-		// subtrackcount: The number of currently active subtracks tokens
-		// on the owning HumdrumLine (in the same track).  The subtrack range
-		// is from 1 (if there is only a primary spine), to a larger number.
-		// if subtrackcount is 0, then the variable is not set, or there are
-		// no tokens in the track (such as for global comments).
-		int m_subtrackcount;
+//////////////////////////////
+//
+// HumPool::spill -- Move one chunk's worth of blocks from the front of
+//     a thread's free list to the shared list.
+//
 
-		// owner: This is the line which manages the given token.
-		HumdrumLine* m_owner;
+template <size_t SIZE>
+void HumPool<SIZE>::spill(FreeList& list) {
+	Block* output = list.head;
+	Block* tail = output;
+	for (size_t i=1; i<m_blockcount; i++) {
+		tail = tail->next;
+	}
+	list.head = tail->next;
+	list.count -= m_blockcount;
+	tail->next = NULL;
+	release(output, m_blockcount);
+}
 
-	friend class HumdrumToken;
-	friend class HumdrumLine;
-	friend class HumdrumFile;
-};
 
 
+//////////////////////////////
+//
+// HumPool::release -- Move a list of count blocks to the shared free list.
+//
 
-class HumParamSet {
+template <size_t SIZE>
+void HumPool<SIZE>::release(Block* list, size_t count) {
+	if (list == NULL) {
+		return;
+	}
+	Block* tail = list;
+	while (tail->next) {
+		tail = tail->next;
+	}
+	std::lock_guard<std::mutex> lock(getMutex());
+	FreeList& shared = getShared();
+	tail->next = shared.head;
+	shared.head = list;
+	shared.count += count;
+}
 
-	public:
-		              HumParamSet        (void);
-		              HumParamSet        (const std::string& token);
-		              HumParamSet        (HTp token);
-		             ~HumParamSet        ();
 
-		const std::string& getNamespace1      (void);
-		const std::string& getNamespace2      (void);
-		std::string   getNamespace       (void);
-		void          setNamespace1      (const std::string& name);
-		void          setNamespace2      (const std::string& name);
-		void          setNamespace       (const std::string& name);
-		void          setNamespace       (const std::string& name1, const std::string& name2);
 
-		void          clear              (void);
-		int           getCount           (void);
-		const std::string& getParameterName   (int index);
-		const std::string& getParameterValue  (int index);
-		int           addParameter       (const std::string& name, const std::string& value);
-		int           setParameter       (const std::string& name, const std::string& value);
-		void          readString         (const std::string& text);
-		std::ostream& printXml           (std::ostream& out = std::cout, int level = 0,
-		                                  const std::string& indent = "\t");
+class KernNote {
+	public:
+		              KernNote             (void);
+		              KernNote             (const char* text, int length);
+
+		void          parse                (const char* text, int length);
+
+		// Bit flags for notational markers (see hasFlag()).
+		enum {
+			NOTE_TIE_START      = 1 << 0,  // [
+			NOTE_TIE_CONTINUE   = 1 << 1,  // _
+			NOTE_TIE_END        = 1 << 2,  // ]
+			NOTE_SLUR_START     = 1 << 3,  // (
+			NOTE_SLUR_END       = 1 << 4,  // )
+			NOTE_BEAM_START     = 1 << 5,  // L
+			NOTE_BEAM_END       = 1 << 6,  // J
+			NOTE_BEAM_PARTIAL   = 1 << 7,  // k or K
+			NOTE_GRACE          = 1 << 8,  // q
+			NOTE_STACCATO       = 1 << 9,  // '
+			NOTE_STACCATISSIMO  = 1 << 10, // `
+			NOTE_ACCENT         = 1 << 11, // ^
+			NOTE_TENUTO         = 1 << 12, // ~
+			NOTE_FERMATA        = 1 << 13, // ;
+			NOTE_NATURAL        = 1 << 14, // n
+			NOTE_PITCH          = 1 << 15, // a-g or A-G
+			NOTE_REST           = 1 << 16  // r
+		};
+
+		bool          hasFlag              (unsigned int flag) const
+		                                       { return (m_flags & flag) != 0; }
+		unsigned int  getFlags             (void) const { return m_flags; }
+
+		bool          isRest               (void) const
+		                                       { return hasFlag(NOTE_REST); }
+		bool          isNote               (void) const
+		                                       { return hasFlag(NOTE_PITCH); }
+		bool          isGrace              (void) const
+		                                       { return hasFlag(NOTE_GRACE); }
+		bool          isSecondaryTiedNote  (void) const;
+		bool          hasSlurStart         (void) const
+		                                       { return hasFlag(NOTE_SLUR_START); }
+		bool          hasSlurEnd           (void) const
+		                                       { return hasFlag(NOTE_SLUR_END); }
+
+		int           getDiatonicPC        (void) const { return m_diatonic; }
+		char          getDiatonicUC        (void) const { return m_letter; }
+		char          getDiatonicLC        (void) const;
+		int           getAccidentalCount   (void) const { return m_accidental; }
+		int           getOctaveNumber      (void) const { return m_octave; }
+		int           getBase40            (void) const { return m_base40; }
+		int           getBase40PC          (void) const;
+		int           getBase12            (void) const;
+		int           getBase12PC          (void) const;
+		int           getBase7             (void) const;
+		int           getMidiNoteNumber    (void) const;
+
+		HumNum        getDuration          (void) const { return m_duration; }
+		HumNum        getVisualDuration    (void) const { return m_visual; }
+		int           getDotCount          (void) const { return m_dots; }
+		char          getStemDirection     (void) const { return m_stem; }
 
 	private:
-		std::string m_ns1;
-		std::string m_ns2;
-		std::vector<std::pair<std::string, std::string>> m_parameters;
+		// m_duration: Logical duration in quarter notes, as returned by
+		// Convert::recipToDuration().  Grace notes have a zero duration.
+		HumNum m_duration;
 
-};
+		// m_visual: Printed duration in quarter notes, which is the same as
+		// m_duration except for grace notes.
+		HumNum m_visual;
 
+		// m_diatonic: Diatonic pitch class (C=0 to B=6), or -1000 for a
+		// rest and -2000 if there is no pitch.
+		int m_diatonic;
 
-std::ostream& operator<<(std::ostream& out, HumParamSet* hps);
-std::ostream& operator<<(std::ostream& out, HumParamSet& hps);
+		// m_accidental: Sum of sharps (+1) and flats (-1).
+		int m_accidental;
+
+		// m_octave: Octave number with middle C in octave 4, or -1000 if
+		// the subtoken is a rest or has no valid pitch.
+		int m_octave;
+
+		// m_base40: Base-40 pitch, or the (negative) diatonic value if
+		// there is no pitch.
+		int m_base40;
+
+		// m_flags: NOTE_* flags for markers found in the subtoken.
+		unsigned int m_flags;
+
+		// m_dots: Number of augmentation dots.
+		unsigned char m_dots;
+
+		// m_letter: Uppercase diatonic letter, 'R' for rests, or 'X' if
+		// there is no pitch.
+		char m_letter;
+
+		// m_stem: First stem direction in the subtoken: '/' for up,
+		// '\\' for down, or '\0' if none.
+		char m_stem;
+};
 
 
 
@@ -981,6 +1851,9 @@ class HumdrumLine : public std::string, public HumHash {
 		            HumdrumLine            (HumdrumLine& line, void* owner);
 		           ~HumdrumLine            ();
 
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr, size_t size);
+
 		HumdrumLine& operator=             (HumdrumLine& line);
 		bool        isComment              (void) const;
 		bool        isCommentLocal         (void) const;
@@ -1058,6 +1931,11 @@ class HumdrumLine : public std::string, public HumHash {
 		HumNum      getDurationFromBarline (HumNum scale);
 		HumNum      getDurationToBarline   (HumNum scale);
 		HumNum      getBarlineDuration     (HumNum scale);
+
+		long long   getTickDuration        (void);
+		long long   getTicksFromStart      (void);
+		long long   getTicksFromBarline    (void);
+		long long   getTicksToBarline      (void);
 		int         getKernNoteAttacks     (void);
 		int         addLinkedParameter     (HTp token);
 
@@ -1069,7 +1947,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     setLineFromCsv         (const std::string& csv,
 		                                 const std::string& separator = ",");
 
-		// low-level editing functions (need to re-analyze structure after using)
+		// low-level editing functions (call HumdrumFile::reanalyzeEdits() after using)
 		void     appendToken            (HTp token, int tabcount = 1);
 		void     appendToken            (const HumdrumToken& token, int tabcount = 1);
 		void     appendToken            (const std::string& token, int tabcount = 1);
@@ -1084,6 +1962,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     insertToken            (int index, const HumdrumToken& token, int tabcount = 1);
 		void     insertToken            (int index, const std::string& token, int tabcount = 1);
 		void     insertToken            (int index, const char* token, int tabcount = 1);
+		void     markEdited             (void);
 
 		void     setDuration            (HumNum aDur);
 		void     setDurationFromStart   (HumNum dur);
@@ -1097,6 +1976,7 @@ class HumdrumLine : public std::string, public HumHash {
 		void     clear                  (void);
 		void     setOwner               (void* hfile);
 		int      createTokensFromLine   (void);
+		void     checkTokens            (void) const;
 		void     setLayoutParameters    (void);
 		void     setParameters          (const std::string& pdata);
 		void     storeGlobalLinkedParameters(void);
@@ -1125,7 +2005,9 @@ class HumdrumLine : public std::string, public HumHash {
 		// createLineFromTokens() in that case.  The second case is more
 		// useful: you can read in a HumdrumFile, tweak the tokens, then
 		// reconstruct the full line and print out again.
-		// This variable is filled by HumdrumFile::read().
+		// This variable is filled by HumdrumFile::read(), or when the tokens
+		// are first accessed if the ANALYZE_TOKENS analysis level was not
+		// used when reading the file.
 		// The contents of this vector should be deleted when deconstructing
 		// a HumdrumLine object.
 		std::vector<HumdrumToken*> m_tokens;
@@ -1161,6 +2043,17 @@ class HumdrumLine : public std::string, public HumHash {
 		// This variable is filled by HumdrumFileStructure::analyzeMeter().
 		HumNum m_durationToBarline;
 
+		// m_tickDuration, m_ticksFromStart, m_ticksFromBarline,
+		// m_ticksToBarline: The above durations in ticks (see
+		// HumdrumFileStructure::tpq()), so that times can be compared
+		// and added as integers.  These variables are filled by
+		// HumdrumFileStructure::assignLineTicks() and are -1 if rhythm
+		// has not been analyzed.
+		long long m_tickDuration = -1;
+		long long m_ticksFromStart = -1;
+		long long m_ticksFromBarline = -1;
+		long long m_ticksToBarline = -1;
+
 		// m_linkedParameters: List of Humdrum tokens which are parameters
 		// (mostly only layout parameters at the moment)
 		std::vector<HTp> m_linkedParameters;
@@ -1199,6 +2092,9 @@ class HumdrumToken : public std::string, public HumHash {
 		         HumdrumToken              (const std::string& token);
 		        ~HumdrumToken              ();
 
+		static void* operator new          (size_t size);
+		static void  operator delete       (void* ptr, size_t size);
+
 		bool     isNull                    (void) const;
 		bool     isManipulator             (void) const;
 
@@ -1270,6 +2166,7 @@ class HumdrumToken : public std::string, public HumHash {
 
 		HumNum   getDuration               (void);
 		HumNum   getDuration               (HumNum scale);
+		bool     hasStaleDuration          (void) const;
 		HumNum   getTiedDuration           (void);
 		HumNum   getTiedDuration           (HumNum scale);
 		HumNum   getDurationNoDots         (void);
@@ -1279,6 +2176,9 @@ class HumdrumToken : public std::string, public HumHash {
 		HumNum   getDurationFromStart      (void);
 		HumNum   getDurationFromStart      (HumNum scale);
 
+		long long getTickDuration          (void);
+		long long getTicksFromStart        (void);
+
 		HumNum   getDurationToEnd          (void);
 		HumNum   getDurationToEnd          (HumNum scale);
 
@@ -1313,6 +2213,10 @@ class HumdrumToken : public std::string, public HumHash {
 		bool     noteInLowerSubtrack       (void);
 		std::string   getTrackString       (void) const;
 		int      getSubtokenCount          (const std::string& separator = " ") const;
+		const KernNote& getKernNote        (int index = 0) const;
+		int      getKernNoteCount          (void) const;
+		unsigned int getKernNoteFlags      (void) const;
+		HumNum   getRecipDuration          (void) const;
 		std::string   getSubtoken          (int index,
 		                                    const std::string& separator = " ") const;
 		std::vector<std::string> getSubtokens (const std::string& separator = " ") const;
@@ -1407,6 +2311,8 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setStrandIndex            (int index);
 
 		bool     analyzeDuration           (void);
+		void     checkAnalysis             (int levels) const;
+		bool     getDurationFromText       (HumNum& duration) const;
 		std::ostream& printXmlBaseInfo     (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlContentInfo  (std::ostream& out = std::cout, int level = 0,
@@ -1419,6 +2325,36 @@ class HumdrumToken : public std::string, public HumHash {
 		                                    const std::string& indent = "\t");
 
 	private:
+		unsigned int getTextFlags          (void) const;
+		int      getDataTypeClass          (void) const;
+		void     clearCachedState          (void);
+		void     analyzeKernNotes          (void) const;
+		static void invalidateDataTypes    (void);
+		static std::atomic<int>& getDataTypeEpoch (void);
+
+		// Bit flags for m_textflags, describing characters found in the
+		// text of the token.
+		enum {
+			TEXT_ANALYZED     = 1 << 0,  // flags below have been calculated
+			TEXT_NULL         = 1 << 1,  // ".", "*" or "!"
+			TEXT_PITCH        = 1 << 2,  // a-g or A-G
+			TEXT_REST         = 1 << 3,  // r
+			TEXT_TIE_CONTINUE = 1 << 4,  // _ or ]
+			TEXT_GRACE        = 1 << 5,  // q
+			TEXT_CHORD        = 1 << 6,  // space
+			TEXT_SLUR_START   = 1 << 7,  // (
+			TEXT_SLUR_END     = 1 << 8,  // )
+			TEXT_BEAM         = 1 << 9   // L, J, k or K
+		};
+
+		// Values for m_datatype.
+		enum {
+			DATATYPE_OTHER = 0,
+			DATATYPE_KERN,
+			DATATYPE_MENS,
+			DATATYPE_RECIP
+		};
+
 		// address: The address contains information about the location of
 		// the token on a HumdrumLine and in a HumdrumFile.
 		HumAddress m_address;
@@ -1476,6 +2412,28 @@ class HumdrumToken : public std::string, public HumHash {
 		// m_rhythm_analyzed: Set to true when HumdrumFile assigned duration
 		bool m_rhythm_analyzed = false;
 
+		// m_textflags: Classification of the token text which is used by
+		// isNote(), isRest(), isNull() and similar functions.  Calculated
+		// in a single pass over the text the first time that it is needed,
+		// and cleared by setText().  Use setText() (or the HumRegex
+		// replaceDestructive() functions which take an HTp) rather than
+		// std::string functions to change the text of a token so that the
+		// flags are not left stale.
+		mutable unsigned int m_textflags = 0;
+
+		// m_datatype: Cached class of the exclusive interpretation of the
+		// token's spine, so that isKern() and similar functions do not
+		// have to look up the data type each time.  The cached value is
+		// valid while m_datatypeEpoch matches getDataTypeEpoch(), which
+		// changes whenever an exclusive interpretation is added or edited.
+		mutable int m_datatype = DATATYPE_OTHER;
+		mutable int m_datatypeEpoch = -1;
+
+		// m_kernnotes: Parsed **kern subtokens (see getKernNote()), filled
+		// in the first time that they are requested and cleared along with
+		// m_textflags.
+		mutable std::vector<KernNote> m_kernnotes;
+
 	friend class HumdrumLine;
 	friend class HumdrumFileBase;
 	friend class HumdrumFileStructure;
@@ -1526,6 +2484,53 @@ std::ostream& printSequence(std::vector<HTp>& sequence, std::ostream& out = std:
 #define OPT_DATA      (OPT_NOMANIP | OPT_NOCOMMENT | OPT_NOGLOBAL)
 #define OPT_ATTACKS   (OPT_DATA | OPT_NOREST | OPT_NOTIE | OPT_NONULL)
 
+// The following analysis levels are used with setAnalysisLevel() to
+// select which analyses are done when a file is read.  Skipped analyses
+// are done when analyze() is called, or automatically by the file, line
+// and token accessors which depend on them: spine/track and strand
+// accessors, rhythm accessors (durations, ticks, barlines), token links,
+// layout parameters, HumdrumToken::getStrandIndex() and the slur token
+// accessors.  Values read directly from the "auto" parameters with
+// getValue() (such as those set by the tie and accidental analyses) are
+// not lazy, so call analyze() with the needed levels before reading them:
+// * ANALYZE_TOKENS       => split lines into tokens.
+// * ANALYZE_SPINES       => spine info, data types and track numbers.
+// * ANALYZE_LINKS        => links between tokens on adjacent lines.
+// * ANALYZE_STRANDS      => spine strands and null token resolution.
+// * ANALYZE_GLOBALPARAMS => global (!!LO:) layout parameters.
+// * ANALYZE_LOCALPARAMS  => local (!LO:) layout parameters.
+// * ANALYZE_RHYTHM       => durations and timestamps of lines.
+// * ANALYZE_SLURS        => slur start/end linking.
+// * ANALYZE_TIES         => tie start/end linking.
+// * ANALYZE_ACCIDENTALS  => visual and cautionary accidentals.
+//
+// Compound levels:
+// * ANALYZE_BASE      (ANALYZE_TOKENS | ANALYZE_SPINES | ANALYZE_LINKS)
+//     Analyses done by HumdrumFileBase::read().
+// * ANALYZE_STRUCTURE (ANALYZE_BASE | ANALYZE_STRANDS | ANALYZE_GLOBALPARAMS
+//                      | ANALYZE_LOCALPARAMS | ANALYZE_RHYTHM)
+//     Analyses done by HumdrumFileStructure::read() (the default level).
+// * ANALYZE_CONTENT   (ANALYZE_STRUCTURE | ANALYZE_SLURS | ANALYZE_TIES
+//                      | ANALYZE_ACCIDENTALS)
+//     All analyses.
+//
+#define ANALYZE_TOKENS       0x001
+#define ANALYZE_SPINES       0x002
+#define ANALYZE_LINKS        0x004
+#define ANALYZE_STRANDS      0x008
+#define ANALYZE_GLOBALPARAMS 0x010
+#define ANALYZE_LOCALPARAMS  0x020
+#define ANALYZE_RHYTHM       0x040
+#define ANALYZE_SLURS        0x080
+#define ANALYZE_TIES         0x100
+#define ANALYZE_ACCIDENTALS  0x200
+#define ANALYZE_BASE         (ANALYZE_TOKENS | ANALYZE_SPINES | ANALYZE_LINKS)
+#define ANALYZE_STRUCTURE    (ANALYZE_BASE | ANALYZE_STRANDS | \
+                              ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS | \
+                              ANALYZE_RHYTHM)
+#define ANALYZE_CONTENT      (ANALYZE_STRUCTURE | ANALYZE_SLURS | \
+                              ANALYZE_TIES | ANALYZE_ACCIDENTALS)
+
 
 class TokenPair {
 	public:
@@ -1549,7 +2554,7 @@ class HumdrumFileBase : public HumHash {
 		              HumdrumFileBase          (HumdrumFileBase& infile);
 		              HumdrumFileBase          (const std::string& contents);
 		              HumdrumFileBase          (std::istream& contents);
-		             ~HumdrumFileBase          ();
+		virtual      ~HumdrumFileBase          ();
 
 		HumdrumFileBase& operator=             (HumdrumFileBase& infile);
 		bool          read                     (std::istream& contents);
@@ -1564,6 +2569,8 @@ class HumdrumFileBase : public HumHash {
 
 		bool          readString               (const char* contents);
 		bool          readString               (const std::string& contents);
+		bool          readBuffer               (const char* contents,
+		                                        size_t size);
 		bool          readStringCsv            (const char* contents,
 		                                        const std::string& separator=",");
 		bool          readStringCsv            (const std::string& contents,
@@ -1577,6 +2584,10 @@ class HumdrumFileBase : public HumHash {
 		bool          isStructureAnalyzed      (void);
 		bool          isRhythmAnalyzed         (void);
 		bool          areStrandsAnalyzed       (void);
+		void          setAnalysisLevel         (int levels);
+		int           getAnalysisLevel         (void) const;
+		bool          isAnalyzed               (int levels) const;
+		virtual bool  analyze                  (int levels);
 
     	template <class TYPE>
 		   void       initializeArray          (std::vector<std::vector<TYPE>>& array, TYPE value);
@@ -1674,6 +2685,9 @@ class HumdrumFileBase : public HumHash {
 		void          insertLine               (int index, HumdrumLine* line);
 
 		void          deleteLine               (int index);
+		void          markLineEdited           (int index);
+		bool          hasEdits                 (void) const;
+		virtual bool  reanalyzeEdits           (void);
 //		void          adjustMergeSpineLines    (void);
 
 		HumdrumLine*  back                     (void);
@@ -1756,6 +2770,18 @@ class HumdrumFileBase : public HumHash {
 		bool          processNonNullDataTokensForTrackBackward(HTp starttoken,
 		                                         std::vector<HTp> ptokens);
 		bool          setParseError             (std::stringstream& err);
+		void          checkSpines               (void) const;
+		bool          repairEditedSpines        (int startline, int endline);
+		void          getEditedRegion           (int startline, int endline,
+		                                         std::vector<HumdrumLine*>& region,
+		                                         HumdrumLine*& previous,
+		                                         HumdrumLine*& next);
+		void          clearEdits                (void);
+		std::string   getEditedText             (void);
+		void          appendLineText            (const char* text, size_t size);
+#ifdef USING_MMAP
+		bool          readMappedFile            (const char* filename);
+#endif
 		bool          setParseError             (const std::string& err);
 		bool          setParseError             (const char* format, ...);
 //		void          fixMerges                 (int linei);
@@ -1821,22 +2847,29 @@ class HumdrumFileBase : public HumHash {
 		// file structure has been analyzed.
 		bool m_structure_analyzed = false;
 
-		// m_rhythm_analyzed: Used to keep track of whether or not
-		// rhythm structure has been analyzed.
-		bool m_rhythm_analyzed = false;
-
-		// m_strands_analyzed: Used to keep track of whether or not
-		// file strands have been analyzed.
-		bool m_strands_analyzed = false;
+		// m_analysisLevel: ANALYZE_* analyses which are done when
+		// reading a file.
+		int m_analysisLevel = ANALYZE_STRUCTURE;
 
-		// m_slurs_analyzed: Used to keep track of whether or not
-		// slur endpoints have been linked or not.
-		bool m_slurs_analyzed = false;
+		// m_analyzed: ANALYZE_* analyses which have been done (or
+		// which are being done) on the current contents of the file.
+		int m_analyzed = 0;
 
 		// m_nulls_analyzed: Used to keep track of wheter or not
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_editStart: index of the first line which has been edited
+		// since the file was analyzed, or -1 if there are no edits.
+		int m_editStart = -1;
+
+		// m_editEnd: index of the last line which has been edited.
+		int m_editEnd = -1;
+
+		// m_editReparse: Set when an edit cannot be repaired locally
+		// by reanalyzeEdits(), such as deleting a spine manipulator.
+		bool m_editReparse = false;
+
 	public:
 		// Dummy functions to allow the HumdrumFile class's inheritance
 		// to be shifted between HumdrumFileContent (the top-level default),
@@ -1869,6 +2902,12 @@ std::ostream& operator<<(std::ostream& out, HumdrumFileBase& infile);
 
 
 
+// Records of the binary .humb file format (see HumdrumFileStructure-binary.cpp).
+struct HumbHeader;
+struct HumbString;
+struct HumbLine;
+struct HumbToken;
+
 class HumdrumFileStructure : public HumdrumFileBase {
 	public:
 		              HumdrumFileStructure         (void);
@@ -1922,10 +2961,20 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          readStringNoRhythmCsv        (const std::string& contents,
 		                                            const std::string& separator = ",");
 
+		// binary cache (.humb) of analyzed files:
+		bool          writeBinary                  (const std::string& filename);
+		bool          writeBinary                  (std::ostream& out);
+		bool          readBinary                   (const std::string& filename);
+		bool          readBinary                   (const char* filename);
+		bool          readBinaryBuffer             (const char* data, size_t size);
+		static bool   isBinaryBuffer               (const char* data, size_t size);
+
 		// rhythmic analysis related functionality:
 		HumNum        getScoreDuration             (void) const;
 		std::ostream&      printDurationInfo       (std::ostream& out = std::cout);
 		int           tpq                          (void);
+		long long     durationToTicks              (HumNum duration);
+		HumNum        ticksToDuration              (long long ticks);
 
 		// strand functionality:
 		HTp           getStrandStart               (int index);
@@ -1952,6 +3001,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          analyzeStructureNoRhythm     (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
+		virtual bool  analyze                      (int levels);
+		virtual bool  reanalyzeEdits               (void);
 
 		// signifier access
 		std::string   getKernLinkSignifier         (void);
@@ -1977,12 +3028,14 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          assignDurationsToTrack       (HTp starttoken,
 		                                            HumNum startdur);
 		bool          prepareDurations             (HTp token, int state,
-		                                            HumNum startdur);
+		                                            HumNum startdur,
+		                                            std::vector<std::pair<HTp, HumNum>>& worklist);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
 		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
 		bool          analyzeNullLineRhythms       (void);
 		void          fillInNegativeStartTimes     (void);
 		void          assignLineDurations          (void);
+		void          assignLineTicks              (void);
 		void          assignStrandsToTokens        (void);
 		std::set<HumNum>   getNonZeroLineDurations      (void);
 		std::set<HumNum>   getPositiveLineDurations     (void);
@@ -1994,6 +3047,45 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            HTp starttok);
 		void          analyzeSignifiers            (void);
 		void          setLineRhythmAnalyzed        (void);
+		void          checkRhythm                  (void) const;
+		bool          repairEditedStructure        (int startline, int endline);
+		void          repairEditedStrands          (std::vector<HumdrumLine*>& region,
+		                                            HumdrumLine* next,
+		                                            int startline, int endline);
+		HTp           getEditedStrandStart         (HTp token, int startline,
+		                                            int endline);
+		bool          isTimedLine                  (HumdrumLine* line);
+		bool          repairEditedRhythm           (HumdrumLine* first, int endline);
+		void          repairNonRhythmicDurations   (HumdrumLine* first,
+		                                            int startindex, int endindex);
+		void          repairMeter                  (int startindex, int endindex);
+		void          repairNonNullDataTokens      (HumdrumLine* first,
+		                                            int startline, int endline);
+		void          repairNullResolutions        (HumdrumLine* first,
+		                                            int endline);
+		static void   setBinaryNumber              (int* output, const HumNum& value);
+		int           getBinaryTokenIndex          (HTp token,
+		                                            const std::vector<int>& lineoffsets);
+		bool          storeBinaryLinks             (HumbString& output,
+		                                            const std::vector<HTp>& tokens,
+		                                            std::vector<int>& links,
+		                                            const std::vector<int>& lineoffsets);
+		static void   loadBinaryLinks              (std::vector<HTp>& output,
+		                                            const HumbString& range,
+		                                            const int* links,
+		                                            const std::vector<HTp>& tokens);
+		static bool   checkBinaryTables            (const HumbHeader& header,
+		                                            const HumbLine* lines,
+		                                            const HumbToken* tokens,
+		                                            const int* links,
+		                                            const HumbString* infos,
+		                                            const int* trackstarts,
+		                                            const int* trackendcounts,
+		                                            const int* trackends,
+		                                            const int* strands,
+		                                            const int* strand2dcounts,
+		                                            const int* strands2d,
+		                                            const int* barlines);
 };
 
 
@@ -2005,6 +3097,11 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		       HumdrumFileContent         (std::istream& contents);
 		      ~HumdrumFileContent         ();
 
+		virtual bool analyze              (int levels);
+
+		void   setThreadCount             (int count);
+		int    getThreadCount             (void) const;
+
 		bool   analyzeSlurs               (void);
 	private:
 		bool   analyzeMensSlurs           (void);
@@ -2071,9 +3168,17 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		                                   std::vector<std::pair<HTp, HTp>>& labels,
 		                                   std::vector<int>& endings,
 		                                   const std::string& linksig = "");
+		bool   analyzeSlurSpines          (std::vector<HTp>& spinestarts,
+		                                   std::vector<HTp>& linkstarts,
+		                                   std::vector<HTp>& linkends,
+		                                   std::vector<std::pair<HTp, HTp>>& labels,
+		                                   std::vector<int>& endings,
+		                                   const std::string& linksig);
 		bool   analyzeKernTies            (std::vector<std::pair<HTp, int>>& linkedtiestarts,
 		                                   std::vector<std::pair<HTp, int>>& linkedtieends,
 		                                   std::string& linkSignifier);
+		bool   analyzeKernAccidentals     (std::vector<HTp>& tokens,
+		                                   std::vector<char>& barlines);
 		void   fillKeySignature           (std::vector<int>& states,
 		                                   const std::string& keysig);
 		void   resetDiatonicStatesWithKeySignature(std::vector<int>& states,
@@ -2097,6 +3202,14 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		void    checkDataForCrossStaffStems(HTp token, std::string& above, std::string& below);
 		void    prepareStaffAboveNoteStems (HTp token);
 		void    prepareStaffBelowNoteStems (HTp token);
+
+		template <class TASK>
+		void    runSpineTasks             (int count, TASK task);
+
+	private:
+		// m_threads: number of threads used to analyze spines concurrently
+		// in the content analyses.
+		int m_threads = 1;
 };
 
 
@@ -2105,6 +3218,45 @@ class HumdrumFileContent : public HumdrumFileStructure {
 //
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::runSpineTasks -- Run task(0) to task(count-1),
+//    using the number of threads given by setThreadCount().  Each task
+//    should only change the tokens of its own spine (or strand), and
+//    store any other results in its own slot so that the caller can
+//    merge them in spine order afterwards.  Analyses which are done
+//    on demand (such as rhythm or null-token resolution) must be done
+//    before the tasks are run.
+//
+
+template <class TASK>
+void HumdrumFileContent::runSpineTasks(int count, TASK task) {
+	int threads = m_threads < count ? m_threads : count;
+	if (threads <= 1) {
+		for (int i=0; i<count; i++) {
+			task(i);
+		}
+		return;
+	}
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			task(index);
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileContent::prependDataSpine -- prepend a data spine
@@ -3160,15 +4312,22 @@ std::ostream& operator<<(std::ostream& out, MuseDataSet& musedata);
 class NoteGrid;
 
 
+//
+// NoteCell is a view of one cell in a NoteGrid.  The data for the cell
+// is stored in the arrays of its NoteGrid, so the accessor functions
+// are defined in NoteGrid.h.
+//
+
 class NoteCell {
 	public:
-		       NoteCell             (NoteGrid* owner, HTp token);
-		      ~NoteCell             (void) { clear();                    }
+		       NoteCell             (NoteGrid* owner, int index, int voice,
+		                             int slice);
+		      ~NoteCell             (void) { }
 
-		double getSgnDiatonicPitch  (void) { return m_b7;                }
-		double getSgnMidiPitch      (void) { return m_b12;               }
-		double getSgnBase40Pitch    (void) { return m_b40;               }
-		double getSgnAccidental     (void) { return m_accidental;        }
+		double getSgnDiatonicPitch  (void);
+		double getSgnMidiPitch      (void);
+		double getSgnBase40Pitch    (void);
+		double getSgnAccidental     (void);
 
 		double getSgnDiatonicPitchClass(void);
 		double getAbsDiatonicPitchClass(void);
@@ -3176,15 +4335,15 @@ class NoteCell {
 		double getSgnBase40PitchClass(void);
 		double getAbsBase40PitchClass(void);
 
-		double getAbsDiatonicPitch  (void) { return fabs(m_b7);          }
-		double getAbsMidiPitch      (void) { return fabs(m_b12);         }
-		double getAbsBase40Pitch    (void) { return fabs(m_b40);         }
-		double getAbsAccidental     (void) { return fabs(m_accidental);  }
+		double getAbsDiatonicPitch  (void);
+		double getAbsMidiPitch      (void);
+		double getAbsBase40Pitch    (void);
+		double getAbsAccidental     (void);
 
-		HTp    getToken             (void) { return m_token;             }
-		int    getNextAttackIndex   (void) { return m_nextAttackIndex;   }
-		int    getPrevAttackIndex   (void) { return m_prevAttackIndex;   }
-		int    getCurrAttackIndex   (void) { return m_currAttackIndex;   }
+		HTp    getToken             (void);
+		int    getNextAttackIndex   (void);
+		int    getPrevAttackIndex   (void);
+		int    getCurrAttackIndex   (void);
 		int    getSliceIndex        (void) { return m_timeslice;         }
 		int    getVoiceIndex        (void) { return m_voice;             }
 
@@ -3206,42 +4365,19 @@ class NoteCell {
 		double getMetricLevel       (void);
 		HumNum getDurationFromStart (void);
 		HumNum getDuration          (void);
-		void   setMeter             (int topval, HumNum botval);
 		int    getMeterTop          (void);
 		HumNum getMeterBottom       (void);
 
 		std::vector<HTp> m_tiedtokens;  // list of tied notes/rests after note attack
 
-	protected:
-		void clear                  (void);
-		void calculateNumericPitches(void);
-		void setVoiceIndex          (int index) { m_voice = index;           }
-		void setSliceIndex          (int index) { m_timeslice = index;       }
-		void setNextAttackIndex     (int index) { m_nextAttackIndex = index; }
-		void setPrevAttackIndex     (int index) { m_prevAttackIndex = index; }
-		void setCurrAttackIndex     (int index) { m_currAttackIndex = index; }
-
 	private:
 		NoteGrid* m_owner; // the NoteGrid to which this cell belongs.
-		HTp m_token;       // pointer to the note in the origina Humdrum file.
+		int m_index;       // index of the cell in the NoteGrid arrays.
 		int m_voice;       // index of the voice in the score the note belongs
 		                   // 0=bottom voice (HumdrumFile ordering of parts)
 		                   // column in NoteGrid.
 		int m_timeslice;   // index for the row in NoteGrid.
 
-		double m_b7;         // diatonic note number; NaN=rest; negative=sustain.
-		double m_b12;        // MIDI note number; NaN=rest; negative=sustain.
-		double m_b40;        // base-40 note number; NaN=rest; negative=sustain.
-		double m_accidental; // chromatic alteration of a diatonic pitch.
-		                     // NaN=no accidental.
-		int m_nextAttackIndex; // index to next note attack (or rest),
-		                       // -1 for undefined (interpred as rest).
-		int m_prevAttackIndex; // index to previous note attack.
-		int m_currAttackIndex; // index to current note attack (useful for
-		                       // finding the start of a sustained note.
-		int m_metertop = 0;    // top number of prevailing meter signature
-		HumNum m_meterbot = 0; // bottom number of prevailing meter signature
-
 	friend NoteGrid;
 };
 
@@ -3297,16 +4433,148 @@ class NoteGrid {
 	protected:
 		void       buildAttackIndexes    (void);
 		void       buildAttackIndex      (int vindex);
+		void       buildDurations        (void);
+		void       calculateNumericPitches(int index);
+		int        getIndex              (int vindex, int sindex);
 
 	private:
-		vector<vector<NoteCell*> > m_grid;
+		// Cell flags:
+		enum {
+			CELL_REST    = 1,  // no pitch (base-40 pitch is NaN).
+			CELL_NOPITCH = 2   // no diatonic/MIDI pitch or accidental.
+		};
+
+		// m_cells: one NoteCell view for each cell of the grid.  All of the
+		// per-cell arrays below are stored by voice and then by slice:
+		// index = vindex * m_slices + sindex.
+		vector<NoteCell>           m_cells;
+
+		// m_tokens: the note (or null/rest) token of each cell.
+		vector<HTp>                m_tokens;
+
+		// m_b7, m_b12, m_b40, m_accidental: diatonic, MIDI and base-40 pitch
+		// and chromatic alteration of each cell.  Values are negative for
+		// sustained notes; see m_flags for rests.
+		vector<int>                m_b7;
+		vector<int>                m_b12;
+		vector<int>                m_b40;
+		vector<int>                m_accidental;
+
+		// m_flags: CELL_* flags for each cell.
+		vector<unsigned char>      m_flags;
+
+		// m_prevattack, m_currattack, m_nextattack: slice indexes of the
+		// previous, current and next note attacks (or first rests of
+		// rest sequences) in the voice; -1 for none.
+		vector<int>                m_prevattack;
+		vector<int>                m_currattack;
+		vector<int>                m_nextattack;
+
+		// m_durations: duration of the note (or rest) in each cell, from
+		// its attack to the next attack in the voice.  Calculated when
+		// first needed.
+		vector<HumNum>             m_durations;
+
+		// m_metertops, m_meterbots: prevailing meter signature of each cell.
+		vector<int>                m_metertops;
+		vector<HumNum>             m_meterbots;
+
+		// m_voices, m_slices: size of the grid.
+		int                        m_voices = 0;
+		int                        m_slices = 0;
+
 		vector<HTp>                m_kernspines;
 		vector<double>             m_metriclevels;
-		HumdrumFile*               m_infile;
+		HumdrumFile*               m_infile = NULL;
+
+	friend NoteCell;
 };
 
 
 
+//////////////////////////////
+//
+// NoteGrid::getIndex -- Return the index of a cell in the grid arrays.
+//
+
+inline int NoteGrid::getIndex(int vindex, int sindex) {
+	if (((unsigned)vindex >= (unsigned)m_voices) ||
+			((unsigned)sindex >= (unsigned)m_slices)) {
+		throw std::out_of_range("NoteGrid cell index out of range");
+	}
+	return vindex * m_slices + sindex;
+}
+
+
+
+//////////////////////////////
+//
+// NoteCell accessors -- These read the NoteGrid arrays for the cell.
+//
+
+inline double NoteCell::getSgnDiatonicPitch(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) ? GRIDREST
+			: m_owner->m_b7[m_index];
+}
+
+inline double NoteCell::getSgnMidiPitch(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) ? GRIDREST
+			: m_owner->m_b12[m_index];
+}
+
+inline double NoteCell::getSgnBase40Pitch(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) ? GRIDREST
+			: m_owner->m_b40[m_index];
+}
+
+inline double NoteCell::getSgnAccidental(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) ? GRIDREST
+			: m_owner->m_accidental[m_index];
+}
+
+inline double NoteCell::getAbsDiatonicPitch(void) {
+	return fabs(getSgnDiatonicPitch());
+}
+
+inline double NoteCell::getAbsMidiPitch(void) {
+	return fabs(getSgnMidiPitch());
+}
+
+inline double NoteCell::getAbsBase40Pitch(void) {
+	return fabs(getSgnBase40Pitch());
+}
+
+inline double NoteCell::getAbsAccidental(void) {
+	return fabs(getSgnAccidental());
+}
+
+inline HTp NoteCell::getToken(void) {
+	return m_owner->m_tokens[m_index];
+}
+
+inline int NoteCell::getNextAttackIndex(void) {
+	return m_owner->m_nextattack[m_index];
+}
+
+inline int NoteCell::getPrevAttackIndex(void) {
+	return m_owner->m_prevattack[m_index];
+}
+
+inline int NoteCell::getCurrAttackIndex(void) {
+	return m_owner->m_currattack[m_index];
+}
+
+inline bool NoteCell::isRest(void) {
+	return (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) ? true : false;
+}
+
+inline bool NoteCell::isAttack(void) {
+	return !isRest() && (m_owner->m_b40[m_index] > 0);
+}
+
+
+
+
 class Convert {
 	public:
 
@@ -3323,6 +4591,9 @@ class Convert {
 		static HumNum  recipToDurationNoDots(std::string* recip,
 		                                     HumNum scale = 4,
 		                                     const std::string& separator = " ");
+		static HumNum  recipToDuration      (const HumdrumToken* token,
+		                                     HumNum scale = 4,
+		                                     const std::string& separator = " ");
 		static std::string  durationToRecip      (HumNum duration,
 		                                     HumNum scale = HumNum(1,4));
 		static std::string  durationFloatToRecip (double duration,
@@ -3337,41 +4608,41 @@ class Convert {
 		static std::string  base40ToIntervalAbbr (int b40);
 		static int     kernToOctaveNumber   (const std::string& kerndata);
 		static int     kernToOctaveNumber   (HTp token)
-				{ return kernToOctaveNumber((std::string)*token); }
+				{ return token->getKernNote().getOctaveNumber(); }
 		static int     kernToAccidentalCount(const std::string& kerndata);
 		static int     kernToAccidentalCount(HTp token)
-				{ return kernToAccidentalCount((std::string)*token); }
+				{ return token->getKernNote().getAccidentalCount(); }
 		static int     kernToDiatonicPC     (const std::string& kerndata);
 		static int     kernToDiatonicPC     (HTp token)
-				{ return kernToDiatonicPC     ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicPC(); }
 		static char    kernToDiatonicUC     (const std::string& kerndata);
 		static int     kernToDiatonicUC     (HTp token)
-				{ return kernToDiatonicUC     ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicUC(); }
 		static char    kernToDiatonicLC     (const std::string& kerndata);
 		static int     kernToDiatonicLC     (HTp token)
-				{ return kernToDiatonicLC     ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicLC(); }
 		static int     kernToBase40PC       (const std::string& kerndata);
 		static int     kernToBase40PC       (HTp token)
-				{ return kernToBase40PC       ((std::string)*token); }
+				{ return token->getKernNote().getBase40PC(); }
 		static int     kernToBase12PC       (const std::string& kerndata);
 		static int     kernToBase12PC       (HTp token)
-				{ return kernToBase12PC       ((std::string)*token); }
+				{ return token->getKernNote().getBase12PC(); }
 		static int     kernToBase7PC        (const std::string& kerndata) {
 		                                     return kernToDiatonicPC(kerndata); }
 		static int     kernToBase7PC        (HTp token)
-				{ return kernToBase7PC        ((std::string)*token); }
+				{ return token->getKernNote().getDiatonicPC(); }
 		static int     kernToBase40         (const std::string& kerndata);
 		static int     kernToBase40         (HTp token)
-				{ return kernToBase40         ((std::string)*token); }
+				{ return token->getKernNote().getBase40(); }
 		static int     kernToBase12         (const std::string& kerndata);
 		static int     kernToBase12         (HTp token)
-				{ return kernToBase12         ((std::string)*token); }
+				{ return token->getKernNote().getBase12(); }
 		static int     kernToBase7          (const std::string& kerndata);
 		static int     kernToBase7          (HTp token)
-				{ return kernToBase7          ((std::string)*token); }
+				{ return token->getKernNote().getBase7(); }
 		static int     kernToMidiNoteNumber (const std::string& kerndata);
 		static int     kernToMidiNoteNumber(HTp token)
-				{ return kernToMidiNoteNumber((std::string)*token); }
+				{ return token->getKernNote().getMidiNoteNumber(); }
 		static std::string  kernToScientificPitch(const std::string& kerndata,
 		                                     std::string flat = "b",
 		                                     std::string sharp = "#",
@@ -3456,6 +4727,19 @@ class Convert {
 		static char hasKernStemDirection    (const std::string& kerndata);
 
 		static bool isKernSecondaryTiedNote (const std::string& kerndata);
+
+		// HTp versions, which use the parsed notes of the token (see
+		// HumdrumToken::getKernNote()):
+		static bool isKernRest              (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_REST; }
+		static bool isKernNote              (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_PITCH; }
+		static bool isKernNoteAttack        (HTp token);
+		static bool hasKernSlurStart        (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_SLUR_START; }
+		static bool hasKernSlurEnd          (HTp token)
+				{ return token->getKernNoteFlags() & KernNote::NOTE_SLUR_END; }
+		static bool isKernSecondaryTiedNote (HTp token);
 		static std::string getKernPitchAttributes(const std::string& kerndata);
 
 		// String processing, defined in Convert-string.cpp
@@ -3484,6 +4768,7 @@ class Convert {
 
 		// Mathematical processing, defined in Convert-math.cpp
 		static int     getLcm               (const std::vector<int>& numbers);
+		static long long getLcm64           (const std::vector<int>& numbers);
 		static int     getGcd               (int a, int b);
 		static void    primeFactors         (std::vector<int>& output, int n);
 		static double  nearIntQuantize      (double value,
@@ -4444,26 +5729,214 @@ class Options {
 		// listing.
 		bool m_suppressQ = false;
 
-		// m_optionsArgument: indicate that --options was used.
-		bool m_optionsArgQ = false;
+		// m_optionsArgument: indicate that --options was used.
+		bool m_optionsArgQ = false;
+
+		// m_error: used to store errors in parsing command-line options.
+		stringstream m_error;
+
+	private:
+		int     getRegIndex    (const string& optionName);
+		bool    isOption       (const string& aString, int& argp);
+		int     storeOption    (int gargp, int& position, int& running);
+};
+
+#define OPTION_BOOLEAN_TYPE   'b'
+#define OPTION_CHAR_TYPE      'c'
+#define OPTION_DOUBLE_TYPE    'd'
+#define OPTION_FLOAT_TYPE     'f'
+#define OPTION_INT_TYPE       'i'
+#define OPTION_STRING_TYPE    's'
+#define OPTION_UNKNOWN_TYPE   'x'
+
+
+
+class HumdrumFileSet;
+
+class HumdrumFileStream {
+	public:
+		                HumdrumFileStream  (void);
+		                HumdrumFileStream  (char** list);
+		                HumdrumFileStream  (const std::vector<std::string>& list);
+		                HumdrumFileStream  (Options& options);
+		                HumdrumFileStream  (const string& datastream);
+		               ~HumdrumFileStream  ();
+
+		void            loadString         (const string& data);
+
+		int             setFileList        (char** list);
+		int             setFileList        (const std::vector<std::string>& list);
+		const std::vector<std::string>& getFileList(void) const;
+
+		void            clear              (void);
+		int             eof                (void);
+
+		int             getFile            (HumdrumFile& infile);
+		int             read               (HumdrumFile& infile);
+		int             read               (HumdrumFileSet& infiles);
+		int             readSingleSegment  (HumdrumFileSet& infiles);
+		int             readSegments       (HumdrumFileSet& infiles, int count);
+
+		void            setThreadCount     (int count);
+		int             getThreadCount     (void) const;
+
+		void            setPrefetch        (int count, size_t maxbytes = 0);
+		int             getPrefetchCount   (void) const;
+
+		// Random access to the segments of a single file (see
+		// HumdrumFileStream-index.cpp):
+		int             buildSegmentIndex  (const std::string& filename);
+		bool            writeSegmentIndex  (std::ostream& out);
+		bool            writeSegmentIndex  (const std::string& filename);
+		bool            readSegmentIndex   (std::istream& input);
+		bool            readSegmentIndex   (const std::string& filename);
+		int             getSegmentCount    (void) const;
+		int             getSegmentNumber   (const std::string& name) const;
+		std::string     getSegmentName     (int index) const;
+		int             getSegmentLevel    (int index) const;
+		long long       getSegmentOffset   (int index) const;
+		bool            readSegment        (HumdrumFile& infile, int index);
+		bool            readSegment        (HumdrumFile& infile,
+		                                    const std::string& name);
+
+	protected:
+		std::stringstream m_stringbuffer;   // used to read files from a string
+		std::ifstream     m_instream;       // used to read from list of files
+		std::stringstream m_urlbuffer;      // used to read data over internet
+		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
+		                                    // records.
+
+		std::vector<std::string>  m_filelist;       // used when not using cin
+		int                       m_curfile;        // index into filelist
+
+		std::vector<std::string>  m_universals;     // storage for universal comments
+
+		// m_threads: number of threads used to parse segments in readSegments().
+		int m_threads = 1;
+
+		// SegmentEntry: the reading state of the stream at the start of
+		// a segment, which is enough to read the segment without reading
+		// the ones before it.
+		struct SegmentEntry {
+			long long   offset;      // byte offset after the pending line
+			int         level;       // !!!!SEGMENT level
+			int         universals;  // index into m_segmentuniversals
+			std::string pending;     // m_newfilebuffer contents
+			std::string name;        // filename of the segment
+		};
+
+		// m_indexfile: the file described by the segment index.
+		std::string m_indexfile;
+
+		// m_segments: the segment index created by buildSegmentIndex().
+		std::vector<SegmentEntry> m_segments;
+
+		// m_segmentuniversals: universal comments which are in effect
+		// for segments in the index.
+		std::vector<std::vector<std::string>> m_segmentuniversals;
+
+		// m_segmentnames: segment index for each segment name.
+		std::map<std::string, int> m_segmentnames;
+
+		// PrefetchEntry: a segment read by the prefetch thread.
+		struct PrefetchEntry {
+			HumdrumFile* infile;   // filename and level, plus contents if parsed
+			std::string  contents; // text of the segment if not parsed
+			bool         parsed;   // true if infile has been parsed
+			size_t       size;     // parsed size if parsed, else text length
+		};
+
+		// m_prefetchcount: maximum number of segments read ahead of the
+		// caller (0 to read segments only when requested).
+		int m_prefetchcount = 0;
+
+		// m_prefetchbytes: maximum total size of the segments which have
+		// been read ahead (0 for no limit).  Parsed segments are counted
+		// by getParsedSize(), unparsed ones by the length of their text.
+		size_t m_prefetchbytes = 0;
+
+		// m_prefetchsize: total size of the segments in m_prefetchqueue.
+		size_t m_prefetchsize = 0;
+
+		// m_prefetchparse: true if the prefetch thread also parses segments.
+		bool m_prefetchparse = true;
+
+		// m_prefetchdone: true when the prefetch thread has reached the end
+		// of the input.
+		bool m_prefetchdone = false;
+
+		// m_prefetchstop: set to ask the prefetch thread to exit.
+		bool m_prefetchstop = false;
+
+		std::deque<PrefetchEntry> m_prefetchqueue;
+		std::thread               m_prefetchthread;
+		std::mutex                m_prefetchlock;
+		std::condition_variable   m_prefetchready;  // queue is not empty or done
+		std::condition_variable   m_prefetchroom;   // queue has space or stop
+
+		void     startPrefetch            (bool parse);
+		void     stopPrefetch             (void);
+		void     prefetchSegments         (void);
+		HumdrumFile* takeSegment          (std::string& contents, bool& parsed);
+		static size_t getParsedSize       (HumdrumFile& infile);
+
+		int      getFileText              (HumdrumFile& infile, std::string& contents);
+		static void parseFileText         (HumdrumFile& infile,
+		                                   const std::string& contents);
+		static std::string escapeIndexText   (const std::string& text);
+		static std::string unescapeIndexText (const std::string& text);
+
+		// Automatic URL downloading of data from internet in read():
+		void     fillUrlBuffer            (std::stringstream& uribuffer,
+		                                   const std::string& uriname);
+
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+class HumdrumFileSet {
+   public:
+                            HumdrumFileSet   (void);
+                            HumdrumFileSet   (Options& options);
+                            HumdrumFileSet   (const std::string& contents);
+                           ~HumdrumFileSet   ();
+
+      void                  clear            (void);
+      void                  clearNoFree      (void);
+      int                   getSize          (void);
+      int                   getCount         (void) { return getSize(); }
+      HumdrumFile&          operator[]       (int index);
+		bool                  swap             (int index1, int index2);
+		bool                  hasFilters       (void);
+		bool                  hasGlobalFilters    (void);
+		bool                  hasUniversalFilters (void);
+		std::vector<HumdrumLine*> getUniversalReferenceRecords(void);
+
+      int                   readFile         (const std::string& filename);
+      int                   readString       (const std::string& contents);
+      int                   readStringCsv    (const std::string& contents);
+      int                   read             (std::istream& inStream);
+      int                   read             (Options& options);
+      int                   read             (HumdrumFileStream& instream);
+
+      int                   readAppendFile   (const std::string& filename);
+      int                   readAppendString (const std::string& contents);
+      int                   readAppendStringCsv (const std::string& contents);
+      int                   readAppend       (std::istream& inStream);
+      int                   readAppend       (Options& options);
+      int                   readAppend       (HumdrumFileStream& instream);
+      int                   readAppendHumdrum(HumdrumFile& infile);
+		int                   appendHumdrumPointer(HumdrumFile* infile);
 
-		// m_error: used to store errors in parsing command-line options.
-		stringstream m_error;
+   protected:
+      vector<HumdrumFile*>  m_data;
 
-	private:
-		int     getRegIndex    (const string& optionName);
-		bool    isOption       (const string& aString, int& argp);
-		int     storeOption    (int gargp, int& position, int& running);
+      void                  appendHumdrumFileContent(const std::string& filename,
+                                               std::stringstream& inbuffer);
 };
 
-#define OPTION_BOOLEAN_TYPE   'b'
-#define OPTION_CHAR_TYPE      'c'
-#define OPTION_DOUBLE_TYPE    'd'
-#define OPTION_FLOAT_TYPE     'f'
-#define OPTION_INT_TYPE       'i'
-#define OPTION_STRING_TYPE    's'
-#define OPTION_UNKNOWN_TYPE   'x'
-
 
 
 class HumTool : public Options {
@@ -4498,8 +5971,11 @@ class HumTool : public Options {
 		std::string   getError        (void);
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
+		void          allowSegmentPrefetch(void);
 
 	protected:
+		void          allowParallelSegments(void);
+
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
 		std::stringstream m_free_text;     // output for plain text content.
@@ -4511,6 +5987,160 @@ class HumTool : public Options {
 };
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// runStreamParallel -- Process the segments of a HumdrumFileStream with
+//    several threads for STREAM_INTERFACE.  Segments are read in batches
+//    and parsed concurrently, then each thread runs its own copy of
+//    the tool (set up with the same command-line options) on segments
+//    from the batch.  Output is written in the input order, and
+//    processing stops at the first segment which gives an error.
+//    Only used for tools which call HumTool::allowParallelSegments(),
+//    since tools which keep state between segments would give different
+//    results depending on which segments each copy of the tool is given.
+//
+
+template <class TOOL>
+int runStreamParallel(HumdrumFileStream& instream, int argc, char** argv,
+		int threads) {
+	instream.setThreadCount(threads);
+	threads = instream.getThreadCount();
+	std::vector<TOOL> tools(threads);
+	for (int i=0; i<threads; i++) {
+		tools[i].process(argc, argv);
+	}
+	int batchsize = threads * 4;
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (true) {
+		int count = instream.readSegments(infiles, batchsize);
+		if (count == 0) {
+			break;
+		}
+		std::vector<std::string> output(count);
+		std::vector<std::string> warning(count);
+		std::vector<std::string> error(count);
+		std::vector<char> success(count, 1);
+		std::vector<char> failure(count, 0);
+		std::atomic<int> next(0);
+		auto worker = [&](TOOL& tool) {
+			int index;
+			while ((index = next++) < count) {
+				HumdrumFileSet single;
+				single.appendHumdrumPointer(&infiles[index]);
+				success[index] = tool.run(single);
+				single.clearNoFree();
+				warning[index] = tool.getWarning();
+				if (tool.hasError()) {
+					failure[index] = 1;
+					error[index] = tool.getError();
+				}
+				if (tool.hasAnyText()) {
+					output[index] = tool.getAllText();
+				} else if (!failure[index]) {
+					std::stringstream text;
+					text << infiles[index];
+					output[index] = text.str();
+				}
+				tool.clearOutput();
+			}
+		};
+		std::vector<std::thread> workers;
+		for (int i=1; i<threads; i++) {
+			workers.emplace_back(worker, std::ref(tools[i]));
+		}
+		worker(tools[0]);
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+		for (int i=0; i<count; i++) {
+			status &= success[i] ? true : false;
+			std::cerr << warning[i];
+			std::cout << output[i];
+			if (failure[i]) {
+				std::cerr << error[i];
+				return -1;
+			}
+		}
+	}
+	return !status;
+}
+
+
+
+//////////////////////////////
+//
+// runStreamInterface -- Run a tool on each segment of the input files
+//    (or standard input) for STREAM_INTERFACE, after the command-line
+//    options have been processed.  Output for each segment is printed
+//    after the tool has processed it.  Segments are read ahead if the
+//    tool has the --prefetch option (see HumTool::allowSegmentPrefetch()).
+//
+
+template <class TOOL>
+int runStreamInterface(TOOL& interface, int argc, char** argv) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	if (interface.isDefined("prefetch")) {
+		instream.setPrefetch(interface.getInteger("prefetch"),
+				(size_t)interface.getInteger("prefetch-memory") << 20);
+	}
+	if (interface.isDefined("threads") && (interface.getInteger("threads") != 1)) {
+		return runStreamParallel<TOOL>(instream, argc, argv,
+				interface.getInteger("threads"));
+	}
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (instream.readSingleSegment(infiles)) {
+		status &= interface.run(infiles);
+		if (interface.hasWarning()) {
+			interface.getWarning(std::cerr);
+		}
+		if (interface.hasAnyText()) {
+			interface.getAllText(std::cout);
+		}
+		if (interface.hasError()) {
+			interface.getError(std::cerr);
+			return -1;
+		}
+		if (!interface.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				std::cout << infiles[i];
+			}
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
+
+
+
+//////////////////////////////
+//
+// runRawStreamInterface -- Give the whole input stream (the input files
+//    or standard input) to a tool for RAW_STREAM_INTERFACE, after the
+//    command-line options have been processed, and print its output.
+//
+
+template <class TOOL>
+int runRawStreamInterface(TOOL& interface) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	bool status = interface.run(instream);
+	if (interface.hasWarning()) {
+		interface.getWarning(std::cerr);
+	}
+	if (interface.hasAnyText()) {
+		interface.getAllText(std::cout);
+	}
+	if (interface.hasError()) {
+		interface.getError(std::cerr);
+		return -1;
+	}
+	interface.clearOutput();
+	return !status;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // common command-line Interfaces
@@ -4559,7 +6189,11 @@ int main(int argc, char** argv) {                      \
 //////////////////////////////
 //
 // STREAM_INTERFACE -- Use HumdrumFileStream (low-memory
-//    usage implementation).
+//    usage implementation).  For tools which allow it, segments are
+//    processed in parallel when --threads is set to a value other than 1
+//    (see runStreamParallel).
+//    With --prefetch, segments are read and parsed in a separate thread
+//    while the current segment is processed.
 //
 
 #define STREAM_INTERFACE(CLASS)                                  \
@@ -4567,33 +6201,12 @@ using namespace std;                                             \
 using namespace hum;                                             \
 int main(int argc, char** argv) {                                \
 	CLASS interface;                                              \
+	interface.allowSegmentPrefetch();                             \
 	if (!interface.process(argc, argv)) {                         \
 		interface.getError(cerr);                                  \
 		return -1;                                                 \
 	}                                                             \
-	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	HumdrumFileSet infiles;                                       \
-	bool status = true;                                           \
-	while (instream.readSingleSegment(infiles)) {                 \
-		status &= interface.run(infiles);                          \
-		if (interface.hasWarning()) {                              \
-			interface.getWarning(cerr);                             \
-		}                                                          \
-		if (interface.hasAnyText()) {                              \
-		   interface.getAllText(cout);                             \
-		}                                                          \
-		if (interface.hasError()) {                                \
-			interface.getError(cerr);                               \
-         return -1;                                              \
-		}                                                          \
-		if (!interface.hasAnyText()) {                             \
-			for (int i=0; i<infiles.getCount(); i++) {              \
-				cout << infiles[i];                                  \
-			}                                                       \
-		}                                                          \
-		interface.clearOutput();                                   \
-	}                                                             \
-	return !status;                                               \
+	return runStreamInterface<CLASS>(interface, argc, argv);      \
 }
 
 
@@ -4614,20 +6227,7 @@ int main(int argc, char** argv) {                                \
 		interface.getError(cerr);                                  \
 		return -1;                                                 \
 	}                                                             \
-	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	bool status = interface.run(instream);                        \
-	if (interface.hasWarning()) {                                 \
-		interface.getWarning(cerr);                                \
-	}                                                             \
-	if (interface.hasAnyText()) {                                 \
-	   interface.getAllText(cout);                                \
-	}                                                             \
-	if (interface.hasError()) {                                   \
-		interface.getError(cerr);                                  \
-        return -1;                                               \
-	}                                                             \
-	interface.clearOutput();                                      \
-	return !status;                                               \
+	return runRawStreamInterface<CLASS>(interface);               \
 }
 
 
@@ -4672,94 +6272,6 @@ int main(int argc, char** argv) {                                \
 
 
 
-class HumdrumFileSet;
-
-class HumdrumFileStream {
-	public:
-		                HumdrumFileStream  (void);
-		                HumdrumFileStream  (char** list);
-		                HumdrumFileStream  (const std::vector<std::string>& list);
-		                HumdrumFileStream  (Options& options);
-		                HumdrumFileStream  (const string& datastream);
-
-		void            loadString         (const string& data);
-
-		int             setFileList        (char** list);
-		int             setFileList        (const std::vector<std::string>& list);
-
-		void            clear              (void);
-		int             eof                (void);
-
-		int             getFile            (HumdrumFile& infile);
-		int             read               (HumdrumFile& infile);
-		int             read               (HumdrumFileSet& infiles);
-		int             readSingleSegment  (HumdrumFileSet& infiles);
-
-	protected:
-		std::stringstream m_stringbuffer;   // used to read files from a string
-		std::ifstream     m_instream;       // used to read from list of files
-		std::stringstream m_urlbuffer;      // used to read data over internet
-		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
-		                                    // records.
-
-		std::vector<std::string>  m_filelist;       // used when not using cin
-		int                       m_curfile;        // index into filelist
-
-		std::vector<std::string>  m_universals;     // storage for universal comments
-
-		// Automatic URL downloading of data from internet in read():
-		void     fillUrlBuffer            (std::stringstream& uribuffer,
-		                                   const std::string& uriname);
-
-};
-
-
-
-///////////////////////////////////////////////////////////////////////////
-
-class HumdrumFileSet {
-   public:
-                            HumdrumFileSet   (void);
-                            HumdrumFileSet   (Options& options);
-                            HumdrumFileSet   (const std::string& contents);
-                           ~HumdrumFileSet   ();
-
-      void                  clear            (void);
-      void                  clearNoFree      (void);
-      int                   getSize          (void);
-      int                   getCount         (void) { return getSize(); }
-      HumdrumFile&          operator[]       (int index);
-		bool                  swap             (int index1, int index2);
-		bool                  hasFilters       (void);
-		bool                  hasGlobalFilters    (void);
-		bool                  hasUniversalFilters (void);
-		std::vector<HumdrumLine*> getUniversalReferenceRecords(void);
-
-      int                   readFile         (const std::string& filename);
-      int                   readString       (const std::string& contents);
-      int                   readStringCsv    (const std::string& contents);
-      int                   read             (std::istream& inStream);
-      int                   read             (Options& options);
-      int                   read             (HumdrumFileStream& instream);
-
-      int                   readAppendFile   (const std::string& filename);
-      int                   readAppendString (const std::string& contents);
-      int                   readAppendStringCsv (const std::string& contents);
-      int                   readAppend       (std::istream& inStream);
-      int                   readAppend       (Options& options);
-      int                   readAppend       (HumdrumFileStream& instream);
-      int                   readAppendHumdrum(HumdrumFile& infile);
-		int                   appendHumdrumPointer(HumdrumFile* infile);
-
-   protected:
-      vector<HumdrumFile*>  m_data;
-
-      void                  appendHumdrumFileContent(const std::string& filename,
-                                               std::stringstream& inbuffer);
-};
-
-
-
 
 class Tool_autobeam : public HumTool {
 	public:
@@ -4906,9 +6418,11 @@ class Tool_binroll : public HumTool {
 		                            HTp ending);
 		void     printAnalysis     (HumdrumFile& infile,
 		                            vector<vector<char>>& roll);
+		int      getSlotIndex      (long long ticks);
 
 	private:
 		HumNum    m_duration;
+		int       m_tpq = 1;
 
 };
 
@@ -4994,6 +6508,41 @@ class NoteNode {
 
 
 
+//
+// CintModuleHash -- Hash function for counting modules, which are stored
+//    as a list of interval codes (see Tool_cint::getIntervalCode) and the
+//    number of sonorities in the module.
+//
+
+class CintModuleHash {
+	public:
+		size_t operator()(const pair<vector<int>, int>& module) const {
+			size_t hash = (size_t)module.second;
+			for (int code : module.first) {
+				hash ^= (size_t)code + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			}
+			return hash;
+		}
+};
+
+
+
+//
+// CintModuleText -- Output of a counterpoint module which has been
+//    calculated ahead of printing (--pair-threads).
+//
+
+class CintModuleText {
+	public:
+		string      text;            // printed module text.
+		int         count = 0;       // number of search matches.
+		vector<int> marks;           // note indexes to mark for a match.
+		int         retroline = -1;  // retrospective row, or -1 if none.
+		string      retrotext;       // retrospective entry.
+};
+
+
+
 class Tool_cint : public HumTool {
 	public:
 		         Tool_cint    (void);
@@ -5003,6 +6552,8 @@ class Tool_cint : public HumTool {
 		bool     run                    (HumdrumFile& infile);
 		bool     run                    (const string& indata, ostream& out);
 		bool     run                    (HumdrumFile& infile, ostream& out);
+		bool     run                    (HumdrumFileStream& instream);
+		bool     hasModuleCountMode     (void);
 
 	protected:
 
@@ -5036,6 +6587,9 @@ class Tool_cint : public HumTool {
 		void      printSpacer          (ostream& out);
 		int       printInterval        (ostream& out, NoteNode& note1, NoteNode& note2,
 		                                int type, int octaveadjust = 0);
+		int       getIntervalCode      (NoteNode& note1, NoteNode& note2,
+		                                int type, int octaveadjust = 0);
+		void      printIntervalCode    (ostream& out, int code);
 		int       printLatticeItem     (vector<vector<NoteNode> >& notes, int n,
 		                                int currentindex, int fileline);
 		int       printLatticeItemRows (vector<vector<NoteNode> >& notes, int n,
@@ -5080,9 +6634,31 @@ class Tool_cint : public HumTool {
 		                                vector<vector<NoteNode> >& notes, int n,
 		                                int startline, int part1, int part2,
 		                                vector<vector<string> >& retrospective,
-		                                HumdrumFile& infile, const string& searchstring);
+		                                HumdrumFile& infile, const string& searchstring,
+		                                CintModuleText* result = NULL);
+		void      prepareModuleBlock   (vector<vector<NoteNode> >& notes,
+		                                HumdrumFile& infile, int n, int start, int end,
+		                                vector<vector<string> >& retrospective,
+		                                const string& searchstring);
+		int       printPreparedModule  (ostream& out, vector<vector<NoteNode> >& notes,
+		                                int startline, int part1, int part2,
+		                                vector<vector<string> >& retrospective);
 		int       getOctaveAdjustForCombinationModule(vector<vector<NoteNode> >& notes,
 		                                int n, int startline, int part1, int part2);
+		int       getModuleIndexes     (vector<int>& indexes,
+		                                vector<vector<NoteNode> >& notes, int n,
+		                                int startline, int part1, int part2);
+		void      getModuleCodes       (vector<int>& codes,
+		                                vector<vector<NoteNode> >& notes,
+		                                vector<int>& indexes, int part1, int part2,
+		                                int octaveadjust);
+		void      printModuleCodes     (ostream& out, const vector<int>& codes,
+		                                int steps,
+		                                vector<vector<NoteNode> >* notes = NULL,
+		                                vector<int>* indexes = NULL,
+		                                int part1 = 0, int part2 = 0);
+		void      countModules         (HumdrumFile& infile);
+		void      printModuleCounts    (void);
 		void      addMarksToInputData  (HumdrumFile& infile,
 		                                vector<vector<NoteNode> >& notes,
 		                                vector<int>& ktracks,
@@ -5142,6 +6718,21 @@ class Tool_cint : public HumTool {
 		string    SearchString;
 		string Spacer;
 
+		// m_pairthreads: number of threads for calculating the modules of
+		// each pair of parts (--pair-threads).
+		int m_pairthreads = 1;
+
+		// m_moduletexts: modules calculated by prepareModuleBlock() for
+		// each pair of parts, for the note indexes from m_blockstart to
+		// m_blockend-1.
+		vector<vector<CintModuleText>> m_moduletexts;
+		int m_blockstart = -1;
+		int m_blockend = -1;
+
+		// m_modulecounts: number of times each module occurs, for
+		// --module-count.
+		std::unordered_map<pair<vector<int>, int>, int, CintModuleHash> m_modulecounts;
+
 };
 
 
@@ -5552,10 +7143,18 @@ class Tool_filter : public HumTool {
 		void     initialize         (HumdrumFile& infile);
 		void     removeGlobalFilterLines    (HumdrumFile& infile);
 		void     removeUniversalFilterLines (HumdrumFileSet& infiles);
+		void     updateFromToolOutput(HumdrumFile& infile, const string& text);
+		bool     updateLineFromText (HumdrumLine& line, const char* text,
+		                             int length);
+		bool     isAnalyzedToken    (HumdrumLine& line, HTp token, int field);
+		string   getSlurMarkers     (const string& text);
+		void     clearAutoParameters(HumdrumFile& infile);
 
 	private:
 		string   m_variant;        // used with -v option.
 		bool     m_debugQ = false; // used with --debug option
+		bool     m_reparseQ = false; // used with --reparse option
+		bool     m_rewrittenQ = false; // tokens updated in place from tool output
 
 };
 
@@ -5669,6 +7268,10 @@ class TimePoint {
 		// timestamp :: The duration from the start of the score to given time in score.
 		HumNum timestamp = -1;
 
+		// ticks :: The timestamp in ticks, using a timebase which is common
+		// to all files being compared.
+		long long ticks = -1;
+
 		// measure :: The measure number in which the timestamp occurs.
 		int measure = -1;
 
@@ -5676,6 +7279,7 @@ class TimePoint {
 			file.clear();
 			index.clear();
 			timestamp = -1;
+			ticks = -1;
 			measure = -1;
 		}
 };
@@ -5731,10 +7335,12 @@ class Tool_humdiff : public HumTool {
 		void     processFile        (HumdrumFile& infile1, HumdrumFile& infile2);
 
 		void     compareFiles       (HumdrumFileSet& humset);
+		bool     setCommonTicks     (vector<vector<TimePoint>>& timepoints, vector<int>& tpqs);
+		void     setTimestampTicks  (vector<vector<TimePoint>>& timepoints);
 		ostream& compareTimePoints  (ostream& out, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset);
 		void     extractTimePoints  (vector<TimePoint>& points, HumdrumFile& infile);
 		ostream& printTimePoints    (ostream& out, vector<TimePoint>& timepoints);
-		void     compareLines       (HumNum minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset);
+		void     compareLines       (long long minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset);
 		void     getNoteList        (vector<NotePoint>& notelist, HumdrumFile& infile, int line, int measure, int sourceindex, int tpindex);
 		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps);
 		void     printNotePoints    (vector<NotePoint>& notelist);
@@ -5802,6 +7408,46 @@ class Tool_humsort : public HumTool {
 };
 
 
+//
+// ImitationIndex -- Lookup tables for the note sequence of a voice, used
+//    to find the starting notes in the voice which could match a sequence
+//    in another voice.  Each note is given a key made from its interval
+//    to the next note (and its duration), and each run of notes long
+//    enough for a match is given a hash of its keys.
+//
+
+class ImitationIndex {
+	public:
+		void clear(void) {
+			keys.clear();
+			hashes.clear();
+			firsts.clear();
+			runs.clear();
+			lastsync.clear();
+		}
+
+		// keys: key of each note attack (intervals and durations which
+		// match have the same key).
+		std::vector<unsigned long long> keys;
+
+		// hashes: hash of the keys in the run of notes starting at
+		// each note attack (0 if the run extends past the end).
+		std::vector<unsigned long long> hashes;
+
+		// firsts: sorted list of the note attacks with a given key.
+		std::unordered_map<unsigned long long, std::vector<int>> firsts;
+
+		// runs: sorted list of the note attacks with a given run hash.
+		std::unordered_map<unsigned long long, std::vector<int>> runs;
+
+		// lastsync: for each entry in a firsts list, the index of the
+		// last entry at or before it which is at least a run length
+		// after the previous entry.
+		std::unordered_map<unsigned long long, std::vector<int>> lastsync;
+};
+
+
+
 class Tool_imitation : public HumTool {
 	public:
 		         Tool_imitation    (void);
@@ -5821,6 +7467,17 @@ class Tool_imitation : public HumTool {
 		                            vector<vector<NoteCell*>>& attacks,
 		                            vector<vector<double>>& intervals,
 		                            int v1, int v2);
+		void    buildIndex         (ImitationIndex& index,
+		                            vector<NoteCell*>& attacks,
+		                            vector<double>& intervals, bool target);
+		int     getMatchCount      (vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals,
+		                            vector<int>& enum1, vector<int>& enum2,
+		                            int v1, int v2, int i, int j);
+		int     getNextCandidate   (vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals,
+		                            vector<int>& enum1, vector<int>& enum2,
+		                            int v1, int v2, int i, int j);
 		void    getIntervals       (vector<double>& intervals,
 		                            vector<NoteCell*>& attacks);
 		int     compareSequences   (vector<NoteCell*>& attack1, vector<double>& seq1,
@@ -5867,6 +7524,15 @@ class Tool_imitation : public HumTool {
 		bool m_retrograde = false;
 
 		vector<int> m_barlines;
+
+		// m_indexQ: only compare note sequences which start with the same
+		// run of intervals (and durations) rather than all pairs of notes.
+		bool m_indexQ = true;
+
+		// m_sources, m_targets: index of each voice as the first/second
+		// voice of a voice pair.
+		vector<ImitationIndex> m_sources;
+		vector<ImitationIndex> m_targets;
 };
 
 
@@ -6296,7 +7962,7 @@ class MSearchTextQuery {
 			link = false;
 		}
 		string word;
-		bool link = false;
+		bool link = false;  // word follows the previous word in a "phrase"
 };
 
 
@@ -6330,6 +7996,154 @@ class TextInfo {
 };
 
 
+//
+// MSearchIndex -- n-gram index of the melodies in a corpus, used by
+//    msearch to find the files which could match a query without reading
+//    every file.  For every voice of every file, n-grams are made from the
+//    note (and rest) attacks of the NoteGrid for four features: diatonic
+//    pitch class, base-40 (chromatic) pitch class, interval direction from
+//    the previous note, and duration.  Each n-gram has a posting list of
+//    the file, voice and slice at which it starts.  The lyrics of each
+//    file are also indexed: every word (with its syllables joined, as for
+//    msearch -t) has a posting list of the file, track, line and word
+//    number at which it occurs.  See tool-msearch-index.cpp for the file
+//    format.
+//
+
+class MSearchIndexPosting {
+	public:
+		int file;   // index of the file in the index.
+		int voice;  // voice index in the file's NoteGrid.
+		int slice;  // slice index of the first note of the n-gram.
+};
+
+
+class MSearchIndexWordPosting {
+	public:
+		int file;   // index of the file in the index.
+		int track;  // track of the **text or **silbe spine.
+		int line;   // line index of the first syllable of the word.
+		int word;   // index of the word in the file's list of words.
+};
+
+
+class MSearchIndex {
+	public:
+		              MSearchIndex      (void);
+		             ~MSearchIndex      ();
+
+		void          clear             (void);
+		void          setGramLength     (int length);
+		int           getGramLength     (void) const;
+
+		int           addSource         (const string& segmentindex);
+		int           addFile           (const string& name, int source,
+		                                 int segment, NoteGrid& grid);
+		bool          write             (const string& filename);
+		bool          write             (ostream& out);
+		bool          read              (const string& filename);
+
+		int           getFileCount      (void) const;
+		string        getFileName       (int index) const;
+		int           getFileSource     (int index) const;
+		int           getFileSegment    (int index) const;
+		int           getSourceCount    (void) const;
+		string        getSourceIndex    (int source) const;
+		void          getPostings       (vector<MSearchIndexPosting>& postings,
+		                                 unsigned long long key);
+		bool          getCandidates     (vector<int>& files,
+		                                 vector<MSearchQueryToken>& query);
+		void          getQueryKeys      (vector<unsigned long long>& keys,
+		                                 vector<MSearchQueryToken>& query);
+
+		void          addWords          (int file, vector<TextInfo*>& words);
+		int           getWordCount      (void);
+		void          getTextMatches    (vector<MSearchIndexWordPosting>& matches,
+		                                 vector<MSearchTextQuery>& query);
+		void          getTextCandidates (vector<int>& files,
+		                                 vector<MSearchTextQuery>& query);
+
+	protected:
+		// Feature types of n-grams:
+		enum {
+			GRAM_DIATONIC  = 'd',  // diatonic pitch class (7 = rest)
+			GRAM_CHROMATIC = 'c',  // base-40 pitch class (40 = rest)
+			GRAM_INTERVAL  = 'i',  // direction from previous note
+			GRAM_RHYTHM    = 'r'   // duration
+		};
+
+		// Interval direction symbols:
+		enum {
+			GRAM_UP = 1,
+			GRAM_DOWN = 2,
+			GRAM_SAME = 3,
+			GRAM_NONE = 4   // one of the notes is a rest
+		};
+
+		void          addGrams          (int type, vector<int>& symbols,
+		                                 vector<int>& symbols2, int start,
+		                                 vector<NoteCell*>& attacks, int file,
+		                                 int voice);
+		void          addQueryGrams     (vector<unsigned long long>& keys,
+		                                 int type, vector<int>& symbols,
+		                                 vector<int>& symbols2);
+		unsigned long long makeKey      (int type, vector<int>& symbols,
+		                                 vector<int>& symbols2, int start);
+		string        normalizeWord     (const string& word);
+		void          sortWords         (void);
+		void          getMatchingWords  (vector<int>& indexes,
+		                                 const string& term);
+		void          getTermPostings   (vector<MSearchIndexWordPosting>& postings,
+		                                 const string& term);
+		void          getWordPostings   (vector<MSearchIndexWordPosting>& postings,
+		                                 int index);
+
+	private:
+		// m_length: number of notes (or intervals) in an n-gram.
+		int m_length = 4;
+
+		// m_files: name of each file in the index.
+		vector<string> m_files;
+
+		// m_filesources, m_filesegments: the source file of each file in
+		// the index, and the segment number of the file in the source.
+		vector<int> m_filesources;
+		vector<int> m_filesegments;
+
+		// m_sources: segment index of each source file, as written by
+		// HumdrumFileStream::writeSegmentIndex() (which includes the
+		// absolute path of the source file).
+		vector<string> m_sources;
+
+		// m_postings: posting lists for each n-gram key, while building
+		// the index.
+		std::unordered_map<unsigned long long,
+				vector<MSearchIndexPosting>> m_postings;
+
+		// m_keys, m_offsets, m_counts: sorted n-gram keys of an index read
+		// from a file, with the location and size of their posting lists.
+		vector<unsigned long long> m_keys;
+		vector<long long> m_offsets;
+		vector<int> m_counts;
+
+		// m_wordpostings: posting lists for each normalized word, while
+		// building the index.
+		std::unordered_map<string, vector<MSearchIndexWordPosting>> m_wordpostings;
+
+		// m_words, m_wordoffsets, m_wordcounts: sorted list of normalized
+		// words, with the location and size of their posting lists.
+		vector<string> m_words;
+		vector<long long> m_wordoffsets;
+		vector<int> m_wordcounts;
+
+		// m_input: index file from which posting lists are read.
+		std::ifstream m_input;
+		long long m_postingstart = 0;
+		long long m_wordpostingstart = 0;
+};
+
+
+
 class Tool_msearch : public HumTool {
 	public:
 		         Tool_msearch      (void);
@@ -6339,8 +8153,13 @@ class Tool_msearch : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     run               (HumdrumFileStream& instream);
+		bool     hasIndexMode      (void);
 
 	protected:
+		bool    buildIndex         (HumdrumFileStream& instream);
+		bool    addIndexSource     (MSearchIndex& index, const string& filename);
+		bool    searchIndex        (void);
 		void    initialize         (void);
 		void    doMusicSearch      (HumdrumFile& infile, NoteGrid& grid,
 		                            vector<MSearchQueryToken>& query);
@@ -6365,6 +8184,9 @@ class Tool_msearch : public HumTool {
 	 	vector<HTp> m_kernspines;
 		string      m_text;
 		string      m_marker;
+
+		// m_matchcount: number of matches found by the last search.
+		int         m_matchcount = 0;
 };
 
 
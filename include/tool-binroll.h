@@ -37,9 +37,11 @@ class Tool_binroll : public HumTool {
 		                            HTp ending);
 		void     printAnalysis     (HumdrumFile& infile,
 		                            vector<vector<char>>& roll);
+		int      getSlotIndex      (long long ticks);
 
 	private:
 		HumNum    m_duration;
+		int       m_tpq = 1;
 
 };
 
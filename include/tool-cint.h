@@ -19,8 +19,10 @@
 #include "NoteGrid.h"
 #include "HumRegex.h"
 
-#include <vector>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace hum {
 
@@ -58,6 +60,41 @@ class NoteNode {
 
 
 
+//
+// CintModuleHash -- Hash function for counting modules, which are stored
+//    as a list of interval codes (see Tool_cint::getIntervalCode) and the
+//    number of sonorities in the module.
+//
+
+class CintModuleHash {
+	public:
+		size_t operator()(const pair<vector<int>, int>& module) const {
+			size_t hash = (size_t)module.second;
+			for (int code : module.first) {
+				hash ^= (size_t)code + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			}
+			return hash;
+		}
+};
+
+
+
+//
+// CintModuleText -- Output of a counterpoint module which has been
+//    calculated ahead of printing (--pair-threads).
+//
+
+class CintModuleText {
+	public:
+		string      text;            // printed module text.
+		int         count = 0;       // number of search matches.
+		vector<int> marks;           // note indexes to mark for a match.
+		int         retroline = -1;  // retrospective row, or -1 if none.
+		string      retrotext;       // retrospective entry.
+};
+
+
+
 class Tool_cint : public HumTool {
 	public:
 		         Tool_cint    (void);
@@ -67,6 +104,8 @@ class Tool_cint : public HumTool {
 		bool     run                    (HumdrumFile& infile);
 		bool     run                    (const string& indata, ostream& out);
 		bool     run                    (HumdrumFile& infile, ostream& out);
+		bool     run                    (HumdrumFileStream& instream);
+		bool     hasModuleCountMode     (void);
 
 	protected:
 
@@ -100,6 +139,9 @@ class Tool_cint : public HumTool {
 		void      printSpacer          (ostream& out);
 		int       printInterval        (ostream& out, NoteNode& note1, NoteNode& note2,
 		                                int type, int octaveadjust = 0);
+		int       getIntervalCode      (NoteNode& note1, NoteNode& note2,
+		                                int type, int octaveadjust = 0);
+		void      printIntervalCode    (ostream& out, int code);
 		int       printLatticeItem     (vector<vector<NoteNode> >& notes, int n,
 		                                int currentindex, int fileline);
 		int       printLatticeItemRows (vector<vector<NoteNode> >& notes, int n,
@@ -144,9 +186,31 @@ class Tool_cint : public HumTool {
 		                                vector<vector<NoteNode> >& notes, int n,
 		                                int startline, int part1, int part2,
 		                                vector<vector<string> >& retrospective,
-		                                HumdrumFile& infile, const string& searchstring);
+		                                HumdrumFile& infile, const string& searchstring,
+		                                CintModuleText* result = NULL);
+		void      prepareModuleBlock   (vector<vector<NoteNode> >& notes,
+		                                HumdrumFile& infile, int n, int start, int end,
+		                                vector<vector<string> >& retrospective,
+		                                const string& searchstring);
+		int       printPreparedModule  (ostream& out, vector<vector<NoteNode> >& notes,
+		                                int startline, int part1, int part2,
+		                                vector<vector<string> >& retrospective);
 		int       getOctaveAdjustForCombinationModule(vector<vector<NoteNode> >& notes,
 		                                int n, int startline, int part1, int part2);
+		int       getModuleIndexes     (vector<int>& indexes,
+		                                vector<vector<NoteNode> >& notes, int n,
+		                                int startline, int part1, int part2);
+		void      getModuleCodes       (vector<int>& codes,
+		                                vector<vector<NoteNode> >& notes,
+		                                vector<int>& indexes, int part1, int part2,
+		                                int octaveadjust);
+		void      printModuleCodes     (ostream& out, const vector<int>& codes,
+		                                int steps,
+		                                vector<vector<NoteNode> >* notes = NULL,
+		                                vector<int>* indexes = NULL,
+		                                int part1 = 0, int part2 = 0);
+		void      countModules         (HumdrumFile& infile);
+		void      printModuleCounts    (void);
 		void      addMarksToInputData  (HumdrumFile& infile,
 		                                vector<vector<NoteNode> >& notes,
 		                                vector<int>& ktracks,
@@ -206,6 +270,21 @@ class Tool_cint : public HumTool {
 		string    SearchString;
 		string Spacer;
 
+		// m_pairthreads: number of threads for calculating the modules of
+		// each pair of parts (--pair-threads).
+		int m_pairthreads = 1;
+
+		// m_moduletexts: modules calculated by prepareModuleBlock() for
+		// each pair of parts, for the note indexes from m_blockstart to
+		// m_blockend-1.
+		vector<vector<CintModuleText>> m_moduletexts;
+		int m_blockstart = -1;
+		int m_blockend = -1;
+
+		// m_modulecounts: number of times each module occurs, for
+		// --module-count.
+		std::unordered_map<pair<vector<int>, int>, int, CintModuleHash> m_modulecounts;
+
 };
 
 // END_MERGE
@@ -39,10 +39,18 @@ class Tool_filter : public HumTool {
 		void     initialize         (HumdrumFile& infile);
 		void     removeGlobalFilterLines    (HumdrumFile& infile);
 		void     removeUniversalFilterLines (HumdrumFileSet& infiles);
+		void     updateFromToolOutput(HumdrumFile& infile, const string& text);
+		bool     updateLineFromText (HumdrumLine& line, const char* text,
+		                             int length);
+		bool     isAnalyzedToken    (HumdrumLine& line, HTp token, int field);
+		string   getSlurMarkers     (const string& text);
+		void     clearAutoParameters(HumdrumFile& infile);
 
 	private:
 		string   m_variant;        // used with -v option.
 		bool     m_debugQ = false; // used with --debug option
+		bool     m_reparseQ = false; // used with --reparse option
+		bool     m_rewrittenQ = false; // tokens updated in place from tool output
 
 };
 
@@ -39,6 +39,10 @@ class TimePoint {
 		// timestamp :: The duration from the start of the score to given time in score.
 		HumNum timestamp = -1;
 
+		// ticks :: The timestamp in ticks, using a timebase which is common
+		// to all files being compared.
+		long long ticks = -1;
+
 		// measure :: The measure number in which the timestamp occurs.
 		int measure = -1;
 
@@ -46,6 +50,7 @@ class TimePoint {
 			file.clear();
 			index.clear();
 			timestamp = -1;
+			ticks = -1;
 			measure = -1;
 		}
 };
@@ -101,10 +106,12 @@ class Tool_humdiff : public HumTool {
 		void     processFile        (HumdrumFile& infile1, HumdrumFile& infile2);
 
 		void     compareFiles       (HumdrumFileSet& humset);
+		bool     setCommonTicks     (vector<vector<TimePoint>>& timepoints, vector<int>& tpqs);
+		void     setTimestampTicks  (vector<vector<TimePoint>>& timepoints);
 		ostream& compareTimePoints  (ostream& out, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset);
 		void     extractTimePoints  (vector<TimePoint>& points, HumdrumFile& infile);
 		ostream& printTimePoints    (ostream& out, vector<TimePoint>& timepoints);
-		void     compareLines       (HumNum minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset);
+		void     compareLines       (long long minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset);
 		void     getNoteList        (vector<NotePoint>& notelist, HumdrumFile& infile, int line, int measure, int sourceindex, int tpindex);
 		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps);
 		void     printNotePoints    (vector<NotePoint>& notelist);
@@ -17,10 +17,53 @@
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 
+#include <unordered_map>
+#include <vector>
+
 namespace hum {
 
 // START_MERGE
 
+//
+// ImitationIndex -- Lookup tables for the note sequence of a voice, used
+//    to find the starting notes in the voice which could match a sequence
+//    in another voice.  Each note is given a key made from its interval
+//    to the next note (and its duration), and each run of notes long
+//    enough for a match is given a hash of its keys.
+//
+
+class ImitationIndex {
+	public:
+		void clear(void) {
+			keys.clear();
+			hashes.clear();
+			firsts.clear();
+			runs.clear();
+			lastsync.clear();
+		}
+
+		// keys: key of each note attack (intervals and durations which
+		// match have the same key).
+		std::vector<unsigned long long> keys;
+
+		// hashes: hash of the keys in the run of notes starting at
+		// each note attack (0 if the run extends past the end).
+		std::vector<unsigned long long> hashes;
+
+		// firsts: sorted list of the note attacks with a given key.
+		std::unordered_map<unsigned long long, std::vector<int>> firsts;
+
+		// runs: sorted list of the note attacks with a given run hash.
+		std::unordered_map<unsigned long long, std::vector<int>> runs;
+
+		// lastsync: for each entry in a firsts list, the index of the
+		// last entry at or before it which is at least a run length
+		// after the previous entry.
+		std::unordered_map<unsigned long long, std::vector<int>> lastsync;
+};
+
+
+
 class Tool_imitation : public HumTool {
 	public:
 		         Tool_imitation    (void);
@@ -40,6 +83,17 @@ class Tool_imitation : public HumTool {
 		                            vector<vector<NoteCell*>>& attacks,
 		                            vector<vector<double>>& intervals,
 		                            int v1, int v2);
+		void    buildIndex         (ImitationIndex& index,
+		                            vector<NoteCell*>& attacks,
+		                            vector<double>& intervals, bool target);
+		int     getMatchCount      (vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals,
+		                            vector<int>& enum1, vector<int>& enum2,
+		                            int v1, int v2, int i, int j);
+		int     getNextCandidate   (vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals,
+		                            vector<int>& enum1, vector<int>& enum2,
+		                            int v1, int v2, int i, int j);
 		void    getIntervals       (vector<double>& intervals,
 		                            vector<NoteCell*>& attacks);
 		int     compareSequences   (vector<NoteCell*>& attack1, vector<double>& seq1,
@@ -86,6 +140,15 @@ class Tool_imitation : public HumTool {
 		bool m_retrograde = false;
 
 		vector<int> m_barlines;
+
+		// m_indexQ: only compare note sequences which start with the same
+		// run of intervals (and durations) rather than all pairs of notes.
+		bool m_indexQ = true;
+
+		// m_sources, m_targets: index of each voice as the first/second
+		// voice of a voice pair.
+		vector<ImitationIndex> m_sources;
+		vector<ImitationIndex> m_targets;
 };
 
 // END_MERGE
@@ -17,6 +17,10 @@
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
 namespace hum {
 
 // START_MERGE
@@ -86,7 +90,7 @@ class MSearchTextQuery {
 			link = false;
 		}
 		string word;
-		bool link = false;
+		bool link = false;  // word follows the previous word in a "phrase"
 };
 
 
@@ -120,6 +124,154 @@ class TextInfo {
 };
 
 
+//
+// MSearchIndex -- n-gram index of the melodies in a corpus, used by
+//    msearch to find the files which could match a query without reading
+//    every file.  For every voice of every file, n-grams are made from the
+//    note (and rest) attacks of the NoteGrid for four features: diatonic
+//    pitch class, base-40 (chromatic) pitch class, interval direction from
+//    the previous note, and duration.  Each n-gram has a posting list of
+//    the file, voice and slice at which it starts.  The lyrics of each
+//    file are also indexed: every word (with its syllables joined, as for
+//    msearch -t) has a posting list of the file, track, line and word
+//    number at which it occurs.  See tool-msearch-index.cpp for the file
+//    format.
+//
+
+class MSearchIndexPosting {
+	public:
+		int file;   // index of the file in the index.
+		int voice;  // voice index in the file's NoteGrid.
+		int slice;  // slice index of the first note of the n-gram.
+};
+
+
+class MSearchIndexWordPosting {
+	public:
+		int file;   // index of the file in the index.
+		int track;  // track of the **text or **silbe spine.
+		int line;   // line index of the first syllable of the word.
+		int word;   // index of the word in the file's list of words.
+};
+
+
+class MSearchIndex {
+	public:
+		              MSearchIndex      (void);
+		             ~MSearchIndex      ();
+
+		void          clear             (void);
+		void          setGramLength     (int length);
+		int           getGramLength     (void) const;
+
+		int           addSource         (const string& segmentindex);
+		int           addFile           (const string& name, int source,
+		                                 int segment, NoteGrid& grid);
+		bool          write             (const string& filename);
+		bool          write             (ostream& out);
+		bool          read              (const string& filename);
+
+		int           getFileCount      (void) const;
+		string        getFileName       (int index) const;
+		int           getFileSource     (int index) const;
+		int           getFileSegment    (int index) const;
+		int           getSourceCount    (void) const;
+		string        getSourceIndex    (int source) const;
+		void          getPostings       (vector<MSearchIndexPosting>& postings,
+		                                 unsigned long long key);
+		bool          getCandidates     (vector<int>& files,
+		                                 vector<MSearchQueryToken>& query);
+		void          getQueryKeys      (vector<unsigned long long>& keys,
+		                                 vector<MSearchQueryToken>& query);
+
+		void          addWords          (int file, vector<TextInfo*>& words);
+		int           getWordCount      (void);
+		void          getTextMatches    (vector<MSearchIndexWordPosting>& matches,
+		                                 vector<MSearchTextQuery>& query);
+		void          getTextCandidates (vector<int>& files,
+		                                 vector<MSearchTextQuery>& query);
+
+	protected:
+		// Feature types of n-grams:
+		enum {
+			GRAM_DIATONIC  = 'd',  // diatonic pitch class (7 = rest)
+			GRAM_CHROMATIC = 'c',  // base-40 pitch class (40 = rest)
+			GRAM_INTERVAL  = 'i',  // direction from previous note
+			GRAM_RHYTHM    = 'r'   // duration
+		};
+
+		// Interval direction symbols:
+		enum {
+			GRAM_UP = 1,
+			GRAM_DOWN = 2,
+			GRAM_SAME = 3,
+			GRAM_NONE = 4   // one of the notes is a rest
+		};
+
+		void          addGrams          (int type, vector<int>& symbols,
+		                                 vector<int>& symbols2, int start,
+		                                 vector<NoteCell*>& attacks, int file,
+		                                 int voice);
+		void          addQueryGrams     (vector<unsigned long long>& keys,
+		                                 int type, vector<int>& symbols,
+		                                 vector<int>& symbols2);
+		unsigned long long makeKey      (int type, vector<int>& symbols,
+		                                 vector<int>& symbols2, int start);
+		string        normalizeWord     (const string& word);
+		void          sortWords         (void);
+		void          getMatchingWords  (vector<int>& indexes,
+		                                 const string& term);
+		void          getTermPostings   (vector<MSearchIndexWordPosting>& postings,
+		                                 const string& term);
+		void          getWordPostings   (vector<MSearchIndexWordPosting>& postings,
+		                                 int index);
+
+	private:
+		// m_length: number of notes (or intervals) in an n-gram.
+		int m_length = 4;
+
+		// m_files: name of each file in the index.
+		vector<string> m_files;
+
+		// m_filesources, m_filesegments: the source file of each file in
+		// the index, and the segment number of the file in the source.
+		vector<int> m_filesources;
+		vector<int> m_filesegments;
+
+		// m_sources: segment index of each source file, as written by
+		// HumdrumFileStream::writeSegmentIndex() (which includes the
+		// absolute path of the source file).
+		vector<string> m_sources;
+
+		// m_postings: posting lists for each n-gram key, while building
+		// the index.
+		std::unordered_map<unsigned long long,
+				vector<MSearchIndexPosting>> m_postings;
+
+		// m_keys, m_offsets, m_counts: sorted n-gram keys of an index read
+		// from a file, with the location and size of their posting lists.
+		vector<unsigned long long> m_keys;
+		vector<long long> m_offsets;
+		vector<int> m_counts;
+
+		// m_wordpostings: posting lists for each normalized word, while
+		// building the index.
+		std::unordered_map<string, vector<MSearchIndexWordPosting>> m_wordpostings;
+
+		// m_words, m_wordoffsets, m_wordcounts: sorted list of normalized
+		// words, with the location and size of their posting lists.
+		vector<string> m_words;
+		vector<long long> m_wordoffsets;
+		vector<int> m_wordcounts;
+
+		// m_input: index file from which posting lists are read.
+		std::ifstream m_input;
+		long long m_postingstart = 0;
+		long long m_wordpostingstart = 0;
+};
+
+
+
 class Tool_msearch : public HumTool {
 	public:
 		         Tool_msearch      (void);
@@ -129,8 +281,13 @@ class Tool_msearch : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     run               (HumdrumFileStream& instream);
+		bool     hasIndexMode      (void);
 
 	protected:
+		bool    buildIndex         (HumdrumFileStream& instream);
+		bool    addIndexSource     (MSearchIndex& index, const string& filename);
+		bool    searchIndex        (void);
 		void    initialize         (void);
 		void    doMusicSearch      (HumdrumFile& infile, NoteGrid& grid,
 		                            vector<MSearchQueryToken>& query);
@@ -155,6 +312,9 @@ class Tool_msearch : public HumTool {
 	 	vector<HTp> m_kernspines;
 		string      m_text;
 		string      m_marker;
+
+		// m_matchcount: number of matches found by the last search.
+		int         m_matchcount = 0;
 };
 
 // END_MERGE
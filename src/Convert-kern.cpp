@@ -78,6 +78,18 @@ bool Convert::isKernSecondaryTiedNote(const string& kerndata) {
 	return false;
 }
 
+//
+// HTp version:
+//
+
+bool Convert::isKernSecondaryTiedNote(HTp token) {
+	unsigned int flags = token->getKernNoteFlags();
+	if (!(flags & KernNote::NOTE_PITCH)) {
+		return false;
+	}
+	return (flags & (KernNote::NOTE_TIE_CONTINUE | KernNote::NOTE_TIE_END)) != 0;
+}
+
 
 
 //////////////////////////////
@@ -101,6 +113,18 @@ bool Convert::isKernNoteAttack(const string& kerndata) {
 	return true;
 }
 
+//
+// HTp version:
+//
+
+bool Convert::isKernNoteAttack(HTp token) {
+	unsigned int flags = token->getKernNoteFlags();
+	if (!(flags & KernNote::NOTE_PITCH)) {
+		return false;
+	}
+	return (flags & (KernNote::NOTE_TIE_CONTINUE | KernNote::NOTE_TIE_END)) == 0;
+}
+
 
 
 //////////////////////////////
@@ -12,6 +12,7 @@
 
 #include "Convert.h"
 #include <cmath>
+#include <limits>
 
 using namespace std;
 
@@ -39,6 +40,36 @@ int Convert::getLcm(const vector<int>& numbers) {
 
 
 
+//////////////////////////////
+//
+// Convert::getLcm64 -- Return the Least Common Multiple of a list of
+//     positive numbers, calculated in 64-bit integers.  Returns 0 if a
+//     number is not positive or if the LCM does not fit in a long long.
+//
+
+long long Convert::getLcm64(const vector<int>& numbers) {
+	if (numbers.size() == 0) {
+		return 1;
+	}
+	if (numbers[0] <= 0) {
+		return 0;
+	}
+	long long output = numbers[0];
+	for (int i=1; i<(int)numbers.size(); i++) {
+		if (numbers[i] <= 0) {
+			return 0;
+		}
+		long long factor = numbers[i] / getGcd((int)(output % numbers[i]), numbers[i]);
+		if (output > std::numeric_limits<long long>::max() / factor) {
+			return 0;
+		}
+		output *= factor;
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // Convert::getGcd -- Return the Greatest Common Divisor of two numbers.
@@ -46,6 +46,15 @@ HumNum Convert::recipToDuration(string* recip, HumNum scale,
 }
 
 
+HumNum Convert::recipToDuration(const HumdrumToken* token, HumNum scale,
+		const string& separator) {
+	if (separator != " ") {
+		return Convert::recipToDuration(*token, scale, separator);
+	}
+	return token->getRecipDuration() * scale / 4;
+}
+
+
 HumNum Convert::recipToDuration(const string& recip, HumNum scale,
 		const string& separator) {
 	size_t loc;
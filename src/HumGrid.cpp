@@ -2084,7 +2084,7 @@ void HumGrid::extendDurationToken(int slicei, int parti, int staffi,
 		return;
 	}
 
-	HumNum tokendur = Convert::recipToDuration((string)*token);
+	HumNum tokendur = Convert::recipToDuration(token);
 	HumNum currts   = m_allslices.at(slicei)->getTimestamp();
 	HumNum nextts   = m_allslices.at(slicei+1)->getTimestamp();
 	HumNum slicedur = nextts - currts;
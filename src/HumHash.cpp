@@ -104,9 +104,12 @@
 #include "Convert.h"
 #include "HumdrumToken.h"
 
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 
 using namespace std;
 
@@ -131,6 +134,141 @@ HumParameter::HumParameter(const string& str) : string(str) {
 
 
 
+//////////////////////////////
+//
+// HumHashEntry::getText -- Return the value of the parameter as a string.
+//
+
+string HumHashEntry::getText(void) const {
+	switch (type) {
+		case TYPE_INT:
+			return to_string(number.getNumerator());
+		case TYPE_FRACTION: {
+			stringstream ss;
+			ss << number;
+			return ss.str();
+		}
+		case TYPE_HTP:
+			return "HT_" + to_string((long long)token);
+	}
+	return text;
+}
+
+
+
+//////////////////////////////
+//
+// HumHashIdTable -- Table of interned namespace and key strings which is
+//    shared by all HumHash objects.  The first three ids are reserved for
+//    "", "!" and "!!".
+//
+
+class HumHashIdTable {
+	public:
+		HumHashIdTable(void) {
+			names.push_back("");
+			names.push_back("!");
+			names.push_back("!!");
+			for (int i=0; i<(int)names.size(); i++) {
+				ids[names[i]] = i;
+			}
+		}
+		std::mutex                           lock;
+		std::unordered_map<std::string, int> ids;
+		vector<std::string>                  names;
+};
+
+static HumHashIdTable& getHumHashIdTable(void) {
+	static HumHashIdTable table;
+	return table;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getParameterId -- Return the interned id of a namespace or key
+//    string, adding the string to the table if it is not already in it.
+//    Ids are shared by all HumHash objects and are never removed, so they
+//    can be stored and used in place of the strings.  The empty string
+//    has id 0.
+//
+
+int HumHash::getParameterId(const string& name) {
+	if (name.empty()) {
+		return 0;
+	}
+	static thread_local std::unordered_map<std::string, int> cache;
+	auto it = cache.find(name);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	HumHashIdTable& table = getHumHashIdTable();
+	int output;
+	{
+		std::lock_guard<std::mutex> guard(table.lock);
+		auto found = table.ids.find(name);
+		if (found == table.ids.end()) {
+			output = (int)table.names.size();
+			table.names.push_back(name);
+			table.ids[name] = output;
+		} else {
+			output = found->second;
+		}
+	}
+	cache[name] = output;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findParameterId -- Return the interned id of a namespace or key
+//    string, or -1 if no parameter has ever used the string.
+//
+
+int HumHash::findParameterId(const string& name) {
+	if (name.empty()) {
+		return 0;
+	}
+	static thread_local std::unordered_map<std::string, int> cache;
+	auto it = cache.find(name);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	HumHashIdTable& table = getHumHashIdTable();
+	int output;
+	{
+		std::lock_guard<std::mutex> guard(table.lock);
+		auto found = table.ids.find(name);
+		if (found == table.ids.end()) {
+			return -1;
+		}
+		output = found->second;
+	}
+	cache[name] = output;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getParameterName -- Return the string for an interned id.
+//
+
+string HumHash::getParameterName(int id) {
+	HumHashIdTable& table = getHumHashIdTable();
+	std::lock_guard<std::mutex> guard(table.lock);
+	if ((id < 0) || (id >= (int)table.names.size())) {
+		return "";
+	}
+	return table.names[id];
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::HumHash -- HumHash constructor.  The data storage is empty
@@ -139,6 +277,16 @@ HumParameter::HumParameter(const string& str) : string(str) {
 
 HumHash::HumHash(void) {
 	parameters = NULL;
+	prefix = 0;
+}
+
+
+HumHash::HumHash(const HumHash& hash) {
+	parameters = NULL;
+	prefix = hash.prefix;
+	if (hash.parameters != NULL) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	}
 }
 
 
@@ -158,6 +306,31 @@ HumHash::~HumHash() {
 
 
 
+//////////////////////////////
+//
+// HumHash::operator= -- Copy the parameters and prefix of another HumHash.
+//
+
+HumHash& HumHash::operator=(const HumHash& hash) {
+	if (this == &hash) {
+		return *this;
+	}
+	prefix = hash.prefix;
+	if (hash.parameters == NULL) {
+		if (parameters != NULL) {
+			delete parameters;
+			parameters = NULL;
+		}
+	} else if (parameters == NULL) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	} else {
+		*parameters = *hash.parameters;
+	}
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValue -- Returns the value specified by the given key.
@@ -198,23 +371,27 @@ string HumHash::getValue(const string& ns2, const string& key) const {
 
 string HumHash::getValue(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return "";
 	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return "";
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return "";
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	return entry->getText();
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getValue -- Version of getValue() which takes parameter ids (see
+//     getParameterId()) instead of strings.
+//
+
+string HumHash::getValue(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return "";
 	}
-	return it3->second;
+	return entry->getText();
 }
 
 
@@ -231,7 +408,7 @@ HTp HumHash::getValueHTp(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueHTp("", "", keys[2]);
+		return getValueHTp("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueHTp(keys[0], keys[1]);
 	} else {
@@ -250,10 +427,14 @@ HTp HumHash::getValueHTp(const string& ns2, const string& key) const {
 
 HTp HumHash::getValueHTp(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return NULL;
 	}
-	string value = getValue(ns1, ns2, key);
+	if (entry->type == HumHashEntry::TYPE_HTP) {
+		return entry->token;
+	}
+	string value = entry->getText();
 	if (value.find("HT_") != 0) {
 		return NULL;
 	} else {
@@ -270,6 +451,26 @@ HTp HumHash::getValueHTp(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::getValueHTp -- Version of getValueHTp() which takes parameter ids
+//     (see getParameterId()) instead of strings.
+//
+
+HTp HumHash::getValueHTp(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return NULL;
+	}
+	if (entry->type == HumHashEntry::TYPE_HTP) {
+		return entry->token;
+	}
+	return getValueHTp(getParameterName(ns1), getParameterName(ns2),
+			getParameterName(key));
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValueInt -- Return the value as an integer.  The value must
@@ -287,7 +488,7 @@ int HumHash::getValueInt(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueInt("", "", keys[2]);
+		return getValueInt("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueInt(keys[0], keys[1]);
 	} else {
@@ -306,10 +507,16 @@ int HumHash::getValueInt(const string& ns2, const string& key) const {
 
 int HumHash::getValueInt(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
+	if (entry->type == HumHashEntry::TYPE_INT) {
+		return entry->number.getNumerator();
+	} else if (entry->type == HumHashEntry::TYPE_FRACTION) {
+		return entry->number.getInteger();
+	}
+	string value = entry->getText();
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return  nvalue.getInteger();
@@ -332,6 +539,28 @@ int HumHash::getValueInt(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::getValueInt -- Version of getValueInt() which takes parameter ids
+//     (see getParameterId()) instead of strings.
+//
+
+int HumHash::getValueInt(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return 0;
+	}
+	if (entry->type == HumHashEntry::TYPE_INT) {
+		return entry->number.getNumerator();
+	} else if (entry->type == HumHashEntry::TYPE_FRACTION) {
+		return entry->number.getInteger();
+	}
+	return getValueInt(getParameterName(ns1), getParameterName(ns2),
+			getParameterName(key));
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValueFraction -- Return the value as a HumNum fraction.
@@ -365,11 +594,36 @@ HumNum HumHash::getValueFraction(const string& ns2, const string& key) const {
 
 HumNum HumHash::getValueFraction(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (!isDefined(ns1, ns2, key)) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
-	HumNum fractionvalue(value);
+	if ((entry->type == HumHashEntry::TYPE_INT) ||
+			(entry->type == HumHashEntry::TYPE_FRACTION)) {
+		return entry->number;
+	}
+	HumNum fractionvalue(entry->getText());
+	return fractionvalue;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getValueFraction -- Version of getValueFraction() which takes
+//     parameter ids (see getParameterId()) instead of strings.
+//
+
+HumNum HumHash::getValueFraction(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return 0;
+	}
+	if ((entry->type == HumHashEntry::TYPE_INT) ||
+			(entry->type == HumHashEntry::TYPE_FRACTION)) {
+		return entry->number;
+	}
+	HumNum fractionvalue(entry->getText());
 	return fractionvalue;
 }
 
@@ -392,7 +646,7 @@ double HumHash::getValueFloat(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueFloat("", "", keys[2]);
+		return getValueFloat("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueFloat(keys[0], keys[1]);
 	} else {
@@ -405,7 +659,7 @@ double HumHash::getValueFloat(const string& ns2, const string& key) const {
 	if (parameters == NULL) {
 		return 0.0;
 	}
-	return getValueInt("", ns2, key);
+	return getValueFloat("", ns2, key);
 }
 
 
@@ -414,7 +668,16 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return 0.0;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry != NULL) {
+		if ((entry->type == HumHashEntry::TYPE_INT) ||
+				(entry->type == HumHashEntry::TYPE_FRACTION)) {
+			return entry->number.getFloat();
+		} else if (entry->type == HumHashEntry::TYPE_FLOAT) {
+			return entry->real;
+		}
+	}
+	string value = entry ? entry->getText() : "";
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return nvalue.getFloat();
@@ -432,6 +695,30 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::getValueFloat -- Version of getValueFloat() which takes parameter
+//     ids (see getParameterId()) instead of strings.
+//
+
+double HumHash::getValueFloat(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return getValueFloat(getParameterName(ns1), getParameterName(ns2),
+				getParameterName(key));
+	}
+	if ((entry->type == HumHashEntry::TYPE_INT) ||
+			(entry->type == HumHashEntry::TYPE_FRACTION)) {
+		return entry->number.getFloat();
+	} else if (entry->type == HumHashEntry::TYPE_FLOAT) {
+		return entry->real;
+	}
+	return getValueFloat(getParameterName(ns1), getParameterName(ns2),
+			getParameterName(key));
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValueBool -- Return true or false based on the
@@ -446,7 +733,7 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 bool HumHash::getValueBool(const string& key) const {
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueBool("", "", keys[2]);
+		return getValueBool("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueBool(keys[0], keys[1]);
 	} else {
@@ -462,15 +749,33 @@ bool HumHash::getValueBool(const string& ns2, const string& key) const {
 
 bool HumHash::getValueBool(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	return getValueBool(findParameterId(ns1), findParameterId(ns2),
+			findParameterId(key));
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getValueBool -- Version of getValueBool() which takes parameter ids
+//     (see getParameterId()) instead of strings.
+//
+
+bool HumHash::getValueBool(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return false;
 	}
-	if (!isDefined(ns1, ns2, key)) {
-		return false;
+	switch (entry->type) {
+		case HumHashEntry::TYPE_INT:
+		case HumHashEntry::TYPE_FRACTION:
+			return entry->number != 0;
+		case HumHashEntry::TYPE_HTP:
+			return true;
 	}
-	if ((*parameters)[ns1][ns2][key] == "false") {
+	if (entry->text == "false") {
 		return false;
-	} else if ((*parameters)[ns1][ns2][key] == "0") {
+	} else if (entry->text == "0") {
 		return false;
 	} else {
 		return true;
@@ -486,9 +791,9 @@ bool HumHash::getValueBool(const string& ns1, const string& ns2,
 //     value is any arbitrary string, but preferably does not
 //     include tabs or colons.  If a colon is needed, then specify
 //     as "&colon;" without the quotes.  Values such as integers
-//     fractions and floats can be specified, and these wil be converted
-//     internally into strings (use getValueInt() or getValueFloat()
-//     to recover the original type).
+//     fractions and tokens are stored without conversion to text (use
+//     getValueInt(), getValueFraction() or getValueHTp() to recover the
+//     original type), and floats are converted into strings.
 //
 
 void HumHash::setValue(const string& key, const string& value) {
@@ -511,8 +816,8 @@ void HumHash::setValue(const string& ns2, const string& key,
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, const string& value) {
-	initializeParameters();
-	(*parameters)[ns1][ns2][key] = value;
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -552,10 +857,8 @@ void HumHash::setValue(const string& ns2, const string& key, int value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, int value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -578,10 +881,8 @@ void HumHash::setValue(const string& ns2, const string& key, HTp value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HTp value) {
-	initializeParameters();
-	stringstream ss;
-	ss << "HT_" << ((long long)value);
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -604,10 +905,8 @@ void HumHash::setValue(const string& ns2, const string& key, HumNum value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HumNum value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -630,34 +929,8 @@ void HumHash::setValue(const string& ns2, const string& key, double value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, double value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
-}
-
-
-
-//////////////////////////////
-//
-// HumHash::getKeys -- Return a list of keys in a particular namespace
-//     combination.  With no parameters, a complete list of all
-//     namespaces/keys will be returned.  Giving one parameter will
-//     produce a list will give all NS2:key values in the NS1 namespace.
-//     If there is a colon in the single parameter version of the function,
-//     then this will be interpreted as "NS1", "NS2" version of the parameters
-//     described above.
-//
-
-vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
-	vector<string> output;
-	if (parameters == NULL) {
-		return output;
-	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output.push_back(it.first);
-	}
-	return output;
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -673,11 +946,17 @@ vector<string> HumHash::getKeys(const string& ns) const {
 		return getKeys(ns1, ns2);
 	}
 
-	for (auto& it1 : (*parameters)[ns]) {
-		for (auto& it2 : it1.second) {
-			output.push_back(it1.first + ":" + it2.first);
+	int id1 = findParameterId(ns);
+	vector<pair<string, string>> keys;
+	for (auto& entry : *parameters) {
+		if (entry.ns1 == id1) {
+			keys.emplace_back(getParameterName(entry.ns2), getParameterName(entry.key));
 		}
 	}
+	std::sort(keys.begin(), keys.end());
+	for (auto& key : keys) {
+		output.push_back(key.first + ":" + key.second);
+	}
 	return output;
 }
 
@@ -687,9 +966,11 @@ vector<string> HumHash::getKeys(void) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it1 : (*parameters)) {
+	MapNNKV sorted;
+	getSortedParameters(sorted);
+	for (auto& it1 : sorted) {
 		for (auto& it2 : it1.second) {
-			for (auto it3 : it2.second) {
+			for (auto& it3 : it2.second) {
 				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
 			}
 		}
@@ -699,6 +980,87 @@ vector<string> HumHash::getKeys(void) const {
 
 
 
+//////////////////////////////
+//
+// HumHash::setValue -- Versions of setValue() which take parameter ids (see
+//     getParameterId()) instead of strings.  The string versions store
+//     their values through these functions.
+//
+
+void HumHash::setValue(int ns1, int ns2, int key, const string& value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_STRING;
+	entry.text = value;
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, int value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_INT;
+	entry.number = value;
+	entry.text.clear();
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, HTp value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_HTP;
+	entry.token = value;
+	entry.text.clear();
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, HumNum value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_FRACTION;
+	entry.number = value;
+	entry.text.clear();
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, double value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_FLOAT;
+	stringstream ss;
+	ss << value;
+	entry.text = ss.str();
+	// Store the value of the printed form, so that getValueFloat() returns
+	// the same value as a parameter read from text:
+	entry.real = value;
+	ss >> entry.real;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getKeys -- Return a list of keys in a particular namespace
+//     combination.  With no parameters, a complete list of all
+//     namespaces/keys will be returned.  Giving one parameter will
+//     produce a list will give all NS2:key values in the NS1 namespace.
+//     If there is a colon in the single parameter version of the function,
+//     then this will be interpreted as "NS1", "NS2" version of the parameters
+//     described above.
+//
+
+vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
+	vector<string> output;
+	if (parameters == NULL) {
+		return output;
+	}
+	int id1 = findParameterId(ns1);
+	int id2 = findParameterId(ns2);
+	for (auto& entry : *parameters) {
+		if ((entry.ns1 == id1) && (entry.ns2 == id2)) {
+			output.push_back(getParameterName(entry.key));
+		}
+	}
+	std::sort(output.begin(), output.end());
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::hasParameters -- Returns true if at least one parameter is defined
@@ -710,42 +1072,12 @@ vector<string> HumHash::getKeys(void) const {
 //
 
 bool HumHash::hasParameters(const string& ns1, const string& ns2) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	auto it2 = (*parameters)[ns1].find(ns2);
-	if (it2 == (*parameters)[ns1].end()) {
-		return false;
-	} else {
-		return true;
-	}
+	return getParameterCount(ns1, ns2) > 0;
 }
 
 
 bool HumHash::hasParameters(const string& ns) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	auto loc = ns.find(":");
-	if (loc != string::npos) {
-		string ns1 = ns.substr(0, loc);
-		string ns2 = ns.substr(loc+1);
-		return hasParameters(ns1, ns2);
-	}
-
-	auto it = parameters->find(ns);
-	if (it == parameters->end()) {
-		return false;
-	} else {
-		return true;
-	}
+	return getParameterCount(ns) > 0;
 }
 
 
@@ -753,19 +1085,7 @@ bool HumHash::hasParameters(void) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	for (auto& it1 : *parameters) {
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			} else {
-				return true;
-			}
-		}
-	}
-	return false;
+	return !parameters->empty();
 }
 
 
@@ -785,24 +1105,24 @@ int HumHash::getParameterCount(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
+	int id1 = findParameterId(ns1);
+	int id2 = findParameterId(ns2);
+	if ((id1 < 0) || (id2 < 0)) {
 		return 0;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return 0;
+	int sum = 0;
+	for (auto& entry : *parameters) {
+		if ((entry.ns1 == id1) && (entry.ns2 == id2)) {
+			sum++;
+		}
 	}
-	return (int)it2->second.size();
+	return sum;
 }
 
 
 int HumHash::getParameterCount(const string& ns) const {
 	if (parameters == NULL) {
-		return false;
+		return 0;
 	}
 	auto loc = ns.find(":");
 	if (loc != string::npos) {
@@ -811,13 +1131,15 @@ int HumHash::getParameterCount(const string& ns) const {
 		return getParameterCount(ns1, ns2);
 	}
 
-	auto it1 = parameters->find(ns);
-	if (it1 == parameters->end()) {
-		return false;
+	int id1 = findParameterId(ns);
+	if (id1 < 0) {
+		return 0;
 	}
 	int sum = 0;
-	for (auto& it2 : it1->second) {
-		sum += (int)it2.second.size();
+	for (auto& entry : *parameters) {
+		if (entry.ns1 == id1) {
+			sum++;
+		}
 	}
 	return sum;
 }
@@ -827,16 +1149,7 @@ int HumHash::getParameterCount(void) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	int sum = 0;
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			sum += (int)it2.second.size();
-		}
-	}
-	return sum;
+	return (int)parameters->size();
 }
 
 
@@ -855,29 +1168,35 @@ bool HumHash::isDefined(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return (*parameters)[""][""].count(keys[0]) ? true : false;
+		return isDefined("", "", keys[0]);
 	} else if (keys.size() == 2) {
-		return (*parameters)[""][keys[0]].count(keys[1]) ? true : false;
+		return isDefined("", keys[0], keys[1]);
 	} else {
-		return (*parameters)[keys[0]][keys[1]].count(keys[2]) ? true : false;
+		return isDefined(keys[0], keys[1], keys[2]);
 	}
 }
 
 
 bool HumHash::isDefined(const string& ns2, const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[""][ns2].count(key) ? true : false;
+	return isDefined("", ns2, key);
 }
 
 
 bool HumHash::isDefined(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[ns1][ns2].count(key) ? true : false;
+	return findEntry(ns1, ns2, key) != NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::isDefined -- Version of isDefined() which takes parameter ids (see
+//     getParameterId()) instead of strings.
+//
+
+bool HumHash::isDefined(int ns1, int ns2, int key) const {
+	return findEntry(ns1, ns2, key) != NULL;
 }
 
 
@@ -914,38 +1233,135 @@ void HumHash::deleteValue(const string& ns2, const string& key) {
 
 void HumHash::deleteValue(const string& ns1, const string& ns2,
 		const string& key) {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return;
 	}
-	(*parameters)[ns1][ns2].erase(key);
+	parameters->erase(parameters->begin() + (entry - parameters->data()));
+}
+
+
 
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
+//////////////////////////////
+//
+// HumHash::deleteValues -- Delete all parameters in the given namespace
+//   combination (such as "" and "auto" for values which are calculated
+//   by content analyses).
+//
+
+void HumHash::deleteValues(const string& ns1, const string& ns2) {
+	if ((parameters == NULL) || parameters->empty()) {
 		return;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return;
+	int id1 = findParameterId(ns1);
+	int id2 = findParameterId(ns2);
+	parameters->erase(std::remove_if(parameters->begin(), parameters->end(),
+			[id1, id2](const HumHashEntry& entry) {
+				return (entry.ns1 == id1) && (entry.ns2 == id2);
+			}), parameters->end());
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::initializeParameters -- Create the parameter list if it does
+//     not already exist.
+//
+
+void HumHash::initializeParameters(void) {
+	if (parameters == NULL) {
+		parameters = new vector<HumHashEntry>;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findEntry -- Return the storage for a parameter, or NULL if
+//     the parameter is not defined.
+//
+
+HumHashEntry* HumHash::findEntry(int ns1, int ns2, int key) const {
+	if (parameters == NULL) {
+		return NULL;
 	}
-	it2->second.erase(key);
+	for (auto& entry : *parameters) {
+		if ((entry.key == key) && (entry.ns2 == ns2) && (entry.ns1 == ns1)) {
+			return &entry;
+		}
+	}
+	return NULL;
+}
+
+
+HumHashEntry* HumHash::findEntry(const string& ns1, const string& ns2,
+		const string& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	int id1 = findParameterId(ns1);
+	if (id1 < 0) {
+		return NULL;
+	}
+	int id2 = findParameterId(ns2);
+	if (id2 < 0) {
+		return NULL;
+	}
+	int idk = findParameterId(key);
+	if (idk < 0) {
+		return NULL;
+	}
+	return findEntry(id1, id2, idk);
 }
 
 
 
 //////////////////////////////
 //
-// HumHash::initializeParameters -- Create the map structure if it does not
-//     already exist.
+// HumHash::insertEntry -- Return the storage for a parameter, adding it
+//     if it does not already exist.  The origin of an existing parameter
+//     is cleared since it is being given a new value.
 //
 
-void HumHash::initializeParameters(void) {
+HumHashEntry& HumHash::insertEntry(int ns1, int ns2, int key) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry != NULL) {
+		entry->origin = NULL;
+		return *entry;
+	}
+	initializeParameters();
+	parameters->resize(parameters->size() + 1);
+	HumHashEntry& output = parameters->back();
+	output.ns1    = ns1;
+	output.ns2    = ns2;
+	output.key    = key;
+	output.type   = HumHashEntry::TYPE_STRING;
+	output.token  = NULL;
+	output.real   = 0.0;
+	output.origin = NULL;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getSortedParameters -- Copy the parameters into a map sorted
+//     by namespaces and key, which is the order used when printing them.
+//
+
+void HumHash::getSortedParameters(MapNNKV& output) const {
+	output.clear();
 	if (parameters == NULL) {
-		parameters = new MapNNKV;
+		return;
+	}
+	for (auto& entry : *parameters) {
+		HumParameter& value = output[getParameterName(entry.ns1)]
+				[getParameterName(entry.ns2)][getParameterName(entry.key)];
+		value.assign(entry.getText());
+		value.origin = entry.origin;
 	}
 }
 
@@ -982,7 +1398,13 @@ vector<string> HumHash::getKeyList(const string& keys) const {
 //
 
 void HumHash::setPrefix(const string& value) {
-	prefix = value;
+	if (value == "!") {
+		prefix = 1;
+	} else if (value == "!!") {
+		prefix = 2;
+	} else {
+		prefix = getParameterId(value);
+	}
 }
 
 
@@ -993,7 +1415,12 @@ void HumHash::setPrefix(const string& value) {
 //
 
 string HumHash::getPrefix(void) const {
-	return prefix;
+	switch (prefix) {
+		case 0: return "";
+		case 1: return "!";
+		case 2: return "!!";
+	}
+	return getParameterName(prefix);
 }
 
 
@@ -1042,23 +1469,11 @@ void HumHash::setOrigin(const string& ns2, const string& key,
 
 void HumHash::setOrigin(const string& ns1, const string& ns2,
 		const string& key, HumdrumToken* tok) {
-	if (parameters == NULL) {
-		return;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
-	}
-	it3->second.origin = tok;
+	entry->origin = tok;
 }
 
 
@@ -1102,23 +1517,11 @@ HumdrumToken* HumHash::getOrigin(const string& ns2, const string& key) const {
 
 HumdrumToken* HumHash::getOrigin(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return NULL;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return NULL;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return NULL;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return NULL;
 	}
-	return it3->second.origin;
+	return entry->origin;
 }
 
 
@@ -1134,7 +1537,9 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 	if (parameters == NULL) {
 		return out;
 	}
-	if (parameters->size() == 0) {
+	MapNNKV sorted;
+	getSortedParameters(sorted);
+	if (sorted.size() == 0) {
 		return out;
 	}
 
@@ -1143,7 +1548,7 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : sorted) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -1200,7 +1605,9 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 	if (parameters == NULL) {
 		return out;
 	}
-	if (parameters->size() == 0) {
+	MapNNKV sorted;
+	getSortedParameters(sorted);
+	if (sorted.size() == 0) {
 		return out;
 	}
 
@@ -1213,7 +1620,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : sorted) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -1313,13 +1720,16 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 	if (hash.parameters == NULL) {
 		return out;
 	}
-	if (hash.parameters->size() == 0) {
+	MapNNKV sorted;
+	hash.getSortedParameters(sorted);
+	if (sorted.size() == 0) {
 		return out;
 	}
 
 	string cleaned;
+	string prefix = hash.getPrefix();
 
-	for (auto& it1 : *(hash.parameters)) {
+	for (auto& it1 : sorted) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -1327,7 +1737,7 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 			if (it2.second.size() == 0) {
 				continue;
 			}
-			out << hash.prefix;
+			out << prefix;
 			out << it1.first << ":" << it2.first;
 			for (auto& it3 : it2.second) {
 				out << ":" << it3.first;
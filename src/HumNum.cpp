@@ -26,20 +26,9 @@ namespace hum {
 //
 // HumNum::HumNum -- HumNum Constructor.  Set the default value
 //   of the number to zero, or the given number if specified.
+//   The default and integer constructors are defined in HumNum.h.
 //
 
-HumNum::HumNum(void){
-	top = 0;
-	bot = 1;
-}
-
-
-HumNum::HumNum(int value){
-	top = value;
-	bot = 1;
-}
-
-
 HumNum::HumNum(int numerator, int denominator){
 	setValue(numerator, denominator);
 }
@@ -55,100 +44,6 @@ HumNum::HumNum(const char* ratstring) {
 }
 
 
-HumNum::HumNum(const HumNum& rat) {
-	top = rat.top;
-	bot = rat.bot;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::~HumNum -- HumNum deconstructor.
-//
-
-HumNum::~HumNum() {
-	// do nothing
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNegative -- Returns true if value is negative.
-//
-
-bool HumNum::isNegative(void) const {
-	return isFinite() && (top < 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isPositive -- Returns true if value is positive.
-//
-
-bool HumNum::isPositive(void) const {
-	return isFinite() && (top > 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isZero -- Returns true if value is zero.
-//
-
-bool HumNum::isZero(void) const {
-	return isFinite() && (top == 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNonZero -- Returns true if value is not zero.
-//
-
-bool HumNum::isNonZero(void) const {
-	return isFinite() && (top != 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNonNegative -- Returns true if value is non-negative.
-//
-
-bool HumNum::isNonNegative(void) const {
-	return isFinite() && (top >= 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNonPositive -- Returns true if value is non-positive.
-//
-
-bool HumNum::isNonPositive(void) const {
-	return isFinite() && (top >= 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::getFloat -- Returns the floating-point equivalent of the
-//     rational number.
-//
-
-double HumNum::getFloat(void) const {
-	return (double)top/(double)bot;
-}
-
 
 
 //////////////////////////////
@@ -173,28 +68,6 @@ int HumNum::getInteger(double round) const {
 
 
 
-//////////////////////////////
-//
-// HumNum::getNumerator -- Returns the top integer in the fraction.
-//
-
-int HumNum::getNumerator(void) const {
-	return top;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::getDenominator -- Returns the bottom integer in the fraction.
-//
-
-int HumNum::getDenominator(void) const {
-	return bot;
-}
-
-
-
 //////////////////////////////
 //
 // HumNum::getRemainder -- Returns the non-integer fractional part of the value.
@@ -258,13 +131,12 @@ void HumNum::setValue(const char* ratstring) {
 
 //////////////////////////////
 //
-// HumNum::invert --
+// HumNum::invert -- Swap the numerator and denominator, keeping the
+//    sign in the numerator.
 //
 
 void HumNum::invert(void) {
-	int temp = top;
-	top = bot;
-	bot = temp;
+	setWide(bot, top);
 }
 
 
@@ -305,492 +177,246 @@ HumNum& HumNum::makeAbs(void) {
 //
 
 void HumNum::reduce(void) {
-	int a = getNumerator();
-	int b = getDenominator();
-	if (a == 1 || b == 1) {
-		return;
-	}
-	if (a == 0) {
-		bot = 1;
-		return;
-	}
-	if (b == 0) {
-		a = 0;
-		b = 0;
-	}
-	int gcdval = gcdIterative(a, b);
-	if (gcdval > 1) {
-		top /= gcdval;
-		bot /= gcdval;
-	}
+	setWide(top, bot);
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::gcdIterative -- Returns the greatest common divisor of two
-//      numbers using an iterative algorithm.
+// HumNum::setWide -- Reduce a fraction given as 64-bit integers and
+//    store it.  The sign of the fraction is placed in the numerator.
+//    0/0 is stored as 0, and other values with a zero denominator
+//    are stored unreduced (infinite values).
 //
 
-int HumNum::gcdIterative(int a, int b) {
-	int c;
-	while (b) {
-		c = a;
-		a = b;
-		b = c % b;
+void HumNum::setWide(long long numerator, long long denominator) {
+	if (numerator == 0) {
+		top = 0;
+		bot = 1;
+		return;
 	}
-	return a < 0 ? -a : a;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::gcdRecursive -- Returns the greatest common divisor of two
-//      numbers using a recursive algorithm.
-//
-
-int HumNum::gcdRecursive(int a, int b) {
-	if (a < 0) {
-		a = -a;
+	if (denominator == 0) {
+		if (numerator > 2147483647LL) {
+			numerator = 2147483647LL;
+		} else if (numerator < -2147483647LL) {
+			numerator = -2147483647LL;
+		}
+		top = (int)numerator;
+		bot = 0;
+		return;
 	}
-	if (!b) {
-		return a;
-	} else {
-		return gcdRecursive(b, a % b);
+	if (denominator < 0) {
+		numerator = -numerator;
+		denominator = -denominator;
 	}
+	if (denominator != 1) {
+		unsigned long long absnum = numerator < 0 ? -(unsigned long long)numerator
+				: (unsigned long long)numerator;
+		unsigned long long gcdval = gcdBinary(absnum, (unsigned long long)denominator);
+		if (gcdval > 1) {
+			numerator /= (long long)gcdval;
+			denominator /= (long long)gcdval;
+		}
+	}
+	setWideReduced(numerator, denominator);
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::isInfinite -- Returns true if the denominator is zero.
-//
-
-bool HumNum::isInfinite(void) const {
-	return (bot == 0) && (top != 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNaN -- Returns true if the numerator and denominator
-//     are both zero.
-//
-
-bool HumNum::isNaN(void) const {
-	return (bot == 0) && (top == 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isFinite -- Returns true if the denominator is not zero.
-//
-
-bool HumNum::isFinite(void) const {
-	return bot != 0;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isInteger -- Returns true if number is an integer.
+// HumNum::setOverflow -- Store a reduced fraction which does not fit
+//    into 32-bit integers.  The value is replaced by the last of its
+//    continued-fraction convergents which fits, or by +/-2147483647 if
+//    the value itself is too large.
+//    Each overflow is counted, and the count can be checked with
+//    getOverflowCount().
 //
 
-bool HumNum::isInteger(void) const {
-	return isFinite() && (bot == 1);
-}
-
+void HumNum::setOverflow(long long numerator, long long denominator) {
+	overflowCount()++;
+	const unsigned long long limit = 2147483647ULL;
+	int sign = numerator < 0 ? -1 : 1;
+	unsigned long long n = numerator < 0 ? -(unsigned long long)numerator
+			: (unsigned long long)numerator;
+	unsigned long long d = (unsigned long long)denominator;
 
-
-//////////////////////////////
-//
-// HumNum::isPowerOfTwo -- Returns true if a power of two.
-//
-
-bool HumNum::isPowerOfTwo(void) const {
-	if (top == 0) {
-		return false;
+	unsigned long long p0 = 0;
+	unsigned long long q0 = 1;
+	unsigned long long p1 = 1;
+	unsigned long long q1 = 0;
+	while (d != 0) {
+		unsigned long long a = n / d;
+		if (((p1 > 0) && (a > (limit - p0) / p1)) ||
+				((q1 > 0) && (a > (limit - q0) / q1))) {
+			break;
+		}
+		unsigned long long p2 = a * p1 + p0;
+		unsigned long long q2 = a * q1 + q0;
+		p0 = p1;
+		q0 = q1;
+		p1 = p2;
+		q1 = q2;
+		unsigned long long r = n - a * d;
+		n = d;
+		d = r;
 	}
-	int abstop = top > 0 ? top : -top;
-	if (bot == 1) {
-		return !(abstop & (abstop - 1));
-	} else if (abstop == 1) {
-		return !(bot & (bot - 1));
+	if (q1 == 0) {
+		top = sign * (int)limit;
+		bot = 1;
+	} else {
+		top = sign * (int)p1;
+		bot = (int)q1;
 	}
-	return false;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator+ -- Addition operator which adds HumNum
-//    to another HumNum or with a integers.
-//
-
-HumNum HumNum::operator+(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 + a2 * b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator+(int value) const {
-	HumNum output(value * bot + top, bot);
-	return output;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator- -- Subtraction operator to subtract
-//     HumNums from each other and to subtrack integers from
-//     HumNums.
+// HumNum::getOverflowCount -- Return the number of arithmetic results
+//    in the current thread which did not fit into a 32-bit fraction
+//    and were approximated (see setOverflow()).
 //
 
-HumNum HumNum::operator-(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 - a2*b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator-(int value) const {
-	HumNum output(top - value * bot, bot);
-	return output;
+int HumNum::getOverflowCount(void) {
+	return overflowCount();
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator- -- Unary negation operator to generate
-//   the negative version of a HumNum.
+// HumNum::clearOverflowCount -- Reset the overflow count for the
+//    current thread.
 //
 
-HumNum HumNum::operator-(void) const {
-	HumNum output(-top, bot);
-	return output;
+void HumNum::clearOverflowCount(void) {
+	overflowCount() = 0;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator* -- Multiplication operator to multiply
-//   two HumNums together or a HumNum and an integer.
+// HumNum::overflowCount -- Storage for the overflow count of each thread.
 //
 
-HumNum HumNum::operator*(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*a2;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator*(int value) const {
-	HumNum output(top * value, bot);
-	return output;
+int& HumNum::overflowCount(void) {
+	static thread_local int count = 0;
+	return count;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator/ -- Division operator to divide two
-//     HumNums together or divide a HumNum by an integer.
+// HumNum::gcdBinary -- Returns the greatest common divisor of two
+//      numbers using the binary (Stein) algorithm, which needs only
+//      shifts and subtractions.
 //
 
-HumNum HumNum::operator/(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2;
-	int bo = b1*a2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator/(int value) const {
-	int a  = getNumerator();
-	int b  = getDenominator();
-	if (value < 0) {
-		a = -a;
-		b *= -value;
-	} else {
-		b *= value;
+unsigned long long HumNum::gcdBinary(unsigned long long a, unsigned long long b) {
+	if (a == 0) {
+		return b;
 	}
-	HumNum output(a, b);
-	return output;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator= -- Assign the contents of a HumNum
-//    from another HumNum.
-//
-
-HumNum& HumNum::operator=(const HumNum& value) {
-	if (this == &value) {
-		return *this;
+	if (b == 0) {
+		return a;
 	}
-	setValue(value.top, value.bot);
-	return *this;
-}
-
-HumNum& HumNum::operator=(int  value) {
-	setValue(value);
-	return *this;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator+= -- Add a HumNum or integer to a HumNum.
-//
-
-HumNum& HumNum::operator+=(const HumNum& value) {
-	*this = *this + value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator+=(int value) {
-	*this = *this + value;
-	return *this;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator-= -- Subtract a HumNum or an integer from
-//    a HumNum.
-//
-
-HumNum& HumNum::operator-=(const HumNum& value) {
-	*this = *this - value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator-=(int value) {
-	*this = *this - value;
-	return *this;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator*= -- Multiply a HumNum by a HumNum or integer.
-//
-
-HumNum& HumNum::operator*=(const HumNum& value) {
-	*this = *this * value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator*=(int value) {
-	*this = *this * value;
-	return *this;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator/= -- Divide a HumNum by a HumNum or integer.
-//
-
-HumNum& HumNum::operator/=(const HumNum& value) {
-	*this = *this / value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator/=(int value) {
-	*this = *this / value;
-	return *this;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator< -- Less-than equality for a HumNum and
-//   a HumNum, integer, or float.
-//
-
-bool HumNum::operator<(const HumNum& value) const {
-	if (this == &value) {
-		return false;
+#if defined(__GNUC__) || defined(__clang__)
+	int shift = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+	do {
+		b >>= __builtin_ctzll(b);
+		if (a > b) {
+			unsigned long long temp = a;
+			a = b;
+			b = temp;
+		}
+		b -= a;
+	} while (b != 0);
+	return a << shift;
+#else
+	int shift = 0;
+	while (((a | b) & 1) == 0) {
+		a >>= 1;
+		b >>= 1;
+		shift++;
 	}
-	return getFloat() < value.getFloat();
-}
-
-
-bool HumNum::operator<(int value) const {
-	return getFloat() < value;
-}
-
-
-bool HumNum::operator<(double value) const {
-	return getFloat() < value;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator<= -- Less-than-or-equal equality for a
-//     HumNum with a HumNum, integer or float.
-//
-
-bool HumNum::operator<=(const HumNum& value) const {
-	if (this == &value) {
-		return true;
+	while ((a & 1) == 0) {
+		a >>= 1;
 	}
-	return getFloat() <= value.getFloat();
-}
-
-
-bool HumNum::operator<=(int value) const {
-	return getFloat() <= value;
-}
-
-
-bool HumNum::operator<=(double value) const {
-	return getFloat() <= value;
+	do {
+		while ((b & 1) == 0) {
+			b >>= 1;
+		}
+		if (a > b) {
+			unsigned long long temp = a;
+			a = b;
+			b = temp;
+		}
+		b -= a;
+	} while (b != 0);
+	return a << shift;
+#endif
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator> -- Greater-than equality for a HumNum
-//     compared to a HumNum, integer, or float.
+// HumNum::gcdIterative -- Returns the greatest common divisor of two
+//      numbers using an iterative algorithm.
 //
 
-bool HumNum::operator>(const HumNum& value) const {
-	if (this == &value) {
-		return false;
+int HumNum::gcdIterative(int a, int b) {
+	int c;
+	while (b) {
+		c = a;
+		a = b;
+		b = c % b;
 	}
-	return getFloat() > value.getFloat();
-}
-
-
-bool HumNum::operator>(int value) const {
-	return getFloat() > value;
-}
-
-
-bool HumNum::operator>(double value) const {
-	return getFloat() > value;
+	return a < 0 ? -a : a;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator>= -- Greater-than-or-equal equality
-//    comparison for a HumNum to another HumNum, integer, or float.
+// HumNum::gcdRecursive -- Returns the greatest common divisor of two
+//      numbers using a recursive algorithm.
 //
 
-bool HumNum::operator>=(const HumNum& value) const {
-	if (this == &value) {
-		return true;
+int HumNum::gcdRecursive(int a, int b) {
+	if (a < 0) {
+		a = -a;
 	}
-	return getFloat() >= value.getFloat();
-}
-
-
-bool HumNum::operator>=(int value) const {
-	return getFloat() >= value;
-}
-
-
-bool HumNum::operator>=(double value) const {
-	return getFloat() >= value;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator== -- Equality test for HumNums compared to
-//   another HumNum, integer or float.
-//
-
-bool HumNum::operator==(const HumNum& value) const {
-	if (this == &value) {
-		return true;
+	if (!b) {
+		return a;
+	} else {
+		return gcdRecursive(b, a % b);
 	}
-	return getFloat() == value.getFloat();
-}
-
-
-bool HumNum::operator==(int value) const {
-	return getFloat() == value;
-}
-
-
-bool HumNum::operator==(double value) const {
-	return getFloat() == value;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator!= -- Inequality test for HumNums compared
-//   to other HumNums, integers or floats.
+// HumNum::isPowerOfTwo -- Returns true if a power of two.
 //
 
-bool HumNum::operator!=(const HumNum& value) const {
-	if (this == &value) {
+bool HumNum::isPowerOfTwo(void) const {
+	if (top == 0) {
 		return false;
 	}
-	return getFloat() != value.getFloat();
-}
-
-
-bool HumNum::operator!=(int value) const {
-	return getFloat() != value;
-}
-
-
-bool HumNum::operator!=(double value) const {
-	return getFloat() != value;
+	int abstop = top > 0 ? top : -top;
+	if (bot == 1) {
+		return !(abstop & (abstop - 1));
+	} else if (abstop == 1) {
+		return !(bot & (bot - 1));
+	}
+	return false;
 }
 
 
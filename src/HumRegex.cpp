@@ -17,6 +17,7 @@
 //
 
 #include "HumRegex.h"
+#include "HumdrumToken.h"
 
 #include <iostream>
 
@@ -35,6 +36,7 @@ namespace hum {
 HumRegex::HumRegex(void) {
 	// by default use ECMAScript regular expression syntax:
 	m_regexflags  = std::regex_constants::ECMAScript;
+	m_expflags    = m_regexflags;
 
 	m_searchflags = std::regex_constants::format_first_only;
 }
@@ -48,7 +50,8 @@ HumRegex::HumRegex(const string& exp, const string& options) {
 		// explicitly set the default syntax
 		m_regexflags = std::regex_constants::ECMAScript;
 	}
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	m_expflags = m_regexflags;
+	setRegex(exp, getTemporaryRegexFlags(options));
 	m_searchflags = (std::regex_constants::match_flag_type)0;
 	m_searchflags = getTemporarySearchFlags(options);
 }
@@ -65,6 +68,117 @@ HumRegex::~HumRegex() {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// precompiled expressions
+//
+
+//////////////////////////////
+//
+// HumRegex::compile -- Store a regular expression in the object so that
+//     it can be used repeatedly by the search(), match(), replaceDestructive()
+//     and replaceCopy() functions which do not have an expression parameter.
+//     The options are the same as for the other functions ("i" to ignore
+//     case, "g" for global replacement), and the search options remain
+//     set for later calls.
+//
+
+void HumRegex::compile(const string& exp, const string& options) {
+	setRegex(exp, getTemporaryRegexFlags(options));
+	m_searchflags = getTemporarySearchFlags(options);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::search -- Search with the expression given to compile() or
+//     to the constructor.
+//
+
+int HumRegex::search(const string& input) {
+	if (!m_regex) {
+		return 0;
+	}
+	bool result = regex_search(input, m_matches, *m_regex, m_searchflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+int HumRegex::search(const string& input, int startindex) {
+	if (!m_regex) {
+		return 0;
+	}
+	auto startit = input.begin() + startindex;
+	auto endit   = input.end();
+	bool result = regex_search(startit, endit, m_matches, *m_regex, m_searchflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::match -- Match the entire input string with the expression
+//     given to compile() or to the constructor.
+//
+
+bool HumRegex::match(const string& input) {
+	if (!m_regex) {
+		return false;
+	}
+	return regex_match(input, *m_regex, m_searchflags);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::replaceDestructive -- Replace in the input string using the
+//     expression given to compile() or to the constructor.
+//
+
+string& HumRegex::replaceDestructive(string& input, const string& replacement) {
+	if (!m_regex) {
+		return input;
+	}
+	input = regex_replace(input, *m_regex, replacement, m_searchflags);
+	return input;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::replaceCopy -- Return a copy of the input string with
+//     replacements made using the expression given to compile() or to
+//     the constructor.
+//
+
+string HumRegex::replaceCopy(const string& input, const string& replacement) {
+	if (!m_regex) {
+		return input;
+	}
+	string output;
+	regex_replace(std::back_inserter(output), input.begin(),
+			input.end(), *m_regex, replacement, m_searchflags);
+	return output;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // option setting
@@ -155,8 +269,8 @@ void HumRegex::unsetGlobal(void) {
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	bool result = regex_search(input, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -170,10 +284,10 @@ int HumRegex::search(const string& input, const string& exp) {
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
+	bool result = regex_search(startit, endit, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -199,8 +313,8 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	bool result = regex_search(input, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -213,10 +327,10 @@ int HumRegex::search(const string& input, const string& exp,
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
+	bool result = regex_search(startit, endit, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -385,15 +499,15 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	return regex_match(input, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	return regex_match(input, *m_regex, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	return regex_match(input, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	return regex_match(input, *m_regex, getTemporarySearchFlags(options));
 }
 
 
@@ -424,8 +538,8 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	input = regex_replace(input, m_regex, replacement, m_searchflags);
+	setRegex(exp, m_regexflags);
+	input = regex_replace(input, *m_regex, replacement, m_searchflags);
 	return input;
 }
 
@@ -441,8 +555,8 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	input = regex_replace(input, *m_regex, replacement, getTemporarySearchFlags(options));
 	return input;
 }
 
@@ -453,6 +567,31 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 }
 
 
+//
+// HumdrumToken versions: the replacement is made on a copy of the text
+//     which is then stored with HumdrumToken::setText(), so that the
+//     token's cached text analysis is cleared and edits which change the
+//     structure of the file are recorded.
+//
+
+string& HumRegex::replaceDestructive(HumdrumToken* token, const string& replacement,
+		const string& exp) {
+	string text = *token;
+	HumRegex::replaceDestructive(text, replacement, exp);
+	token->setText(text);
+	return *token;
+}
+
+
+string& HumRegex::replaceDestructive(HumdrumToken* token, const string& replacement,
+		const string& exp, const string& options) {
+	string text = *token;
+	HumRegex::replaceDestructive(text, replacement, exp, options);
+	token->setText(text);
+	return *token;
+}
+
+
 
 //////////////////////////////
 //
@@ -462,10 +601,10 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement);
+			input.end(), *m_regex, replacement);
 	return output;
 }
 
@@ -481,10 +620,10 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
+			input.end(), *m_regex, replacement, getTemporarySearchFlags(options));
 	return output;
 }
 
@@ -586,6 +725,68 @@ std::regex_constants::syntax_option_type HumRegex::getTemporaryRegexFlags(
 
 
 
+//////////////////////////////
+//
+// HumRegex::setRegex -- Set the regular expression for the object,
+//     reusing the current one if the expression and options have not
+//     changed, and otherwise taking it from the compiled expression cache.
+//
+
+const regex& HumRegex::setRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_regex && (flags == m_expflags) && (exp == m_exp)) {
+		return *m_regex;
+	}
+	m_regex    = getCompiledRegex(exp, flags);
+	m_exp      = exp;
+	m_expflags = flags;
+	return *m_regex;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCompiledRegex -- Return a compiled regular expression
+//     from a cache which is shared by all threads, compiling it the first
+//     time that an expression/option combination is used.  The cache is
+//     cleared if it grows too large (such as when expressions are built
+//     from input data), but expressions already in use by HumRegex objects
+//     remain valid.
+//
+
+std::shared_ptr<const regex> HumRegex::getCompiledRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	// Allocated and never deleted so that they are still available if
+	// HumRegex is used while static objects are being destroyed.
+	static std::mutex* cachelock = new std::mutex;
+	static map<pair<string, int>, std::shared_ptr<const regex>>* cache =
+			new map<pair<string, int>, std::shared_ptr<const regex>>;
+	const size_t maxsize = 1000;
+
+	pair<string, int> key(exp, (int)flags);
+	{
+		std::lock_guard<std::mutex> lock(*cachelock);
+		auto it = cache->find(key);
+		if (it != cache->end()) {
+			return it->second;
+		}
+	}
+
+	// Compile outside of the lock.  An invalid expression throws a
+	// std::regex_error here just as before.
+	std::shared_ptr<const regex> output = std::make_shared<const regex>(exp, flags);
+
+	std::lock_guard<std::mutex> lock(*cachelock);
+	if (cache->size() >= maxsize) {
+		cache->clear();
+	}
+	cache->insert(make_pair(key, output));
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumRegex::getTemporarySearchFlags --
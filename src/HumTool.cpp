@@ -94,6 +94,37 @@ void HumTool::suppressHumdrumFileOutput(void) {
 
 
 
+//////////////////////////////
+//
+// HumTool::allowParallelSegments -- Add the --threads option, which
+//    lets STREAM_INTERFACE process segments in parallel, each thread with
+//    its own copy of the tool.  Only call this from the constructor of a
+//    tool which keeps no state from one segment to the next, since the
+//    segments given to each copy of the tool are not predictable.
+//
+
+void HumTool::allowParallelSegments(void) {
+	define("threads=i:1", "number of threads for processing input segments (0 = all cores)");
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::allowSegmentPrefetch -- Add the --prefetch and
+//    --prefetch-memory options, which let runStreamInterface() read and
+//    parse input segments in a separate thread ahead of processing.
+//    Called by STREAM_INTERFACE before the command-line options are
+//    processed.
+//
+
+void HumTool::allowSegmentPrefetch(void) {
+	define("prefetch=i:0", "number of input segments to read ahead (0 = none)");
+	define("prefetch-memory=i:256", "maximum megabytes of segments to read ahead (0 = no limit)");
+}
+
+
+
 //////////////////////////////
 //
 // HumTool::hasHumdrumText -- Returns true if the output contains
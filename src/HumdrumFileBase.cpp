@@ -66,7 +66,7 @@ HumdrumFileBase::HumdrumFileBase(istream& contents) : HumHash() {
 // using the following constructor:
 //
 
-HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
+HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) : HumHash() {
 
 	m_filename = infile.m_filename;
 	m_segmentlevel = infile.m_segmentlevel;
@@ -80,6 +80,7 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysisLevel = infile.m_analysisLevel;
 
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
@@ -116,6 +117,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysisLevel = infile.m_analysisLevel;
 
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
@@ -166,9 +168,9 @@ void HumdrumFileBase::clear(void) {
 	m_filename.clear();
 	m_segmentlevel = 0;
 	m_structure_analyzed = false;
-	m_rhythm_analyzed = false;
-	m_slurs_analyzed = false;
+	m_analyzed = 0;
 	m_nulls_analyzed = false;
+	clearEdits();
 }
 
 
@@ -190,7 +192,7 @@ bool HumdrumFileBase::isStructureAnalyzed(void) {
 //
 
 bool HumdrumFileBase::isRhythmAnalyzed(void) {
-	return m_rhythm_analyzed;
+	return isAnalyzed(ANALYZE_RHYTHM);
 }
 
 
@@ -201,7 +203,101 @@ bool HumdrumFileBase::isRhythmAnalyzed(void) {
 //
 
 bool HumdrumFileBase::areStrandsAnalyzed(void) {
-	return m_strands_analyzed;
+	return isAnalyzed(ANALYZE_STRANDS);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::setAnalysisLevel -- Set the analyses which are done
+//    when reading a file, using the ANALYZE_* defines (see
+//    HumdrumFileBase.h).  Analyses not included in the level are done
+//    later when they are needed.  The level stays in effect for later
+//    reads.  The default level is ANALYZE_STRUCTURE.  The readNoRhythm()
+//    functions only use the ANALYZE_BASE part of the level.
+//
+
+void HumdrumFileBase::setAnalysisLevel(int levels) {
+	m_analysisLevel = levels;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getAnalysisLevel -- Return the analyses which are
+//    done when reading a file.
+//
+
+int HumdrumFileBase::getAnalysisLevel(void) const {
+	return m_analysisLevel;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::isAnalyzed -- Returns true if all of the given
+//    ANALYZE_* analyses have been done on the file.
+//
+
+bool HumdrumFileBase::isAnalyzed(int levels) const {
+	return (m_analyzed & levels) == levels;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::analyze -- Do any of the given ANALYZE_* analyses
+//    (and the analyses which they depend on) that have not already been
+//    done.  HumdrumFileStructure and HumdrumFileContent add the analyses
+//    that they are responsible for.  Tokens are only created for lines
+//    that do not already have them, since accessing a line's tokens
+//    will create them for that line.
+//
+
+bool HumdrumFileBase::analyze(int levels) {
+	if (levels & ANALYZE_LINKS) {
+		levels |= ANALYZE_SPINES;
+	}
+	if (levels & ANALYZE_SPINES) {
+		levels |= ANALYZE_TOKENS;
+	}
+	if ((levels & ANALYZE_TOKENS) && !isAnalyzed(ANALYZE_TOKENS)) {
+		m_analyzed |= ANALYZE_TOKENS;
+		for (int i=0; i<(int)m_lines.size(); i++) {
+			if (m_lines[i]->m_tokens.empty()) {
+				m_lines[i]->createTokensFromLine();
+			}
+		}
+		if (!analyzeLines()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_SPINES) && !isAnalyzed(ANALYZE_SPINES)) {
+		m_analyzed |= ANALYZE_SPINES;
+		if (!analyzeSpines()) { return isValid(); }
+		if (!analyzeTracks()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_LINKS) && !isAnalyzed(ANALYZE_LINKS)) {
+		m_analyzed |= ANALYZE_LINKS;
+		if (!analyzeLinks()) { return isValid(); }
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::checkSpines -- Analyze the spines of the file if
+//    this has not been done yet (used by spine accessor functions).
+//
+
+void HumdrumFileBase::checkSpines(void) const {
+	if (!(m_analyzed & ANALYZE_SPINES)) {
+		const_cast<HumdrumFileBase*>(this)->analyze(ANALYZE_SPINES);
+	}
 }
 
 
@@ -317,30 +413,31 @@ bool HumdrumFileBase::read(const char* filename) {
 	}
 #endif
 
-	ifstream infile;
 	if (fname.empty() || (fname ==  "-")) {
 		return HumdrumFileBase::read(cin);
-	} else {
-		infile.open(filename);
-		if (!infile.is_open()) {
-			return setParseError("Cannot open file >>%s<< for reading. A", filename);
-		}
+	}
+
+#ifdef USING_MMAP
+	return readMappedFile(filename);
+#else
+	ifstream infile;
+	infile.open(filename);
+	if (!infile.is_open()) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
 	}
 	HumdrumFileBase::read(infile);
 	infile.close();
 	return isValid();
+#endif
 }
 
 
 bool HumdrumFileBase::read(istream& contents) {
 	clear();
 	m_displayError = true;
-	char buffer[123123] = {0};
-	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
-		s = new HumdrumLine(buffer);
-		s->setOwner(this);
-		m_lines.push_back(s);
+	string buffer;
+	while (getline(contents, buffer, '\n')) {
+		appendLineText(buffer.data(), buffer.size());
 	}
 	return analyzeBaseFromLines();
 /*
@@ -385,9 +482,9 @@ bool HumdrumFileBase::readCsv(const char* filename, const string& separator) {
 
 bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 	m_displayError = true;
-	char buffer[123123] = {0};
+	string buffer;
 	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
+	while (getline(contents, buffer, '\n')) {
 		s = new HumdrumLine;
 		s->setLineFromCsv(buffer);
 		s->setOwner(this);
@@ -404,12 +501,18 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 //
 
 bool HumdrumFileBase::analyzeBaseFromLines(void)  {
+	// New tokens are created, so any previous analysis is no longer valid.
+	m_analyzed = 0;
+	m_nulls_analyzed = false;
+	clearEdits();
+	if (!(m_analysisLevel & ANALYZE_BASE)) {
+		// Tokens will be created when they are needed.
+		return analyzeLines();
+	}
+	m_analyzed |= ANALYZE_TOKENS;
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
-	if (!analyzeSpines()) { return isValid(); }
-	if (!analyzeLinks() ) { return isValid(); }
-	if (!analyzeTracks()) { return isValid(); }
-	return isValid();
+	return analyze(m_analysisLevel & ANALYZE_BASE);
 }
 
 
@@ -421,6 +524,8 @@ bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 
 bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 	// if (!analyzeTokens()) { return isValid(); } // this creates tokens from lines
+	m_analyzed |= ANALYZE_BASE;
+	clearEdits();
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
 	if (!analyzeLinks() ) { return isValid(); }
@@ -437,21 +542,109 @@ bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 //
 
 bool HumdrumFileBase::readString(const string& contents) {
-	stringstream infile;
-	infile << contents;
-	bool status = read(infile);
-	return status;
+	return readBuffer(contents.data(), contents.size());
 }
 
 
 bool HumdrumFileBase::readString(const char* contents) {
-	stringstream infile;
-	infile << contents;
-	return read(infile);
+	return readBuffer(contents, strlen(contents));
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBuffer -- Read contents from a block of memory
+//    that does not need to be null-terminated.  Lines are copied
+//    directly from the buffer into HumdrumLines, so there is no
+//    limit on the length of a line.
+//
+
+bool HumdrumFileBase::readBuffer(const char* contents, size_t size) {
+	clear();
+	m_displayError = true;
+	const char* ptr = contents;
+	const char* end = contents + size;
+	while (ptr < end) {
+		const char* eol = (const char*)memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			eol = end;
+		}
+		appendLineText(ptr, eol - ptr);
+		ptr = eol + 1;
+	}
+	return analyzeBaseFromLines();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendLineText -- Store a line of text at the end
+//    of the file without splitting it into tokens (which is done later
+//    by analyzeTokens).  A trailing carriage return is removed.
+//
+
+void HumdrumFileBase::appendLineText(const char* text, size_t size) {
+	if ((size > 0) && (text[size - 1] == 0x0d)) {
+		size--;
+	}
+	HumdrumLine* s = new HumdrumLine;
+	s->assign(text, size);
+	s->setOwner(this);
+	m_lines.push_back(s);
 }
 
 
 
+#ifdef USING_MMAP
+
+//////////////////////////////
+//
+// HumdrumFileBase::readMappedFile -- Read a file by mapping it into
+//    memory rather than streaming it through an ifstream.  The text is
+//    copied once from the mapped pages into the HumdrumLines.
+//
+
+bool HumdrumFileBase::readMappedFile(const char* filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		// Not a regular file (such as a pipe), so read as a stream.
+		close(fd);
+		ifstream infile(filename);
+		if (!infile.is_open()) {
+			return setParseError("Cannot open file >>%s<< for reading. A", filename);
+		}
+		HumdrumFileBase::read(infile);
+		return isValid();
+	}
+	size_t size = (size_t)info.st_size;
+	if (size == 0) {
+		close(fd);
+		return readBuffer("", 0);
+	}
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return setParseError("Cannot map file >>%s<< for reading.", filename);
+	}
+#ifdef MADV_SEQUENTIAL
+	madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+	bool status = readBuffer((const char*)data, size);
+	munmap(data, size);
+	return status;
+}
+
+#endif
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::readStringCsv -- Reads Humdrum data in CSV format.
@@ -788,59 +981,73 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
-//    spine and rhythmic structure should be recalculated after an append.
+//    spine and rhythmic structure should be recalculated after an append,
+//    either with reanalyzeEdits() or by reading the file again.
 //
 
 void HumdrumFileBase::appendLine(const char* line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.push_back(s);
+	appendLine(new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::appendLine(const string& line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.push_back(s);
+	appendLine(new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::appendLine(HumdrumLine* line) {
 	// deletion will be handled by class.
-	m_lines.push_back(line);
+	insertLine((int)m_lines.size(), line);
 }
 
 
 
 ////////////////////////////
 //
-// HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
-//    spine and rhythmic structure should be recalculated after an append.
+// HumdrumFileBase::insertLine -- Insert a line into the file's contents
+//    before the given line index.  The indexes of the following lines are
+//    updated, and the line is marked as edited so that reanalyzeEdits() can
+//    repair the analysis of the file around it.
 //
 
-
 void HumdrumFileBase::insertLine(int index, const char* line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.insert(m_lines.begin() + index, s);
+	insertLine(index, new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::insertLine(int index, const string& line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.insert(m_lines.begin() + index, s);
+	insertLine(index, new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::insertLine(int index, HumdrumLine* line) {
 	// deletion will be handled by class.
 	m_lines.insert(m_lines.begin() + index, line);
+	line->setOwner(this);
+	if (isAnalyzed(ANALYZE_TOKENS) && line->m_tokens.empty()) {
+		line->createTokensFromLine();
+	}
+	for (int i=index; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setLineIndex(i);
+	}
+	if (m_editStart >= index) {
+		m_editStart++;
+	}
+	if (m_editEnd >= index) {
+		m_editEnd++;
+	}
+	markLineEdited(index);
 }
 
 
 //////////////////////////////
 //
 // HumdrumFileBase::deleteLine -- remove a line from the Humdrum file.
-//    Is best used for global comments and reference records for now.
-//    Other line types will cause parsing problems untill further
-//    generalized to stitch previous next lines together.
+//    The indexes of the following lines are updated, and the neighboring
+//    lines are marked as edited so that reanalyzeEdits() can stitch the
+//    previous and next lines together.  Deleting a spine manipulator
+//    (or a signifier or layout parameter) requires the whole file to be
+//    analyzed again.
 //
 
 void HumdrumFileBase::deleteLine(int index) {
@@ -850,14 +1057,282 @@ void HumdrumFileBase::deleteLine(int index) {
 	if (index < 0) {
 		return;
 	}
-	delete m_lines[index];
-	for (int i=index+1; i<(int)m_lines.size(); i++) {
-		m_lines[i-1] = m_lines[i];
+	HumdrumLine* line = m_lines[index];
+	if (isAnalyzed(ANALYZE_TOKENS)) {
+		if (line->hasSpines() && line->isManipulator()) {
+			m_editReparse = true;
+		} else if (line->isComment() && (line->find("LO:") != string::npos)) {
+			m_editReparse = true;
+		}
+	}
+	if (line->hasSpines() && isAnalyzed(ANALYZE_STRANDS)) {
+		// Strands which start on the deleted line now start on the next line.
+		for (int i=0; i<(int)m_strand1d.size(); i++) {
+			if (m_strand1d[i].first && (m_strand1d[i].first->getOwner() == line)) {
+				m_strand1d[i].first = m_strand1d[i].first->getNextToken(0);
+			}
+		}
+		for (int i=0; i<(int)m_strand2d.size(); i++) {
+			for (int j=0; j<(int)m_strand2d[i].size(); j++) {
+				if (m_strand2d[i][j].first && (m_strand2d[i][j].first->getOwner() == line)) {
+					m_strand2d[i][j].first = m_strand2d[i][j].first->getNextToken(0);
+				}
+			}
+		}
+	}
+	delete line;
+	m_lines.erase(m_lines.begin() + index);
+	for (int i=index; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setLineIndex(i);
+	}
+	if (m_editStart > index) {
+		m_editStart--;
+	}
+	if (m_editEnd >= index) {
+		m_editEnd--;
+	}
+	if (index < (int)m_lines.size()) {
+		markLineEdited(index);
+	} else {
+		markLineEdited(index - 1);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::markLineEdited -- Note that the contents of a line have
+//    been changed so that reanalyzeEdits() will repair the analysis of the
+//    file around the line.  This is done automatically by insertLine(),
+//    deleteLine(), HumdrumLine::appendToken() and HumdrumToken::setText()
+//    (when the new text changes the duration or type of the token).
+//
+
+void HumdrumFileBase::markLineEdited(int index) {
+	if ((index < 0) || (index >= (int)m_lines.size())) {
+		return;
+	}
+	if ((m_editStart < 0) || (index < m_editStart)) {
+		m_editStart = index;
+	}
+	if (index > m_editEnd) {
+		m_editEnd = index;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::hasEdits -- Returns true if lines have been edited
+//    since the file was last analyzed.
+//
+
+bool HumdrumFileBase::hasEdits(void) const {
+	return (m_editStart >= 0) || m_editReparse;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::clearEdits -- Forget about edited lines (such as after
+//    the file has been analyzed again).
+//
+
+void HumdrumFileBase::clearEdits(void) {
+	m_editStart = -1;
+	m_editEnd = -1;
+	m_editReparse = false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::reanalyzeEdits -- Update the analysis of the file after
+//    lines have been inserted, deleted or edited.  Only the edited region
+//    is analyzed again when the spine structure of the file is not changed
+//    by the edits; otherwise, the file is read again from the text of its
+//    lines (so pointers to its lines and tokens will no longer be valid).
+//    HumdrumFileStructure also repairs the rhythm analysis of the file.
+//
+
+bool HumdrumFileBase::reanalyzeEdits(void) {
+	if (!hasEdits()) {
+		return isValid();
+	}
+	if (!isAnalyzed(ANALYZE_TOKENS)) {
+		clearEdits();
+		return isValid();
+	}
+	if (!repairEditedSpines(m_editStart, m_editEnd)) {
+		string text = getEditedText();
+		return HumdrumFileBase::readString(text);
+	}
+	clearEdits();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getEditedText -- Return the text of the file after
+//    updating the text of edited lines from their tokens.
+//
+
+string HumdrumFileBase::getEditedText(void) {
+	string output;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if ((i >= m_editStart) && (i <= m_editEnd) && !m_lines[i]->m_tokens.empty()) {
+			m_lines[i]->createLineFromTokens();
+		}
+		output += *m_lines[i];
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::repairEditedSpines -- Create tokens, spine information
+//    and spine links for the lines between startline and endline, and
+//    link them to the spined lines before and after them.  Returns false
+//    if the edits cannot be repaired without analyzing the entire file
+//    again, such as when a spine manipulator was added or removed, or if
+//    the number of fields on a line no longer matches the following line.
+//
+
+bool HumdrumFileBase::repairEditedSpines(int startline, int endline) {
+	if (m_editReparse) {
+		return false;
+	}
+	if ((startline < 0) || (endline >= (int)m_lines.size())) {
+		return true;
+	}
+
+	int i, j;
+	for (i=startline; i<=endline; i++) {
+		m_lines[i]->setOwner(this);
+		if (m_lines[i]->m_tokens.empty()) {
+			m_lines[i]->createTokensFromLine();
+		}
+		if (m_lines[i]->hasSpines()) {
+			for (j=0; j<m_lines[i]->getTokenCount(); j++) {
+				m_lines[i]->token(j)->setOwner(m_lines[i]);
+			}
+		} else {
+			m_lines[i]->token(0)->setOwner(m_lines[i]);
+			m_lines[i]->token(0)->setFieldIndex(0);
+		}
+	}
+	if (!isAnalyzed(ANALYZE_SPINES)) {
+		return true;
+	}
+
+	vector<HumdrumLine*> region;
+	HumdrumLine* previous = NULL;
+	HumdrumLine* next = NULL;
+	getEditedRegion(startline, endline, region, previous, next);
+	if (!previous || !next) {
+		// Spine starts and ends cannot be changed locally.
+		return region.empty();
+	}
+	int fieldcount = next->getTokenCount();
+	if (!previous->isManipulator() && (previous->getTokenCount() != fieldcount)) {
+		return false;
+	}
+	for (i=0; i<(int)region.size(); i++) {
+		if (region[i]->isManipulator()) {
+			return false;
+		}
+		if (region[i]->getTokenCount() != fieldcount) {
+			return false;
+		}
+	}
+
+	// The spine information of the edited lines is the same as the spine
+	// information of the (incoming) tokens on the next line.
+	for (i=0; i<(int)region.size(); i++) {
+		for (j=0; j<fieldcount; j++) {
+			HTp token = region[i]->token(j);
+			token->setSpineInfo(next->token(j)->getSpineInfo());
+			token->setFieldIndex(j);
+		}
+		if (!region[i]->analyzeTracks(m_parseError)) {
+			return false;
+		}
+	}
+	if (!isAnalyzed(ANALYZE_LINKS)) {
+		return true;
+	}
+
+	for (j=0; j<previous->getTokenCount(); j++) {
+		previous->token(j)->m_nextTokens.clear();
+	}
+	for (j=0; j<fieldcount; j++) {
+		next->token(j)->m_previousTokens.clear();
+	}
+	for (i=0; i<(int)region.size(); i++) {
+		for (j=0; j<fieldcount; j++) {
+			region[i]->token(j)->m_nextTokens.clear();
+			region[i]->token(j)->m_previousTokens.clear();
+		}
+	}
+	HumdrumLine* last = previous;
+	for (i=0; i<(int)region.size(); i++) {
+		if (!stitchLinesTogether(*last, *region[i])) {
+			return false;
+		}
+		last = region[i];
+	}
+	if (!stitchLinesTogether(*last, *next)) {
+		return false;
+	}
+
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getEditedRegion -- Return the spined lines between
+//    startline and endline, as well as the spined lines before and after
+//    them (or NULL if there are none).
+//
+
+void HumdrumFileBase::getEditedRegion(int startline, int endline,
+		vector<HumdrumLine*>& region, HumdrumLine*& previous,
+		HumdrumLine*& next) {
+	region.clear();
+	previous = NULL;
+	next = NULL;
+	for (int i=startline-1; i>=0; i--) {
+		if (m_lines[i]->hasSpines()) {
+			previous = m_lines[i];
+			break;
+		}
+	}
+	for (int i=startline; i<=endline; i++) {
+		if (m_lines[i]->hasSpines()) {
+			region.push_back(m_lines[i]);
+		}
+	}
+	for (int i=endline+1; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->hasSpines()) {
+			next = m_lines[i];
+			break;
+		}
 	}
-	m_lines.resize(m_lines.size() - 1);
 }
 
 
+
 //////////////////////////////
 //
 // HumdrumFileBase::back --
@@ -975,6 +1450,7 @@ string HumdrumFileBase::token(int lineindex, int fieldindex,
 //
 
 int HumdrumFileBase::getMaxTrack(void) const {
+	checkSpines();
 	return (int)m_trackstarts.size() - 1;
 }
 
@@ -1046,6 +1522,7 @@ int HumdrumFileBase::getExinterpCount(const string& exinterp) {
 //
 
 void HumdrumFileBase::getSpineStopList(vector<HTp>& spinestops) {
+	checkSpines();
 	spinestops.reserve(m_trackends.size());
 	spinestops.resize(0);
 	for (int i=0; i<(int)m_trackends.size(); i++) {
@@ -1070,6 +1547,7 @@ void HumdrumFileBase::getSpineStopList(vector<HTp>& spinestops) {
 //
 
 void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts) {
+	checkSpines();
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
 	for (int i=1; i<(int)m_trackstarts.size(); i++) {
@@ -1087,6 +1565,7 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 		newexinterp = "**";
 		newexinterp += exinterp;
 	}
+	checkSpines();
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
 	for (int i=1; i<(int)m_trackstarts.size(); i++) {
@@ -1108,6 +1587,7 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 			newexinterps[i] += exinterps[i];
 		}
 	}
+	checkSpines();
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
 	for (int i=1; i<(int)m_trackstarts.size(); i++) {
@@ -1317,6 +1797,7 @@ void HumdrumFileBase::getTrackSequence(vector<vector<HTp> >& sequence,
 //
 
 HTp HumdrumFileBase::getTrackStart(int track) const {
+	checkSpines();
 	if ((track > 0) && (track < (int)m_trackstarts.size())) {
 		return m_trackstarts[track];
 	} else {
@@ -1337,6 +1818,7 @@ HTp HumdrumFileBase::getTrackStart(int track) const {
 //
 
 int HumdrumFileBase::getTrackEndCount(int track) const {
+	checkSpines();
 	if (track < 0) {
 		track += (int)m_trackends.size();
 	}
@@ -1359,6 +1841,7 @@ int HumdrumFileBase::getTrackEndCount(int track) const {
 //
 
 HTp HumdrumFileBase::getTrackEnd(int track, int subtrack) const {
+	checkSpines();
 	if (track < 0) {
 		track += (int)m_trackends.size();
 	}
@@ -1587,6 +2070,7 @@ bool HumdrumFileBase::analyzeSpines(void) {
 	m_trackstarts.resize(0);
 	m_trackends.resize(0);
 	addToTrackStarts(NULL);
+	HumdrumToken::invalidateDataTypes();
 
 	bool init = false;
 	int i, j;
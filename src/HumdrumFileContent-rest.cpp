@@ -30,9 +30,11 @@ namespace hum {
 
 void HumdrumFileContent::analyzeRestPositions(void) {
 	vector<HTp> kernstarts = getKernSpineStartList();
-	for (int i=0; i<(int)kernstarts.size(); i++) {
-		assignImplicitVerticalRestPositions(kernstarts[i]);
-	}
+	// Null tokens are resolved in the spine tasks, so do it beforehand.
+	resolveNullTokens();
+	runSpineTasks((int)kernstarts.size(), [&](int index) {
+		assignImplicitVerticalRestPositions(kernstarts[index]);
+	});
 
 	checkForExplicitVerticalRestPositions();
 }
@@ -30,10 +30,10 @@ namespace hum {
 
 
 bool HumdrumFileContent::analyzeSlurs(void) {
-	if (m_slurs_analyzed) {
+	if (isAnalyzed(ANALYZE_SLURS)) {
 		return false;
 	}
-	m_slurs_analyzed = true;
+	m_analyzed |= ANALYZE_SLURS;
 	bool output = true;
 	output &= analyzeKernSlurs();
 	output &= analyzeMensSlurs();
@@ -103,11 +103,9 @@ bool HumdrumFileContent::analyzeMensSlurs(void) {
 
 	vector<HTp> mensspines;
 	getSpineStartList(mensspines, "**mens");
-	bool output = true;
 	string linkSignifier = m_signifiers.getKernLinkSignifier();
-	for (int i=0; i<(int)mensspines.size(); i++) {
-		output = output && analyzeKernSlurs(mensspines[i], slurstarts, slurends, labels, endings, linkSignifier);
-	}
+	bool output = analyzeSlurSpines(mensspines, slurstarts, slurends, labels,
+			endings, linkSignifier);
 	createLinkedSlurs(slurstarts, slurends);
 	return output;
 }
@@ -174,17 +172,55 @@ bool HumdrumFileContent::analyzeKernSlurs(void) {
 
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
-	bool output = true;
 	string linkSignifier = m_signifiers.getKernLinkSignifier();
-	for (int i=0; i<(int)kernspines.size(); i++) {
-		output = output && analyzeKernSlurs(kernspines[i], slurstarts, slurends, labels, endings, linkSignifier);
-	}
+	bool output = analyzeSlurSpines(kernspines, slurstarts, slurends, labels,
+			endings, linkSignifier);
 
 	createLinkedSlurs(slurstarts, slurends);
 	return output;
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeSlurSpines -- Link slurs within each spine
+//    (concurrently if there is more than one thread).  Linked slur starts
+//    and ends are returned in spine order, to be linked across spines
+//    afterwards with createLinkedSlurs().
+//
+
+bool HumdrumFileContent::analyzeSlurSpines(vector<HTp>& spinestarts,
+		vector<HTp>& linkstarts, vector<HTp>& linkends,
+		vector<pair<HTp, HTp>>& labels, vector<int>& endings,
+		const string& linksig) {
+	int count = (int)spinestarts.size();
+	if ((m_threads > 1) && (count > 1)) {
+		// Slur durations are read in the spine tasks, so the rhythm
+		// must be analyzed first.
+		analyze(ANALYZE_RHYTHM);
+	}
+	vector<vector<HTp>> spinelinkstarts(count);
+	vector<vector<HTp>> spinelinkends(count);
+	vector<char> status(count, 1);
+	runSpineTasks(count, [&](int index) {
+		status[index] = analyzeKernSlurs(spinestarts[index],
+				spinelinkstarts[index], spinelinkends[index], labels, endings,
+				linksig);
+	});
+
+	bool output = true;
+	for (int i=0; i<count; i++) {
+		output = output && status[i];
+		linkstarts.insert(linkstarts.end(), spinelinkstarts[i].begin(),
+				spinelinkstarts[i].end());
+		linkends.insert(linkends.end(), spinelinkends[i].begin(),
+				spinelinkends[i].end());
+	}
+	return output;
+}
+
+
 bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 		vector<HTp>& linkstarts, vector<HTp>& linkends, vector<pair<HTp, HTp>>& labels,
 		vector<int>& endings, const string& linksig) {
@@ -436,8 +472,8 @@ void HumdrumFileContent::linkSlurEndpoints(HTp slurstart, HTp slurend) {
 	HumNum duration = slurend->getDurationFromStart()
 			- slurstart->getDurationFromStart();
 	slurstart->setValue("auto", durtag, duration);
-	slurstart->setValue("auto", "slurEndCount", to_string(slurEndCount));
-	slurend->setValue("auto", "slurStartCount", to_string(slurStartCount));
+	slurstart->setValue("auto", "slurEndCount", slurEndCount);
+	slurend->setValue("auto", "slurStartCount", slurStartCount);
 }
 
 
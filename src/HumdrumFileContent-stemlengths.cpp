@@ -34,13 +34,18 @@ bool HumdrumFileContent::analyzeKernStemLengths(void) {
 
 	vector<vector<int>> centerlines;
 	getBaselines(centerlines);
-	for (int i=0; i<scount; i++) {
-		HTp sstart = this->getStrandStart(i);
+	// Each strand only changes its own tokens, so they are independent tasks.
+	vector<char> status(scount, 1);
+	runSpineTasks(scount, [&](int index) {
+		HTp sstart = this->getStrandStart(index);
 		if (!sstart->isKern()) {
-			continue;
+			return;
 		}
-		HTp send = this->getStrandEnd(i);
-		output = output && analyzeKernStemLengths(sstart, send, centerlines);
+		HTp send = this->getStrandEnd(index);
+		status[index] = analyzeKernStemLengths(sstart, send, centerlines);
+	});
+	for (int i=0; i<scount; i++) {
+		output = output && status[i];
 	}
 	return output;
 }
@@ -28,6 +28,7 @@ namespace hum {
 //
 
 bool HumdrumFileContent::analyzeKernTies(void) {
+	m_analyzed |= ANALYZE_TIES;
 	vector<pair<HTp, int>> linkedtiestarts;
 	vector<pair<HTp, int>> linkedtieends;
 
@@ -193,13 +194,13 @@ void HumdrumFileContent::linkTieEndpoints(HTp tiestart,
    tiestart->setValue("auto", endtag, tieend);
    tiestart->setValue("auto", "id", tiestart);
 	if (endnumber > 0) {
-		tiestart->setValue("auto", endnum, to_string(endnumber));
+		tiestart->setValue("auto", endnum, endnumber);
 	}
 
    tieend->setValue("auto", starttag, tiestart);
    tieend->setValue("auto", "id", tieend);
 	if (startnumber > 0) {
-		tieend->setValue("auto", startnum, to_string(startnumber));
+		tieend->setValue("auto", startnum, startnumber);
 	}
 
    HumNum duration = tieend->getDurationFromStart()
@@ -54,6 +54,63 @@ HumdrumFileContent::~HumdrumFileContent() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::setThreadCount -- Set the number of threads used
+//    to analyze **kern spines concurrently in the slur, accidental, rest
+//    position and stem length analyses.  A value of 0 or less will use
+//    one thread for each core.  The default is 1 (no extra threads).
+//
+
+void HumdrumFileContent::setThreadCount(int count) {
+	if (count <= 0) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	m_threads = count > 0 ? count : 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getThreadCount -- Return the number of threads
+//    used to analyze spines concurrently.
+//
+
+int HumdrumFileContent::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyze -- Do any of the given ANALYZE_*
+//    analyses that have not already been done (see
+//    HumdrumFileBase::analyze()).
+//
+
+bool HumdrumFileContent::analyze(int levels) {
+	if (levels & (ANALYZE_SLURS | ANALYZE_TIES | ANALYZE_ACCIDENTALS)) {
+		levels |= ANALYZE_RHYTHM;
+	}
+	if (!HumdrumFileStructure::analyze(levels)) {
+		return isValid();
+	}
+	if ((levels & ANALYZE_SLURS) && !isAnalyzed(ANALYZE_SLURS)) {
+		analyzeSlurs();
+	}
+	if ((levels & ANALYZE_TIES) && !isAnalyzed(ANALYZE_TIES)) {
+		analyzeKernTies();
+	}
+	if ((levels & ANALYZE_ACCIDENTALS) && !isAnalyzed(ANALYZE_ACCIDENTALS)) {
+		analyzeKernAccidentals();
+	}
+	return isValid();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileContent::analyzeRScale --
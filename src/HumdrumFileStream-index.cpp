@@ -0,0 +1,396 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Fri Oct 16 11:32:45 PDT 2026
+// Last Modified: Fri Oct 16 11:41:20 PDT 2026
+// Filename:      HumdrumFileStream-index.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileStream-index.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Random access to the segments of a file which contains
+//                many Humdrum files (such as a corpus concatenated with
+//                !!!!SEGMENT: records).  buildSegmentIndex() reads the
+//                file once and stores the byte offset, name and segment
+//                level of each segment, along with the stream state needed
+//                to read a segment on its own.  readSegment() then seeks
+//                directly to a segment given by number or by name.
+//
+//                The index can be saved with writeSegmentIndex() and loaded
+//                again with readSegmentIndex().  The format is one record
+//                per line, with tab-separated fields:
+//                   !!!!humindex: <filename>
+//                   U <group> <universal comment>
+//                   S <offset> <level> <group> <pending line> <name>
+//                Backslashes, tabs and newlines in text fields are escaped
+//                as \\, \t and \n.  A group of -1 means that there are no
+//                universal comments in effect for the segment.
+//
+
+#include "HumdrumFileStream.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::buildSegmentIndex -- Read through a file and store
+//    the location of each segment in it.  Returns the number of segments
+//    found.
+//
+
+int HumdrumFileStream::buildSegmentIndex(const string& filename) {
+	m_segments.clear();
+	m_segmentuniversals.clear();
+	m_segmentnames.clear();
+	m_indexfile = filename;
+
+	clear();
+	if (m_instream.is_open()) {
+		m_instream.close();
+	}
+	m_instream.clear();
+	m_urlbuffer.str("");
+	m_filelist.assign(1, filename);
+	m_curfile = -1;
+
+	HumdrumFile infile;
+	string contents;
+	while (true) {
+		SegmentEntry entry;
+		entry.offset = 0;
+		if (m_instream.is_open()) {
+			entry.offset = (long long)m_instream.tellg();
+		}
+		entry.pending = m_newfilebuffer;
+		entry.universals = -1;
+		if (!m_universals.empty()) {
+			if (m_segmentuniversals.empty() || (m_segmentuniversals.back() != m_universals)) {
+				m_segmentuniversals.push_back(m_universals);
+			}
+			entry.universals = (int)m_segmentuniversals.size() - 1;
+		}
+		if (!getFileText(infile, contents)) {
+			break;
+		}
+		if (m_curfile != 0) {
+			// Filenames listed in the data are not part of the index.
+			break;
+		}
+		entry.name = infile.getFilename();
+		entry.level = infile.getSegmentLevel();
+		if (m_segmentnames.find(entry.name) == m_segmentnames.end()) {
+			m_segmentnames[entry.name] = (int)m_segments.size();
+		}
+		m_segments.push_back(entry);
+	}
+
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::writeSegmentIndex -- Save the segment index.
+//
+
+bool HumdrumFileStream::writeSegmentIndex(const string& filename) {
+	std::ofstream output(filename.c_str());
+	if (!output.is_open()) {
+		return false;
+	}
+	return writeSegmentIndex(output);
+}
+
+
+bool HumdrumFileStream::writeSegmentIndex(ostream& out) {
+	out << "!!!!humindex: " << escapeIndexText(m_indexfile) << "\n";
+	for (int i=0; i<(int)m_segmentuniversals.size(); i++) {
+		for (int j=0; j<(int)m_segmentuniversals[i].size(); j++) {
+			out << "U\t" << i << "\t" << escapeIndexText(m_segmentuniversals[i][j]) << "\n";
+		}
+	}
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		SegmentEntry& entry = m_segments[i];
+		out << "S\t" << entry.offset;
+		out << "\t" << entry.level;
+		out << "\t" << entry.universals;
+		out << "\t" << escapeIndexText(entry.pending);
+		out << "\t" << escapeIndexText(entry.name);
+		out << "\n";
+	}
+	out.flush();
+	return out.good();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegmentIndex -- Load a segment index saved with
+//    writeSegmentIndex().  Returns false if the input is not a segment
+//    index.
+//
+
+bool HumdrumFileStream::readSegmentIndex(const string& filename) {
+	ifstream input(filename.c_str());
+	if (!input.is_open()) {
+		return false;
+	}
+	return readSegmentIndex(input);
+}
+
+
+bool HumdrumFileStream::readSegmentIndex(istream& input) {
+	m_segments.clear();
+	m_segmentuniversals.clear();
+	m_segmentnames.clear();
+	m_indexfile.clear();
+	stopPrefetch();
+	if (m_instream.is_open()) {
+		m_instream.close();
+	}
+
+	string line;
+	if (!getline(input, line) || (line.compare(0, 14, "!!!!humindex: ") != 0)) {
+		return false;
+	}
+	m_indexfile = unescapeIndexText(line.substr(14));
+
+	vector<string> fields;
+	while (getline(input, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		fields.clear();
+		size_t start = 0;
+		while (true) {
+			size_t tab = line.find('\t', start);
+			if (tab == string::npos) {
+				fields.push_back(line.substr(start));
+				break;
+			}
+			fields.push_back(line.substr(start, tab - start));
+			start = tab + 1;
+		}
+		if ((fields[0] == "U") && (fields.size() == 3)) {
+			int group = std::stoi(fields[1]);
+			if ((group < 0) || (group > (int)m_segmentuniversals.size())) {
+				return false;
+			}
+			if (group == (int)m_segmentuniversals.size()) {
+				m_segmentuniversals.resize(group + 1);
+			}
+			m_segmentuniversals[group].push_back(unescapeIndexText(fields[2]));
+		} else if ((fields[0] == "S") && (fields.size() == 6)) {
+			SegmentEntry entry;
+			entry.offset = std::stoll(fields[1]);
+			entry.level = std::stoi(fields[2]);
+			entry.universals = std::stoi(fields[3]);
+			if (entry.universals >= (int)m_segmentuniversals.size()) {
+				return false;
+			}
+			entry.pending = unescapeIndexText(fields[4]);
+			entry.name = unescapeIndexText(fields[5]);
+			if (m_segmentnames.find(entry.name) == m_segmentnames.end()) {
+				m_segmentnames[entry.name] = (int)m_segments.size();
+			}
+			m_segments.push_back(entry);
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentCount -- Number of segments in the index.
+//
+
+int HumdrumFileStream::getSegmentCount(void) const {
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentNumber -- Return the index of the first
+//    segment with the given name, or -1 if there is no such segment.
+//
+
+int HumdrumFileStream::getSegmentNumber(const string& name) const {
+	auto it = m_segmentnames.find(name);
+	if (it == m_segmentnames.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentName -- Return the filename of a segment
+//    in the index.
+//
+
+string HumdrumFileStream::getSegmentName(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return "";
+	}
+	return m_segments[index].name;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentLevel -- Return the !!!!SEGMENT level of
+//    a segment in the index.
+//
+
+int HumdrumFileStream::getSegmentLevel(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return 0;
+	}
+	return m_segments[index].level;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentOffset -- Return the byte offset in the
+//    file at which reading of the segment starts, or -1 if the index is
+//    out of range.
+//
+
+long long HumdrumFileStream::getSegmentOffset(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return -1;
+	}
+	return m_segments[index].offset;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegment -- Read a segment given by number or
+//    name from the indexed file, without reading the segments before it.
+//    The result is the same as reading the segment in sequence with
+//    getFile().  Afterwards, getFile() continues with the next segment
+//    in the file.
+//
+
+bool HumdrumFileStream::readSegment(HumdrumFile& infile, const string& name) {
+	return readSegment(infile, getSegmentNumber(name));
+}
+
+
+bool HumdrumFileStream::readSegment(HumdrumFile& infile, int index) {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return false;
+	}
+	SegmentEntry& entry = m_segments[index];
+	stopPrefetch();
+
+	if (!m_instream.is_open()) {
+		m_instream.open(m_indexfile.c_str());
+		if (!m_instream.is_open()) {
+			return false;
+		}
+	}
+	m_instream.clear();
+	m_instream.seekg(entry.offset);
+	if (!m_instream.good()) {
+		return false;
+	}
+	m_stringbuffer.str("");
+	m_urlbuffer.str("");
+	m_filelist.assign(1, m_indexfile);
+	m_curfile = 0;
+	m_newfilebuffer = entry.pending;
+	if (entry.universals >= 0) {
+		m_universals = m_segmentuniversals[entry.universals];
+	} else {
+		m_universals.clear();
+	}
+
+	string contents;
+	if (!getFileText(infile, contents)) {
+		return false;
+	}
+	parseFileText(infile, contents);
+	infile.setFilename(entry.name);
+	infile.setSegmentLevel(entry.level);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::escapeIndexText -- Escape backslashes, tabs and
+//    newlines for storage in a segment index.
+//
+
+string HumdrumFileStream::escapeIndexText(const string& text) {
+	string output;
+	output.reserve(text.size());
+	for (int i=0; i<(int)text.size(); i++) {
+		switch (text[i]) {
+			case '\\': output += "\\\\"; break;
+			case '\t': output += "\\t";  break;
+			case '\n': output += "\\n";  break;
+			default:   output += text[i];
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::unescapeIndexText -- Undo escapeIndexText().
+//
+
+string HumdrumFileStream::unescapeIndexText(const string& text) {
+	string output;
+	output.reserve(text.size());
+	for (int i=0; i<(int)text.size(); i++) {
+		if ((text[i] != '\\') || (i == (int)text.size() - 1)) {
+			output += text[i];
+			continue;
+		}
+		i++;
+		switch (text[i]) {
+			case 't': output += '\t'; break;
+			case 'n': output += '\n'; break;
+			default:  output += text[i];
+		}
+	}
+	return output;
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
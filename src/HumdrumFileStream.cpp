@@ -18,10 +18,12 @@
 #include "HumdrumFileSet.h"
 #include "HumRegex.h"
 
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -64,12 +66,25 @@ HumdrumFileStream::HumdrumFileStream(const string& datastring) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::~HumdrumFileStream -- Stop the prefetch thread
+//    if it is running.
+//
+
+HumdrumFileStream::~HumdrumFileStream() {
+	stopPrefetch();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::clear -- reset the contents of the class.
 //
 
 void HumdrumFileStream::clear(void) {
+	stopPrefetch();
 	m_curfile = 0;
 	m_filelist.resize(0);
 	m_universals.resize(0);
@@ -86,6 +101,7 @@ void HumdrumFileStream::clear(void) {
 //
 
 int HumdrumFileStream::setFileList(char** list) {
+	stopPrefetch();
 	m_filelist.reserve(1000);
 	m_filelist.resize(0);
 	int i = 0;
@@ -98,18 +114,33 @@ int HumdrumFileStream::setFileList(char** list) {
 
 
 int HumdrumFileStream::setFileList(const vector<string>& list) {
+	stopPrefetch();
 	m_filelist = list;
 	return (int)list.size();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::getFileList -- Return the list of input files (which
+//    is empty when reading from standard input or a string).  Filenames
+//    found in the input data are added to the list as they are read.
+//
+
+const vector<string>& HumdrumFileStream::getFileList(void) const {
+	return m_filelist;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::loadString --
 //
 
 void HumdrumFileStream::loadString(const string& data) {
+	stopPrefetch();
 	m_curfile = -1;
 	m_stringbuffer << data;
 }
@@ -128,12 +159,15 @@ int HumdrumFileStream::read(HumdrumFile& infile) {
 
 int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 	infiles.clear();
-	HumdrumFile* infile = new HumdrumFile;
-	while (getFile(*infile)) {
+	string contents;
+	bool parsed;
+	HumdrumFile* infile;
+	while ((infile = takeSegment(contents, parsed)) != NULL) {
+		if (!parsed) {
+			parseFileText(*infile, contents);
+		}
 		infiles.appendHumdrumPointer(infile);
-		infile = new HumdrumFile;
 	}
-	delete infile;
 	return 0;
 }
 
@@ -146,14 +180,298 @@ int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 
 int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 	infiles.clear();
-	HumdrumFile* infile = new HumdrumFile;
-	int status = getFile(*infile);
-	if (!status) {
-		delete infile;
-	} else {
+	string contents;
+	bool parsed;
+	HumdrumFile* infile = takeSegment(contents, parsed);
+	if (!infile) {
+		return 0;
+	}
+	if (!parsed) {
+		parseFileText(*infile, contents);
+	}
+	infiles.appendHumdrumPointer(infile);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegments -- Read up to count segments into a
+//    set.  The text of the segments is split out of the input serially,
+//    and then the segments are parsed concurrently if the thread count
+//    is greater than one.  Returns the number of segments read.
+//
+
+int HumdrumFileStream::readSegments(HumdrumFileSet& infiles, int count) {
+	infiles.clear();
+	if ((m_prefetchcount > 0) && !m_prefetchthread.joinable()) {
+		// Leave the parsing to the worker threads below if there are any.
+		startPrefetch(m_threads <= 1);
+	}
+	vector<string> contents;
+	vector<int> unparsed;
+	for (int i=0; i<count; i++) {
+		bool parsed;
+		contents.resize(contents.size() + 1);
+		HumdrumFile* infile = takeSegment(contents.back(), parsed);
+		if (!infile) {
+			contents.pop_back();
+			break;
+		}
+		if (!parsed) {
+			unparsed.push_back(i);
+		}
 		infiles.appendHumdrumPointer(infile);
 	}
-	return status;
+
+	int size = (int)contents.size();
+	int todo = (int)unparsed.size();
+	int threads = m_threads < todo ? m_threads : todo;
+	if (threads <= 1) {
+		for (int i=0; i<todo; i++) {
+			parseFileText(infiles[unparsed[i]], contents[unparsed[i]]);
+		}
+		return size;
+	}
+
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < todo) {
+			parseFileText(infiles[unparsed[index]], contents[unparsed[index]]);
+		}
+	};
+	vector<std::thread> workers;
+	for (int i=0; i<threads - 1; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+	return size;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::setThreadCount -- Set the number of threads used
+//    to parse segments in readSegments().  A value of 0 or less will
+//    use one thread for each core.
+//
+
+void HumdrumFileStream::setThreadCount(int count) {
+	if (count <= 0) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	m_threads = count > 0 ? count : 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getThreadCount -- Return the number of threads
+//    used to parse segments in readSegments().
+//
+
+int HumdrumFileStream::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::setPrefetch -- Read up to count segments ahead
+//    of the caller in a separate thread, so that reading and parsing the
+//    input overlaps with the processing of the current segment.  The
+//    segments waiting in the queue will not use more than maxbytes in
+//    total (0 for no limit), counting the lines and tokens of parsed
+//    segments, or the text of segments which are not parsed.  A single
+//    segment which is larger than maxbytes is still passed through when
+//    the queue is empty.  A count of 0 turns off prefetching.  Segments
+//    are parsed by the prefetch thread when they are read with
+//    readSingleSegment(), read() into a HumdrumFileSet, or readSegments();
+//    for getFile() only the input is read ahead and the caller parses the
+//    segment.
+//
+
+void HumdrumFileStream::setPrefetch(int count, size_t maxbytes) {
+	stopPrefetch();
+	m_prefetchcount = count > 0 ? count : 0;
+	m_prefetchbytes = maxbytes;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getPrefetchCount -- Return the maximum number of
+//    segments which are read ahead of the caller.
+//
+
+int HumdrumFileStream::getPrefetchCount(void) const {
+	return m_prefetchcount;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::startPrefetch -- Start the prefetch thread.
+//
+
+void HumdrumFileStream::startPrefetch(bool parse) {
+	m_prefetchparse = parse;
+	m_prefetchdone = false;
+	m_prefetchstop = false;
+	m_prefetchsize = 0;
+	m_prefetchthread = std::thread(&HumdrumFileStream::prefetchSegments, this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::stopPrefetch -- Stop the prefetch thread and throw
+//    away any segments which it has read but which have not been taken.
+//
+
+void HumdrumFileStream::stopPrefetch(void) {
+	if (!m_prefetchthread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_prefetchlock);
+		m_prefetchstop = true;
+	}
+	m_prefetchroom.notify_all();
+	m_prefetchthread.join();
+	for (int i=0; i<(int)m_prefetchqueue.size(); i++) {
+		delete m_prefetchqueue[i].infile;
+	}
+	m_prefetchqueue.clear();
+	m_prefetchsize = 0;
+	m_prefetchdone = false;
+	m_prefetchstop = false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::prefetchSegments -- Main loop of the prefetch thread.
+//    Segments are read from the input (and parsed if requested) and then
+//    placed in the queue, waiting until the queue has room for them, so
+//    that at most one segment is in use outside of the queue limits.
+//
+
+void HumdrumFileStream::prefetchSegments(void) {
+	while (true) {
+		PrefetchEntry entry;
+		entry.infile = new HumdrumFile;
+		entry.parsed = false;
+		if (!getFileText(*entry.infile, entry.contents)) {
+			delete entry.infile;
+			std::lock_guard<std::mutex> lock(m_prefetchlock);
+			m_prefetchdone = true;
+			m_prefetchready.notify_all();
+			return;
+		}
+
+		if (m_prefetchparse) {
+			parseFileText(*entry.infile, entry.contents);
+			entry.contents.clear();
+			entry.contents.shrink_to_fit();
+			entry.parsed = true;
+			entry.size = getParsedSize(*entry.infile);
+		} else {
+			entry.size = entry.contents.size();
+		}
+
+		std::unique_lock<std::mutex> lock(m_prefetchlock);
+		m_prefetchroom.wait(lock, [&]() {
+			return m_prefetchstop || m_prefetchqueue.empty() ||
+					(((int)m_prefetchqueue.size() < m_prefetchcount) &&
+					((m_prefetchbytes == 0) ||
+					(m_prefetchsize + entry.size <= m_prefetchbytes)));
+		});
+		if (m_prefetchstop) {
+			delete entry.infile;
+			return;
+		}
+		m_prefetchsize += entry.size;
+		m_prefetchqueue.push_back(std::move(entry));
+		m_prefetchready.notify_all();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getParsedSize -- Return an estimate of the memory
+//    used by a parsed segment: its line and token objects and their text.
+//
+
+size_t HumdrumFileStream::getParsedSize(HumdrumFile& infile) {
+	size_t output = sizeof(HumdrumFile);
+	for (int i=0; i<infile.getLineCount(); i++) {
+		HumdrumLine& line = infile[i];
+		output += sizeof(HumdrumLine) + line.capacity();
+		for (int j=0; j<line.getTokenCount(); j++) {
+			output += sizeof(HumdrumToken) + line.token(j)->capacity();
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::takeSegment -- Return the next segment from the
+//    input, either from the prefetch queue or by reading it directly.
+//    The segment is parsed if parsed is set to true; otherwise contents
+//    holds its text, and the returned HumdrumFile only has the filename
+//    and segment level.  Returns NULL if there are no more segments.
+//    The caller owns the returned HumdrumFile.
+//
+
+HumdrumFile* HumdrumFileStream::takeSegment(string& contents, bool& parsed) {
+	parsed = false;
+	contents.clear();
+	if (m_prefetchcount <= 0) {
+		HumdrumFile* infile = new HumdrumFile;
+		if (!getFileText(*infile, contents)) {
+			delete infile;
+			return NULL;
+		}
+		return infile;
+	}
+
+	if (!m_prefetchthread.joinable()) {
+		startPrefetch(true);
+	}
+	std::unique_lock<std::mutex> lock(m_prefetchlock);
+	m_prefetchready.wait(lock, [&]() {
+		return m_prefetchdone || !m_prefetchqueue.empty();
+	});
+	if (m_prefetchqueue.empty()) {
+		return NULL;
+	}
+	PrefetchEntry entry = std::move(m_prefetchqueue.front());
+	m_prefetchqueue.pop_front();
+	m_prefetchsize -= entry.size;
+	lock.unlock();
+	m_prefetchroom.notify_all();
+
+	parsed = entry.parsed;
+	contents = std::move(entry.contents);
+	return entry.infile;
 }
 
 
@@ -165,6 +483,14 @@ int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 //
 
 int HumdrumFileStream::eof(void) {
+	if (m_prefetchthread.joinable()) {
+		std::unique_lock<std::mutex> lock(m_prefetchlock);
+		m_prefetchready.wait(lock, [&]() {
+			return m_prefetchdone || !m_prefetchqueue.empty();
+		});
+		return m_prefetchqueue.empty();
+	}
+
 	istream* newinput = NULL;
 
 	// Read HumdrumFile contents from:
@@ -212,6 +538,68 @@ int HumdrumFileStream::eof(void) {
 //
 
 int HumdrumFileStream::getFile(HumdrumFile& infile) {
+	string contents;
+	if (m_prefetchcount <= 0) {
+		if (!getFileText(infile, contents)) {
+			return 0;
+		}
+		parseFileText(infile, contents);
+		return 1;
+	}
+
+	if (!m_prefetchthread.joinable()) {
+		startPrefetch(false);
+	}
+	bool parsed;
+	HumdrumFile* segment = takeSegment(contents, parsed);
+	if (!segment) {
+		return 0;
+	}
+	if (parsed) {
+		stringstream text;
+		text << *segment;
+		contents = text.str();
+	}
+	infile.clear();
+	infile.setFilename(segment->getFilename());
+	infile.setSegmentLevel(segment->getSegmentLevel());
+	delete segment;
+	parseFileText(infile, contents);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::parseFileText -- Parse the text of a segment
+//    extracted with getFileText(), keeping the filename and segment
+//    level which were found for the segment.
+//
+
+void HumdrumFileStream::parseFileText(HumdrumFile& infile,
+		const string& contents) {
+	string filename = infile.getFilename();
+	int level = infile.getSegmentLevel();
+	infile.readStringNoRhythm(contents);
+	if (!filename.empty()) {
+		infile.setFilename(filename);
+	}
+	infile.setSegmentLevel(level);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getFileText -- Extract the text of the next segment
+//    from the input stream or next input file in the list.  The filename
+//    and segment level for the segment are stored in infile, but the
+//    contents are not parsed.  Returns false if there are no more
+//    segments in the input stream.
+//
+
+int HumdrumFileStream::getFileText(HumdrumFile& infile, string& contents) {
 	infile.clear();
 	istream* newinput = NULL;
 
@@ -349,6 +737,15 @@ restarting:
 		starstarFoundQ = 1;
 	}
 
+	// If the previous read stopped at a !!!!SEGMENT record, then keep
+	// the record at the start of this segment (its name was stored in
+	// infile above) so that the segment labels are printed with the
+	// segments, and following programs can split the output again.
+	if (strncmp(m_newfilebuffer.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
+		buffer << m_newfilebuffer << "\n";
+		m_newfilebuffer = "";
+	}
+
 	while (!input.eof()) {
 		input.getline(templine, 123123, '\n');
 		if ((!dataFoundQ) &&
@@ -398,6 +795,7 @@ restarting:
 				// current file stream, not this one, so stop reading the
 				// HumdrumFile content and send what has already been read back
 				// out with new contents.
+				break;
 			}  else {
 				// !!!!SEGMENT: came before any real data was read, so
 				// it is most likely the name of the current file
@@ -485,23 +883,16 @@ restarting:
 	// Universal comments (demoted into Global comments) at the start
 	// of the data stream (maybe allow for postpending Universal comments
 	// in the future).
-	stringstream contents;
-	contents.str(""); // empty any contents in buffer
-	contents.clear(); // reset error flags in buffer
-
+	contents.clear();
 	for (int i=0; i<(int)m_universals.size(); i++) {
 		// Convert universals reference records to globals, but do not demote !!!!filter:
 		if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
 			continue;
 		}
-		contents << &(m_universals[i][1]) << "\n";
-	}
-	contents << buffer.str();
-	string filename = infile.getFilename();
-	infile.readNoRhythm(contents);
-	if (!filename.empty()) {
-		infile.setFilename(filename);
+		contents += &(m_universals[i][1]);
+		contents += "\n";
 	}
+	contents += buffer.str();
 	return 1;
 }
 
@@ -0,0 +1,815 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Fri Oct 16 11:14:04 PDT 2026
+// Last Modified: Fri Oct 16 18:38:51 PDT 2026
+// Filename:      HumdrumFileStructure-binary.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileStructure-binary.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Reading and writing of analyzed Humdrum files in a binary
+//                cache format (.humb).  The binary image stores the text
+//                of the lines and tokens together with the results of the
+//                spine and rhythm analyses, so that loading a file does
+//                not need to split lines into tokens or analyze them again.
+//
+//                Layout of a .humb file (all numbers are ints in the byte
+//                order of the computer which wrote the file):
+//                   HumbHeader
+//                   HumbLine[linecount]
+//                   HumbToken[tokencount]
+//                   int links[linkcount]        (token indexes)
+//                   HumbString info[infocount]  (spine info strings)
+//                   int trackstarts[trackcount] (token indexes or -1)
+//                   int trackendcounts[trackcount]
+//                   int trackends[trackendcount]
+//                   int strands[strandcount * 2]
+//                   int strand2dcounts[strand2dcount]
+//                   int strands2d[strand2dtotal * 2]
+//                   int barlines[barlinecount]  (line indexes)
+//                   char text[textsize]
+//                   char infotext[infosize]
+//                   char filename[filenamesize]
+//
+
+#include "HumdrumFileStructure.h"
+
+#include <string.h>
+
+#include <fstream>
+#include <map>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+#define HUMB_VERSION   1
+#define HUMB_BYTEORDER 0x01020304
+
+// Values for HumbHeader::flags:
+#define HUMB_NULLS     0x1
+#define HUMB_STRUCTURE 0x2
+
+// Values for HumbLine::flags and HumbToken::flags:
+#define HUMB_RHYTHM    0x1
+
+struct HumbHeader {
+	char magic[4];      // "HUMB"
+	int  version;       // HUMB_VERSION
+	int  byteorder;     // HUMB_BYTEORDER
+	int  linesize;      // sizeof(HumbLine)
+	int  tokensize;     // sizeof(HumbToken)
+	int  analyzed;      // ANALYZE_* analyses stored in the file
+	int  flags;         // HUMB_NULLS, HUMB_STRUCTURE
+	int  tpq;           // ticks per quarter note (or -1)
+	int  segmentlevel;
+	int  linecount;
+	int  tokencount;
+	int  linkcount;
+	int  infocount;
+	int  trackcount;
+	int  trackendcount;
+	int  strandcount;
+	int  strand2dcount;
+	int  strand2dtotal;
+	int  barlinecount;
+	int  textsize;
+	int  infosize;
+	int  filenamesize;
+};
+
+struct HumbString {
+	int offset;
+	int length;
+};
+
+struct HumbLine {
+	HumbString text;
+	int firsttoken;
+	int tokencount;
+	int duration[2];
+	int durationfromstart[2];
+	int durationfrombarline[2];
+	int durationtobarline[2];
+	int flags;
+};
+
+struct HumbToken {
+	HumbString text;
+	int tabs;
+	int info;
+	int track;
+	int subtrack;
+	int subtrackcount;
+	int duration[2];
+	int strand;
+	int nullresolve;
+	HumbString next;
+	HumbString previous;
+	HumbString nextnonnull;
+	HumbString previousnonnull;
+	int flags;
+};
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::writeBinary -- Write the file and its analysis in
+//    the binary .humb format, which can be loaded with readBinary().  Any
+//    pending edits are analyzed before writing.  Content analyses (such as
+//    slurs and ties) are not stored.  Returns false if the file could not
+//    be written.
+//
+
+bool HumdrumFileStructure::writeBinary(const string& filename) {
+	std::ofstream outfile(filename.c_str(), std::ios::out | std::ios::binary);
+	if (!outfile.is_open()) {
+		return false;
+	}
+	if (!writeBinary(outfile)) {
+		return false;
+	}
+	outfile.close();
+	return !outfile.fail();
+}
+
+
+bool HumdrumFileStructure::writeBinary(ostream& out) {
+	if (hasEdits()) {
+		reanalyzeEdits();
+	}
+
+	int linecount = (int)m_lines.size();
+	vector<int> lineoffsets(linecount);
+	int tokencount = 0;
+	for (int i=0; i<linecount; i++) {
+		lineoffsets[i] = tokencount;
+		tokencount += m_lines[i]->getTokenCount();
+	}
+
+	vector<HumbLine> lines(linecount);
+	vector<HumbToken> tokens(tokencount);
+	vector<int> links;
+	vector<HumbString> infos;
+	string text;
+	string infotext;
+	map<string, int> infoindex;
+	bool status = true;
+
+	for (int i=0; i<linecount; i++) {
+		HumdrumLine* line = m_lines[i];
+		HumbLine& hline = lines[i];
+		hline.text.offset = (int)text.size();
+		hline.text.length = (int)line->size();
+		text += *line;
+		hline.firsttoken = lineoffsets[i];
+		hline.tokencount = line->getTokenCount();
+		setBinaryNumber(hline.duration, line->m_duration);
+		setBinaryNumber(hline.durationfromstart, line->m_durationFromStart);
+		setBinaryNumber(hline.durationfrombarline, line->m_durationFromBarline);
+		setBinaryNumber(hline.durationtobarline, line->m_durationToBarline);
+		hline.flags = line->m_rhythm_analyzed ? HUMB_RHYTHM : 0;
+
+		// Tokens are stored as references to the line text when they match it.
+		int position = hline.text.offset;
+		int lineend = hline.text.offset + hline.text.length;
+		for (int j=0; j<hline.tokencount; j++) {
+			HTp token = line->token(j);
+			HumbToken& htoken = tokens[lineoffsets[i] + j];
+			int length = (int)token->size();
+			if ((position + length <= lineend) &&
+					(text.compare(position, length, *token) == 0)) {
+				htoken.text.offset = position;
+			} else {
+				htoken.text.offset = (int)text.size();
+				text += *token;
+			}
+			htoken.text.length = length;
+			htoken.tabs = (j < (int)line->m_tabs.size()) ? line->m_tabs[j] : 0;
+			position += length + htoken.tabs;
+
+			const string& info = token->getSpineInfo();
+			auto found = infoindex.find(info);
+			if (found == infoindex.end()) {
+				HumbString entry;
+				entry.offset = (int)infotext.size();
+				entry.length = (int)info.size();
+				infotext += info;
+				infoindex[info] = (int)infos.size();
+				htoken.info = (int)infos.size();
+				infos.push_back(entry);
+			} else {
+				htoken.info = found->second;
+			}
+
+			htoken.track = token->getTrack();
+			htoken.subtrack = token->getSubtrack();
+			htoken.subtrackcount = token->m_address.getSubtrackCount();
+			setBinaryNumber(htoken.duration, token->m_duration);
+			htoken.strand = token->m_strand;
+			htoken.nullresolve = -1;
+			if (m_nulls_analyzed && token->m_nullresolve) {
+				htoken.nullresolve = getBinaryTokenIndex(token->m_nullresolve, lineoffsets);
+				status &= htoken.nullresolve >= 0;
+			}
+			status &= storeBinaryLinks(htoken.next, token->m_nextTokens, links,
+					lineoffsets);
+			status &= storeBinaryLinks(htoken.previous, token->m_previousTokens,
+					links, lineoffsets);
+			status &= storeBinaryLinks(htoken.nextnonnull,
+					token->m_nextNonNullTokens, links, lineoffsets);
+			status &= storeBinaryLinks(htoken.previousnonnull,
+					token->m_previousNonNullTokens, links, lineoffsets);
+			htoken.flags = token->m_rhythm_analyzed ? HUMB_RHYTHM : 0;
+		}
+	}
+	if (!status) {
+		// A token is linked to a token which is not in the file.
+		return false;
+	}
+
+	vector<int> trackstarts(m_trackstarts.size());
+	vector<int> trackendcounts(m_trackstarts.size(), 0);
+	vector<int> trackends;
+	for (int i=0; i<(int)m_trackstarts.size(); i++) {
+		trackstarts[i] = m_trackstarts[i] ?
+				getBinaryTokenIndex(m_trackstarts[i], lineoffsets) : -1;
+		if (i >= (int)m_trackends.size()) {
+			continue;
+		}
+		trackendcounts[i] = (int)m_trackends[i].size();
+		for (int j=0; j<(int)m_trackends[i].size(); j++) {
+			trackends.push_back(getBinaryTokenIndex(m_trackends[i][j], lineoffsets));
+			if (trackends.back() < 0) {
+				return false;
+			}
+		}
+	}
+
+	vector<int> strands;
+	for (int i=0; i<(int)m_strand1d.size(); i++) {
+		strands.push_back(getBinaryTokenIndex(m_strand1d[i].first, lineoffsets));
+		strands.push_back(getBinaryTokenIndex(m_strand1d[i].last, lineoffsets));
+	}
+	vector<int> strand2dcounts(m_strand2d.size());
+	vector<int> strands2d;
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		strand2dcounts[i] = (int)m_strand2d[i].size();
+		for (int j=0; j<(int)m_strand2d[i].size(); j++) {
+			strands2d.push_back(getBinaryTokenIndex(m_strand2d[i][j].first, lineoffsets));
+			strands2d.push_back(getBinaryTokenIndex(m_strand2d[i][j].last, lineoffsets));
+		}
+	}
+
+	vector<int> barlines(m_barlines.size());
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		barlines[i] = m_barlines[i]->getLineIndex();
+	}
+
+	HumbHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "HUMB", 4);
+	header.version       = HUMB_VERSION;
+	header.byteorder     = HUMB_BYTEORDER;
+	header.linesize      = (int)sizeof(HumbLine);
+	header.tokensize     = (int)sizeof(HumbToken);
+	header.analyzed      = m_analyzed & ANALYZE_STRUCTURE;
+	header.flags         = (m_nulls_analyzed ? HUMB_NULLS : 0) |
+	                       (m_structure_analyzed ? HUMB_STRUCTURE : 0);
+	header.tpq           = m_ticksperquarternote;
+	header.segmentlevel  = m_segmentlevel;
+	header.linecount     = linecount;
+	header.tokencount    = tokencount;
+	header.linkcount     = (int)links.size();
+	header.infocount     = (int)infos.size();
+	header.trackcount    = (int)trackstarts.size();
+	header.trackendcount = (int)trackends.size();
+	header.strandcount   = (int)m_strand1d.size();
+	header.strand2dcount = (int)strand2dcounts.size();
+	header.strand2dtotal = (int)strands2d.size() / 2;
+	header.barlinecount  = (int)barlines.size();
+	header.textsize      = (int)text.size();
+	header.infosize      = (int)infotext.size();
+	header.filenamesize  = (int)m_filename.size();
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)lines.data(), lines.size() * sizeof(HumbLine));
+	out.write((const char*)tokens.data(), tokens.size() * sizeof(HumbToken));
+	out.write((const char*)links.data(), links.size() * sizeof(int));
+	out.write((const char*)infos.data(), infos.size() * sizeof(HumbString));
+	out.write((const char*)trackstarts.data(), trackstarts.size() * sizeof(int));
+	out.write((const char*)trackendcounts.data(), trackendcounts.size() * sizeof(int));
+	out.write((const char*)trackends.data(), trackends.size() * sizeof(int));
+	out.write((const char*)strands.data(), strands.size() * sizeof(int));
+	out.write((const char*)strand2dcounts.data(), strand2dcounts.size() * sizeof(int));
+	out.write((const char*)strands2d.data(), strands2d.size() * sizeof(int));
+	out.write((const char*)barlines.data(), barlines.size() * sizeof(int));
+	out.write(text.data(), text.size());
+	out.write(infotext.data(), infotext.size());
+	out.write(m_filename.data(), m_filename.size());
+	return !out.fail();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::setBinaryNumber -- Store a HumNum as a numerator
+//    and denominator pair.
+//
+
+void HumdrumFileStructure::setBinaryNumber(int* output, const HumNum& value) {
+	output[0] = value.getNumerator();
+	output[1] = value.getDenominator();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getBinaryTokenIndex -- Return the index of a token
+//    in the list of all tokens in the file (ordered by line and field),
+//    or -1 if the token does not belong to the file.
+//
+
+int HumdrumFileStructure::getBinaryTokenIndex(HTp token,
+		const vector<int>& lineoffsets) {
+	if (token == NULL) {
+		return -1;
+	}
+	HumdrumLine* line = token->getOwner();
+	if (line == NULL) {
+		return -1;
+	}
+	int lineindex = line->getLineIndex();
+	if ((lineindex < 0) || (lineindex >= (int)m_lines.size()) ||
+			(m_lines[lineindex] != line)) {
+		return -1;
+	}
+	int field = token->getFieldIndex();
+	if ((field < 0) || (field >= (int)line->m_tokens.size()) ||
+			(line->m_tokens[field] != token)) {
+		for (field=0; field<(int)line->m_tokens.size(); field++) {
+			if (line->m_tokens[field] == token) {
+				break;
+			}
+		}
+		if (field >= (int)line->m_tokens.size()) {
+			return -1;
+		}
+	}
+	return lineoffsets[lineindex] + field;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::storeBinaryLinks -- Add the indexes of a list of
+//    tokens to the link table.  Returns false if a token does not belong
+//    to the file.
+//
+
+bool HumdrumFileStructure::storeBinaryLinks(HumbString& output,
+		const vector<HTp>& tokens, vector<int>& links,
+		const vector<int>& lineoffsets) {
+	output.offset = (int)links.size();
+	output.length = (int)tokens.size();
+	bool status = true;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		int index = getBinaryTokenIndex(tokens[i], lineoffsets);
+		status &= index >= 0;
+		links.push_back(index);
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::readBinary -- Load a file which was written with
+//    writeBinary().  The file is mapped into memory when possible, and the
+//    lines and tokens are created directly from the stored text and
+//    analysis, without splitting lines into tokens or analyzing spines and
+//    rhythm again.  Layout parameters and signifiers are analyzed after
+//    loading (if they were analyzed when the file was written), and content
+//    analyses are done when they are first needed.  If the stored tables
+//    are invalid, a parse error is set and false is returned; the source
+//    file is not read again automatically.
+//
+
+bool HumdrumFileStructure::readBinary(const string& filename) {
+	return readBinary(filename.c_str());
+}
+
+
+bool HumdrumFileStructure::readBinary(const char* filename) {
+#ifdef USING_MMAP
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	struct stat info;
+	if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0)) {
+		size_t size = (size_t)info.st_size;
+		void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			return setParseError("Cannot map file >>%s<< for reading.", filename);
+		}
+		bool status = readBinaryBuffer((const char*)data, size);
+		munmap(data, size);
+		return status;
+	}
+	close(fd);
+#endif
+	ifstream infile(filename, std::ios::in | std::ios::binary);
+	if (!infile.is_open()) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	string contents((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
+	return readBinaryBuffer(contents.data(), contents.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::readBinaryBuffer -- Load a file in the .humb format
+//    from a block of memory (see readBinary()).
+//
+
+bool HumdrumFileStructure::readBinaryBuffer(const char* data, size_t size) {
+	clear();
+	m_displayError = true;
+
+	// Copy unaligned data so that the tables can be accessed directly.
+	vector<int> aligned;
+	if (((size_t)data) % alignof(int) != 0) {
+		aligned.resize(size / sizeof(int) + 1);
+		memcpy(aligned.data(), data, size);
+		data = (const char*)aligned.data();
+	}
+
+	if (!isBinaryBuffer(data, size)) {
+		return setParseError("Not a Humdrum binary (.humb) file.");
+	}
+	const HumbHeader& header = *(const HumbHeader*)data;
+	if ((header.version != HUMB_VERSION) ||
+			(header.linesize != (int)sizeof(HumbLine)) ||
+			(header.tokensize != (int)sizeof(HumbToken))) {
+		return setParseError("Unsupported version of Humdrum binary file.");
+	}
+	if (header.byteorder != HUMB_BYTEORDER) {
+		return setParseError("Humdrum binary file has a different byte order.");
+	}
+
+	// Locate the tables in the data, checking that they fit.
+	int counts[] = { header.linecount, header.tokencount, header.linkcount,
+			header.infocount, header.trackcount, header.trackendcount,
+			header.strandcount, header.strand2dcount, header.strand2dtotal,
+			header.barlinecount, header.textsize, header.infosize,
+			header.filenamesize };
+	for (int i=0; i<(int)(sizeof(counts) / sizeof(int)); i++) {
+		if (counts[i] < 0) {
+			return setParseError("Corrupted Humdrum binary file.");
+		}
+	}
+	size_t expected = sizeof(HumbHeader)
+			+ (size_t)header.linecount * sizeof(HumbLine)
+			+ (size_t)header.tokencount * sizeof(HumbToken)
+			+ (size_t)header.linkcount * sizeof(int)
+			+ (size_t)header.infocount * sizeof(HumbString)
+			+ (size_t)header.trackcount * 2 * sizeof(int)
+			+ (size_t)header.trackendcount * sizeof(int)
+			+ (size_t)header.strandcount * 2 * sizeof(int)
+			+ (size_t)header.strand2dcount * sizeof(int)
+			+ (size_t)header.strand2dtotal * 2 * sizeof(int)
+			+ (size_t)header.barlinecount * sizeof(int)
+			+ (size_t)header.textsize
+			+ (size_t)header.infosize
+			+ (size_t)header.filenamesize;
+	if (expected != size) {
+		return setParseError("Corrupted Humdrum binary file.");
+	}
+	const char* ptr = data + sizeof(HumbHeader);
+	const HumbLine* hlines = (const HumbLine*)ptr;
+	ptr += header.linecount * sizeof(HumbLine);
+	const HumbToken* htokens = (const HumbToken*)ptr;
+	ptr += header.tokencount * sizeof(HumbToken);
+	const int* links = (const int*)ptr;
+	ptr += header.linkcount * sizeof(int);
+	const HumbString* infos = (const HumbString*)ptr;
+	ptr += header.infocount * sizeof(HumbString);
+	const int* trackstarts = (const int*)ptr;
+	ptr += header.trackcount * sizeof(int);
+	const int* trackendcounts = (const int*)ptr;
+	ptr += header.trackcount * sizeof(int);
+	const int* trackends = (const int*)ptr;
+	ptr += header.trackendcount * sizeof(int);
+	const int* strands = (const int*)ptr;
+	ptr += header.strandcount * 2 * sizeof(int);
+	const int* strand2dcounts = (const int*)ptr;
+	ptr += header.strand2dcount * sizeof(int);
+	const int* strands2d = (const int*)ptr;
+	ptr += header.strand2dtotal * 2 * sizeof(int);
+	const int* barlines = (const int*)ptr;
+	ptr += header.barlinecount * sizeof(int);
+	const char* text = ptr;
+	ptr += header.textsize;
+	const char* infotext = ptr;
+	ptr += header.infosize;
+	const char* filename = ptr;
+
+	if (!checkBinaryTables(header, hlines, htokens, links, infos, trackstarts,
+			trackendcounts, trackends, strands, strand2dcounts, strands2d,
+			barlines)) {
+		// The cached analysis cannot be used.  The caller has to read the
+		// source file again (the stored filename is given in the message).
+		string source(filename, header.filenamesize);
+		if (source.empty()) {
+			return setParseError("Corrupted Humdrum binary file.");
+		}
+		return setParseError("Corrupted Humdrum binary file for >>" + source
+				+ "<<.");
+	}
+
+	// Create the lines and tokens:
+	vector<HTp> tokens(header.tokencount);
+	vector<string> infostrings(header.infocount);
+	for (int i=0; i<header.infocount; i++) {
+		infostrings[i].assign(infotext + infos[i].offset, infos[i].length);
+	}
+	m_lines.resize(header.linecount);
+	for (int i=0; i<header.linecount; i++) {
+		const HumbLine& hline = hlines[i];
+		HumdrumLine* line = new HumdrumLine;
+		m_lines[i] = line;
+		line->assign(text + hline.text.offset, hline.text.length);
+		line->setOwner(this);
+		line->setLineIndex(i);
+		line->m_duration.setValue(hline.duration[0], hline.duration[1]);
+		line->m_durationFromStart.setValue(hline.durationfromstart[0],
+				hline.durationfromstart[1]);
+		line->m_durationFromBarline.setValue(hline.durationfrombarline[0],
+				hline.durationfrombarline[1]);
+		line->m_durationToBarline.setValue(hline.durationtobarline[0],
+				hline.durationtobarline[1]);
+		line->m_rhythm_analyzed = (hline.flags & HUMB_RHYTHM) ? true : false;
+		line->m_tokens.resize(hline.tokencount);
+		line->m_tabs.resize(hline.tokencount);
+		for (int j=0; j<hline.tokencount; j++) {
+			const HumbToken& htoken = htokens[hline.firsttoken + j];
+			HTp token = new HumdrumToken;
+			tokens[hline.firsttoken + j] = token;
+			line->m_tokens[j] = token;
+			line->m_tabs[j] = htoken.tabs;
+			token->assign(text + htoken.text.offset, htoken.text.length);
+			token->setOwner(line);
+			token->setFieldIndex(j);
+			token->setSpineInfo(infostrings[htoken.info]);
+			token->setTrack(htoken.track, htoken.subtrack);
+			token->setSubtrackCount(htoken.subtrackcount);
+			token->m_duration.setValue(htoken.duration[0], htoken.duration[1]);
+			token->m_strand = htoken.strand;
+			token->m_rhythm_analyzed = (htoken.flags & HUMB_RHYTHM) ? true : false;
+		}
+	}
+
+	// Link the tokens together:
+	for (int i=0; i<header.tokencount; i++) {
+		const HumbToken& htoken = htokens[i];
+		HTp token = tokens[i];
+		if (htoken.nullresolve >= 0) {
+			token->m_nullresolve = tokens[htoken.nullresolve];
+		}
+		loadBinaryLinks(token->m_nextTokens, htoken.next, links, tokens);
+		loadBinaryLinks(token->m_previousTokens, htoken.previous, links, tokens);
+		loadBinaryLinks(token->m_nextNonNullTokens, htoken.nextnonnull, links, tokens);
+		loadBinaryLinks(token->m_previousNonNullTokens, htoken.previousnonnull,
+				links, tokens);
+	}
+
+	m_trackstarts.resize(header.trackcount);
+	m_trackends.resize(header.trackcount);
+	int index = 0;
+	for (int i=0; i<header.trackcount; i++) {
+		m_trackstarts[i] = trackstarts[i] >= 0 ? tokens[trackstarts[i]] : NULL;
+		m_trackends[i].resize(trackendcounts[i]);
+		for (int j=0; j<trackendcounts[i]; j++) {
+			m_trackends[i][j] = tokens[trackends[index++]];
+		}
+	}
+
+	m_strand1d.resize(header.strandcount);
+	for (int i=0; i<header.strandcount; i++) {
+		m_strand1d[i].first = strands[2*i] >= 0 ? tokens[strands[2*i]] : NULL;
+		m_strand1d[i].last = strands[2*i+1] >= 0 ? tokens[strands[2*i+1]] : NULL;
+	}
+	m_strand2d.resize(header.strand2dcount);
+	index = 0;
+	for (int i=0; i<header.strand2dcount; i++) {
+		m_strand2d[i].resize(strand2dcounts[i]);
+		for (int j=0; j<strand2dcounts[i]; j++) {
+			m_strand2d[i][j].first = strands2d[index] >= 0 ? tokens[strands2d[index]] : NULL;
+			m_strand2d[i][j].last = strands2d[index+1] >= 0 ? tokens[strands2d[index+1]] : NULL;
+			index += 2;
+		}
+	}
+
+	m_barlines.resize(header.barlinecount);
+	for (int i=0; i<header.barlinecount; i++) {
+		m_barlines[i] = m_lines[barlines[i]];
+	}
+
+	m_filename.assign(filename, header.filenamesize);
+	m_segmentlevel = header.segmentlevel;
+	m_ticksperquarternote = header.tpq;
+	m_nulls_analyzed = (header.flags & HUMB_NULLS) ? true : false;
+	m_structure_analyzed = (header.flags & HUMB_STRUCTURE) ? true : false;
+
+	// Parameters are stored in the tokens' hash tables, which are not saved.
+	int params = header.analyzed & (ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
+	m_analyzed = header.analyzed & ~params;
+	if (params) {
+		analyze(params);
+	}
+	if (m_analyzed & ANALYZE_RHYTHM) {
+		assignLineTicks();
+	}
+	analyzeSignifiers();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::isBinaryBuffer -- Returns true if the data starts
+//    with the header of a Humdrum binary (.humb) file.
+//
+
+bool HumdrumFileStructure::isBinaryBuffer(const char* data, size_t size) {
+	if (size < sizeof(HumbHeader)) {
+		return false;
+	}
+	return strncmp(data, "HUMB", 4) == 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::checkBinaryTables -- Returns true if all of the
+//    offsets and indexes in the tables of a .humb file are in range, so
+//    that a corrupted file cannot cause invalid memory accesses, and that
+//    all durations have positive denominators.
+//
+
+bool HumdrumFileStructure::checkBinaryTables(const HumbHeader& header,
+		const HumbLine* lines, const HumbToken* tokens, const int* links,
+		const HumbString* infos, const int* trackstarts,
+		const int* trackendcounts, const int* trackends, const int* strands,
+		const int* strand2dcounts, const int* strands2d, const int* barlines) {
+	int i;
+	int tokencount = header.tokencount;
+	auto validString = [](const HumbString& value, int size) {
+		return (value.offset >= 0) && (value.length >= 0) &&
+				(value.offset <= size - value.length);
+	};
+	auto validToken = [tokencount](int index, bool allownull) {
+		return (index < tokencount) && ((index >= 0) || (allownull && (index == -1)));
+	};
+	auto validNumber = [](const int* value) {
+		return value[1] > 0;
+	};
+
+	int expected = 0;
+	for (i=0; i<header.linecount; i++) {
+		if (!validString(lines[i].text, header.textsize)) {
+			return false;
+		}
+		if ((lines[i].firsttoken != expected) || (lines[i].tokencount < 0)) {
+			return false;
+		}
+		if (!validNumber(lines[i].duration) ||
+				!validNumber(lines[i].durationfromstart) ||
+				!validNumber(lines[i].durationfrombarline) ||
+				!validNumber(lines[i].durationtobarline)) {
+			return false;
+		}
+		expected += lines[i].tokencount;
+		if (expected > tokencount) {
+			return false;
+		}
+	}
+	if (expected != tokencount) {
+		return false;
+	}
+	for (i=0; i<tokencount; i++) {
+		const HumbToken& token = tokens[i];
+		if (!validString(token.text, header.textsize)) {
+			return false;
+		}
+		if ((token.info < 0) || (token.info >= header.infocount)) {
+			return false;
+		}
+		if (!validNumber(token.duration)) {
+			return false;
+		}
+		if (!validToken(token.nullresolve, true)) {
+			return false;
+		}
+		if (!validString(token.next, header.linkcount) ||
+				!validString(token.previous, header.linkcount) ||
+				!validString(token.nextnonnull, header.linkcount) ||
+				!validString(token.previousnonnull, header.linkcount)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.linkcount; i++) {
+		if (!validToken(links[i], false)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.infocount; i++) {
+		if (!validString(infos[i], header.infosize)) {
+			return false;
+		}
+	}
+	expected = 0;
+	for (i=0; i<header.trackcount; i++) {
+		if (!validToken(trackstarts[i], true) || (trackendcounts[i] < 0)) {
+			return false;
+		}
+		expected += trackendcounts[i];
+		if (expected > header.trackendcount) {
+			return false;
+		}
+	}
+	if (expected != header.trackendcount) {
+		return false;
+	}
+	for (i=0; i<header.trackendcount; i++) {
+		if (!validToken(trackends[i], false)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.strandcount * 2; i++) {
+		if (!validToken(strands[i], true)) {
+			return false;
+		}
+	}
+	expected = 0;
+	for (i=0; i<header.strand2dcount; i++) {
+		if (strand2dcounts[i] < 0) {
+			return false;
+		}
+		expected += strand2dcounts[i];
+		if (expected > header.strand2dtotal) {
+			return false;
+		}
+	}
+	if (expected != header.strand2dtotal) {
+		return false;
+	}
+	for (i=0; i<header.strand2dtotal * 2; i++) {
+		if (!validToken(strands2d[i], true)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.barlinecount; i++) {
+		if ((barlines[i] < 0) || (barlines[i] >= header.linecount)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::loadBinaryLinks -- Convert a list of token indexes
+//    from the link table into a list of tokens.
+//
+
+void HumdrumFileStructure::loadBinaryLinks(vector<HTp>& output,
+		const HumbString& range, const int* links, const vector<HTp>& tokens) {
+	output.resize(range.length);
+	for (int i=0; i<range.length; i++) {
+		output[i] = tokens[links[range.offset + i]];
+	}
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
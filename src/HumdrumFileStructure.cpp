@@ -199,16 +199,29 @@ bool HumdrumFileStructure::readStringCsv(const string& contents,
 
 bool HumdrumFileStructure::analyzeStructure(void) {
 	m_structure_analyzed = false;
-	if (!m_strands_analyzed) {
-		if (!analyzeStrands()          ) { return isValid(); }
+	int levels = m_analysisLevel;
+	if (levels & ANALYZE_STRANDS) {
+		if (!areStrandsAnalyzed()) {
+			if (!analyzeStrands()          ) { return isValid(); }
+		}
+	}
+	if (levels & ANALYZE_GLOBALPARAMS) {
+		if (!analyzeGlobalParameters() ) { return isValid(); }
+	}
+	if (levels & ANALYZE_LOCALPARAMS) {
+		if (!analyzeLocalParameters()  ) { return isValid(); }
+	}
+	if (levels & ANALYZE_RHYTHM) {
+		if (!HumdrumFileBase::analyze(ANALYZE_LINKS)) { return isValid(); }
+		if (!analyzeTokenDurations()   ) { return isValid(); }
+		m_structure_analyzed = true;
+		if (!analyzeRhythmStructure()  ) { return isValid(); }
 	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	m_structure_analyzed = true;
-	if (!analyzeRhythmStructure()  ) { return isValid(); }
 	analyzeSignifiers();
+	if (levels & ~ANALYZE_STRUCTURE) {
+		// Content analyses such as slurs and ties:
+		analyze(levels);
+	}
 	return isValid();
 }
 
@@ -217,16 +230,26 @@ bool HumdrumFileStructure::analyzeStructure(void) {
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze global/local
-//    parameters but not rhythmic structure.
+//    parameters but not rhythmic structure.  Parameters are only
+//    analyzed here if they are included in the analysis level (see
+//    setAnalysisLevel()); otherwise they are analyzed when needed.
 //
 
 bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 	m_structure_analyzed = true;
-	if (!m_strands_analyzed) {
-		if (!analyzeStrands()          ) { return isValid(); }
+	if (!HumdrumFileBase::analyze(ANALYZE_SPINES)) { return isValid(); }
+	int levels = m_analysisLevel;
+	if (levels & ANALYZE_STRANDS) {
+		if (!areStrandsAnalyzed()) {
+			if (!analyzeStrands()          ) { return isValid(); }
+		}
+	}
+	if ((levels & ANALYZE_GLOBALPARAMS) && !isAnalyzed(ANALYZE_GLOBALPARAMS)) {
+		if (!analyzeGlobalParameters() ) { return isValid(); }
+	}
+	if ((levels & ANALYZE_LOCALPARAMS) && !isAnalyzed(ANALYZE_LOCALPARAMS)) {
+		if (!analyzeLocalParameters()  ) { return isValid(); }
 	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
 	if (!analyzeTokenDurations()   ) { return isValid(); }
 	analyzeSignifiers();
 	return isValid();
@@ -234,14 +257,62 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyze -- Do any of the given ANALYZE_*
+//    analyses that have not already been done (see
+//    HumdrumFileBase::analyze()).
+//
+
+bool HumdrumFileStructure::analyze(int levels) {
+	if (levels & (ANALYZE_STRANDS | ANALYZE_LOCALPARAMS | ANALYZE_RHYTHM)) {
+		levels |= ANALYZE_LINKS;
+	}
+	if (!HumdrumFileBase::analyze(levels)) {
+		return isValid();
+	}
+	if ((levels & ANALYZE_STRANDS) && !isAnalyzed(ANALYZE_STRANDS)) {
+		if (!analyzeStrands()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_GLOBALPARAMS) && !isAnalyzed(ANALYZE_GLOBALPARAMS)) {
+		if (!analyzeGlobalParameters()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_LOCALPARAMS) && !isAnalyzed(ANALYZE_LOCALPARAMS)) {
+		if (!analyzeLocalParameters()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_RHYTHM) && !isAnalyzed(ANALYZE_RHYTHM)) {
+		if (!analyzeRhythmStructure()) { return isValid(); }
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::checkRhythm -- Analyze the rhythm of the file if
+//    this has not been done yet (used by barline accessor functions).
+//
+
+void HumdrumFileStructure::checkRhythm(void) const {
+	if (!(m_analyzed & ANALYZE_RHYTHM)) {
+		const_cast<HumdrumFileStructure*>(this)->analyze(ANALYZE_RHYTHM);
+	}
+}
+
+
+
 /////////////////////////////
 //
 // HumdrumFileStructure::analyzeRhythmStructure --
 //
 
 bool HumdrumFileStructure::analyzeRhythmStructure(void) {
-	m_rhythm_analyzed = true;
+	m_analyzed |= ANALYZE_RHYTHM;
 	setLineRhythmAnalyzed();
+	if (!isAnalyzed(ANALYZE_LINKS)) {
+		if (!HumdrumFileBase::analyze(ANALYZE_LINKS)) { return isValid(); }
+	}
 	if (!isStructureAnalyzed()) {
 		if (!analyzeStructureNoRhythm()) { return isValid(); }
 	}
@@ -253,6 +324,7 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 		if (!analyzeRhythm()           ) { return isValid(); }
 		if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	}
+	assignLineTicks();
 	return isValid();
 }
 
@@ -279,11 +351,7 @@ bool HumdrumFileStructure::assignRhythmFromRecip(HTp spinestart) {
 			continue;
 		}
 
-		if (strchr(current->c_str(), 'q') != NULL) {
-			duration = 0;
-		} else {
-			duration = Convert::recipToDuration((string)*current);
-		}
+		duration = current->getRecipDuration();
 		current->getLine()->setDuration(duration);
 		current = current->getNextToken();
 	}
@@ -426,6 +494,7 @@ int HumdrumFileStructure::tpq(void) {
 	if (m_ticksperquarternote > 0) {
 		return m_ticksperquarternote;
 	}
+	checkRhythm();
 	set<HumNum> durlist = getPositiveLineDurations();
 	vector<int> dems;
 	for (auto& it : durlist) {
@@ -443,6 +512,67 @@ int HumdrumFileStructure::tpq(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::durationToTicks -- Convert a duration in quarter
+//    notes into ticks (see tpq()).  Durations which are not a multiple
+//    of a tick are truncated.
+//
+
+long long HumdrumFileStructure::durationToTicks(HumNum duration) {
+	long long ticks = tpq();
+	long long bot = duration.getDenominator();
+	if (ticks % bot == 0) {
+		return duration.getNumerator() * (ticks / bot);
+	}
+	return duration.getNumerator() * ticks / bot;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::ticksToDuration -- Convert a time in ticks (see
+//    tpq()) into a duration in quarter notes.  The whole quarter notes and
+//    the remaining ticks are converted separately so that large tick
+//    values are not narrowed to an int.
+//
+
+HumNum HumdrumFileStructure::ticksToDuration(long long ticks) {
+	long long ticksperquarter = tpq();
+	if (ticksperquarter <= 0) {
+		return 0;
+	}
+	HumNum output((int)(ticks / ticksperquarter));
+	output += HumNum((int)(ticks % ticksperquarter), (int)ticksperquarter);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::assignLineTicks -- Store the line durations and
+//    times in ticks after the rhythm of the file has been analyzed.
+//
+
+void HumdrumFileStructure::assignLineTicks(void) {
+	// Line durations may have changed since tpq() was last calculated:
+	m_ticksperquarternote = -1;
+	int ticks = tpq();
+	if (ticks <= 0) {
+		return;
+	}
+	for (auto& line : m_lines) {
+		line->m_tickDuration     = durationToTicks(line->m_duration);
+		line->m_ticksFromStart   = durationToTicks(line->m_durationFromStart);
+		line->m_ticksFromBarline = durationToTicks(line->m_durationFromBarline);
+		line->m_ticksToBarline   = durationToTicks(line->m_durationToBarline);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::getPositiveLineDurations -- Return a list of all
@@ -486,6 +616,7 @@ ostream& HumdrumFileStructure::printDurationInfo(ostream& out) {
 //
 
 HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -509,6 +640,7 @@ HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
 //
 
 int HumdrumFileStructure::getBarlineCount(void) const {
+	checkRhythm();
 	return (int)m_barlines.size();
 }
 
@@ -524,6 +656,7 @@ int HumdrumFileStructure::getBarlineCount(void) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -552,6 +685,7 @@ HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -573,6 +707,7 @@ HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationToEnd(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -731,6 +866,7 @@ bool HumdrumFileStructure::analyzeTokenDurations (void) {
 //
 
 bool HumdrumFileStructure::analyzeGlobalParameters(void) {
+	m_analyzed |= ANALYZE_GLOBALPARAMS;
 	vector<HumdrumLine*> globals;
 
 //	for (int i=0; i<(int)m_lines.size(); i++) {
@@ -784,6 +920,7 @@ bool HumdrumFileStructure::analyzeGlobalParameters(void) {
 //
 
 bool HumdrumFileStructure::analyzeLocalParameters(void) {
+	m_analyzed |= ANALYZE_LOCALPARAMS;
 	// analyze backward tokens:
 
 	for (int i=0; i<getStrandCount(); i++) {
@@ -948,12 +1085,16 @@ bool HumdrumFileStructure::decrementDurStates(vector<HumNum>& durs,
 //////////////////////////////
 //
 // HumdrumFileStructure::assignDurationsToTrack -- Assign duration from starts
-//    for each rhythmic spine in the file.  Analysis is done recursively, one
-//    sub-spine at a time.  Duplicate analyses are prevented by the state
-//    variable in the HumdrumToken (currently called rhycheck because it is only
-//    used in this function).  After the durationFromStarts have been assigned
-//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
-//    done elsewhere.
+//    for each rhythmic spine in the file.  Analysis is done iteratively, one
+//    sub-spine at a time: the primary sub-spine is followed to its end, and
+//    the sub-spines which split off from it are placed on a worklist to be
+//    processed afterwards (last split first, which is the order of a
+//    depth-first traversal).  Each token is visited once: tokens are marked
+//    with the state variable in the HumdrumToken (currently called rhycheck
+//    because it is only used in this function), and a sub-spine stops when it
+//    reaches a token that has already been visited, such as at a spine merge.
+//    After the durationFromStarts have been assigned for the rhythmic
+//    analysis of non-data tokens and non-rhythmic spines is done elsewhere.
 //
 
 bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
@@ -962,8 +1103,15 @@ bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
 		return isValid();
 	}
 	int state = starttoken->getState();
-	if (!prepareDurations(starttoken, state, startdur)) {
-		return isValid();
+	vector<pair<HTp, HumNum>> worklist;
+	worklist.emplace_back(starttoken, startdur);
+	while (!worklist.empty()) {
+		HTp token = worklist.back().first;
+		HumNum dursum = worklist.back().second;
+		worklist.pop_back();
+		if (!prepareDurations(token, state, dursum, worklist)) {
+			return isValid();
+		}
 	}
 	return isValid();
 }
@@ -973,12 +1121,14 @@ bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
 //////////////////////////////
 //
 // HumdrumFileStructure::prepareDurations -- Helper function for
-//     HumdrumFileStructure::assignDurationsToTrack() which does all of the
-//     work for assigning durationFromStart values.
+//     HumdrumFileStructure::assignDurationsToTrack() which assigns
+//     durationFromStart values along one sub-spine.  The starting tokens
+//     of sub-spines which split off are added to the worklist along with
+//     their durationFromStart.
 //
 
 bool HumdrumFileStructure::prepareDurations(HTp token, int state,
-		HumNum startdur) {
+		HumNum startdur, vector<pair<HTp, HumNum>>& worklist) {
 	if (state != token->getState()) {
 		return isValid();
 	}
@@ -992,14 +1142,10 @@ bool HumdrumFileStructure::prepareDurations(HTp token, int state,
 	}
 	int tcount = token->getNextTokenCount();
 
-	vector<HTp> reservoir;
-	vector<HumNum> startdurs;
-
 	// Assign line durationFromStarts for primary track first.
 	while (tcount > 0) {
 		for (int t=1; t<tcount; t++) {
-			reservoir.push_back(token->getNextToken(t));
-			startdurs.push_back(dursum);
+			worklist.emplace_back(token->getNextToken(t), dursum);
 		}
 		token = token->getNextToken(0);
 		if (state != token->getState()) {
@@ -1017,13 +1163,6 @@ bool HumdrumFileStructure::prepareDurations(HTp token, int state,
 		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
 	}
 
-	// Process secondary tracks next:
-	int newstate = state;
-
-	for (int i=(int)reservoir.size()-1; i>=0; i--) {
-		prepareDurations(reservoir[i], newstate, startdurs[i]);
-	}
-
 	return isValid();
 }
 
@@ -1092,6 +1231,7 @@ bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
 				dursum += token->getDuration();
 			}
 			token = token->getNextToken(0);
+			tcount = token->getNextTokenCount();
 		}
 	}
 
@@ -1407,7 +1547,8 @@ void HumdrumFileStructure::checkForLocalParameters(HTp token,
 //
 
 bool HumdrumFileStructure::analyzeStrands(void) {
-	m_strands_analyzed = true;
+	m_analyzed |= ANALYZE_STRANDS;
+	if (!HumdrumFileBase::analyze(ANALYZE_LINKS)) { return isValid(); }
 	int spines = getSpineCount();
 	m_strand1d.resize(0);
 	m_strand2d.resize(0);
@@ -1482,14 +1623,28 @@ void HumdrumFileStructure::resolveNullTokens(void) {
 //
 // HumdrumFileStructure::assignStrandsToTokens -- Store the 1D strand
 //    index number for each token in the file.  Global tokens will have
-//    strand index set to -1.
+//    strand index set to -1.  Each token is given the highest strand index
+//    of the strands that lead to it when following the primary next tokens
+//    from the strand start.  The strands are followed from the last to the
+//    first, and each walk stops at the first token which has already been
+//    assigned, since all later tokens on that path have been assigned as
+//    well.  This way each token is visited once, rather than once for every
+//    strand which merges into it.
 //
 
 void HumdrumFileStructure::assignStrandsToTokens(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<m_lines[i]->getTokenCount(); j++) {
+			m_lines[i]->token(j)->setStrandIndex(-1);
+		}
+	}
 	HTp tok;
-	for (int i=0; i<(int)m_strand1d.size(); i++) {
+	for (int i=(int)m_strand1d.size()-1; i>=0; i--) {
 		tok = m_strand1d[i].first;
-		while (tok != NULL) {
+		while ((tok != NULL) && (tok->getStrandIndex() < 0)) {
 			tok->setStrandIndex(i);
 			tok = tok->getNextToken();
 		}
@@ -1676,6 +1831,7 @@ bool HumdrumFileStructure::hasUniversalFilters(void) {
 
 void HumdrumFileStructure::analyzeSignifiers(void) {
 	HumdrumFileStructure& infile = *this;
+	m_signifiers.clear();
 	for (int i=0; i<getLineCount(); i++) {
 		if (!infile[i].isSignifier()) {
 			continue;
@@ -1724,6 +1880,672 @@ std::string HumdrumFileStructure::getKernBelowSignifier(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::reanalyzeEdits -- Update the analysis of the file
+//    after lines have been inserted, deleted or edited.  Spine links, track
+//    information, strands, null token resolution, token durations and line
+//    timestamps are repaired from the first edited line to the next barline
+//    or spine manipulator after the last edited line (the timestamps of
+//    the rest of the file are shifted if the duration up to that point
+//    changed).  If the edits change the spine structure of the file, or
+//    the rhythm cannot be repaired locally, then the file is read again
+//    from the text of its lines.  Content analyses (slurs, ties and
+//    accidentals) which have already been done are done again for the
+//    entire file.
+//
+
+bool HumdrumFileStructure::reanalyzeEdits(void) {
+	if (!hasEdits()) {
+		return isValid();
+	}
+	if (!isAnalyzed(ANALYZE_TOKENS)) {
+		clearEdits();
+		return isValid();
+	}
+	if (!repairEditedSpines(m_editStart, m_editEnd) ||
+			!repairEditedStructure(m_editStart, m_editEnd)) {
+		string text = getEditedText();
+		return HumdrumFileStructure::readString(text);
+	}
+	clearEdits();
+	int content = m_analyzed & (ANALYZE_SLURS | ANALYZE_TIES | ANALYZE_ACCIDENTALS);
+	if (content) {
+		m_analyzed &= ~content;
+		return analyze(content);
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairEditedStructure -- Repair the strand and
+//    rhythm analyses after the spines of the edited lines have been
+//    repaired.  Returns false if the file needs to be analyzed again.
+//
+
+bool HumdrumFileStructure::repairEditedStructure(int startline, int endline) {
+	if (!isAnalyzed(ANALYZE_LINKS)) {
+		return true;
+	}
+	if ((startline < 0) || (endline >= (int)m_lines.size())) {
+		return true;
+	}
+	if (m_analyzed & (ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS)) {
+		// Layout parameters are attached to the tokens which follow them.
+		for (int i=(startline > 0 ? startline - 1 : 0); i<=endline; i++) {
+			if (m_lines[i]->isComment() && (m_lines[i]->find("LO:") != string::npos)) {
+				return false;
+			}
+		}
+	}
+
+	vector<HumdrumLine*> region;
+	HumdrumLine* previous = NULL;
+	HumdrumLine* next = NULL;
+	getEditedRegion(startline, endline, region, previous, next);
+	if (previous && next) {
+		HumdrumLine* first = region.empty() ? next : region[0];
+		if (next->m_rhythm_analyzed) {
+			for (int i=startline; i<=endline; i++) {
+				m_lines[i]->m_rhythm_analyzed = true;
+				if (!m_lines[i]->analyzeTokenDurations(m_parseError)) {
+					return false;
+				}
+			}
+		}
+		if (m_analyzed & ANALYZE_STRANDS) {
+			repairEditedStrands(region, next, startline, endline);
+		}
+		if (m_analyzed & ANALYZE_RHYTHM) {
+			if (!repairEditedRhythm(first, endline)) {
+				return false;
+			}
+			repairNonNullDataTokens(first, startline, endline);
+		}
+		if ((m_analyzed & ANALYZE_STRANDS) && m_nulls_analyzed) {
+			repairNullResolutions(first, endline);
+		}
+	}
+
+	analyzeSignifiers();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairEditedStrands -- Assign strands to the tokens
+//    on edited lines, and move the starts of strands which begin after a
+//    spine split to the first edited line following the split.
+//
+
+void HumdrumFileStructure::repairEditedStrands(vector<HumdrumLine*>& region,
+		HumdrumLine* next, int startline, int endline) {
+	for (int i=0; i<(int)region.size(); i++) {
+		for (int j=0; j<region[i]->getTokenCount(); j++) {
+			region[i]->token(j)->setStrandIndex(next->token(j)->getStrandIndex());
+		}
+	}
+	for (int i=0; i<(int)m_strand1d.size(); i++) {
+		m_strand1d[i].first = getEditedStrandStart(m_strand1d[i].first,
+				startline, endline);
+	}
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		for (int j=0; j<(int)m_strand2d[i].size(); j++) {
+			m_strand2d[i][j].first = getEditedStrandStart(m_strand2d[i][j].first,
+					startline, endline);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getEditedStrandStart -- Helper function for
+//    repairEditedStrands().  Returns the earliest token on an edited line
+//    which comes directly before the start of a strand, or the start of the
+//    strand if there is none.
+//
+
+HTp HumdrumFileStructure::getEditedStrandStart(HTp token, int startline,
+		int endline) {
+	if (token == NULL) {
+		return token;
+	}
+	while (token->getPreviousTokenCount() > 0) {
+		HTp previous = token->getPreviousToken(0);
+		int index = previous->getLineIndex();
+		if ((index < startline) || (index > endline)) {
+			break;
+		}
+		token = previous;
+	}
+	return token;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::isTimedLine -- Returns true if the line is given
+//    a timestamp by the rhythmic analysis of its tokens (a data line with
+//    a non-null rhythmic token or the end of a rhythmic spine).  Other lines
+//    are placed in time between the timed lines before and after them.
+//
+
+bool HumdrumFileStructure::isTimedLine(HumdrumLine* line) {
+	if (!line->hasSpines()) {
+		return false;
+	}
+	if (line->isData()) {
+		return !line->isAllRhythmicNull();
+	}
+	if (!line->isInterpretation()) {
+		return false;
+	}
+	for (int i=0; i<line->getTokenCount(); i++) {
+		if (line->token(i)->isTerminateInterpretation() && line->token(i)->hasRhythm()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairEditedRhythm -- Calculate the timestamps
+//    and durations of lines from the first edited line to the first
+//    barline or spine manipulator after the last edited line.  Returns
+//    false if the spines do not end at the same time on that line (or the
+//    rhythm is not consistent), in which case the rhythm of the entire
+//    file has to be analyzed again.
+//
+
+bool HumdrumFileStructure::repairEditedRhythm(HumdrumLine* first, int endline) {
+	HTp firstspine = getSpineStart(0);
+	if (firstspine && firstspine->isDataType("**recip")) {
+		return false;
+	}
+	for (int track=2; track<=getMaxTrack(); track++) {
+		if (getTrackStart(track)->getLineIndex() != firstspine->getLineIndex()) {
+			// floating spines are linked to the score by the full analysis
+			return false;
+		}
+	}
+
+	int i, j;
+	int stopindex = -1;
+	for (i=endline+1; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		if (m_lines[i]->isBarline() || m_lines[i]->isManipulator()) {
+			stopindex = i;
+			break;
+		}
+	}
+	if (stopindex < 0) {
+		return false;
+	}
+	HumdrumLine* stopline = m_lines[stopindex];
+	int fieldcount = first->getTokenCount();
+	if (stopline->getTokenCount() != fieldcount) {
+		return false;
+	}
+
+	// Find the time at which the last note before the edited lines
+	// ends in each rhythmic spine:
+	vector<HumNum> durstate(fieldcount, -1);
+	for (j=0; j<fieldcount; j++) {
+		HTp token = first->token(j);
+		if (!token->hasRhythm()) {
+			continue;
+		}
+		while (token->getPreviousTokenCount() > 0) {
+			token = token->getPreviousToken(0);
+			if (token->isData() && !token->isNull() && token->getDuration().isNonNegative()) {
+				durstate[j] = token->getDurationFromStart() + token->getDuration();
+				break;
+			}
+		}
+		if (durstate[j].isNegative()) {
+			if (token->getLineIndex() != getTrackStart(1)->getLineIndex()) {
+				// floating spine
+				return false;
+			}
+			durstate[j] = 0;
+		}
+	}
+
+	// The old timestamp of the stop line (or of the next timed line):
+	int endindex = stopindex;
+	while ((endindex < (int)m_lines.size() - 1) && !isTimedLine(m_lines[endindex])) {
+		endindex++;
+	}
+	HumNum oldstop = m_lines[endindex]->getDurationFromStart();
+
+	int firstindex = first->getLineIndex();
+	for (i=firstindex; i<stopindex; i++) {
+		HumdrumLine* line = m_lines[i];
+		if (!(line->hasSpines() && line->isData())) {
+			line->setDurationFromStart(-1);
+			continue;
+		}
+		bool found = false;
+		HumNum linestart = 0;
+		for (j=0; j<fieldcount; j++) {
+			HTp token = line->token(j);
+			if (!token->hasRhythm() || token->getDuration().isNegative()) {
+				continue;
+			}
+			if (!found) {
+				linestart = durstate[j];
+				found = true;
+			} else if (durstate[j] != linestart) {
+				return false;
+			}
+		}
+		if (!found) {
+			line->setDurationFromStart(-1);
+			continue;
+		}
+		line->setDurationFromStart(linestart);
+		for (j=0; j<fieldcount; j++) {
+			HTp token = line->token(j);
+			if (!token->hasRhythm() || token->getDuration().isNegative()) {
+				continue;
+			}
+			durstate[j] = linestart + token->getDuration();
+		}
+	}
+
+	// All rhythmic spines must end at the same time at the stop line.
+	HumNum newstop = -1;
+	for (j=0; j<fieldcount; j++) {
+		if (!stopline->token(j)->hasRhythm()) {
+			continue;
+		}
+		if (newstop.isNegative()) {
+			newstop = durstate[j];
+		} else if (durstate[j] != newstop) {
+			return false;
+		}
+	}
+	if (newstop.isNegative()) {
+		newstop = oldstop;
+	}
+	HumNum delta = newstop - oldstop;
+	if (delta != 0) {
+		for (i=stopindex; i<(int)m_lines.size(); i++) {
+			m_lines[i]->setDurationFromStart(m_lines[i]->getDurationFromStart() + delta);
+		}
+	}
+
+	// Place untimed lines between the timed lines around the region
+	// (see analyzeNullLineRhythms() and fillInNegativeStartTimes()).
+	int startindex = firstindex - 1;
+	while ((startindex >= 0) && !isTimedLine(m_lines[startindex])) {
+		startindex--;
+	}
+	for (i=startindex+1; i<=endindex; i++) {
+		if (!isTimedLine(m_lines[i])) {
+			m_lines[i]->setDurationFromStart(-1);
+		}
+	}
+
+	vector<HumdrumLine*> nulllines;
+	HumdrumLine* previous = startindex >= 0 ? m_lines[startindex] : NULL;
+	for (i=startindex+1; i<=endindex; i++) {
+		HumdrumLine* line = m_lines[i];
+		if (!line->hasSpines()) {
+			continue;
+		}
+		if (line->isAllRhythmicNull()) {
+			if (line->isData()) {
+				nulllines.push_back(line);
+			}
+			continue;
+		}
+		if (line->getDurationFromStart().isNegative()) {
+			continue;
+		}
+		if (previous) {
+			HumNum startdur = previous->getDurationFromStart();
+			HumNum nulldur = (line->getDurationFromStart() - startdur) /
+					((int)nulllines.size() + 1);
+			for (j=0; j<(int)nulllines.size(); j++) {
+				nulllines[j]->setDurationFromStart(startdur + (nulldur * (j+1)));
+			}
+		}
+		previous = line;
+		nulllines.clear();
+	}
+
+	int fillstart = startindex >= 0 ? startindex : 0;
+	HumNum lastdur = -1;
+	for (i=endindex; i>=fillstart; i--) {
+		HumNum dur = m_lines[i]->getDurationFromStart();
+		if (dur.isNonNegative()) {
+			lastdur = dur;
+		} else if (lastdur.isNonNegative()) {
+			m_lines[i]->setDurationFromStart(lastdur);
+		}
+	}
+	lastdur = -1;
+	for (i=fillstart; i<=endindex; i++) {
+		HumNum dur = m_lines[i]->getDurationFromStart();
+		if (dur.isNonNegative()) {
+			lastdur = dur;
+		} else {
+			m_lines[i]->setDurationFromStart(lastdur);
+		}
+	}
+
+	for (i=fillstart; i<=endindex; i++) {
+		if (i < (int)m_lines.size() - 1) {
+			m_lines[i]->setDuration(m_lines[i+1]->getDurationFromStart() -
+					m_lines[i]->getDurationFromStart());
+		} else {
+			m_lines[i]->setDuration(0);
+		}
+	}
+	if (fillstart > 0) {
+		m_lines[fillstart-1]->setDuration(m_lines[fillstart]->getDurationFromStart() -
+				m_lines[fillstart-1]->getDurationFromStart());
+	}
+
+	repairNonRhythmicDurations(first, fillstart, endindex);
+	repairMeter(fillstart, endindex);
+	if (!isValid()) {
+		return false;
+	}
+	// The edit may change tpq(), so the ticks of every line are
+	// calculated again.
+	assignLineTicks();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairNonRhythmicDurations -- Calculate the
+//    durations of non-null data tokens in non-rhythmic spines for the
+//    lines from startindex to endindex which were given new timestamps
+//    (see assignDurationsToNonRhythmicTrack()).
+//
+
+void HumdrumFileStructure::repairNonRhythmicDurations(HumdrumLine* first,
+		int startindex, int endindex) {
+	for (int j=0; j<first->getTokenCount(); j++) {
+		HTp token = first->token(j);
+		if (token->hasRhythm()) {
+			continue;
+		}
+		HTp pending = NULL;
+		while (token->getPreviousTokenCount() > 0) {
+			token = token->getPreviousToken(0);
+			if (token->isData() && !token->isNull()) {
+				pending = token;
+				if (token->getLineIndex() < startindex) {
+					break;
+				}
+			}
+		}
+		if (pending) {
+			token = pending;
+		}
+		while (token) {
+			if (token->isData() && !token->isNull()) {
+				if (pending && (pending != token)) {
+					pending->setDuration(token->getDurationFromStart() -
+							pending->getDurationFromStart());
+				}
+				pending = token;
+				if (token->getLineIndex() > endindex) {
+					break;
+				}
+			}
+			if (token->getNextTokenCount() == 0) {
+				if (pending) {
+					pending->setDuration(token->getDurationFromStart() -
+							pending->getDurationFromStart());
+				}
+				break;
+			}
+			token = token->getNextToken(0);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairMeter -- Update the list of barlines, and the
+//    durations from/to barlines of the lines in the measures which contain
+//    the lines from startindex to endindex (see analyzeMeter()).
+//
+
+void HumdrumFileStructure::repairMeter(int startindex, int endindex) {
+	int i;
+	m_barlines.resize(0);
+	bool foundbarline = false;
+	for (i=0; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->isBarline()) {
+			foundbarline = true;
+			m_barlines.push_back(m_lines[i]);
+		}
+		if (m_lines[i]->isData() && !foundbarline) {
+			m_barlines.push_back(m_lines[0]);
+			foundbarline = true;
+		}
+	}
+
+	int barstart = startindex;
+	while ((barstart > 0) && !m_lines[barstart]->isBarline()) {
+		barstart--;
+	}
+	int barend = endindex;
+	while ((barend < (int)m_lines.size() - 1) && !m_lines[barend]->isBarline()) {
+		barend++;
+	}
+
+	HumNum sum = 0;
+	for (i=(m_lines[barstart]->isBarline() ? barstart + 1 : barstart); i<=barend; i++) {
+		m_lines[i]->setDurationFromBarline(sum);
+		sum += m_lines[i]->getDuration();
+		if (m_lines[i]->isBarline()) {
+			sum = 0;
+		}
+	}
+
+	sum = 0;
+	for (i=(m_lines[barend]->isBarline() ? barend - 1 : barend); i>=barstart; i--) {
+		sum += m_lines[i]->getDuration();
+		m_lines[i]->setDurationToBarline(sum);
+		if (m_lines[i]->isBarline()) {
+			sum = 0;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairNonNullDataTokens -- Update the links to the
+//    previous and next non-null data tokens for the tokens between the
+//    last non-null data token before the edited lines and the first one
+//    after them.  If a spine manipulator or the end of a spine is found
+//    instead, the links are analyzed again for the entire file.
+//
+
+void HumdrumFileStructure::repairNonNullDataTokens(HumdrumLine* first,
+		int startline, int endline) {
+	bool local = true;
+	vector<HTp> tokens;
+
+	for (int j=0; j<first->getTokenCount(); j++) {
+		// Find the non-null data token before the edited lines:
+		HTp token = first->token(j);
+		HTp previous = NULL;
+		while (token->getPreviousTokenCount() == 1) {
+			token = token->getPreviousToken(0);
+			if (token->isSplitInterpretation() || token->isMergeInterpretation()) {
+				break;
+			}
+			if (token->isData() && !token->isNull() &&
+					(token->getLineIndex() < startline)) {
+				previous = token;
+				break;
+			}
+		}
+		if (!previous || (previous->getPreviousTokenCount() != 1) ||
+				previous->getPreviousToken(0)->isSplitInterpretation()) {
+			local = false;
+			break;
+		}
+
+		// Collect the tokens up to the next non-null data token:
+		tokens.clear();
+		tokens.push_back(previous);
+		HTp next = NULL;
+		token = previous;
+		while (token->getNextTokenCount() == 1) {
+			token = token->getNextToken(0);
+			if (token->isSplitInterpretation() || token->isMergeInterpretation() ||
+					(token->getPreviousTokenCount() != 1)) {
+				break;
+			}
+			tokens.push_back(token);
+			if (token->isData() && !token->isNull() &&
+					(token->getLineIndex() > endline)) {
+				next = token;
+				break;
+			}
+		}
+		if (!next) {
+			local = false;
+			break;
+		}
+
+		HTp current = previous;
+		for (int i=1; i<(int)tokens.size(); i++) {
+			tokens[i]->m_previousNonNullTokens.assign(1, current);
+			if (tokens[i]->isData() && !tokens[i]->isNull()) {
+				current = tokens[i];
+			}
+		}
+		current = next;
+		for (int i=(int)tokens.size() - 2; i>=0; i--) {
+			tokens[i]->m_nextNonNullTokens.assign(1, current);
+			if (tokens[i]->isData() && !tokens[i]->isNull()) {
+				current = tokens[i];
+			}
+		}
+	}
+
+	if (local) {
+		return;
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<m_lines[i]->getTokenCount(); j++) {
+			m_lines[i]->token(j)->m_previousNonNullTokens.clear();
+			m_lines[i]->token(j)->m_nextNonNullTokens.clear();
+		}
+	}
+	analyzeNonNullDataTokens();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairNullResolutions -- Resolve null data tokens
+//    on the edited lines, and the null tokens which follow them in the
+//    same strand (see resolveNullTokens()).  If there is no non-null data
+//    token before and after the edited lines in a strand, then the null
+//    tokens are resolved again for the entire file.
+//
+
+void HumdrumFileStructure::repairNullResolutions(HumdrumLine* first,
+		int endline) {
+	bool local = true;
+	vector<HTp> tokens;
+
+	for (int j=0; j<first->getTokenCount(); j++) {
+		HTp token = first->token(j);
+		int strand = token->getStrandIndex();
+		HTp data = NULL;
+		HTp current = token;
+		while (current->getPreviousTokenCount() > 0) {
+			current = current->getPreviousToken(0);
+			if (current->getStrandIndex() != strand) {
+				break;
+			}
+			if (current->isData()) {
+				data = current->isNull() ? current->m_nullresolve : current;
+				break;
+			}
+		}
+		if (data == NULL) {
+			local = false;
+			break;
+		}
+		tokens.clear();
+		bool found = false;
+		while (token && (token->getStrandIndex() == strand)) {
+			if (token->isData()) {
+				if (!token->isNull() && (token->getLineIndex() > endline)) {
+					found = true;
+					break;
+				}
+				tokens.push_back(token);
+			}
+			token = token->getNextTokenCount() ? token->getNextToken(0) : NULL;
+		}
+		if (!found) {
+			local = false;
+			break;
+		}
+		for (int i=0; i<(int)tokens.size(); i++) {
+			if (tokens[i]->isNull()) {
+				tokens[i]->setNullResolution(data);
+			} else {
+				tokens[i]->setNullResolution(NULL);
+				data = tokens[i];
+			}
+		}
+	}
+
+	if (local) {
+		return;
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<m_lines[i]->getTokenCount(); j++) {
+			m_lines[i]->token(j)->setNullResolution(NULL);
+		}
+	}
+	m_nulls_analyzed = false;
+	resolveNullTokens();
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
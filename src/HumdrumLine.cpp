@@ -62,12 +62,16 @@ HumdrumLine::HumdrumLine(const char* aString) : string(aString) {
 }
 
 
-HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line) {
+HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line), HumHash() {
 	m_lineindex           = line.m_lineindex;
 	m_duration            = line.m_duration;
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_tickDuration        = line.m_tickDuration;
+	m_ticksFromStart      = line.m_ticksFromStart;
+	m_ticksFromBarline    = line.m_ticksFromBarline;
+	m_ticksToBarline      = line.m_ticksToBarline;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -86,6 +90,10 @@ HumdrumLine::HumdrumLine(HumdrumLine& line, void* owner) : string((string)line)
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_tickDuration        = line.m_tickDuration;
+	m_ticksFromStart      = line.m_ticksFromStart;
+	m_ticksFromBarline    = line.m_ticksFromBarline;
+	m_ticksToBarline      = line.m_ticksToBarline;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -141,6 +149,36 @@ HumdrumLine::~HumdrumLine() {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::operator new -- Allocate lines from a memory pool.
+//    See HumdrumToken::operator new.
+//
+
+void* HumdrumLine::operator new(size_t size) {
+	if (size != sizeof(HumdrumLine)) {
+		return ::operator new(size);
+	}
+	return HumPool<sizeof(HumdrumLine)>::allocate();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::operator delete -- Return a line's memory to the pool.
+//
+
+void HumdrumLine::operator delete(void* ptr, size_t size) {
+	if (size != sizeof(HumdrumLine)) {
+		::operator delete(ptr);
+		return;
+	}
+	HumPool<sizeof(HumdrumLine)>::deallocate(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::setLineFromCsv -- Read a HumdrumLine from a CSV line.
@@ -847,6 +885,77 @@ HumNum HumdrumLine::getBarlineDuration(HumNum scale) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::getTickDuration -- Return the duration of the line in
+//    ticks, where a quarter note is HumdrumFileStructure::tpq() ticks.
+//    Tick values allow times in the file to be compared and summed with
+//    integer rather than rational arithmetic.  Returns -1 if the line
+//    does not belong to a file.
+//
+
+long long HumdrumLine::getTickDuration(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickDuration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTicksFromStart -- Return the time from the start of the
+//    file to the start of the line in ticks (see getTickDuration()).
+//
+
+long long HumdrumLine::getTicksFromStart(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_ticksFromStart;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTicksFromBarline -- Return the time from the previous
+//    barline to the start of the line in ticks (see getTickDuration()).
+//
+
+long long HumdrumLine::getTicksFromBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_ticksFromBarline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTicksToBarline -- Return the time from the start of the
+//    line to the next barline in ticks (see getTickDuration()).
+//
+
+long long HumdrumLine::getTicksToBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_ticksToBarline;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::setDurationFromStart -- Sets the duration from the start of the
@@ -1131,6 +1240,9 @@ bool HumdrumLine::isEmpty(void) const {
 //
 
 int HumdrumLine::getTokenCount(void) const {
+	if (m_tokens.empty()) {
+		checkTokens();
+	}
 	return (int)m_tokens.size();
 }
 
@@ -1146,11 +1258,29 @@ int HumdrumLine::getTokenCount(void) const {
 //
 
 HTp HumdrumLine::token(int index) const {
+	if (m_tokens.empty()) {
+		checkTokens();
+	}
 	return m_tokens[index];
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::checkTokens -- Create the tokens for the lines of the
+//    owning file if the file was read without the ANALYZE_TOKENS analysis.
+//
+
+void HumdrumLine::checkTokens(void) const {
+	HumdrumFile* owner = (HumdrumFile*)m_owner;
+	if (owner && !owner->isAnalyzed(ANALYZE_TOKENS)) {
+		owner->analyze(ANALYZE_TOKENS);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::getTokenString -- Returns a copy of the string component of
@@ -1159,7 +1289,7 @@ HTp HumdrumLine::token(int index) const {
 //
 
 string HumdrumLine::getTokenString(int index) const {
-	return (string(*m_tokens[index]));
+	return (string(*token(index)));
 }
 
 
@@ -1179,9 +1309,6 @@ int HumdrumLine::createTokensFromLine(void) {
 	m_tokens.clear();
 	m_tabs.clear();
 	HTp token;
-	char ch = 0;
-	char lastch = 0;
-	string tstring;
 
 	if (this->size() == 0) {
 		token = new HumdrumToken();
@@ -1194,34 +1321,38 @@ int HumdrumLine::createTokensFromLine(void) {
 		m_tokens.push_back(token);
 		m_tabs.push_back(0);
 	} else {
-		for (int i=0; i<(int)size(); i++) {
-			lastch = ch;
-			ch = getChar(i);
-			if (ch == '\t') {
-				// Parser now allows multiple tab characters in a
-				// row to represent a single tab.
-				if (lastch != '\t') {
-					token = new HumdrumToken(tstring);
-					token->setOwner(this);
-					m_tokens.push_back(token);
-					m_tabs.push_back(1);
-					tstring.clear();
-				} else {
-					if (m_tabs.size() > 0) {
-						m_tabs.back()++;
-					}
-				}
+		// Copy each tab-separated field directly from the line
+		// text into its token rather than building it up one
+		// character at a time.
+		const char* text = this->data();
+		int length = (int)this->size();
+		int start = 0;
+		for (int i=0; i<length; i++) {
+			if (text[i] != '\t') {
+				continue;
+			}
+			// Parser now allows multiple tab characters in a
+			// row to represent a single tab.
+			if ((i == 0) || (text[i-1] != '\t')) {
+				token = new HumdrumToken();
+				token->assign(text + start, i - start);
+				token->setOwner(this);
+				m_tokens.push_back(token);
+				m_tabs.push_back(1);
 			} else {
-				tstring += ch;
+				if (m_tabs.size() > 0) {
+					m_tabs.back()++;
+				}
 			}
+			start = i + 1;
+		}
+		if (start < length) {
+			token = new HumdrumToken();
+			token->assign(text + start, length - start);
+			token->setOwner(this);
+			m_tokens.push_back(token);
+			m_tabs.push_back(0);
 		}
-	}
-	if (tstring.size() > 0) {
-		token = new HumdrumToken(tstring);
-		token->setOwner(this);
-		m_tokens.push_back(token);
-		m_tabs.push_back(0);
-		tstring.clear();
 	}
 
 	return (int)m_tokens.size();
@@ -1924,6 +2055,22 @@ void HumdrumLine::setParameters(const string& pdata) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::markEdited -- Tell the owning file that the line has been
+//    changed, so that HumdrumFile::reanalyzeEdits() will repair the
+//    analysis of the file around the line.
+//
+
+void HumdrumLine::markEdited(void) {
+	HumdrumFile* owner = getOwner();
+	if (owner) {
+		owner->markLineEdited(m_lineindex);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::appendToken -- add a token at the end of the current
@@ -1934,6 +2081,7 @@ void HumdrumLine::appendToken(HTp token, int tabcount) {
 	// deletion will be handled by class.
 	m_tokens.push_back(token);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -1941,6 +2089,7 @@ void HumdrumLine::appendToken(const HumdrumToken& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -1948,6 +2097,7 @@ void HumdrumLine::appendToken(const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -1955,6 +2105,7 @@ void HumdrumLine::appendToken(const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -1990,6 +2141,7 @@ void HumdrumLine::insertToken(int index, HTp token, int tabcount) {
 	// already belongs to another HumdrumLine or HumdrumFile.
 	m_tokens.insert(m_tokens.begin() + index, token);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -1997,6 +2149,7 @@ void HumdrumLine::insertToken(int index, const HumdrumToken& token, int tabcount
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -2004,6 +2157,7 @@ void HumdrumLine::insertToken(int index, const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -2011,6 +2165,7 @@ void HumdrumLine::insertToken(int index, const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -159,6 +159,7 @@ HumdrumToken& HumdrumToken::operator=(HumdrumToken& token) {
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	setPrefix(token.getPrefix());
+	clearCachedState();
 
 	return *this;
 }
@@ -177,6 +178,7 @@ HumdrumToken& HumdrumToken::operator=(const string& token) {
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	setPrefix("!");
+	clearCachedState();
 
 	return *this;
 }
@@ -195,6 +197,7 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	setPrefix("!");
+	clearCachedState();
 
 	return *this;
 }
@@ -214,6 +217,37 @@ HumdrumToken::~HumdrumToken() {
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumToken::operator new -- Allocate tokens from a memory pool
+//    rather than individually from the heap, since files contain
+//    many tokens which are all created and deleted together.
+//
+
+void* HumdrumToken::operator new(size_t size) {
+	if (size != sizeof(HumdrumToken)) {
+		return ::operator new(size);
+	}
+	return HumPool<sizeof(HumdrumToken)>::allocate();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::operator delete -- Return a token's memory to the pool.
+//
+
+void HumdrumToken::operator delete(void* ptr, size_t size) {
+	if (size != sizeof(HumdrumToken)) {
+		::operator delete(ptr);
+		return;
+	}
+	HumPool<sizeof(HumdrumToken)>::deallocate(ptr);
+}
+
+
 //////////////////////////////
 //
 // HumdrumToken::equalChar -- Returns true if the character at the given
@@ -324,6 +358,7 @@ HumNum HumdrumToken::getSlurDuration(HumNum scale) {
 	if (!isDataType("**kern")) {
 		return 0;
 	}
+	checkAnalysis(ANALYZE_SLURS);
 	if (isDefined("auto", "slurDuration")) {
 		return getValueFraction("auto", "slurDuration");
 	} else if (isDefined("auto", "slurEnd")) {
@@ -375,7 +410,7 @@ bool HumdrumToken::isDataType(const string& dtype) const {
 //
 
 bool HumdrumToken::isKern(void) const {
-	return isDataType("**kern");
+	return getDataTypeClass() == DATATYPE_KERN;
 }
 
 
@@ -388,7 +423,7 @@ bool HumdrumToken::isKern(void) const {
 //
 
 bool HumdrumToken::isMens(void) const {
-	return isDataType("**mens");
+	return getDataTypeClass() == DATATYPE_MENS;
 }
 
 
@@ -513,6 +548,7 @@ void HumdrumToken::setFieldIndex(int index) {
 
 void HumdrumToken::setTrack(int aTrack) {
 	m_address.setTrack(aTrack);
+	m_datatypeEpoch = -1;
 }
 
 
@@ -603,6 +639,26 @@ void HumdrumToken::addNextNonNullToken(HTp token) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::checkAnalysis -- Do the given ANALYZE_* analyses on the
+//    file which owns the token if they have not been done yet (such as
+//    when the file was read with a lower analysis level).
+//
+
+void HumdrumToken::checkAnalysis(int levels) const {
+	HumdrumLine* line = getOwner();
+	if (line == NULL) {
+		return;
+	}
+	HumdrumFile* infile = line->getOwner();
+	if ((infile != NULL) && !infile->isAnalyzed(levels)) {
+		infile->analyze(levels);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getNextToken -- Returns the next token in the
@@ -614,6 +670,9 @@ void HumdrumToken::addNextNonNullToken(HTp token) {
 //
 
 HTp HumdrumToken::getNextToken(int index) const {
+	if (m_nextTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	if ((index >= 0) && (index < (int)m_nextTokens.size())) {
 		return m_nextTokens[index];
 	} else {
@@ -631,6 +690,9 @@ HTp HumdrumToken::getNextToken(int index) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
+	if (m_nextTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return m_nextTokens;
 }
 
@@ -643,6 +705,9 @@ vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getPreviousTokens(void) const {
+	if (m_previousTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return m_previousTokens;
 }
 
@@ -657,6 +722,9 @@ vector<HumdrumToken*> HumdrumToken::getPreviousTokens(void) const {
 //
 
 HumdrumToken* HumdrumToken::getPreviousToken(int index) const {
+	if (m_previousTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	if ((index >= 0) && (index < (int)m_previousTokens.size())) {
 		return m_previousTokens[index];
 	} else {
@@ -711,44 +779,79 @@ HTp HumdrumToken::getPreviousFieldToken(void) const {
 
 bool HumdrumToken::analyzeDuration(void) {
 	m_rhythm_analyzed = true;
+	HumNum duration;
+	if (getDurationFromText(duration)) {
+		m_duration = duration;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::hasStaleDuration -- Returns true if the rhythm of the
+//    token has been analyzed, but the text of the token now represents
+//    a different duration (such as after changing the rhythm of a **kern
+//    note with setText()).
+//
+
+bool HumdrumToken::hasStaleDuration(void) const {
+	if (!m_rhythm_analyzed) {
+		return false;
+	}
+	HumNum duration;
+	if (!getDurationFromText(duration)) {
+		return false;
+	}
+	return duration != m_duration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDurationFromText -- Calculate the duration which the
+//    text of the token represents.  Returns false if the duration is not
+//    determined by the text alone (such as for **recip data).
+//
+
+bool HumdrumToken::getDurationFromText(HumNum& duration) const {
 	if ((*this) == NULL_DATA) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
 	if (equalChar(0 ,'!')) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
 	if (equalChar(0 ,'*')) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
 	if (equalChar(0 ,'=')) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
-	string dtype = getDataType();
 	if (hasRhythm()) {
 		if (isData()) {
 			if (!isNull()) {
 				if (isKern()) {
-					if (strchr(this->c_str(), 'q') != NULL) {
-						m_duration = 0;
-					} else {
-						m_duration = Convert::recipToDuration((string)(*this));
-					}
+					duration = getRecipDuration();
 				} else if (isMens()) {
-					m_duration = Convert::mensToDuration((string)(*this));
+					duration = Convert::mensToDuration(*this);
+				} else {
+					return false;
 				}
 			} else {
-				m_duration.setValue(-1);
+				duration.setValue(-1);
 			}
 		} else {
-			m_duration.setValue(-1);
+			duration.setValue(-1);
 		}
 
 	} else {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 	}
 	return true;
 }
@@ -927,6 +1030,39 @@ HumNum HumdrumToken::getDurationFromStart(HumNum scale) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getTickDuration -- Return the duration of the token in
+//   ticks, where a quarter note is HumdrumFileStructure::tpq() ticks.
+//   Returns -1 if the token does not have a duration.
+//
+
+long long HumdrumToken::getTickDuration(void) {
+	HumNum duration = getDuration();
+	if (duration < 0) {
+		return -1;
+	}
+	HumdrumLine* line = getOwner();
+	if (!line || !line->getOwner()) {
+		return -1;
+	}
+	return line->getOwner()->durationToTicks(duration);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTicksFromStart -- Return the time from the start of
+//   the owning HumdrumFile to the start of the token in ticks.
+//
+
+long long HumdrumToken::getTicksFromStart(void) {
+	return getLine()->getTicksFromStart();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getDurationToEnd -- Returns the duration from the
@@ -1035,17 +1171,7 @@ HumNum HumdrumToken::getDurationFromBarline(HumNum scale) {
 //
 
 bool HumdrumToken::hasRhythm(void) const {
-	string type = getDataType();
-	if (type == "**kern") {
-		return true;
-	}
-	if (type == "**recip") {
-		return true;
-	}
-	if (type == "**mens") {
-		return true;
-	}
-	return false;
+	return getDataTypeClass() != DATATYPE_OTHER;
 }
 
 
@@ -1056,16 +1182,7 @@ bool HumdrumToken::hasRhythm(void) const {
 //
 
 bool HumdrumToken::hasBeam(void) const {
-	for (int i=0; i<(int)this->size(); i++) {
-		switch (this->at(i)) {
-			case 'L':
-			case 'J':
-			case 'k':
-			case 'K':
-				return true;
-		}
-	}
-	return false;
+	return (getTextFlags() & TEXT_BEAM) ? true : false;
 }
 
 
@@ -1091,16 +1208,17 @@ bool HumdrumToken::equalTo(const string& pattern) {
 //
 
 bool HumdrumToken::isRest(void) {
-	if (isKern()) {
-		if (isNull() && Convert::isKernRest((string)(*resolveNull()))) {
-			return true;
-		} else if (Convert::isKernRest((string)(*this))) {
-			return true;
-		}
-	} else if (isMens()) {
-		if (isNull() && Convert::isMensRest((string)(*resolveNull()))) {
-			return true;
-		} else if (Convert::isMensRest((string)(*this))) {
+	int datatype = getDataTypeClass();
+	if ((datatype != DATATYPE_KERN) && (datatype != DATATYPE_MENS)) {
+		return false;
+	}
+	unsigned int flags = getTextFlags();
+	if (flags & TEXT_REST) {
+		return true;
+	}
+	if (flags & TEXT_NULL) {
+		HTp resolve = resolveNull();
+		if (resolve && (resolve->getTextFlags() & TEXT_REST)) {
 			return true;
 		}
 	}
@@ -1116,16 +1234,11 @@ bool HumdrumToken::isRest(void) {
 //
 
 bool HumdrumToken::isNote(void) {
-	if (isKern()) {
-		if (Convert::isKernNote((string)(*this))) {
-			return true;
-		}
-	} else if (isMens()) {
-		if (Convert::isMensNote((string)(*this))) {
-			return true;
-		}
+	if (!(getTextFlags() & TEXT_PITCH)) {
+		return false;
 	}
-	return false;
+	int datatype = getDataTypeClass();
+	return (datatype == DATATYPE_KERN) || (datatype == DATATYPE_MENS);
 }
 
 
@@ -1175,7 +1288,7 @@ bool HumdrumToken::isNoteAttack(void) {
 //
 
 bool HumdrumToken::isInvisible(void) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 			return false;
 	}
 	if (isBarline()) {
@@ -1199,16 +1312,10 @@ bool HumdrumToken::isInvisible(void) {
 //
 
 bool HumdrumToken::isGrace(void) {
-	if (!isDataType("**kern")) {
-			return false;
-	}
-	if (!isData()) {
+	if (!(getTextFlags() & TEXT_GRACE)) {
 		return false;
-	} else if (this->find("q") != string::npos) {
-		return true;
 	}
-
-	return false;
+	return isData() && isKern();
 }
 
 
@@ -1346,12 +1453,10 @@ bool HumdrumToken::isMensurationSymbol(void) {
 //
 
 bool HumdrumToken::hasSlurStart(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurStart((string)(*this))) {
-			return true;
-		}
+	if (!(getTextFlags() & TEXT_SLUR_START)) {
+		return false;
 	}
-	return false;
+	return isKern();
 }
 
 
@@ -1363,12 +1468,10 @@ bool HumdrumToken::hasSlurStart(void) {
 //
 
 bool HumdrumToken::hasSlurEnd(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurEnd((string)(*this))) {
-			return true;
-		}
+	if (!(getTextFlags() & TEXT_SLUR_END)) {
+		return false;
 	}
-	return false;
+	return isKern();
 }
 
 
@@ -1485,7 +1588,14 @@ bool HumdrumToken::hasObliquaLigatureBegin(void) {
 
 char HumdrumToken::hasStemDirection(void) {
 	if (isKern()) {
-		return Convert::hasKernStemDirection(*this);
+		int count = getKernNoteCount();
+		for (int i=0; i<count; i++) {
+			char stem = getKernNote(i).getStemDirection();
+			if (stem) {
+				return stem;
+			}
+		}
+		return '\0';
 	} else {
 		// don't know what a stem in this datatype is
 		return '\0';
@@ -1545,12 +1655,12 @@ bool HumdrumToken::hasObliquaLigatureEnd(void) {
 //
 
 bool HumdrumToken::isSecondaryTiedNote(void) {
-	if (isDataType("**kern")) {
-		if (Convert::isKernSecondaryTiedNote((string)(*this))) {
-			return true;
-		}
+	unsigned int flags = getTextFlags();
+	if ((flags & (TEXT_PITCH | TEXT_TIE_CONTINUE)) !=
+			(TEXT_PITCH | TEXT_TIE_CONTINUE)) {
+		return false;
 	}
-	return false;
+	return isKern();
 }
 
 
@@ -1729,6 +1839,9 @@ bool HumdrumToken::isLabel(void) const {
 //
 
 bool HumdrumToken::isChord(const string& separator) {
+	if (separator == " ") {
+		return (getTextFlags() & TEXT_CHORD) ? true : false;
+	}
 	return (this->find(separator) != string::npos) ? true : false;
 }
 
@@ -1741,8 +1854,7 @@ bool HumdrumToken::isChord(const string& separator) {
 //
 
 bool HumdrumToken::isExclusiveInterpretation(void) const {
-	const string& tok = (string)(*this);
-	return tok.substr(0, 2) == "**";
+	return this->compare(0, 2, "**") == 0;
 }
 
 
@@ -1810,11 +1922,115 @@ bool HumdrumToken::isAddInterpretation(void) const {
 //
 
 bool HumdrumToken::isNull(void) const {
-	const string& tok = (string)(*this);
-	if (tok == NULL_DATA)           { return true; }
-	if (tok == NULL_INTERPRETATION) { return true; }
-	if (tok == NULL_COMMENT_LOCAL)  { return true; }
-	return false;
+	return (getTextFlags() & TEXT_NULL) ? true : false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTextFlags -- Return the TEXT_* flags which describe
+//    the text of the token, calculating them if they have not yet been
+//    analyzed since the last change to the text.
+//
+
+unsigned int HumdrumToken::getTextFlags(void) const {
+	if (m_textflags & TEXT_ANALYZED) {
+		return m_textflags;
+	}
+	unsigned int flags = TEXT_ANALYZED;
+	const string& tok = *this;
+	if ((tok == NULL_DATA) || (tok == NULL_INTERPRETATION) ||
+			(tok == NULL_COMMENT_LOCAL)) {
+		flags |= TEXT_NULL;
+	}
+	for (int i=0; i<(int)tok.size(); i++) {
+		switch (tok[i]) {
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				flags |= TEXT_PITCH;
+				break;
+			case 'r': flags |= TEXT_REST;         break;
+			case '_': flags |= TEXT_TIE_CONTINUE; break;
+			case ']': flags |= TEXT_TIE_CONTINUE; break;
+			case 'q': flags |= TEXT_GRACE;        break;
+			case ' ': flags |= TEXT_CHORD;        break;
+			case '(': flags |= TEXT_SLUR_START;   break;
+			case ')': flags |= TEXT_SLUR_END;     break;
+			case 'L': case 'J': case 'k': case 'K':
+				flags |= TEXT_BEAM;
+				break;
+		}
+	}
+	m_textflags = flags;
+	return flags;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeClass -- Return one of the DATATYPE_* values
+//    for the exclusive interpretation of the token's spine.
+//
+
+int HumdrumToken::getDataTypeClass(void) const {
+	int epoch = getDataTypeEpoch().load(std::memory_order_relaxed);
+	if (m_datatypeEpoch == epoch) {
+		return m_datatype;
+	}
+	const string& datatype = getDataType();
+	if (datatype == "**kern") {
+		m_datatype = DATATYPE_KERN;
+	} else if (datatype == "**mens") {
+		m_datatype = DATATYPE_MENS;
+	} else if (datatype == "**recip") {
+		m_datatype = DATATYPE_RECIP;
+	} else {
+		m_datatype = DATATYPE_OTHER;
+	}
+	m_datatypeEpoch = epoch;
+	return m_datatype;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::clearCachedState -- Forget the text flags and data type
+//    class of the token so that they will be recalculated when next needed.
+//
+
+void HumdrumToken::clearCachedState(void) {
+	m_textflags = 0;
+	m_datatypeEpoch = -1;
+	m_kernnotes.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::invalidateDataTypes -- Force all tokens to look up their
+//    data type again.  Called when an exclusive interpretation is changed
+//    or when the spine starts of a file are rebuilt.
+//
+
+void HumdrumToken::invalidateDataTypes(void) {
+	getDataTypeEpoch().fetch_add(1, std::memory_order_relaxed);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeEpoch -- Counter which is incremented by
+//    invalidateDataTypes().
+//
+
+std::atomic<int>& HumdrumToken::getDataTypeEpoch(void) {
+	static std::atomic<int> epoch(0);
+	return epoch;
 }
 
 
@@ -1912,6 +2128,120 @@ int HumdrumToken::getSubtokenCount(const string& separator) const {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getKernNote -- Return the parsed contents of a **kern
+//    subtoken (a note or rest in a chord).  The text is parsed on the
+//    first call and the results are kept until the text of the token
+//    changes.  An empty record is returned if the index is out of range.
+//    The data type of the token is not checked.
+// default value: index = 0
+// @SEEALSO: getKernNoteCount
+//
+
+const KernNote& HumdrumToken::getKernNote(int index) const {
+	if (m_kernnotes.empty()) {
+		analyzeKernNotes();
+	}
+	if ((index < 0) || (index >= (int)m_kernnotes.size())) {
+		static const KernNote empty;
+		return empty;
+	}
+	return m_kernnotes[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getKernNoteCount -- Return the number of space-separated
+//    subtokens in the token, counted in the same way as getSubtokenCount().
+// @SEEALSO: getKernNote
+//
+
+int HumdrumToken::getKernNoteCount(void) const {
+	if (m_kernnotes.empty()) {
+		analyzeKernNotes();
+	}
+	return (int)m_kernnotes.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getKernNoteFlags -- Return the KernNote::NOTE_* flags of
+//    all subtokens combined, such as KernNote::NOTE_REST if any subtoken
+//    is a rest.
+// @SEEALSO: getKernNote
+//
+
+unsigned int HumdrumToken::getKernNoteFlags(void) const {
+	if (m_kernnotes.empty()) {
+		analyzeKernNotes();
+	}
+	unsigned int output = 0;
+	for (int i=0; i<(int)m_kernnotes.size(); i++) {
+		output |= m_kernnotes[i].getFlags();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getRecipDuration -- Return the duration in quarter notes
+//    of the rhythm in the first subtoken, or 0 if any subtoken is a grace
+//    note, with the same results as Convert::recipToDuration().  The
+//    parsed **kern notes are used if they are available, otherwise only
+//    the first subtoken is parsed and the results are not kept, so that
+//    rhythm analysis does not fill in the note cache of every token.
+//
+
+HumNum HumdrumToken::getRecipDuration(void) const {
+	if (getTextFlags() & TEXT_GRACE) {
+		return 0;
+	}
+	if (!m_kernnotes.empty()) {
+		return m_kernnotes[0].getDuration();
+	}
+	const char* text = this->c_str();
+	const char* space = strchr(text, ' ');
+	KernNote note(text, space ? (int)(space - text) : (int)this->size());
+	return note.getDuration();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::analyzeKernNotes -- Split the token on spaces and parse
+//    each subtoken into m_kernnotes.
+//
+
+void HumdrumToken::analyzeKernNotes(void) const {
+	const char* text = this->data();
+	int length = (int)this->size();
+	int count = 1;
+	for (int i=0; i<length; i++) {
+		if (text[i] == ' ') {
+			count++;
+		}
+	}
+	m_kernnotes.resize(count);
+	int start = 0;
+	int index = 0;
+	for (int i=0; i<=length; i++) {
+		if ((i == length) || (text[i] == ' ')) {
+			m_kernnotes[index++].parse(text + start, i - start);
+			start = i + 1;
+		}
+	}
+}
+
+
+
 /////////////////////////////
 //
 // HumdrumToken::getSubtoken -- Extract the specified sub-token from the token.
@@ -2045,11 +2375,31 @@ void HumdrumToken::setParameters(const string& pdata, HumdrumToken* ptok) {
 
 //////////////////////////////
 //
-// HumdrumToken::setText --
+// HumdrumToken::setText -- Change the text of the token.  If the token
+//    belongs to a HumdrumFile and the new text changes the duration of
+//    the token, whether or not it is null, or whether or not it is data
+//    or a spine manipulator, then the line is marked as edited so that
+//    HumdrumFile::reanalyzeEdits() can repair the analysis of the file.
 //
 
 void HumdrumToken::setText(const string& text) {
+	bool exinterp = isExclusiveInterpretation();
+	bool oldnull  = isNull();
+	bool oldmanip = isManipulator();
+	bool olddata  = isData();
 	string::assign(text);
+	clearCachedState();
+	if (exinterp || isExclusiveInterpretation()) {
+		invalidateDataTypes();
+	}
+	HumdrumLine* line = getOwner();
+	if (!line) {
+		return;
+	}
+	if ((olddata != isData()) || (oldnull != isNull()) || oldmanip ||
+			isManipulator() || hasStaleDuration()) {
+		line->markEdited();
+	}
 }
 
 
@@ -2128,6 +2478,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterCount(void) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 	return (int)m_linkedParameters.size();
 }
 
@@ -2144,6 +2495,7 @@ HumParamSet* HumdrumToken::getLinkedParameter(void) {
 
 
 HumParamSet* HumdrumToken::getLinkedParameter(int index) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 	return m_linkedParameters.at(index)->getLinkedParameter();
 }
 
@@ -2247,6 +2599,7 @@ string HumdrumToken::getVisualDurationNote(int subtokenindex) {
 
 std::string HumdrumToken::getLayoutParameter(const std::string& category,
 		const std::string& keyname, int subtokenindex) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 
 	// First check for any local layout parameter:
 	std::string testoutput = this->getValue("LO", category, keyname);
@@ -2336,6 +2689,7 @@ std::string HumdrumToken::getLayoutParameter(const std::string& category,
 
 std::string HumdrumToken::getSlurLayoutParameter(const std::string& keyname,
 		int subtokenindex) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 	std::string category = "S";
 	std::string output;
 
@@ -2409,6 +2763,7 @@ std::string HumdrumToken::getSlurLayoutParameter(const std::string& keyname,
 
 std::string HumdrumToken::getLayoutParameterChord(const std::string& category,
 		const std::string& keyname) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 
 	// First check for any local layout parameter:
 	std::string testoutput = this->getValue("LO", category, keyname);
@@ -2468,6 +2823,7 @@ std::string HumdrumToken::getLayoutParameterChord(const std::string& category,
 
 std::string HumdrumToken::getLayoutParameterNote(const std::string& category,
 		const std::string& keyname, int subtokenindex) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 
 	// First check for any local layout parameter:
 	std::string testoutput = this->getValue("LO", category, keyname);
@@ -2538,6 +2894,7 @@ std::string HumdrumToken::getLayoutParameterNote(const std::string& category,
 
 void HumdrumToken::setOwner(HumdrumLine* aLine) {
 	m_address.setOwner(aLine);
+	m_datatypeEpoch = -1;
 }
 
 
@@ -2573,6 +2930,7 @@ int HumdrumToken::getState(void) const {
 //
 
 int  HumdrumToken::getStrandIndex(void) const {
+	checkAnalysis(ANALYZE_STRANDS);
 	return m_strand;
 }
 
@@ -2650,6 +3008,9 @@ void HumdrumToken::incrementState(void) {
 //
 
 int HumdrumToken::getNextTokenCount(void) const {
+	if (m_nextTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return (int)m_nextTokens.size();
 }
 
@@ -2665,6 +3026,9 @@ int HumdrumToken::getNextTokenCount(void) const {
 //
 
 int HumdrumToken::getPreviousTokenCount(void) const {
+	if (m_previousTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return (int)m_previousTokens.size();
 }
 
@@ -3031,6 +3395,7 @@ ostream& printSequence(vector<HTp>& sequence, ostream& out) {
 //
 
 HTp HumdrumToken::getSlurStartToken(int number) {
+	checkAnalysis(ANALYZE_SLURS);
 	string tag = "slurStart";
 	if (number > 1) {
 		tag += to_string(number);
@@ -3049,6 +3414,7 @@ HTp HumdrumToken::getSlurStartToken(int number) {
 //
 
 HTp HumdrumToken::getSlurEndToken(int number) {
+	checkAnalysis(ANALYZE_SLURS);
 	string tag = "slurEnd";
 	if (number > 1) {
 		tag += to_string(number);
@@ -0,0 +1,305 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Fri Oct 16 10:13:17 PDT 2026
+// Last Modified: Fri Oct 16 10:13:17 PDT 2026
+// Filename:      KernNote.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/KernNote.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Parsed contents of a single **kern subtoken.
+//
+
+#include "KernNote.h"
+
+#include <ctype.h>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// KernNote::KernNote -- Constructor.  The default constructor gives the
+//    values for an empty subtoken.
+//
+
+KernNote::KernNote(void) {
+	parse("", 0);
+}
+
+
+KernNote::KernNote(const char* text, int length) {
+	parse(text, length);
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::parse -- Extract the pitch, rhythm and markers from the text
+//    of a single **kern subtoken (which should not contain spaces) in
+//    one pass.  The rules follow those of Convert::kernToDiatonicPC(),
+//    Convert::kernToOctaveNumber(), Convert::recipToDuration() and the
+//    related functions so that results are the same as calling them
+//    individually on the subtoken.
+//
+
+void KernNote::parse(const char* text, int length) {
+	m_diatonic   = -2000;
+	m_letter     = 'X';
+	m_accidental = 0;
+	m_flags      = 0;
+	m_stem       = '\0';
+
+	int  uc        = 0;     // count of uppercase pitch letters
+	int  lc        = 0;     // count of lowercase pitch letters
+	int  dots      = 0;
+	bool hasrhythm = false; // found first digit
+	bool innumber  = false; // still reading the first number
+	int  number    = 0;     // value of the first number
+	int  zeros     = 0;     // leading zeros of the first number
+	bool inzeros   = false;
+	bool hasrecip  = false; // found "%"
+	bool innumer   = false; // reading the number after "%"
+	int  numer     = 1;     // value of the number after "%"
+
+	for (int i=0; i<length; i++) {
+		char ch = text[i];
+
+		if (innumber) {
+			if (isdigit(ch)) {
+				number = number * 10 + (ch - '0');
+				if (inzeros && (ch == '0')) {
+					zeros++;
+				} else {
+					inzeros = false;
+				}
+			} else {
+				innumber = false;
+				inzeros = false;
+			}
+		} else if (!hasrhythm && isdigit(ch)) {
+			hasrhythm = true;
+			innumber  = true;
+			number    = ch - '0';
+			inzeros   = (ch == '0');
+			zeros     = inzeros ? 1 : 0;
+		}
+		if (innumer) {
+			if (isdigit(ch)) {
+				numer = numer * 10 + (ch - '0');
+			} else {
+				innumer = false;
+			}
+		}
+
+		switch (ch) {
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+				lc++;
+				m_flags |= NOTE_PITCH;
+				if (m_diatonic == -2000) {
+					m_letter = toupper(ch);
+					m_diatonic = (ch - 'a' + 5) % 7;
+				}
+				break;
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				uc++;
+				m_flags |= NOTE_PITCH;
+				if (m_diatonic == -2000) {
+					m_letter = ch;
+					m_diatonic = (ch - 'A' + 5) % 7;
+				}
+				break;
+			case 'r':
+				m_flags |= NOTE_REST;
+				if (m_diatonic == -2000) {
+					m_letter = 'R';
+					m_diatonic = -1000;
+				}
+				break;
+			case '-':  m_accidental--;                 break;
+			case '#':  m_accidental++;                 break;
+			case '.':  dots++;                         break;
+			case '[':  m_flags |= NOTE_TIE_START;      break;
+			case '_':  m_flags |= NOTE_TIE_CONTINUE;   break;
+			case ']':  m_flags |= NOTE_TIE_END;        break;
+			case '(':  m_flags |= NOTE_SLUR_START;     break;
+			case ')':  m_flags |= NOTE_SLUR_END;       break;
+			case 'L':  m_flags |= NOTE_BEAM_START;     break;
+			case 'J':  m_flags |= NOTE_BEAM_END;       break;
+			case 'k':  m_flags |= NOTE_BEAM_PARTIAL;   break;
+			case 'K':  m_flags |= NOTE_BEAM_PARTIAL;   break;
+			case 'q':  m_flags |= NOTE_GRACE;          break;
+			case '\'': m_flags |= NOTE_STACCATO;       break;
+			case '`':  m_flags |= NOTE_STACCATISSIMO;  break;
+			case '^':  m_flags |= NOTE_ACCENT;         break;
+			case '~':  m_flags |= NOTE_TENUTO;         break;
+			case ';':  m_flags |= NOTE_FERMATA;        break;
+			case 'n':  m_flags |= NOTE_NATURAL;        break;
+			case '/':
+			case '\\':
+				if (m_stem == '\0') {
+					m_stem = ch;
+				}
+				break;
+			case '%':
+				if (!hasrecip) {
+					hasrecip = true;
+					if ((i + 1 < length) && isdigit(text[i+1])) {
+						innumer = true;
+						numer = 0;
+					}
+				}
+				break;
+		}
+	}
+
+	// octave (see Convert::kernToOctaveNumber):
+	if ((m_flags & NOTE_REST) || ((uc > 0) && (lc > 0))) {
+		m_octave = -1000;
+	} else if (uc > 0) {
+		m_octave = 4 - uc;
+	} else if (lc > 0) {
+		m_octave = 3 + lc;
+	} else {
+		m_octave = -1000;
+	}
+
+	// base-40 pitch (see Convert::kernToBase40):
+	m_base40 = getBase40PC();
+	if (m_base40 >= 0) {
+		m_base40 += 40 * m_octave;
+	}
+
+	// rhythm (see Convert::recipToDuration):
+	m_dots = (unsigned char)(dots > 255 ? 255 : dots);
+	HumNum output;
+	if (hasrecip && hasrhythm) {
+		output.setValue(numer, number);
+	} else if (!hasrhythm) {
+		output = 0;
+	} else if (zeros > 0) {
+		output.setValue(1 << zeros, 1);
+	} else {
+		output.setValue(1, number);
+	}
+	if (hasrhythm && (dots > 0)) {
+		HumNum factor((1 << (dots + 1)) - 1, 1 << dots);
+		output *= factor;
+	}
+	m_visual = output * 4;
+	if (m_flags & NOTE_GRACE) {
+		m_duration = 0;
+	} else {
+		m_duration = m_visual;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::isSecondaryTiedNote -- True if a note with a tie continuation
+//    or tie end marker.
+//
+
+bool KernNote::isSecondaryTiedNote(void) const {
+	if (!(m_flags & NOTE_PITCH)) {
+		return false;
+	}
+	return (m_flags & (NOTE_TIE_CONTINUE | NOTE_TIE_END)) ? true : false;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getDiatonicLC -- Lowercase diatonic letter, 'r' for rests,
+//    or 'x' if there is no pitch.
+//
+
+char KernNote::getDiatonicLC(void) const {
+	return tolower(m_letter);
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase40PC -- Base-40 pitch class, or the diatonic value if
+//    it is negative.
+//
+
+int KernNote::getBase40PC(void) const {
+	if (m_diatonic < 0) {
+		return m_diatonic;
+	}
+	static const int b40[7] = { 0, 6, 12, 17, 23, 29, 35 };
+	return b40[m_diatonic] + m_accidental + 2;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase12PC -- Base-12 pitch class, or the diatonic value if
+//    it is negative.
+//
+
+int KernNote::getBase12PC(void) const {
+	if (m_diatonic < 0) {
+		return m_diatonic;
+	}
+	static const int b12[7] = { 0, 2, 4, 5, 7, 9, 11 };
+	return b12[m_diatonic] + m_accidental;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase12 -- Base-12 pitch (middle C = 48).
+//
+
+int KernNote::getBase12(void) const {
+	return getBase12PC() + 12 * m_octave;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase7 -- Diatonic pitch (middle C = 28), or the diatonic
+//    value if it is negative.
+//
+
+int KernNote::getBase7(void) const {
+	if (m_diatonic < 0) {
+		return m_diatonic;
+	}
+	return m_diatonic + 7 * m_octave;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getMidiNoteNumber -- MIDI key number (middle C = 60).
+//
+
+int KernNote::getMidiNoteNumber(void) const {
+	return getBase12PC() + 12 * (m_octave + 1);
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -23,83 +23,15 @@ namespace hum {
 
 //////////////////////////////
 //
-// NoteCell::NoteCell -- Constructor.
+// NoteCell::NoteCell -- Constructor.  The pitch and attack data for
+//    the cell are stored in the owner's arrays at the given index.
 //
 
-NoteCell::NoteCell(NoteGrid* owner, HTp token) {
-	clear();
+NoteCell::NoteCell(NoteGrid* owner, int index, int voice, int slice) {
 	m_owner = owner;
-	m_token = token;
-	calculateNumericPitches();
-}
-
-
-
-//////////////////////////////
-//
-// NoteCell::clear -- Clear the contents of the object.
-//
-
-void NoteCell::clear(void) {
-	m_owner = NULL;
-	m_token = NULL;
-	m_b7  = 0;
-	m_b12 = 0;
-	m_b40 = 0;
-	m_accidental = 0;
-	m_nextAttackIndex = -1;
-	m_prevAttackIndex = -1;
-	m_currAttackIndex = -1;
-	m_timeslice = -1;
-	m_voice = -1;
-}
-
-
-
-//////////////////////////////
-//
-// NoteCell::calculateNumericPitches -- Fills in b7, b12, and b40 variables.
-//    0 = rest, negative values for sustained notes.
-//
-
-void NoteCell::calculateNumericPitches(void) {
-	if (!m_token) {
-		m_b40        = NAN;
-		m_b12        = NAN;
-		m_b7         = NAN;
-		m_accidental = NAN;
-		return;
-	}
-
-	bool sustain = m_token->isNull() || m_token->isSecondaryTiedNote();
-	if (m_token->isRest()) {
-		m_b40 = NAN;
-	} else {
-		HTp resolve = m_token->resolveNull();
-		if (resolve->isRest()) {
-			m_b40 = NAN;
-		} else if (resolve->isNull()) {
-			m_b40 = NAN;
-		} else {
-			m_b40 = Convert::kernToBase40(resolve);
-			m_b40 = (sustain ? -m_b40 : m_b40);
-		}
-	}
-
-	// convert to base-7 (diatonic pitch numbers)
-	if (m_b40 > 0) {
-		m_b7         = Convert::base40ToDiatonic((int)m_b40);
-		m_b12        = Convert::base40ToMidiNoteNumber((int)m_b40);
-		m_accidental = Convert::base40ToAccidental((int)m_b40);
-	} else if (m_b40 < 0) {
-		m_b7         = -Convert::base40ToDiatonic(-(int)m_b40);
-		m_b12        = -Convert::base40ToMidiNoteNumber(-(int)m_b40);
-		m_accidental = -Convert::base40ToAccidental(-(int)m_b40);
-	} else {
-		m_b7         = NAN;
-		m_b12        = NAN;
-		m_accidental = NAN;
-	}
+	m_index = index;
+	m_voice = voice;
+	m_timeslice = slice;
 }
 
 
@@ -146,13 +78,14 @@ string NoteCell::getAbsKernPitch(void) {
 //
 
 bool NoteCell::isSustained(void) {
-	if (m_b40 < 0) {
+	int b40 = m_owner->m_b40[m_index];
+	if (b40 < 0) {
 		return true;
-	} else if (m_b40 > 0) {
+	} else if (b40 > 0) {
 		return false;
 	}
 	// calculate if rest is a "sustain" or an "attack"
-	if (m_currAttackIndex == m_timeslice) {
+	if (getCurrAttackIndex() == m_timeslice) {
 		return false;
 	} else {
 		return true;
@@ -188,10 +121,11 @@ double NoteCell::operator-(int B) {
 //
 
 int NoteCell::getLineIndex(void) {
-	if (!m_token) {
+	HTp token = getToken();
+	if (!token) {
 		return -1;
 	}
-	return m_token->getLineIndex();
+	return token->getLineIndex();
 }
 
 
@@ -203,10 +137,11 @@ int NoteCell::getLineIndex(void) {
 //
 
 int NoteCell::getFieldIndex(void) {
-	if (!m_token) {
+	HTp token = getToken();
+	if (!token) {
 		return -1;
 	}
-	return m_token->getFieldIndex();
+	return token->getFieldIndex();
 }
 
 
@@ -241,9 +176,6 @@ double NoteCell::getDiatonicIntervalFromPreviousAttack(void) {
 	if (previ < 0) {
 		return NAN;
 	}
-	if (!m_owner) {
-		return NAN;
-	}
 	return getAbsDiatonicPitch()
 			- m_owner->cell(m_voice,previ)->getAbsDiatonicPitch();
 }
@@ -260,36 +192,18 @@ double NoteCell::getDiatonicIntervalToNextAttack(void) {
 	if (nexti < 0) {
 		return NAN;
 	}
-	if (!m_owner) {
-		return NAN;
-	}
 	return m_owner->cell(m_voice,nexti)->getAbsDiatonicPitch()
 			- getAbsDiatonicPitch();
 }
 
 
 
-//////////////////////////////
-//
-// NoteCell::isRest --
-//
-
-bool NoteCell::isRest(void) {
-	// bug in GCC requires :: prefix to resolve two different isnan() defs.
-	return Convert::isNaN(m_b40);
-}
-
-
-
 //////////////////////////////
 //
 // NoteCell::getMetricLevel --
 //
 
 double NoteCell::getMetricLevel(void) {
-	if (!m_owner) {
-		return NAN;
-	}
 	return m_owner->getMetricLevel(getLineIndex());
 }
 
@@ -301,8 +215,9 @@ double NoteCell::getMetricLevel(void) {
 //
 
 HumNum NoteCell::getDurationFromStart(void) {
-	if (m_token) {
-		return m_token->getDurationFromStart();
+	HTp token = getToken();
+	if (token) {
+		return token->getDurationFromStart();
 	} else {
 		return -1;
 	}
@@ -316,33 +231,18 @@ HumNum NoteCell::getDurationFromStart(void) {
 //
 
 HumNum NoteCell::getDuration(void) {
-	if (!m_owner) {
-		return Convert::recipToDuration(m_token);
-	}
 	return m_owner->getNoteDuration(getVoiceIndex(), getSliceIndex());
 }
 
 
 
-//////////////////////////////
-//
-// NoteCell::setMeter --
-//
-
-void NoteCell::setMeter(int topval, HumNum botval) {
-	m_metertop = topval;
-	m_meterbot = botval;
-}
-
-
-
 //////////////////////////////
 //
 // NoteCell::getMeterTop --
 //
 
 int NoteCell::getMeterTop(void) {
-	return m_metertop;
+	return m_owner->m_metertops[m_index];
 }
 
 
@@ -353,7 +253,7 @@ int NoteCell::getMeterTop(void) {
 //
 
 HumNum NoteCell::getMeterBottom(void) {
-	return m_meterbot;
+	return m_owner->m_meterbots[m_index];
 }
 
 
@@ -364,12 +264,14 @@ HumNum NoteCell::getMeterBottom(void) {
 //
 
 double NoteCell::getSgnDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) {
 		return GRIDREST;
-	} else if (m_b7 < 0) {
-		return -(double)(((int)-m_b7) % 7);
+	}
+	int b7 = m_owner->m_b7[m_index];
+	if (b7 < 0) {
+		return -(double)(-b7 % 7);
 	} else {
-		return (double)(((int)m_b7) % 7);
+		return (double)(b7 % 7);
 	}
 }
 
@@ -381,10 +283,10 @@ double NoteCell::getSgnDiatonicPitchClass(void) {
 //
 
 double NoteCell::getAbsDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b7)) % 7);
+		return (double)(abs(m_owner->m_b7[m_index]) % 7);
 	}
 }
 
@@ -396,12 +298,14 @@ double NoteCell::getAbsDiatonicPitchClass(void) {
 //
 
 double NoteCell::getSgnBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) {
 		return GRIDREST;
-	} else if (m_b40 < 0) {
-		return -(double)(((int)-m_b40) % 40);
+	}
+	int b40 = m_owner->m_b40[m_index];
+	if (b40 < 0) {
+		return -(double)(-b40 % 40);
 	} else {
-		return (double)(((int)m_b40) % 40);
+		return (double)(b40 % 40);
 	}
 }
 
@@ -413,24 +317,11 @@ double NoteCell::getSgnBase40PitchClass(void) {
 //
 
 double NoteCell::getAbsBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b40)) % 40);
-	}
-}
-
-
-//////////////////////////////
-//
-// NoteCell::isAttack --
-//
-
-bool NoteCell::isAttack(void) {
-	if (Convert::isNaN(m_b40)) {
-		return false;
+		return (double)(abs(m_owner->m_b40[m_index]) % 40);
 	}
-	return m_b40>0? true:false;
 }
 
 
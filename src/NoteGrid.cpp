@@ -13,6 +13,7 @@
 
 #include "NoteGrid.h"
 #include "HumRegex.h"
+#include "Convert.h"
 
 using namespace std;
 
@@ -51,19 +52,23 @@ NoteGrid::~NoteGrid() {
 void NoteGrid::clear(void) {
 	m_infile = NULL;
 	m_kernspines.clear();
+	m_metriclevels.clear();
 
-	vector<vector<NoteCell* > >& grid = m_grid;
-	for (int i=0; i<(int)grid.size(); i++) {
-		for (int j=0; j<(int)grid[i].size(); j++) {
-			if (grid[i][j]) {
-				grid[i][j]->clear();
-				delete grid[i][j];
-				grid[i][j] = NULL;
-			}
-		}
-		grid[i].clear();
-	}
-	grid.clear();
+	m_cells.clear();
+	m_tokens.clear();
+	m_b7.clear();
+	m_b12.clear();
+	m_b40.clear();
+	m_accidental.clear();
+	m_flags.clear();
+	m_prevattack.clear();
+	m_currattack.clear();
+	m_nextattack.clear();
+	m_durations.clear();
+	m_metertops.clear();
+	m_meterbots.clear();
+	m_voices = 0;
+	m_slices = 0;
 }
 
 
@@ -74,7 +79,7 @@ void NoteGrid::clear(void) {
 //
 
 int NoteGrid::getVoiceCount(void) {
-	return (int)m_grid.size();
+	return m_voices;
 }
 
 
@@ -86,11 +91,7 @@ int NoteGrid::getVoiceCount(void) {
 //
 
 int NoteGrid::getSliceCount(void) {
-	if (m_grid.size() == 0) {
-		return 0;
-	} else {
-		return (int)m_grid[0].size();
-	}
+	return m_slices;
 }
 
 
@@ -119,16 +120,22 @@ bool NoteGrid::load(HumdrumFile& infile) {
 		return false;
 	}
 
-	vector<vector<NoteCell* > >& grid = m_grid;
-	grid.resize(kernspines.size());
-	for (int i=0; i<(int)grid.size(); i++) {
-		grid[i].reserve(infile.getLineCount());
-	}
+	// The cells are collected one slice at a time, and then stored
+	// by voice after all slices are known.
+	int voices = (int)kernspines.size();
+	vector<HTp> slicetokens;
+	vector<int> slicetops;
+	vector<HumNum> slicebots;
+	slicetokens.reserve(voices * infile.getLineCount());
 
 	int attack = 0;
 	int track, lasttrack;
 	vector<HTp> current;
-	HumRegex hre;
+	bool status = true;
+	HumRegex hrerecip;
+	hrerecip.compile("\\*M(\\d+)/(\\d+)%(\\d+)");
+	HumRegex hremeter;
+	hremeter.compile("\\*M(\\d+)/(\\d+)");
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (infile[i].isInterpretation()) {
 			for (int j=0; j<infile[i].getFieldCount(); j++) {
@@ -136,13 +143,13 @@ bool NoteGrid::load(HumdrumFile& infile) {
 					continue;
 				}
 				track = infile.token(i, j)->getTrack();
-				if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)%(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-					meterbots[track] /= hre.getMatchInt(3);
-				} else if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
+				if (hrerecip.search(*infile.token(i, j))) {
+					metertops[track] = hrerecip.getMatchInt(1);
+					meterbots[track] = hrerecip.getMatchInt(2);
+					meterbots[track] /= hrerecip.getMatchInt(3);
+				} else if (hremeter.search(*infile.token(i, j))) {
+					metertops[track] = hremeter.getMatchInt(1);
+					meterbots[track] = hremeter.getMatchInt(2);
 				} else {
 					continue;
 				}
@@ -174,21 +181,56 @@ bool NoteGrid::load(HumdrumFile& infile) {
 		if (current.size() != kernspines.size()) {
 			cerr << "Error: Unequal vector sizes " << current.size()
 			     << " compared to " << kernspines.size() << endl;
-			return false;
+			// Keep the slices read so far (without attack indexes).
+			status = false;
+			break;
 		}
 		for (int j=0; j<(int)current.size(); j++) {
-			NoteCell* cell = new NoteCell(this, current[j]);
 			track = current[j]->getTrack();
-			cell->setVoiceIndex(j);
-			cell->setSliceIndex((int)grid[j].size());
-			cell->setMeter(metertops[track], meterbots[track]);
-			grid[j].push_back(cell);
+			slicetokens.push_back(current[j]);
+			slicetops.push_back(metertops[track]);
+			slicebots.push_back(meterbots[track]);
+		}
+	}
+
+	m_voices = voices;
+	m_slices = (int)slicetokens.size() / voices;
+	int size = m_voices * m_slices;
+	m_tokens.resize(size);
+	m_metertops.resize(size);
+	m_meterbots.resize(size);
+	for (int v=0; v<m_voices; v++) {
+		for (int s=0; s<m_slices; s++) {
+			int index = v * m_slices + s;
+			int sindex = s * m_voices + v;
+			m_tokens[index] = slicetokens[sindex];
+			m_metertops[index] = slicetops[sindex];
+			m_meterbots[index] = slicebots[sindex];
 		}
 	}
 
-	buildAttackIndexes();
+	m_b7.resize(size);
+	m_b12.resize(size);
+	m_b40.resize(size);
+	m_accidental.resize(size);
+	m_flags.resize(size);
+	m_prevattack.assign(size, -1);
+	m_currattack.assign(size, -1);
+	m_nextattack.assign(size, -1);
+	m_cells.reserve(size);
+	for (int v=0; v<m_voices; v++) {
+		for (int s=0; s<m_slices; s++) {
+			int index = v * m_slices + s;
+			m_cells.emplace_back(this, index, v, s);
+			calculateNumericPitches(index);
+		}
+	}
+
+	if (status) {
+		buildAttackIndexes();
+	}
 
-	return true;
+	return status;
 }
 
 
@@ -199,7 +241,50 @@ bool NoteGrid::load(HumdrumFile& infile) {
 //
 
 NoteCell* NoteGrid::cell(int voiceindex, int sliceindex) {
-	return m_grid.at(voiceindex).at(sliceindex);
+	return &m_cells[getIndex(voiceindex, sliceindex)];
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::calculateNumericPitches -- Fills in the diatonic, MIDI and
+//    base-40 pitches of a cell.  Values are negative for sustained notes.
+//    Rests are marked with CELL_REST and CELL_NOPITCH, and unpitched
+//    notes with CELL_NOPITCH.
+//
+
+void NoteGrid::calculateNumericPitches(int index) {
+	HTp token = m_tokens[index];
+	int b40 = 0;
+	bool rest = true;
+	if (token && !token->isRest()) {
+		bool sustain = token->isNull() || token->isSecondaryTiedNote();
+		HTp resolve = token->resolveNull();
+		if (!(resolve->isRest() || resolve->isNull())) {
+			b40 = Convert::kernToBase40(resolve);
+			b40 = (sustain ? -b40 : b40);
+			rest = false;
+		}
+	}
+
+	m_flags[index] = rest ? (CELL_REST | CELL_NOPITCH) : 0;
+	// convert to base-7 (diatonic pitch numbers)
+	if (b40 > 0) {
+		m_b7[index]         = Convert::base40ToDiatonic(b40);
+		m_b12[index]        = Convert::base40ToMidiNoteNumber(b40);
+		m_accidental[index] = Convert::base40ToAccidental(b40);
+	} else if (b40 < 0) {
+		m_b7[index]         = -Convert::base40ToDiatonic(-b40);
+		m_b12[index]        = -Convert::base40ToMidiNoteNumber(-b40);
+		m_accidental[index] = -Convert::base40ToAccidental(-b40);
+	} else {
+		m_b7[index]         = 0;
+		m_b12[index]        = 0;
+		m_accidental[index] = 0;
+		m_flags[index]     |= CELL_NOPITCH;
+	}
+	m_b40[index] = b40;
 }
 
 
@@ -307,7 +392,7 @@ void NoteGrid::printKernGrid(ostream& output) {
 //
 
 void NoteGrid::buildAttackIndexes(void) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
+	for (int i=0; i<m_voices; i++) {
 		buildAttackIndex(i);
 	}
 }
@@ -321,7 +406,13 @@ void NoteGrid::buildAttackIndexes(void) {
 //
 
 void NoteGrid::buildAttackIndex(int vindex) {
-	vector<NoteCell*>& part = m_grid[vindex];
+	int count = m_slices;
+	int base = vindex * m_slices;
+	NoteCell* part = m_cells.data() + base;
+	HTp* tokens = m_tokens.data() + base;
+	int* curr = m_currattack.data() + base;
+	int* prev = m_prevattack.data() + base;
+	int* next = m_nextattack.data() + base;
 
 	// Set the slice index for the attack of the current note.  This
 	// will be the same as the current slice if the NoteCell is an attack.
@@ -330,46 +421,46 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	// For rests, the first rest in a continuous sequence of rests
 	// will be marked as the "attack" of the rest.
 	NoteCell* currentcell = NULL;
-	for (int i=0; i<(int)part.size(); i++) {
+	for (int i=0; i<count; i++) {
 		if (i == 0) {
-			part[0]->setCurrAttackIndex(0);
+			curr[0] = 0;
 			continue;
 		}
-		if (part[i]->isRest()) {
+		if (part[i].isRest()) {
 			// This is a rest, so check for a rest sustain or start
 			// of a rest sequence.
-			if (part[i-1]->isRest()) {
+			if (part[i-1].isRest()) {
 				// rest "sustain"
-				if (currentcell && !part[i]->getToken()->isNull()) {
-					currentcell->m_tiedtokens.push_back(part[i]->getToken());
+				if (currentcell && !tokens[i]->isNull()) {
+					currentcell->m_tiedtokens.push_back(tokens[i]);
 				}
-				part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
+				curr[i] = curr[i-1];
 			} else {
 				// rest "attack";
-				part[i]->setCurrAttackIndex(i);
+				curr[i] = i;
 			}
-		} else if (part[i]->isAttack()) {
-			part[i]->setCurrAttackIndex(i);
-			currentcell = part[i];
+		} else if (part[i].isAttack()) {
+			curr[i] = i;
+			currentcell = &part[i];
 		} else {
 			// This is a sustain, so get the attack index of the
 			// note from the previous slice index.
-			part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			if (currentcell && !part[i]->getToken()->isNull()) {
-				currentcell->m_tiedtokens.push_back(part[i]->getToken());
+			curr[i] = curr[i-1];
+			if (currentcell && !tokens[i]->isNull()) {
+				currentcell->m_tiedtokens.push_back(tokens[i]);
 			}
 		}
 	}
 
 	// start with note attacks marked in the previous and next note slots:
-	for (int i=0; i<(int)part.size(); i++) {
-		if (part[i]->isAttack()) {
-			part[i]->setNextAttackIndex(i);
-			part[i]->setPrevAttackIndex(i);
-		} else if (part[i]->isRest()) {
-			if (part[i]->getCurrAttackIndex() == i) {
-				part[i]->setNextAttackIndex(i);
-				part[i]->setPrevAttackIndex(i);
+	for (int i=0; i<count; i++) {
+		if (part[i].isAttack()) {
+			next[i] = i;
+			prev[i] = i;
+		} else if (part[i].isRest()) {
+			if (curr[i] == i) {
+				next[i] = i;
+				prev[i] = i;
 			}
 		}
 	}
@@ -377,27 +468,27 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	// Go back and adjust the next note attack index:
 	int value = -1;
 	int temp  = -1;
-	for (int i=(int)part.size()-1; i>=0; i--) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getNextAttackIndex();
-			part[i]->setNextAttackIndex(value);
+	for (int i=count-1; i>=0; i--) {
+		if (!part[i].isSustained()) {
+			temp = next[i];
+			next[i] = value;
 			value = temp;
 		} else {
-			part[i]->setNextAttackIndex(value);
+			next[i] = value;
 		}
 	}
 
 	// Go back and adjust the previous note attack index:
 	value = -1;
 	temp  = -1;
-	for (int i=0; i<(int)part.size(); i++) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getPrevAttackIndex();
-			part[i]->setPrevAttackIndex(value);
+	for (int i=0; i<count; i++) {
+		if (!part[i].isSustained()) {
+			temp = prev[i];
+			prev[i] = value;
 			value = temp;
 		} else {
 			if (i != 0) {
-				part[i]->setPrevAttackIndex(part[i-1]->getPrevAttackIndex());
+				prev[i] = prev[i-1];
 			}
 		}
 	}
@@ -413,7 +504,7 @@ void NoteGrid::buildAttackIndex(int vindex) {
 //
 
 double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsDiatonicPitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsDiatonicPitch();
 }
 
 
@@ -425,7 +516,7 @@ double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnDiatonicPitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnDiatonicPitch();
 }
 
 
@@ -437,7 +528,7 @@ double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsMidiPitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsMidiPitch();
 }
 
 
@@ -449,7 +540,7 @@ double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnMidiPitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnMidiPitch();
 }
 
 
@@ -461,7 +552,7 @@ double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsBase40Pitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsBase40Pitch();
 }
 
 
@@ -473,7 +564,7 @@ double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnBase40Pitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnBase40Pitch();
 }
 
 
@@ -485,7 +576,7 @@ double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsKernPitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsKernPitch();
 }
 
 
@@ -497,7 +588,7 @@ string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnKernPitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnKernPitch();
 }
 
 
@@ -509,7 +600,7 @@ string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
 //
 
 HTp NoteGrid::getToken(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getToken();
+	return m_cells[getIndex(vindex, sindex)].getToken();
 }
 
 
@@ -523,8 +614,7 @@ HTp NoteGrid::getToken(int vindex, int sindex) {
 //
 
 int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getPrevAttackIndex();
+	int index = m_prevattack[getIndex(vindex, sindex)];
 	if (index < 0) {
 		return 0;
 	} else {
@@ -543,8 +633,7 @@ int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getNextAttackIndex();
+	int index = m_nextattack[getIndex(vindex, sindex)];
 	if (index < 0) {
 		return 0;
 	} else {
@@ -561,10 +650,10 @@ int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getLineIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_voices == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getLineIndex();
+	return m_tokens[getIndex(0, sindex)]->getLineIndex();
 }
 
 
@@ -576,10 +665,10 @@ int NoteGrid::getLineIndex(int sindex) {
 //
 
 int NoteGrid::getFieldIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_voices == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getFieldIndex();
+	return m_tokens[getIndex(0, sindex)]->getFieldIndex();
 }
 
 
@@ -643,18 +732,44 @@ double NoteGrid::getMetricLevel(int sindex) {
 //
 
 HumNum NoteGrid::getNoteDuration(int vindex, int sindex) {
-	NoteCell* curnote = cell(vindex, sindex);
-	int attacki = curnote->getCurrAttackIndex();
-	int nexti   = curnote->getNextAttackIndex();
-	HumNum starttime = 0;
-	if (attacki >= 0) {
-		starttime = cell(vindex, attacki)->getDurationFromStart();
+	int index = getIndex(vindex, sindex);
+	if (m_durations.empty()) {
+		buildDurations();
 	}
-	HumNum endtime = m_infile->getScoreDuration();;
-	if (nexti >= 0) {
-		endtime = cell(vindex, nexti)->getDurationFromStart();
+	return m_durations[index];
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::buildDurations -- Calculate the duration of the note (or
+//     rest) in each cell, from its attack to the next note attack in
+//     the voice (or to the end of the score).
+//
+
+void NoteGrid::buildDurations(void) {
+	// Time of each slice in the score (the same for all voices).
+	vector<HumNum> slicetimes(m_slices);
+	for (int s=0; s<m_slices; s++) {
+		slicetimes[s] = m_tokens[s]->getDurationFromStart();
+	}
+	HumNum scoreduration = m_infile->getScoreDuration();
+
+	m_durations.resize(m_voices * m_slices);
+	for (int i=0; i<(int)m_durations.size(); i++) {
+		int attacki = m_currattack[i];
+		int nexti   = m_nextattack[i];
+		HumNum starttime = 0;
+		if (attacki >= 0) {
+			starttime = slicetimes[attacki];
+		}
+		HumNum endtime = scoreduration;
+		if (nexti >= 0) {
+			endtime = slicetimes[nexti];
+		}
+		m_durations[i] = endtime - starttime;
 	}
-	return endtime - starttime;
 }
 
 
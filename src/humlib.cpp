@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Thu Oct 17 00:23:09 PDT 2019
+// Last Modified: Sat Oct 17 01:53:46 UTC 2026
 // Filename:      /include/humlib.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/humlib.cpp
 // Syntax:        C++11
@@ -499,6 +499,18 @@ bool Convert::isKernSecondaryTiedNote(const string& kerndata) {
 	return false;
 }
 
+//
+// HTp version:
+//
+
+bool Convert::isKernSecondaryTiedNote(HTp token) {
+	unsigned int flags = token->getKernNoteFlags();
+	if (!(flags & KernNote::NOTE_PITCH)) {
+		return false;
+	}
+	return (flags & (KernNote::NOTE_TIE_CONTINUE | KernNote::NOTE_TIE_END)) != 0;
+}
+
 
 
 //////////////////////////////
@@ -522,6 +534,18 @@ bool Convert::isKernNoteAttack(const string& kerndata) {
 	return true;
 }
 
+//
+// HTp version:
+//
+
+bool Convert::isKernNoteAttack(HTp token) {
+	unsigned int flags = token->getKernNoteFlags();
+	if (!(flags & KernNote::NOTE_PITCH)) {
+		return false;
+	}
+	return (flags & (KernNote::NOTE_TIE_CONTINUE | KernNote::NOTE_TIE_END)) == 0;
+}
+
 
 
 //////////////////////////////
@@ -719,6 +743,36 @@ int Convert::getLcm(const vector<int>& numbers) {
 
 
 
+//////////////////////////////
+//
+// Convert::getLcm64 -- Return the Least Common Multiple of a list of
+//     positive numbers, calculated in 64-bit integers.  Returns 0 if a
+//     number is not positive or if the LCM does not fit in a long long.
+//
+
+long long Convert::getLcm64(const vector<int>& numbers) {
+	if (numbers.size() == 0) {
+		return 1;
+	}
+	if (numbers[0] <= 0) {
+		return 0;
+	}
+	long long output = numbers[0];
+	for (int i=1; i<(int)numbers.size(); i++) {
+		if (numbers[i] <= 0) {
+			return 0;
+		}
+		long long factor = numbers[i] / getGcd((int)(output % numbers[i]), numbers[i]);
+		if (output > std::numeric_limits<long long>::max() / factor) {
+			return 0;
+		}
+		output *= factor;
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // Convert::getGcd -- Return the Greatest Common Divisor of two numbers.
@@ -2812,6 +2866,15 @@ HumNum Convert::recipToDuration(string* recip, HumNum scale,
 }
 
 
+HumNum Convert::recipToDuration(const HumdrumToken* token, HumNum scale,
+		const string& separator) {
+	if (separator != " ") {
+		return Convert::recipToDuration(*token, scale, separator);
+	}
+	return token->getRecipDuration() * scale / 4;
+}
+
+
 HumNum Convert::recipToDuration(const string& recip, HumNum scale,
 		const string& separator) {
 	size_t loc;
@@ -9047,7 +9110,7 @@ void HumGrid::extendDurationToken(int slicei, int parti, int staffi,
 		return;
 	}
 
-	HumNum tokendur = Convert::recipToDuration((string)*token);
+	HumNum tokendur = Convert::recipToDuration(token);
 	HumNum currts   = m_allslices.at(slicei)->getTimestamp();
 	HumNum nextts   = m_allslices.at(slicei+1)->getTimestamp();
 	HumNum slicedur = nextts - currts;
@@ -9996,6 +10059,141 @@ HumParameter::HumParameter(const string& str) : string(str) {
 
 
 
+//////////////////////////////
+//
+// HumHashEntry::getText -- Return the value of the parameter as a string.
+//
+
+string HumHashEntry::getText(void) const {
+	switch (type) {
+		case TYPE_INT:
+			return to_string(number.getNumerator());
+		case TYPE_FRACTION: {
+			stringstream ss;
+			ss << number;
+			return ss.str();
+		}
+		case TYPE_HTP:
+			return "HT_" + to_string((long long)token);
+	}
+	return text;
+}
+
+
+
+//////////////////////////////
+//
+// HumHashIdTable -- Table of interned namespace and key strings which is
+//    shared by all HumHash objects.  The first three ids are reserved for
+//    "", "!" and "!!".
+//
+
+class HumHashIdTable {
+	public:
+		HumHashIdTable(void) {
+			names.push_back("");
+			names.push_back("!");
+			names.push_back("!!");
+			for (int i=0; i<(int)names.size(); i++) {
+				ids[names[i]] = i;
+			}
+		}
+		std::mutex                           lock;
+		std::unordered_map<std::string, int> ids;
+		vector<std::string>                  names;
+};
+
+static HumHashIdTable& getHumHashIdTable(void) {
+	static HumHashIdTable table;
+	return table;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getParameterId -- Return the interned id of a namespace or key
+//    string, adding the string to the table if it is not already in it.
+//    Ids are shared by all HumHash objects and are never removed, so they
+//    can be stored and used in place of the strings.  The empty string
+//    has id 0.
+//
+
+int HumHash::getParameterId(const string& name) {
+	if (name.empty()) {
+		return 0;
+	}
+	static thread_local std::unordered_map<std::string, int> cache;
+	auto it = cache.find(name);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	HumHashIdTable& table = getHumHashIdTable();
+	int output;
+	{
+		std::lock_guard<std::mutex> guard(table.lock);
+		auto found = table.ids.find(name);
+		if (found == table.ids.end()) {
+			output = (int)table.names.size();
+			table.names.push_back(name);
+			table.ids[name] = output;
+		} else {
+			output = found->second;
+		}
+	}
+	cache[name] = output;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findParameterId -- Return the interned id of a namespace or key
+//    string, or -1 if no parameter has ever used the string.
+//
+
+int HumHash::findParameterId(const string& name) {
+	if (name.empty()) {
+		return 0;
+	}
+	static thread_local std::unordered_map<std::string, int> cache;
+	auto it = cache.find(name);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	HumHashIdTable& table = getHumHashIdTable();
+	int output;
+	{
+		std::lock_guard<std::mutex> guard(table.lock);
+		auto found = table.ids.find(name);
+		if (found == table.ids.end()) {
+			return -1;
+		}
+		output = found->second;
+	}
+	cache[name] = output;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getParameterName -- Return the string for an interned id.
+//
+
+string HumHash::getParameterName(int id) {
+	HumHashIdTable& table = getHumHashIdTable();
+	std::lock_guard<std::mutex> guard(table.lock);
+	if ((id < 0) || (id >= (int)table.names.size())) {
+		return "";
+	}
+	return table.names[id];
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::HumHash -- HumHash constructor.  The data storage is empty
@@ -10004,6 +10202,16 @@ HumParameter::HumParameter(const string& str) : string(str) {
 
 HumHash::HumHash(void) {
 	parameters = NULL;
+	prefix = 0;
+}
+
+
+HumHash::HumHash(const HumHash& hash) {
+	parameters = NULL;
+	prefix = hash.prefix;
+	if (hash.parameters != NULL) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	}
 }
 
 
@@ -10023,6 +10231,31 @@ HumHash::~HumHash() {
 
 
 
+//////////////////////////////
+//
+// HumHash::operator= -- Copy the parameters and prefix of another HumHash.
+//
+
+HumHash& HumHash::operator=(const HumHash& hash) {
+	if (this == &hash) {
+		return *this;
+	}
+	prefix = hash.prefix;
+	if (hash.parameters == NULL) {
+		if (parameters != NULL) {
+			delete parameters;
+			parameters = NULL;
+		}
+	} else if (parameters == NULL) {
+		parameters = new vector<HumHashEntry>(*hash.parameters);
+	} else {
+		*parameters = *hash.parameters;
+	}
+	return *this;
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValue -- Returns the value specified by the given key.
@@ -10063,23 +10296,27 @@ string HumHash::getValue(const string& ns2, const string& key) const {
 
 string HumHash::getValue(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return "";
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return "";
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return "";
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	return entry->getText();
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getValue -- Version of getValue() which takes parameter ids (see
+//     getParameterId()) instead of strings.
+//
+
+string HumHash::getValue(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return "";
 	}
-	return it3->second;
+	return entry->getText();
 }
 
 
@@ -10096,7 +10333,7 @@ HTp HumHash::getValueHTp(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueHTp("", "", keys[2]);
+		return getValueHTp("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueHTp(keys[0], keys[1]);
 	} else {
@@ -10115,10 +10352,14 @@ HTp HumHash::getValueHTp(const string& ns2, const string& key) const {
 
 HTp HumHash::getValueHTp(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return NULL;
 	}
-	string value = getValue(ns1, ns2, key);
+	if (entry->type == HumHashEntry::TYPE_HTP) {
+		return entry->token;
+	}
+	string value = entry->getText();
 	if (value.find("HT_") != 0) {
 		return NULL;
 	} else {
@@ -10135,6 +10376,26 @@ HTp HumHash::getValueHTp(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::getValueHTp -- Version of getValueHTp() which takes parameter ids
+//     (see getParameterId()) instead of strings.
+//
+
+HTp HumHash::getValueHTp(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return NULL;
+	}
+	if (entry->type == HumHashEntry::TYPE_HTP) {
+		return entry->token;
+	}
+	return getValueHTp(getParameterName(ns1), getParameterName(ns2),
+			getParameterName(key));
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValueInt -- Return the value as an integer.  The value must
@@ -10152,7 +10413,7 @@ int HumHash::getValueInt(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueInt("", "", keys[2]);
+		return getValueInt("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueInt(keys[0], keys[1]);
 	} else {
@@ -10171,10 +10432,16 @@ int HumHash::getValueInt(const string& ns2, const string& key) const {
 
 int HumHash::getValueInt(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
+	if (entry->type == HumHashEntry::TYPE_INT) {
+		return entry->number.getNumerator();
+	} else if (entry->type == HumHashEntry::TYPE_FRACTION) {
+		return entry->number.getInteger();
+	}
+	string value = entry->getText();
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return  nvalue.getInteger();
@@ -10197,6 +10464,28 @@ int HumHash::getValueInt(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::getValueInt -- Version of getValueInt() which takes parameter ids
+//     (see getParameterId()) instead of strings.
+//
+
+int HumHash::getValueInt(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return 0;
+	}
+	if (entry->type == HumHashEntry::TYPE_INT) {
+		return entry->number.getNumerator();
+	} else if (entry->type == HumHashEntry::TYPE_FRACTION) {
+		return entry->number.getInteger();
+	}
+	return getValueInt(getParameterName(ns1), getParameterName(ns2),
+			getParameterName(key));
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValueFraction -- Return the value as a HumNum fraction.
@@ -10230,11 +10519,36 @@ HumNum HumHash::getValueFraction(const string& ns2, const string& key) const {
 
 HumNum HumHash::getValueFraction(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (!isDefined(ns1, ns2, key)) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return 0;
 	}
-	string value = getValue(ns1, ns2, key);
-	HumNum fractionvalue(value);
+	if ((entry->type == HumHashEntry::TYPE_INT) ||
+			(entry->type == HumHashEntry::TYPE_FRACTION)) {
+		return entry->number;
+	}
+	HumNum fractionvalue(entry->getText());
+	return fractionvalue;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getValueFraction -- Version of getValueFraction() which takes
+//     parameter ids (see getParameterId()) instead of strings.
+//
+
+HumNum HumHash::getValueFraction(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return 0;
+	}
+	if ((entry->type == HumHashEntry::TYPE_INT) ||
+			(entry->type == HumHashEntry::TYPE_FRACTION)) {
+		return entry->number;
+	}
+	HumNum fractionvalue(entry->getText());
 	return fractionvalue;
 }
 
@@ -10257,7 +10571,7 @@ double HumHash::getValueFloat(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueFloat("", "", keys[2]);
+		return getValueFloat("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueFloat(keys[0], keys[1]);
 	} else {
@@ -10270,7 +10584,7 @@ double HumHash::getValueFloat(const string& ns2, const string& key) const {
 	if (parameters == NULL) {
 		return 0.0;
 	}
-	return getValueInt("", ns2, key);
+	return getValueFloat("", ns2, key);
 }
 
 
@@ -10279,7 +10593,16 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return 0.0;
 	}
-	string value = getValue(ns1, ns2, key);
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry != NULL) {
+		if ((entry->type == HumHashEntry::TYPE_INT) ||
+				(entry->type == HumHashEntry::TYPE_FRACTION)) {
+			return entry->number.getFloat();
+		} else if (entry->type == HumHashEntry::TYPE_FLOAT) {
+			return entry->real;
+		}
+	}
+	string value = entry ? entry->getText() : "";
 	if (value.find("/") != string::npos) {
 		HumNum nvalue(value);
 		return nvalue.getFloat();
@@ -10297,6 +10620,30 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 
 
 
+//////////////////////////////
+//
+// HumHash::getValueFloat -- Version of getValueFloat() which takes parameter
+//     ids (see getParameterId()) instead of strings.
+//
+
+double HumHash::getValueFloat(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
+		return getValueFloat(getParameterName(ns1), getParameterName(ns2),
+				getParameterName(key));
+	}
+	if ((entry->type == HumHashEntry::TYPE_INT) ||
+			(entry->type == HumHashEntry::TYPE_FRACTION)) {
+		return entry->number.getFloat();
+	} else if (entry->type == HumHashEntry::TYPE_FLOAT) {
+		return entry->real;
+	}
+	return getValueFloat(getParameterName(ns1), getParameterName(ns2),
+			getParameterName(key));
+}
+
+
+
 //////////////////////////////
 //
 // HumHash::getValueBool -- Return true or false based on the
@@ -10311,7 +10658,7 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 bool HumHash::getValueBool(const string& key) const {
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueBool("", "", keys[2]);
+		return getValueBool("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueBool(keys[0], keys[1]);
 	} else {
@@ -10327,15 +10674,33 @@ bool HumHash::getValueBool(const string& ns2, const string& key) const {
 
 bool HumHash::getValueBool(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
+	return getValueBool(findParameterId(ns1), findParameterId(ns2),
+			findParameterId(key));
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getValueBool -- Version of getValueBool() which takes parameter ids
+//     (see getParameterId()) instead of strings.
+//
+
+bool HumHash::getValueBool(int ns1, int ns2, int key) const {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return false;
 	}
-	if (!isDefined(ns1, ns2, key)) {
-		return false;
+	switch (entry->type) {
+		case HumHashEntry::TYPE_INT:
+		case HumHashEntry::TYPE_FRACTION:
+			return entry->number != 0;
+		case HumHashEntry::TYPE_HTP:
+			return true;
 	}
-	if ((*parameters)[ns1][ns2][key] == "false") {
+	if (entry->text == "false") {
 		return false;
-	} else if ((*parameters)[ns1][ns2][key] == "0") {
+	} else if (entry->text == "0") {
 		return false;
 	} else {
 		return true;
@@ -10351,9 +10716,9 @@ bool HumHash::getValueBool(const string& ns1, const string& ns2,
 //     value is any arbitrary string, but preferably does not
 //     include tabs or colons.  If a colon is needed, then specify
 //     as "&colon;" without the quotes.  Values such as integers
-//     fractions and floats can be specified, and these wil be converted
-//     internally into strings (use getValueInt() or getValueFloat()
-//     to recover the original type).
+//     fractions and tokens are stored without conversion to text (use
+//     getValueInt(), getValueFraction() or getValueHTp() to recover the
+//     original type), and floats are converted into strings.
 //
 
 void HumHash::setValue(const string& key, const string& value) {
@@ -10376,8 +10741,8 @@ void HumHash::setValue(const string& ns2, const string& key,
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, const string& value) {
-	initializeParameters();
-	(*parameters)[ns1][ns2][key] = value;
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -10417,10 +10782,8 @@ void HumHash::setValue(const string& ns2, const string& key, int value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, int value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -10443,10 +10806,8 @@ void HumHash::setValue(const string& ns2, const string& key, HTp value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HTp value) {
-	initializeParameters();
-	stringstream ss;
-	ss << "HT_" << ((long long)value);
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -10469,10 +10830,8 @@ void HumHash::setValue(const string& ns2, const string& key, HumNum value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HumNum value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
 }
 
 
@@ -10495,10 +10854,105 @@ void HumHash::setValue(const string& ns2, const string& key, double value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, double value) {
-	initializeParameters();
+	setValue(getParameterId(ns1), getParameterId(ns2), getParameterId(key),
+			value);
+}
+
+
+vector<string> HumHash::getKeys(const string& ns) const {
+	vector<string> output;
+	if (parameters == NULL) {
+		return output;
+	}
+	auto loc = ns.find(":");
+	if (loc != string::npos) {
+		string ns1 = ns.substr(0, loc);
+		string ns2 = ns.substr(loc+1);
+		return getKeys(ns1, ns2);
+	}
+
+	int id1 = findParameterId(ns);
+	vector<pair<string, string>> keys;
+	for (auto& entry : *parameters) {
+		if (entry.ns1 == id1) {
+			keys.emplace_back(getParameterName(entry.ns2), getParameterName(entry.key));
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+	for (auto& key : keys) {
+		output.push_back(key.first + ":" + key.second);
+	}
+	return output;
+}
+
+
+vector<string> HumHash::getKeys(void) const {
+	vector<string> output;
+	if (parameters == NULL) {
+		return output;
+	}
+	MapNNKV sorted;
+	getSortedParameters(sorted);
+	for (auto& it1 : sorted) {
+		for (auto& it2 : it1.second) {
+			for (auto& it3 : it2.second) {
+				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
+			}
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::setValue -- Versions of setValue() which take parameter ids (see
+//     getParameterId()) instead of strings.  The string versions store
+//     their values through these functions.
+//
+
+void HumHash::setValue(int ns1, int ns2, int key, const string& value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_STRING;
+	entry.text = value;
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, int value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_INT;
+	entry.number = value;
+	entry.text.clear();
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, HTp value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_HTP;
+	entry.token = value;
+	entry.text.clear();
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, HumNum value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_FRACTION;
+	entry.number = value;
+	entry.text.clear();
+}
+
+
+void HumHash::setValue(int ns1, int ns2, int key, double value) {
+	HumHashEntry& entry = insertEntry(ns1, ns2, key);
+	entry.type = HumHashEntry::TYPE_FLOAT;
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	entry.text = ss.str();
+	// Store the value of the printed form, so that getValueFloat() returns
+	// the same value as a parameter read from text:
+	entry.real = value;
+	ss >> entry.real;
 }
 
 
@@ -10519,46 +10973,14 @@ vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output.push_back(it.first);
-	}
-	return output;
-}
-
-
-vector<string> HumHash::getKeys(const string& ns) const {
-	vector<string> output;
-	if (parameters == NULL) {
-		return output;
-	}
-	auto loc = ns.find(":");
-	if (loc != string::npos) {
-		string ns1 = ns.substr(0, loc);
-		string ns2 = ns.substr(loc+1);
-		return getKeys(ns1, ns2);
-	}
-
-	for (auto& it1 : (*parameters)[ns]) {
-		for (auto& it2 : it1.second) {
-			output.push_back(it1.first + ":" + it2.first);
-		}
-	}
-	return output;
-}
-
-
-vector<string> HumHash::getKeys(void) const {
-	vector<string> output;
-	if (parameters == NULL) {
-		return output;
-	}
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			for (auto it3 : it2.second) {
-				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
-			}
+	int id1 = findParameterId(ns1);
+	int id2 = findParameterId(ns2);
+	for (auto& entry : *parameters) {
+		if ((entry.ns1 == id1) && (entry.ns2 == id2)) {
+			output.push_back(getParameterName(entry.key));
 		}
 	}
+	std::sort(output.begin(), output.end());
 	return output;
 }
 
@@ -10575,42 +10997,12 @@ vector<string> HumHash::getKeys(void) const {
 //
 
 bool HumHash::hasParameters(const string& ns1, const string& ns2) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	auto it2 = (*parameters)[ns1].find(ns2);
-	if (it2 == (*parameters)[ns1].end()) {
-		return false;
-	} else {
-		return true;
-	}
+	return getParameterCount(ns1, ns2) > 0;
 }
 
 
 bool HumHash::hasParameters(const string& ns) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	auto loc = ns.find(":");
-	if (loc != string::npos) {
-		string ns1 = ns.substr(0, loc);
-		string ns2 = ns.substr(loc+1);
-		return hasParameters(ns1, ns2);
-	}
-
-	auto it = parameters->find(ns);
-	if (it == parameters->end()) {
-		return false;
-	} else {
-		return true;
-	}
+	return getParameterCount(ns) > 0;
 }
 
 
@@ -10618,19 +11010,7 @@ bool HumHash::hasParameters(void) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	for (auto& it1 : *parameters) {
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			} else {
-				return true;
-			}
-		}
-	}
-	return false;
+	return !parameters->empty();
 }
 
 
@@ -10650,24 +11030,24 @@ int HumHash::getParameterCount(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
+	int id1 = findParameterId(ns1);
+	int id2 = findParameterId(ns2);
+	if ((id1 < 0) || (id2 < 0)) {
 		return 0;
 	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return 0;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return 0;
+	int sum = 0;
+	for (auto& entry : *parameters) {
+		if ((entry.ns1 == id1) && (entry.ns2 == id2)) {
+			sum++;
+		}
 	}
-	return (int)it2->second.size();
+	return sum;
 }
 
 
 int HumHash::getParameterCount(const string& ns) const {
 	if (parameters == NULL) {
-		return false;
+		return 0;
 	}
 	auto loc = ns.find(":");
 	if (loc != string::npos) {
@@ -10676,13 +11056,15 @@ int HumHash::getParameterCount(const string& ns) const {
 		return getParameterCount(ns1, ns2);
 	}
 
-	auto it1 = parameters->find(ns);
-	if (it1 == parameters->end()) {
-		return false;
+	int id1 = findParameterId(ns);
+	if (id1 < 0) {
+		return 0;
 	}
 	int sum = 0;
-	for (auto& it2 : it1->second) {
-		sum += (int)it2.second.size();
+	for (auto& entry : *parameters) {
+		if (entry.ns1 == id1) {
+			sum++;
+		}
 	}
 	return sum;
 }
@@ -10692,16 +11074,7 @@ int HumHash::getParameterCount(void) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	int sum = 0;
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			sum += (int)it2.second.size();
-		}
-	}
-	return sum;
+	return (int)parameters->size();
 }
 
 
@@ -10720,29 +11093,35 @@ bool HumHash::isDefined(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return (*parameters)[""][""].count(keys[0]) ? true : false;
+		return isDefined("", "", keys[0]);
 	} else if (keys.size() == 2) {
-		return (*parameters)[""][keys[0]].count(keys[1]) ? true : false;
+		return isDefined("", keys[0], keys[1]);
 	} else {
-		return (*parameters)[keys[0]][keys[1]].count(keys[2]) ? true : false;
+		return isDefined(keys[0], keys[1], keys[2]);
 	}
 }
 
 
 bool HumHash::isDefined(const string& ns2, const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[""][ns2].count(key) ? true : false;
+	return isDefined("", ns2, key);
 }
 
 
 bool HumHash::isDefined(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return false;
-	}
-	return (*parameters)[ns1][ns2].count(key) ? true : false;
+	return findEntry(ns1, ns2, key) != NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::isDefined -- Version of isDefined() which takes parameter ids (see
+//     getParameterId()) instead of strings.
+//
+
+bool HumHash::isDefined(int ns1, int ns2, int key) const {
+	return findEntry(ns1, ns2, key) != NULL;
 }
 
 
@@ -10779,38 +11158,135 @@ void HumHash::deleteValue(const string& ns2, const string& key) {
 
 void HumHash::deleteValue(const string& ns1, const string& ns2,
 		const string& key) {
-	if (parameters == NULL) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return;
 	}
-	(*parameters)[ns1][ns2].erase(key);
+	parameters->erase(parameters->begin() + (entry - parameters->data()));
+}
 
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
+
+
+//////////////////////////////
+//
+// HumHash::deleteValues -- Delete all parameters in the given namespace
+//   combination (such as "" and "auto" for values which are calculated
+//   by content analyses).
+//
+
+void HumHash::deleteValues(const string& ns1, const string& ns2) {
+	if ((parameters == NULL) || parameters->empty()) {
 		return;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return;
+	int id1 = findParameterId(ns1);
+	int id2 = findParameterId(ns2);
+	parameters->erase(std::remove_if(parameters->begin(), parameters->end(),
+			[id1, id2](const HumHashEntry& entry) {
+				return (entry.ns1 == id1) && (entry.ns2 == id2);
+			}), parameters->end());
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::initializeParameters -- Create the parameter list if it does
+//     not already exist.
+//
+
+void HumHash::initializeParameters(void) {
+	if (parameters == NULL) {
+		parameters = new vector<HumHashEntry>;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findEntry -- Return the storage for a parameter, or NULL if
+//     the parameter is not defined.
+//
+
+HumHashEntry* HumHash::findEntry(int ns1, int ns2, int key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	for (auto& entry : *parameters) {
+		if ((entry.key == key) && (entry.ns2 == ns2) && (entry.ns1 == ns1)) {
+			return &entry;
+		}
+	}
+	return NULL;
+}
+
+
+HumHashEntry* HumHash::findEntry(const string& ns1, const string& ns2,
+		const string& key) const {
+	if (parameters == NULL) {
+		return NULL;
+	}
+	int id1 = findParameterId(ns1);
+	if (id1 < 0) {
+		return NULL;
+	}
+	int id2 = findParameterId(ns2);
+	if (id2 < 0) {
+		return NULL;
 	}
-	it2->second.erase(key);
+	int idk = findParameterId(key);
+	if (idk < 0) {
+		return NULL;
+	}
+	return findEntry(id1, id2, idk);
 }
 
 
 
 //////////////////////////////
 //
-// HumHash::initializeParameters -- Create the map structure if it does not
-//     already exist.
+// HumHash::insertEntry -- Return the storage for a parameter, adding it
+//     if it does not already exist.  The origin of an existing parameter
+//     is cleared since it is being given a new value.
 //
 
-void HumHash::initializeParameters(void) {
+HumHashEntry& HumHash::insertEntry(int ns1, int ns2, int key) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry != NULL) {
+		entry->origin = NULL;
+		return *entry;
+	}
+	initializeParameters();
+	parameters->resize(parameters->size() + 1);
+	HumHashEntry& output = parameters->back();
+	output.ns1    = ns1;
+	output.ns2    = ns2;
+	output.key    = key;
+	output.type   = HumHashEntry::TYPE_STRING;
+	output.token  = NULL;
+	output.real   = 0.0;
+	output.origin = NULL;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::getSortedParameters -- Copy the parameters into a map sorted
+//     by namespaces and key, which is the order used when printing them.
+//
+
+void HumHash::getSortedParameters(MapNNKV& output) const {
+	output.clear();
 	if (parameters == NULL) {
-		parameters = new MapNNKV;
+		return;
+	}
+	for (auto& entry : *parameters) {
+		HumParameter& value = output[getParameterName(entry.ns1)]
+				[getParameterName(entry.ns2)][getParameterName(entry.key)];
+		value.assign(entry.getText());
+		value.origin = entry.origin;
 	}
 }
 
@@ -10847,7 +11323,13 @@ vector<string> HumHash::getKeyList(const string& keys) const {
 //
 
 void HumHash::setPrefix(const string& value) {
-	prefix = value;
+	if (value == "!") {
+		prefix = 1;
+	} else if (value == "!!") {
+		prefix = 2;
+	} else {
+		prefix = getParameterId(value);
+	}
 }
 
 
@@ -10858,7 +11340,12 @@ void HumHash::setPrefix(const string& value) {
 //
 
 string HumHash::getPrefix(void) const {
-	return prefix;
+	switch (prefix) {
+		case 0: return "";
+		case 1: return "!";
+		case 2: return "!!";
+	}
+	return getParameterName(prefix);
 }
 
 
@@ -10907,23 +11394,11 @@ void HumHash::setOrigin(const string& ns2, const string& key,
 
 void HumHash::setOrigin(const string& ns1, const string& ns2,
 		const string& key, HumdrumToken* tok) {
-	if (parameters == NULL) {
-		return;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
-	}
-	it3->second.origin = tok;
+	entry->origin = tok;
 }
 
 
@@ -10967,23 +11442,11 @@ HumdrumToken* HumHash::getOrigin(const string& ns2, const string& key) const {
 
 HumdrumToken* HumHash::getOrigin(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return NULL;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return NULL;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return NULL;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return NULL;
 	}
-	return it3->second.origin;
+	return entry->origin;
 }
 
 
@@ -10999,7 +11462,9 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 	if (parameters == NULL) {
 		return out;
 	}
-	if (parameters->size() == 0) {
+	MapNNKV sorted;
+	getSortedParameters(sorted);
+	if (sorted.size() == 0) {
 		return out;
 	}
 
@@ -11008,7 +11473,7 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : sorted) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -11065,7 +11530,9 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 	if (parameters == NULL) {
 		return out;
 	}
-	if (parameters->size() == 0) {
+	MapNNKV sorted;
+	getSortedParameters(sorted);
+	if (sorted.size() == 0) {
 		return out;
 	}
 
@@ -11078,7 +11545,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
+	for (auto& it1 : sorted) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -11178,13 +11645,16 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 	if (hash.parameters == NULL) {
 		return out;
 	}
-	if (hash.parameters->size() == 0) {
+	MapNNKV sorted;
+	hash.getSortedParameters(sorted);
+	if (sorted.size() == 0) {
 		return out;
 	}
 
 	string cleaned;
+	string prefix = hash.getPrefix();
 
-	for (auto& it1 : *(hash.parameters)) {
+	for (auto& it1 : sorted) {
 		if (it1.second.size() == 0) {
 			continue;
 		}
@@ -11192,7 +11662,7 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 			if (it2.second.size() == 0) {
 				continue;
 			}
-			out << hash.prefix;
+			out << prefix;
 			out << it1.first << ":" << it2.first;
 			for (auto& it3 : it2.second) {
 				out << ":" << it3.first;
@@ -11634,20 +12104,9 @@ void HumInstrument::sortData(void) {
 //
 // HumNum::HumNum -- HumNum Constructor.  Set the default value
 //   of the number to zero, or the given number if specified.
+//   The default and integer constructors are defined in HumNum.h.
 //
 
-HumNum::HumNum(void){
-	top = 0;
-	bot = 1;
-}
-
-
-HumNum::HumNum(int value){
-	top = value;
-	bot = 1;
-}
-
-
 HumNum::HumNum(int numerator, int denominator){
 	setValue(numerator, denominator);
 }
@@ -11663,100 +12122,6 @@ HumNum::HumNum(const char* ratstring) {
 }
 
 
-HumNum::HumNum(const HumNum& rat) {
-	top = rat.top;
-	bot = rat.bot;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::~HumNum -- HumNum deconstructor.
-//
-
-HumNum::~HumNum() {
-	// do nothing
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNegative -- Returns true if value is negative.
-//
-
-bool HumNum::isNegative(void) const {
-	return isFinite() && (top < 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isPositive -- Returns true if value is positive.
-//
-
-bool HumNum::isPositive(void) const {
-	return isFinite() && (top > 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isZero -- Returns true if value is zero.
-//
-
-bool HumNum::isZero(void) const {
-	return isFinite() && (top == 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNonZero -- Returns true if value is not zero.
-//
-
-bool HumNum::isNonZero(void) const {
-	return isFinite() && (top != 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNonNegative -- Returns true if value is non-negative.
-//
-
-bool HumNum::isNonNegative(void) const {
-	return isFinite() && (top >= 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNonPositive -- Returns true if value is non-positive.
-//
-
-bool HumNum::isNonPositive(void) const {
-	return isFinite() && (top >= 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::getFloat -- Returns the floating-point equivalent of the
-//     rational number.
-//
-
-double HumNum::getFloat(void) const {
-	return (double)top/(double)bot;
-}
-
 
 
 //////////////////////////////
@@ -11781,28 +12146,6 @@ int HumNum::getInteger(double round) const {
 
 
 
-//////////////////////////////
-//
-// HumNum::getNumerator -- Returns the top integer in the fraction.
-//
-
-int HumNum::getNumerator(void) const {
-	return top;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::getDenominator -- Returns the bottom integer in the fraction.
-//
-
-int HumNum::getDenominator(void) const {
-	return bot;
-}
-
-
-
 //////////////////////////////
 //
 // HumNum::getRemainder -- Returns the non-integer fractional part of the value.
@@ -11866,13 +12209,12 @@ void HumNum::setValue(const char* ratstring) {
 
 //////////////////////////////
 //
-// HumNum::invert --
+// HumNum::invert -- Swap the numerator and denominator, keeping the
+//    sign in the numerator.
 //
 
 void HumNum::invert(void) {
-	int temp = top;
-	top = bot;
-	bot = temp;
+	setWide(bot, top);
 }
 
 
@@ -11913,492 +12255,246 @@ HumNum& HumNum::makeAbs(void) {
 //
 
 void HumNum::reduce(void) {
-	int a = getNumerator();
-	int b = getDenominator();
-	if (a == 1 || b == 1) {
-		return;
-	}
-	if (a == 0) {
-		bot = 1;
-		return;
-	}
-	if (b == 0) {
-		a = 0;
-		b = 0;
-	}
-	int gcdval = gcdIterative(a, b);
-	if (gcdval > 1) {
-		top /= gcdval;
-		bot /= gcdval;
-	}
+	setWide(top, bot);
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::gcdIterative -- Returns the greatest common divisor of two
-//      numbers using an iterative algorithm.
+// HumNum::setWide -- Reduce a fraction given as 64-bit integers and
+//    store it.  The sign of the fraction is placed in the numerator.
+//    0/0 is stored as 0, and other values with a zero denominator
+//    are stored unreduced (infinite values).
 //
 
-int HumNum::gcdIterative(int a, int b) {
-	int c;
-	while (b) {
-		c = a;
-		a = b;
-		b = c % b;
-	}
-	return a < 0 ? -a : a;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::gcdRecursive -- Returns the greatest common divisor of two
-//      numbers using a recursive algorithm.
-//
-
-int HumNum::gcdRecursive(int a, int b) {
-	if (a < 0) {
-		a = -a;
+void HumNum::setWide(long long numerator, long long denominator) {
+	if (numerator == 0) {
+		top = 0;
+		bot = 1;
+		return;
 	}
-	if (!b) {
-		return a;
-	} else {
-		return gcdRecursive(b, a % b);
+	if (denominator == 0) {
+		if (numerator > 2147483647LL) {
+			numerator = 2147483647LL;
+		} else if (numerator < -2147483647LL) {
+			numerator = -2147483647LL;
+		}
+		top = (int)numerator;
+		bot = 0;
+		return;
 	}
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isInfinite -- Returns true if the denominator is zero.
-//
-
-bool HumNum::isInfinite(void) const {
-	return (bot == 0) && (top != 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isNaN -- Returns true if the numerator and denominator
-//     are both zero.
-//
-
-bool HumNum::isNaN(void) const {
-	return (bot == 0) && (top == 0);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isFinite -- Returns true if the denominator is not zero.
-//
-
-bool HumNum::isFinite(void) const {
-	return bot != 0;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isInteger -- Returns true if number is an integer.
-//
-
-bool HumNum::isInteger(void) const {
-	return isFinite() && (bot == 1);
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::isPowerOfTwo -- Returns true if a power of two.
-//
-
-bool HumNum::isPowerOfTwo(void) const {
-	if (top == 0) {
-		return false;
+	if (denominator < 0) {
+		numerator = -numerator;
+		denominator = -denominator;
 	}
-	int abstop = top > 0 ? top : -top;
-	if (bot == 1) {
-		return !(abstop & (abstop - 1));
-	} else if (abstop == 1) {
-		return !(bot & (bot - 1));
+	if (denominator != 1) {
+		unsigned long long absnum = numerator < 0 ? -(unsigned long long)numerator
+				: (unsigned long long)numerator;
+		unsigned long long gcdval = gcdBinary(absnum, (unsigned long long)denominator);
+		if (gcdval > 1) {
+			numerator /= (long long)gcdval;
+			denominator /= (long long)gcdval;
+		}
 	}
-	return false;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator+ -- Addition operator which adds HumNum
-//    to another HumNum or with a integers.
-//
-
-HumNum HumNum::operator+(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 + a2 * b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator+(int value) const {
-	HumNum output(value * bot + top, bot);
-	return output;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator- -- Subtraction operator to subtract
-//     HumNums from each other and to subtrack integers from
-//     HumNums.
-//
-
-HumNum HumNum::operator-(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 - a2*b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator-(int value) const {
-	HumNum output(top - value * bot, bot);
-	return output;
+	setWideReduced(numerator, denominator);
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator- -- Unary negation operator to generate
-//   the negative version of a HumNum.
+// HumNum::setOverflow -- Store a reduced fraction which does not fit
+//    into 32-bit integers.  The value is replaced by the last of its
+//    continued-fraction convergents which fits, or by +/-2147483647 if
+//    the value itself is too large.
+//    Each overflow is counted, and the count can be checked with
+//    getOverflowCount().
 //
 
-HumNum HumNum::operator-(void) const {
-	HumNum output(-top, bot);
-	return output;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator* -- Multiplication operator to multiply
-//   two HumNums together or a HumNum and an integer.
-//
-
-HumNum HumNum::operator*(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*a2;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
-	return output;
-}
-
-
-HumNum HumNum::operator*(int value) const {
-	HumNum output(top * value, bot);
-	return output;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator/ -- Division operator to divide two
-//     HumNums together or divide a HumNum by an integer.
-//
-
-HumNum HumNum::operator/(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2;
-	int bo = b1*a2;
-	HumNum output(ao, bo);
-	return output;
-}
-
+void HumNum::setOverflow(long long numerator, long long denominator) {
+	overflowCount()++;
+	const unsigned long long limit = 2147483647ULL;
+	int sign = numerator < 0 ? -1 : 1;
+	unsigned long long n = numerator < 0 ? -(unsigned long long)numerator
+			: (unsigned long long)numerator;
+	unsigned long long d = (unsigned long long)denominator;
 
-HumNum HumNum::operator/(int value) const {
-	int a  = getNumerator();
-	int b  = getDenominator();
-	if (value < 0) {
-		a = -a;
-		b *= -value;
+	unsigned long long p0 = 0;
+	unsigned long long q0 = 1;
+	unsigned long long p1 = 1;
+	unsigned long long q1 = 0;
+	while (d != 0) {
+		unsigned long long a = n / d;
+		if (((p1 > 0) && (a > (limit - p0) / p1)) ||
+				((q1 > 0) && (a > (limit - q0) / q1))) {
+			break;
+		}
+		unsigned long long p2 = a * p1 + p0;
+		unsigned long long q2 = a * q1 + q0;
+		p0 = p1;
+		q0 = q1;
+		p1 = p2;
+		q1 = q2;
+		unsigned long long r = n - a * d;
+		n = d;
+		d = r;
+	}
+	if (q1 == 0) {
+		top = sign * (int)limit;
+		bot = 1;
 	} else {
-		b *= value;
-	}
-	HumNum output(a, b);
-	return output;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator= -- Assign the contents of a HumNum
-//    from another HumNum.
-//
-
-HumNum& HumNum::operator=(const HumNum& value) {
-	if (this == &value) {
-		return *this;
+		top = sign * (int)p1;
+		bot = (int)q1;
 	}
-	setValue(value.top, value.bot);
-	return *this;
-}
-
-HumNum& HumNum::operator=(int  value) {
-	setValue(value);
-	return *this;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator+= -- Add a HumNum or integer to a HumNum.
-//
-
-HumNum& HumNum::operator+=(const HumNum& value) {
-	*this = *this + value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator+=(int value) {
-	*this = *this + value;
-	return *this;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator-= -- Subtract a HumNum or an integer from
-//    a HumNum.
+// HumNum::getOverflowCount -- Return the number of arithmetic results
+//    in the current thread which did not fit into a 32-bit fraction
+//    and were approximated (see setOverflow()).
 //
 
-HumNum& HumNum::operator-=(const HumNum& value) {
-	*this = *this - value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator-=(int value) {
-	*this = *this - value;
-	return *this;
+int HumNum::getOverflowCount(void) {
+	return overflowCount();
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator*= -- Multiply a HumNum by a HumNum or integer.
+// HumNum::clearOverflowCount -- Reset the overflow count for the
+//    current thread.
 //
 
-HumNum& HumNum::operator*=(const HumNum& value) {
-	*this = *this * value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator*=(int value) {
-	*this = *this * value;
-	return *this;
+void HumNum::clearOverflowCount(void) {
+	overflowCount() = 0;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator/= -- Divide a HumNum by a HumNum or integer.
+// HumNum::overflowCount -- Storage for the overflow count of each thread.
 //
 
-HumNum& HumNum::operator/=(const HumNum& value) {
-	*this = *this / value;
-	return *this;
-}
-
-
-HumNum& HumNum::operator/=(int value) {
-	*this = *this / value;
-	return *this;
+int& HumNum::overflowCount(void) {
+	static thread_local int count = 0;
+	return count;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator< -- Less-than equality for a HumNum and
-//   a HumNum, integer, or float.
+// HumNum::gcdBinary -- Returns the greatest common divisor of two
+//      numbers using the binary (Stein) algorithm, which needs only
+//      shifts and subtractions.
 //
 
-bool HumNum::operator<(const HumNum& value) const {
-	if (this == &value) {
-		return false;
+unsigned long long HumNum::gcdBinary(unsigned long long a, unsigned long long b) {
+	if (a == 0) {
+		return b;
 	}
-	return getFloat() < value.getFloat();
-}
-
-
-bool HumNum::operator<(int value) const {
-	return getFloat() < value;
-}
-
-
-bool HumNum::operator<(double value) const {
-	return getFloat() < value;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator<= -- Less-than-or-equal equality for a
-//     HumNum with a HumNum, integer or float.
-//
-
-bool HumNum::operator<=(const HumNum& value) const {
-	if (this == &value) {
-		return true;
+	if (b == 0) {
+		return a;
 	}
-	return getFloat() <= value.getFloat();
-}
-
-
-bool HumNum::operator<=(int value) const {
-	return getFloat() <= value;
-}
-
-
-bool HumNum::operator<=(double value) const {
-	return getFloat() <= value;
+#if defined(__GNUC__) || defined(__clang__)
+	int shift = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+	do {
+		b >>= __builtin_ctzll(b);
+		if (a > b) {
+			unsigned long long temp = a;
+			a = b;
+			b = temp;
+		}
+		b -= a;
+	} while (b != 0);
+	return a << shift;
+#else
+	int shift = 0;
+	while (((a | b) & 1) == 0) {
+		a >>= 1;
+		b >>= 1;
+		shift++;
+	}
+	while ((a & 1) == 0) {
+		a >>= 1;
+	}
+	do {
+		while ((b & 1) == 0) {
+			b >>= 1;
+		}
+		if (a > b) {
+			unsigned long long temp = a;
+			a = b;
+			b = temp;
+		}
+		b -= a;
+	} while (b != 0);
+	return a << shift;
+#endif
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator> -- Greater-than equality for a HumNum
-//     compared to a HumNum, integer, or float.
+// HumNum::gcdIterative -- Returns the greatest common divisor of two
+//      numbers using an iterative algorithm.
 //
 
-bool HumNum::operator>(const HumNum& value) const {
-	if (this == &value) {
-		return false;
+int HumNum::gcdIterative(int a, int b) {
+	int c;
+	while (b) {
+		c = a;
+		a = b;
+		b = c % b;
 	}
-	return getFloat() > value.getFloat();
-}
-
-
-bool HumNum::operator>(int value) const {
-	return getFloat() > value;
-}
-
-
-bool HumNum::operator>(double value) const {
-	return getFloat() > value;
+	return a < 0 ? -a : a;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator>= -- Greater-than-or-equal equality
-//    comparison for a HumNum to another HumNum, integer, or float.
+// HumNum::gcdRecursive -- Returns the greatest common divisor of two
+//      numbers using a recursive algorithm.
 //
 
-bool HumNum::operator>=(const HumNum& value) const {
-	if (this == &value) {
-		return true;
+int HumNum::gcdRecursive(int a, int b) {
+	if (a < 0) {
+		a = -a;
 	}
-	return getFloat() >= value.getFloat();
-}
-
-
-bool HumNum::operator>=(int value) const {
-	return getFloat() >= value;
-}
-
-
-bool HumNum::operator>=(double value) const {
-	return getFloat() >= value;
-}
-
-
-
-//////////////////////////////
-//
-// HumNum::operator== -- Equality test for HumNums compared to
-//   another HumNum, integer or float.
-//
-
-bool HumNum::operator==(const HumNum& value) const {
-	if (this == &value) {
-		return true;
+	if (!b) {
+		return a;
+	} else {
+		return gcdRecursive(b, a % b);
 	}
-	return getFloat() == value.getFloat();
-}
-
-
-bool HumNum::operator==(int value) const {
-	return getFloat() == value;
-}
-
-
-bool HumNum::operator==(double value) const {
-	return getFloat() == value;
 }
 
 
 
 //////////////////////////////
 //
-// HumNum::operator!= -- Inequality test for HumNums compared
-//   to other HumNums, integers or floats.
+// HumNum::isPowerOfTwo -- Returns true if a power of two.
 //
 
-bool HumNum::operator!=(const HumNum& value) const {
-	if (this == &value) {
+bool HumNum::isPowerOfTwo(void) const {
+	if (top == 0) {
 		return false;
 	}
-	return getFloat() != value.getFloat();
-}
-
-
-bool HumNum::operator!=(int value) const {
-	return getFloat() != value;
-}
-
-
-bool HumNum::operator!=(double value) const {
-	return getFloat() != value;
+	int abstop = top > 0 ? top : -top;
+	if (bot == 1) {
+		return !(abstop & (abstop - 1));
+	} else if (abstop == 1) {
+		return !(bot & (bot - 1));
+	}
+	return false;
 }
 
 
@@ -12828,6 +12924,7 @@ ostream& operator<<(ostream& out, HumParamSet& hps) {
 HumRegex::HumRegex(void) {
 	// by default use ECMAScript regular expression syntax:
 	m_regexflags  = std::regex_constants::ECMAScript;
+	m_expflags    = m_regexflags;
 
 	m_searchflags = std::regex_constants::format_first_only;
 }
@@ -12841,7 +12938,8 @@ HumRegex::HumRegex(const string& exp, const string& options) {
 		// explicitly set the default syntax
 		m_regexflags = std::regex_constants::ECMAScript;
 	}
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	m_expflags = m_regexflags;
+	setRegex(exp, getTemporaryRegexFlags(options));
 	m_searchflags = (std::regex_constants::match_flag_type)0;
 	m_searchflags = getTemporarySearchFlags(options);
 }
@@ -12858,6 +12956,117 @@ HumRegex::~HumRegex() {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// precompiled expressions
+//
+
+//////////////////////////////
+//
+// HumRegex::compile -- Store a regular expression in the object so that
+//     it can be used repeatedly by the search(), match(), replaceDestructive()
+//     and replaceCopy() functions which do not have an expression parameter.
+//     The options are the same as for the other functions ("i" to ignore
+//     case, "g" for global replacement), and the search options remain
+//     set for later calls.
+//
+
+void HumRegex::compile(const string& exp, const string& options) {
+	setRegex(exp, getTemporaryRegexFlags(options));
+	m_searchflags = getTemporarySearchFlags(options);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::search -- Search with the expression given to compile() or
+//     to the constructor.
+//
+
+int HumRegex::search(const string& input) {
+	if (!m_regex) {
+		return 0;
+	}
+	bool result = regex_search(input, m_matches, *m_regex, m_searchflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+int HumRegex::search(const string& input, int startindex) {
+	if (!m_regex) {
+		return 0;
+	}
+	auto startit = input.begin() + startindex;
+	auto endit   = input.end();
+	bool result = regex_search(startit, endit, m_matches, *m_regex, m_searchflags);
+	if (!result) {
+		return 0;
+	} else if (m_matches.size() < 1) {
+		return 0;
+	} else {
+		return (int)m_matches.position(0) + 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::match -- Match the entire input string with the expression
+//     given to compile() or to the constructor.
+//
+
+bool HumRegex::match(const string& input) {
+	if (!m_regex) {
+		return false;
+	}
+	return regex_match(input, *m_regex, m_searchflags);
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::replaceDestructive -- Replace in the input string using the
+//     expression given to compile() or to the constructor.
+//
+
+string& HumRegex::replaceDestructive(string& input, const string& replacement) {
+	if (!m_regex) {
+		return input;
+	}
+	input = regex_replace(input, *m_regex, replacement, m_searchflags);
+	return input;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::replaceCopy -- Return a copy of the input string with
+//     replacements made using the expression given to compile() or to
+//     the constructor.
+//
+
+string HumRegex::replaceCopy(const string& input, const string& replacement) {
+	if (!m_regex) {
+		return input;
+	}
+	string output;
+	regex_replace(std::back_inserter(output), input.begin(),
+			input.end(), *m_regex, replacement, m_searchflags);
+	return output;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // option setting
@@ -12948,8 +13157,8 @@ void HumRegex::unsetGlobal(void) {
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	bool result = regex_search(input, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -12963,10 +13172,10 @@ int HumRegex::search(const string& input, const string& exp) {
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
+	bool result = regex_search(startit, endit, m_matches, *m_regex, m_searchflags);
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -12992,8 +13201,8 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	bool result = regex_search(input, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -13006,10 +13215,10 @@ int HumRegex::search(const string& input, const string& exp,
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
-	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
+	bool result = regex_search(startit, endit, m_matches, *m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
 	} else if (m_matches.size() < 1) {
@@ -13178,15 +13387,15 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	return regex_match(input, m_regex, m_searchflags);
+	setRegex(exp, m_regexflags);
+	return regex_match(input, *m_regex, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	return regex_match(input, m_regex, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	return regex_match(input, *m_regex, getTemporarySearchFlags(options));
 }
 
 
@@ -13217,8 +13426,8 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
-	input = regex_replace(input, m_regex, replacement, m_searchflags);
+	setRegex(exp, m_regexflags);
+	input = regex_replace(input, *m_regex, replacement, m_searchflags);
 	return input;
 }
 
@@ -13234,8 +13443,8 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
-	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
+	input = regex_replace(input, *m_regex, replacement, getTemporarySearchFlags(options));
 	return input;
 }
 
@@ -13246,6 +13455,31 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 }
 
 
+//
+// HumdrumToken versions: the replacement is made on a copy of the text
+//     which is then stored with HumdrumToken::setText(), so that the
+//     token's cached text analysis is cleared and edits which change the
+//     structure of the file are recorded.
+//
+
+string& HumRegex::replaceDestructive(HumdrumToken* token, const string& replacement,
+		const string& exp) {
+	string text = *token;
+	HumRegex::replaceDestructive(text, replacement, exp);
+	token->setText(text);
+	return *token;
+}
+
+
+string& HumRegex::replaceDestructive(HumdrumToken* token, const string& replacement,
+		const string& exp, const string& options) {
+	string text = *token;
+	HumRegex::replaceDestructive(text, replacement, exp, options);
+	token->setText(text);
+	return *token;
+}
+
+
 
 //////////////////////////////
 //
@@ -13255,10 +13489,10 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement);
+			input.end(), *m_regex, replacement);
 	return output;
 }
 
@@ -13274,10 +13508,10 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
-			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
+			input.end(), *m_regex, replacement, getTemporarySearchFlags(options));
 	return output;
 }
 
@@ -13379,6 +13613,68 @@ std::regex_constants::syntax_option_type HumRegex::getTemporaryRegexFlags(
 
 
 
+//////////////////////////////
+//
+// HumRegex::setRegex -- Set the regular expression for the object,
+//     reusing the current one if the expression and options have not
+//     changed, and otherwise taking it from the compiled expression cache.
+//
+
+const regex& HumRegex::setRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_regex && (flags == m_expflags) && (exp == m_exp)) {
+		return *m_regex;
+	}
+	m_regex    = getCompiledRegex(exp, flags);
+	m_exp      = exp;
+	m_expflags = flags;
+	return *m_regex;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCompiledRegex -- Return a compiled regular expression
+//     from a cache which is shared by all threads, compiling it the first
+//     time that an expression/option combination is used.  The cache is
+//     cleared if it grows too large (such as when expressions are built
+//     from input data), but expressions already in use by HumRegex objects
+//     remain valid.
+//
+
+std::shared_ptr<const regex> HumRegex::getCompiledRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	// Allocated and never deleted so that they are still available if
+	// HumRegex is used while static objects are being destroyed.
+	static std::mutex* cachelock = new std::mutex;
+	static map<pair<string, int>, std::shared_ptr<const regex>>* cache =
+			new map<pair<string, int>, std::shared_ptr<const regex>>;
+	const size_t maxsize = 1000;
+
+	pair<string, int> key(exp, (int)flags);
+	{
+		std::lock_guard<std::mutex> lock(*cachelock);
+		auto it = cache->find(key);
+		if (it != cache->end()) {
+			return it->second;
+		}
+	}
+
+	// Compile outside of the lock.  An invalid expression throws a
+	// std::regex_error here just as before.
+	std::shared_ptr<const regex> output = std::make_shared<const regex>(exp, flags);
+
+	std::lock_guard<std::mutex> lock(*cachelock);
+	if (cache->size() >= maxsize) {
+		cache->clear();
+	}
+	cache->insert(make_pair(key, output));
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumRegex::getTemporarySearchFlags --
@@ -13804,6 +14100,37 @@ void HumTool::suppressHumdrumFileOutput(void) {
 
 
 
+//////////////////////////////
+//
+// HumTool::allowParallelSegments -- Add the --threads option, which
+//    lets STREAM_INTERFACE process segments in parallel, each thread with
+//    its own copy of the tool.  Only call this from the constructor of a
+//    tool which keeps no state from one segment to the next, since the
+//    segments given to each copy of the tool are not predictable.
+//
+
+void HumTool::allowParallelSegments(void) {
+	define("threads=i:1", "number of threads for processing input segments (0 = all cores)");
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::allowSegmentPrefetch -- Add the --prefetch and
+//    --prefetch-memory options, which let runStreamInterface() read and
+//    parse input segments in a separate thread ahead of processing.
+//    Called by STREAM_INTERFACE before the command-line options are
+//    processed.
+//
+
+void HumTool::allowSegmentPrefetch(void) {
+	define("prefetch=i:0", "number of input segments to read ahead (0 = none)");
+	define("prefetch-memory=i:256", "maximum megabytes of segments to read ahead (0 = no limit)");
+}
+
+
+
 //////////////////////////////
 //
 // HumTool::hasHumdrumText -- Returns true if the output contains
@@ -14601,7 +14928,7 @@ HumdrumFileBase::HumdrumFileBase(istream& contents) : HumHash() {
 // using the following constructor:
 //
 
-HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
+HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) : HumHash() {
 
 	m_filename = infile.m_filename;
 	m_segmentlevel = infile.m_segmentlevel;
@@ -14615,6 +14942,7 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysisLevel = infile.m_analysisLevel;
 
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
@@ -14651,6 +14979,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
+	m_analysisLevel = infile.m_analysisLevel;
 
 	m_lines.resize(infile.m_lines.size());
 	for (int i=0; i<(int)m_lines.size(); i++) {
@@ -14701,9 +15030,9 @@ void HumdrumFileBase::clear(void) {
 	m_filename.clear();
 	m_segmentlevel = 0;
 	m_structure_analyzed = false;
-	m_rhythm_analyzed = false;
-	m_slurs_analyzed = false;
+	m_analyzed = 0;
 	m_nulls_analyzed = false;
+	clearEdits();
 }
 
 
@@ -14725,7 +15054,7 @@ bool HumdrumFileBase::isStructureAnalyzed(void) {
 //
 
 bool HumdrumFileBase::isRhythmAnalyzed(void) {
-	return m_rhythm_analyzed;
+	return isAnalyzed(ANALYZE_RHYTHM);
 }
 
 
@@ -14736,7 +15065,101 @@ bool HumdrumFileBase::isRhythmAnalyzed(void) {
 //
 
 bool HumdrumFileBase::areStrandsAnalyzed(void) {
-	return m_strands_analyzed;
+	return isAnalyzed(ANALYZE_STRANDS);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::setAnalysisLevel -- Set the analyses which are done
+//    when reading a file, using the ANALYZE_* defines (see
+//    HumdrumFileBase.h).  Analyses not included in the level are done
+//    later when they are needed.  The level stays in effect for later
+//    reads.  The default level is ANALYZE_STRUCTURE.  The readNoRhythm()
+//    functions only use the ANALYZE_BASE part of the level.
+//
+
+void HumdrumFileBase::setAnalysisLevel(int levels) {
+	m_analysisLevel = levels;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getAnalysisLevel -- Return the analyses which are
+//    done when reading a file.
+//
+
+int HumdrumFileBase::getAnalysisLevel(void) const {
+	return m_analysisLevel;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::isAnalyzed -- Returns true if all of the given
+//    ANALYZE_* analyses have been done on the file.
+//
+
+bool HumdrumFileBase::isAnalyzed(int levels) const {
+	return (m_analyzed & levels) == levels;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::analyze -- Do any of the given ANALYZE_* analyses
+//    (and the analyses which they depend on) that have not already been
+//    done.  HumdrumFileStructure and HumdrumFileContent add the analyses
+//    that they are responsible for.  Tokens are only created for lines
+//    that do not already have them, since accessing a line's tokens
+//    will create them for that line.
+//
+
+bool HumdrumFileBase::analyze(int levels) {
+	if (levels & ANALYZE_LINKS) {
+		levels |= ANALYZE_SPINES;
+	}
+	if (levels & ANALYZE_SPINES) {
+		levels |= ANALYZE_TOKENS;
+	}
+	if ((levels & ANALYZE_TOKENS) && !isAnalyzed(ANALYZE_TOKENS)) {
+		m_analyzed |= ANALYZE_TOKENS;
+		for (int i=0; i<(int)m_lines.size(); i++) {
+			if (m_lines[i]->m_tokens.empty()) {
+				m_lines[i]->createTokensFromLine();
+			}
+		}
+		if (!analyzeLines()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_SPINES) && !isAnalyzed(ANALYZE_SPINES)) {
+		m_analyzed |= ANALYZE_SPINES;
+		if (!analyzeSpines()) { return isValid(); }
+		if (!analyzeTracks()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_LINKS) && !isAnalyzed(ANALYZE_LINKS)) {
+		m_analyzed |= ANALYZE_LINKS;
+		if (!analyzeLinks()) { return isValid(); }
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::checkSpines -- Analyze the spines of the file if
+//    this has not been done yet (used by spine accessor functions).
+//
+
+void HumdrumFileBase::checkSpines(void) const {
+	if (!(m_analyzed & ANALYZE_SPINES)) {
+		const_cast<HumdrumFileBase*>(this)->analyze(ANALYZE_SPINES);
+	}
 }
 
 
@@ -14852,30 +15275,31 @@ bool HumdrumFileBase::read(const char* filename) {
 	}
 #endif
 
-	ifstream infile;
 	if (fname.empty() || (fname ==  "-")) {
 		return HumdrumFileBase::read(cin);
-	} else {
-		infile.open(filename);
-		if (!infile.is_open()) {
-			return setParseError("Cannot open file >>%s<< for reading. A", filename);
-		}
+	}
+
+#ifdef USING_MMAP
+	return readMappedFile(filename);
+#else
+	ifstream infile;
+	infile.open(filename);
+	if (!infile.is_open()) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
 	}
 	HumdrumFileBase::read(infile);
 	infile.close();
 	return isValid();
+#endif
 }
 
 
 bool HumdrumFileBase::read(istream& contents) {
 	clear();
 	m_displayError = true;
-	char buffer[123123] = {0};
-	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
-		s = new HumdrumLine(buffer);
-		s->setOwner(this);
-		m_lines.push_back(s);
+	string buffer;
+	while (getline(contents, buffer, '\n')) {
+		appendLineText(buffer.data(), buffer.size());
 	}
 	return analyzeBaseFromLines();
 /*
@@ -14920,9 +15344,9 @@ bool HumdrumFileBase::readCsv(const char* filename, const string& separator) {
 
 bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 	m_displayError = true;
-	char buffer[123123] = {0};
+	string buffer;
 	HumdrumLine* s;
-	while (contents.getline(buffer, sizeof(buffer), '\n')) {
+	while (getline(contents, buffer, '\n')) {
 		s = new HumdrumLine;
 		s->setLineFromCsv(buffer);
 		s->setOwner(this);
@@ -14939,12 +15363,18 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 //
 
 bool HumdrumFileBase::analyzeBaseFromLines(void)  {
+	// New tokens are created, so any previous analysis is no longer valid.
+	m_analyzed = 0;
+	m_nulls_analyzed = false;
+	clearEdits();
+	if (!(m_analysisLevel & ANALYZE_BASE)) {
+		// Tokens will be created when they are needed.
+		return analyzeLines();
+	}
+	m_analyzed |= ANALYZE_TOKENS;
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
-	if (!analyzeSpines()) { return isValid(); }
-	if (!analyzeLinks() ) { return isValid(); }
-	if (!analyzeTracks()) { return isValid(); }
-	return isValid();
+	return analyze(m_analysisLevel & ANALYZE_BASE);
 }
 
 
@@ -14956,6 +15386,8 @@ bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 
 bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 	// if (!analyzeTokens()) { return isValid(); } // this creates tokens from lines
+	m_analyzed |= ANALYZE_BASE;
+	clearEdits();
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
 	if (!analyzeLinks() ) { return isValid(); }
@@ -14972,21 +15404,109 @@ bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 //
 
 bool HumdrumFileBase::readString(const string& contents) {
-	stringstream infile;
-	infile << contents;
-	bool status = read(infile);
-	return status;
+	return readBuffer(contents.data(), contents.size());
 }
 
 
 bool HumdrumFileBase::readString(const char* contents) {
-	stringstream infile;
-	infile << contents;
-	return read(infile);
+	return readBuffer(contents, strlen(contents));
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBuffer -- Read contents from a block of memory
+//    that does not need to be null-terminated.  Lines are copied
+//    directly from the buffer into HumdrumLines, so there is no
+//    limit on the length of a line.
+//
+
+bool HumdrumFileBase::readBuffer(const char* contents, size_t size) {
+	clear();
+	m_displayError = true;
+	const char* ptr = contents;
+	const char* end = contents + size;
+	while (ptr < end) {
+		const char* eol = (const char*)memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			eol = end;
+		}
+		appendLineText(ptr, eol - ptr);
+		ptr = eol + 1;
+	}
+	return analyzeBaseFromLines();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendLineText -- Store a line of text at the end
+//    of the file without splitting it into tokens (which is done later
+//    by analyzeTokens).  A trailing carriage return is removed.
+//
+
+void HumdrumFileBase::appendLineText(const char* text, size_t size) {
+	if ((size > 0) && (text[size - 1] == 0x0d)) {
+		size--;
+	}
+	HumdrumLine* s = new HumdrumLine;
+	s->assign(text, size);
+	s->setOwner(this);
+	m_lines.push_back(s);
 }
 
 
 
+#ifdef USING_MMAP
+
+//////////////////////////////
+//
+// HumdrumFileBase::readMappedFile -- Read a file by mapping it into
+//    memory rather than streaming it through an ifstream.  The text is
+//    copied once from the mapped pages into the HumdrumLines.
+//
+
+bool HumdrumFileBase::readMappedFile(const char* filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		// Not a regular file (such as a pipe), so read as a stream.
+		close(fd);
+		ifstream infile(filename);
+		if (!infile.is_open()) {
+			return setParseError("Cannot open file >>%s<< for reading. A", filename);
+		}
+		HumdrumFileBase::read(infile);
+		return isValid();
+	}
+	size_t size = (size_t)info.st_size;
+	if (size == 0) {
+		close(fd);
+		return readBuffer("", 0);
+	}
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return setParseError("Cannot map file >>%s<< for reading.", filename);
+	}
+#ifdef MADV_SEQUENTIAL
+	madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+	bool status = readBuffer((const char*)data, size);
+	munmap(data, size);
+	return status;
+}
+
+#endif
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::readStringCsv -- Reads Humdrum data in CSV format.
@@ -15323,59 +15843,73 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
-//    spine and rhythmic structure should be recalculated after an append.
+//    spine and rhythmic structure should be recalculated after an append,
+//    either with reanalyzeEdits() or by reading the file again.
 //
 
 void HumdrumFileBase::appendLine(const char* line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.push_back(s);
+	appendLine(new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::appendLine(const string& line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.push_back(s);
+	appendLine(new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::appendLine(HumdrumLine* line) {
 	// deletion will be handled by class.
-	m_lines.push_back(line);
+	insertLine((int)m_lines.size(), line);
 }
 
 
 
 ////////////////////////////
 //
-// HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
-//    spine and rhythmic structure should be recalculated after an append.
+// HumdrumFileBase::insertLine -- Insert a line into the file's contents
+//    before the given line index.  The indexes of the following lines are
+//    updated, and the line is marked as edited so that reanalyzeEdits() can
+//    repair the analysis of the file around it.
 //
 
-
 void HumdrumFileBase::insertLine(int index, const char* line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.insert(m_lines.begin() + index, s);
+	insertLine(index, new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::insertLine(int index, const string& line) {
-	HumdrumLine* s = new HumdrumLine(line);
-	m_lines.insert(m_lines.begin() + index, s);
+	insertLine(index, new HumdrumLine(line));
 }
 
 
 void HumdrumFileBase::insertLine(int index, HumdrumLine* line) {
 	// deletion will be handled by class.
 	m_lines.insert(m_lines.begin() + index, line);
+	line->setOwner(this);
+	if (isAnalyzed(ANALYZE_TOKENS) && line->m_tokens.empty()) {
+		line->createTokensFromLine();
+	}
+	for (int i=index; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setLineIndex(i);
+	}
+	if (m_editStart >= index) {
+		m_editStart++;
+	}
+	if (m_editEnd >= index) {
+		m_editEnd++;
+	}
+	markLineEdited(index);
 }
 
 
 //////////////////////////////
 //
 // HumdrumFileBase::deleteLine -- remove a line from the Humdrum file.
-//    Is best used for global comments and reference records for now.
-//    Other line types will cause parsing problems untill further
-//    generalized to stitch previous next lines together.
+//    The indexes of the following lines are updated, and the neighboring
+//    lines are marked as edited so that reanalyzeEdits() can stitch the
+//    previous and next lines together.  Deleting a spine manipulator
+//    (or a signifier or layout parameter) requires the whole file to be
+//    analyzed again.
 //
 
 void HumdrumFileBase::deleteLine(int index) {
@@ -15385,14 +15919,282 @@ void HumdrumFileBase::deleteLine(int index) {
 	if (index < 0) {
 		return;
 	}
-	delete m_lines[index];
-	for (int i=index+1; i<(int)m_lines.size(); i++) {
-		m_lines[i-1] = m_lines[i];
+	HumdrumLine* line = m_lines[index];
+	if (isAnalyzed(ANALYZE_TOKENS)) {
+		if (line->hasSpines() && line->isManipulator()) {
+			m_editReparse = true;
+		} else if (line->isComment() && (line->find("LO:") != string::npos)) {
+			m_editReparse = true;
+		}
+	}
+	if (line->hasSpines() && isAnalyzed(ANALYZE_STRANDS)) {
+		// Strands which start on the deleted line now start on the next line.
+		for (int i=0; i<(int)m_strand1d.size(); i++) {
+			if (m_strand1d[i].first && (m_strand1d[i].first->getOwner() == line)) {
+				m_strand1d[i].first = m_strand1d[i].first->getNextToken(0);
+			}
+		}
+		for (int i=0; i<(int)m_strand2d.size(); i++) {
+			for (int j=0; j<(int)m_strand2d[i].size(); j++) {
+				if (m_strand2d[i][j].first && (m_strand2d[i][j].first->getOwner() == line)) {
+					m_strand2d[i][j].first = m_strand2d[i][j].first->getNextToken(0);
+				}
+			}
+		}
+	}
+	delete line;
+	m_lines.erase(m_lines.begin() + index);
+	for (int i=index; i<(int)m_lines.size(); i++) {
+		m_lines[i]->setLineIndex(i);
+	}
+	if (m_editStart > index) {
+		m_editStart--;
+	}
+	if (m_editEnd >= index) {
+		m_editEnd--;
+	}
+	if (index < (int)m_lines.size()) {
+		markLineEdited(index);
+	} else {
+		markLineEdited(index - 1);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::markLineEdited -- Note that the contents of a line have
+//    been changed so that reanalyzeEdits() will repair the analysis of the
+//    file around the line.  This is done automatically by insertLine(),
+//    deleteLine(), HumdrumLine::appendToken() and HumdrumToken::setText()
+//    (when the new text changes the duration or type of the token).
+//
+
+void HumdrumFileBase::markLineEdited(int index) {
+	if ((index < 0) || (index >= (int)m_lines.size())) {
+		return;
+	}
+	if ((m_editStart < 0) || (index < m_editStart)) {
+		m_editStart = index;
+	}
+	if (index > m_editEnd) {
+		m_editEnd = index;
 	}
-	m_lines.resize(m_lines.size() - 1);
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumFileBase::hasEdits -- Returns true if lines have been edited
+//    since the file was last analyzed.
+//
+
+bool HumdrumFileBase::hasEdits(void) const {
+	return (m_editStart >= 0) || m_editReparse;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::clearEdits -- Forget about edited lines (such as after
+//    the file has been analyzed again).
+//
+
+void HumdrumFileBase::clearEdits(void) {
+	m_editStart = -1;
+	m_editEnd = -1;
+	m_editReparse = false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::reanalyzeEdits -- Update the analysis of the file after
+//    lines have been inserted, deleted or edited.  Only the edited region
+//    is analyzed again when the spine structure of the file is not changed
+//    by the edits; otherwise, the file is read again from the text of its
+//    lines (so pointers to its lines and tokens will no longer be valid).
+//    HumdrumFileStructure also repairs the rhythm analysis of the file.
+//
+
+bool HumdrumFileBase::reanalyzeEdits(void) {
+	if (!hasEdits()) {
+		return isValid();
+	}
+	if (!isAnalyzed(ANALYZE_TOKENS)) {
+		clearEdits();
+		return isValid();
+	}
+	if (!repairEditedSpines(m_editStart, m_editEnd)) {
+		string text = getEditedText();
+		return HumdrumFileBase::readString(text);
+	}
+	clearEdits();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getEditedText -- Return the text of the file after
+//    updating the text of edited lines from their tokens.
+//
+
+string HumdrumFileBase::getEditedText(void) {
+	string output;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if ((i >= m_editStart) && (i <= m_editEnd) && !m_lines[i]->m_tokens.empty()) {
+			m_lines[i]->createLineFromTokens();
+		}
+		output += *m_lines[i];
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::repairEditedSpines -- Create tokens, spine information
+//    and spine links for the lines between startline and endline, and
+//    link them to the spined lines before and after them.  Returns false
+//    if the edits cannot be repaired without analyzing the entire file
+//    again, such as when a spine manipulator was added or removed, or if
+//    the number of fields on a line no longer matches the following line.
+//
+
+bool HumdrumFileBase::repairEditedSpines(int startline, int endline) {
+	if (m_editReparse) {
+		return false;
+	}
+	if ((startline < 0) || (endline >= (int)m_lines.size())) {
+		return true;
+	}
+
+	int i, j;
+	for (i=startline; i<=endline; i++) {
+		m_lines[i]->setOwner(this);
+		if (m_lines[i]->m_tokens.empty()) {
+			m_lines[i]->createTokensFromLine();
+		}
+		if (m_lines[i]->hasSpines()) {
+			for (j=0; j<m_lines[i]->getTokenCount(); j++) {
+				m_lines[i]->token(j)->setOwner(m_lines[i]);
+			}
+		} else {
+			m_lines[i]->token(0)->setOwner(m_lines[i]);
+			m_lines[i]->token(0)->setFieldIndex(0);
+		}
+	}
+	if (!isAnalyzed(ANALYZE_SPINES)) {
+		return true;
+	}
+
+	vector<HumdrumLine*> region;
+	HumdrumLine* previous = NULL;
+	HumdrumLine* next = NULL;
+	getEditedRegion(startline, endline, region, previous, next);
+	if (!previous || !next) {
+		// Spine starts and ends cannot be changed locally.
+		return region.empty();
+	}
+	int fieldcount = next->getTokenCount();
+	if (!previous->isManipulator() && (previous->getTokenCount() != fieldcount)) {
+		return false;
+	}
+	for (i=0; i<(int)region.size(); i++) {
+		if (region[i]->isManipulator()) {
+			return false;
+		}
+		if (region[i]->getTokenCount() != fieldcount) {
+			return false;
+		}
+	}
+
+	// The spine information of the edited lines is the same as the spine
+	// information of the (incoming) tokens on the next line.
+	for (i=0; i<(int)region.size(); i++) {
+		for (j=0; j<fieldcount; j++) {
+			HTp token = region[i]->token(j);
+			token->setSpineInfo(next->token(j)->getSpineInfo());
+			token->setFieldIndex(j);
+		}
+		if (!region[i]->analyzeTracks(m_parseError)) {
+			return false;
+		}
+	}
+	if (!isAnalyzed(ANALYZE_LINKS)) {
+		return true;
+	}
+
+	for (j=0; j<previous->getTokenCount(); j++) {
+		previous->token(j)->m_nextTokens.clear();
+	}
+	for (j=0; j<fieldcount; j++) {
+		next->token(j)->m_previousTokens.clear();
+	}
+	for (i=0; i<(int)region.size(); i++) {
+		for (j=0; j<fieldcount; j++) {
+			region[i]->token(j)->m_nextTokens.clear();
+			region[i]->token(j)->m_previousTokens.clear();
+		}
+	}
+	HumdrumLine* last = previous;
+	for (i=0; i<(int)region.size(); i++) {
+		if (!stitchLinesTogether(*last, *region[i])) {
+			return false;
+		}
+		last = region[i];
+	}
+	if (!stitchLinesTogether(*last, *next)) {
+		return false;
+	}
+
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getEditedRegion -- Return the spined lines between
+//    startline and endline, as well as the spined lines before and after
+//    them (or NULL if there are none).
+//
+
+void HumdrumFileBase::getEditedRegion(int startline, int endline,
+		vector<HumdrumLine*>& region, HumdrumLine*& previous,
+		HumdrumLine*& next) {
+	region.clear();
+	previous = NULL;
+	next = NULL;
+	for (int i=startline-1; i>=0; i--) {
+		if (m_lines[i]->hasSpines()) {
+			previous = m_lines[i];
+			break;
+		}
+	}
+	for (int i=startline; i<=endline; i++) {
+		if (m_lines[i]->hasSpines()) {
+			region.push_back(m_lines[i]);
+		}
+	}
+	for (int i=endline+1; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->hasSpines()) {
+			next = m_lines[i];
+			break;
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::back --
@@ -15510,6 +16312,7 @@ string HumdrumFileBase::token(int lineindex, int fieldindex,
 //
 
 int HumdrumFileBase::getMaxTrack(void) const {
+	checkSpines();
 	return (int)m_trackstarts.size() - 1;
 }
 
@@ -15581,6 +16384,7 @@ int HumdrumFileBase::getExinterpCount(const string& exinterp) {
 //
 
 void HumdrumFileBase::getSpineStopList(vector<HTp>& spinestops) {
+	checkSpines();
 	spinestops.reserve(m_trackends.size());
 	spinestops.resize(0);
 	for (int i=0; i<(int)m_trackends.size(); i++) {
@@ -15605,6 +16409,7 @@ void HumdrumFileBase::getSpineStopList(vector<HTp>& spinestops) {
 //
 
 void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts) {
+	checkSpines();
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
 	for (int i=1; i<(int)m_trackstarts.size(); i++) {
@@ -15622,6 +16427,7 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 		newexinterp = "**";
 		newexinterp += exinterp;
 	}
+	checkSpines();
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
 	for (int i=1; i<(int)m_trackstarts.size(); i++) {
@@ -15643,6 +16449,7 @@ void HumdrumFileBase::getSpineStartList(vector<HTp>& spinestarts,
 			newexinterps[i] += exinterps[i];
 		}
 	}
+	checkSpines();
 	spinestarts.reserve(m_trackstarts.size());
 	spinestarts.resize(0);
 	for (int i=1; i<(int)m_trackstarts.size(); i++) {
@@ -15852,6 +16659,7 @@ void HumdrumFileBase::getTrackSequence(vector<vector<HTp> >& sequence,
 //
 
 HTp HumdrumFileBase::getTrackStart(int track) const {
+	checkSpines();
 	if ((track > 0) && (track < (int)m_trackstarts.size())) {
 		return m_trackstarts[track];
 	} else {
@@ -15872,6 +16680,7 @@ HTp HumdrumFileBase::getTrackStart(int track) const {
 //
 
 int HumdrumFileBase::getTrackEndCount(int track) const {
+	checkSpines();
 	if (track < 0) {
 		track += (int)m_trackends.size();
 	}
@@ -15894,6 +16703,7 @@ int HumdrumFileBase::getTrackEndCount(int track) const {
 //
 
 HTp HumdrumFileBase::getTrackEnd(int track, int subtrack) const {
+	checkSpines();
 	if (track < 0) {
 		track += (int)m_trackends.size();
 	}
@@ -16122,6 +16932,7 @@ bool HumdrumFileBase::analyzeSpines(void) {
 	m_trackstarts.resize(0);
 	m_trackends.resize(0);
 	addToTrackStarts(NULL);
+	HumdrumToken::invalidateDataTypes();
 
 	bool init = false;
 	int i, j;
@@ -16942,35 +17753,79 @@ std::string HumdrumFileBase::getReferenceRecord(const std::string& key) {
 //
 
 bool HumdrumFileContent::analyzeKernAccidentals(void) {
+	m_analyzed |= ANALYZE_ACCIDENTALS;
 
 	// ottava marks must be analyzed first:
 	this->analyzeOttavas();
 
 	HumdrumFileContent& infile = *this;
-	int i, j, k;
-	int kindex;
-	int track;
 
 	// ktracks == List of **kern spines in data.
 	// rtracks == Reverse mapping from track to ktrack index (part/staff index).
 	vector<HTp> ktracks = getKernSpineStartList();
 	vector<int> rtracks(getMaxTrack()+1, -1);
-	for (i=0; i<(int)ktracks.size(); i++) {
-		track = ktracks[i]->getTrack();
-		rtracks[track] = i;
+	for (int i=0; i<(int)ktracks.size(); i++) {
+		rtracks[ktracks[i]->getTrack()] = i;
 	}
 	int kcount = (int)ktracks.size();
 
-	// keysigs == key signature spellings of diatonic pitch classes.  This array
-	// is duplicated into dstates after each barline.
-	vector<vector<int> > keysigs;
-	keysigs.resize(kcount);
-	for (i=0; i<kcount; i++) {
-		keysigs[i].resize(7);
-		std::fill(keysigs[i].begin(), keysigs[i].end(), 0);
+	// tracktokens == key signatures, barlines and data tokens of each
+	// **kern spine in line order.  The accidental states are separate
+	// for each spine, so the spines can be analyzed independently.
+	// barlines == lines which contain a visible **kern barline.
+	vector<vector<HTp>> tracktokens(kcount);
+	vector<char> barlines(infile.getLineCount(), 0);
+	for (int i=0; i<infile.getLineCount(); i++) {
+		bool interpQ = infile[i].isInterpretation();
+		bool barlineQ = infile[i].isBarline();
+		if (!(interpQ || barlineQ || infile[i].isData())) {
+			continue;
+		}
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			if (interpQ && (token->compare(0, 3, "*k[") != 0)) {
+				continue;
+			}
+			if (barlineQ && !token->isInvisible()) {
+				barlines[i] = 1;
+			}
+			int rindex = rtracks[token->getTrack()];
+			if (rindex >= 0) {
+				tracktokens[rindex].push_back(token);
+			}
+		}
 	}
 
-	// dstates == diatonic states for every pitch in a spine.
+	runSpineTasks(kcount, [&](int index) {
+		analyzeKernAccidentals(tracktokens[index], barlines);
+	});
+
+	// Indicate that the accidental analysis has been done:
+	infile.setValue("auto", "accidentalAnalysis", "true");
+
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeKernAccidentals -- Analyze the accidentals
+//    of a single **kern spine, given the list of its key signatures,
+//    barlines and data tokens.
+//
+
+bool HumdrumFileContent::analyzeKernAccidentals(vector<HTp>& tokens,
+		vector<char>& barlines) {
+
+	// keysig == key signature spellings of diatonic pitch classes.  This array
+	// is duplicated into dstates after each barline.
+	vector<int> keysig(7, 0);
+
+	// dstates == diatonic states for every pitch in the spine.
 	// sub-spines are considered as a single unit, although there are
 	// score conventions which would keep a separate voices on a staff
 	// with different accidental states (i.e., two parts superimposed
@@ -16978,398 +17833,356 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 	// Eventually this algorithm should be adjusted for dealing with
 	// cross-staff notes, where the cross-staff notes should be following
 	// the accidentals of a different spine...
-	vector<vector<int> > dstates; // diatonic states
-	dstates.resize(kcount);
-	for (i=0; i<kcount; i++) {
-		dstates[i].resize(70);     // 10 octave limit for analysis
-			                        // may cause problems; fix later.
-		std::fill(dstates[i].begin(), dstates[i].end(), 0);
-	}
+	vector<int> dstates(70, 0); // 10 octave limit for analysis
+	                            // may cause problems; fix later.
 
-	// gdstates == grace note diatonic states for every pitch in a spine.
-	vector<vector<int> > gdstates; // grace-note diatonic states
-	gdstates.resize(kcount);
-	for (i=0; i<kcount; i++) {
-		gdstates[i].resize(70);
-		std::fill(gdstates[i].begin(), gdstates[i].end(), 0);
-	}
+	// gdstates == grace note diatonic states for every pitch in the spine.
+	vector<int> gdstates(70, 0);
 
-	// rhythmstart == keep track of first beat in measure.
-	vector<int> firstinbar(kcount, 0);
+	// firstinbar == keep track of first beat in measure.
+	int firstinbar = 0;
 
-	int lasttrack = -1;
 	vector<int> concurrentstate(70, 0);
+	int lastline = -1;
+	bool lastdataQ = false;
 
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].hasSpines()) {
-			continue;
-		}
-		if (infile[i].isInterpretation()) {
-			for (j=0; j<infile[i].getFieldCount(); j++) {
-				if (!infile[i].token(j)->isKern()) {
-					continue;
-				}
-				if (infile[i].token(j)->compare(0, 3, "*k[") == 0) {
-					track = infile[i].token(j)->getTrack();
-					kindex = rtracks[track];
-					fillKeySignature(keysigs[kindex], *infile[i].token(j));
-					// resetting key states of current measure.  What to do if this
-					// key signature is in the middle of a measure?
-					resetDiatonicStatesWithKeySignature(dstates[kindex],
-							keysigs[kindex]);
-					resetDiatonicStatesWithKeySignature(gdstates[kindex],
-							keysigs[kindex]);
-				}
+	for (int p=0; p<(int)tokens.size(); p++) {
+		HTp token = tokens[p];
+		int line = token->getLineIndex();
+		if (line != lastline) {
+			// firstinbar is set by the barline of any staff, and is cleared
+			// after the next data line.
+			if (lastdataQ) {
+				firstinbar = 0;
 			}
-		} else if (infile[i].isBarline()) {
-			for (j=0; j<infile[i].getFieldCount(); j++) {
-				if (!infile[i].token(j)->isKern()) {
-					continue;
-				}
-				if (infile[i].token(j)->isInvisible()) {
-					continue;
-				}
-				std::fill(firstinbar.begin(), firstinbar.end(), 1);
-				track = infile[i].token(j)->getTrack();
-				kindex = rtracks[track];
-				// reset the accidental states in dstates to match keysigs.
-				resetDiatonicStatesWithKeySignature(dstates[kindex],
-						keysigs[kindex]);
-				resetDiatonicStatesWithKeySignature(gdstates[kindex],
-						keysigs[kindex]);
+			if (barlines[line]) {
+				firstinbar = 1;
 			}
+			fill(concurrentstate.begin(), concurrentstate.end(), 0);
+			lastline = line;
 		}
+		lastdataQ = token->isData();
 
-		if (!infile[i].isData()) {
+		if (token->isInterpretation()) {
+			fillKeySignature(keysig, *token);
+			// resetting key states of current measure.  What to do if this
+			// key signature is in the middle of a measure?
+			resetDiatonicStatesWithKeySignature(dstates, keysig);
+			resetDiatonicStatesWithKeySignature(gdstates, keysig);
 			continue;
 		}
-
-		fill(concurrentstate.begin(), concurrentstate.end(), 0);
-		lasttrack = -1;
-
-		for (j=0; j<infile[i].getFieldCount(); j++) {
-			if (!infile[i].token(j)->isKern()) {
-				continue;
-			}
-			if (infile[i].token(j)->isNull()) {
-				continue;
+		if (token->isBarline()) {
+			if (!token->isInvisible()) {
+				// reset the accidental states in dstates to match keysig.
+				resetDiatonicStatesWithKeySignature(dstates, keysig);
+				resetDiatonicStatesWithKeySignature(gdstates, keysig);
 			}
-			if (infile[i].token(j)->isRest()) {
+			continue;
+		}
+		if (token->isNull()) {
+			continue;
+		}
+		if (token->isRest()) {
+			continue;
+		}
+
+		int subcount = token->getSubtokenCount();
+		for (int k=0; k<subcount; k++) {
+			string subtok = token->getSubtoken(k);
+			int b40 = Convert::kernToBase40(subtok);
+			int diatonic = Convert::kernToBase7(subtok);
+			int octaveadjust = token->getValueInt("auto", "ottava");
+			diatonic -= octaveadjust * 7;
+			if (diatonic < 0) {
+				// Deal with extra-low notes later.
 				continue;
 			}
-
-			int subcount = infile[i].token(j)->getSubtokenCount();
-			track = infile[i].token(j)->getTrack();
-
-			if (lasttrack != track) {
-				fill(concurrentstate.begin(), concurrentstate.end(), 0);
+			int graceQ = token->isGrace();
+			int accid = Convert::kernToAccidentalCount(subtok);
+			int hiddenQ = 0;
+			if (subtok.find("yy") == string::npos) {
+				if ((subtok.find("ny") != string::npos) ||
+				    (subtok.find("#y") != string::npos) ||
+				    (subtok.find("-y") != string::npos)) {
+					hiddenQ = 1;
+				}
 			}
-			lasttrack = track;
 
-			int rindex = rtracks[track];
-			for (k=0; k<subcount; k++) {
-				HTp token = infile[i].token(j);
-				string subtok = token->getSubtoken(k);
-				int b40 = Convert::kernToBase40(subtok);
-				int diatonic = Convert::kernToBase7(subtok);
-				int octaveadjust = token->getValueInt("auto", "ottava");
-				diatonic -= octaveadjust * 7;
-				if (diatonic < 0) {
-					// Deal with extra-low notes later.
-					continue;
+			if (((subtok.find("_") != string::npos) ||
+					(subtok.find("]") != string::npos))) {
+				// tied notes do not have slurs, so skip them
+				if ((accid != keysig[diatonic % 7]) && firstinbar) {
+					// But first, prepare to force an accidental to be shown on
+					// the note immediately following the end of a tied group
+					// if the tied group crosses a barline.
+					dstates[diatonic] = -1000 + accid;
+					gdstates[diatonic] = -1000 + accid;
 				}
-				int graceQ = infile[i].token(j)->isGrace();
-				int accid = Convert::kernToAccidentalCount(subtok);
-				int hiddenQ = 0;
-				if (subtok.find("yy") == string::npos) {
-					if ((subtok.find("ny") != string::npos) ||
-					    (subtok.find("#y") != string::npos) ||
-					    (subtok.find("-y") != string::npos)) {
-						hiddenQ = 1;
-					}
-				}
-
-				if (((subtok.find("_") != string::npos) ||
-						(subtok.find("]") != string::npos))) {
-					// tied notes do not have slurs, so skip them
-					if ((accid != keysigs[rindex][diatonic % 7]) &&
-							firstinbar[rindex]) {
-						// But first, prepare to force an accidental to be shown on
-						// the note immediately following the end of a tied group
-						// if the tied group crosses a barline.
-						dstates[rindex][diatonic] = -1000 + accid;
-						gdstates[rindex][diatonic] = -1000 + accid;
-					}
-					auto loc = subtok.find('X');
-					if (loc == string::npos) {
-						continue;
-					} else if (loc == 0) {
+				auto loc = subtok.find('X');
+				if (loc == string::npos) {
+					continue;
+				} else if (loc == 0) {
+					continue;
+				} else {
+					if (!((subtok[loc-1] == '#') || (subtok[loc-1] == '-') ||
+							(subtok[loc-1] == 'n'))) {
 						continue;
 					} else {
-						if (!((subtok[loc-1] == '#') || (subtok[loc-1] == '-') ||
-								(subtok[loc-1] == 'n'))) {
-							continue;
-						} else {
-							// an accidental should be fored at end of tie
-						}
+						// an accidental should be fored at end of tie
 					}
 				}
+			}
 
-				size_t loc;
-				// check for accidentals on trills, mordents and turns.
-				if (subtok.find("t") != string::npos) {
-					// minor second trill
-					int trillnote     = b40 + 5;
-					int trilldiatonic = Convert::base40ToDiatonic(trillnote);
-					int trillaccid    = Convert::base40ToAccidental(trillnote);
-					if (dstates[rindex][trilldiatonic] != trillaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"trillAccidental", to_string(trillaccid));
-						dstates[rindex][trilldiatonic] = -1000 + trillaccid;
-					}
-				} else if (subtok.find("T") != string::npos) {
-					// major second trill
-					int trillnote     = b40 + 6;
-					int trilldiatonic = Convert::base40ToDiatonic(trillnote);
-					int trillaccid    = Convert::base40ToAccidental(trillnote);
-					if (dstates[rindex][trilldiatonic] != trillaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"trillAccidental", to_string(trillaccid));
-						dstates[rindex][trilldiatonic] = -1000 + trillaccid;
-					}
-				} else if (subtok.find("M") != string::npos) {
-					// major second upper mordent
-					int auxnote     = b40 + 6;
-					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
-					int auxaccid    = Convert::base40ToAccidental(auxnote);
-					if (dstates[rindex][auxdiatonic] != auxaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"mordentUpperAccidental", to_string(auxaccid));
-						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
-					}
-				} else if (subtok.find("m") != string::npos) {
-					// minor second upper mordent
-					int auxnote     = b40 + 5;
-					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
-					int auxaccid    = Convert::base40ToAccidental(auxnote);
-					if (dstates[rindex][auxdiatonic] != auxaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"mordentUpperAccidental", to_string(auxaccid));
-						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
-					}
-				} else if (subtok.find("W") != string::npos) {
-					// major second upper mordent
-					int auxnote     = b40 - 6;
-					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
-					int auxaccid    = Convert::base40ToAccidental(auxnote);
-					if (dstates[rindex][auxdiatonic] != auxaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"mordentLowerAccidental", to_string(auxaccid));
-						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
-					}
-				} else if (subtok.find("w") != string::npos) {
-					// minor second upper mordent
-					int auxnote     = b40 - 5;
-					int auxdiatonic = Convert::base40ToDiatonic(auxnote);
-					int auxaccid    = Convert::base40ToAccidental(auxnote);
-					if (dstates[rindex][auxdiatonic] != auxaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"mordentLowerAccidental", to_string(auxaccid));
-						dstates[rindex][auxdiatonic] = -1000 + auxaccid;
-					}
+			size_t loc;
+			// check for accidentals on trills, mordents and turns.
+			if (subtok.find("t") != string::npos) {
+				// minor second trill
+				int trillnote     = b40 + 5;
+				int trilldiatonic = Convert::base40ToDiatonic(trillnote);
+				int trillaccid    = Convert::base40ToAccidental(trillnote);
+				if (dstates[trilldiatonic] != trillaccid) {
+					token->setValue("auto", to_string(k),
+							"trillAccidental", to_string(trillaccid));
+					dstates[trilldiatonic] = -1000 + trillaccid;
+				}
+			} else if (subtok.find("T") != string::npos) {
+				// major second trill
+				int trillnote     = b40 + 6;
+				int trilldiatonic = Convert::base40ToDiatonic(trillnote);
+				int trillaccid    = Convert::base40ToAccidental(trillnote);
+				if (dstates[trilldiatonic] != trillaccid) {
+					token->setValue("auto", to_string(k),
+							"trillAccidental", to_string(trillaccid));
+					dstates[trilldiatonic] = -1000 + trillaccid;
+				}
+			} else if (subtok.find("M") != string::npos) {
+				// major second upper mordent
+				int auxnote     = b40 + 6;
+				int auxdiatonic = Convert::base40ToDiatonic(auxnote);
+				int auxaccid    = Convert::base40ToAccidental(auxnote);
+				if (dstates[auxdiatonic] != auxaccid) {
+					token->setValue("auto", to_string(k),
+							"mordentUpperAccidental", to_string(auxaccid));
+					dstates[auxdiatonic] = -1000 + auxaccid;
+				}
+			} else if (subtok.find("m") != string::npos) {
+				// minor second upper mordent
+				int auxnote     = b40 + 5;
+				int auxdiatonic = Convert::base40ToDiatonic(auxnote);
+				int auxaccid    = Convert::base40ToAccidental(auxnote);
+				if (dstates[auxdiatonic] != auxaccid) {
+					token->setValue("auto", to_string(k),
+							"mordentUpperAccidental", to_string(auxaccid));
+					dstates[auxdiatonic] = -1000 + auxaccid;
+				}
+			} else if (subtok.find("W") != string::npos) {
+				// major second upper mordent
+				int auxnote     = b40 - 6;
+				int auxdiatonic = Convert::base40ToDiatonic(auxnote);
+				int auxaccid    = Convert::base40ToAccidental(auxnote);
+				if (dstates[auxdiatonic] != auxaccid) {
+					token->setValue("auto", to_string(k),
+							"mordentLowerAccidental", to_string(auxaccid));
+					dstates[auxdiatonic] = -1000 + auxaccid;
+				}
+			} else if (subtok.find("w") != string::npos) {
+				// minor second upper mordent
+				int auxnote     = b40 - 5;
+				int auxdiatonic = Convert::base40ToDiatonic(auxnote);
+				int auxaccid    = Convert::base40ToAccidental(auxnote);
+				if (dstates[auxdiatonic] != auxaccid) {
+					token->setValue("auto", to_string(k),
+							"mordentLowerAccidental", to_string(auxaccid));
+					dstates[auxdiatonic] = -1000 + auxaccid;
+				}
 
-				} else if ((loc = subtok.find("$")) != string::npos) {
-
-					int turndiatonic = Convert::base40ToDiatonic(b40);
-					// int turnaccid = Convert::base40ToAccidental(b40);
-					// inverted turn
-					int lowerint = 0;
-					int upperint = 0;
-					if (loc < subtok.size()-1) {
-						if (subtok[loc+1] == 's') {
-							lowerint = -5;
-						} else if (subtok[loc+1] == 'S') {
-							lowerint = -6;
-						}
+			} else if ((loc = subtok.find("$")) != string::npos) {
+
+				int turndiatonic = Convert::base40ToDiatonic(b40);
+				// int turnaccid = Convert::base40ToAccidental(b40);
+				// inverted turn
+				int lowerint = 0;
+				int upperint = 0;
+				if (loc < subtok.size()-1) {
+					if (subtok[loc+1] == 's') {
+						lowerint = -5;
+					} else if (subtok[loc+1] == 'S') {
+						lowerint = -6;
 					}
-					if (loc < subtok.size()-2) {
-						if (subtok[loc+2] == 's') {
-							upperint = +5;
-						} else if (subtok[loc+2] == 'S') {
-							upperint = +6;
-						}
-					}
-					int lowerdiatonic = turndiatonic - 1;
-					// Maybe also need to check for forced accidental state...
-					int loweraccid = dstates[rindex][lowerdiatonic];
-					int lowerb40 = Convert::base7ToBase40(lowerdiatonic) + loweraccid;
-					int upperdiatonic = turndiatonic + 1;
-					// Maybe also need to check for forced accidental state...
-					int upperaccid = dstates[rindex][upperdiatonic];
-					int upperb40 = Convert::base7ToBase40(upperdiatonic) + upperaccid;
-					if (lowerint == 0) {
-						// need to calculate lower interval (but it will not appear
-						// below the inverted turn, just calculating for performance
-						// rendering.
-						lowerint = lowerb40 - b40;
-						lowerb40 = b40 + lowerint;
-					}
-					if (upperint == 0) {
-						// need to calculate upper interval (but it will not appear
-						// above the inverted turn, just calculating for performance
-						// rendering.
-						upperint = upperb40 - b40;
-						upperb40 = b40 + upperint;
-					}
-					int uacc = Convert::base40ToAccidental(b40 + upperint);
-					int bacc = Convert::base40ToAccidental(b40 + lowerint);
-					if (uacc != upperaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"turnUpperAccidental", to_string(uacc));
-						dstates[rindex][upperdiatonic] = -1000 + uacc;
-					}
-					if (bacc != loweraccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"turnLowerAccidental", to_string(bacc));
-						dstates[rindex][lowerdiatonic] = -1000 + bacc;
+				}
+				if (loc < subtok.size()-2) {
+					if (subtok[loc+2] == 's') {
+						upperint = +5;
+					} else if (subtok[loc+2] == 'S') {
+						upperint = +6;
 					}
+				}
+				int lowerdiatonic = turndiatonic - 1;
+				// Maybe also need to check for forced accidental state...
+				int loweraccid = dstates[lowerdiatonic];
+				int lowerb40 = Convert::base7ToBase40(lowerdiatonic) + loweraccid;
+				int upperdiatonic = turndiatonic + 1;
+				// Maybe also need to check for forced accidental state...
+				int upperaccid = dstates[upperdiatonic];
+				int upperb40 = Convert::base7ToBase40(upperdiatonic) + upperaccid;
+				if (lowerint == 0) {
+					// need to calculate lower interval (but it will not appear
+					// below the inverted turn, just calculating for performance
+					// rendering.
+					lowerint = lowerb40 - b40;
+					lowerb40 = b40 + lowerint;
+				}
+				if (upperint == 0) {
+					// need to calculate upper interval (but it will not appear
+					// above the inverted turn, just calculating for performance
+					// rendering.
+					upperint = upperb40 - b40;
+					upperb40 = b40 + upperint;
+				}
+				int uacc = Convert::base40ToAccidental(b40 + upperint);
+				int bacc = Convert::base40ToAccidental(b40 + lowerint);
+				if (uacc != upperaccid) {
+					token->setValue("auto", to_string(k),
+							"turnUpperAccidental", to_string(uacc));
+					dstates[upperdiatonic] = -1000 + uacc;
+				}
+				if (bacc != loweraccid) {
+					token->setValue("auto", to_string(k),
+							"turnLowerAccidental", to_string(bacc));
+					dstates[lowerdiatonic] = -1000 + bacc;
+				}
 
-				} else if ((loc = subtok.find("S")) != string::npos) {
-
-					int turndiatonic = Convert::base40ToDiatonic(b40);
-					// int turnaccid = Convert::base40ToAccidental(b40);
-					// regular turn
-					int lowerint = 0;
-					int upperint = 0;
-					if (loc < subtok.size()-1) {
-						if (subtok[loc+1] == 's') {
-							upperint = +5;
-						} else if (subtok[loc+1] == 'S') {
-							upperint = +6;
-						}
-					}
-					if (loc < subtok.size()-2) {
-						if (subtok[loc+2] == 's') {
-							lowerint = -5;
-						} else if (subtok[loc+2] == 'S') {
-							lowerint = -6;
-						}
+			} else if ((loc = subtok.find("S")) != string::npos) {
+
+				int turndiatonic = Convert::base40ToDiatonic(b40);
+				// int turnaccid = Convert::base40ToAccidental(b40);
+				// regular turn
+				int lowerint = 0;
+				int upperint = 0;
+				if (loc < subtok.size()-1) {
+					if (subtok[loc+1] == 's') {
+						upperint = +5;
+					} else if (subtok[loc+1] == 'S') {
+						upperint = +6;
 					}
-					int lowerdiatonic = turndiatonic - 1;
-					// Maybe also need to check for forced accidental state...
-					int loweraccid = dstates[rindex][lowerdiatonic];
-					int lowerb40 = Convert::base7ToBase40(lowerdiatonic) + loweraccid;
-					int upperdiatonic = turndiatonic + 1;
-					// Maybe also need to check for forced accidental state...
-					int upperaccid = dstates[rindex][upperdiatonic];
-					int upperb40 = Convert::base7ToBase40(upperdiatonic) + upperaccid;
-					if (lowerint == 0) {
-						// need to calculate lower interval (but it will not appear
-						// below the inverted turn, just calculating for performance
-						// rendering.
-						lowerint = lowerb40 - b40;
-						lowerb40 = b40 + lowerint;
-					}
-					if (upperint == 0) {
-						// need to calculate upper interval (but it will not appear
-						// above the inverted turn, just calculating for performance
-						// rendering.
-						upperint = upperb40 - b40;
-						upperb40 = b40 + upperint;
+				}
+				if (loc < subtok.size()-2) {
+					if (subtok[loc+2] == 's') {
+						lowerint = -5;
+					} else if (subtok[loc+2] == 'S') {
+						lowerint = -6;
 					}
-					int uacc = Convert::base40ToAccidental(b40 + upperint);
-					int bacc = Convert::base40ToAccidental(b40 + lowerint);
-					if (uacc != upperaccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"turnUpperAccidental", to_string(uacc));
-						dstates[rindex][upperdiatonic] = -1000 + uacc;
+				}
+				int lowerdiatonic = turndiatonic - 1;
+				// Maybe also need to check for forced accidental state...
+				int loweraccid = dstates[lowerdiatonic];
+				int lowerb40 = Convert::base7ToBase40(lowerdiatonic) + loweraccid;
+				int upperdiatonic = turndiatonic + 1;
+				// Maybe also need to check for forced accidental state...
+				int upperaccid = dstates[upperdiatonic];
+				int upperb40 = Convert::base7ToBase40(upperdiatonic) + upperaccid;
+				if (lowerint == 0) {
+					// need to calculate lower interval (but it will not appear
+					// below the inverted turn, just calculating for performance
+					// rendering.
+					lowerint = lowerb40 - b40;
+					lowerb40 = b40 + lowerint;
+				}
+				if (upperint == 0) {
+					// need to calculate upper interval (but it will not appear
+					// above the inverted turn, just calculating for performance
+					// rendering.
+					upperint = upperb40 - b40;
+					upperb40 = b40 + upperint;
+				}
+				int uacc = Convert::base40ToAccidental(b40 + upperint);
+				int bacc = Convert::base40ToAccidental(b40 + lowerint);
+				if (uacc != upperaccid) {
+					token->setValue("auto", to_string(k),
+							"turnUpperAccidental", to_string(uacc));
+					dstates[upperdiatonic] = -1000 + uacc;
+				}
+				if (bacc != loweraccid) {
+					token->setValue("auto", to_string(k),
+							"turnLowerAccidental", to_string(bacc));
+					dstates[lowerdiatonic] = -1000 + bacc;
+				}
+			}
+
+			if (graceQ && (accid != gdstates[diatonic])) {
+				// accidental is different from the previous state so should be
+				// printed
+				if (!hiddenQ) {
+					token->setValue("auto", to_string(k),
+							"visualAccidental", "true");
+					if (gdstates[diatonic] < -900) {
+						// this is an obligatory cautionary accidental
+						// or at least half the time it is (figure that out later)
+						token->setValue("auto", to_string(k),
+								"obligatoryAccidental", "true");
+						token->setValue("auto", to_string(k),
+								"cautionaryAccidental", "true");
 					}
-					if (bacc != loweraccid) {
-						infile[i].token(j)->setValue("auto", to_string(k),
-								"turnLowerAccidental", to_string(bacc));
-						dstates[rindex][lowerdiatonic] = -1000 + bacc;
+				}
+				gdstates[diatonic] = accid;
+				// regular notes are not affected by grace notes accidental
+				// changes, but should have an obligatory cautionary accidental,
+				// displayed for clarification.
+				dstates[diatonic] = -1000 + accid;
+
+			} else if (!graceQ && ((concurrentstate[diatonic] && (concurrentstate[diatonic] == accid))
+					|| (accid != dstates[diatonic]))) {
+				// accidental is different from the previous state so should be
+				// printed, but only print if not supposed to be hidden.
+				if (!hiddenQ) {
+					token->setValue("auto", to_string(k),
+							"visualAccidental", "true");
+					concurrentstate[diatonic] = accid;
+					if (dstates[diatonic] < -900) {
+						// this is an obligatory cautionary accidental
+						// or at least half the time it is (figure that out later)
+						token->setValue("auto", to_string(k),
+								"obligatoryAccidental", "true");
+						token->setValue("auto", to_string(k),
+								"cautionaryAccidental", "true");
 					}
 				}
-
-				if (graceQ && (accid != gdstates[rindex][diatonic])) {
-					// accidental is different from the previous state so should be
-					// printed
-					if (!hiddenQ) {
-						infile[i].token(j)->setValue("auto", to_string(k),
+				dstates[diatonic] = accid;
+				gdstates[diatonic] = accid;
+
+			} else if ((accid == 0) && (subtok.find("n") != string::npos) &&
+						!hiddenQ) {
+				token->setValue("auto", to_string(k),
+						"cautionaryAccidental", "true");
+				token->setValue("auto", to_string(k),
+						"visualAccidental", "true");
+			} else if (subtok.find("XX") == string::npos) {
+				// The accidental is not necessary. See if there is a single "X"
+				// immediately after the accidental which means to force it to
+				// display.
+				auto loc = subtok.find("X");
+				if ((loc != string::npos) && (loc > 0)) {
+					if (subtok[loc-1] == '#') {
+						token->setValue("auto", to_string(k),
+								"cautionaryAccidental", "true");
+						token->setValue("auto", to_string(k),
 								"visualAccidental", "true");
-						if (gdstates[rindex][diatonic] < -900) {
-							// this is an obligatory cautionary accidental
-							// or at least half the time it is (figure that out later)
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"obligatoryAccidental", "true");
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"cautionaryAccidental", "true");
-						}
-					}
-					gdstates[rindex][diatonic] = accid;
-					// regular notes are not affected by grace notes accidental
-					// changes, but should have an obligatory cautionary accidental,
-					// displayed for clarification.
-					dstates[rindex][diatonic] = -1000 + accid;
-
-				} else if (!graceQ && ((concurrentstate[diatonic] && (concurrentstate[diatonic] == accid))
-						|| (accid != dstates[rindex][diatonic]))) {
-					// accidental is different from the previous state so should be
-					// printed, but only print if not supposed to be hidden.
-					if (!hiddenQ) {
-						infile[i].token(j)->setValue("auto", to_string(k),
+					} else if (subtok[loc-1] == '-') {
+						token->setValue("auto", to_string(k),
+								"cautionaryAccidental", "true");
+						token->setValue("auto", to_string(k),
+								"visualAccidental", "true");
+					} else if (subtok[loc-1] == 'n') {
+						token->setValue("auto", to_string(k),
+								"cautionaryAccidental", "true");
+						token->setValue("auto", to_string(k),
 								"visualAccidental", "true");
-						concurrentstate[diatonic] = accid;
-						if (dstates[rindex][diatonic] < -900) {
-							// this is an obligatory cautionary accidental
-							// or at least half the time it is (figure that out later)
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"obligatoryAccidental", "true");
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"cautionaryAccidental", "true");
-						}
-					}
-					dstates[rindex][diatonic] = accid;
-					gdstates[rindex][diatonic] = accid;
-
-				} else if ((accid == 0) && (subtok.find("n") != string::npos) &&
-							!hiddenQ) {
-					infile[i].token(j)->setValue("auto", to_string(k),
-							"cautionaryAccidental", "true");
-					infile[i].token(j)->setValue("auto", to_string(k),
-							"visualAccidental", "true");
-				} else if (subtok.find("XX") == string::npos) {
-					// The accidental is not necessary. See if there is a single "X"
-					// immediately after the accidental which means to force it to
-					// display.
-					auto loc = subtok.find("X");
-					if ((loc != string::npos) && (loc > 0)) {
-						if (subtok[loc-1] == '#') {
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"cautionaryAccidental", "true");
-									infile[i].token(j)->setValue("auto", to_string(k),
-											"visualAccidental", "true");
-						} else if (subtok[loc-1] == '-') {
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"cautionaryAccidental", "true");
-									infile[i].token(j)->setValue("auto", to_string(k),
-											"visualAccidental", "true");
-						} else if (subtok[loc-1] == 'n') {
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"cautionaryAccidental", "true");
-							infile[i].token(j)->setValue("auto", to_string(k),
-									"visualAccidental", "true");
-						}
 					}
 				}
 			}
 		}
-		std::fill(firstinbar.begin(), firstinbar.end(), 0);
 	}
 
-	// Indicate that the accidental analysis has been done:
-	infile.setValue("auto", "accidentalAnalysis", "true");
-
 	return true;
 }
 
@@ -17914,9 +18727,11 @@ void HumdrumFileContent::analyzeOttavas(void) {
 
 void HumdrumFileContent::analyzeRestPositions(void) {
 	vector<HTp> kernstarts = getKernSpineStartList();
-	for (int i=0; i<(int)kernstarts.size(); i++) {
-		assignImplicitVerticalRestPositions(kernstarts[i]);
-	}
+	// Null tokens are resolved in the spine tasks, so do it beforehand.
+	resolveNullTokens();
+	runSpineTasks((int)kernstarts.size(), [&](int index) {
+		assignImplicitVerticalRestPositions(kernstarts[index]);
+	});
 
 	checkForExplicitVerticalRestPositions();
 }
@@ -18625,10 +19440,10 @@ int HumdrumFileContent::getRestPositionAboveNotes(HTp rest, vector<int>& vpos) {
 
 
 bool HumdrumFileContent::analyzeSlurs(void) {
-	if (m_slurs_analyzed) {
+	if (isAnalyzed(ANALYZE_SLURS)) {
 		return false;
 	}
-	m_slurs_analyzed = true;
+	m_analyzed |= ANALYZE_SLURS;
 	bool output = true;
 	output &= analyzeKernSlurs();
 	output &= analyzeMensSlurs();
@@ -18698,11 +19513,9 @@ bool HumdrumFileContent::analyzeMensSlurs(void) {
 
 	vector<HTp> mensspines;
 	getSpineStartList(mensspines, "**mens");
-	bool output = true;
 	string linkSignifier = m_signifiers.getKernLinkSignifier();
-	for (int i=0; i<(int)mensspines.size(); i++) {
-		output = output && analyzeKernSlurs(mensspines[i], slurstarts, slurends, labels, endings, linkSignifier);
-	}
+	bool output = analyzeSlurSpines(mensspines, slurstarts, slurends, labels,
+			endings, linkSignifier);
 	createLinkedSlurs(slurstarts, slurends);
 	return output;
 }
@@ -18769,17 +19582,55 @@ bool HumdrumFileContent::analyzeKernSlurs(void) {
 
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
-	bool output = true;
 	string linkSignifier = m_signifiers.getKernLinkSignifier();
-	for (int i=0; i<(int)kernspines.size(); i++) {
-		output = output && analyzeKernSlurs(kernspines[i], slurstarts, slurends, labels, endings, linkSignifier);
-	}
+	bool output = analyzeSlurSpines(kernspines, slurstarts, slurends, labels,
+			endings, linkSignifier);
 
 	createLinkedSlurs(slurstarts, slurends);
 	return output;
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeSlurSpines -- Link slurs within each spine
+//    (concurrently if there is more than one thread).  Linked slur starts
+//    and ends are returned in spine order, to be linked across spines
+//    afterwards with createLinkedSlurs().
+//
+
+bool HumdrumFileContent::analyzeSlurSpines(vector<HTp>& spinestarts,
+		vector<HTp>& linkstarts, vector<HTp>& linkends,
+		vector<pair<HTp, HTp>>& labels, vector<int>& endings,
+		const string& linksig) {
+	int count = (int)spinestarts.size();
+	if ((m_threads > 1) && (count > 1)) {
+		// Slur durations are read in the spine tasks, so the rhythm
+		// must be analyzed first.
+		analyze(ANALYZE_RHYTHM);
+	}
+	vector<vector<HTp>> spinelinkstarts(count);
+	vector<vector<HTp>> spinelinkends(count);
+	vector<char> status(count, 1);
+	runSpineTasks(count, [&](int index) {
+		status[index] = analyzeKernSlurs(spinestarts[index],
+				spinelinkstarts[index], spinelinkends[index], labels, endings,
+				linksig);
+	});
+
+	bool output = true;
+	for (int i=0; i<count; i++) {
+		output = output && status[i];
+		linkstarts.insert(linkstarts.end(), spinelinkstarts[i].begin(),
+				spinelinkstarts[i].end());
+		linkends.insert(linkends.end(), spinelinkends[i].begin(),
+				spinelinkends[i].end());
+	}
+	return output;
+}
+
+
 bool HumdrumFileContent::analyzeKernSlurs(HTp spinestart,
 		vector<HTp>& linkstarts, vector<HTp>& linkends, vector<pair<HTp, HTp>>& labels,
 		vector<int>& endings, const string& linksig) {
@@ -19031,8 +19882,8 @@ void HumdrumFileContent::linkSlurEndpoints(HTp slurstart, HTp slurend) {
 	HumNum duration = slurend->getDurationFromStart()
 			- slurstart->getDurationFromStart();
 	slurstart->setValue("auto", durtag, duration);
-	slurstart->setValue("auto", "slurEndCount", to_string(slurEndCount));
-	slurend->setValue("auto", "slurStartCount", to_string(slurStartCount));
+	slurstart->setValue("auto", "slurEndCount", slurEndCount);
+	slurend->setValue("auto", "slurStartCount", slurStartCount);
 }
 
 
@@ -19050,13 +19901,18 @@ bool HumdrumFileContent::analyzeKernStemLengths(void) {
 
 	vector<vector<int>> centerlines;
 	getBaselines(centerlines);
-	for (int i=0; i<scount; i++) {
-		HTp sstart = this->getStrandStart(i);
+	// Each strand only changes its own tokens, so they are independent tasks.
+	vector<char> status(scount, 1);
+	runSpineTasks(scount, [&](int index) {
+		HTp sstart = this->getStrandStart(index);
 		if (!sstart->isKern()) {
-			continue;
+			return;
 		}
-		HTp send = this->getStrandEnd(i);
-		output = output && analyzeKernStemLengths(sstart, send, centerlines);
+		HTp send = this->getStrandEnd(index);
+		status[index] = analyzeKernStemLengths(sstart, send, centerlines);
+	});
+	for (int i=0; i<scount; i++) {
+		output = output && status[i];
 	}
 	return output;
 }
@@ -19185,6 +20041,7 @@ void HumdrumFileContent::getBaselines(vector<vector<int>>& centerlines) {
 //
 
 bool HumdrumFileContent::analyzeKernTies(void) {
+	m_analyzed |= ANALYZE_TIES;
 	vector<pair<HTp, int>> linkedtiestarts;
 	vector<pair<HTp, int>> linkedtieends;
 
@@ -19350,13 +20207,13 @@ void HumdrumFileContent::linkTieEndpoints(HTp tiestart,
    tiestart->setValue("auto", endtag, tieend);
    tiestart->setValue("auto", "id", tiestart);
 	if (endnumber > 0) {
-		tiestart->setValue("auto", endnum, to_string(endnumber));
+		tiestart->setValue("auto", endnum, endnumber);
 	}
 
    tieend->setValue("auto", starttag, tiestart);
    tieend->setValue("auto", "id", tieend);
 	if (startnumber > 0) {
-		tieend->setValue("auto", startnum, to_string(startnumber));
+		tieend->setValue("auto", startnum, startnumber);
 	}
 
    HumNum duration = tieend->getDurationFromStart()
@@ -19496,6 +20353,63 @@ HumdrumFileContent::~HumdrumFileContent() {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::setThreadCount -- Set the number of threads used
+//    to analyze **kern spines concurrently in the slur, accidental, rest
+//    position and stem length analyses.  A value of 0 or less will use
+//    one thread for each core.  The default is 1 (no extra threads).
+//
+
+void HumdrumFileContent::setThreadCount(int count) {
+	if (count <= 0) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	m_threads = count > 0 ? count : 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getThreadCount -- Return the number of threads
+//    used to analyze spines concurrently.
+//
+
+int HumdrumFileContent::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyze -- Do any of the given ANALYZE_*
+//    analyses that have not already been done (see
+//    HumdrumFileBase::analyze()).
+//
+
+bool HumdrumFileContent::analyze(int levels) {
+	if (levels & (ANALYZE_SLURS | ANALYZE_TIES | ANALYZE_ACCIDENTALS)) {
+		levels |= ANALYZE_RHYTHM;
+	}
+	if (!HumdrumFileStructure::analyze(levels)) {
+		return isValid();
+	}
+	if ((levels & ANALYZE_SLURS) && !isAnalyzed(ANALYZE_SLURS)) {
+		analyzeSlurs();
+	}
+	if ((levels & ANALYZE_TIES) && !isAnalyzed(ANALYZE_TIES)) {
+		analyzeKernTies();
+	}
+	if ((levels & ANALYZE_ACCIDENTALS) && !isAnalyzed(ANALYZE_ACCIDENTALS)) {
+		analyzeKernAccidentals();
+	}
+	return isValid();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileContent::analyzeRScale --
@@ -19953,6 +20867,357 @@ vector<HumdrumLine*> HumdrumFileSet::getUniversalReferenceRecords(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::buildSegmentIndex -- Read through a file and store
+//    the location of each segment in it.  Returns the number of segments
+//    found.
+//
+
+int HumdrumFileStream::buildSegmentIndex(const string& filename) {
+	m_segments.clear();
+	m_segmentuniversals.clear();
+	m_segmentnames.clear();
+	m_indexfile = filename;
+
+	clear();
+	if (m_instream.is_open()) {
+		m_instream.close();
+	}
+	m_instream.clear();
+	m_urlbuffer.str("");
+	m_filelist.assign(1, filename);
+	m_curfile = -1;
+
+	HumdrumFile infile;
+	string contents;
+	while (true) {
+		SegmentEntry entry;
+		entry.offset = 0;
+		if (m_instream.is_open()) {
+			entry.offset = (long long)m_instream.tellg();
+		}
+		entry.pending = m_newfilebuffer;
+		entry.universals = -1;
+		if (!m_universals.empty()) {
+			if (m_segmentuniversals.empty() || (m_segmentuniversals.back() != m_universals)) {
+				m_segmentuniversals.push_back(m_universals);
+			}
+			entry.universals = (int)m_segmentuniversals.size() - 1;
+		}
+		if (!getFileText(infile, contents)) {
+			break;
+		}
+		if (m_curfile != 0) {
+			// Filenames listed in the data are not part of the index.
+			break;
+		}
+		entry.name = infile.getFilename();
+		entry.level = infile.getSegmentLevel();
+		if (m_segmentnames.find(entry.name) == m_segmentnames.end()) {
+			m_segmentnames[entry.name] = (int)m_segments.size();
+		}
+		m_segments.push_back(entry);
+	}
+
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::writeSegmentIndex -- Save the segment index.
+//
+
+bool HumdrumFileStream::writeSegmentIndex(const string& filename) {
+	std::ofstream output(filename.c_str());
+	if (!output.is_open()) {
+		return false;
+	}
+	return writeSegmentIndex(output);
+}
+
+
+bool HumdrumFileStream::writeSegmentIndex(ostream& out) {
+	out << "!!!!humindex: " << escapeIndexText(m_indexfile) << "\n";
+	for (int i=0; i<(int)m_segmentuniversals.size(); i++) {
+		for (int j=0; j<(int)m_segmentuniversals[i].size(); j++) {
+			out << "U\t" << i << "\t" << escapeIndexText(m_segmentuniversals[i][j]) << "\n";
+		}
+	}
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		SegmentEntry& entry = m_segments[i];
+		out << "S\t" << entry.offset;
+		out << "\t" << entry.level;
+		out << "\t" << entry.universals;
+		out << "\t" << escapeIndexText(entry.pending);
+		out << "\t" << escapeIndexText(entry.name);
+		out << "\n";
+	}
+	out.flush();
+	return out.good();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegmentIndex -- Load a segment index saved with
+//    writeSegmentIndex().  Returns false if the input is not a segment
+//    index.
+//
+
+bool HumdrumFileStream::readSegmentIndex(const string& filename) {
+	ifstream input(filename.c_str());
+	if (!input.is_open()) {
+		return false;
+	}
+	return readSegmentIndex(input);
+}
+
+
+bool HumdrumFileStream::readSegmentIndex(istream& input) {
+	m_segments.clear();
+	m_segmentuniversals.clear();
+	m_segmentnames.clear();
+	m_indexfile.clear();
+	stopPrefetch();
+	if (m_instream.is_open()) {
+		m_instream.close();
+	}
+
+	string line;
+	if (!getline(input, line) || (line.compare(0, 14, "!!!!humindex: ") != 0)) {
+		return false;
+	}
+	m_indexfile = unescapeIndexText(line.substr(14));
+
+	vector<string> fields;
+	while (getline(input, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		fields.clear();
+		size_t start = 0;
+		while (true) {
+			size_t tab = line.find('\t', start);
+			if (tab == string::npos) {
+				fields.push_back(line.substr(start));
+				break;
+			}
+			fields.push_back(line.substr(start, tab - start));
+			start = tab + 1;
+		}
+		if ((fields[0] == "U") && (fields.size() == 3)) {
+			int group = std::stoi(fields[1]);
+			if ((group < 0) || (group > (int)m_segmentuniversals.size())) {
+				return false;
+			}
+			if (group == (int)m_segmentuniversals.size()) {
+				m_segmentuniversals.resize(group + 1);
+			}
+			m_segmentuniversals[group].push_back(unescapeIndexText(fields[2]));
+		} else if ((fields[0] == "S") && (fields.size() == 6)) {
+			SegmentEntry entry;
+			entry.offset = std::stoll(fields[1]);
+			entry.level = std::stoi(fields[2]);
+			entry.universals = std::stoi(fields[3]);
+			if (entry.universals >= (int)m_segmentuniversals.size()) {
+				return false;
+			}
+			entry.pending = unescapeIndexText(fields[4]);
+			entry.name = unescapeIndexText(fields[5]);
+			if (m_segmentnames.find(entry.name) == m_segmentnames.end()) {
+				m_segmentnames[entry.name] = (int)m_segments.size();
+			}
+			m_segments.push_back(entry);
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentCount -- Number of segments in the index.
+//
+
+int HumdrumFileStream::getSegmentCount(void) const {
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentNumber -- Return the index of the first
+//    segment with the given name, or -1 if there is no such segment.
+//
+
+int HumdrumFileStream::getSegmentNumber(const string& name) const {
+	auto it = m_segmentnames.find(name);
+	if (it == m_segmentnames.end()) {
+		return -1;
+	}
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentName -- Return the filename of a segment
+//    in the index.
+//
+
+string HumdrumFileStream::getSegmentName(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return "";
+	}
+	return m_segments[index].name;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentLevel -- Return the !!!!SEGMENT level of
+//    a segment in the index.
+//
+
+int HumdrumFileStream::getSegmentLevel(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return 0;
+	}
+	return m_segments[index].level;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegmentOffset -- Return the byte offset in the
+//    file at which reading of the segment starts, or -1 if the index is
+//    out of range.
+//
+
+long long HumdrumFileStream::getSegmentOffset(int index) const {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return -1;
+	}
+	return m_segments[index].offset;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegment -- Read a segment given by number or
+//    name from the indexed file, without reading the segments before it.
+//    The result is the same as reading the segment in sequence with
+//    getFile().  Afterwards, getFile() continues with the next segment
+//    in the file.
+//
+
+bool HumdrumFileStream::readSegment(HumdrumFile& infile, const string& name) {
+	return readSegment(infile, getSegmentNumber(name));
+}
+
+
+bool HumdrumFileStream::readSegment(HumdrumFile& infile, int index) {
+	if ((index < 0) || (index >= (int)m_segments.size())) {
+		return false;
+	}
+	SegmentEntry& entry = m_segments[index];
+	stopPrefetch();
+
+	if (!m_instream.is_open()) {
+		m_instream.open(m_indexfile.c_str());
+		if (!m_instream.is_open()) {
+			return false;
+		}
+	}
+	m_instream.clear();
+	m_instream.seekg(entry.offset);
+	if (!m_instream.good()) {
+		return false;
+	}
+	m_stringbuffer.str("");
+	m_urlbuffer.str("");
+	m_filelist.assign(1, m_indexfile);
+	m_curfile = 0;
+	m_newfilebuffer = entry.pending;
+	if (entry.universals >= 0) {
+		m_universals = m_segmentuniversals[entry.universals];
+	} else {
+		m_universals.clear();
+	}
+
+	string contents;
+	if (!getFileText(infile, contents)) {
+		return false;
+	}
+	parseFileText(infile, contents);
+	infile.setFilename(entry.name);
+	infile.setSegmentLevel(entry.level);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::escapeIndexText -- Escape backslashes, tabs and
+//    newlines for storage in a segment index.
+//
+
+string HumdrumFileStream::escapeIndexText(const string& text) {
+	string output;
+	output.reserve(text.size());
+	for (int i=0; i<(int)text.size(); i++) {
+		switch (text[i]) {
+			case '\\': output += "\\\\"; break;
+			case '\t': output += "\\t";  break;
+			case '\n': output += "\\n";  break;
+			default:   output += text[i];
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::unescapeIndexText -- Undo escapeIndexText().
+//
+
+string HumdrumFileStream::unescapeIndexText(const string& text) {
+	string output;
+	output.reserve(text.size());
+	for (int i=0; i<(int)text.size(); i++) {
+		if ((text[i] != '\\') || (i == (int)text.size() - 1)) {
+			output += text[i];
+			continue;
+		}
+		i++;
+		switch (text[i]) {
+			case 't': output += '\t'; break;
+			case 'n': output += '\n'; break;
+			default:  output += text[i];
+		}
+	}
+	return output;
+}
+
+
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::HumdrumFileStream --
@@ -19986,12 +21251,25 @@ HumdrumFileStream::HumdrumFileStream(const string& datastring) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::~HumdrumFileStream -- Stop the prefetch thread
+//    if it is running.
+//
+
+HumdrumFileStream::~HumdrumFileStream() {
+	stopPrefetch();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::clear -- reset the contents of the class.
 //
 
 void HumdrumFileStream::clear(void) {
+	stopPrefetch();
 	m_curfile = 0;
 	m_filelist.resize(0);
 	m_universals.resize(0);
@@ -20008,6 +21286,7 @@ void HumdrumFileStream::clear(void) {
 //
 
 int HumdrumFileStream::setFileList(char** list) {
+	stopPrefetch();
 	m_filelist.reserve(1000);
 	m_filelist.resize(0);
 	int i = 0;
@@ -20020,18 +21299,33 @@ int HumdrumFileStream::setFileList(char** list) {
 
 
 int HumdrumFileStream::setFileList(const vector<string>& list) {
+	stopPrefetch();
 	m_filelist = list;
 	return (int)list.size();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::getFileList -- Return the list of input files (which
+//    is empty when reading from standard input or a string).  Filenames
+//    found in the input data are added to the list as they are read.
+//
+
+const vector<string>& HumdrumFileStream::getFileList(void) const {
+	return m_filelist;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::loadString --
 //
 
 void HumdrumFileStream::loadString(const string& data) {
+	stopPrefetch();
 	m_curfile = -1;
 	m_stringbuffer << data;
 }
@@ -20050,12 +21344,15 @@ int HumdrumFileStream::read(HumdrumFile& infile) {
 
 int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 	infiles.clear();
-	HumdrumFile* infile = new HumdrumFile;
-	while (getFile(*infile)) {
+	string contents;
+	bool parsed;
+	HumdrumFile* infile;
+	while ((infile = takeSegment(contents, parsed)) != NULL) {
+		if (!parsed) {
+			parseFileText(*infile, contents);
+		}
 		infiles.appendHumdrumPointer(infile);
-		infile = new HumdrumFile;
 	}
-	delete infile;
 	return 0;
 }
 
@@ -20068,14 +21365,298 @@ int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 
 int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 	infiles.clear();
-	HumdrumFile* infile = new HumdrumFile;
-	int status = getFile(*infile);
-	if (!status) {
-		delete infile;
-	} else {
+	string contents;
+	bool parsed;
+	HumdrumFile* infile = takeSegment(contents, parsed);
+	if (!infile) {
+		return 0;
+	}
+	if (!parsed) {
+		parseFileText(*infile, contents);
+	}
+	infiles.appendHumdrumPointer(infile);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::readSegments -- Read up to count segments into a
+//    set.  The text of the segments is split out of the input serially,
+//    and then the segments are parsed concurrently if the thread count
+//    is greater than one.  Returns the number of segments read.
+//
+
+int HumdrumFileStream::readSegments(HumdrumFileSet& infiles, int count) {
+	infiles.clear();
+	if ((m_prefetchcount > 0) && !m_prefetchthread.joinable()) {
+		// Leave the parsing to the worker threads below if there are any.
+		startPrefetch(m_threads <= 1);
+	}
+	vector<string> contents;
+	vector<int> unparsed;
+	for (int i=0; i<count; i++) {
+		bool parsed;
+		contents.resize(contents.size() + 1);
+		HumdrumFile* infile = takeSegment(contents.back(), parsed);
+		if (!infile) {
+			contents.pop_back();
+			break;
+		}
+		if (!parsed) {
+			unparsed.push_back(i);
+		}
 		infiles.appendHumdrumPointer(infile);
 	}
-	return status;
+
+	int size = (int)contents.size();
+	int todo = (int)unparsed.size();
+	int threads = m_threads < todo ? m_threads : todo;
+	if (threads <= 1) {
+		for (int i=0; i<todo; i++) {
+			parseFileText(infiles[unparsed[i]], contents[unparsed[i]]);
+		}
+		return size;
+	}
+
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < todo) {
+			parseFileText(infiles[unparsed[index]], contents[unparsed[index]]);
+		}
+	};
+	vector<std::thread> workers;
+	for (int i=0; i<threads - 1; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+	return size;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::setThreadCount -- Set the number of threads used
+//    to parse segments in readSegments().  A value of 0 or less will
+//    use one thread for each core.
+//
+
+void HumdrumFileStream::setThreadCount(int count) {
+	if (count <= 0) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	m_threads = count > 0 ? count : 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getThreadCount -- Return the number of threads
+//    used to parse segments in readSegments().
+//
+
+int HumdrumFileStream::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::setPrefetch -- Read up to count segments ahead
+//    of the caller in a separate thread, so that reading and parsing the
+//    input overlaps with the processing of the current segment.  The
+//    segments waiting in the queue will not use more than maxbytes in
+//    total (0 for no limit), counting the lines and tokens of parsed
+//    segments, or the text of segments which are not parsed.  A single
+//    segment which is larger than maxbytes is still passed through when
+//    the queue is empty.  A count of 0 turns off prefetching.  Segments
+//    are parsed by the prefetch thread when they are read with
+//    readSingleSegment(), read() into a HumdrumFileSet, or readSegments();
+//    for getFile() only the input is read ahead and the caller parses the
+//    segment.
+//
+
+void HumdrumFileStream::setPrefetch(int count, size_t maxbytes) {
+	stopPrefetch();
+	m_prefetchcount = count > 0 ? count : 0;
+	m_prefetchbytes = maxbytes;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getPrefetchCount -- Return the maximum number of
+//    segments which are read ahead of the caller.
+//
+
+int HumdrumFileStream::getPrefetchCount(void) const {
+	return m_prefetchcount;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::startPrefetch -- Start the prefetch thread.
+//
+
+void HumdrumFileStream::startPrefetch(bool parse) {
+	m_prefetchparse = parse;
+	m_prefetchdone = false;
+	m_prefetchstop = false;
+	m_prefetchsize = 0;
+	m_prefetchthread = std::thread(&HumdrumFileStream::prefetchSegments, this);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::stopPrefetch -- Stop the prefetch thread and throw
+//    away any segments which it has read but which have not been taken.
+//
+
+void HumdrumFileStream::stopPrefetch(void) {
+	if (!m_prefetchthread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_prefetchlock);
+		m_prefetchstop = true;
+	}
+	m_prefetchroom.notify_all();
+	m_prefetchthread.join();
+	for (int i=0; i<(int)m_prefetchqueue.size(); i++) {
+		delete m_prefetchqueue[i].infile;
+	}
+	m_prefetchqueue.clear();
+	m_prefetchsize = 0;
+	m_prefetchdone = false;
+	m_prefetchstop = false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::prefetchSegments -- Main loop of the prefetch thread.
+//    Segments are read from the input (and parsed if requested) and then
+//    placed in the queue, waiting until the queue has room for them, so
+//    that at most one segment is in use outside of the queue limits.
+//
+
+void HumdrumFileStream::prefetchSegments(void) {
+	while (true) {
+		PrefetchEntry entry;
+		entry.infile = new HumdrumFile;
+		entry.parsed = false;
+		if (!getFileText(*entry.infile, entry.contents)) {
+			delete entry.infile;
+			std::lock_guard<std::mutex> lock(m_prefetchlock);
+			m_prefetchdone = true;
+			m_prefetchready.notify_all();
+			return;
+		}
+
+		if (m_prefetchparse) {
+			parseFileText(*entry.infile, entry.contents);
+			entry.contents.clear();
+			entry.contents.shrink_to_fit();
+			entry.parsed = true;
+			entry.size = getParsedSize(*entry.infile);
+		} else {
+			entry.size = entry.contents.size();
+		}
+
+		std::unique_lock<std::mutex> lock(m_prefetchlock);
+		m_prefetchroom.wait(lock, [&]() {
+			return m_prefetchstop || m_prefetchqueue.empty() ||
+					(((int)m_prefetchqueue.size() < m_prefetchcount) &&
+					((m_prefetchbytes == 0) ||
+					(m_prefetchsize + entry.size <= m_prefetchbytes)));
+		});
+		if (m_prefetchstop) {
+			delete entry.infile;
+			return;
+		}
+		m_prefetchsize += entry.size;
+		m_prefetchqueue.push_back(std::move(entry));
+		m_prefetchready.notify_all();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getParsedSize -- Return an estimate of the memory
+//    used by a parsed segment: its line and token objects and their text.
+//
+
+size_t HumdrumFileStream::getParsedSize(HumdrumFile& infile) {
+	size_t output = sizeof(HumdrumFile);
+	for (int i=0; i<infile.getLineCount(); i++) {
+		HumdrumLine& line = infile[i];
+		output += sizeof(HumdrumLine) + line.capacity();
+		for (int j=0; j<line.getTokenCount(); j++) {
+			output += sizeof(HumdrumToken) + line.token(j)->capacity();
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::takeSegment -- Return the next segment from the
+//    input, either from the prefetch queue or by reading it directly.
+//    The segment is parsed if parsed is set to true; otherwise contents
+//    holds its text, and the returned HumdrumFile only has the filename
+//    and segment level.  Returns NULL if there are no more segments.
+//    The caller owns the returned HumdrumFile.
+//
+
+HumdrumFile* HumdrumFileStream::takeSegment(string& contents, bool& parsed) {
+	parsed = false;
+	contents.clear();
+	if (m_prefetchcount <= 0) {
+		HumdrumFile* infile = new HumdrumFile;
+		if (!getFileText(*infile, contents)) {
+			delete infile;
+			return NULL;
+		}
+		return infile;
+	}
+
+	if (!m_prefetchthread.joinable()) {
+		startPrefetch(true);
+	}
+	std::unique_lock<std::mutex> lock(m_prefetchlock);
+	m_prefetchready.wait(lock, [&]() {
+		return m_prefetchdone || !m_prefetchqueue.empty();
+	});
+	if (m_prefetchqueue.empty()) {
+		return NULL;
+	}
+	PrefetchEntry entry = std::move(m_prefetchqueue.front());
+	m_prefetchqueue.pop_front();
+	m_prefetchsize -= entry.size;
+	lock.unlock();
+	m_prefetchroom.notify_all();
+
+	parsed = entry.parsed;
+	contents = std::move(entry.contents);
+	return entry.infile;
 }
 
 
@@ -20087,6 +21668,14 @@ int HumdrumFileStream::readSingleSegment(HumdrumFileSet& infiles) {
 //
 
 int HumdrumFileStream::eof(void) {
+	if (m_prefetchthread.joinable()) {
+		std::unique_lock<std::mutex> lock(m_prefetchlock);
+		m_prefetchready.wait(lock, [&]() {
+			return m_prefetchdone || !m_prefetchqueue.empty();
+		});
+		return m_prefetchqueue.empty();
+	}
+
 	istream* newinput = NULL;
 
 	// Read HumdrumFile contents from:
@@ -20134,6 +21723,68 @@ int HumdrumFileStream::eof(void) {
 //
 
 int HumdrumFileStream::getFile(HumdrumFile& infile) {
+	string contents;
+	if (m_prefetchcount <= 0) {
+		if (!getFileText(infile, contents)) {
+			return 0;
+		}
+		parseFileText(infile, contents);
+		return 1;
+	}
+
+	if (!m_prefetchthread.joinable()) {
+		startPrefetch(false);
+	}
+	bool parsed;
+	HumdrumFile* segment = takeSegment(contents, parsed);
+	if (!segment) {
+		return 0;
+	}
+	if (parsed) {
+		stringstream text;
+		text << *segment;
+		contents = text.str();
+	}
+	infile.clear();
+	infile.setFilename(segment->getFilename());
+	infile.setSegmentLevel(segment->getSegmentLevel());
+	delete segment;
+	parseFileText(infile, contents);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::parseFileText -- Parse the text of a segment
+//    extracted with getFileText(), keeping the filename and segment
+//    level which were found for the segment.
+//
+
+void HumdrumFileStream::parseFileText(HumdrumFile& infile,
+		const string& contents) {
+	string filename = infile.getFilename();
+	int level = infile.getSegmentLevel();
+	infile.readStringNoRhythm(contents);
+	if (!filename.empty()) {
+		infile.setFilename(filename);
+	}
+	infile.setSegmentLevel(level);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getFileText -- Extract the text of the next segment
+//    from the input stream or next input file in the list.  The filename
+//    and segment level for the segment are stored in infile, but the
+//    contents are not parsed.  Returns false if there are no more
+//    segments in the input stream.
+//
+
+int HumdrumFileStream::getFileText(HumdrumFile& infile, string& contents) {
 	infile.clear();
 	istream* newinput = NULL;
 
@@ -20271,6 +21922,15 @@ restarting:
 		starstarFoundQ = 1;
 	}
 
+	// If the previous read stopped at a !!!!SEGMENT record, then keep
+	// the record at the start of this segment (its name was stored in
+	// infile above) so that the segment labels are printed with the
+	// segments, and following programs can split the output again.
+	if (strncmp(m_newfilebuffer.c_str(), "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
+		buffer << m_newfilebuffer << "\n";
+		m_newfilebuffer = "";
+	}
+
 	while (!input.eof()) {
 		input.getline(templine, 123123, '\n');
 		if ((!dataFoundQ) &&
@@ -20320,6 +21980,7 @@ restarting:
 				// current file stream, not this one, so stop reading the
 				// HumdrumFile content and send what has already been read back
 				// out with new contents.
+				break;
 			}  else {
 				// !!!!SEGMENT: came before any real data was read, so
 				// it is most likely the name of the current file
@@ -20407,23 +22068,16 @@ restarting:
 	// Universal comments (demoted into Global comments) at the start
 	// of the data stream (maybe allow for postpending Universal comments
 	// in the future).
-	stringstream contents;
-	contents.str(""); // empty any contents in buffer
-	contents.clear(); // reset error flags in buffer
-
+	contents.clear();
 	for (int i=0; i<(int)m_universals.size(); i++) {
 		// Convert universals reference records to globals, but do not demote !!!!filter:
 		if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
 			continue;
 		}
-		contents << &(m_universals[i][1]) << "\n";
-	}
-	contents << buffer.str();
-	string filename = infile.getFilename();
-	infile.readNoRhythm(contents);
-	if (!filename.empty()) {
-		infile.setFilename(filename);
+		contents += &(m_universals[i][1]);
+		contents += "\n";
 	}
+	contents += buffer.str();
 	return 1;
 }
 
@@ -20447,6 +22101,769 @@ void HumdrumFileStream::fillUrlBuffer(stringstream& uribuffer,
 
 
 
+#define HUMB_VERSION   1
+#define HUMB_BYTEORDER 0x01020304
+
+// Values for HumbHeader::flags:
+#define HUMB_NULLS     0x1
+#define HUMB_STRUCTURE 0x2
+
+// Values for HumbLine::flags and HumbToken::flags:
+#define HUMB_RHYTHM    0x1
+
+struct HumbHeader {
+	char magic[4];      // "HUMB"
+	int  version;       // HUMB_VERSION
+	int  byteorder;     // HUMB_BYTEORDER
+	int  linesize;      // sizeof(HumbLine)
+	int  tokensize;     // sizeof(HumbToken)
+	int  analyzed;      // ANALYZE_* analyses stored in the file
+	int  flags;         // HUMB_NULLS, HUMB_STRUCTURE
+	int  tpq;           // ticks per quarter note (or -1)
+	int  segmentlevel;
+	int  linecount;
+	int  tokencount;
+	int  linkcount;
+	int  infocount;
+	int  trackcount;
+	int  trackendcount;
+	int  strandcount;
+	int  strand2dcount;
+	int  strand2dtotal;
+	int  barlinecount;
+	int  textsize;
+	int  infosize;
+	int  filenamesize;
+};
+
+struct HumbString {
+	int offset;
+	int length;
+};
+
+struct HumbLine {
+	HumbString text;
+	int firsttoken;
+	int tokencount;
+	int duration[2];
+	int durationfromstart[2];
+	int durationfrombarline[2];
+	int durationtobarline[2];
+	int flags;
+};
+
+struct HumbToken {
+	HumbString text;
+	int tabs;
+	int info;
+	int track;
+	int subtrack;
+	int subtrackcount;
+	int duration[2];
+	int strand;
+	int nullresolve;
+	HumbString next;
+	HumbString previous;
+	HumbString nextnonnull;
+	HumbString previousnonnull;
+	int flags;
+};
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::writeBinary -- Write the file and its analysis in
+//    the binary .humb format, which can be loaded with readBinary().  Any
+//    pending edits are analyzed before writing.  Content analyses (such as
+//    slurs and ties) are not stored.  Returns false if the file could not
+//    be written.
+//
+
+bool HumdrumFileStructure::writeBinary(const string& filename) {
+	std::ofstream outfile(filename.c_str(), std::ios::out | std::ios::binary);
+	if (!outfile.is_open()) {
+		return false;
+	}
+	if (!writeBinary(outfile)) {
+		return false;
+	}
+	outfile.close();
+	return !outfile.fail();
+}
+
+
+bool HumdrumFileStructure::writeBinary(ostream& out) {
+	if (hasEdits()) {
+		reanalyzeEdits();
+	}
+
+	int linecount = (int)m_lines.size();
+	vector<int> lineoffsets(linecount);
+	int tokencount = 0;
+	for (int i=0; i<linecount; i++) {
+		lineoffsets[i] = tokencount;
+		tokencount += m_lines[i]->getTokenCount();
+	}
+
+	vector<HumbLine> lines(linecount);
+	vector<HumbToken> tokens(tokencount);
+	vector<int> links;
+	vector<HumbString> infos;
+	string text;
+	string infotext;
+	map<string, int> infoindex;
+	bool status = true;
+
+	for (int i=0; i<linecount; i++) {
+		HumdrumLine* line = m_lines[i];
+		HumbLine& hline = lines[i];
+		hline.text.offset = (int)text.size();
+		hline.text.length = (int)line->size();
+		text += *line;
+		hline.firsttoken = lineoffsets[i];
+		hline.tokencount = line->getTokenCount();
+		setBinaryNumber(hline.duration, line->m_duration);
+		setBinaryNumber(hline.durationfromstart, line->m_durationFromStart);
+		setBinaryNumber(hline.durationfrombarline, line->m_durationFromBarline);
+		setBinaryNumber(hline.durationtobarline, line->m_durationToBarline);
+		hline.flags = line->m_rhythm_analyzed ? HUMB_RHYTHM : 0;
+
+		// Tokens are stored as references to the line text when they match it.
+		int position = hline.text.offset;
+		int lineend = hline.text.offset + hline.text.length;
+		for (int j=0; j<hline.tokencount; j++) {
+			HTp token = line->token(j);
+			HumbToken& htoken = tokens[lineoffsets[i] + j];
+			int length = (int)token->size();
+			if ((position + length <= lineend) &&
+					(text.compare(position, length, *token) == 0)) {
+				htoken.text.offset = position;
+			} else {
+				htoken.text.offset = (int)text.size();
+				text += *token;
+			}
+			htoken.text.length = length;
+			htoken.tabs = (j < (int)line->m_tabs.size()) ? line->m_tabs[j] : 0;
+			position += length + htoken.tabs;
+
+			const string& info = token->getSpineInfo();
+			auto found = infoindex.find(info);
+			if (found == infoindex.end()) {
+				HumbString entry;
+				entry.offset = (int)infotext.size();
+				entry.length = (int)info.size();
+				infotext += info;
+				infoindex[info] = (int)infos.size();
+				htoken.info = (int)infos.size();
+				infos.push_back(entry);
+			} else {
+				htoken.info = found->second;
+			}
+
+			htoken.track = token->getTrack();
+			htoken.subtrack = token->getSubtrack();
+			htoken.subtrackcount = token->m_address.getSubtrackCount();
+			setBinaryNumber(htoken.duration, token->m_duration);
+			htoken.strand = token->m_strand;
+			htoken.nullresolve = -1;
+			if (m_nulls_analyzed && token->m_nullresolve) {
+				htoken.nullresolve = getBinaryTokenIndex(token->m_nullresolve, lineoffsets);
+				status &= htoken.nullresolve >= 0;
+			}
+			status &= storeBinaryLinks(htoken.next, token->m_nextTokens, links,
+					lineoffsets);
+			status &= storeBinaryLinks(htoken.previous, token->m_previousTokens,
+					links, lineoffsets);
+			status &= storeBinaryLinks(htoken.nextnonnull,
+					token->m_nextNonNullTokens, links, lineoffsets);
+			status &= storeBinaryLinks(htoken.previousnonnull,
+					token->m_previousNonNullTokens, links, lineoffsets);
+			htoken.flags = token->m_rhythm_analyzed ? HUMB_RHYTHM : 0;
+		}
+	}
+	if (!status) {
+		// A token is linked to a token which is not in the file.
+		return false;
+	}
+
+	vector<int> trackstarts(m_trackstarts.size());
+	vector<int> trackendcounts(m_trackstarts.size(), 0);
+	vector<int> trackends;
+	for (int i=0; i<(int)m_trackstarts.size(); i++) {
+		trackstarts[i] = m_trackstarts[i] ?
+				getBinaryTokenIndex(m_trackstarts[i], lineoffsets) : -1;
+		if (i >= (int)m_trackends.size()) {
+			continue;
+		}
+		trackendcounts[i] = (int)m_trackends[i].size();
+		for (int j=0; j<(int)m_trackends[i].size(); j++) {
+			trackends.push_back(getBinaryTokenIndex(m_trackends[i][j], lineoffsets));
+			if (trackends.back() < 0) {
+				return false;
+			}
+		}
+	}
+
+	vector<int> strands;
+	for (int i=0; i<(int)m_strand1d.size(); i++) {
+		strands.push_back(getBinaryTokenIndex(m_strand1d[i].first, lineoffsets));
+		strands.push_back(getBinaryTokenIndex(m_strand1d[i].last, lineoffsets));
+	}
+	vector<int> strand2dcounts(m_strand2d.size());
+	vector<int> strands2d;
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		strand2dcounts[i] = (int)m_strand2d[i].size();
+		for (int j=0; j<(int)m_strand2d[i].size(); j++) {
+			strands2d.push_back(getBinaryTokenIndex(m_strand2d[i][j].first, lineoffsets));
+			strands2d.push_back(getBinaryTokenIndex(m_strand2d[i][j].last, lineoffsets));
+		}
+	}
+
+	vector<int> barlines(m_barlines.size());
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		barlines[i] = m_barlines[i]->getLineIndex();
+	}
+
+	HumbHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "HUMB", 4);
+	header.version       = HUMB_VERSION;
+	header.byteorder     = HUMB_BYTEORDER;
+	header.linesize      = (int)sizeof(HumbLine);
+	header.tokensize     = (int)sizeof(HumbToken);
+	header.analyzed      = m_analyzed & ANALYZE_STRUCTURE;
+	header.flags         = (m_nulls_analyzed ? HUMB_NULLS : 0) |
+	                       (m_structure_analyzed ? HUMB_STRUCTURE : 0);
+	header.tpq           = m_ticksperquarternote;
+	header.segmentlevel  = m_segmentlevel;
+	header.linecount     = linecount;
+	header.tokencount    = tokencount;
+	header.linkcount     = (int)links.size();
+	header.infocount     = (int)infos.size();
+	header.trackcount    = (int)trackstarts.size();
+	header.trackendcount = (int)trackends.size();
+	header.strandcount   = (int)m_strand1d.size();
+	header.strand2dcount = (int)strand2dcounts.size();
+	header.strand2dtotal = (int)strands2d.size() / 2;
+	header.barlinecount  = (int)barlines.size();
+	header.textsize      = (int)text.size();
+	header.infosize      = (int)infotext.size();
+	header.filenamesize  = (int)m_filename.size();
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)lines.data(), lines.size() * sizeof(HumbLine));
+	out.write((const char*)tokens.data(), tokens.size() * sizeof(HumbToken));
+	out.write((const char*)links.data(), links.size() * sizeof(int));
+	out.write((const char*)infos.data(), infos.size() * sizeof(HumbString));
+	out.write((const char*)trackstarts.data(), trackstarts.size() * sizeof(int));
+	out.write((const char*)trackendcounts.data(), trackendcounts.size() * sizeof(int));
+	out.write((const char*)trackends.data(), trackends.size() * sizeof(int));
+	out.write((const char*)strands.data(), strands.size() * sizeof(int));
+	out.write((const char*)strand2dcounts.data(), strand2dcounts.size() * sizeof(int));
+	out.write((const char*)strands2d.data(), strands2d.size() * sizeof(int));
+	out.write((const char*)barlines.data(), barlines.size() * sizeof(int));
+	out.write(text.data(), text.size());
+	out.write(infotext.data(), infotext.size());
+	out.write(m_filename.data(), m_filename.size());
+	return !out.fail();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::setBinaryNumber -- Store a HumNum as a numerator
+//    and denominator pair.
+//
+
+void HumdrumFileStructure::setBinaryNumber(int* output, const HumNum& value) {
+	output[0] = value.getNumerator();
+	output[1] = value.getDenominator();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getBinaryTokenIndex -- Return the index of a token
+//    in the list of all tokens in the file (ordered by line and field),
+//    or -1 if the token does not belong to the file.
+//
+
+int HumdrumFileStructure::getBinaryTokenIndex(HTp token,
+		const vector<int>& lineoffsets) {
+	if (token == NULL) {
+		return -1;
+	}
+	HumdrumLine* line = token->getOwner();
+	if (line == NULL) {
+		return -1;
+	}
+	int lineindex = line->getLineIndex();
+	if ((lineindex < 0) || (lineindex >= (int)m_lines.size()) ||
+			(m_lines[lineindex] != line)) {
+		return -1;
+	}
+	int field = token->getFieldIndex();
+	if ((field < 0) || (field >= (int)line->m_tokens.size()) ||
+			(line->m_tokens[field] != token)) {
+		for (field=0; field<(int)line->m_tokens.size(); field++) {
+			if (line->m_tokens[field] == token) {
+				break;
+			}
+		}
+		if (field >= (int)line->m_tokens.size()) {
+			return -1;
+		}
+	}
+	return lineoffsets[lineindex] + field;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::storeBinaryLinks -- Add the indexes of a list of
+//    tokens to the link table.  Returns false if a token does not belong
+//    to the file.
+//
+
+bool HumdrumFileStructure::storeBinaryLinks(HumbString& output,
+		const vector<HTp>& tokens, vector<int>& links,
+		const vector<int>& lineoffsets) {
+	output.offset = (int)links.size();
+	output.length = (int)tokens.size();
+	bool status = true;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		int index = getBinaryTokenIndex(tokens[i], lineoffsets);
+		status &= index >= 0;
+		links.push_back(index);
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::readBinary -- Load a file which was written with
+//    writeBinary().  The file is mapped into memory when possible, and the
+//    lines and tokens are created directly from the stored text and
+//    analysis, without splitting lines into tokens or analyzing spines and
+//    rhythm again.  Layout parameters and signifiers are analyzed after
+//    loading (if they were analyzed when the file was written), and content
+//    analyses are done when they are first needed.  If the stored tables
+//    are invalid, a parse error is set and false is returned; the source
+//    file is not read again automatically.
+//
+
+bool HumdrumFileStructure::readBinary(const string& filename) {
+	return readBinary(filename.c_str());
+}
+
+
+bool HumdrumFileStructure::readBinary(const char* filename) {
+#ifdef USING_MMAP
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	struct stat info;
+	if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0)) {
+		size_t size = (size_t)info.st_size;
+		void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			return setParseError("Cannot map file >>%s<< for reading.", filename);
+		}
+		bool status = readBinaryBuffer((const char*)data, size);
+		munmap(data, size);
+		return status;
+	}
+	close(fd);
+#endif
+	ifstream infile(filename, std::ios::in | std::ios::binary);
+	if (!infile.is_open()) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	string contents((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
+	return readBinaryBuffer(contents.data(), contents.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::readBinaryBuffer -- Load a file in the .humb format
+//    from a block of memory (see readBinary()).
+//
+
+bool HumdrumFileStructure::readBinaryBuffer(const char* data, size_t size) {
+	clear();
+	m_displayError = true;
+
+	// Copy unaligned data so that the tables can be accessed directly.
+	vector<int> aligned;
+	if (((size_t)data) % alignof(int) != 0) {
+		aligned.resize(size / sizeof(int) + 1);
+		memcpy(aligned.data(), data, size);
+		data = (const char*)aligned.data();
+	}
+
+	if (!isBinaryBuffer(data, size)) {
+		return setParseError("Not a Humdrum binary (.humb) file.");
+	}
+	const HumbHeader& header = *(const HumbHeader*)data;
+	if ((header.version != HUMB_VERSION) ||
+			(header.linesize != (int)sizeof(HumbLine)) ||
+			(header.tokensize != (int)sizeof(HumbToken))) {
+		return setParseError("Unsupported version of Humdrum binary file.");
+	}
+	if (header.byteorder != HUMB_BYTEORDER) {
+		return setParseError("Humdrum binary file has a different byte order.");
+	}
+
+	// Locate the tables in the data, checking that they fit.
+	int counts[] = { header.linecount, header.tokencount, header.linkcount,
+			header.infocount, header.trackcount, header.trackendcount,
+			header.strandcount, header.strand2dcount, header.strand2dtotal,
+			header.barlinecount, header.textsize, header.infosize,
+			header.filenamesize };
+	for (int i=0; i<(int)(sizeof(counts) / sizeof(int)); i++) {
+		if (counts[i] < 0) {
+			return setParseError("Corrupted Humdrum binary file.");
+		}
+	}
+	size_t expected = sizeof(HumbHeader)
+			+ (size_t)header.linecount * sizeof(HumbLine)
+			+ (size_t)header.tokencount * sizeof(HumbToken)
+			+ (size_t)header.linkcount * sizeof(int)
+			+ (size_t)header.infocount * sizeof(HumbString)
+			+ (size_t)header.trackcount * 2 * sizeof(int)
+			+ (size_t)header.trackendcount * sizeof(int)
+			+ (size_t)header.strandcount * 2 * sizeof(int)
+			+ (size_t)header.strand2dcount * sizeof(int)
+			+ (size_t)header.strand2dtotal * 2 * sizeof(int)
+			+ (size_t)header.barlinecount * sizeof(int)
+			+ (size_t)header.textsize
+			+ (size_t)header.infosize
+			+ (size_t)header.filenamesize;
+	if (expected != size) {
+		return setParseError("Corrupted Humdrum binary file.");
+	}
+	const char* ptr = data + sizeof(HumbHeader);
+	const HumbLine* hlines = (const HumbLine*)ptr;
+	ptr += header.linecount * sizeof(HumbLine);
+	const HumbToken* htokens = (const HumbToken*)ptr;
+	ptr += header.tokencount * sizeof(HumbToken);
+	const int* links = (const int*)ptr;
+	ptr += header.linkcount * sizeof(int);
+	const HumbString* infos = (const HumbString*)ptr;
+	ptr += header.infocount * sizeof(HumbString);
+	const int* trackstarts = (const int*)ptr;
+	ptr += header.trackcount * sizeof(int);
+	const int* trackendcounts = (const int*)ptr;
+	ptr += header.trackcount * sizeof(int);
+	const int* trackends = (const int*)ptr;
+	ptr += header.trackendcount * sizeof(int);
+	const int* strands = (const int*)ptr;
+	ptr += header.strandcount * 2 * sizeof(int);
+	const int* strand2dcounts = (const int*)ptr;
+	ptr += header.strand2dcount * sizeof(int);
+	const int* strands2d = (const int*)ptr;
+	ptr += header.strand2dtotal * 2 * sizeof(int);
+	const int* barlines = (const int*)ptr;
+	ptr += header.barlinecount * sizeof(int);
+	const char* text = ptr;
+	ptr += header.textsize;
+	const char* infotext = ptr;
+	ptr += header.infosize;
+	const char* filename = ptr;
+
+	if (!checkBinaryTables(header, hlines, htokens, links, infos, trackstarts,
+			trackendcounts, trackends, strands, strand2dcounts, strands2d,
+			barlines)) {
+		// The cached analysis cannot be used.  The caller has to read the
+		// source file again (the stored filename is given in the message).
+		string source(filename, header.filenamesize);
+		if (source.empty()) {
+			return setParseError("Corrupted Humdrum binary file.");
+		}
+		return setParseError("Corrupted Humdrum binary file for >>" + source
+				+ "<<.");
+	}
+
+	// Create the lines and tokens:
+	vector<HTp> tokens(header.tokencount);
+	vector<string> infostrings(header.infocount);
+	for (int i=0; i<header.infocount; i++) {
+		infostrings[i].assign(infotext + infos[i].offset, infos[i].length);
+	}
+	m_lines.resize(header.linecount);
+	for (int i=0; i<header.linecount; i++) {
+		const HumbLine& hline = hlines[i];
+		HumdrumLine* line = new HumdrumLine;
+		m_lines[i] = line;
+		line->assign(text + hline.text.offset, hline.text.length);
+		line->setOwner(this);
+		line->setLineIndex(i);
+		line->m_duration.setValue(hline.duration[0], hline.duration[1]);
+		line->m_durationFromStart.setValue(hline.durationfromstart[0],
+				hline.durationfromstart[1]);
+		line->m_durationFromBarline.setValue(hline.durationfrombarline[0],
+				hline.durationfrombarline[1]);
+		line->m_durationToBarline.setValue(hline.durationtobarline[0],
+				hline.durationtobarline[1]);
+		line->m_rhythm_analyzed = (hline.flags & HUMB_RHYTHM) ? true : false;
+		line->m_tokens.resize(hline.tokencount);
+		line->m_tabs.resize(hline.tokencount);
+		for (int j=0; j<hline.tokencount; j++) {
+			const HumbToken& htoken = htokens[hline.firsttoken + j];
+			HTp token = new HumdrumToken;
+			tokens[hline.firsttoken + j] = token;
+			line->m_tokens[j] = token;
+			line->m_tabs[j] = htoken.tabs;
+			token->assign(text + htoken.text.offset, htoken.text.length);
+			token->setOwner(line);
+			token->setFieldIndex(j);
+			token->setSpineInfo(infostrings[htoken.info]);
+			token->setTrack(htoken.track, htoken.subtrack);
+			token->setSubtrackCount(htoken.subtrackcount);
+			token->m_duration.setValue(htoken.duration[0], htoken.duration[1]);
+			token->m_strand = htoken.strand;
+			token->m_rhythm_analyzed = (htoken.flags & HUMB_RHYTHM) ? true : false;
+		}
+	}
+
+	// Link the tokens together:
+	for (int i=0; i<header.tokencount; i++) {
+		const HumbToken& htoken = htokens[i];
+		HTp token = tokens[i];
+		if (htoken.nullresolve >= 0) {
+			token->m_nullresolve = tokens[htoken.nullresolve];
+		}
+		loadBinaryLinks(token->m_nextTokens, htoken.next, links, tokens);
+		loadBinaryLinks(token->m_previousTokens, htoken.previous, links, tokens);
+		loadBinaryLinks(token->m_nextNonNullTokens, htoken.nextnonnull, links, tokens);
+		loadBinaryLinks(token->m_previousNonNullTokens, htoken.previousnonnull,
+				links, tokens);
+	}
+
+	m_trackstarts.resize(header.trackcount);
+	m_trackends.resize(header.trackcount);
+	int index = 0;
+	for (int i=0; i<header.trackcount; i++) {
+		m_trackstarts[i] = trackstarts[i] >= 0 ? tokens[trackstarts[i]] : NULL;
+		m_trackends[i].resize(trackendcounts[i]);
+		for (int j=0; j<trackendcounts[i]; j++) {
+			m_trackends[i][j] = tokens[trackends[index++]];
+		}
+	}
+
+	m_strand1d.resize(header.strandcount);
+	for (int i=0; i<header.strandcount; i++) {
+		m_strand1d[i].first = strands[2*i] >= 0 ? tokens[strands[2*i]] : NULL;
+		m_strand1d[i].last = strands[2*i+1] >= 0 ? tokens[strands[2*i+1]] : NULL;
+	}
+	m_strand2d.resize(header.strand2dcount);
+	index = 0;
+	for (int i=0; i<header.strand2dcount; i++) {
+		m_strand2d[i].resize(strand2dcounts[i]);
+		for (int j=0; j<strand2dcounts[i]; j++) {
+			m_strand2d[i][j].first = strands2d[index] >= 0 ? tokens[strands2d[index]] : NULL;
+			m_strand2d[i][j].last = strands2d[index+1] >= 0 ? tokens[strands2d[index+1]] : NULL;
+			index += 2;
+		}
+	}
+
+	m_barlines.resize(header.barlinecount);
+	for (int i=0; i<header.barlinecount; i++) {
+		m_barlines[i] = m_lines[barlines[i]];
+	}
+
+	m_filename.assign(filename, header.filenamesize);
+	m_segmentlevel = header.segmentlevel;
+	m_ticksperquarternote = header.tpq;
+	m_nulls_analyzed = (header.flags & HUMB_NULLS) ? true : false;
+	m_structure_analyzed = (header.flags & HUMB_STRUCTURE) ? true : false;
+
+	// Parameters are stored in the tokens' hash tables, which are not saved.
+	int params = header.analyzed & (ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
+	m_analyzed = header.analyzed & ~params;
+	if (params) {
+		analyze(params);
+	}
+	if (m_analyzed & ANALYZE_RHYTHM) {
+		assignLineTicks();
+	}
+	analyzeSignifiers();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::isBinaryBuffer -- Returns true if the data starts
+//    with the header of a Humdrum binary (.humb) file.
+//
+
+bool HumdrumFileStructure::isBinaryBuffer(const char* data, size_t size) {
+	if (size < sizeof(HumbHeader)) {
+		return false;
+	}
+	return strncmp(data, "HUMB", 4) == 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::checkBinaryTables -- Returns true if all of the
+//    offsets and indexes in the tables of a .humb file are in range, so
+//    that a corrupted file cannot cause invalid memory accesses, and that
+//    all durations have positive denominators.
+//
+
+bool HumdrumFileStructure::checkBinaryTables(const HumbHeader& header,
+		const HumbLine* lines, const HumbToken* tokens, const int* links,
+		const HumbString* infos, const int* trackstarts,
+		const int* trackendcounts, const int* trackends, const int* strands,
+		const int* strand2dcounts, const int* strands2d, const int* barlines) {
+	int i;
+	int tokencount = header.tokencount;
+	auto validString = [](const HumbString& value, int size) {
+		return (value.offset >= 0) && (value.length >= 0) &&
+				(value.offset <= size - value.length);
+	};
+	auto validToken = [tokencount](int index, bool allownull) {
+		return (index < tokencount) && ((index >= 0) || (allownull && (index == -1)));
+	};
+	auto validNumber = [](const int* value) {
+		return value[1] > 0;
+	};
+
+	int expected = 0;
+	for (i=0; i<header.linecount; i++) {
+		if (!validString(lines[i].text, header.textsize)) {
+			return false;
+		}
+		if ((lines[i].firsttoken != expected) || (lines[i].tokencount < 0)) {
+			return false;
+		}
+		if (!validNumber(lines[i].duration) ||
+				!validNumber(lines[i].durationfromstart) ||
+				!validNumber(lines[i].durationfrombarline) ||
+				!validNumber(lines[i].durationtobarline)) {
+			return false;
+		}
+		expected += lines[i].tokencount;
+		if (expected > tokencount) {
+			return false;
+		}
+	}
+	if (expected != tokencount) {
+		return false;
+	}
+	for (i=0; i<tokencount; i++) {
+		const HumbToken& token = tokens[i];
+		if (!validString(token.text, header.textsize)) {
+			return false;
+		}
+		if ((token.info < 0) || (token.info >= header.infocount)) {
+			return false;
+		}
+		if (!validNumber(token.duration)) {
+			return false;
+		}
+		if (!validToken(token.nullresolve, true)) {
+			return false;
+		}
+		if (!validString(token.next, header.linkcount) ||
+				!validString(token.previous, header.linkcount) ||
+				!validString(token.nextnonnull, header.linkcount) ||
+				!validString(token.previousnonnull, header.linkcount)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.linkcount; i++) {
+		if (!validToken(links[i], false)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.infocount; i++) {
+		if (!validString(infos[i], header.infosize)) {
+			return false;
+		}
+	}
+	expected = 0;
+	for (i=0; i<header.trackcount; i++) {
+		if (!validToken(trackstarts[i], true) || (trackendcounts[i] < 0)) {
+			return false;
+		}
+		expected += trackendcounts[i];
+		if (expected > header.trackendcount) {
+			return false;
+		}
+	}
+	if (expected != header.trackendcount) {
+		return false;
+	}
+	for (i=0; i<header.trackendcount; i++) {
+		if (!validToken(trackends[i], false)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.strandcount * 2; i++) {
+		if (!validToken(strands[i], true)) {
+			return false;
+		}
+	}
+	expected = 0;
+	for (i=0; i<header.strand2dcount; i++) {
+		if (strand2dcounts[i] < 0) {
+			return false;
+		}
+		expected += strand2dcounts[i];
+		if (expected > header.strand2dtotal) {
+			return false;
+		}
+	}
+	if (expected != header.strand2dtotal) {
+		return false;
+	}
+	for (i=0; i<header.strand2dtotal * 2; i++) {
+		if (!validToken(strands2d[i], true)) {
+			return false;
+		}
+	}
+	for (i=0; i<header.barlinecount; i++) {
+		if ((barlines[i] < 0) || (barlines[i] >= header.linecount)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::loadBinaryLinks -- Convert a list of token indexes
+//    from the link table into a list of tokens.
+//
+
+void HumdrumFileStructure::loadBinaryLinks(vector<HTp>& output,
+		const HumbString& range, const int* links, const vector<HTp>& tokens) {
+	output.resize(range.length);
+	for (int i=0; i<range.length; i++) {
+		output[i] = tokens[links[range.offset + i]];
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::HumdrumFileStructure -- HumdrumFileStructure
@@ -20618,16 +23035,29 @@ bool HumdrumFileStructure::readStringCsv(const string& contents,
 
 bool HumdrumFileStructure::analyzeStructure(void) {
 	m_structure_analyzed = false;
-	if (!m_strands_analyzed) {
-		if (!analyzeStrands()          ) { return isValid(); }
+	int levels = m_analysisLevel;
+	if (levels & ANALYZE_STRANDS) {
+		if (!areStrandsAnalyzed()) {
+			if (!analyzeStrands()          ) { return isValid(); }
+		}
+	}
+	if (levels & ANALYZE_GLOBALPARAMS) {
+		if (!analyzeGlobalParameters() ) { return isValid(); }
+	}
+	if (levels & ANALYZE_LOCALPARAMS) {
+		if (!analyzeLocalParameters()  ) { return isValid(); }
+	}
+	if (levels & ANALYZE_RHYTHM) {
+		if (!HumdrumFileBase::analyze(ANALYZE_LINKS)) { return isValid(); }
+		if (!analyzeTokenDurations()   ) { return isValid(); }
+		m_structure_analyzed = true;
+		if (!analyzeRhythmStructure()  ) { return isValid(); }
 	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
-	m_structure_analyzed = true;
-	if (!analyzeRhythmStructure()  ) { return isValid(); }
 	analyzeSignifiers();
+	if (levels & ~ANALYZE_STRUCTURE) {
+		// Content analyses such as slurs and ties:
+		analyze(levels);
+	}
 	return isValid();
 }
 
@@ -20636,16 +23066,26 @@ bool HumdrumFileStructure::analyzeStructure(void) {
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze global/local
-//    parameters but not rhythmic structure.
+//    parameters but not rhythmic structure.  Parameters are only
+//    analyzed here if they are included in the analysis level (see
+//    setAnalysisLevel()); otherwise they are analyzed when needed.
 //
 
 bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 	m_structure_analyzed = true;
-	if (!m_strands_analyzed) {
-		if (!analyzeStrands()          ) { return isValid(); }
+	if (!HumdrumFileBase::analyze(ANALYZE_SPINES)) { return isValid(); }
+	int levels = m_analysisLevel;
+	if (levels & ANALYZE_STRANDS) {
+		if (!areStrandsAnalyzed()) {
+			if (!analyzeStrands()          ) { return isValid(); }
+		}
+	}
+	if ((levels & ANALYZE_GLOBALPARAMS) && !isAnalyzed(ANALYZE_GLOBALPARAMS)) {
+		if (!analyzeGlobalParameters() ) { return isValid(); }
+	}
+	if ((levels & ANALYZE_LOCALPARAMS) && !isAnalyzed(ANALYZE_LOCALPARAMS)) {
+		if (!analyzeLocalParameters()  ) { return isValid(); }
 	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
 	if (!analyzeTokenDurations()   ) { return isValid(); }
 	analyzeSignifiers();
 	return isValid();
@@ -20653,14 +23093,62 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyze -- Do any of the given ANALYZE_*
+//    analyses that have not already been done (see
+//    HumdrumFileBase::analyze()).
+//
+
+bool HumdrumFileStructure::analyze(int levels) {
+	if (levels & (ANALYZE_STRANDS | ANALYZE_LOCALPARAMS | ANALYZE_RHYTHM)) {
+		levels |= ANALYZE_LINKS;
+	}
+	if (!HumdrumFileBase::analyze(levels)) {
+		return isValid();
+	}
+	if ((levels & ANALYZE_STRANDS) && !isAnalyzed(ANALYZE_STRANDS)) {
+		if (!analyzeStrands()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_GLOBALPARAMS) && !isAnalyzed(ANALYZE_GLOBALPARAMS)) {
+		if (!analyzeGlobalParameters()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_LOCALPARAMS) && !isAnalyzed(ANALYZE_LOCALPARAMS)) {
+		if (!analyzeLocalParameters()) { return isValid(); }
+	}
+	if ((levels & ANALYZE_RHYTHM) && !isAnalyzed(ANALYZE_RHYTHM)) {
+		if (!analyzeRhythmStructure()) { return isValid(); }
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::checkRhythm -- Analyze the rhythm of the file if
+//    this has not been done yet (used by barline accessor functions).
+//
+
+void HumdrumFileStructure::checkRhythm(void) const {
+	if (!(m_analyzed & ANALYZE_RHYTHM)) {
+		const_cast<HumdrumFileStructure*>(this)->analyze(ANALYZE_RHYTHM);
+	}
+}
+
+
+
 /////////////////////////////
 //
 // HumdrumFileStructure::analyzeRhythmStructure --
 //
 
 bool HumdrumFileStructure::analyzeRhythmStructure(void) {
-	m_rhythm_analyzed = true;
+	m_analyzed |= ANALYZE_RHYTHM;
 	setLineRhythmAnalyzed();
+	if (!isAnalyzed(ANALYZE_LINKS)) {
+		if (!HumdrumFileBase::analyze(ANALYZE_LINKS)) { return isValid(); }
+	}
 	if (!isStructureAnalyzed()) {
 		if (!analyzeStructureNoRhythm()) { return isValid(); }
 	}
@@ -20672,6 +23160,7 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 		if (!analyzeRhythm()           ) { return isValid(); }
 		if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	}
+	assignLineTicks();
 	return isValid();
 }
 
@@ -20698,11 +23187,7 @@ bool HumdrumFileStructure::assignRhythmFromRecip(HTp spinestart) {
 			continue;
 		}
 
-		if (strchr(current->c_str(), 'q') != NULL) {
-			duration = 0;
-		} else {
-			duration = Convert::recipToDuration((string)*current);
-		}
+		duration = current->getRecipDuration();
 		current->getLine()->setDuration(duration);
 		current = current->getNextToken();
 	}
@@ -20845,6 +23330,7 @@ int HumdrumFileStructure::tpq(void) {
 	if (m_ticksperquarternote > 0) {
 		return m_ticksperquarternote;
 	}
+	checkRhythm();
 	set<HumNum> durlist = getPositiveLineDurations();
 	vector<int> dems;
 	for (auto& it : durlist) {
@@ -20862,6 +23348,67 @@ int HumdrumFileStructure::tpq(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::durationToTicks -- Convert a duration in quarter
+//    notes into ticks (see tpq()).  Durations which are not a multiple
+//    of a tick are truncated.
+//
+
+long long HumdrumFileStructure::durationToTicks(HumNum duration) {
+	long long ticks = tpq();
+	long long bot = duration.getDenominator();
+	if (ticks % bot == 0) {
+		return duration.getNumerator() * (ticks / bot);
+	}
+	return duration.getNumerator() * ticks / bot;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::ticksToDuration -- Convert a time in ticks (see
+//    tpq()) into a duration in quarter notes.  The whole quarter notes and
+//    the remaining ticks are converted separately so that large tick
+//    values are not narrowed to an int.
+//
+
+HumNum HumdrumFileStructure::ticksToDuration(long long ticks) {
+	long long ticksperquarter = tpq();
+	if (ticksperquarter <= 0) {
+		return 0;
+	}
+	HumNum output((int)(ticks / ticksperquarter));
+	output += HumNum((int)(ticks % ticksperquarter), (int)ticksperquarter);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::assignLineTicks -- Store the line durations and
+//    times in ticks after the rhythm of the file has been analyzed.
+//
+
+void HumdrumFileStructure::assignLineTicks(void) {
+	// Line durations may have changed since tpq() was last calculated:
+	m_ticksperquarternote = -1;
+	int ticks = tpq();
+	if (ticks <= 0) {
+		return;
+	}
+	for (auto& line : m_lines) {
+		line->m_tickDuration     = durationToTicks(line->m_duration);
+		line->m_ticksFromStart   = durationToTicks(line->m_durationFromStart);
+		line->m_ticksFromBarline = durationToTicks(line->m_durationFromBarline);
+		line->m_ticksToBarline   = durationToTicks(line->m_durationToBarline);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::getPositiveLineDurations -- Return a list of all
@@ -20905,6 +23452,7 @@ ostream& HumdrumFileStructure::printDurationInfo(ostream& out) {
 //
 
 HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -20928,6 +23476,7 @@ HumdrumLine* HumdrumFileStructure::getBarline(int index) const {
 //
 
 int HumdrumFileStructure::getBarlineCount(void) const {
+	checkRhythm();
 	return (int)m_barlines.size();
 }
 
@@ -20943,6 +23492,7 @@ int HumdrumFileStructure::getBarlineCount(void) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -20971,6 +23521,7 @@ HumNum HumdrumFileStructure::getBarlineDuration(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -20992,6 +23543,7 @@ HumNum HumdrumFileStructure::getBarlineDurationFromStart(int index) const {
 //
 
 HumNum HumdrumFileStructure::getBarlineDurationToEnd(int index) const {
+	checkRhythm();
 	if (index < 0) {
 		index += (int)m_barlines.size();
 	}
@@ -21150,6 +23702,7 @@ bool HumdrumFileStructure::analyzeTokenDurations (void) {
 //
 
 bool HumdrumFileStructure::analyzeGlobalParameters(void) {
+	m_analyzed |= ANALYZE_GLOBALPARAMS;
 	vector<HumdrumLine*> globals;
 
 //	for (int i=0; i<(int)m_lines.size(); i++) {
@@ -21203,6 +23756,7 @@ bool HumdrumFileStructure::analyzeGlobalParameters(void) {
 //
 
 bool HumdrumFileStructure::analyzeLocalParameters(void) {
+	m_analyzed |= ANALYZE_LOCALPARAMS;
 	// analyze backward tokens:
 
 	for (int i=0; i<getStrandCount(); i++) {
@@ -21367,12 +23921,16 @@ bool HumdrumFileStructure::decrementDurStates(vector<HumNum>& durs,
 //////////////////////////////
 //
 // HumdrumFileStructure::assignDurationsToTrack -- Assign duration from starts
-//    for each rhythmic spine in the file.  Analysis is done recursively, one
-//    sub-spine at a time.  Duplicate analyses are prevented by the state
-//    variable in the HumdrumToken (currently called rhycheck because it is only
-//    used in this function).  After the durationFromStarts have been assigned
-//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
-//    done elsewhere.
+//    for each rhythmic spine in the file.  Analysis is done iteratively, one
+//    sub-spine at a time: the primary sub-spine is followed to its end, and
+//    the sub-spines which split off from it are placed on a worklist to be
+//    processed afterwards (last split first, which is the order of a
+//    depth-first traversal).  Each token is visited once: tokens are marked
+//    with the state variable in the HumdrumToken (currently called rhycheck
+//    because it is only used in this function), and a sub-spine stops when it
+//    reaches a token that has already been visited, such as at a spine merge.
+//    After the durationFromStarts have been assigned for the rhythmic
+//    analysis of non-data tokens and non-rhythmic spines is done elsewhere.
 //
 
 bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
@@ -21381,8 +23939,15 @@ bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
 		return isValid();
 	}
 	int state = starttoken->getState();
-	if (!prepareDurations(starttoken, state, startdur)) {
-		return isValid();
+	vector<pair<HTp, HumNum>> worklist;
+	worklist.emplace_back(starttoken, startdur);
+	while (!worklist.empty()) {
+		HTp token = worklist.back().first;
+		HumNum dursum = worklist.back().second;
+		worklist.pop_back();
+		if (!prepareDurations(token, state, dursum, worklist)) {
+			return isValid();
+		}
 	}
 	return isValid();
 }
@@ -21392,12 +23957,14 @@ bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
 //////////////////////////////
 //
 // HumdrumFileStructure::prepareDurations -- Helper function for
-//     HumdrumFileStructure::assignDurationsToTrack() which does all of the
-//     work for assigning durationFromStart values.
+//     HumdrumFileStructure::assignDurationsToTrack() which assigns
+//     durationFromStart values along one sub-spine.  The starting tokens
+//     of sub-spines which split off are added to the worklist along with
+//     their durationFromStart.
 //
 
 bool HumdrumFileStructure::prepareDurations(HTp token, int state,
-		HumNum startdur) {
+		HumNum startdur, vector<pair<HTp, HumNum>>& worklist) {
 	if (state != token->getState()) {
 		return isValid();
 	}
@@ -21411,14 +23978,10 @@ bool HumdrumFileStructure::prepareDurations(HTp token, int state,
 	}
 	int tcount = token->getNextTokenCount();
 
-	vector<HTp> reservoir;
-	vector<HumNum> startdurs;
-
 	// Assign line durationFromStarts for primary track first.
 	while (tcount > 0) {
 		for (int t=1; t<tcount; t++) {
-			reservoir.push_back(token->getNextToken(t));
-			startdurs.push_back(dursum);
+			worklist.emplace_back(token->getNextToken(t), dursum);
 		}
 		token = token->getNextToken(0);
 		if (state != token->getState()) {
@@ -21436,13 +23999,6 @@ bool HumdrumFileStructure::prepareDurations(HTp token, int state,
 		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
 	}
 
-	// Process secondary tracks next:
-	int newstate = state;
-
-	for (int i=(int)reservoir.size()-1; i>=0; i--) {
-		prepareDurations(reservoir[i], newstate, startdurs[i]);
-	}
-
 	return isValid();
 }
 
@@ -21511,6 +24067,7 @@ bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
 				dursum += token->getDuration();
 			}
 			token = token->getNextToken(0);
+			tcount = token->getNextTokenCount();
 		}
 	}
 
@@ -21826,7 +24383,8 @@ void HumdrumFileStructure::checkForLocalParameters(HTp token,
 //
 
 bool HumdrumFileStructure::analyzeStrands(void) {
-	m_strands_analyzed = true;
+	m_analyzed |= ANALYZE_STRANDS;
+	if (!HumdrumFileBase::analyze(ANALYZE_LINKS)) { return isValid(); }
 	int spines = getSpineCount();
 	m_strand1d.resize(0);
 	m_strand2d.resize(0);
@@ -21901,14 +24459,28 @@ void HumdrumFileStructure::resolveNullTokens(void) {
 //
 // HumdrumFileStructure::assignStrandsToTokens -- Store the 1D strand
 //    index number for each token in the file.  Global tokens will have
-//    strand index set to -1.
+//    strand index set to -1.  Each token is given the highest strand index
+//    of the strands that lead to it when following the primary next tokens
+//    from the strand start.  The strands are followed from the last to the
+//    first, and each walk stops at the first token which has already been
+//    assigned, since all later tokens on that path have been assigned as
+//    well.  This way each token is visited once, rather than once for every
+//    strand which merges into it.
 //
 
 void HumdrumFileStructure::assignStrandsToTokens(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<m_lines[i]->getTokenCount(); j++) {
+			m_lines[i]->token(j)->setStrandIndex(-1);
+		}
+	}
 	HTp tok;
-	for (int i=0; i<(int)m_strand1d.size(); i++) {
+	for (int i=(int)m_strand1d.size()-1; i>=0; i--) {
 		tok = m_strand1d[i].first;
-		while (tok != NULL) {
+		while ((tok != NULL) && (tok->getStrandIndex() < 0)) {
 			tok->setStrandIndex(i);
 			tok = tok->getNextToken();
 		}
@@ -22095,6 +24667,7 @@ bool HumdrumFileStructure::hasUniversalFilters(void) {
 
 void HumdrumFileStructure::analyzeSignifiers(void) {
 	HumdrumFileStructure& infile = *this;
+	m_signifiers.clear();
 	for (int i=0; i<getLineCount(); i++) {
 		if (!infile[i].isSignifier()) {
 			continue;
@@ -22143,6 +24716,672 @@ std::string HumdrumFileStructure::getKernBelowSignifier(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::reanalyzeEdits -- Update the analysis of the file
+//    after lines have been inserted, deleted or edited.  Spine links, track
+//    information, strands, null token resolution, token durations and line
+//    timestamps are repaired from the first edited line to the next barline
+//    or spine manipulator after the last edited line (the timestamps of
+//    the rest of the file are shifted if the duration up to that point
+//    changed).  If the edits change the spine structure of the file, or
+//    the rhythm cannot be repaired locally, then the file is read again
+//    from the text of its lines.  Content analyses (slurs, ties and
+//    accidentals) which have already been done are done again for the
+//    entire file.
+//
+
+bool HumdrumFileStructure::reanalyzeEdits(void) {
+	if (!hasEdits()) {
+		return isValid();
+	}
+	if (!isAnalyzed(ANALYZE_TOKENS)) {
+		clearEdits();
+		return isValid();
+	}
+	if (!repairEditedSpines(m_editStart, m_editEnd) ||
+			!repairEditedStructure(m_editStart, m_editEnd)) {
+		string text = getEditedText();
+		return HumdrumFileStructure::readString(text);
+	}
+	clearEdits();
+	int content = m_analyzed & (ANALYZE_SLURS | ANALYZE_TIES | ANALYZE_ACCIDENTALS);
+	if (content) {
+		m_analyzed &= ~content;
+		return analyze(content);
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairEditedStructure -- Repair the strand and
+//    rhythm analyses after the spines of the edited lines have been
+//    repaired.  Returns false if the file needs to be analyzed again.
+//
+
+bool HumdrumFileStructure::repairEditedStructure(int startline, int endline) {
+	if (!isAnalyzed(ANALYZE_LINKS)) {
+		return true;
+	}
+	if ((startline < 0) || (endline >= (int)m_lines.size())) {
+		return true;
+	}
+	if (m_analyzed & (ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS)) {
+		// Layout parameters are attached to the tokens which follow them.
+		for (int i=(startline > 0 ? startline - 1 : 0); i<=endline; i++) {
+			if (m_lines[i]->isComment() && (m_lines[i]->find("LO:") != string::npos)) {
+				return false;
+			}
+		}
+	}
+
+	vector<HumdrumLine*> region;
+	HumdrumLine* previous = NULL;
+	HumdrumLine* next = NULL;
+	getEditedRegion(startline, endline, region, previous, next);
+	if (previous && next) {
+		HumdrumLine* first = region.empty() ? next : region[0];
+		if (next->m_rhythm_analyzed) {
+			for (int i=startline; i<=endline; i++) {
+				m_lines[i]->m_rhythm_analyzed = true;
+				if (!m_lines[i]->analyzeTokenDurations(m_parseError)) {
+					return false;
+				}
+			}
+		}
+		if (m_analyzed & ANALYZE_STRANDS) {
+			repairEditedStrands(region, next, startline, endline);
+		}
+		if (m_analyzed & ANALYZE_RHYTHM) {
+			if (!repairEditedRhythm(first, endline)) {
+				return false;
+			}
+			repairNonNullDataTokens(first, startline, endline);
+		}
+		if ((m_analyzed & ANALYZE_STRANDS) && m_nulls_analyzed) {
+			repairNullResolutions(first, endline);
+		}
+	}
+
+	analyzeSignifiers();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairEditedStrands -- Assign strands to the tokens
+//    on edited lines, and move the starts of strands which begin after a
+//    spine split to the first edited line following the split.
+//
+
+void HumdrumFileStructure::repairEditedStrands(vector<HumdrumLine*>& region,
+		HumdrumLine* next, int startline, int endline) {
+	for (int i=0; i<(int)region.size(); i++) {
+		for (int j=0; j<region[i]->getTokenCount(); j++) {
+			region[i]->token(j)->setStrandIndex(next->token(j)->getStrandIndex());
+		}
+	}
+	for (int i=0; i<(int)m_strand1d.size(); i++) {
+		m_strand1d[i].first = getEditedStrandStart(m_strand1d[i].first,
+				startline, endline);
+	}
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		for (int j=0; j<(int)m_strand2d[i].size(); j++) {
+			m_strand2d[i][j].first = getEditedStrandStart(m_strand2d[i][j].first,
+					startline, endline);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getEditedStrandStart -- Helper function for
+//    repairEditedStrands().  Returns the earliest token on an edited line
+//    which comes directly before the start of a strand, or the start of the
+//    strand if there is none.
+//
+
+HTp HumdrumFileStructure::getEditedStrandStart(HTp token, int startline,
+		int endline) {
+	if (token == NULL) {
+		return token;
+	}
+	while (token->getPreviousTokenCount() > 0) {
+		HTp previous = token->getPreviousToken(0);
+		int index = previous->getLineIndex();
+		if ((index < startline) || (index > endline)) {
+			break;
+		}
+		token = previous;
+	}
+	return token;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::isTimedLine -- Returns true if the line is given
+//    a timestamp by the rhythmic analysis of its tokens (a data line with
+//    a non-null rhythmic token or the end of a rhythmic spine).  Other lines
+//    are placed in time between the timed lines before and after them.
+//
+
+bool HumdrumFileStructure::isTimedLine(HumdrumLine* line) {
+	if (!line->hasSpines()) {
+		return false;
+	}
+	if (line->isData()) {
+		return !line->isAllRhythmicNull();
+	}
+	if (!line->isInterpretation()) {
+		return false;
+	}
+	for (int i=0; i<line->getTokenCount(); i++) {
+		if (line->token(i)->isTerminateInterpretation() && line->token(i)->hasRhythm()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairEditedRhythm -- Calculate the timestamps
+//    and durations of lines from the first edited line to the first
+//    barline or spine manipulator after the last edited line.  Returns
+//    false if the spines do not end at the same time on that line (or the
+//    rhythm is not consistent), in which case the rhythm of the entire
+//    file has to be analyzed again.
+//
+
+bool HumdrumFileStructure::repairEditedRhythm(HumdrumLine* first, int endline) {
+	HTp firstspine = getSpineStart(0);
+	if (firstspine && firstspine->isDataType("**recip")) {
+		return false;
+	}
+	for (int track=2; track<=getMaxTrack(); track++) {
+		if (getTrackStart(track)->getLineIndex() != firstspine->getLineIndex()) {
+			// floating spines are linked to the score by the full analysis
+			return false;
+		}
+	}
+
+	int i, j;
+	int stopindex = -1;
+	for (i=endline+1; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		if (m_lines[i]->isBarline() || m_lines[i]->isManipulator()) {
+			stopindex = i;
+			break;
+		}
+	}
+	if (stopindex < 0) {
+		return false;
+	}
+	HumdrumLine* stopline = m_lines[stopindex];
+	int fieldcount = first->getTokenCount();
+	if (stopline->getTokenCount() != fieldcount) {
+		return false;
+	}
+
+	// Find the time at which the last note before the edited lines
+	// ends in each rhythmic spine:
+	vector<HumNum> durstate(fieldcount, -1);
+	for (j=0; j<fieldcount; j++) {
+		HTp token = first->token(j);
+		if (!token->hasRhythm()) {
+			continue;
+		}
+		while (token->getPreviousTokenCount() > 0) {
+			token = token->getPreviousToken(0);
+			if (token->isData() && !token->isNull() && token->getDuration().isNonNegative()) {
+				durstate[j] = token->getDurationFromStart() + token->getDuration();
+				break;
+			}
+		}
+		if (durstate[j].isNegative()) {
+			if (token->getLineIndex() != getTrackStart(1)->getLineIndex()) {
+				// floating spine
+				return false;
+			}
+			durstate[j] = 0;
+		}
+	}
+
+	// The old timestamp of the stop line (or of the next timed line):
+	int endindex = stopindex;
+	while ((endindex < (int)m_lines.size() - 1) && !isTimedLine(m_lines[endindex])) {
+		endindex++;
+	}
+	HumNum oldstop = m_lines[endindex]->getDurationFromStart();
+
+	int firstindex = first->getLineIndex();
+	for (i=firstindex; i<stopindex; i++) {
+		HumdrumLine* line = m_lines[i];
+		if (!(line->hasSpines() && line->isData())) {
+			line->setDurationFromStart(-1);
+			continue;
+		}
+		bool found = false;
+		HumNum linestart = 0;
+		for (j=0; j<fieldcount; j++) {
+			HTp token = line->token(j);
+			if (!token->hasRhythm() || token->getDuration().isNegative()) {
+				continue;
+			}
+			if (!found) {
+				linestart = durstate[j];
+				found = true;
+			} else if (durstate[j] != linestart) {
+				return false;
+			}
+		}
+		if (!found) {
+			line->setDurationFromStart(-1);
+			continue;
+		}
+		line->setDurationFromStart(linestart);
+		for (j=0; j<fieldcount; j++) {
+			HTp token = line->token(j);
+			if (!token->hasRhythm() || token->getDuration().isNegative()) {
+				continue;
+			}
+			durstate[j] = linestart + token->getDuration();
+		}
+	}
+
+	// All rhythmic spines must end at the same time at the stop line.
+	HumNum newstop = -1;
+	for (j=0; j<fieldcount; j++) {
+		if (!stopline->token(j)->hasRhythm()) {
+			continue;
+		}
+		if (newstop.isNegative()) {
+			newstop = durstate[j];
+		} else if (durstate[j] != newstop) {
+			return false;
+		}
+	}
+	if (newstop.isNegative()) {
+		newstop = oldstop;
+	}
+	HumNum delta = newstop - oldstop;
+	if (delta != 0) {
+		for (i=stopindex; i<(int)m_lines.size(); i++) {
+			m_lines[i]->setDurationFromStart(m_lines[i]->getDurationFromStart() + delta);
+		}
+	}
+
+	// Place untimed lines between the timed lines around the region
+	// (see analyzeNullLineRhythms() and fillInNegativeStartTimes()).
+	int startindex = firstindex - 1;
+	while ((startindex >= 0) && !isTimedLine(m_lines[startindex])) {
+		startindex--;
+	}
+	for (i=startindex+1; i<=endindex; i++) {
+		if (!isTimedLine(m_lines[i])) {
+			m_lines[i]->setDurationFromStart(-1);
+		}
+	}
+
+	vector<HumdrumLine*> nulllines;
+	HumdrumLine* previous = startindex >= 0 ? m_lines[startindex] : NULL;
+	for (i=startindex+1; i<=endindex; i++) {
+		HumdrumLine* line = m_lines[i];
+		if (!line->hasSpines()) {
+			continue;
+		}
+		if (line->isAllRhythmicNull()) {
+			if (line->isData()) {
+				nulllines.push_back(line);
+			}
+			continue;
+		}
+		if (line->getDurationFromStart().isNegative()) {
+			continue;
+		}
+		if (previous) {
+			HumNum startdur = previous->getDurationFromStart();
+			HumNum nulldur = (line->getDurationFromStart() - startdur) /
+					((int)nulllines.size() + 1);
+			for (j=0; j<(int)nulllines.size(); j++) {
+				nulllines[j]->setDurationFromStart(startdur + (nulldur * (j+1)));
+			}
+		}
+		previous = line;
+		nulllines.clear();
+	}
+
+	int fillstart = startindex >= 0 ? startindex : 0;
+	HumNum lastdur = -1;
+	for (i=endindex; i>=fillstart; i--) {
+		HumNum dur = m_lines[i]->getDurationFromStart();
+		if (dur.isNonNegative()) {
+			lastdur = dur;
+		} else if (lastdur.isNonNegative()) {
+			m_lines[i]->setDurationFromStart(lastdur);
+		}
+	}
+	lastdur = -1;
+	for (i=fillstart; i<=endindex; i++) {
+		HumNum dur = m_lines[i]->getDurationFromStart();
+		if (dur.isNonNegative()) {
+			lastdur = dur;
+		} else {
+			m_lines[i]->setDurationFromStart(lastdur);
+		}
+	}
+
+	for (i=fillstart; i<=endindex; i++) {
+		if (i < (int)m_lines.size() - 1) {
+			m_lines[i]->setDuration(m_lines[i+1]->getDurationFromStart() -
+					m_lines[i]->getDurationFromStart());
+		} else {
+			m_lines[i]->setDuration(0);
+		}
+	}
+	if (fillstart > 0) {
+		m_lines[fillstart-1]->setDuration(m_lines[fillstart]->getDurationFromStart() -
+				m_lines[fillstart-1]->getDurationFromStart());
+	}
+
+	repairNonRhythmicDurations(first, fillstart, endindex);
+	repairMeter(fillstart, endindex);
+	if (!isValid()) {
+		return false;
+	}
+	// The edit may change tpq(), so the ticks of every line are
+	// calculated again.
+	assignLineTicks();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairNonRhythmicDurations -- Calculate the
+//    durations of non-null data tokens in non-rhythmic spines for the
+//    lines from startindex to endindex which were given new timestamps
+//    (see assignDurationsToNonRhythmicTrack()).
+//
+
+void HumdrumFileStructure::repairNonRhythmicDurations(HumdrumLine* first,
+		int startindex, int endindex) {
+	for (int j=0; j<first->getTokenCount(); j++) {
+		HTp token = first->token(j);
+		if (token->hasRhythm()) {
+			continue;
+		}
+		HTp pending = NULL;
+		while (token->getPreviousTokenCount() > 0) {
+			token = token->getPreviousToken(0);
+			if (token->isData() && !token->isNull()) {
+				pending = token;
+				if (token->getLineIndex() < startindex) {
+					break;
+				}
+			}
+		}
+		if (pending) {
+			token = pending;
+		}
+		while (token) {
+			if (token->isData() && !token->isNull()) {
+				if (pending && (pending != token)) {
+					pending->setDuration(token->getDurationFromStart() -
+							pending->getDurationFromStart());
+				}
+				pending = token;
+				if (token->getLineIndex() > endindex) {
+					break;
+				}
+			}
+			if (token->getNextTokenCount() == 0) {
+				if (pending) {
+					pending->setDuration(token->getDurationFromStart() -
+							pending->getDurationFromStart());
+				}
+				break;
+			}
+			token = token->getNextToken(0);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairMeter -- Update the list of barlines, and the
+//    durations from/to barlines of the lines in the measures which contain
+//    the lines from startindex to endindex (see analyzeMeter()).
+//
+
+void HumdrumFileStructure::repairMeter(int startindex, int endindex) {
+	int i;
+	m_barlines.resize(0);
+	bool foundbarline = false;
+	for (i=0; i<(int)m_lines.size(); i++) {
+		if (m_lines[i]->isBarline()) {
+			foundbarline = true;
+			m_barlines.push_back(m_lines[i]);
+		}
+		if (m_lines[i]->isData() && !foundbarline) {
+			m_barlines.push_back(m_lines[0]);
+			foundbarline = true;
+		}
+	}
+
+	int barstart = startindex;
+	while ((barstart > 0) && !m_lines[barstart]->isBarline()) {
+		barstart--;
+	}
+	int barend = endindex;
+	while ((barend < (int)m_lines.size() - 1) && !m_lines[barend]->isBarline()) {
+		barend++;
+	}
+
+	HumNum sum = 0;
+	for (i=(m_lines[barstart]->isBarline() ? barstart + 1 : barstart); i<=barend; i++) {
+		m_lines[i]->setDurationFromBarline(sum);
+		sum += m_lines[i]->getDuration();
+		if (m_lines[i]->isBarline()) {
+			sum = 0;
+		}
+	}
+
+	sum = 0;
+	for (i=(m_lines[barend]->isBarline() ? barend - 1 : barend); i>=barstart; i--) {
+		sum += m_lines[i]->getDuration();
+		m_lines[i]->setDurationToBarline(sum);
+		if (m_lines[i]->isBarline()) {
+			sum = 0;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairNonNullDataTokens -- Update the links to the
+//    previous and next non-null data tokens for the tokens between the
+//    last non-null data token before the edited lines and the first one
+//    after them.  If a spine manipulator or the end of a spine is found
+//    instead, the links are analyzed again for the entire file.
+//
+
+void HumdrumFileStructure::repairNonNullDataTokens(HumdrumLine* first,
+		int startline, int endline) {
+	bool local = true;
+	vector<HTp> tokens;
+
+	for (int j=0; j<first->getTokenCount(); j++) {
+		// Find the non-null data token before the edited lines:
+		HTp token = first->token(j);
+		HTp previous = NULL;
+		while (token->getPreviousTokenCount() == 1) {
+			token = token->getPreviousToken(0);
+			if (token->isSplitInterpretation() || token->isMergeInterpretation()) {
+				break;
+			}
+			if (token->isData() && !token->isNull() &&
+					(token->getLineIndex() < startline)) {
+				previous = token;
+				break;
+			}
+		}
+		if (!previous || (previous->getPreviousTokenCount() != 1) ||
+				previous->getPreviousToken(0)->isSplitInterpretation()) {
+			local = false;
+			break;
+		}
+
+		// Collect the tokens up to the next non-null data token:
+		tokens.clear();
+		tokens.push_back(previous);
+		HTp next = NULL;
+		token = previous;
+		while (token->getNextTokenCount() == 1) {
+			token = token->getNextToken(0);
+			if (token->isSplitInterpretation() || token->isMergeInterpretation() ||
+					(token->getPreviousTokenCount() != 1)) {
+				break;
+			}
+			tokens.push_back(token);
+			if (token->isData() && !token->isNull() &&
+					(token->getLineIndex() > endline)) {
+				next = token;
+				break;
+			}
+		}
+		if (!next) {
+			local = false;
+			break;
+		}
+
+		HTp current = previous;
+		for (int i=1; i<(int)tokens.size(); i++) {
+			tokens[i]->m_previousNonNullTokens.assign(1, current);
+			if (tokens[i]->isData() && !tokens[i]->isNull()) {
+				current = tokens[i];
+			}
+		}
+		current = next;
+		for (int i=(int)tokens.size() - 2; i>=0; i--) {
+			tokens[i]->m_nextNonNullTokens.assign(1, current);
+			if (tokens[i]->isData() && !tokens[i]->isNull()) {
+				current = tokens[i];
+			}
+		}
+	}
+
+	if (local) {
+		return;
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<m_lines[i]->getTokenCount(); j++) {
+			m_lines[i]->token(j)->m_previousNonNullTokens.clear();
+			m_lines[i]->token(j)->m_nextNonNullTokens.clear();
+		}
+	}
+	analyzeNonNullDataTokens();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::repairNullResolutions -- Resolve null data tokens
+//    on the edited lines, and the null tokens which follow them in the
+//    same strand (see resolveNullTokens()).  If there is no non-null data
+//    token before and after the edited lines in a strand, then the null
+//    tokens are resolved again for the entire file.
+//
+
+void HumdrumFileStructure::repairNullResolutions(HumdrumLine* first,
+		int endline) {
+	bool local = true;
+	vector<HTp> tokens;
+
+	for (int j=0; j<first->getTokenCount(); j++) {
+		HTp token = first->token(j);
+		int strand = token->getStrandIndex();
+		HTp data = NULL;
+		HTp current = token;
+		while (current->getPreviousTokenCount() > 0) {
+			current = current->getPreviousToken(0);
+			if (current->getStrandIndex() != strand) {
+				break;
+			}
+			if (current->isData()) {
+				data = current->isNull() ? current->m_nullresolve : current;
+				break;
+			}
+		}
+		if (data == NULL) {
+			local = false;
+			break;
+		}
+		tokens.clear();
+		bool found = false;
+		while (token && (token->getStrandIndex() == strand)) {
+			if (token->isData()) {
+				if (!token->isNull() && (token->getLineIndex() > endline)) {
+					found = true;
+					break;
+				}
+				tokens.push_back(token);
+			}
+			token = token->getNextTokenCount() ? token->getNextToken(0) : NULL;
+		}
+		if (!found) {
+			local = false;
+			break;
+		}
+		for (int i=0; i<(int)tokens.size(); i++) {
+			if (tokens[i]->isNull()) {
+				tokens[i]->setNullResolution(data);
+			} else {
+				tokens[i]->setNullResolution(NULL);
+				data = tokens[i];
+			}
+		}
+	}
+
+	if (local) {
+		return;
+	}
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		if (!m_lines[i]->hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<m_lines[i]->getTokenCount(); j++) {
+			m_lines[i]->token(j)->setNullResolution(NULL);
+		}
+	}
+	m_nulls_analyzed = false;
+	resolveNullTokens();
+}
+
+
+
 
 //////////////////////////////
 //
@@ -22181,12 +25420,16 @@ HumdrumLine::HumdrumLine(const char* aString) : string(aString) {
 }
 
 
-HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line) {
+HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line), HumHash() {
 	m_lineindex           = line.m_lineindex;
 	m_duration            = line.m_duration;
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_tickDuration        = line.m_tickDuration;
+	m_ticksFromStart      = line.m_ticksFromStart;
+	m_ticksFromBarline    = line.m_ticksFromBarline;
+	m_ticksToBarline      = line.m_ticksToBarline;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -22205,6 +25448,10 @@ HumdrumLine::HumdrumLine(HumdrumLine& line, void* owner) : string((string)line)
 	m_durationFromStart   = line.m_durationFromStart;
 	m_durationFromBarline = line.m_durationFromBarline;
 	m_durationToBarline   = line.m_durationToBarline;
+	m_tickDuration        = line.m_tickDuration;
+	m_ticksFromStart      = line.m_ticksFromStart;
+	m_ticksFromBarline    = line.m_ticksFromBarline;
+	m_ticksToBarline      = line.m_ticksToBarline;
 	m_tokens.resize(line.m_tokens.size());
 	for (int i=0; i<(int)m_tokens.size(); i++) {
 		m_tokens[i] = new HumdrumToken(*line.m_tokens[i], this);
@@ -22260,6 +25507,36 @@ HumdrumLine::~HumdrumLine() {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::operator new -- Allocate lines from a memory pool.
+//    See HumdrumToken::operator new.
+//
+
+void* HumdrumLine::operator new(size_t size) {
+	if (size != sizeof(HumdrumLine)) {
+		return ::operator new(size);
+	}
+	return HumPool<sizeof(HumdrumLine)>::allocate();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::operator delete -- Return a line's memory to the pool.
+//
+
+void HumdrumLine::operator delete(void* ptr, size_t size) {
+	if (size != sizeof(HumdrumLine)) {
+		::operator delete(ptr);
+		return;
+	}
+	HumPool<sizeof(HumdrumLine)>::deallocate(ptr);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::setLineFromCsv -- Read a HumdrumLine from a CSV line.
@@ -22966,6 +26243,77 @@ HumNum HumdrumLine::getBarlineDuration(HumNum scale) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::getTickDuration -- Return the duration of the line in
+//    ticks, where a quarter note is HumdrumFileStructure::tpq() ticks.
+//    Tick values allow times in the file to be compared and summed with
+//    integer rather than rational arithmetic.  Returns -1 if the line
+//    does not belong to a file.
+//
+
+long long HumdrumLine::getTickDuration(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_tickDuration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTicksFromStart -- Return the time from the start of the
+//    file to the start of the line in ticks (see getTickDuration()).
+//
+
+long long HumdrumLine::getTicksFromStart(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_ticksFromStart;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTicksFromBarline -- Return the time from the previous
+//    barline to the start of the line in ticks (see getTickDuration()).
+//
+
+long long HumdrumLine::getTicksFromBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_ticksFromBarline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::getTicksToBarline -- Return the time from the start of the
+//    line to the next barline in ticks (see getTickDuration()).
+//
+
+long long HumdrumLine::getTicksToBarline(void) {
+	if (!m_rhythm_analyzed) {
+		if (getOwner()) {
+			getOwner()->analyzeRhythmStructure();
+		}
+	}
+	return m_ticksToBarline;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::setDurationFromStart -- Sets the duration from the start of the
@@ -23250,6 +26598,9 @@ bool HumdrumLine::isEmpty(void) const {
 //
 
 int HumdrumLine::getTokenCount(void) const {
+	if (m_tokens.empty()) {
+		checkTokens();
+	}
 	return (int)m_tokens.size();
 }
 
@@ -23265,11 +26616,29 @@ int HumdrumLine::getTokenCount(void) const {
 //
 
 HTp HumdrumLine::token(int index) const {
+	if (m_tokens.empty()) {
+		checkTokens();
+	}
 	return m_tokens[index];
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::checkTokens -- Create the tokens for the lines of the
+//    owning file if the file was read without the ANALYZE_TOKENS analysis.
+//
+
+void HumdrumLine::checkTokens(void) const {
+	HumdrumFile* owner = (HumdrumFile*)m_owner;
+	if (owner && !owner->isAnalyzed(ANALYZE_TOKENS)) {
+		owner->analyze(ANALYZE_TOKENS);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::getTokenString -- Returns a copy of the string component of
@@ -23278,7 +26647,7 @@ HTp HumdrumLine::token(int index) const {
 //
 
 string HumdrumLine::getTokenString(int index) const {
-	return (string(*m_tokens[index]));
+	return (string(*token(index)));
 }
 
 
@@ -23298,9 +26667,6 @@ int HumdrumLine::createTokensFromLine(void) {
 	m_tokens.clear();
 	m_tabs.clear();
 	HTp token;
-	char ch = 0;
-	char lastch = 0;
-	string tstring;
 
 	if (this->size() == 0) {
 		token = new HumdrumToken();
@@ -23313,34 +26679,38 @@ int HumdrumLine::createTokensFromLine(void) {
 		m_tokens.push_back(token);
 		m_tabs.push_back(0);
 	} else {
-		for (int i=0; i<(int)size(); i++) {
-			lastch = ch;
-			ch = getChar(i);
-			if (ch == '\t') {
-				// Parser now allows multiple tab characters in a
-				// row to represent a single tab.
-				if (lastch != '\t') {
-					token = new HumdrumToken(tstring);
-					token->setOwner(this);
-					m_tokens.push_back(token);
-					m_tabs.push_back(1);
-					tstring.clear();
-				} else {
-					if (m_tabs.size() > 0) {
-						m_tabs.back()++;
-					}
-				}
+		// Copy each tab-separated field directly from the line
+		// text into its token rather than building it up one
+		// character at a time.
+		const char* text = this->data();
+		int length = (int)this->size();
+		int start = 0;
+		for (int i=0; i<length; i++) {
+			if (text[i] != '\t') {
+				continue;
+			}
+			// Parser now allows multiple tab characters in a
+			// row to represent a single tab.
+			if ((i == 0) || (text[i-1] != '\t')) {
+				token = new HumdrumToken();
+				token->assign(text + start, i - start);
+				token->setOwner(this);
+				m_tokens.push_back(token);
+				m_tabs.push_back(1);
 			} else {
-				tstring += ch;
+				if (m_tabs.size() > 0) {
+					m_tabs.back()++;
+				}
 			}
+			start = i + 1;
+		}
+		if (start < length) {
+			token = new HumdrumToken();
+			token->assign(text + start, length - start);
+			token->setOwner(this);
+			m_tokens.push_back(token);
+			m_tabs.push_back(0);
 		}
-	}
-	if (tstring.size() > 0) {
-		token = new HumdrumToken(tstring);
-		token->setOwner(this);
-		m_tokens.push_back(token);
-		m_tabs.push_back(0);
-		tstring.clear();
 	}
 
 	return (int)m_tokens.size();
@@ -24043,6 +27413,22 @@ void HumdrumLine::setParameters(const string& pdata) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::markEdited -- Tell the owning file that the line has been
+//    changed, so that HumdrumFile::reanalyzeEdits() will repair the
+//    analysis of the file around the line.
+//
+
+void HumdrumLine::markEdited(void) {
+	HumdrumFile* owner = getOwner();
+	if (owner) {
+		owner->markLineEdited(m_lineindex);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::appendToken -- add a token at the end of the current
@@ -24053,6 +27439,7 @@ void HumdrumLine::appendToken(HTp token, int tabcount) {
 	// deletion will be handled by class.
 	m_tokens.push_back(token);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -24060,6 +27447,7 @@ void HumdrumLine::appendToken(const HumdrumToken& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -24067,6 +27455,7 @@ void HumdrumLine::appendToken(const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -24074,6 +27463,7 @@ void HumdrumLine::appendToken(const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.push_back(newtok);
 	m_tabs.push_back(tabcount);
+	markEdited();
 }
 
 
@@ -24109,6 +27499,7 @@ void HumdrumLine::insertToken(int index, HTp token, int tabcount) {
 	// already belongs to another HumdrumLine or HumdrumFile.
 	m_tokens.insert(m_tokens.begin() + index, token);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -24116,6 +27507,7 @@ void HumdrumLine::insertToken(int index, const HumdrumToken& token, int tabcount
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -24123,6 +27515,7 @@ void HumdrumLine::insertToken(int index, const string& token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -24130,6 +27523,7 @@ void HumdrumLine::insertToken(int index, const char* token, int tabcount) {
 	HTp newtok = new HumdrumToken(token);
 	m_tokens.insert(m_tokens.begin() + index, newtok);
 	m_tabs.insert(m_tabs.begin() + index, tabcount);
+	markEdited();
 }
 
 
@@ -24323,6 +27717,7 @@ HumdrumToken& HumdrumToken::operator=(HumdrumToken& token) {
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	setPrefix(token.getPrefix());
+	clearCachedState();
 
 	return *this;
 }
@@ -24341,6 +27736,7 @@ HumdrumToken& HumdrumToken::operator=(const string& token) {
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	setPrefix("!");
+	clearCachedState();
 
 	return *this;
 }
@@ -24359,6 +27755,7 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	setPrefix("!");
+	clearCachedState();
 
 	return *this;
 }
@@ -24378,6 +27775,37 @@ HumdrumToken::~HumdrumToken() {
 }
 
 
+
+//////////////////////////////
+//
+// HumdrumToken::operator new -- Allocate tokens from a memory pool
+//    rather than individually from the heap, since files contain
+//    many tokens which are all created and deleted together.
+//
+
+void* HumdrumToken::operator new(size_t size) {
+	if (size != sizeof(HumdrumToken)) {
+		return ::operator new(size);
+	}
+	return HumPool<sizeof(HumdrumToken)>::allocate();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::operator delete -- Return a token's memory to the pool.
+//
+
+void HumdrumToken::operator delete(void* ptr, size_t size) {
+	if (size != sizeof(HumdrumToken)) {
+		::operator delete(ptr);
+		return;
+	}
+	HumPool<sizeof(HumdrumToken)>::deallocate(ptr);
+}
+
+
 //////////////////////////////
 //
 // HumdrumToken::equalChar -- Returns true if the character at the given
@@ -24488,6 +27916,7 @@ HumNum HumdrumToken::getSlurDuration(HumNum scale) {
 	if (!isDataType("**kern")) {
 		return 0;
 	}
+	checkAnalysis(ANALYZE_SLURS);
 	if (isDefined("auto", "slurDuration")) {
 		return getValueFraction("auto", "slurDuration");
 	} else if (isDefined("auto", "slurEnd")) {
@@ -24539,7 +27968,7 @@ bool HumdrumToken::isDataType(const string& dtype) const {
 //
 
 bool HumdrumToken::isKern(void) const {
-	return isDataType("**kern");
+	return getDataTypeClass() == DATATYPE_KERN;
 }
 
 
@@ -24552,7 +27981,7 @@ bool HumdrumToken::isKern(void) const {
 //
 
 bool HumdrumToken::isMens(void) const {
-	return isDataType("**mens");
+	return getDataTypeClass() == DATATYPE_MENS;
 }
 
 
@@ -24677,6 +28106,7 @@ void HumdrumToken::setFieldIndex(int index) {
 
 void HumdrumToken::setTrack(int aTrack) {
 	m_address.setTrack(aTrack);
+	m_datatypeEpoch = -1;
 }
 
 
@@ -24767,6 +28197,26 @@ void HumdrumToken::addNextNonNullToken(HTp token) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::checkAnalysis -- Do the given ANALYZE_* analyses on the
+//    file which owns the token if they have not been done yet (such as
+//    when the file was read with a lower analysis level).
+//
+
+void HumdrumToken::checkAnalysis(int levels) const {
+	HumdrumLine* line = getOwner();
+	if (line == NULL) {
+		return;
+	}
+	HumdrumFile* infile = line->getOwner();
+	if ((infile != NULL) && !infile->isAnalyzed(levels)) {
+		infile->analyze(levels);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getNextToken -- Returns the next token in the
@@ -24778,6 +28228,9 @@ void HumdrumToken::addNextNonNullToken(HTp token) {
 //
 
 HTp HumdrumToken::getNextToken(int index) const {
+	if (m_nextTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	if ((index >= 0) && (index < (int)m_nextTokens.size())) {
 		return m_nextTokens[index];
 	} else {
@@ -24795,6 +28248,9 @@ HTp HumdrumToken::getNextToken(int index) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
+	if (m_nextTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return m_nextTokens;
 }
 
@@ -24807,6 +28263,9 @@ vector<HumdrumToken*> HumdrumToken::getNextTokens(void) const {
 //
 
 vector<HumdrumToken*> HumdrumToken::getPreviousTokens(void) const {
+	if (m_previousTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return m_previousTokens;
 }
 
@@ -24821,6 +28280,9 @@ vector<HumdrumToken*> HumdrumToken::getPreviousTokens(void) const {
 //
 
 HumdrumToken* HumdrumToken::getPreviousToken(int index) const {
+	if (m_previousTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	if ((index >= 0) && (index < (int)m_previousTokens.size())) {
 		return m_previousTokens[index];
 	} else {
@@ -24875,44 +28337,79 @@ HTp HumdrumToken::getPreviousFieldToken(void) const {
 
 bool HumdrumToken::analyzeDuration(void) {
 	m_rhythm_analyzed = true;
+	HumNum duration;
+	if (getDurationFromText(duration)) {
+		m_duration = duration;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::hasStaleDuration -- Returns true if the rhythm of the
+//    token has been analyzed, but the text of the token now represents
+//    a different duration (such as after changing the rhythm of a **kern
+//    note with setText()).
+//
+
+bool HumdrumToken::hasStaleDuration(void) const {
+	if (!m_rhythm_analyzed) {
+		return false;
+	}
+	HumNum duration;
+	if (!getDurationFromText(duration)) {
+		return false;
+	}
+	return duration != m_duration;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDurationFromText -- Calculate the duration which the
+//    text of the token represents.  Returns false if the duration is not
+//    determined by the text alone (such as for **recip data).
+//
+
+bool HumdrumToken::getDurationFromText(HumNum& duration) const {
 	if ((*this) == NULL_DATA) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
 	if (equalChar(0 ,'!')) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
 	if (equalChar(0 ,'*')) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
 	if (equalChar(0 ,'=')) {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 		return true;
 	}
-	string dtype = getDataType();
 	if (hasRhythm()) {
 		if (isData()) {
 			if (!isNull()) {
 				if (isKern()) {
-					if (strchr(this->c_str(), 'q') != NULL) {
-						m_duration = 0;
-					} else {
-						m_duration = Convert::recipToDuration((string)(*this));
-					}
+					duration = getRecipDuration();
 				} else if (isMens()) {
-					m_duration = Convert::mensToDuration((string)(*this));
+					duration = Convert::mensToDuration(*this);
+				} else {
+					return false;
 				}
 			} else {
-				m_duration.setValue(-1);
+				duration.setValue(-1);
 			}
 		} else {
-			m_duration.setValue(-1);
+			duration.setValue(-1);
 		}
 
 	} else {
-		m_duration.setValue(-1);
+		duration.setValue(-1);
 	}
 	return true;
 }
@@ -25091,6 +28588,39 @@ HumNum HumdrumToken::getDurationFromStart(HumNum scale) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getTickDuration -- Return the duration of the token in
+//   ticks, where a quarter note is HumdrumFileStructure::tpq() ticks.
+//   Returns -1 if the token does not have a duration.
+//
+
+long long HumdrumToken::getTickDuration(void) {
+	HumNum duration = getDuration();
+	if (duration < 0) {
+		return -1;
+	}
+	HumdrumLine* line = getOwner();
+	if (!line || !line->getOwner()) {
+		return -1;
+	}
+	return line->getOwner()->durationToTicks(duration);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTicksFromStart -- Return the time from the start of
+//   the owning HumdrumFile to the start of the token in ticks.
+//
+
+long long HumdrumToken::getTicksFromStart(void) {
+	return getLine()->getTicksFromStart();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::getDurationToEnd -- Returns the duration from the
@@ -25199,17 +28729,7 @@ HumNum HumdrumToken::getDurationFromBarline(HumNum scale) {
 //
 
 bool HumdrumToken::hasRhythm(void) const {
-	string type = getDataType();
-	if (type == "**kern") {
-		return true;
-	}
-	if (type == "**recip") {
-		return true;
-	}
-	if (type == "**mens") {
-		return true;
-	}
-	return false;
+	return getDataTypeClass() != DATATYPE_OTHER;
 }
 
 
@@ -25220,16 +28740,7 @@ bool HumdrumToken::hasRhythm(void) const {
 //
 
 bool HumdrumToken::hasBeam(void) const {
-	for (int i=0; i<(int)this->size(); i++) {
-		switch (this->at(i)) {
-			case 'L':
-			case 'J':
-			case 'k':
-			case 'K':
-				return true;
-		}
-	}
-	return false;
+	return (getTextFlags() & TEXT_BEAM) ? true : false;
 }
 
 
@@ -25255,16 +28766,17 @@ bool HumdrumToken::equalTo(const string& pattern) {
 //
 
 bool HumdrumToken::isRest(void) {
-	if (isKern()) {
-		if (isNull() && Convert::isKernRest((string)(*resolveNull()))) {
-			return true;
-		} else if (Convert::isKernRest((string)(*this))) {
-			return true;
-		}
-	} else if (isMens()) {
-		if (isNull() && Convert::isMensRest((string)(*resolveNull()))) {
-			return true;
-		} else if (Convert::isMensRest((string)(*this))) {
+	int datatype = getDataTypeClass();
+	if ((datatype != DATATYPE_KERN) && (datatype != DATATYPE_MENS)) {
+		return false;
+	}
+	unsigned int flags = getTextFlags();
+	if (flags & TEXT_REST) {
+		return true;
+	}
+	if (flags & TEXT_NULL) {
+		HTp resolve = resolveNull();
+		if (resolve && (resolve->getTextFlags() & TEXT_REST)) {
 			return true;
 		}
 	}
@@ -25280,16 +28792,11 @@ bool HumdrumToken::isRest(void) {
 //
 
 bool HumdrumToken::isNote(void) {
-	if (isKern()) {
-		if (Convert::isKernNote((string)(*this))) {
-			return true;
-		}
-	} else if (isMens()) {
-		if (Convert::isMensNote((string)(*this))) {
-			return true;
-		}
+	if (!(getTextFlags() & TEXT_PITCH)) {
+		return false;
 	}
-	return false;
+	int datatype = getDataTypeClass();
+	return (datatype == DATATYPE_KERN) || (datatype == DATATYPE_MENS);
 }
 
 
@@ -25339,7 +28846,7 @@ bool HumdrumToken::isNoteAttack(void) {
 //
 
 bool HumdrumToken::isInvisible(void) {
-	if (!isDataType("**kern")) {
+	if (!isKern()) {
 			return false;
 	}
 	if (isBarline()) {
@@ -25363,16 +28870,10 @@ bool HumdrumToken::isInvisible(void) {
 //
 
 bool HumdrumToken::isGrace(void) {
-	if (!isDataType("**kern")) {
-			return false;
-	}
-	if (!isData()) {
+	if (!(getTextFlags() & TEXT_GRACE)) {
 		return false;
-	} else if (this->find("q") != string::npos) {
-		return true;
 	}
-
-	return false;
+	return isData() && isKern();
 }
 
 
@@ -25510,12 +29011,10 @@ bool HumdrumToken::isMensurationSymbol(void) {
 //
 
 bool HumdrumToken::hasSlurStart(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurStart((string)(*this))) {
-			return true;
-		}
+	if (!(getTextFlags() & TEXT_SLUR_START)) {
+		return false;
 	}
-	return false;
+	return isKern();
 }
 
 
@@ -25527,12 +29026,10 @@ bool HumdrumToken::hasSlurStart(void) {
 //
 
 bool HumdrumToken::hasSlurEnd(void) {
-	if (isDataType("**kern")) {
-		if (Convert::hasKernSlurEnd((string)(*this))) {
-			return true;
-		}
+	if (!(getTextFlags() & TEXT_SLUR_END)) {
+		return false;
 	}
-	return false;
+	return isKern();
 }
 
 
@@ -25649,7 +29146,14 @@ bool HumdrumToken::hasObliquaLigatureBegin(void) {
 
 char HumdrumToken::hasStemDirection(void) {
 	if (isKern()) {
-		return Convert::hasKernStemDirection(*this);
+		int count = getKernNoteCount();
+		for (int i=0; i<count; i++) {
+			char stem = getKernNote(i).getStemDirection();
+			if (stem) {
+				return stem;
+			}
+		}
+		return '\0';
 	} else {
 		// don't know what a stem in this datatype is
 		return '\0';
@@ -25709,12 +29213,12 @@ bool HumdrumToken::hasObliquaLigatureEnd(void) {
 //
 
 bool HumdrumToken::isSecondaryTiedNote(void) {
-	if (isDataType("**kern")) {
-		if (Convert::isKernSecondaryTiedNote((string)(*this))) {
-			return true;
-		}
+	unsigned int flags = getTextFlags();
+	if ((flags & (TEXT_PITCH | TEXT_TIE_CONTINUE)) !=
+			(TEXT_PITCH | TEXT_TIE_CONTINUE)) {
+		return false;
 	}
-	return false;
+	return isKern();
 }
 
 
@@ -25893,6 +29397,9 @@ bool HumdrumToken::isLabel(void) const {
 //
 
 bool HumdrumToken::isChord(const string& separator) {
+	if (separator == " ") {
+		return (getTextFlags() & TEXT_CHORD) ? true : false;
+	}
 	return (this->find(separator) != string::npos) ? true : false;
 }
 
@@ -25905,8 +29412,7 @@ bool HumdrumToken::isChord(const string& separator) {
 //
 
 bool HumdrumToken::isExclusiveInterpretation(void) const {
-	const string& tok = (string)(*this);
-	return tok.substr(0, 2) == "**";
+	return this->compare(0, 2, "**") == 0;
 }
 
 
@@ -25974,11 +29480,115 @@ bool HumdrumToken::isAddInterpretation(void) const {
 //
 
 bool HumdrumToken::isNull(void) const {
-	const string& tok = (string)(*this);
-	if (tok == NULL_DATA)           { return true; }
-	if (tok == NULL_INTERPRETATION) { return true; }
-	if (tok == NULL_COMMENT_LOCAL)  { return true; }
-	return false;
+	return (getTextFlags() & TEXT_NULL) ? true : false;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getTextFlags -- Return the TEXT_* flags which describe
+//    the text of the token, calculating them if they have not yet been
+//    analyzed since the last change to the text.
+//
+
+unsigned int HumdrumToken::getTextFlags(void) const {
+	if (m_textflags & TEXT_ANALYZED) {
+		return m_textflags;
+	}
+	unsigned int flags = TEXT_ANALYZED;
+	const string& tok = *this;
+	if ((tok == NULL_DATA) || (tok == NULL_INTERPRETATION) ||
+			(tok == NULL_COMMENT_LOCAL)) {
+		flags |= TEXT_NULL;
+	}
+	for (int i=0; i<(int)tok.size(); i++) {
+		switch (tok[i]) {
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				flags |= TEXT_PITCH;
+				break;
+			case 'r': flags |= TEXT_REST;         break;
+			case '_': flags |= TEXT_TIE_CONTINUE; break;
+			case ']': flags |= TEXT_TIE_CONTINUE; break;
+			case 'q': flags |= TEXT_GRACE;        break;
+			case ' ': flags |= TEXT_CHORD;        break;
+			case '(': flags |= TEXT_SLUR_START;   break;
+			case ')': flags |= TEXT_SLUR_END;     break;
+			case 'L': case 'J': case 'k': case 'K':
+				flags |= TEXT_BEAM;
+				break;
+		}
+	}
+	m_textflags = flags;
+	return flags;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeClass -- Return one of the DATATYPE_* values
+//    for the exclusive interpretation of the token's spine.
+//
+
+int HumdrumToken::getDataTypeClass(void) const {
+	int epoch = getDataTypeEpoch().load(std::memory_order_relaxed);
+	if (m_datatypeEpoch == epoch) {
+		return m_datatype;
+	}
+	const string& datatype = getDataType();
+	if (datatype == "**kern") {
+		m_datatype = DATATYPE_KERN;
+	} else if (datatype == "**mens") {
+		m_datatype = DATATYPE_MENS;
+	} else if (datatype == "**recip") {
+		m_datatype = DATATYPE_RECIP;
+	} else {
+		m_datatype = DATATYPE_OTHER;
+	}
+	m_datatypeEpoch = epoch;
+	return m_datatype;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::clearCachedState -- Forget the text flags and data type
+//    class of the token so that they will be recalculated when next needed.
+//
+
+void HumdrumToken::clearCachedState(void) {
+	m_textflags = 0;
+	m_datatypeEpoch = -1;
+	m_kernnotes.clear();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::invalidateDataTypes -- Force all tokens to look up their
+//    data type again.  Called when an exclusive interpretation is changed
+//    or when the spine starts of a file are rebuilt.
+//
+
+void HumdrumToken::invalidateDataTypes(void) {
+	getDataTypeEpoch().fetch_add(1, std::memory_order_relaxed);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getDataTypeEpoch -- Counter which is incremented by
+//    invalidateDataTypes().
+//
+
+std::atomic<int>& HumdrumToken::getDataTypeEpoch(void) {
+	static std::atomic<int> epoch(0);
+	return epoch;
 }
 
 
@@ -26076,6 +29686,120 @@ int HumdrumToken::getSubtokenCount(const string& separator) const {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::getKernNote -- Return the parsed contents of a **kern
+//    subtoken (a note or rest in a chord).  The text is parsed on the
+//    first call and the results are kept until the text of the token
+//    changes.  An empty record is returned if the index is out of range.
+//    The data type of the token is not checked.
+// default value: index = 0
+// @SEEALSO: getKernNoteCount
+//
+
+const KernNote& HumdrumToken::getKernNote(int index) const {
+	if (m_kernnotes.empty()) {
+		analyzeKernNotes();
+	}
+	if ((index < 0) || (index >= (int)m_kernnotes.size())) {
+		static const KernNote empty;
+		return empty;
+	}
+	return m_kernnotes[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getKernNoteCount -- Return the number of space-separated
+//    subtokens in the token, counted in the same way as getSubtokenCount().
+// @SEEALSO: getKernNote
+//
+
+int HumdrumToken::getKernNoteCount(void) const {
+	if (m_kernnotes.empty()) {
+		analyzeKernNotes();
+	}
+	return (int)m_kernnotes.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getKernNoteFlags -- Return the KernNote::NOTE_* flags of
+//    all subtokens combined, such as KernNote::NOTE_REST if any subtoken
+//    is a rest.
+// @SEEALSO: getKernNote
+//
+
+unsigned int HumdrumToken::getKernNoteFlags(void) const {
+	if (m_kernnotes.empty()) {
+		analyzeKernNotes();
+	}
+	unsigned int output = 0;
+	for (int i=0; i<(int)m_kernnotes.size(); i++) {
+		output |= m_kernnotes[i].getFlags();
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::getRecipDuration -- Return the duration in quarter notes
+//    of the rhythm in the first subtoken, or 0 if any subtoken is a grace
+//    note, with the same results as Convert::recipToDuration().  The
+//    parsed **kern notes are used if they are available, otherwise only
+//    the first subtoken is parsed and the results are not kept, so that
+//    rhythm analysis does not fill in the note cache of every token.
+//
+
+HumNum HumdrumToken::getRecipDuration(void) const {
+	if (getTextFlags() & TEXT_GRACE) {
+		return 0;
+	}
+	if (!m_kernnotes.empty()) {
+		return m_kernnotes[0].getDuration();
+	}
+	const char* text = this->c_str();
+	const char* space = strchr(text, ' ');
+	KernNote note(text, space ? (int)(space - text) : (int)this->size());
+	return note.getDuration();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::analyzeKernNotes -- Split the token on spaces and parse
+//    each subtoken into m_kernnotes.
+//
+
+void HumdrumToken::analyzeKernNotes(void) const {
+	const char* text = this->data();
+	int length = (int)this->size();
+	int count = 1;
+	for (int i=0; i<length; i++) {
+		if (text[i] == ' ') {
+			count++;
+		}
+	}
+	m_kernnotes.resize(count);
+	int start = 0;
+	int index = 0;
+	for (int i=0; i<=length; i++) {
+		if ((i == length) || (text[i] == ' ')) {
+			m_kernnotes[index++].parse(text + start, i - start);
+			start = i + 1;
+		}
+	}
+}
+
+
+
 /////////////////////////////
 //
 // HumdrumToken::getSubtoken -- Extract the specified sub-token from the token.
@@ -26209,11 +29933,31 @@ void HumdrumToken::setParameters(const string& pdata, HumdrumToken* ptok) {
 
 //////////////////////////////
 //
-// HumdrumToken::setText --
+// HumdrumToken::setText -- Change the text of the token.  If the token
+//    belongs to a HumdrumFile and the new text changes the duration of
+//    the token, whether or not it is null, or whether or not it is data
+//    or a spine manipulator, then the line is marked as edited so that
+//    HumdrumFile::reanalyzeEdits() can repair the analysis of the file.
 //
 
 void HumdrumToken::setText(const string& text) {
+	bool exinterp = isExclusiveInterpretation();
+	bool oldnull  = isNull();
+	bool oldmanip = isManipulator();
+	bool olddata  = isData();
 	string::assign(text);
+	clearCachedState();
+	if (exinterp || isExclusiveInterpretation()) {
+		invalidateDataTypes();
+	}
+	HumdrumLine* line = getOwner();
+	if (!line) {
+		return;
+	}
+	if ((olddata != isData()) || (oldnull != isNull()) || oldmanip ||
+			isManipulator() || hasStaleDuration()) {
+		line->markEdited();
+	}
 }
 
 
@@ -26292,6 +30036,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterCount(void) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 	return (int)m_linkedParameters.size();
 }
 
@@ -26308,6 +30053,7 @@ HumParamSet* HumdrumToken::getLinkedParameter(void) {
 
 
 HumParamSet* HumdrumToken::getLinkedParameter(int index) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 	return m_linkedParameters.at(index)->getLinkedParameter();
 }
 
@@ -26411,6 +30157,7 @@ string HumdrumToken::getVisualDurationNote(int subtokenindex) {
 
 std::string HumdrumToken::getLayoutParameter(const std::string& category,
 		const std::string& keyname, int subtokenindex) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 
 	// First check for any local layout parameter:
 	std::string testoutput = this->getValue("LO", category, keyname);
@@ -26500,6 +30247,7 @@ std::string HumdrumToken::getLayoutParameter(const std::string& category,
 
 std::string HumdrumToken::getSlurLayoutParameter(const std::string& keyname,
 		int subtokenindex) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 	std::string category = "S";
 	std::string output;
 
@@ -26573,6 +30321,7 @@ std::string HumdrumToken::getSlurLayoutParameter(const std::string& keyname,
 
 std::string HumdrumToken::getLayoutParameterChord(const std::string& category,
 		const std::string& keyname) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 
 	// First check for any local layout parameter:
 	std::string testoutput = this->getValue("LO", category, keyname);
@@ -26632,6 +30381,7 @@ std::string HumdrumToken::getLayoutParameterChord(const std::string& category,
 
 std::string HumdrumToken::getLayoutParameterNote(const std::string& category,
 		const std::string& keyname, int subtokenindex) {
+	checkAnalysis(ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS);
 
 	// First check for any local layout parameter:
 	std::string testoutput = this->getValue("LO", category, keyname);
@@ -26702,6 +30452,7 @@ std::string HumdrumToken::getLayoutParameterNote(const std::string& category,
 
 void HumdrumToken::setOwner(HumdrumLine* aLine) {
 	m_address.setOwner(aLine);
+	m_datatypeEpoch = -1;
 }
 
 
@@ -26737,6 +30488,7 @@ int HumdrumToken::getState(void) const {
 //
 
 int  HumdrumToken::getStrandIndex(void) const {
+	checkAnalysis(ANALYZE_STRANDS);
 	return m_strand;
 }
 
@@ -26814,6 +30566,9 @@ void HumdrumToken::incrementState(void) {
 //
 
 int HumdrumToken::getNextTokenCount(void) const {
+	if (m_nextTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return (int)m_nextTokens.size();
 }
 
@@ -26829,6 +30584,9 @@ int HumdrumToken::getNextTokenCount(void) const {
 //
 
 int HumdrumToken::getPreviousTokenCount(void) const {
+	if (m_previousTokens.empty()) {
+		checkAnalysis(ANALYZE_LINKS);
+	}
 	return (int)m_previousTokens.size();
 }
 
@@ -27195,6 +30953,7 @@ ostream& printSequence(vector<HTp>& sequence, ostream& out) {
 //
 
 HTp HumdrumToken::getSlurStartToken(int number) {
+	checkAnalysis(ANALYZE_SLURS);
 	string tag = "slurStart";
 	if (number > 1) {
 		tag += to_string(number);
@@ -27213,6 +30972,7 @@ HTp HumdrumToken::getSlurStartToken(int number) {
 //
 
 HTp HumdrumToken::getSlurEndToken(int number) {
+	checkAnalysis(ANALYZE_SLURS);
 	string tag = "slurEnd";
 	if (number > 1) {
 		tag += to_string(number);
@@ -27260,6 +31020,284 @@ void HumdrumToken::setNullResolution(HTp resolution) {
 
 
 
+//////////////////////////////
+//
+// KernNote::KernNote -- Constructor.  The default constructor gives the
+//    values for an empty subtoken.
+//
+
+KernNote::KernNote(void) {
+	parse("", 0);
+}
+
+
+KernNote::KernNote(const char* text, int length) {
+	parse(text, length);
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::parse -- Extract the pitch, rhythm and markers from the text
+//    of a single **kern subtoken (which should not contain spaces) in
+//    one pass.  The rules follow those of Convert::kernToDiatonicPC(),
+//    Convert::kernToOctaveNumber(), Convert::recipToDuration() and the
+//    related functions so that results are the same as calling them
+//    individually on the subtoken.
+//
+
+void KernNote::parse(const char* text, int length) {
+	m_diatonic   = -2000;
+	m_letter     = 'X';
+	m_accidental = 0;
+	m_flags      = 0;
+	m_stem       = '\0';
+
+	int  uc        = 0;     // count of uppercase pitch letters
+	int  lc        = 0;     // count of lowercase pitch letters
+	int  dots      = 0;
+	bool hasrhythm = false; // found first digit
+	bool innumber  = false; // still reading the first number
+	int  number    = 0;     // value of the first number
+	int  zeros     = 0;     // leading zeros of the first number
+	bool inzeros   = false;
+	bool hasrecip  = false; // found "%"
+	bool innumer   = false; // reading the number after "%"
+	int  numer     = 1;     // value of the number after "%"
+
+	for (int i=0; i<length; i++) {
+		char ch = text[i];
+
+		if (innumber) {
+			if (isdigit(ch)) {
+				number = number * 10 + (ch - '0');
+				if (inzeros && (ch == '0')) {
+					zeros++;
+				} else {
+					inzeros = false;
+				}
+			} else {
+				innumber = false;
+				inzeros = false;
+			}
+		} else if (!hasrhythm && isdigit(ch)) {
+			hasrhythm = true;
+			innumber  = true;
+			number    = ch - '0';
+			inzeros   = (ch == '0');
+			zeros     = inzeros ? 1 : 0;
+		}
+		if (innumer) {
+			if (isdigit(ch)) {
+				numer = numer * 10 + (ch - '0');
+			} else {
+				innumer = false;
+			}
+		}
+
+		switch (ch) {
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+				lc++;
+				m_flags |= NOTE_PITCH;
+				if (m_diatonic == -2000) {
+					m_letter = toupper(ch);
+					m_diatonic = (ch - 'a' + 5) % 7;
+				}
+				break;
+			case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+				uc++;
+				m_flags |= NOTE_PITCH;
+				if (m_diatonic == -2000) {
+					m_letter = ch;
+					m_diatonic = (ch - 'A' + 5) % 7;
+				}
+				break;
+			case 'r':
+				m_flags |= NOTE_REST;
+				if (m_diatonic == -2000) {
+					m_letter = 'R';
+					m_diatonic = -1000;
+				}
+				break;
+			case '-':  m_accidental--;                 break;
+			case '#':  m_accidental++;                 break;
+			case '.':  dots++;                         break;
+			case '[':  m_flags |= NOTE_TIE_START;      break;
+			case '_':  m_flags |= NOTE_TIE_CONTINUE;   break;
+			case ']':  m_flags |= NOTE_TIE_END;        break;
+			case '(':  m_flags |= NOTE_SLUR_START;     break;
+			case ')':  m_flags |= NOTE_SLUR_END;       break;
+			case 'L':  m_flags |= NOTE_BEAM_START;     break;
+			case 'J':  m_flags |= NOTE_BEAM_END;       break;
+			case 'k':  m_flags |= NOTE_BEAM_PARTIAL;   break;
+			case 'K':  m_flags |= NOTE_BEAM_PARTIAL;   break;
+			case 'q':  m_flags |= NOTE_GRACE;          break;
+			case '\'': m_flags |= NOTE_STACCATO;       break;
+			case '`':  m_flags |= NOTE_STACCATISSIMO;  break;
+			case '^':  m_flags |= NOTE_ACCENT;         break;
+			case '~':  m_flags |= NOTE_TENUTO;         break;
+			case ';':  m_flags |= NOTE_FERMATA;        break;
+			case 'n':  m_flags |= NOTE_NATURAL;        break;
+			case '/':
+			case '\\':
+				if (m_stem == '\0') {
+					m_stem = ch;
+				}
+				break;
+			case '%':
+				if (!hasrecip) {
+					hasrecip = true;
+					if ((i + 1 < length) && isdigit(text[i+1])) {
+						innumer = true;
+						numer = 0;
+					}
+				}
+				break;
+		}
+	}
+
+	// octave (see Convert::kernToOctaveNumber):
+	if ((m_flags & NOTE_REST) || ((uc > 0) && (lc > 0))) {
+		m_octave = -1000;
+	} else if (uc > 0) {
+		m_octave = 4 - uc;
+	} else if (lc > 0) {
+		m_octave = 3 + lc;
+	} else {
+		m_octave = -1000;
+	}
+
+	// base-40 pitch (see Convert::kernToBase40):
+	m_base40 = getBase40PC();
+	if (m_base40 >= 0) {
+		m_base40 += 40 * m_octave;
+	}
+
+	// rhythm (see Convert::recipToDuration):
+	m_dots = (unsigned char)(dots > 255 ? 255 : dots);
+	HumNum output;
+	if (hasrecip && hasrhythm) {
+		output.setValue(numer, number);
+	} else if (!hasrhythm) {
+		output = 0;
+	} else if (zeros > 0) {
+		output.setValue(1 << zeros, 1);
+	} else {
+		output.setValue(1, number);
+	}
+	if (hasrhythm && (dots > 0)) {
+		HumNum factor((1 << (dots + 1)) - 1, 1 << dots);
+		output *= factor;
+	}
+	m_visual = output * 4;
+	if (m_flags & NOTE_GRACE) {
+		m_duration = 0;
+	} else {
+		m_duration = m_visual;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::isSecondaryTiedNote -- True if a note with a tie continuation
+//    or tie end marker.
+//
+
+bool KernNote::isSecondaryTiedNote(void) const {
+	if (!(m_flags & NOTE_PITCH)) {
+		return false;
+	}
+	return (m_flags & (NOTE_TIE_CONTINUE | NOTE_TIE_END)) ? true : false;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getDiatonicLC -- Lowercase diatonic letter, 'r' for rests,
+//    or 'x' if there is no pitch.
+//
+
+char KernNote::getDiatonicLC(void) const {
+	return tolower(m_letter);
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase40PC -- Base-40 pitch class, or the diatonic value if
+//    it is negative.
+//
+
+int KernNote::getBase40PC(void) const {
+	if (m_diatonic < 0) {
+		return m_diatonic;
+	}
+	static const int b40[7] = { 0, 6, 12, 17, 23, 29, 35 };
+	return b40[m_diatonic] + m_accidental + 2;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase12PC -- Base-12 pitch class, or the diatonic value if
+//    it is negative.
+//
+
+int KernNote::getBase12PC(void) const {
+	if (m_diatonic < 0) {
+		return m_diatonic;
+	}
+	static const int b12[7] = { 0, 2, 4, 5, 7, 9, 11 };
+	return b12[m_diatonic] + m_accidental;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase12 -- Base-12 pitch (middle C = 48).
+//
+
+int KernNote::getBase12(void) const {
+	return getBase12PC() + 12 * m_octave;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getBase7 -- Diatonic pitch (middle C = 28), or the diatonic
+//    value if it is negative.
+//
+
+int KernNote::getBase7(void) const {
+	if (m_diatonic < 0) {
+		return m_diatonic;
+	}
+	return m_diatonic + 7 * m_octave;
+}
+
+
+
+//////////////////////////////
+//
+// KernNote::getMidiNoteNumber -- MIDI key number (middle C = 60).
+//
+
+int KernNote::getMidiNoteNumber(void) const {
+	return getBase12PC() + 12 * (m_octave + 1);
+}
+
+
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // MuseEventSet class functions --
@@ -38524,83 +42562,15 @@ string MxmlPart::cleanSpaces(const string& input) {
 
 //////////////////////////////
 //
-// NoteCell::NoteCell -- Constructor.
+// NoteCell::NoteCell -- Constructor.  The pitch and attack data for
+//    the cell are stored in the owner's arrays at the given index.
 //
 
-NoteCell::NoteCell(NoteGrid* owner, HTp token) {
-	clear();
+NoteCell::NoteCell(NoteGrid* owner, int index, int voice, int slice) {
 	m_owner = owner;
-	m_token = token;
-	calculateNumericPitches();
-}
-
-
-
-//////////////////////////////
-//
-// NoteCell::clear -- Clear the contents of the object.
-//
-
-void NoteCell::clear(void) {
-	m_owner = NULL;
-	m_token = NULL;
-	m_b7  = 0;
-	m_b12 = 0;
-	m_b40 = 0;
-	m_accidental = 0;
-	m_nextAttackIndex = -1;
-	m_prevAttackIndex = -1;
-	m_currAttackIndex = -1;
-	m_timeslice = -1;
-	m_voice = -1;
-}
-
-
-
-//////////////////////////////
-//
-// NoteCell::calculateNumericPitches -- Fills in b7, b12, and b40 variables.
-//    0 = rest, negative values for sustained notes.
-//
-
-void NoteCell::calculateNumericPitches(void) {
-	if (!m_token) {
-		m_b40        = NAN;
-		m_b12        = NAN;
-		m_b7         = NAN;
-		m_accidental = NAN;
-		return;
-	}
-
-	bool sustain = m_token->isNull() || m_token->isSecondaryTiedNote();
-	if (m_token->isRest()) {
-		m_b40 = NAN;
-	} else {
-		HTp resolve = m_token->resolveNull();
-		if (resolve->isRest()) {
-			m_b40 = NAN;
-		} else if (resolve->isNull()) {
-			m_b40 = NAN;
-		} else {
-			m_b40 = Convert::kernToBase40(resolve);
-			m_b40 = (sustain ? -m_b40 : m_b40);
-		}
-	}
-
-	// convert to base-7 (diatonic pitch numbers)
-	if (m_b40 > 0) {
-		m_b7         = Convert::base40ToDiatonic((int)m_b40);
-		m_b12        = Convert::base40ToMidiNoteNumber((int)m_b40);
-		m_accidental = Convert::base40ToAccidental((int)m_b40);
-	} else if (m_b40 < 0) {
-		m_b7         = -Convert::base40ToDiatonic(-(int)m_b40);
-		m_b12        = -Convert::base40ToMidiNoteNumber(-(int)m_b40);
-		m_accidental = -Convert::base40ToAccidental(-(int)m_b40);
-	} else {
-		m_b7         = NAN;
-		m_b12        = NAN;
-		m_accidental = NAN;
-	}
+	m_index = index;
+	m_voice = voice;
+	m_timeslice = slice;
 }
 
 
@@ -38647,13 +42617,14 @@ string NoteCell::getAbsKernPitch(void) {
 //
 
 bool NoteCell::isSustained(void) {
-	if (m_b40 < 0) {
+	int b40 = m_owner->m_b40[m_index];
+	if (b40 < 0) {
 		return true;
-	} else if (m_b40 > 0) {
+	} else if (b40 > 0) {
 		return false;
 	}
 	// calculate if rest is a "sustain" or an "attack"
-	if (m_currAttackIndex == m_timeslice) {
+	if (getCurrAttackIndex() == m_timeslice) {
 		return false;
 	} else {
 		return true;
@@ -38689,10 +42660,11 @@ double NoteCell::operator-(int B) {
 //
 
 int NoteCell::getLineIndex(void) {
-	if (!m_token) {
+	HTp token = getToken();
+	if (!token) {
 		return -1;
 	}
-	return m_token->getLineIndex();
+	return token->getLineIndex();
 }
 
 
@@ -38704,10 +42676,11 @@ int NoteCell::getLineIndex(void) {
 //
 
 int NoteCell::getFieldIndex(void) {
-	if (!m_token) {
+	HTp token = getToken();
+	if (!token) {
 		return -1;
 	}
-	return m_token->getFieldIndex();
+	return token->getFieldIndex();
 }
 
 
@@ -38742,9 +42715,6 @@ double NoteCell::getDiatonicIntervalFromPreviousAttack(void) {
 	if (previ < 0) {
 		return NAN;
 	}
-	if (!m_owner) {
-		return NAN;
-	}
 	return getAbsDiatonicPitch()
 			- m_owner->cell(m_voice,previ)->getAbsDiatonicPitch();
 }
@@ -38761,36 +42731,18 @@ double NoteCell::getDiatonicIntervalToNextAttack(void) {
 	if (nexti < 0) {
 		return NAN;
 	}
-	if (!m_owner) {
-		return NAN;
-	}
 	return m_owner->cell(m_voice,nexti)->getAbsDiatonicPitch()
 			- getAbsDiatonicPitch();
 }
 
 
 
-//////////////////////////////
-//
-// NoteCell::isRest --
-//
-
-bool NoteCell::isRest(void) {
-	// bug in GCC requires :: prefix to resolve two different isnan() defs.
-	return Convert::isNaN(m_b40);
-}
-
-
-
 //////////////////////////////
 //
 // NoteCell::getMetricLevel --
 //
 
 double NoteCell::getMetricLevel(void) {
-	if (!m_owner) {
-		return NAN;
-	}
 	return m_owner->getMetricLevel(getLineIndex());
 }
 
@@ -38802,8 +42754,9 @@ double NoteCell::getMetricLevel(void) {
 //
 
 HumNum NoteCell::getDurationFromStart(void) {
-	if (m_token) {
-		return m_token->getDurationFromStart();
+	HTp token = getToken();
+	if (token) {
+		return token->getDurationFromStart();
 	} else {
 		return -1;
 	}
@@ -38817,33 +42770,18 @@ HumNum NoteCell::getDurationFromStart(void) {
 //
 
 HumNum NoteCell::getDuration(void) {
-	if (!m_owner) {
-		return Convert::recipToDuration(m_token);
-	}
 	return m_owner->getNoteDuration(getVoiceIndex(), getSliceIndex());
 }
 
 
 
-//////////////////////////////
-//
-// NoteCell::setMeter --
-//
-
-void NoteCell::setMeter(int topval, HumNum botval) {
-	m_metertop = topval;
-	m_meterbot = botval;
-}
-
-
-
 //////////////////////////////
 //
 // NoteCell::getMeterTop --
 //
 
 int NoteCell::getMeterTop(void) {
-	return m_metertop;
+	return m_owner->m_metertops[m_index];
 }
 
 
@@ -38854,7 +42792,7 @@ int NoteCell::getMeterTop(void) {
 //
 
 HumNum NoteCell::getMeterBottom(void) {
-	return m_meterbot;
+	return m_owner->m_meterbots[m_index];
 }
 
 
@@ -38865,12 +42803,14 @@ HumNum NoteCell::getMeterBottom(void) {
 //
 
 double NoteCell::getSgnDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) {
 		return GRIDREST;
-	} else if (m_b7 < 0) {
-		return -(double)(((int)-m_b7) % 7);
+	}
+	int b7 = m_owner->m_b7[m_index];
+	if (b7 < 0) {
+		return -(double)(-b7 % 7);
 	} else {
-		return (double)(((int)m_b7) % 7);
+		return (double)(b7 % 7);
 	}
 }
 
@@ -38882,10 +42822,10 @@ double NoteCell::getSgnDiatonicPitchClass(void) {
 //
 
 double NoteCell::getAbsDiatonicPitchClass(void) {
-	if (Convert::isNaN(m_b7)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_NOPITCH) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b7)) % 7);
+		return (double)(abs(m_owner->m_b7[m_index]) % 7);
 	}
 }
 
@@ -38897,12 +42837,14 @@ double NoteCell::getAbsDiatonicPitchClass(void) {
 //
 
 double NoteCell::getSgnBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) {
 		return GRIDREST;
-	} else if (m_b40 < 0) {
-		return -(double)(((int)-m_b40) % 40);
+	}
+	int b40 = m_owner->m_b40[m_index];
+	if (b40 < 0) {
+		return -(double)(-b40 % 40);
 	} else {
-		return (double)(((int)m_b40) % 40);
+		return (double)(b40 % 40);
 	}
 }
 
@@ -38914,24 +42856,11 @@ double NoteCell::getSgnBase40PitchClass(void) {
 //
 
 double NoteCell::getAbsBase40PitchClass(void) {
-	if (Convert::isNaN(m_b40)) {
+	if (m_owner->m_flags[m_index] & NoteGrid::CELL_REST) {
 		return GRIDREST;
 	} else {
-		return (double)(((int)fabs(m_b40)) % 40);
-	}
-}
-
-
-//////////////////////////////
-//
-// NoteCell::isAttack --
-//
-
-bool NoteCell::isAttack(void) {
-	if (Convert::isNaN(m_b40)) {
-		return false;
+		return (double)(abs(m_owner->m_b40[m_index]) % 40);
 	}
-	return m_b40>0? true:false;
 }
 
 
@@ -38967,19 +42896,23 @@ NoteGrid::~NoteGrid() {
 void NoteGrid::clear(void) {
 	m_infile = NULL;
 	m_kernspines.clear();
+	m_metriclevels.clear();
 
-	vector<vector<NoteCell* > >& grid = m_grid;
-	for (int i=0; i<(int)grid.size(); i++) {
-		for (int j=0; j<(int)grid[i].size(); j++) {
-			if (grid[i][j]) {
-				grid[i][j]->clear();
-				delete grid[i][j];
-				grid[i][j] = NULL;
-			}
-		}
-		grid[i].clear();
-	}
-	grid.clear();
+	m_cells.clear();
+	m_tokens.clear();
+	m_b7.clear();
+	m_b12.clear();
+	m_b40.clear();
+	m_accidental.clear();
+	m_flags.clear();
+	m_prevattack.clear();
+	m_currattack.clear();
+	m_nextattack.clear();
+	m_durations.clear();
+	m_metertops.clear();
+	m_meterbots.clear();
+	m_voices = 0;
+	m_slices = 0;
 }
 
 
@@ -38990,7 +42923,7 @@ void NoteGrid::clear(void) {
 //
 
 int NoteGrid::getVoiceCount(void) {
-	return (int)m_grid.size();
+	return m_voices;
 }
 
 
@@ -39002,11 +42935,7 @@ int NoteGrid::getVoiceCount(void) {
 //
 
 int NoteGrid::getSliceCount(void) {
-	if (m_grid.size() == 0) {
-		return 0;
-	} else {
-		return (int)m_grid[0].size();
-	}
+	return m_slices;
 }
 
 
@@ -39035,16 +42964,22 @@ bool NoteGrid::load(HumdrumFile& infile) {
 		return false;
 	}
 
-	vector<vector<NoteCell* > >& grid = m_grid;
-	grid.resize(kernspines.size());
-	for (int i=0; i<(int)grid.size(); i++) {
-		grid[i].reserve(infile.getLineCount());
-	}
+	// The cells are collected one slice at a time, and then stored
+	// by voice after all slices are known.
+	int voices = (int)kernspines.size();
+	vector<HTp> slicetokens;
+	vector<int> slicetops;
+	vector<HumNum> slicebots;
+	slicetokens.reserve(voices * infile.getLineCount());
 
 	int attack = 0;
 	int track, lasttrack;
 	vector<HTp> current;
-	HumRegex hre;
+	bool status = true;
+	HumRegex hrerecip;
+	hrerecip.compile("\\*M(\\d+)/(\\d+)%(\\d+)");
+	HumRegex hremeter;
+	hremeter.compile("\\*M(\\d+)/(\\d+)");
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (infile[i].isInterpretation()) {
 			for (int j=0; j<infile[i].getFieldCount(); j++) {
@@ -39052,13 +42987,13 @@ bool NoteGrid::load(HumdrumFile& infile) {
 					continue;
 				}
 				track = infile.token(i, j)->getTrack();
-				if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)%(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-					meterbots[track] /= hre.getMatchInt(3);
-				} else if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
+				if (hrerecip.search(*infile.token(i, j))) {
+					metertops[track] = hrerecip.getMatchInt(1);
+					meterbots[track] = hrerecip.getMatchInt(2);
+					meterbots[track] /= hrerecip.getMatchInt(3);
+				} else if (hremeter.search(*infile.token(i, j))) {
+					metertops[track] = hremeter.getMatchInt(1);
+					meterbots[track] = hremeter.getMatchInt(2);
 				} else {
 					continue;
 				}
@@ -39090,21 +43025,56 @@ bool NoteGrid::load(HumdrumFile& infile) {
 		if (current.size() != kernspines.size()) {
 			cerr << "Error: Unequal vector sizes " << current.size()
 			     << " compared to " << kernspines.size() << endl;
-			return false;
+			// Keep the slices read so far (without attack indexes).
+			status = false;
+			break;
 		}
 		for (int j=0; j<(int)current.size(); j++) {
-			NoteCell* cell = new NoteCell(this, current[j]);
 			track = current[j]->getTrack();
-			cell->setVoiceIndex(j);
-			cell->setSliceIndex((int)grid[j].size());
-			cell->setMeter(metertops[track], meterbots[track]);
-			grid[j].push_back(cell);
+			slicetokens.push_back(current[j]);
+			slicetops.push_back(metertops[track]);
+			slicebots.push_back(meterbots[track]);
 		}
 	}
 
-	buildAttackIndexes();
+	m_voices = voices;
+	m_slices = (int)slicetokens.size() / voices;
+	int size = m_voices * m_slices;
+	m_tokens.resize(size);
+	m_metertops.resize(size);
+	m_meterbots.resize(size);
+	for (int v=0; v<m_voices; v++) {
+		for (int s=0; s<m_slices; s++) {
+			int index = v * m_slices + s;
+			int sindex = s * m_voices + v;
+			m_tokens[index] = slicetokens[sindex];
+			m_metertops[index] = slicetops[sindex];
+			m_meterbots[index] = slicebots[sindex];
+		}
+	}
 
-	return true;
+	m_b7.resize(size);
+	m_b12.resize(size);
+	m_b40.resize(size);
+	m_accidental.resize(size);
+	m_flags.resize(size);
+	m_prevattack.assign(size, -1);
+	m_currattack.assign(size, -1);
+	m_nextattack.assign(size, -1);
+	m_cells.reserve(size);
+	for (int v=0; v<m_voices; v++) {
+		for (int s=0; s<m_slices; s++) {
+			int index = v * m_slices + s;
+			m_cells.emplace_back(this, index, v, s);
+			calculateNumericPitches(index);
+		}
+	}
+
+	if (status) {
+		buildAttackIndexes();
+	}
+
+	return status;
 }
 
 
@@ -39115,7 +43085,50 @@ bool NoteGrid::load(HumdrumFile& infile) {
 //
 
 NoteCell* NoteGrid::cell(int voiceindex, int sliceindex) {
-	return m_grid.at(voiceindex).at(sliceindex);
+	return &m_cells[getIndex(voiceindex, sliceindex)];
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::calculateNumericPitches -- Fills in the diatonic, MIDI and
+//    base-40 pitches of a cell.  Values are negative for sustained notes.
+//    Rests are marked with CELL_REST and CELL_NOPITCH, and unpitched
+//    notes with CELL_NOPITCH.
+//
+
+void NoteGrid::calculateNumericPitches(int index) {
+	HTp token = m_tokens[index];
+	int b40 = 0;
+	bool rest = true;
+	if (token && !token->isRest()) {
+		bool sustain = token->isNull() || token->isSecondaryTiedNote();
+		HTp resolve = token->resolveNull();
+		if (!(resolve->isRest() || resolve->isNull())) {
+			b40 = Convert::kernToBase40(resolve);
+			b40 = (sustain ? -b40 : b40);
+			rest = false;
+		}
+	}
+
+	m_flags[index] = rest ? (CELL_REST | CELL_NOPITCH) : 0;
+	// convert to base-7 (diatonic pitch numbers)
+	if (b40 > 0) {
+		m_b7[index]         = Convert::base40ToDiatonic(b40);
+		m_b12[index]        = Convert::base40ToMidiNoteNumber(b40);
+		m_accidental[index] = Convert::base40ToAccidental(b40);
+	} else if (b40 < 0) {
+		m_b7[index]         = -Convert::base40ToDiatonic(-b40);
+		m_b12[index]        = -Convert::base40ToMidiNoteNumber(-b40);
+		m_accidental[index] = -Convert::base40ToAccidental(-b40);
+	} else {
+		m_b7[index]         = 0;
+		m_b12[index]        = 0;
+		m_accidental[index] = 0;
+		m_flags[index]     |= CELL_NOPITCH;
+	}
+	m_b40[index] = b40;
 }
 
 
@@ -39223,7 +43236,7 @@ void NoteGrid::printKernGrid(ostream& output) {
 //
 
 void NoteGrid::buildAttackIndexes(void) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
+	for (int i=0; i<m_voices; i++) {
 		buildAttackIndex(i);
 	}
 }
@@ -39237,7 +43250,13 @@ void NoteGrid::buildAttackIndexes(void) {
 //
 
 void NoteGrid::buildAttackIndex(int vindex) {
-	vector<NoteCell*>& part = m_grid[vindex];
+	int count = m_slices;
+	int base = vindex * m_slices;
+	NoteCell* part = m_cells.data() + base;
+	HTp* tokens = m_tokens.data() + base;
+	int* curr = m_currattack.data() + base;
+	int* prev = m_prevattack.data() + base;
+	int* next = m_nextattack.data() + base;
 
 	// Set the slice index for the attack of the current note.  This
 	// will be the same as the current slice if the NoteCell is an attack.
@@ -39246,46 +43265,46 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	// For rests, the first rest in a continuous sequence of rests
 	// will be marked as the "attack" of the rest.
 	NoteCell* currentcell = NULL;
-	for (int i=0; i<(int)part.size(); i++) {
+	for (int i=0; i<count; i++) {
 		if (i == 0) {
-			part[0]->setCurrAttackIndex(0);
+			curr[0] = 0;
 			continue;
 		}
-		if (part[i]->isRest()) {
+		if (part[i].isRest()) {
 			// This is a rest, so check for a rest sustain or start
 			// of a rest sequence.
-			if (part[i-1]->isRest()) {
+			if (part[i-1].isRest()) {
 				// rest "sustain"
-				if (currentcell && !part[i]->getToken()->isNull()) {
-					currentcell->m_tiedtokens.push_back(part[i]->getToken());
+				if (currentcell && !tokens[i]->isNull()) {
+					currentcell->m_tiedtokens.push_back(tokens[i]);
 				}
-				part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
+				curr[i] = curr[i-1];
 			} else {
 				// rest "attack";
-				part[i]->setCurrAttackIndex(i);
+				curr[i] = i;
 			}
-		} else if (part[i]->isAttack()) {
-			part[i]->setCurrAttackIndex(i);
-			currentcell = part[i];
+		} else if (part[i].isAttack()) {
+			curr[i] = i;
+			currentcell = &part[i];
 		} else {
 			// This is a sustain, so get the attack index of the
 			// note from the previous slice index.
-			part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			if (currentcell && !part[i]->getToken()->isNull()) {
-				currentcell->m_tiedtokens.push_back(part[i]->getToken());
+			curr[i] = curr[i-1];
+			if (currentcell && !tokens[i]->isNull()) {
+				currentcell->m_tiedtokens.push_back(tokens[i]);
 			}
 		}
 	}
 
 	// start with note attacks marked in the previous and next note slots:
-	for (int i=0; i<(int)part.size(); i++) {
-		if (part[i]->isAttack()) {
-			part[i]->setNextAttackIndex(i);
-			part[i]->setPrevAttackIndex(i);
-		} else if (part[i]->isRest()) {
-			if (part[i]->getCurrAttackIndex() == i) {
-				part[i]->setNextAttackIndex(i);
-				part[i]->setPrevAttackIndex(i);
+	for (int i=0; i<count; i++) {
+		if (part[i].isAttack()) {
+			next[i] = i;
+			prev[i] = i;
+		} else if (part[i].isRest()) {
+			if (curr[i] == i) {
+				next[i] = i;
+				prev[i] = i;
 			}
 		}
 	}
@@ -39293,27 +43312,27 @@ void NoteGrid::buildAttackIndex(int vindex) {
 	// Go back and adjust the next note attack index:
 	int value = -1;
 	int temp  = -1;
-	for (int i=(int)part.size()-1; i>=0; i--) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getNextAttackIndex();
-			part[i]->setNextAttackIndex(value);
+	for (int i=count-1; i>=0; i--) {
+		if (!part[i].isSustained()) {
+			temp = next[i];
+			next[i] = value;
 			value = temp;
 		} else {
-			part[i]->setNextAttackIndex(value);
+			next[i] = value;
 		}
 	}
 
 	// Go back and adjust the previous note attack index:
 	value = -1;
 	temp  = -1;
-	for (int i=0; i<(int)part.size(); i++) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getPrevAttackIndex();
-			part[i]->setPrevAttackIndex(value);
+	for (int i=0; i<count; i++) {
+		if (!part[i].isSustained()) {
+			temp = prev[i];
+			prev[i] = value;
 			value = temp;
 		} else {
 			if (i != 0) {
-				part[i]->setPrevAttackIndex(part[i-1]->getPrevAttackIndex());
+				prev[i] = prev[i-1];
 			}
 		}
 	}
@@ -39329,7 +43348,7 @@ void NoteGrid::buildAttackIndex(int vindex) {
 //
 
 double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsDiatonicPitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsDiatonicPitch();
 }
 
 
@@ -39341,7 +43360,7 @@ double NoteGrid::getAbsDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnDiatonicPitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnDiatonicPitch();
 }
 
 
@@ -39353,7 +43372,7 @@ double NoteGrid::getSgnDiatonicPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsMidiPitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsMidiPitch();
 }
 
 
@@ -39365,7 +43384,7 @@ double NoteGrid::getAbsMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnMidiPitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnMidiPitch();
 }
 
 
@@ -39377,7 +43396,7 @@ double NoteGrid::getSgnMidiPitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsBase40Pitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsBase40Pitch();
 }
 
 
@@ -39389,7 +43408,7 @@ double NoteGrid::getAbsBase40Pitch(int vindex, int sindex) {
 //
 
 double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnBase40Pitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnBase40Pitch();
 }
 
 
@@ -39401,7 +43420,7 @@ double NoteGrid::getSgnBase40Pitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getAbsKernPitch();
+	return m_cells[getIndex(vindex, sindex)].getAbsKernPitch();
 }
 
 
@@ -39413,7 +43432,7 @@ string NoteGrid::getAbsKernPitch(int vindex, int sindex) {
 //
 
 string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getSgnKernPitch();
+	return m_cells[getIndex(vindex, sindex)].getSgnKernPitch();
 }
 
 
@@ -39425,7 +43444,7 @@ string NoteGrid::getSgnKernPitch(int vindex, int sindex) {
 //
 
 HTp NoteGrid::getToken(int vindex, int sindex) {
-	return m_grid.at(vindex).at(sindex)->getToken();
+	return m_cells[getIndex(vindex, sindex)].getToken();
 }
 
 
@@ -39439,8 +43458,7 @@ HTp NoteGrid::getToken(int vindex, int sindex) {
 //
 
 int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getPrevAttackIndex();
+	int index = m_prevattack[getIndex(vindex, sindex)];
 	if (index < 0) {
 		return 0;
 	} else {
@@ -39459,8 +43477,7 @@ int NoteGrid::getPrevAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
-	NoteCell*& cell = m_grid.at(vindex).at(sindex);
-	int index = cell->getNextAttackIndex();
+	int index = m_nextattack[getIndex(vindex, sindex)];
 	if (index < 0) {
 		return 0;
 	} else {
@@ -39477,10 +43494,10 @@ int NoteGrid::getNextAttackDiatonic(int vindex, int sindex) {
 //
 
 int NoteGrid::getLineIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_voices == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getLineIndex();
+	return m_tokens[getIndex(0, sindex)]->getLineIndex();
 }
 
 
@@ -39492,10 +43509,10 @@ int NoteGrid::getLineIndex(int sindex) {
 //
 
 int NoteGrid::getFieldIndex(int sindex) {
-	if (m_grid.size() == 0) {
+	if (m_voices == 0) {
 		return -1;
 	}
-	return m_grid.at(0).at(sindex)->getToken()->getFieldIndex();
+	return m_tokens[getIndex(0, sindex)]->getFieldIndex();
 }
 
 
@@ -39559,18 +43576,44 @@ double NoteGrid::getMetricLevel(int sindex) {
 //
 
 HumNum NoteGrid::getNoteDuration(int vindex, int sindex) {
-	NoteCell* curnote = cell(vindex, sindex);
-	int attacki = curnote->getCurrAttackIndex();
-	int nexti   = curnote->getNextAttackIndex();
-	HumNum starttime = 0;
-	if (attacki >= 0) {
-		starttime = cell(vindex, attacki)->getDurationFromStart();
+	int index = getIndex(vindex, sindex);
+	if (m_durations.empty()) {
+		buildDurations();
+	}
+	return m_durations[index];
+}
+
+
+
+//////////////////////////////
+//
+// NoteGrid::buildDurations -- Calculate the duration of the note (or
+//     rest) in each cell, from its attack to the next note attack in
+//     the voice (or to the end of the score).
+//
+
+void NoteGrid::buildDurations(void) {
+	// Time of each slice in the score (the same for all voices).
+	vector<HumNum> slicetimes(m_slices);
+	for (int s=0; s<m_slices; s++) {
+		slicetimes[s] = m_tokens[s]->getDurationFromStart();
 	}
-	HumNum endtime = m_infile->getScoreDuration();;
-	if (nexti >= 0) {
-		endtime = cell(vindex, nexti)->getDurationFromStart();
+	HumNum scoreduration = m_infile->getScoreDuration();
+
+	m_durations.resize(m_voices * m_slices);
+	for (int i=0; i<(int)m_durations.size(); i++) {
+		int attacki = m_currattack[i];
+		int nexti   = m_nextattack[i];
+		HumNum starttime = 0;
+		if (attacki >= 0) {
+			starttime = slicetimes[attacki];
+		}
+		HumNum endtime = scoreduration;
+		if (nexti >= 0) {
+			endtime = slicetimes[nexti];
+		}
+		m_durations[i] = endtime - starttime;
 	}
-	return endtime - starttime;
 }
 
 
@@ -40898,6 +44941,8 @@ Tool_autobeam::Tool_autobeam(void) {
 	define("l|lyric|lyrics=b",     "break beam by lyric syllables");
 	define("L|lyric-info=b",       "return the number of breaks needed");
 	define("rest|include-rests=b", "include rests in beam edges");
+
+	allowParallelSegments();
 }
 
 
@@ -41816,6 +45861,8 @@ Tool_autostem::Tool_autostem(void) {
 	define("version=b",       "Program version");
 	define("example=b",       "Program examples");
 	define("h|help=b",        "Short description");
+
+	allowParallelSegments();
 }
 
 
@@ -42036,7 +46083,7 @@ void Tool_autostem::setStemDirection(HumdrumFile& infile, int row, int col,
 	if (notlongQ) {
 		// Don't print stems on whole notes and breves.
 		// Duration units are in quarter notes.
-		HumNum value = Convert::recipToDuration(*infile.token(row,col));
+		HumNum value = Convert::recipToDuration(infile.token(row,col));
 		double duration = value.getFloat();
 		if ((duration >= 4.0) && (duration < 16.0)) {
 			return;
@@ -42632,7 +46679,7 @@ void Tool_autostem::processKernTokenStemsSimpleModel(HumdrumFile& infile,
 
 	HumNum duration;
 	if (tokencount == 1) {
-		duration = Convert::recipToDuration(*infile.token(i, j));
+		duration = Convert::recipToDuration(infile.token(i, j));
 		if (duration >= 4) {
 			// whole note or larger for note/chord, to not append a stem
 			return;
@@ -42915,7 +46962,7 @@ void Tool_autostem::getBeamState(vector<vector<string > >& beams,
 				// rests if beams extend over rests...
 				continue;
 			}
-			rn = Convert::recipToDuration(*infile.token(i, j));
+			rn = Convert::recipToDuration(infile.token(i, j));
 			if (rn >= 1) {
 				beamstate[track][curlayer[track]] = 0;
 				continue;
@@ -43058,6 +47105,8 @@ void Tool_autostem::countBeamStuff(const string& token, int& start, int& stop,
 Tool_binroll::Tool_binroll(void) {
 	// add options here
 	define("t|timebase=s:16", "timebase to do analysis at");
+
+	allowParallelSegments();
 }
 
 
@@ -43116,6 +47165,7 @@ void Tool_binroll::processFile(HumdrumFile& infile) {
 	vector<vector<char>> output;
 	output.resize(128);
 	int count = (infile.getScoreDuration() / m_duration).getInteger() + 1;
+	m_tpq = infile.tpq();
 	for (int i=0; i<(int)output.size(); i++) {
 		output[i].resize(count);
 		std::fill(output[i].begin(), output[i].end(), 0);
@@ -43216,6 +47266,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 	int base12;
 	HumNum starttime;
 	HumNum duration;
+	long long startticks;
 	int startindex;
 	int endindex;
 	while (current && (current != ending)) {
@@ -43231,7 +47282,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 		if (current->isChord()) {
 			int stcount = current->getSubtokenCount();
 			starttime = current->getDurationFromStart();
-			startindex = (starttime / m_duration).getInteger();
+			startindex = getSlotIndex(current->getTicksFromStart());
 			for (int s=0; s<stcount; s++) {
 				string tok = current->getSubtoken(s);
 				base12 = Convert::kernToMidiNoteNumber(tok);
@@ -43251,10 +47302,9 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 				current = current->getNextToken();
 				continue;
 			}
-			starttime = current->getDurationFromStart();
-			duration = current->getDuration();
-			startindex = (starttime / m_duration).getInteger();
-			endindex   = ((starttime+duration) / m_duration).getInteger();
+			startticks = current->getTicksFromStart();
+			startindex = getSlotIndex(startticks);
+			endindex   = getSlotIndex(startticks + current->getTickDuration());
 			roll[base12][startindex] = 2;
 			for (int i=startindex+1; i<endindex; i++) {
 				roll[base12][i] = 1;
@@ -43266,6 +47316,19 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 
 
 
+//////////////////////////////
+//
+// Tool_binroll::getSlotIndex -- Convert a time in ticks into an index
+//    in the piano roll, where each slot has a duration of m_duration.
+//
+
+int Tool_binroll::getSlotIndex(long long ticks) {
+	return (int)(ticks * m_duration.getDenominator() /
+			((long long)m_tpq * m_duration.getNumerator()));
+}
+
+
+
 
 
 
@@ -43359,6 +47422,8 @@ Tool_chord::Tool_chord(void) {
 	define("s|spine=i:-1",        "spine to process (indexed from 1)");
 	define("m|minimize=b",        "minimize chords");
 	define("M|maximize=b",        "maximize chords");
+
+	allowParallelSegments();
 }
 
 
@@ -43696,9 +47761,11 @@ void Tool_chord::maximizeChordPitches(vector<string>& notes,
 #define REST 0
 #define RESTINT -1000000
 #define RESTSTRING "R"
+#define RESTCODE RESTINT
 #define INTERVAL_HARMONIC 1
 #define INTERVAL_MELODIC  2
 #define MARKNOTES  1
+#define MODULE_BLOCK_SIZE 1024
 
 
 /////////////////////////////////
@@ -43749,6 +47816,8 @@ Tool_cint::Tool_cint(void) {
 	define("search=s:", "search string");
 	define("mark=b", "mark matches notes from searches in data");
 	define("count=b", "count matched modules from search query");
+	define("module-count|module-counts=b", "count modules in all input files");
+	define("pair-threads=i:1", "number of threads for analyzing pairs of voices (0 = all cores)");
 	define("debug=b");              // determine bad input line num
 	define("author=b");             // author of program
 	define("version=b");            // compilation info
@@ -43815,6 +47884,35 @@ bool Tool_cint::run(HumdrumFile& infile) {
 }
 
 
+//
+// Module counting for all files in a stream (--module-count):
+//
+
+bool Tool_cint::run(HumdrumFileStream& instream) {
+	initialize();
+	m_modulecounts.clear();
+	HumdrumFile infile;
+	while (instream.getFile(infile)) {
+		countModules(infile);
+	}
+	printModuleCounts();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::hasModuleCountMode -- Returns true if the tool should be
+//    given the input stream rather than individual files (--module-count
+//    option).
+//
+
+bool Tool_cint::hasModuleCountMode(void) {
+	return getBoolean("module-count");
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // NoteNode class functions:
@@ -43894,15 +47992,9 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 	vector<vector<NoteNode> > notes;
 	vector<string> names;
 	vector<int>    ktracks;
-	vector<HTp>    kstarts;
 	vector<int>    reverselookup;
 
-	infile.getSpineStartList(kstarts, "**kern");
-	ktracks.resize(kstarts.size());
-	for (int i=0; i<(int)kstarts.size(); i++) {
-		ktracks[i] = kstarts[i]->getTrack();
-	}
-
+	getKernTracks(ktracks, infile);
 	if (koptionQ) {
 		adjustKTracks(ktracks, getString("koption"));
 	}
@@ -43978,6 +48070,84 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_cint::countModules -- Add the modules of every pair of parts in a
+//     file to the module counts.  The modules are the same as those
+//     printed by printCombinations(), but are only stored as lists of
+//     interval codes.
+//
+
+void Tool_cint::countModules(HumdrumFile& infile) {
+	vector<int> ktracks;
+	getKernTracks(ktracks, infile);
+	if (koptionQ) {
+		adjustKTracks(ktracks, getString("koption"));
+	}
+	vector<int> reverselookup(infile.getTrackCount()+1, -1);
+	for (int i=0; i<(int)ktracks.size(); i++) {
+		reverselookup[ktracks[i]] = i;
+	}
+	vector<vector<NoteNode> > notes(ktracks.size());
+	extractNoteArray(notes, infile, ktracks, reverselookup);
+	if (notes.size() < 2) {
+		return;
+	}
+
+	vector<int> indexes;
+	vector<int> codes;
+	int parts = (int)notes.size();
+	for (int i=0; i+Chaincount<(int)notes[0].size(); i++) {
+		if (!infile[notes[0][i].line].isData()) {
+			// modules only start on data lines.
+			continue;
+		}
+		for (int part1=0; part1<parts-1; part1++) {
+			for (int part2=part1+1; part2<parts; part2++) {
+				if (!getModuleIndexes(indexes, notes, Chaincount, i, part1, part2)) {
+					continue;
+				}
+				int octaveadjust = 0;
+				if (octaveQ) {
+					octaveadjust = getOctaveAdjustForCombinationModule(notes,
+							Chaincount, i, part1, part2);
+				}
+				getModuleCodes(codes, notes, indexes, part1, part2, octaveadjust);
+				m_modulecounts[make_pair(codes, (int)indexes.size())]++;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printModuleCounts -- Print the modules counted by
+//     countModules(), sorted from most to least common.  Modules are
+//     formatted in the same way as for the module display, but without
+//     durations or IDs.
+//
+
+void Tool_cint::printModuleCounts(void) {
+	vector<pair<int, string>> lines;
+	lines.reserve(m_modulecounts.size());
+	for (auto& it : m_modulecounts) {
+		stringstream module;
+		printModuleCodes(module, it.first.first, it.first.second);
+		lines.emplace_back(-it.second, module.str());
+	}
+	sort(lines.begin(), lines.end());
+
+	m_humdrum_text << "**count\t**cint\n";
+	for (int i=0; i<(int)lines.size(); i++) {
+		m_humdrum_text << -lines[i].first << "\t" << lines[i].second << "\n";
+	}
+	m_humdrum_text << "*-\t*-\n";
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::adjustKTracks -- Select only two spines to do analysis on.
@@ -44169,6 +48339,8 @@ int  Tool_cint::printCombinations(vector<vector<NoteNode> >& notes,
 	int i;
 	int currentindex = 0;
 	int matchcount   = 0;
+	m_blockstart     = -1;
+	m_blockend       = -1;
 	for (i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].hasSpines()) {
 			// print all lines here which do not contain spine
@@ -44256,6 +48428,16 @@ int Tool_cint::printModuleCombinations(HumdrumFile& infile, int line, vector<int
 	// printAsCombination(infile, line, ktracks, reverselookup, ".");
 	// return currentindex;
 
+	if ((m_pairthreads > 1) && ((currentindex < m_blockstart) ||
+			(currentindex >= m_blockend))) {
+		int blockend = currentindex + MODULE_BLOCK_SIZE;
+		if (blockend > (int)notes[0].size()) {
+			blockend = (int)notes[0].size();
+		}
+		prepareModuleBlock(notes, infile, n, currentindex, blockend,
+				retrospective, searchstring);
+	}
+
 	int tracknext;
 	int track;
 	int j, jj;
@@ -44300,9 +48482,14 @@ int Tool_cint::printModuleCombinations(HumdrumFile& infile, int line, vector<int
 				int part1 = reverselookup[track];
 				int part2 = part1+1+jj;
 				// m_humdrum_text << part1 << "," << part2;
-				matchcount += printCombinationModulePrepare(m_humdrum_text, filename,
-						notes, n, currentindex, part1, part2, retrospective, infile,
-						searchstring);
+				if (m_pairthreads > 1) {
+					matchcount += printPreparedModule(m_humdrum_text, notes,
+							currentindex, part1, part2, retrospective);
+				} else {
+					matchcount += printCombinationModulePrepare(m_humdrum_text,
+							filename, notes, n, currentindex, part1, part2,
+							retrospective, infile, searchstring);
+				}
 			}
 		}
 
@@ -44320,13 +48507,17 @@ int Tool_cint::printModuleCombinations(HumdrumFile& infile, int line, vector<int
 
 //////////////////////////////
 //
-// Tool_cint::printCombinationModulePrepare --
+// Tool_cint::printCombinationModulePrepare -- If result is given, the
+//     notes to mark and the retrospective entry are stored in it rather
+//     than changed in notes and retrospective, so that pairs of parts
+//     can be prepared concurrently (see prepareModuleBlock()).
 //
 
 int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filename,
 		 vector<vector<NoteNode> >& notes, int n, int startline, int part1,
 		 int part2, vector<vector<string> >& retrospective,
-		HumdrumFile& infile, const string& searchstring) {
+		HumdrumFile& infile, const string& searchstring,
+		CintModuleText* result) {
 	int count = 0;
 	HumRegex hre;
 	stringstream tempstream;
@@ -44353,7 +48544,7 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 					double loc = infile[line].getDurationFromStart().getFloat() /
 							infile[infile.getLineCount()-1].getDurationFromStart().getFloat();
 					loc = int(100.0 * loc + 0.5)/100.0;
-					m_humdrum_text << "!!LOCATION:"
+					out << "!!LOCATION:"
 							<< "\t"  << loc
 							<< "\tm" << getMeasure(infile, line)
 							<< "\tv" << ((int)notes.size() - part2)
@@ -44365,6 +48556,9 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 					out << tempstream.str();
 					// newline already added somewhere previously.
 					// m_humdrum_text << "\n";
+				} else if (result) {
+					getModuleIndexes(result->marks, notes, n, startline, part1,
+							part2);
 				} else {
 					// mark notes of the matched module(s) in the note array
 					// for later marking in input score.
@@ -44378,7 +48572,10 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 
 			}
 		} else {
-			if (retroQ) {
+			if (retroQ && result) {
+				result->retroline = status;
+				result->retrotext = tempstream.str();
+			} else if (retroQ) {
 				int column = getTriangleIndex((int)notes.size(), part1, part2);
 				retrospective[column][status] = tempstream.str();
 			} else {
@@ -44396,6 +48593,104 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 
 
 
+//////////////////////////////
+//
+// Tool_cint::prepareModuleBlock -- Calculate the module output of every
+//     pair of parts for the note array indexes from start to end-1
+//     (--pair-threads).  Each pair of parts is given to a separate
+//     thread, which only reads the note array.  The results are printed
+//     in the usual order by printPreparedModule().
+//
+
+void Tool_cint::prepareModuleBlock(vector<vector<NoteNode> >& notes,
+		HumdrumFile& infile, int n, int start, int end,
+		vector<vector<string> >& retrospective, const string& searchstring) {
+	int parts = (int)notes.size();
+	vector<pair<int, int>> pairs;
+	for (int i=0; i<parts-1; i++) {
+		for (int j=i+1; j<parts; j++) {
+			pairs.emplace_back(i, j);
+		}
+	}
+	if (locationQ && (infile.getLineCount() > 0)) {
+		// The rhythm analysis used by --location is done on demand, so
+		// it must be done before the threads are started.
+		infile[0].getDurationFromStart();
+	}
+	m_moduletexts.resize(pairs.size());
+	m_blockstart = start;
+	m_blockend = end;
+	string filename = infile.getFilename();
+
+	auto task = [&](int index) {
+		int part1 = pairs[index].first;
+		int part2 = pairs[index].second;
+		vector<CintModuleText>& texts = m_moduletexts[index];
+		texts.assign(end - start, CintModuleText());
+		stringstream out;
+		for (int i=start; i<end; i++) {
+			if ((i + n >= (int)notes[0].size()) ||
+					!infile[notes[0][i].line].isData()) {
+				// modules are only printed for data lines.
+				continue;
+			}
+			CintModuleText& text = texts[i - start];
+			out.str("");
+			text.count = printCombinationModulePrepare(out, filename, notes, n,
+					i, part1, part2, retrospective, infile, searchstring, &text);
+			text.text = out.str();
+		}
+	};
+
+	int count = (int)pairs.size();
+	int threads = m_pairthreads < count ? m_pairthreads : count;
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			task(index);
+		}
+	};
+	vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printPreparedModule -- Print the module of a pair of parts
+//     calculated by prepareModuleBlock(), and mark its notes or store its
+//     retrospective entry.  Returns the number of search matches.
+//
+
+int Tool_cint::printPreparedModule(ostream& out,
+		vector<vector<NoteNode> >& notes, int startline, int part1, int part2,
+		vector<vector<string> >& retrospective) {
+	int parts = (int)notes.size();
+	// index of the pair in the list made by prepareModuleBlock():
+	int index = part1 * (2 * parts - part1 - 1) / 2 + (part2 - part1 - 1);
+	CintModuleText& text = m_moduletexts.at(index).at(startline - m_blockstart);
+	out << text.text;
+	for (int i=0; i<(int)text.marks.size(); i++) {
+		notes[part1][text.marks[i]].mark = 1;
+		notes[part2][text.marks[i]].mark = 1;
+	}
+	if (text.retroline >= 0) {
+		int column = getTriangleIndex(parts, part1, part2);
+		retrospective[column][text.retroline] = text.retrotext;
+	}
+	return text.count;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::getMeasure -- return the last measure number of the given line index.
@@ -44701,19 +48996,20 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 
 	notemarker = '\0';
 
-	if (norestsQ) {
-		if (notes[part1][startline].b40 == 0) {
-			return 0;
-		}
-		if (notes[part2][startline].b40 == 0) {
-			return 0;
-		}
+	vector<int> indexes;
+	int retroline = getModuleIndexes(indexes, notes, n, startline, part1, part2);
+	if (!retroline) {
+		return 0;
 	}
 
-	stringstream idstream;
-
-	// int crossing =  0;
-	//int oldcrossing =  0;
+	int i;
+	if (markstate) {
+		for (i=0; i<(int)indexes.size(); i++) {
+			notes[part1][indexes[i]].mark = 1;
+			notes[part2][indexes[i]].mark = 1;
+		}
+		return retroline;
+	}
 
 	int octaveadjust = 0;   // used for -o option
 	if (octaveQ) {
@@ -44721,10 +49017,84 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 				part1, part2);
 	}
 
-	ostream *outp = &out;
-	// if (rawQ && !searchQ) {
-	//    outp = &m_humdrum_text;
-	// }
+	vector<int> codes;
+	getModuleCodes(codes, notes, indexes, part1, part2, octaveadjust);
+
+	if (raw2Q) {
+		// print pitch of first bottom note
+		if (filenameQ) {
+			out << "file_" << filename;
+			out << " ";
+		}
+
+		out << "v_" << part1 << " v_" << part2 << " ";
+
+		if (base12Q) {
+			out << "base12_";
+			out << Convert::base40ToMidiNoteNumber(abs(notes[part1][startline].b40));
+		} else if (base40Q) {
+			out << "base40_";
+			out << abs(notes[part1][startline].b40);
+		} else {
+			out << "base7_";
+			out << Convert::base40ToDiatonic(abs(notes[part1][startline].b40));
+		}
+		out << " ";
+	}
+
+	printModuleCodes(out, codes, (int)indexes.size(), &notes, &indexes, part1,
+			part2);
+
+	// print the ids string if requested
+	if (idQ) {
+		out << " ID:";
+		for (i=0; i<(int)indexes.size(); i++) {
+			if (i > 0) {
+				out << ':';
+			}
+			out << notes[part1][indexes[i]].getId() << ':'
+			    << notes[part2][indexes[i]].getId();
+		}
+		out << ends;
+	}
+
+	// keep track of notemarker state
+	for (i=0; i<(int)indexes.size(); i++) {
+		if ((notes[part1][indexes[i]].notemarker == NoteMarker) ||
+				(notes[part2][indexes[i]].notemarker == NoteMarker)) {
+			notemarker = NoteMarker;
+		}
+	}
+
+	return retroline;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getModuleIndexes -- Return the indexes of the sonorities
+//      in notes which form a counterpoint module (chain) starting at
+//      startline, for the pair of parts.  Sonorities in which both notes
+//      are sustained are skipped.  Returns the index of the last sonority
+//      of the module, or 0 if there is no valid module at the start line
+//      (see printCombinationModule()).
+//
+
+int Tool_cint::getModuleIndexes(vector<int>& indexes,
+		vector<vector<NoteNode> >& notes, int n, int startline, int part1,
+		int part2) {
+
+	indexes.clear();
+
+	if (norestsQ) {
+		if (notes[part1][startline].b40 == 0) {
+			return 0;
+		}
+		if (notes[part2][startline].b40 == 0) {
+			return 0;
+		}
+	}
 
 	if (n + startline >= (int)notes[0].size()) { // [20150202]
 		// definitely nothing to do
@@ -44742,37 +49112,10 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 		return 0;
 	}
 
-	if (raw2Q) {
-		// print pitch of first bottom note
-		if (filenameQ) {
-			(*outp) << "file_" << filename;
-			(*outp) << " ";
-		}
-
-		(*outp) << "v_" << part1 << " v_" << part2 << " ";
-
-		if (base12Q) {
-			(*outp) << "base12_";
-			(*outp) << Convert::base40ToMidiNoteNumber(abs(notes[part1][startline].b40));
-		} else if (base40Q) {
-			(*outp) << "base40_";
-			(*outp) << abs(notes[part1][startline].b40);
-		} else {
-			(*outp) << "base7_";
-			(*outp) << Convert::base40ToDiatonic(abs(notes[part1][startline].b40));
-		}
-		(*outp) << " ";
-	}
-
-	if (parenQ) {
-		(*outp) << "(";
-	}
-
 	int i;
 	int count = 0;
 	int countm = 0;
 	int attackcount = 0;
-	int idstart = 0;
 
 	int lastindex = -1;
 	int retroline = 0;
@@ -44800,125 +49143,25 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 			}
 		}
 
-		// print the melodic intervals (if not the first item in chain)
-		if ((count > 0) && !nomelodicQ) {
-			if (mparenQ) {
-				(*outp) << "{";
-			}
-
-			if (nounisonsQ) {
-				// suppress modules which contain melodic perfect unisons:
-				if ((notes[part1][i].b40 != 0) &&
-					(abs(notes[part1][i].b40) == abs(notes[part1][lastindex].b40))) {
-					return 0;
-				}
-				if ((notes[part2][i].b40 != 0) &&
-					(abs(notes[part2][i].b40) == abs(notes[part2][lastindex].b40))) {
-					return 0;
-				}
-			}
-			// bottom melodic interval:
-			if (!toponlyQ) {
-				printInterval((*outp), notes[part1][lastindex],
-						notes[part1][i], INTERVAL_MELODIC);
-				if (mmarkerQ) {
-					(*outp) << "m";
-				}
-			}
-
-			// print top melodic interval here if requested
-			if (topQ || toponlyQ) {
-				if (!toponlyQ) {
-					printSpacer((*outp));
-				}
-				// top melodic interval:
-				printInterval((*outp), notes[part2][lastindex],
-						notes[part2][i], INTERVAL_MELODIC);
-				if (mmarkerQ) {
-					(*outp) << "m";
-				}
+		if ((count > 0) && !nomelodicQ && nounisonsQ) {
+			// suppress modules which contain melodic perfect unisons:
+			if ((notes[part1][i].b40 != 0) &&
+				(abs(notes[part1][i].b40) == abs(notes[part1][lastindex].b40))) {
+				return 0;
 			}
-
-			if (mparenQ) {
-				(*outp) << "}";
+			if ((notes[part2][i].b40 != 0) &&
+				(abs(notes[part2][i].b40) == abs(notes[part2][lastindex].b40))) {
+				return 0;
 			}
-			printSpacer((*outp));
 		}
 
 		countm++;
-
-		// print harmonic interval
-		if (!noharmonicQ) {
-			if (hparenQ) {
-			  (*outp) << "[";
-			}
-			if (markstate) {
-				notes[part1][i].mark = 1;
-				notes[part2][i].mark = 1;
-			} else {
-				// oldcrossing = crossing;
-				//crossing = printInterval((*outp), notes[part1][i],
-				//      notes[part2][i], INTERVAL_HARMONIC, octaveadjust);
-				printInterval((*outp), notes[part1][i],
-						notes[part2][i], INTERVAL_HARMONIC, octaveadjust);
-			}
-
-			if (durationQ) {
-				if (notes[part1][i].isAttack()) {
-					(*outp) << "D" << notes[part1][i].duration;
-				}
-				if (notes[part2][i].isAttack()) {
-					(*outp) << "d" << notes[part1][i].duration;
-				}
-			}
-
-			if (hmarkerQ) {
-				(*outp) << "h";
-			}
-			if (hparenQ) {
-			  (*outp) << "]";
-			}
-		}
-
-		// prepare the ids string if requested
-		if (idQ) {
-		//   if (count == 0) {
-				// insert both first two notes, even if sustain.
-				if (idstart != 0) { idstream << ':'; }
-				idstart++;
-				idstream << notes[part1][i].getId() << ':'
-							<< notes[part2][i].getId();
-		//   } else {
-		//      // only insert IDs if an attack
-		//      if (notes[part1][i].b40 > 0) {
-		//         if (idstart != 0) { idstream << ':'; }
-		//         idstart++;
-		//         idstream << notes[part1][i].getId();
-		//      }
-		//      if (notes[part2][i].b40 > 0) {
-		//         if (idstart != 0) { idstream << ':'; }
-		//         idstart++;
-		//         idstream << notes[part2][i].getId();
-		//      }
-		//   }
-		}
-
-		// keep track of notemarker state
-		if (notes[part1][i].notemarker == NoteMarker) {
-			notemarker = NoteMarker;
-		}
-		if (notes[part2][i].notemarker == NoteMarker) {
-			notemarker = NoteMarker;
-		}
+		indexes.push_back(i);
 
 		// if count matches n, then exit loop
 		if ((count == n) && !attackQ) {
 			retroline = i;
 			break;
-		} else {
-			if (!noharmonicQ) {
-				printSpacer((*outp));
-			}
 		}
 		lastindex = i;
 		count++;
@@ -44935,15 +49178,6 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 
 	}
 
-	if (parenQ) {
-		(*outp) << ")";
-	}
-
-	if (idQ && idstart) {
-		idstream << ends;
-		(*outp) << " ID:" << idstream.str();
-	}
-
 	if (attackQ && (attackcount == n)) {
 		return retroline;
 	} else if ((countm>1) && (count == n)) {
@@ -44951,7 +49185,7 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 	} else if (n == 0) {
 		return retroline;
 	} else {
-		// did not print the required number of modules.
+		// did not find the required number of modules.
 		return 0;
 	}
 
@@ -44960,6 +49194,120 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 
 
 
+//////////////////////////////
+//
+// Tool_cint::getModuleCodes -- Convert the sonorities of a module from
+//      getModuleIndexes() into a list of interval codes, in the order
+//      in which they are printed: for each sonority after the first,
+//      the bottom and/or top melodic intervals (unless -M), followed by
+//      the harmonic interval of the sonority (unless -H).
+//
+
+void Tool_cint::getModuleCodes(vector<int>& codes,
+		vector<vector<NoteNode> >& notes, vector<int>& indexes, int part1,
+		int part2, int octaveadjust) {
+	codes.clear();
+	for (int i=0; i<(int)indexes.size(); i++) {
+		int index = indexes[i];
+		if ((i > 0) && !nomelodicQ) {
+			int lastindex = indexes[i-1];
+			if (!toponlyQ) {
+				codes.push_back(getIntervalCode(notes[part1][lastindex],
+						notes[part1][index], INTERVAL_MELODIC));
+			}
+			if (topQ || toponlyQ) {
+				codes.push_back(getIntervalCode(notes[part2][lastindex],
+						notes[part2][index], INTERVAL_MELODIC));
+			}
+		}
+		if (!noharmonicQ) {
+			codes.push_back(getIntervalCode(notes[part1][index],
+					notes[part2][index], INTERVAL_HARMONIC, octaveadjust));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printModuleCodes -- Print a module from the interval codes
+//      of getModuleCodes(), for a module with the given number of
+//      sonorities.  Durations (--dur) are only printed if the notes and
+//      indexes of the module are given.
+//
+
+void Tool_cint::printModuleCodes(ostream& out, const vector<int>& codes, int steps,
+		vector<vector<NoteNode> >* notes, vector<int>* indexes, int part1,
+		int part2) {
+	int c = 0;
+	if (parenQ) {
+		out << "(";
+	}
+	for (int i=0; i<steps; i++) {
+		if ((i > 0) && !nomelodicQ) {
+			if (mparenQ) {
+				out << "{";
+			}
+			// bottom melodic interval:
+			if (!toponlyQ) {
+				printIntervalCode(out, codes.at(c++));
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			// top melodic interval:
+			if (topQ || toponlyQ) {
+				if (!toponlyQ) {
+					printSpacer(out);
+				}
+				printIntervalCode(out, codes.at(c++));
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			if (mparenQ) {
+				out << "}";
+			}
+			printSpacer(out);
+		}
+
+		// harmonic interval
+		if (!noharmonicQ) {
+			if (hparenQ) {
+			  out << "[";
+			}
+			printIntervalCode(out, codes.at(c++));
+			if (durationQ && notes && indexes) {
+				int index = indexes->at(i);
+				if ((*notes)[part1][index].isAttack()) {
+					out << "D" << (*notes)[part1][index].duration;
+				}
+				if ((*notes)[part2][index].isAttack()) {
+					out << "d" << (*notes)[part1][index].duration;
+				}
+			}
+			if (hmarkerQ) {
+				out << "h";
+			}
+			if (hparenQ) {
+			  out << "]";
+			}
+		}
+
+		// The spacer after the last harmonic interval is only printed
+		// for --attacks modules.
+		if (((i < steps - 1) || attackQ) && !noharmonicQ) {
+			printSpacer(out);
+		}
+	}
+	if (parenQ) {
+		out << ")";
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::printAsCombination --
@@ -45532,22 +49880,47 @@ int Tool_cint::printLatticeItem(vector<vector<NoteNode> >& notes, int n, int cur
 
 //////////////////////////////
 //
-// Tool_cint::printInterval --
+// Tool_cint::printInterval -- Print the interval between two notes.
+//     Returns true if the harmonic interval is crossed.
 //
 
 int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		int type, int octaveadjust) {
+	printIntervalCode(out, getIntervalCode(note1, note2, type, octaveadjust));
 	if ((note1.b40 == REST) || (note2.b40 == REST)) {
-		out << RESTSTRING;
 		return 0;
 	}
-	int cross = 0;
+	if ((type == INTERVAL_HARMONIC) && (abs(note2.b40) < abs(note1.b40))) {
+		return 1;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getIntervalCode -- Return the interval between two notes
+//     as an integer code, in the units of the display options (base-7,
+//     base-12 or base-40).  The interval is stored in the upper bits of
+//     the code, and the lowest three bits store the sustain/attack state
+//     of the two notes when it is displayed:
+//        bit 2: sustain/attack state is displayed
+//        bit 1: first note is sustained
+//        bit 0: second note is sustained
+//     Rests give RESTCODE.  Use printIntervalCode() to print the code.
+//
+
+int Tool_cint::getIntervalCode(NoteNode& note1, NoteNode& note2, int type,
+		int octaveadjust) {
+	if ((note1.b40 == REST) || (note2.b40 == REST)) {
+		return RESTCODE;
+	}
 	int pitch1 = abs(note1.b40);
 	int pitch2 = abs(note2.b40);
 	int interval = pitch2 - pitch1;
 
 	if ((type == INTERVAL_HARMONIC) && (interval < 0)) {
-		cross = 1;
 		if (uncrossQ) {
 			interval = -interval;
 		}
@@ -45605,6 +49978,35 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		interval = interval + octaveadjust  * 7;
 	}
 
+	int flags = 0;
+	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+		flags |= 4;
+		if (note1.b40 < 0) {
+			flags |= 2;
+		}
+		if (note2.b40 < 0) {
+			flags |= 1;
+		}
+	}
+
+	return interval * 8 + flags;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printIntervalCode -- Print an interval code from
+//     getIntervalCode().
+//
+
+void Tool_cint::printIntervalCode(ostream& out, int code) {
+	if (code == RESTCODE) {
+		out << RESTSTRING;
+		return;
+	}
+	int flags = code & 7;
+	int interval = (code - flags) / 8;
 
 	if (chromaticQ) {
 		out << Convert::base40ToIntervalAbbr(interval);
@@ -45621,21 +50023,11 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		}
 	}
 
-	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+	if (flags & 4) {
 		// print sustain/attack information of intervals.
-		if (note1.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
-		if (note2.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
+		out << ((flags & 2) ? "s" : "x");
+		out << ((flags & 1) ? "s" : "x");
 	}
-
-	return cross;
 }
 
 
@@ -46183,25 +50575,16 @@ void Tool_cint::getAbbreviation(string& abbr, string& name) {
 
 //////////////////////////////
 //
-// Tool_cint::getKernTracks -- return a list of track number for **kern spines.
+// Tool_cint::getKernTracks -- return a list of track number for **kern spines,
+//     including spines which start after the first line of the file.
 //
 
 void Tool_cint::getKernTracks(vector<int>& ktracks, HumdrumFile& infile) {
-	int i, j;
-	ktracks.reserve(infile.getTrackCount()+1);
-	ktracks.resize(0);
-	int track;
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		for (j=0; j<infile[i].getFieldCount(); j++) {
-			if (infile.token(i, j)->isKern()) {
-				track = infile.token(i, j)->getTrack();
-				ktracks.push_back(track);
-			}
-		}
-		break;
+	vector<HTp> kstarts;
+	infile.getSpineStartList(kstarts, "**kern");
+	ktracks.resize(kstarts.size());
+	for (int i=0; i<(int)kstarts.size(); i++) {
+		ktracks[i] = kstarts[i]->getTrack();
 	}
 }
 
@@ -46348,6 +50731,13 @@ void Tool_cint::initialize(void) {
 	uncrossQ     = getBoolean("uncross");
 	locationQ    = getBoolean("location");
 	retroQ       = getBoolean("retrospective");
+	m_pairthreads = getInteger("pair-threads");
+	if (m_pairthreads <= 0) {
+		m_pairthreads = (int)std::thread::hardware_concurrency();
+	}
+	if (m_pairthreads < 1) {
+		m_pairthreads = 1;
+	}
 	NoteMarker   = 0;
 	if (getBoolean("note-marker")) {
 		NoteMarker = getString("note-marker").c_str()[0];
@@ -46497,9 +50887,9 @@ void Tool_composite::processFile(HumdrumFile& infile) {
 		extract.setModified("s", "0,1-$");
 	}
 
-	vector<HumNum> durations(infile.getLineCount());
+	vector<long long> durations(infile.getLineCount());
 	for (int i=0; i<infile.getLineCount(); i++) {
-		durations[i] = infile[i].getDuration();
+		durations[i] = infile[i].getTickDuration();
 	}
 
 	vector<bool> isRest(infile.getLineCount(), false);
@@ -46676,18 +51066,18 @@ HumNum Tool_composite::getLineDuration(HumdrumFile& infile, int index, vector<bo
 	if (!infile[index].isData()) {
 		return 0;
 	}
-	HumNum output = infile[index].getDuration();
+	long long ticks = infile[index].getTickDuration();
 	for (int i=index+1; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
 		}
 		if (isNull[i]) {
-			output += infile[i].getDuration();
+			ticks += infile[i].getTickDuration();
 		} else {
 			break;
 		}
 	}
-	return output;
+	return infile.ticksToDuration(ticks);
 }
 
 
@@ -51006,6 +55396,8 @@ Tool_extract::Tool_extract(void) {
 	define("version=b");             // compilation info
 	define("example=b");             // example usages
 	define("h|help=b");              // short description
+
+	allowParallelSegments();
 }
 
 
@@ -53036,7 +57428,7 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE.readString(tool->getHumdrumText());   \
+		updateFromToolOutput(INFILE, tool->getHumdrumText()); \
 	}                                               \
 	delete tool;
 
@@ -53077,6 +57469,9 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 
 Tool_filter::Tool_filter(void) {
 	define("debug=b", "print debug statement");
+	define("reparse=b", "reparse Humdrum output of each tool rather than updating input file");
+
+	allowParallelSegments();
 }
 
 
@@ -53212,6 +57607,270 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// Tool_filter::updateFromToolOutput -- Make the input file match the
+//    Humdrum text output of a tool.  Tools often print the input file
+//    after changing some of its tokens (or print changed tokens in place
+//    of the originals).  When the output has the same lines and spine
+//    structure as the input file, the changed tokens are updated directly
+//    in the input file, so that the next tool in the chain does not have
+//    to wait for the entire file to be parsed and analyzed again.  Changes
+//    to null tokens or note durations are repaired locally afterwards with
+//    HumdrumFile::reanalyzeEdits().  If the structure changed, or a change
+//    would affect the spine analysis of the file (comments, spine
+//    manipulators or slurs), the file is re-read from the text instead.
+//
+
+void Tool_filter::updateFromToolOutput(HumdrumFile& infile, const string& text) {
+	if (m_reparseQ) {
+		infile.readString(text);
+		return;
+	}
+
+	const char* ptr = text.data();
+	const char* end = ptr + text.size();
+	int lineindex = 0;
+	bool valid = true;
+	m_rewrittenQ = false;
+	while (ptr < end) {
+		const char* eol = (const char*)memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			eol = end;
+		}
+		int length = (int)(eol - ptr);
+		if ((length > 0) && (ptr[length-1] == '\r')) {
+			length--;
+		}
+		if (lineindex >= infile.getLineCount()) {
+			valid = false;
+			break;
+		}
+		if ((infile[lineindex].getOwner() != &infile) ||
+				(infile[lineindex].getLineIndex() != lineindex)) {
+			// The tool inserted or deleted lines in the input file
+			// without analyzing it again.
+			valid = false;
+			break;
+		}
+		if (!updateLineFromText(infile[lineindex], ptr, length)) {
+			valid = false;
+			break;
+		}
+		lineindex++;
+		ptr = eol + 1;
+	}
+	if (lineindex != infile.getLineCount()) {
+		valid = false;
+	}
+
+	if (!valid) {
+		if (m_debugQ) {
+			cerr << "!! filter: reparsing tool output" << endl;
+		}
+		infile.readString(text);
+		return;
+	}
+	if (m_rewrittenQ) {
+		// Links and other values calculated by content analyses (such as
+		// ties) may refer to the old contents of the rewritten tokens.
+		clearAutoParameters(infile);
+	}
+	if (infile.hasEdits()) {
+		infile.reanalyzeEdits();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::clearAutoParameters -- Remove the parameters in the "auto"
+//    namespace, which are set by content analyses such as slur and tie
+//    linking, from all tokens in the file.  Content analyses which were
+//    already done are done again by reanalyzeEdits() (see
+//    updateLineFromText()).
+//
+
+void Tool_filter::clearAutoParameters(HumdrumFile& infile) {
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			infile.token(i, j)->deleteValues("", "auto");
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::updateLineFromText -- Update the tokens of a line to match
+//    a line of text output from a tool.  Returns false if the line cannot
+//    be updated in place, in which case the file should be re-read.
+//
+
+bool Tool_filter::updateLineFromText(HumdrumLine& line, const char* text,
+		int length) {
+	if ((line.size() == (size_t)length) && (line.compare(0, length, text, length) == 0)) {
+		// Line is unchanged (but check that the tokens were not changed
+		// without updating the line text).
+		if (!line.hasSpines()) {
+			return true;
+		}
+		int tcount = line.getTokenCount();
+		int start = 0;
+		for (int i=0; i<tcount; i++) {
+			HTp token = line.token(i);
+			if (!isAnalyzedToken(line, token, i)) {
+				return false;
+			}
+			int tlen = (int)token->size();
+			if (start + tlen > length) {
+				return false;
+			}
+			if (token->compare(0, tlen, text + start, tlen) != 0) {
+				return false;
+			}
+			start += tlen;
+			if (i < tcount - 1) {
+				if ((start >= length) || (text[start] != '\t')) {
+					return false;
+				}
+				start++;
+			}
+		}
+		return start == length;
+	}
+
+	// Only the contents of data, barline and (non-manipulator)
+	// interpretation lines can be changed in place.
+	if (!(line.isData() || line.isBarline() || line.isInterpretation())) {
+		return false;
+	}
+
+	int tcount = line.getTokenCount();
+	int start = 0;
+	bool changed = false;
+	for (int i=0; i<tcount; i++) {
+		if (start > length) {
+			return false;
+		}
+		const char* tab = (const char*)memchr(text + start, '\t', length - start);
+		int stop = tab ? (int)(tab - text) : length;
+		if ((i < tcount - 1) && (tab == NULL)) {
+			// fewer fields in output
+			return false;
+		}
+		if ((i == tcount - 1) && (tab != NULL)) {
+			// more fields in output
+			return false;
+		}
+		HTp token = line.token(i);
+		if (!isAnalyzedToken(line, token, i)) {
+			return false;
+		}
+		int tlen = stop - start;
+		if ((token->size() != (size_t)tlen) || (token->compare(0, tlen, text + start, tlen) != 0)) {
+			string newtext(text + start, tlen);
+			if (newtext.empty()) {
+				return false;
+			}
+			// The new token must be of the same type as the line.
+			char first = newtext[0];
+			if (line.isData() && ((first == '!') || (first == '*') || (first == '='))) {
+				return false;
+			} else if (line.isBarline() && (first != '=')) {
+				return false;
+			} else if (line.isInterpretation() && (first != '*')) {
+				return false;
+			}
+			if (line.isInterpretation()) {
+				if (token->isManipulator() || token->isExclusiveInterpretation()) {
+					return false;
+				}
+			}
+			bool oldnull = token->isNull();
+			if (getSlurMarkers(*token) != getSlurMarkers(newtext)) {
+				// slur linking would need to be analyzed again
+				return false;
+			}
+			token->setText(newtext);
+			if (line.isInterpretation()) {
+				if (token->isManipulator() || token->isExclusiveInterpretation()) {
+					return false;
+				}
+			}
+			if (line.isData()) {
+				if (token->hasRhythm() && !(token->isKern() || token->isMens())) {
+					return false;
+				}
+			} else if (token->isNull() != oldnull) {
+				return false;
+			}
+			changed = true;
+		}
+		start = stop + 1;
+	}
+
+	if (changed) {
+		line.createLineFromTokens();
+		m_rewrittenQ = true;
+		HumdrumFile* owner = line.getOwner();
+		if (owner && (owner->isAnalyzed(ANALYZE_SLURS) ||
+				owner->isAnalyzed(ANALYZE_TIES) ||
+				owner->isAnalyzed(ANALYZE_ACCIDENTALS))) {
+			// so that reanalyzeEdits() does the content analyses again
+			line.markEdited();
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::isAnalyzedToken -- Returns true if the token was part of
+//    the spine analysis of the file (and not added to the line by the
+//    tool, such as when a tool adds a new spine to the input file).
+//
+
+bool Tool_filter::isAnalyzedToken(HumdrumLine& line, HTp token, int field) {
+	if (token->getOwner() != &line) {
+		return false;
+	}
+	if (token->getFieldIndex() != field) {
+		return false;
+	}
+	return token->getTrack() > 0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::getSlurMarkers -- Return the slur start, slur end and
+//    elision characters in a token, in order.
+//
+
+string Tool_filter::getSlurMarkers(const string& text) {
+	string output;
+	for (int i=0; i<(int)text.size(); i++) {
+		switch (text[i]) {
+			case '(':
+			case ')':
+			case '&':
+				output += text[i];
+		}
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_filter::removeGlobalFilterLines --
@@ -53338,6 +57997,7 @@ void Tool_filter::getUniversalCommandList(vector<pair<string, string> >& command
 
 void Tool_filter::initialize(HumdrumFile& infile) {
 	m_debugQ = getBoolean("debug");
+	m_reparseQ = getBoolean("reparse");
 }
 
 
@@ -53363,6 +58023,8 @@ Tool_homophonic::Tool_homophonic(void) {
 	define("s|score=d:1.0", "Score assigned to a sonority with three or more attacks");
 	define("m|intermediate-score=d:0.5", "Score to give sonority between two adjacent attack sonoroties");
 	define("l|letter=b", "Display letter scoress before calculations");
+
+	allowParallelSegments();
 }
 
 
@@ -54323,8 +58985,16 @@ void Tool_humdiff::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 
 void Tool_humdiff::compareFiles(HumdrumFileSet& humset) {
 	vector<vector<TimePoint>> timepoints(humset.getSize());;
+	vector<int> tpqs(humset.getSize());
 	for (int i=0; i<humset.getSize(); i++) {
 		extractTimePoints(timepoints.at(i), humset[i]);
+		tpqs.at(i) = humset[i].tpq();
+	}
+
+	// Convert the tick times of each file to a common timebase.  If that
+	// timebase does not fit in 64 bits, compare the HumNum timestamps instead:
+	if (!setCommonTicks(timepoints, tpqs)) {
+		setTimestampTicks(timepoints);
 	}
 
 	if (getBoolean("time-points")) {
@@ -54338,6 +59008,66 @@ void Tool_humdiff::compareFiles(HumdrumFileSet& humset) {
 
 
 
+//////////////////////////////
+//
+// Tool_humdiff::setCommonTicks -- Scale the tick times of each file to
+//     the LCM of the ticks-per-quarter values of the files.  Returns false
+//     (leaving the timepoints unchanged) if the scaled ticks would overflow.
+//
+
+bool Tool_humdiff::setCommonTicks(vector<vector<TimePoint>>& timepoints,
+		vector<int>& tpqs) {
+	long long tpq = Convert::getLcm64(tpqs);
+	if (tpq <= 0) {
+		return false;
+	}
+	vector<long long> factors(timepoints.size());
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		factors.at(i) = tpq / tpqs.at(i);
+		if (timepoints.at(i).empty()) {
+			continue;
+		}
+		long long maxticks = timepoints.at(i).back().ticks;
+		if (maxticks > std::numeric_limits<long long>::max() / factors.at(i)) {
+			return false;
+		}
+	}
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		for (auto& tp : timepoints.at(i)) {
+			tp.ticks *= factors.at(i);
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::setTimestampTicks -- Replace the tick times with the rank
+//     of each timestamp among all of the timestamps in the files, so that
+//     timepoints are ordered and matched by their HumNum timestamps.
+//
+
+void Tool_humdiff::setTimestampTicks(vector<vector<TimePoint>>& timepoints) {
+	vector<HumNum> timestamps;
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		for (auto& tp : timepoints.at(i)) {
+			timestamps.push_back(tp.timestamp);
+		}
+	}
+	std::sort(timestamps.begin(), timestamps.end());
+	timestamps.erase(std::unique(timestamps.begin(), timestamps.end()), timestamps.end());
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		for (auto& tp : timepoints.at(i)) {
+			tp.ticks = std::lower_bound(timestamps.begin(), timestamps.end(),
+					tp.timestamp) - timestamps.begin();
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_humdiff::printTimePoints --
@@ -54360,8 +59090,8 @@ ostream& Tool_humdiff::printTimePoints(ostream& out, vector<TimePoint>& timepoin
 
 ostream& Tool_humdiff::compareTimePoints(ostream& out, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset) {
 	vector<int> indexes(timepoints.size(), 0);
-	HumNum minval;
-	HumNum value;
+	long long minval;
+	long long value;
 	int found;
 
 	vector<int> increment(timepoints.size(), 0);
@@ -54378,12 +59108,12 @@ ostream& Tool_humdiff::compareTimePoints(ostream& out, vector<vector<TimePoint>>
 		for (int i=1; i<(int)timepoints.size(); i++) {
 			timepoints.at(0).at(indexes.at(0)).index.at(i) = -1;
 		}
-		minval = timepoints.at(0).at(indexes.at(0)).timestamp;
+		minval = timepoints.at(0).at(indexes.at(0)).ticks;
 		for (int i=1; i<(int)timepoints.size(); i++) {
 			if (indexes.at(i) >= (int)timepoints.at(i).size()) {
 				continue;
 			}
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
+			value = timepoints.at(i).at(indexes.at(i)).ticks;
 			if (value < minval) {
 				minval = value;
 			}
@@ -54397,7 +59127,7 @@ ostream& Tool_humdiff::compareTimePoints(ostream& out, vector<vector<TimePoint>>
 				continue;
 			}
 			found = 1;
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
+			value = timepoints.at(i).at(indexes.at(i)).ticks;
 
 			if (value == minval) {
 				timepoints.at(0).at(indexes.at(0)).index.at(i) = timepoints.at(i).at(indexes.at(i)).index.at(0);
@@ -54469,7 +59199,7 @@ void Tool_humdiff::markNote(NotePoint& np) {
 // Tool_humdiff::compareLines --
 //
 
-void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
+void Tool_humdiff::compareLines(long long minval, vector<int>& indexes,
 		vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset) {
 
 	bool reportQ = getBoolean("report");
@@ -54480,7 +59210,7 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 		if (indexes.at(i) >= (int)timepoints.at(i).size()) {
 			continue;
 		}
-		if (timepoints.at(i).at(indexes.at(i)).timestamp != minval) {
+		if (timepoints.at(i).at(indexes.at(i)).ticks != minval) {
 			// not at the same time
 			continue;
 		}
@@ -54641,7 +59371,7 @@ void Tool_humdiff::extractTimePoints(vector<TimePoint>& points, HumdrumFile& inf
 		if (!infile[i].isData()) {
 			continue;
 		}
-		if (infile[i].getDuration() == 0) {
+		if (infile[i].getTickDuration() == 0) {
 			// ignore grace notes for now
 			continue;
 		}
@@ -54649,6 +59379,7 @@ void Tool_humdiff::extractTimePoints(vector<TimePoint>& points, HumdrumFile& inf
 		tp.file.push_back(&infile);
 		tp.index.push_back(i);
 		tp.timestamp = infile[i].getDurationFromStart();
+		tp.ticks = infile[i].getTicksFromStart();
 		tp.measure = measure;
 		points.push_back(tp);
 	}
@@ -55053,6 +59784,8 @@ Tool_humsort::Tool_humsort(void) {
 	define("s|spine=i:1", "Spine to sort (1-indexed)");
 	define("I|do-not-ignore-case=b", "Do not ignore case when sorting alphabetically");
 	define("i|e|x|interp|exclusive-interpretation=s", "Exclusive interpretation to sort");
+
+	allowParallelSegments();
 }
 
 
@@ -55254,6 +59987,8 @@ Tool_imitation::Tool_imitation(void) {
 	define("a|add=b",             "add inversions, retrograde, etc. if specified to normal search");
 	define("v|inversion=b",       "match inversions");
 	define("g|retrograde=b",      "match retrograde");
+
+	define("no-index=b",          "compare all pairs of notes rather than only notes starting the same intervals");
 }
 
 
@@ -55361,6 +60096,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 	m_rest    = getBoolean("rest");
 	m_rest2   = getBoolean("rest2");
 	m_single  = getBoolean("single-mark");
+	m_indexQ  = !getBoolean("no-index");
 
 	if (getBoolean("intervals")) {
 		vector<string> values;
@@ -55447,6 +60183,15 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 		getIntervals(intervals.at(i), attacks.at(i));
 	}
 
+	if (m_indexQ) {
+		m_sources.resize(attacks.size());
+		m_targets.resize(attacks.size());
+		for (int i=0; i<(int)attacks.size(); i++) {
+			buildIndex(m_sources.at(i), attacks.at(i), intervals.at(i), false);
+			buildIndex(m_targets.at(i), attacks.at(i), intervals.at(i), true);
+		}
+	}
+
 	for (int i=0; i<(int)attacks.size(); i++) {
 		for (int j=i+1; j<(int)attacks.size(); j++) {
 			analyzeImitation(results, attacks, intervals, i, j);
@@ -55503,26 +60248,14 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 	for (int i=0; i<(int)v1i.size() - 1; i++) {
 		count = 0;
 		for (int j=0; j<(int)v2i.size() - 1; j++) {
-			if (m_rest || m_rest2) {
-				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
-					// match initiator must be preceded by a rest (or start of music)
-					continue;
-				}
-			}
-			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
-					// match target must be preceded by a rest (or start of music)
-					continue;
+			if (m_indexQ) {
+				// skip to the next note which could start a match.
+				j = getNextCandidate(attacks, intervals, enum1, enum2, v1, v2, i, j);
+				if (j < 0) {
+					break;
 				}
 			}
-			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
-				// avoid re-matching an existing match as a submatch
-				continue;
-			}
-			count = compareSequences(v1a, v1i, i, v2a, v2i, j);
-			if ((count >= min) && (m_intervals.size() > 0)) {
-				count = checkForIntervalSequence(m_intervals, v1i, i, count);
-			}
+			count = getMatchCount(attacks, intervals, enum1, enum2, v1, v2, i, j);
 			if (count < min) {
 				j += count;
 				continue;
@@ -55808,6 +60541,200 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 
 
 
+//////////////////////////////
+//
+// Tool_imitation::getMatchCount -- Return the number of notes that match
+//     between the sequences starting at note i in voice v1 and note j in
+//     voice v2, or 0 if a match is not allowed to start at those notes.
+//
+
+int Tool_imitation::getMatchCount(vector<vector<NoteCell*>>& attacks,
+		vector<vector<double>>& intervals, vector<int>& enum1,
+		vector<int>& enum2, int v1, int v2, int i, int j) {
+	if (m_rest || m_rest2) {
+		if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
+			// match initiator must be preceded by a rest (or start of music)
+			return 0;
+		}
+	}
+	if (m_rest2) {
+		if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+			// match target must be preceded by a rest (or start of music)
+			return 0;
+		}
+	}
+	if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
+		// avoid re-matching an existing match as a submatch
+		return 0;
+	}
+	int count = compareSequences(attacks.at(v1), intervals.at(v1), i,
+			attacks.at(v2), intervals.at(v2), j);
+	if ((count >= m_threshold - 1) && (m_intervals.size() > 0)) {
+		count = checkForIntervalSequence(m_intervals, intervals.at(v1), i, count);
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::buildIndex -- Calculate the keys of the notes in a voice
+//     and the hashes of the runs of m_threshold - 2 keys which a match
+//     must start with.  For the second voice of a voice pair (target),
+//     also list the notes starting with each key and run hash.  Inverted
+//     intervals are used for the target when matching inversions.
+//
+
+void Tool_imitation::buildIndex(ImitationIndex& index,
+		vector<NoteCell*>& attacks, vector<double>& intervals, bool target) {
+	index.clear();
+	int size = (int)intervals.size();
+	index.keys.resize(size);
+	for (int i=0; i<size; i++) {
+		// 0 = interval to/from a rest.
+		unsigned long long key = 0;
+		if (!Convert::isNaN(intervals.at(i))) {
+			int interval = (int)intervals.at(i);
+			if (target && m_inversion) {
+				interval = -interval;
+			}
+			key = (unsigned long long)(interval + 1000);
+		}
+		if (m_duration) {
+			HumNum duration = attacks.at(i)->getDuration();
+			key = key * 1000003ULL + (unsigned long long)duration.getNumerator();
+			key = key * 1000003ULL + (unsigned long long)duration.getDenominator();
+		}
+		index.keys[i] = key;
+	}
+
+	int length = m_threshold - 2;
+	if (size >= length) {
+		index.hashes.resize(size - length + 1);
+	}
+	for (int i=0; i<(int)index.hashes.size(); i++) {
+		unsigned long long hash = 0;
+		for (int k=0; k<length; k++) {
+			hash = hash * 0x100000001b3ULL + index.keys[i+k];
+		}
+		index.hashes[i] = hash;
+	}
+
+	if (!target) {
+		return;
+	}
+	for (int i=0; i<size; i++) {
+		if (Convert::isNaN(intervals.at(i))) {
+			// sequences cannot start with rests
+			continue;
+		}
+		index.firsts[index.keys[i]].push_back(i);
+		if (i < (int)index.hashes.size()) {
+			index.runs[index.hashes[i]].push_back(i);
+		}
+	}
+
+	// A note is a sync point if the previous note with the same key is at
+	// least m_threshold - 1 notes before it: no partial match starting
+	// before it can extend past it.
+	int min = m_threshold - 1;
+	for (auto& it : index.firsts) {
+		vector<int>& list = it.second;
+		vector<int>& sync = index.lastsync[it.first];
+		sync.resize(list.size());
+		for (int k=0; k<(int)list.size(); k++) {
+			if ((k == 0) || (list[k] - list[k-1] >= min)) {
+				sync[k] = k;
+			} else {
+				sync[k] = sync[k-1];
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::getNextCandidate -- Return the next note in voice v2,
+//     starting at note j, which the comparison loop in analyzeImitation()
+//     would reach and which starts the same run of intervals as note i in
+//     voice v1.  Returns -1 if there are no more such notes.  A match
+//     cannot start on any other note, but notes which start with the
+//     same interval can still have partial matches which cause the loop
+//     to skip notes.  These are compared as the loop would, starting from
+//     the last sync point before the candidate.
+//
+
+int Tool_imitation::getNextCandidate(vector<vector<NoteCell*>>& attacks,
+		vector<vector<double>>& intervals, vector<int>& enum1,
+		vector<int>& enum2, int v1, int v2, int i, int j) {
+	ImitationIndex& source = m_sources.at(v1);
+	ImitationIndex& target = m_targets.at(v2);
+	int jmax = (int)intervals.at(v2).size() - 1;
+	if (Convert::isNaN(intervals.at(v1).at(i))) {
+		// sequences cannot start with rests
+		return -1;
+	}
+	if (i >= (int)source.hashes.size()) {
+		return -1;
+	}
+	auto rit = target.runs.find(source.hashes[i]);
+	if (rit == target.runs.end()) {
+		return -1;
+	}
+	vector<int>& runs = rit->second;
+
+	vector<int>* firsts = NULL;
+	vector<int>* lastsync = NULL;
+	auto fit = target.firsts.find(source.keys[i]);
+	if (fit != target.firsts.end()) {
+		firsts = &fit->second;
+		lastsync = &target.lastsync[fit->first];
+	}
+
+	int pos = j;
+	while (true) {
+		auto cit = lower_bound(runs.begin(), runs.end(), pos);
+		if ((cit == runs.end()) || (*cit >= jmax)) {
+			return -1;
+		}
+		int candidate = *cit;
+		if (!firsts) {
+			return candidate;
+		}
+
+		int k = (int)(upper_bound(firsts->begin(), firsts->end(), candidate)
+				- firsts->begin()) - 1;
+		if (k >= 0) {
+			int sync = firsts->at(lastsync->at(k));
+			if (sync > pos) {
+				pos = sync;
+			}
+		}
+
+		int fsize = (int)firsts->size();
+		k = (int)(lower_bound(firsts->begin(), firsts->end(), pos) - firsts->begin());
+		while (pos < candidate) {
+			if ((k >= fsize) || (firsts->at(k) >= candidate)) {
+				pos = candidate;
+				break;
+			}
+			int start = firsts->at(k);
+			pos = start + getMatchCount(attacks, intervals, enum1, enum2, v1, v2, i, start) + 1;
+			while ((k < fsize) && (firsts->at(k) < pos)) {
+				k++;
+			}
+		}
+		if (pos == candidate) {
+			return candidate;
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_imitation::markedTiedNotes --
@@ -55958,6 +60885,8 @@ Tool_kern2mens::Tool_kern2mens(void) {
 	define("I|not-invisible=b",       "keep measures visible");
 	define("D|no-double-bar=b",       "keep thick final barlines");
 	define("c|clef=s",                "clef to use in mensural notation");
+
+	allowParallelSegments();
 }
 
 
@@ -60269,6 +65198,8 @@ Tool_melisma::Tool_melisma(void) {
 	define("a|average|avg=b",  "calculate note-to-syllable ratio");
 	define("w|words=b",        "list words that contain a melisma");
 	define("p|part=b", "also calculate note-to-syllable ratios by part");
+
+	allowParallelSegments();
 }
 
 
@@ -61030,6 +65961,8 @@ Tool_metlev::Tool_metlev(void) {
 	define("G|no-grace-notes=b",  "do not mark grace note lines");
 	define("k|kern-spine=i:1",    "analyze only given kern spine");
 	define("e|exinterp=s:blev",   "exclusive interpretation type for output");
+
+	allowParallelSegments();
 }
 
 
@@ -61222,6 +66155,1014 @@ void Tool_metlev::fillVoiceResults(vector<vector<double> >& results,
 
 
 
+#define MSEARCH_INDEX_VERSION   3
+#define MSEARCH_INDEX_BYTEORDER 0x01020304
+
+struct MSearchIndexHeader {
+	char      magic[4];      // "MSIX"
+	int       version;       // MSEARCH_INDEX_VERSION
+	int       byteorder;     // MSEARCH_INDEX_BYTEORDER
+	int       gramlength;    // number of notes in each n-gram
+	int       filecount;     // number of file names
+	int       sourcecount;   // number of source files
+	int       keycount;      // number of n-gram keys
+	int       wordcount;     // number of lyric words
+	long long namesize;      // bytes of file names
+	long long sourcesize;    // bytes of source segment indexes
+	long long postingcount;  // total number of postings
+	long long wordsize;      // bytes of lyric words
+	long long wordpostingcount;  // total number of word postings
+};
+
+struct MSearchIndexFile {
+	int       source;        // index of the source file
+	int       segment;       // segment number in the source file
+};
+
+struct MSearchIndexKey {
+	unsigned long long key;  // n-gram hash
+	long long offset;        // index of the first posting for the key
+	long long count;         // number of postings for the key
+};
+
+struct MSearchIndexWord {
+	long long offset;        // index of the first posting for the word
+	long long count;         // number of postings for the word
+};
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::MSearchIndex -- Constructor.
+//
+
+MSearchIndex::MSearchIndex(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::~MSearchIndex -- Deconstructor.
+//
+
+MSearchIndex::~MSearchIndex() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::clear -- Remove all files from the index.
+//
+
+void MSearchIndex::clear(void) {
+	m_files.clear();
+	m_filesources.clear();
+	m_filesegments.clear();
+	m_sources.clear();
+	m_postings.clear();
+	m_keys.clear();
+	m_offsets.clear();
+	m_counts.clear();
+	m_wordpostings.clear();
+	m_words.clear();
+	m_wordoffsets.clear();
+	m_wordcounts.clear();
+	if (m_input.is_open()) {
+		m_input.close();
+	}
+	m_postingstart = 0;
+	m_wordpostingstart = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::setGramLength -- Set the number of notes in each n-gram
+//     (default 4).  Queries need at least this many notes with the same
+//     feature type to use the index.  Should be set before adding files.
+//
+
+void MSearchIndex::setGramLength(int length) {
+	if (length < 1) {
+		length = 1;
+	}
+	m_length = length;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getGramLength --
+//
+
+int MSearchIndex::getGramLength(void) const {
+	return m_length;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileCount -- Number of files in the index.
+//
+
+int MSearchIndex::getFileCount(void) const {
+	return (int)m_files.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileName -- Name of a file in the index.
+//
+
+string MSearchIndex::getFileName(int index) const {
+	if ((index < 0) || (index >= (int)m_files.size())) {
+		return "";
+	}
+	return m_files[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileSource -- Index of the source file which contains
+//     a file in the index, or -1 if the index is out of range.
+//
+
+int MSearchIndex::getFileSource(int index) const {
+	if ((index < 0) || (index >= (int)m_filesources.size())) {
+		return -1;
+	}
+	return m_filesources[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileSegment -- Segment number of a file in its source
+//     file, or -1 if the index is out of range.
+//
+
+int MSearchIndex::getFileSegment(int index) const {
+	if ((index < 0) || (index >= (int)m_filesegments.size())) {
+		return -1;
+	}
+	return m_filesegments[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getSourceCount -- Number of source files in the index.
+//
+
+int MSearchIndex::getSourceCount(void) const {
+	return (int)m_sources.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getSourceIndex -- Segment index of a source file, which
+//     can be loaded with HumdrumFileStream::readSegmentIndex().
+//
+
+string MSearchIndex::getSourceIndex(int source) const {
+	if ((source < 0) || (source >= (int)m_sources.size())) {
+		return "";
+	}
+	return m_sources[source];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addSource -- Add a source file, given by its segment index
+//     (from HumdrumFileStream::writeSegmentIndex()).  Returns the index
+//     number of the source.
+//
+
+int MSearchIndex::addSource(const string& segmentindex) {
+	m_sources.push_back(segmentindex);
+	return (int)m_sources.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addFile -- Add the n-grams of every voice in a NoteGrid
+//     to the index.  The file is the given segment of a source file added
+//     with addSource().  Returns the index number of the file.  The note
+//     features are calculated in the same way as the msearch matcher
+//     compares them.
+//
+
+int MSearchIndex::addFile(const string& name, int source, int segment,
+		NoteGrid& grid) {
+	int file = (int)m_files.size();
+	m_files.push_back(name);
+	m_filesources.push_back(source);
+	m_filesegments.push_back(segment);
+
+	vector<NoteCell*> attacks;
+	vector<int> diatonic;
+	vector<int> chromatic;
+	vector<int> interval;
+	vector<int> numerator;
+	vector<int> denominator;
+	vector<int> none;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		int size = (int)attacks.size();
+		diatonic.resize(size);
+		chromatic.resize(size);
+		interval.resize(size);
+		numerator.resize(size);
+		denominator.resize(size);
+		none.assign(size, 0);
+		for (int i=0; i<size; i++) {
+			NoteCell* note = attacks[i];
+			double pc = note->getAbsDiatonicPitchClass();
+			diatonic[i] = Convert::isNaN(pc) ? 7 : (int)pc;
+			pc = note->getAbsBase40PitchClass();
+			chromatic[i] = Convert::isNaN(pc) ? 40 : (int)pc;
+			HumNum duration = note->getDuration();
+			numerator[i] = duration.getNumerator();
+			denominator[i] = duration.getDenominator();
+			interval[i] = GRAM_NONE;
+			if (i > 0) {
+				double current = note->getAbsMidiPitch();
+				double previous = attacks[i-1]->getAbsMidiPitch();
+				if (current > previous) {
+					interval[i] = GRAM_UP;
+				} else if (current < previous) {
+					interval[i] = GRAM_DOWN;
+				} else if (current == previous) {
+					interval[i] = GRAM_SAME;
+				}
+			}
+		}
+		addGrams(GRAM_DIATONIC, diatonic, none, 0, attacks, file, v);
+		addGrams(GRAM_CHROMATIC, chromatic, none, 0, attacks, file, v);
+		addGrams(GRAM_INTERVAL, interval, none, 1, attacks, file, v);
+		addGrams(GRAM_RHYTHM, numerator, denominator, 0, attacks, file, v);
+	}
+
+	return file;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addGrams -- Add a posting for each n-gram of a feature
+//     in a voice.  The first n-gram starts at the given note.
+//
+
+void MSearchIndex::addGrams(int type, vector<int>& symbols,
+		vector<int>& symbols2, int start, vector<NoteCell*>& attacks,
+		int file, int voice) {
+	MSearchIndexPosting posting;
+	posting.file = file;
+	posting.voice = voice;
+	for (int i=start; i+m_length<=(int)symbols.size(); i++) {
+		posting.slice = attacks[i]->getSliceIndex();
+		m_postings[makeKey(type, symbols, symbols2, i)].push_back(posting);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::makeKey -- Hash the n-gram of a feature starting at the
+//     given note (64-bit FNV-1a hash).
+//
+
+unsigned long long MSearchIndex::makeKey(int type, vector<int>& symbols,
+		vector<int>& symbols2, int start) {
+	unsigned long long key = 0xcbf29ce484222325ULL;
+	auto addValue = [&key](int value) {
+		unsigned int data = (unsigned int)value;
+		for (int b=0; b<4; b++) {
+			key ^= (data >> (b * 8)) & 0xff;
+			key *= 0x100000001b3ULL;
+		}
+	};
+	addValue(type);
+	for (int i=start; i<start+m_length; i++) {
+		addValue(symbols[i]);
+		addValue(symbols2[i]);
+	}
+	return key;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::write -- Save the index.  Posting lists are sorted by
+//     n-gram key.
+//
+
+bool MSearchIndex::write(const string& filename) {
+	std::ofstream output(filename.c_str(), std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	return write(output);
+}
+
+
+bool MSearchIndex::write(ostream& out) {
+	vector<unsigned long long> keys;
+	keys.reserve(m_postings.size());
+	for (auto& it : m_postings) {
+		keys.push_back(it.first);
+	}
+	sort(keys.begin(), keys.end());
+
+	string names;
+	for (int i=0; i<(int)m_files.size(); i++) {
+		names += m_files[i];
+		names += '\0';
+	}
+	string sources;
+	for (int i=0; i<(int)m_sources.size(); i++) {
+		sources += m_sources[i];
+		sources += '\0';
+	}
+	vector<MSearchIndexFile> files(m_files.size());
+	for (int i=0; i<(int)m_files.size(); i++) {
+		files[i].source = m_filesources[i];
+		files[i].segment = m_filesegments[i];
+	}
+
+	MSearchIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "MSIX", 4);
+	header.version = MSEARCH_INDEX_VERSION;
+	header.byteorder = MSEARCH_INDEX_BYTEORDER;
+	header.gramlength = m_length;
+	header.filecount = (int)m_files.size();
+	header.sourcecount = (int)m_sources.size();
+	header.keycount = (int)keys.size();
+	header.namesize = (long long)names.size();
+	header.sourcesize = (long long)sources.size();
+
+	vector<MSearchIndexKey> table(keys.size());
+	long long offset = 0;
+	for (int i=0; i<(int)keys.size(); i++) {
+		table[i].key = keys[i];
+		table[i].offset = offset;
+		table[i].count = (long long)m_postings[keys[i]].size();
+		offset += table[i].count;
+	}
+	header.postingcount = offset;
+
+	sortWords();
+	string words;
+	vector<MSearchIndexWord> wordtable(m_words.size());
+	offset = 0;
+	for (int i=0; i<(int)m_words.size(); i++) {
+		words += m_words[i];
+		words += '\0';
+		wordtable[i].offset = offset;
+		wordtable[i].count = m_wordcounts[i];
+		offset += m_wordcounts[i];
+	}
+	header.wordcount = (int)m_words.size();
+	header.wordsize = (long long)words.size();
+	header.wordpostingcount = offset;
+
+	out.write((const char*)&header, sizeof(header));
+	out.write(names.data(), names.size());
+	out.write(sources.data(), sources.size());
+	if (!files.empty()) {
+		out.write((const char*)files.data(), files.size() * sizeof(MSearchIndexFile));
+	}
+	if (!table.empty()) {
+		out.write((const char*)table.data(), table.size() * sizeof(MSearchIndexKey));
+	}
+	for (int i=0; i<(int)keys.size(); i++) {
+		vector<MSearchIndexPosting>& postings = m_postings[keys[i]];
+		out.write((const char*)postings.data(),
+				postings.size() * sizeof(MSearchIndexPosting));
+	}
+	out.write(words.data(), words.size());
+	if (!wordtable.empty()) {
+		out.write((const char*)wordtable.data(),
+				wordtable.size() * sizeof(MSearchIndexWord));
+	}
+	for (int i=0; i<(int)m_words.size(); i++) {
+		vector<MSearchIndexWordPosting>& postings = m_wordpostings[m_words[i]];
+		out.write((const char*)postings.data(),
+				postings.size() * sizeof(MSearchIndexWordPosting));
+	}
+	out.flush();
+	return out.good();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::read -- Load the file names and n-gram keys of an index
+//     file.  Posting lists are read from the file when they are needed.
+//     Returns false if the file is not an msearch index.
+//
+
+bool MSearchIndex::read(const string& filename) {
+	clear();
+	m_input.open(filename.c_str(), std::ios::binary);
+	if (!m_input.is_open()) {
+		return false;
+	}
+	MSearchIndexHeader header;
+	if (!m_input.read((char*)&header, sizeof(header))) {
+		return false;
+	}
+	if ((memcmp(header.magic, "MSIX", 4) != 0) ||
+			(header.version != MSEARCH_INDEX_VERSION) ||
+			(header.byteorder != MSEARCH_INDEX_BYTEORDER) ||
+			(header.gramlength < 1) || (header.filecount < 0) ||
+			(header.sourcecount < 0) || (header.sourcesize < 0) ||
+			(header.keycount < 0) || (header.namesize < 0) ||
+			(header.postingcount < 0) || (header.wordcount < 0) ||
+			(header.wordsize < 0) || (header.wordpostingcount < 0)) {
+		m_input.close();
+		return false;
+	}
+	m_length = header.gramlength;
+
+	string names(header.namesize, '\0');
+	if (!m_input.read(&names[0], header.namesize)) {
+		m_input.close();
+		return false;
+	}
+	size_t start = 0;
+	for (int i=0; i<header.filecount; i++) {
+		size_t end = names.find('\0', start);
+		if (end == string::npos) {
+			m_input.close();
+			return false;
+		}
+		m_files.push_back(names.substr(start, end - start));
+		start = end + 1;
+	}
+
+	string sources(header.sourcesize, '\0');
+	if (!m_input.read(&sources[0], header.sourcesize)) {
+		m_input.close();
+		return false;
+	}
+	start = 0;
+	for (int i=0; i<header.sourcecount; i++) {
+		size_t end = sources.find('\0', start);
+		if (end == string::npos) {
+			m_input.close();
+			return false;
+		}
+		m_sources.push_back(sources.substr(start, end - start));
+		start = end + 1;
+	}
+
+	vector<MSearchIndexFile> files(header.filecount);
+	if (!files.empty() && !m_input.read((char*)files.data(),
+			files.size() * sizeof(MSearchIndexFile))) {
+		m_input.close();
+		return false;
+	}
+	m_filesources.resize(files.size());
+	m_filesegments.resize(files.size());
+	for (int i=0; i<(int)files.size(); i++) {
+		if ((files[i].source < 0) || (files[i].source >= header.sourcecount)) {
+			m_input.close();
+			return false;
+		}
+		m_filesources[i] = files[i].source;
+		m_filesegments[i] = files[i].segment;
+	}
+
+	vector<MSearchIndexKey> table(header.keycount);
+	if (!table.empty() && !m_input.read((char*)table.data(),
+			table.size() * sizeof(MSearchIndexKey))) {
+		m_input.close();
+		return false;
+	}
+	m_keys.resize(table.size());
+	m_offsets.resize(table.size());
+	m_counts.resize(table.size());
+	for (int i=0; i<(int)table.size(); i++) {
+		m_keys[i] = table[i].key;
+		m_offsets[i] = table[i].offset;
+		m_counts[i] = (int)table[i].count;
+	}
+	m_postingstart = (long long)m_input.tellg();
+
+	// The lyric words follow the n-gram posting lists:
+	m_input.seekg(m_postingstart + header.postingcount *
+			(long long)sizeof(MSearchIndexPosting));
+	string words(header.wordsize, '\0');
+	if (!m_input.read(&words[0], header.wordsize)) {
+		m_input.close();
+		return false;
+	}
+	start = 0;
+	for (int i=0; i<header.wordcount; i++) {
+		size_t end = words.find('\0', start);
+		if (end == string::npos) {
+			m_input.close();
+			return false;
+		}
+		m_words.push_back(words.substr(start, end - start));
+		start = end + 1;
+	}
+	vector<MSearchIndexWord> wordtable(header.wordcount);
+	if (!wordtable.empty() && !m_input.read((char*)wordtable.data(),
+			wordtable.size() * sizeof(MSearchIndexWord))) {
+		m_input.close();
+		return false;
+	}
+	m_wordoffsets.resize(wordtable.size());
+	m_wordcounts.resize(wordtable.size());
+	for (int i=0; i<(int)wordtable.size(); i++) {
+		m_wordoffsets[i] = wordtable[i].offset;
+		m_wordcounts[i] = (int)wordtable[i].count;
+	}
+	m_wordpostingstart = (long long)m_input.tellg();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getPostings -- Return the posting list for an n-gram
+//     key, sorted by file, voice and slice.
+//
+
+void MSearchIndex::getPostings(vector<MSearchIndexPosting>& postings,
+		unsigned long long key) {
+	postings.clear();
+	if (!m_input.is_open()) {
+		auto it = m_postings.find(key);
+		if (it != m_postings.end()) {
+			postings = it->second;
+		}
+		return;
+	}
+	auto it = lower_bound(m_keys.begin(), m_keys.end(), key);
+	if ((it == m_keys.end()) || (*it != key)) {
+		return;
+	}
+	int index = (int)(it - m_keys.begin());
+	postings.resize(m_counts[index]);
+	m_input.clear();
+	m_input.seekg(m_postingstart + m_offsets[index] * (long long)sizeof(MSearchIndexPosting));
+	if (!m_input.read((char*)postings.data(),
+			postings.size() * sizeof(MSearchIndexPosting))) {
+		postings.clear();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getQueryKeys -- Return the keys of the n-grams which
+//     every match of the query must contain.  The note which each query
+//     token refers to is calculated in the same way as in
+//     Tool_msearch::checkForMatchDiatonicPC(): a pitch following an
+//     interval-direction token refers to the same note as the interval.
+//     Direction markers on pitches (^ and v) are not used.
+//
+
+void MSearchIndex::getQueryKeys(vector<unsigned long long>& keys,
+		vector<MSearchQueryToken>& query) {
+	keys.clear();
+	int size = (int)query.size();
+	// -1 = no requirement for the note:
+	vector<int> diatonic(size, -1);
+	vector<int> chromatic(size, -1);
+	vector<int> interval(size, -1);
+	vector<int> numerator(size, -1);
+	vector<int> denominator(size, -1);
+	vector<int> none(size, 0);
+
+	bool lastIsInterval = false;
+	int c = 0;
+	for (int i=0; i<size; i++) {
+		MSearchQueryToken& token = query[i];
+		if (token.anything) {
+			continue;
+		}
+		if (token.base <= 0) {
+			lastIsInterval = true;
+			if (token.direction > 0) {
+				interval[i-c] = GRAM_UP;
+			} else if (token.direction < 0) {
+				interval[i-c] = GRAM_DOWN;
+			} else {
+				interval[i-c] = GRAM_SAME;
+			}
+			continue;
+		}
+		if (lastIsInterval) {
+			c++;
+			lastIsInterval = false;
+		}
+		int p = i - c;
+		if (token.base == 40) {
+			// A base-40 pitch class also fixes the diatonic pitch class:
+			if (Convert::isNaN(token.pc)) {
+				chromatic[p] = 40;
+				diatonic[p] = 7;
+			} else {
+				chromatic[p] = (int)token.pc;
+				diatonic[p] = Convert::base40ToDiatonic(chromatic[p]) % 7;
+			}
+		} else {
+			diatonic[p] = Convert::isNaN(token.pc) ? 7 : (int)token.pc;
+		}
+		if (!token.rhythm.empty()) {
+			numerator[p] = token.duration.getNumerator();
+			denominator[p] = token.duration.getDenominator();
+		}
+	}
+
+	addQueryGrams(keys, GRAM_DIATONIC, diatonic, none);
+	addQueryGrams(keys, GRAM_CHROMATIC, chromatic, none);
+	addQueryGrams(keys, GRAM_INTERVAL, interval, none);
+	addQueryGrams(keys, GRAM_RHYTHM, numerator, denominator);
+
+	sort(keys.begin(), keys.end());
+	keys.erase(unique(keys.begin(), keys.end()), keys.end());
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addQueryGrams -- Add the keys for each run of m_length
+//     notes in the query which all have a requirement for the feature.
+//
+
+void MSearchIndex::addQueryGrams(vector<unsigned long long>& keys, int type,
+		vector<int>& symbols, vector<int>& symbols2) {
+	int run = 0;
+	for (int i=0; i<(int)symbols.size(); i++) {
+		if (symbols[i] < 0) {
+			run = 0;
+			continue;
+		}
+		run++;
+		if (run >= m_length) {
+			keys.push_back(makeKey(type, symbols, symbols2, i - m_length + 1));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getCandidates -- Return the files which have a voice
+//     containing all of the n-grams of the query.  Returns false if the
+//     query does not have any n-grams, in which case every file is a
+//     candidate.
+//
+
+bool MSearchIndex::getCandidates(vector<int>& files,
+		vector<MSearchQueryToken>& query) {
+	files.clear();
+	vector<unsigned long long> keys;
+	getQueryKeys(keys, query);
+	if (keys.empty()) {
+		for (int i=0; i<getFileCount(); i++) {
+			files.push_back(i);
+		}
+		return false;
+	}
+
+	// Intersect the voices containing each n-gram, starting with
+	// the shortest posting list.
+	vector<pair<int, unsigned long long>> order;
+	for (int i=0; i<(int)keys.size(); i++) {
+		int count = 0;
+		if (m_input.is_open()) {
+			auto it = lower_bound(m_keys.begin(), m_keys.end(), keys[i]);
+			if ((it != m_keys.end()) && (*it == keys[i])) {
+				count = m_counts[it - m_keys.begin()];
+			}
+		} else {
+			auto it = m_postings.find(keys[i]);
+			if (it != m_postings.end()) {
+				count = (int)it->second.size();
+			}
+		}
+		if (count == 0) {
+			return true;
+		}
+		order.emplace_back(count, keys[i]);
+	}
+	sort(order.begin(), order.end());
+
+	vector<MSearchIndexPosting> postings;
+	vector<long long> voices;
+	vector<long long> current;
+	vector<long long> common;
+	for (int i=0; i<(int)order.size(); i++) {
+		getPostings(postings, order[i].second);
+		current.clear();
+		for (int j=0; j<(int)postings.size(); j++) {
+			long long voice = ((long long)postings[j].file << 32) | postings[j].voice;
+			if (current.empty() || (current.back() != voice)) {
+				current.push_back(voice);
+			}
+		}
+		if (i == 0) {
+			voices.swap(current);
+		} else {
+			common.resize(std::min(voices.size(), current.size()));
+			auto end = set_intersection(voices.begin(), voices.end(),
+					current.begin(), current.end(), common.begin());
+			common.resize(end - common.begin());
+			voices.swap(common);
+		}
+		if (voices.empty()) {
+			return true;
+		}
+	}
+
+	for (int i=0; i<(int)voices.size(); i++) {
+		int file = (int)(voices[i] >> 32);
+		if (files.empty() || (files.back() != file)) {
+			files.push_back(file);
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addWords -- Add the lyric words of a file (from
+//     Tool_msearch::fillWords()) to the index.
+//
+
+void MSearchIndex::addWords(int file, vector<TextInfo*>& words) {
+	MSearchIndexWordPosting posting;
+	posting.file = file;
+	for (int i=0; i<(int)words.size(); i++) {
+		HTp token = words[i]->starttoken;
+		posting.track = token ? token->getTrack() : 0;
+		posting.line = token ? token->getLineIndex() : -1;
+		posting.word = i;
+		m_wordpostings[normalizeWord(words[i]->fullword)].push_back(posting);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getWordCount -- Number of different lyric words in the
+//     index.
+//
+
+int MSearchIndex::getWordCount(void) {
+	sortWords();
+	return (int)m_words.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::normalizeWord -- Convert a word to lower case.
+//
+
+string MSearchIndex::normalizeWord(const string& word) {
+	string output = word;
+	for (int i=0; i<(int)output.size(); i++) {
+		output[i] = (char)std::tolower((unsigned char)output[i]);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::sortWords -- Make the sorted list of words for an index
+//     which is being built (the list is read from the file otherwise).
+//
+
+void MSearchIndex::sortWords(void) {
+	if (m_input.is_open()) {
+		return;
+	}
+	m_words.clear();
+	m_wordcounts.clear();
+	m_wordoffsets.clear();
+	m_words.reserve(m_wordpostings.size());
+	for (auto& it : m_wordpostings) {
+		m_words.push_back(it.first);
+	}
+	sort(m_words.begin(), m_words.end());
+	for (int i=0; i<(int)m_words.size(); i++) {
+		m_wordcounts.push_back((int)m_wordpostings[m_words[i]].size());
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getMatchingWords -- Return the indexes of the words which
+//     match a term of a text query.  Terms are case-insensitive regular
+//     expressions, as in Tool_msearch::doTextSearch().  Plain words only
+//     need a substring test, and plain words starting with "^" (prefix
+//     queries) are found with a binary search of the sorted words.
+//
+
+void MSearchIndex::getMatchingWords(vector<int>& indexes,
+		const string& term) {
+	indexes.clear();
+	bool prefixQ = (!term.empty()) && (term[0] == '^');
+	string literal = normalizeWord(prefixQ ? term.substr(1) : term);
+	bool literalQ = literal.find_first_of("\\^$.|?*+()[]{}") == string::npos;
+
+	if (literalQ && prefixQ) {
+		auto it = lower_bound(m_words.begin(), m_words.end(), literal);
+		while ((it != m_words.end()) &&
+				(it->compare(0, literal.size(), literal) == 0)) {
+			indexes.push_back((int)(it - m_words.begin()));
+			it++;
+		}
+	} else if (literalQ) {
+		for (int i=0; i<(int)m_words.size(); i++) {
+			if (m_words[i].find(literal) != string::npos) {
+				indexes.push_back(i);
+			}
+		}
+	} else {
+		regex re(term, std::regex_constants::ECMAScript |
+				std::regex_constants::icase);
+		for (int i=0; i<(int)m_words.size(); i++) {
+			if (std::regex_search(m_words[i], re)) {
+				indexes.push_back(i);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getWordPostings -- Return the posting list of a word,
+//     sorted by file and word number.
+//
+
+void MSearchIndex::getWordPostings(vector<MSearchIndexWordPosting>& postings,
+		int index) {
+	postings.clear();
+	if ((index < 0) || (index >= (int)m_words.size())) {
+		return;
+	}
+	if (!m_input.is_open()) {
+		postings = m_wordpostings[m_words[index]];
+		return;
+	}
+	postings.resize(m_wordcounts[index]);
+	m_input.clear();
+	m_input.seekg(m_wordpostingstart + m_wordoffsets[index] *
+			(long long)sizeof(MSearchIndexWordPosting));
+	if (!m_input.read((char*)postings.data(),
+			postings.size() * sizeof(MSearchIndexWordPosting))) {
+		postings.clear();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getTermPostings -- Return the postings of all words
+//     which match a query term, sorted by file and word number.
+//
+
+void MSearchIndex::getTermPostings(vector<MSearchIndexWordPosting>& postings,
+		const string& term) {
+	postings.clear();
+	vector<int> indexes;
+	getMatchingWords(indexes, term);
+	vector<MSearchIndexWordPosting> list;
+	for (int i=0; i<(int)indexes.size(); i++) {
+		getWordPostings(list, indexes[i]);
+		postings.insert(postings.end(), list.begin(), list.end());
+	}
+	sort(postings.begin(), postings.end(),
+			[](const MSearchIndexWordPosting& a, const MSearchIndexWordPosting& b) {
+				if (a.file != b.file) {
+					return a.file < b.file;
+				}
+				return a.word < b.word;
+			});
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getTextMatches -- Return the position of the first word
+//     of every match of a text query, sorted by file and word number.
+//     Words of a quoted phrase must follow each other in the same track.
+//
+
+void MSearchIndex::getTextMatches(vector<MSearchIndexWordPosting>& matches,
+		vector<MSearchTextQuery>& query) {
+	matches.clear();
+	sortWords();
+	auto before = [](const MSearchIndexWordPosting& a,
+			const MSearchIndexWordPosting& b) {
+		if (a.file != b.file) {
+			return a.file < b.file;
+		}
+		return a.word < b.word;
+	};
+
+	vector<MSearchIndexWordPosting> current;
+	vector<MSearchIndexWordPosting> next;
+	vector<MSearchIndexWordPosting> kept;
+	for (int i=0; i<(int)query.size(); i++) {
+		if (query[i].link) {
+			continue;
+		}
+		getTermPostings(current, query[i].word);
+		for (int k=1; (i+k<(int)query.size()) && query[i+k].link; k++) {
+			if (current.empty()) {
+				break;
+			}
+			getTermPostings(next, query[i+k].word);
+			kept.clear();
+			for (int j=0; j<(int)current.size(); j++) {
+				MSearchIndexWordPosting target = current[j];
+				target.word += k;
+				auto it = lower_bound(next.begin(), next.end(), target, before);
+				if ((it != next.end()) && (it->file == target.file) &&
+						(it->word == target.word) && (it->track == target.track)) {
+					kept.push_back(current[j]);
+				}
+			}
+			current.swap(kept);
+		}
+		matches.insert(matches.end(), current.begin(), current.end());
+	}
+	sort(matches.begin(), matches.end(), before);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getTextCandidates -- Return the files which contain a
+//     match for a text query.
+//
+
+void MSearchIndex::getTextCandidates(vector<int>& files,
+		vector<MSearchTextQuery>& query) {
+	files.clear();
+	vector<MSearchIndexWordPosting> matches;
+	getTextMatches(matches, query);
+	for (int i=0; i<(int)matches.size(); i++) {
+		if (files.empty() || (files.back() != matches[i].file)) {
+			files.push_back(matches[i].file);
+		}
+	}
+}
+
+
+
+
 
 /////////////////////////////////
 //
@@ -61235,6 +67176,11 @@ Tool_msearch::Tool_msearch(void) {
 	define("x|cross=b",         "search across parts");
 	define("c|color=s",         "highlight color");
 	define("m|mark|marker=s:@", "marking character");
+
+	define("build-index=s",     "write an n-gram index of the input files");
+	define("index=s",           "search the files in an n-gram index");
+	define("gram-length=i:4",   "number of notes in each n-gram for --build-index");
+	define("l|list=b",          "list the candidate files for --index without searching them");
 }
 
 
@@ -61276,6 +67222,22 @@ bool Tool_msearch::run(HumdrumFile& infile, ostream& out) {
 }
 
 
+bool Tool_msearch::run(HumdrumFileStream& instream) {
+	if (getBoolean("build-index")) {
+		return buildIndex(instream);
+	} else if (getBoolean("index")) {
+		return searchIndex();
+	}
+	HumdrumFileSet infiles;
+	infiles.read(instream);
+	bool status = run(infiles);
+	for (int i=0; i<infiles.getCount(); i++) {
+		m_humdrum_text << infiles[i];
+	}
+	return status;
+}
+
+
 bool Tool_msearch::run(HumdrumFile& infile) {
 	NoteGrid grid(infile);
 	if (getBoolean("debug")) {
@@ -61302,6 +67264,171 @@ bool Tool_msearch::run(HumdrumFile& infile) {
 }
 
 
+//////////////////////////////
+//
+// Tool_msearch::hasIndexMode -- Returns true if the tool should be given
+//    the input stream rather than individual files (--build-index or
+//    --index options).
+//
+
+bool Tool_msearch::hasIndexMode(void) {
+	return getBoolean("build-index") || getBoolean("index");
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::buildIndex -- Write an n-gram and lyric index of the
+//    files in the input stream.  Each segment of each input file is
+//    indexed, and is recorded by its source file and segment number so
+//    that searching can read it again with HumdrumFileStream::readSegment().
+//    Standard input and URLs cannot be read again, so they cannot be
+//    indexed.
+//
+
+bool Tool_msearch::buildIndex(HumdrumFileStream& instream) {
+	const vector<string>& filelist = instream.getFileList();
+	if (filelist.empty()) {
+		setError("Error: --build-index needs input files (standard input cannot be indexed)");
+		return false;
+	}
+	MSearchIndex index;
+	index.setGramLength(getInteger("gram-length"));
+	for (int i=0; i<(int)filelist.size(); i++) {
+		if (!addIndexSource(index, filelist[i])) {
+			return false;
+		}
+	}
+	string filename = getString("build-index");
+	if (!index.write(filename)) {
+		setError("Error: cannot write index " + filename);
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::addIndexSource -- Add the segments of an input file to
+//    an index.  The file is stored by its absolute path, so that the
+//    index can be searched from another directory.
+//
+
+bool Tool_msearch::addIndexSource(MSearchIndex& index, const string& filename) {
+	if (filename.find("://") != string::npos) {
+		setError("Error: cannot index URL " + filename);
+		return false;
+	}
+#ifdef _WIN32
+	char* fullpath = _fullpath(NULL, filename.c_str(), 0);
+#else
+	char* fullpath = realpath(filename.c_str(), NULL);
+#endif
+	if (fullpath == NULL) {
+		setError("Error: cannot open " + filename);
+		return false;
+	}
+	string path = fullpath;
+	free(fullpath);
+
+	HumdrumFileStream segments;
+	int count = segments.buildSegmentIndex(path);
+	stringstream segmentindex;
+	segments.writeSegmentIndex(segmentindex);
+	int source = index.addSource(segmentindex.str());
+
+	HumdrumFile infile;
+	vector<TextInfo*> words;
+	for (int i=0; i<count; i++) {
+		if (!segments.readSegment(infile, i)) {
+			setError("Error: cannot read segment " + to_string(i + 1) + " of " + path);
+			return false;
+		}
+		NoteGrid grid(infile);
+		int file = index.addFile(infile.getFilename(), source, i, grid);
+		fillWords(infile, words);
+		index.addWords(file, words);
+		for (int j=0; j<(int)words.size(); j++) {
+			delete words[j];
+		}
+		words.clear();
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::searchIndex -- Search the files in an n-gram index.  Only
+//    the files which contain all of the n-grams of the query (or, for
+//    text queries, the files which contain matching words) are read from
+//    their source files and searched.  Files with matches are printed
+//    (marked as usual), each preceded by a !!!!SEGMENT: record with its
+//    name.
+//
+
+bool Tool_msearch::searchIndex(void) {
+	MSearchIndex index;
+	string filename = getString("index");
+	if (!index.read(filename)) {
+		setError("Error: cannot read index " + filename);
+		return false;
+	}
+
+	vector<int> candidates;
+	if (getBoolean("text")) {
+		vector<MSearchTextQuery> query;
+		fillTextQuery(query, getString("text"));
+		index.getTextCandidates(candidates, query);
+	} else {
+		vector<MSearchQueryToken> query;
+		fillMusicQuery(query, getString("query"));
+		index.getCandidates(candidates, query);
+	}
+
+	if (getBoolean("list")) {
+		for (int i=0; i<(int)candidates.size(); i++) {
+			m_free_text << index.getFileName(candidates[i]) << endl;
+		}
+		return true;
+	}
+
+	bool status = true;
+	HumdrumFileStream segments;
+	int source = -1;
+	for (int i=0; i<(int)candidates.size(); i++) {
+		string name = index.getFileName(candidates[i]);
+		if (index.getFileSource(candidates[i]) != source) {
+			source = index.getFileSource(candidates[i]);
+			stringstream segmentindex(index.getSourceIndex(source));
+			segments.readSegmentIndex(segmentindex);
+		}
+		HumdrumFile infile;
+		if (!segments.readSegment(infile, index.getFileSegment(candidates[i]))) {
+			m_warning_text << "Warning: cannot read " << name << endl;
+			status = false;
+			continue;
+		}
+		run(infile);
+		if (m_matchcount) {
+			// Segments which are labeled in their source file already
+			// start with their !!!!SEGMENT: record.
+			if ((infile.getLineCount() == 0) ||
+					(infile[0].compare(0, 11, "!!!!SEGMENT") != 0)) {
+				m_humdrum_text << "!!!!SEGMENT: " << name << endl;
+			}
+			m_humdrum_text << infile;
+		}
+	}
+	return status;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::initialize --
@@ -61390,6 +67517,8 @@ void Tool_msearch::fillWordsForTrack(vector<TextInfo*>& words,
 //////////////////////////////
 //
 // Tool_msearch::doTextSearch -- do a basic text search of all parts.
+//    Each query word is a case-insensitive regular expression.  Words
+//    of a quoted phrase must match consecutive words in the same track.
 //
 
 void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
@@ -61399,13 +67528,38 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 	words.reserve(10000);
 	fillWords(infile, words);
 	int tcount = 0;
+	m_matchcount = 0;
 
 	HumRegex hre;
 	for (int i=0; i<(int)query.size(); i++) {
-		for (int j=0; j<(int)words.size(); j++) {
-			if (hre.search(words.at(j)->fullword, query.at(i).word, "i")) {
-				tcount++;
-				markTextMatch(infile, *words[j]);
+		if (query[i].link) {
+			continue;
+		}
+		int length = 1;
+		while ((i + length < (int)query.size()) && query[i+length].link) {
+			length++;
+		}
+		for (int j=0; j+length<=(int)words.size(); j++) {
+			int track = words[j]->starttoken->getTrack();
+			bool found = true;
+			for (int k=0; k<length; k++) {
+				TextInfo* word = words[j+k];
+				if ((k > 0) && (word->starttoken->getTrack() != track)) {
+					found = false;
+					break;
+				}
+				if (!hre.search(word->fullword, query[i+k].word, "i")) {
+					found = false;
+					break;
+				}
+			}
+			if (!found) {
+				continue;
+			}
+			tcount++;
+			m_matchcount++;
+			for (int k=0; k<length; k++) {
+				markTextMatch(infile, *words[j+k]);
 			}
 		}
 	}
@@ -61465,11 +67619,13 @@ void Tool_msearch::doMusicSearch(HumdrumFile& infile, NoteGrid& grid,
 
 	vector<NoteCell*>  match;
 	int mcount = 0;
+	m_matchcount = 0;
 	for (int i=0; i<(int)attacks.size(); i++) {
 		for (int j=0; j<(int)attacks[i].size(); j++) {
 			checkForMatchDiatonicPC(attacks[i], j, query, match);
 			if (!match.empty()) {
 				mcount++;
+				m_matchcount++;
 				markMatch(infile, match);
 				// cerr << "FOUND MATCH AT " << i << ", " << j << endl;
 				// markNotes(attacks[i], j, (int)query.size());
@@ -61720,28 +67876,32 @@ bool Tool_msearch::checkForMatchDiatonicPC(vector<NoteCell*>& notes, int index,
 
 //////////////////////////////
 //
-// Tool_msearch::fillTextQuery --
+// Tool_msearch::fillTextQuery -- Split a text query into words.  Words
+//    inside of double quotes form a phrase.
 //
 
 void Tool_msearch::fillTextQuery(vector<MSearchTextQuery>& query,
 		const string& input) {
 	query.clear();
 	bool inquote = false;
+	bool phrase = false;  // next word in quotes continues a phrase
+	MSearchTextQuery temp;
 
-	query.resize(1);
-
-	for (int i=0; i<(int)input.size(); i++) {
-		if (input[i] == '"') {
-			inquote = !inquote;
-			query.resize(query.size() + 1);
+	int size = (int)input.size();
+	for (int i=0; i<=size; i++) {
+		if ((i < size) && (input[i] != '"') && !isspace(input[i])) {
+			temp.word.push_back(input[i]);
 			continue;
 		}
-		if (isspace(input[i])) {
-			query.resize(query.size() + 1);
+		if (!temp.word.empty()) {
+			temp.link = inquote && phrase;
+			query.push_back(temp);
+			phrase = inquote;
+			temp.clear();
 		}
-		query.back().word.push_back(input[i]);
-		if (inquote) {
-			query.back().link = true;
+		if ((i < size) && (input[i] == '"')) {
+			inquote = !inquote;
+			phrase = false;
 		}
 	}
 }
@@ -69001,6 +75161,8 @@ Tool_pccount::Tool_pccount(void) {
 	define("title=s", "Title for plot");
 	define("t|template|vega-template=b", "display the vega-lite template.");
 	define("w|width=i:400", "width of vega-lite plot");
+
+	allowParallelSegments();
 }
 
 
@@ -69819,6 +75981,8 @@ Tool_periodicity::Tool_periodicity(void) {
 	define("s|svg=b", "output svg image");
 	define("p|power=d:2.0", "scaling power for visual display");
 	define("1|one=b", "composite rhythms are not weighted by attack");
+
+	allowParallelSegments();
 }
 
 
@@ -69998,17 +76162,18 @@ void Tool_periodicity::printAttackGrid(ostream& out, HumdrumFile& infile, vector
 //
 
 void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy) {
-	HumNum elements = minrhy * infile.getScoreDuration() / 4;
+	// minrhy is four times tpq(), so grid positions are the same as ticks:
+	long long elements = infile.durationToTicks(infile.getScoreDuration());
 
 	for (int t=0; t<(int)grids.size(); t++) {
-		grids[t].resize(elements.getNumerator());
+		grids[t].resize(elements);
 	}
 
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
 		}
-		HumNum position = infile[i].getDurationFromStart() / 4 * minrhy;
+		long long position = infile[i].getTicksFromStart();
 		for (int j=0; j<infile[i].getFieldCount(); j++) {
 			HTp token = infile.token(i, j);
 			if (!token->isKern()) {
@@ -70021,7 +76186,7 @@ void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double
 				continue;
 			}
 			int track = token->getTrack();
-			grids.at(track).at(position.getNumerator()) += 1;
+			grids.at(track).at(position) += 1;
 		}
 	}
 
@@ -70595,6 +76760,8 @@ Tool_pnum::Tool_pnum(void) {
 	define("r|rest=s:0",         "representation string for rests");
 	define("R|no-rests=b",       "do not include rests in conversion");
 	define("x|attacks-only=b",   "only mark lines with note attacks");
+
+	allowParallelSegments();
 }
 
 
@@ -70825,6 +76992,8 @@ Tool_recip::Tool_recip(void) {
 	define("e|exinterp=s:**recip",   "use the given exinterp for data output");
 	define("n|kern-pitch=s:e",       "note to add for '-e kern' option");
 	define("kern=b",                 "equivalent to '-e kern' option");
+
+	allowParallelSegments();
 }
 
 
@@ -71002,7 +77171,9 @@ void Tool_recip::replaceKernWithRecip(HumdrumFile& infile) {
 					tok->setText(".");
 				}
 			} else {
-				hre.replaceDestructive(*tok, "", expression, "g");
+				string text = *tok;
+				hre.replaceDestructive(text, "", expression, "g");
+				tok->setText(text);
 			}
 			tok = tok->getNextToken();
 		}
@@ -71056,6 +77227,8 @@ void Tool_recip::initialize(HumdrumFile& infile) {
 Tool_restfill::Tool_restfill(void) {
 	define("y|hidden-rests=b",        "hide inserted rests");
 	define("i|exinterp=s:kern",       "type of spine to fill with rests");
+
+	allowParallelSegments();
 }
 
 
@@ -72940,6 +79113,8 @@ Tool_slurcheck::Tool_slurcheck(void) {
 	define("c|count=b", "count unclosed slur endings");
 	define("Z|no-zeros=b", "do not list files that have zero unclosed slurs in counts");
 	define("f|filename=b", "print filename for list and count options");
+
+	allowParallelSegments();
 }
 
 
@@ -73109,6 +79284,8 @@ void Tool_slurcheck::processFile(HumdrumFile& infile) {
 Tool_spinetrace::Tool_spinetrace(void) {
 	define("a|append=b", "append analysis to input data lines");
 	define("p|prepend=b", "prepend analysis to input data lines");
+
+	allowParallelSegments();
 }
 
 
@@ -73222,6 +79399,8 @@ void Tool_spinetrace::processFile(HumdrumFile& infile) {
 Tool_tabber::Tool_tabber(void) {
 	// do nothing for now.
 	define("r|remove=b",    "remove any extra tabs");
+
+	allowParallelSegments();
 }
 
 
@@ -75743,6 +81922,8 @@ void Tool_transpose::initialize(HumdrumFile& infile) {
 
 Tool_trillspell::Tool_trillspell(void) {
 	define("x=b", "mark trills with x (interpretation)");
+
+	allowParallelSegments();
 }
 
 
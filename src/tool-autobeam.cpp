@@ -36,6 +36,8 @@ Tool_autobeam::Tool_autobeam(void) {
 	define("l|lyric|lyrics=b",     "break beam by lyric syllables");
 	define("L|lyric-info=b",       "return the number of breaks needed");
 	define("rest|include-rests=b", "include rests in beam edges");
+
+	allowParallelSegments();
 }
 
 
@@ -48,6 +48,8 @@ Tool_autostem::Tool_autostem(void) {
 	define("version=b",       "Program version");
 	define("example=b",       "Program examples");
 	define("h|help=b",        "Short description");
+
+	allowParallelSegments();
 }
 
 
@@ -268,7 +270,7 @@ void Tool_autostem::setStemDirection(HumdrumFile& infile, int row, int col,
 	if (notlongQ) {
 		// Don't print stems on whole notes and breves.
 		// Duration units are in quarter notes.
-		HumNum value = Convert::recipToDuration(*infile.token(row,col));
+		HumNum value = Convert::recipToDuration(infile.token(row,col));
 		double duration = value.getFloat();
 		if ((duration >= 4.0) && (duration < 16.0)) {
 			return;
@@ -864,7 +866,7 @@ void Tool_autostem::processKernTokenStemsSimpleModel(HumdrumFile& infile,
 
 	HumNum duration;
 	if (tokencount == 1) {
-		duration = Convert::recipToDuration(*infile.token(i, j));
+		duration = Convert::recipToDuration(infile.token(i, j));
 		if (duration >= 4) {
 			// whole note or larger for note/chord, to not append a stem
 			return;
@@ -1147,7 +1149,7 @@ void Tool_autostem::getBeamState(vector<vector<string > >& beams,
 				// rests if beams extend over rests...
 				continue;
 			}
-			rn = Convert::recipToDuration(*infile.token(i, j));
+			rn = Convert::recipToDuration(infile.token(i, j));
 			if (rn >= 1) {
 				beamstate[track][curlayer[track]] = 0;
 				continue;
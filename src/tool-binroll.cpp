@@ -29,6 +29,8 @@ namespace hum {
 Tool_binroll::Tool_binroll(void) {
 	// add options here
 	define("t|timebase=s:16", "timebase to do analysis at");
+
+	allowParallelSegments();
 }
 
 
@@ -87,6 +89,7 @@ void Tool_binroll::processFile(HumdrumFile& infile) {
 	vector<vector<char>> output;
 	output.resize(128);
 	int count = (infile.getScoreDuration() / m_duration).getInteger() + 1;
+	m_tpq = infile.tpq();
 	for (int i=0; i<(int)output.size(); i++) {
 		output[i].resize(count);
 		std::fill(output[i].begin(), output[i].end(), 0);
@@ -187,6 +190,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 	int base12;
 	HumNum starttime;
 	HumNum duration;
+	long long startticks;
 	int startindex;
 	int endindex;
 	while (current && (current != ending)) {
@@ -202,7 +206,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 		if (current->isChord()) {
 			int stcount = current->getSubtokenCount();
 			starttime = current->getDurationFromStart();
-			startindex = (starttime / m_duration).getInteger();
+			startindex = getSlotIndex(current->getTicksFromStart());
 			for (int s=0; s<stcount; s++) {
 				string tok = current->getSubtoken(s);
 				base12 = Convert::kernToMidiNoteNumber(tok);
@@ -222,10 +226,9 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 				current = current->getNextToken();
 				continue;
 			}
-			starttime = current->getDurationFromStart();
-			duration = current->getDuration();
-			startindex = (starttime / m_duration).getInteger();
-			endindex   = ((starttime+duration) / m_duration).getInteger();
+			startticks = current->getTicksFromStart();
+			startindex = getSlotIndex(startticks);
+			endindex   = getSlotIndex(startticks + current->getTickDuration());
 			roll[base12][startindex] = 2;
 			for (int i=startindex+1; i<endindex; i++) {
 				roll[base12][i] = 1;
@@ -237,6 +240,19 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 
 
 
+//////////////////////////////
+//
+// Tool_binroll::getSlotIndex -- Convert a time in ticks into an index
+//    in the piano roll, where each slot has a duration of m_duration.
+//
+
+int Tool_binroll::getSlotIndex(long long ticks) {
+	return (int)(ticks * m_duration.getDenominator() /
+			((long long)m_tpq * m_duration.getNumerator()));
+}
+
+
+
 
 // END_MERGE
 
@@ -39,6 +39,8 @@ Tool_chord::Tool_chord(void) {
 	define("s|spine=i:-1",        "spine to process (indexed from 1)");
 	define("m|minimize=b",        "minimize chords");
 	define("M|maximize=b",        "maximize chords");
+
+	allowParallelSegments();
 }
 
 
@@ -16,6 +16,8 @@
 #include "Convert.h"
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
@@ -27,9 +29,11 @@ namespace hum {
 #define REST 0
 #define RESTINT -1000000
 #define RESTSTRING "R"
+#define RESTCODE RESTINT
 #define INTERVAL_HARMONIC 1
 #define INTERVAL_MELODIC  2
 #define MARKNOTES  1
+#define MODULE_BLOCK_SIZE 1024
 
 
 /////////////////////////////////
@@ -80,6 +84,8 @@ Tool_cint::Tool_cint(void) {
 	define("search=s:", "search string");
 	define("mark=b", "mark matches notes from searches in data");
 	define("count=b", "count matched modules from search query");
+	define("module-count|module-counts=b", "count modules in all input files");
+	define("pair-threads=i:1", "number of threads for analyzing pairs of voices (0 = all cores)");
 	define("debug=b");              // determine bad input line num
 	define("author=b");             // author of program
 	define("version=b");            // compilation info
@@ -146,6 +152,35 @@ bool Tool_cint::run(HumdrumFile& infile) {
 }
 
 
+//
+// Module counting for all files in a stream (--module-count):
+//
+
+bool Tool_cint::run(HumdrumFileStream& instream) {
+	initialize();
+	m_modulecounts.clear();
+	HumdrumFile infile;
+	while (instream.getFile(infile)) {
+		countModules(infile);
+	}
+	printModuleCounts();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::hasModuleCountMode -- Returns true if the tool should be
+//    given the input stream rather than individual files (--module-count
+//    option).
+//
+
+bool Tool_cint::hasModuleCountMode(void) {
+	return getBoolean("module-count");
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // NoteNode class functions:
@@ -225,15 +260,9 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 	vector<vector<NoteNode> > notes;
 	vector<string> names;
 	vector<int>    ktracks;
-	vector<HTp>    kstarts;
 	vector<int>    reverselookup;
 
-	infile.getSpineStartList(kstarts, "**kern");
-	ktracks.resize(kstarts.size());
-	for (int i=0; i<(int)kstarts.size(); i++) {
-		ktracks[i] = kstarts[i]->getTrack();
-	}
-
+	getKernTracks(ktracks, infile);
 	if (koptionQ) {
 		adjustKTracks(ktracks, getString("koption"));
 	}
@@ -309,6 +338,84 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_cint::countModules -- Add the modules of every pair of parts in a
+//     file to the module counts.  The modules are the same as those
+//     printed by printCombinations(), but are only stored as lists of
+//     interval codes.
+//
+
+void Tool_cint::countModules(HumdrumFile& infile) {
+	vector<int> ktracks;
+	getKernTracks(ktracks, infile);
+	if (koptionQ) {
+		adjustKTracks(ktracks, getString("koption"));
+	}
+	vector<int> reverselookup(infile.getTrackCount()+1, -1);
+	for (int i=0; i<(int)ktracks.size(); i++) {
+		reverselookup[ktracks[i]] = i;
+	}
+	vector<vector<NoteNode> > notes(ktracks.size());
+	extractNoteArray(notes, infile, ktracks, reverselookup);
+	if (notes.size() < 2) {
+		return;
+	}
+
+	vector<int> indexes;
+	vector<int> codes;
+	int parts = (int)notes.size();
+	for (int i=0; i+Chaincount<(int)notes[0].size(); i++) {
+		if (!infile[notes[0][i].line].isData()) {
+			// modules only start on data lines.
+			continue;
+		}
+		for (int part1=0; part1<parts-1; part1++) {
+			for (int part2=part1+1; part2<parts; part2++) {
+				if (!getModuleIndexes(indexes, notes, Chaincount, i, part1, part2)) {
+					continue;
+				}
+				int octaveadjust = 0;
+				if (octaveQ) {
+					octaveadjust = getOctaveAdjustForCombinationModule(notes,
+							Chaincount, i, part1, part2);
+				}
+				getModuleCodes(codes, notes, indexes, part1, part2, octaveadjust);
+				m_modulecounts[make_pair(codes, (int)indexes.size())]++;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printModuleCounts -- Print the modules counted by
+//     countModules(), sorted from most to least common.  Modules are
+//     formatted in the same way as for the module display, but without
+//     durations or IDs.
+//
+
+void Tool_cint::printModuleCounts(void) {
+	vector<pair<int, string>> lines;
+	lines.reserve(m_modulecounts.size());
+	for (auto& it : m_modulecounts) {
+		stringstream module;
+		printModuleCodes(module, it.first.first, it.first.second);
+		lines.emplace_back(-it.second, module.str());
+	}
+	sort(lines.begin(), lines.end());
+
+	m_humdrum_text << "**count\t**cint\n";
+	for (int i=0; i<(int)lines.size(); i++) {
+		m_humdrum_text << -lines[i].first << "\t" << lines[i].second << "\n";
+	}
+	m_humdrum_text << "*-\t*-\n";
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::adjustKTracks -- Select only two spines to do analysis on.
@@ -500,6 +607,8 @@ int  Tool_cint::printCombinations(vector<vector<NoteNode> >& notes,
 	int i;
 	int currentindex = 0;
 	int matchcount   = 0;
+	m_blockstart     = -1;
+	m_blockend       = -1;
 	for (i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].hasSpines()) {
 			// print all lines here which do not contain spine
@@ -587,6 +696,16 @@ int Tool_cint::printModuleCombinations(HumdrumFile& infile, int line, vector<int
 	// printAsCombination(infile, line, ktracks, reverselookup, ".");
 	// return currentindex;
 
+	if ((m_pairthreads > 1) && ((currentindex < m_blockstart) ||
+			(currentindex >= m_blockend))) {
+		int blockend = currentindex + MODULE_BLOCK_SIZE;
+		if (blockend > (int)notes[0].size()) {
+			blockend = (int)notes[0].size();
+		}
+		prepareModuleBlock(notes, infile, n, currentindex, blockend,
+				retrospective, searchstring);
+	}
+
 	int tracknext;
 	int track;
 	int j, jj;
@@ -631,9 +750,14 @@ int Tool_cint::printModuleCombinations(HumdrumFile& infile, int line, vector<int
 				int part1 = reverselookup[track];
 				int part2 = part1+1+jj;
 				// m_humdrum_text << part1 << "," << part2;
-				matchcount += printCombinationModulePrepare(m_humdrum_text, filename,
-						notes, n, currentindex, part1, part2, retrospective, infile,
-						searchstring);
+				if (m_pairthreads > 1) {
+					matchcount += printPreparedModule(m_humdrum_text, notes,
+							currentindex, part1, part2, retrospective);
+				} else {
+					matchcount += printCombinationModulePrepare(m_humdrum_text,
+							filename, notes, n, currentindex, part1, part2,
+							retrospective, infile, searchstring);
+				}
 			}
 		}
 
@@ -651,13 +775,17 @@ int Tool_cint::printModuleCombinations(HumdrumFile& infile, int line, vector<int
 
 //////////////////////////////
 //
-// Tool_cint::printCombinationModulePrepare --
+// Tool_cint::printCombinationModulePrepare -- If result is given, the
+//     notes to mark and the retrospective entry are stored in it rather
+//     than changed in notes and retrospective, so that pairs of parts
+//     can be prepared concurrently (see prepareModuleBlock()).
 //
 
 int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filename,
 		 vector<vector<NoteNode> >& notes, int n, int startline, int part1,
 		 int part2, vector<vector<string> >& retrospective,
-		HumdrumFile& infile, const string& searchstring) {
+		HumdrumFile& infile, const string& searchstring,
+		CintModuleText* result) {
 	int count = 0;
 	HumRegex hre;
 	stringstream tempstream;
@@ -684,7 +812,7 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 					double loc = infile[line].getDurationFromStart().getFloat() /
 							infile[infile.getLineCount()-1].getDurationFromStart().getFloat();
 					loc = int(100.0 * loc + 0.5)/100.0;
-					m_humdrum_text << "!!LOCATION:"
+					out << "!!LOCATION:"
 							<< "\t"  << loc
 							<< "\tm" << getMeasure(infile, line)
 							<< "\tv" << ((int)notes.size() - part2)
@@ -696,6 +824,9 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 					out << tempstream.str();
 					// newline already added somewhere previously.
 					// m_humdrum_text << "\n";
+				} else if (result) {
+					getModuleIndexes(result->marks, notes, n, startline, part1,
+							part2);
 				} else {
 					// mark notes of the matched module(s) in the note array
 					// for later marking in input score.
@@ -709,7 +840,10 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 
 			}
 		} else {
-			if (retroQ) {
+			if (retroQ && result) {
+				result->retroline = status;
+				result->retrotext = tempstream.str();
+			} else if (retroQ) {
 				int column = getTriangleIndex((int)notes.size(), part1, part2);
 				retrospective[column][status] = tempstream.str();
 			} else {
@@ -727,6 +861,104 @@ int Tool_cint::printCombinationModulePrepare(ostream& out, const string& filenam
 
 
 
+//////////////////////////////
+//
+// Tool_cint::prepareModuleBlock -- Calculate the module output of every
+//     pair of parts for the note array indexes from start to end-1
+//     (--pair-threads).  Each pair of parts is given to a separate
+//     thread, which only reads the note array.  The results are printed
+//     in the usual order by printPreparedModule().
+//
+
+void Tool_cint::prepareModuleBlock(vector<vector<NoteNode> >& notes,
+		HumdrumFile& infile, int n, int start, int end,
+		vector<vector<string> >& retrospective, const string& searchstring) {
+	int parts = (int)notes.size();
+	vector<pair<int, int>> pairs;
+	for (int i=0; i<parts-1; i++) {
+		for (int j=i+1; j<parts; j++) {
+			pairs.emplace_back(i, j);
+		}
+	}
+	if (locationQ && (infile.getLineCount() > 0)) {
+		// The rhythm analysis used by --location is done on demand, so
+		// it must be done before the threads are started.
+		infile[0].getDurationFromStart();
+	}
+	m_moduletexts.resize(pairs.size());
+	m_blockstart = start;
+	m_blockend = end;
+	string filename = infile.getFilename();
+
+	auto task = [&](int index) {
+		int part1 = pairs[index].first;
+		int part2 = pairs[index].second;
+		vector<CintModuleText>& texts = m_moduletexts[index];
+		texts.assign(end - start, CintModuleText());
+		stringstream out;
+		for (int i=start; i<end; i++) {
+			if ((i + n >= (int)notes[0].size()) ||
+					!infile[notes[0][i].line].isData()) {
+				// modules are only printed for data lines.
+				continue;
+			}
+			CintModuleText& text = texts[i - start];
+			out.str("");
+			text.count = printCombinationModulePrepare(out, filename, notes, n,
+					i, part1, part2, retrospective, infile, searchstring, &text);
+			text.text = out.str();
+		}
+	};
+
+	int count = (int)pairs.size();
+	int threads = m_pairthreads < count ? m_pairthreads : count;
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < count) {
+			task(index);
+		}
+	};
+	vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printPreparedModule -- Print the module of a pair of parts
+//     calculated by prepareModuleBlock(), and mark its notes or store its
+//     retrospective entry.  Returns the number of search matches.
+//
+
+int Tool_cint::printPreparedModule(ostream& out,
+		vector<vector<NoteNode> >& notes, int startline, int part1, int part2,
+		vector<vector<string> >& retrospective) {
+	int parts = (int)notes.size();
+	// index of the pair in the list made by prepareModuleBlock():
+	int index = part1 * (2 * parts - part1 - 1) / 2 + (part2 - part1 - 1);
+	CintModuleText& text = m_moduletexts.at(index).at(startline - m_blockstart);
+	out << text.text;
+	for (int i=0; i<(int)text.marks.size(); i++) {
+		notes[part1][text.marks[i]].mark = 1;
+		notes[part2][text.marks[i]].mark = 1;
+	}
+	if (text.retroline >= 0) {
+		int column = getTriangleIndex(parts, part1, part2);
+		retrospective[column][text.retroline] = text.retrotext;
+	}
+	return text.count;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::getMeasure -- return the last measure number of the given line index.
@@ -1032,19 +1264,20 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 
 	notemarker = '\0';
 
-	if (norestsQ) {
-		if (notes[part1][startline].b40 == 0) {
-			return 0;
-		}
-		if (notes[part2][startline].b40 == 0) {
-			return 0;
-		}
+	vector<int> indexes;
+	int retroline = getModuleIndexes(indexes, notes, n, startline, part1, part2);
+	if (!retroline) {
+		return 0;
 	}
 
-	stringstream idstream;
-
-	// int crossing =  0;
-	//int oldcrossing =  0;
+	int i;
+	if (markstate) {
+		for (i=0; i<(int)indexes.size(); i++) {
+			notes[part1][indexes[i]].mark = 1;
+			notes[part2][indexes[i]].mark = 1;
+		}
+		return retroline;
+	}
 
 	int octaveadjust = 0;   // used for -o option
 	if (octaveQ) {
@@ -1052,10 +1285,84 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 				part1, part2);
 	}
 
-	ostream *outp = &out;
-	// if (rawQ && !searchQ) {
-	//    outp = &m_humdrum_text;
-	// }
+	vector<int> codes;
+	getModuleCodes(codes, notes, indexes, part1, part2, octaveadjust);
+
+	if (raw2Q) {
+		// print pitch of first bottom note
+		if (filenameQ) {
+			out << "file_" << filename;
+			out << " ";
+		}
+
+		out << "v_" << part1 << " v_" << part2 << " ";
+
+		if (base12Q) {
+			out << "base12_";
+			out << Convert::base40ToMidiNoteNumber(abs(notes[part1][startline].b40));
+		} else if (base40Q) {
+			out << "base40_";
+			out << abs(notes[part1][startline].b40);
+		} else {
+			out << "base7_";
+			out << Convert::base40ToDiatonic(abs(notes[part1][startline].b40));
+		}
+		out << " ";
+	}
+
+	printModuleCodes(out, codes, (int)indexes.size(), &notes, &indexes, part1,
+			part2);
+
+	// print the ids string if requested
+	if (idQ) {
+		out << " ID:";
+		for (i=0; i<(int)indexes.size(); i++) {
+			if (i > 0) {
+				out << ':';
+			}
+			out << notes[part1][indexes[i]].getId() << ':'
+			    << notes[part2][indexes[i]].getId();
+		}
+		out << ends;
+	}
+
+	// keep track of notemarker state
+	for (i=0; i<(int)indexes.size(); i++) {
+		if ((notes[part1][indexes[i]].notemarker == NoteMarker) ||
+				(notes[part2][indexes[i]].notemarker == NoteMarker)) {
+			notemarker = NoteMarker;
+		}
+	}
+
+	return retroline;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getModuleIndexes -- Return the indexes of the sonorities
+//      in notes which form a counterpoint module (chain) starting at
+//      startline, for the pair of parts.  Sonorities in which both notes
+//      are sustained are skipped.  Returns the index of the last sonority
+//      of the module, or 0 if there is no valid module at the start line
+//      (see printCombinationModule()).
+//
+
+int Tool_cint::getModuleIndexes(vector<int>& indexes,
+		vector<vector<NoteNode> >& notes, int n, int startline, int part1,
+		int part2) {
+
+	indexes.clear();
+
+	if (norestsQ) {
+		if (notes[part1][startline].b40 == 0) {
+			return 0;
+		}
+		if (notes[part2][startline].b40 == 0) {
+			return 0;
+		}
+	}
 
 	if (n + startline >= (int)notes[0].size()) { // [20150202]
 		// definitely nothing to do
@@ -1073,37 +1380,10 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 		return 0;
 	}
 
-	if (raw2Q) {
-		// print pitch of first bottom note
-		if (filenameQ) {
-			(*outp) << "file_" << filename;
-			(*outp) << " ";
-		}
-
-		(*outp) << "v_" << part1 << " v_" << part2 << " ";
-
-		if (base12Q) {
-			(*outp) << "base12_";
-			(*outp) << Convert::base40ToMidiNoteNumber(abs(notes[part1][startline].b40));
-		} else if (base40Q) {
-			(*outp) << "base40_";
-			(*outp) << abs(notes[part1][startline].b40);
-		} else {
-			(*outp) << "base7_";
-			(*outp) << Convert::base40ToDiatonic(abs(notes[part1][startline].b40));
-		}
-		(*outp) << " ";
-	}
-
-	if (parenQ) {
-		(*outp) << "(";
-	}
-
 	int i;
 	int count = 0;
 	int countm = 0;
 	int attackcount = 0;
-	int idstart = 0;
 
 	int lastindex = -1;
 	int retroline = 0;
@@ -1131,125 +1411,25 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 			}
 		}
 
-		// print the melodic intervals (if not the first item in chain)
-		if ((count > 0) && !nomelodicQ) {
-			if (mparenQ) {
-				(*outp) << "{";
-			}
-
-			if (nounisonsQ) {
-				// suppress modules which contain melodic perfect unisons:
-				if ((notes[part1][i].b40 != 0) &&
-					(abs(notes[part1][i].b40) == abs(notes[part1][lastindex].b40))) {
-					return 0;
-				}
-				if ((notes[part2][i].b40 != 0) &&
-					(abs(notes[part2][i].b40) == abs(notes[part2][lastindex].b40))) {
-					return 0;
-				}
-			}
-			// bottom melodic interval:
-			if (!toponlyQ) {
-				printInterval((*outp), notes[part1][lastindex],
-						notes[part1][i], INTERVAL_MELODIC);
-				if (mmarkerQ) {
-					(*outp) << "m";
-				}
-			}
-
-			// print top melodic interval here if requested
-			if (topQ || toponlyQ) {
-				if (!toponlyQ) {
-					printSpacer((*outp));
-				}
-				// top melodic interval:
-				printInterval((*outp), notes[part2][lastindex],
-						notes[part2][i], INTERVAL_MELODIC);
-				if (mmarkerQ) {
-					(*outp) << "m";
-				}
+		if ((count > 0) && !nomelodicQ && nounisonsQ) {
+			// suppress modules which contain melodic perfect unisons:
+			if ((notes[part1][i].b40 != 0) &&
+				(abs(notes[part1][i].b40) == abs(notes[part1][lastindex].b40))) {
+				return 0;
 			}
-
-			if (mparenQ) {
-				(*outp) << "}";
+			if ((notes[part2][i].b40 != 0) &&
+				(abs(notes[part2][i].b40) == abs(notes[part2][lastindex].b40))) {
+				return 0;
 			}
-			printSpacer((*outp));
 		}
 
 		countm++;
-
-		// print harmonic interval
-		if (!noharmonicQ) {
-			if (hparenQ) {
-			  (*outp) << "[";
-			}
-			if (markstate) {
-				notes[part1][i].mark = 1;
-				notes[part2][i].mark = 1;
-			} else {
-				// oldcrossing = crossing;
-				//crossing = printInterval((*outp), notes[part1][i],
-				//      notes[part2][i], INTERVAL_HARMONIC, octaveadjust);
-				printInterval((*outp), notes[part1][i],
-						notes[part2][i], INTERVAL_HARMONIC, octaveadjust);
-			}
-
-			if (durationQ) {
-				if (notes[part1][i].isAttack()) {
-					(*outp) << "D" << notes[part1][i].duration;
-				}
-				if (notes[part2][i].isAttack()) {
-					(*outp) << "d" << notes[part1][i].duration;
-				}
-			}
-
-			if (hmarkerQ) {
-				(*outp) << "h";
-			}
-			if (hparenQ) {
-			  (*outp) << "]";
-			}
-		}
-
-		// prepare the ids string if requested
-		if (idQ) {
-		//   if (count == 0) {
-				// insert both first two notes, even if sustain.
-				if (idstart != 0) { idstream << ':'; }
-				idstart++;
-				idstream << notes[part1][i].getId() << ':'
-							<< notes[part2][i].getId();
-		//   } else {
-		//      // only insert IDs if an attack
-		//      if (notes[part1][i].b40 > 0) {
-		//         if (idstart != 0) { idstream << ':'; }
-		//         idstart++;
-		//         idstream << notes[part1][i].getId();
-		//      }
-		//      if (notes[part2][i].b40 > 0) {
-		//         if (idstart != 0) { idstream << ':'; }
-		//         idstart++;
-		//         idstream << notes[part2][i].getId();
-		//      }
-		//   }
-		}
-
-		// keep track of notemarker state
-		if (notes[part1][i].notemarker == NoteMarker) {
-			notemarker = NoteMarker;
-		}
-		if (notes[part2][i].notemarker == NoteMarker) {
-			notemarker = NoteMarker;
-		}
+		indexes.push_back(i);
 
 		// if count matches n, then exit loop
 		if ((count == n) && !attackQ) {
 			retroline = i;
 			break;
-		} else {
-			if (!noharmonicQ) {
-				printSpacer((*outp));
-			}
 		}
 		lastindex = i;
 		count++;
@@ -1266,15 +1446,6 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 
 	}
 
-	if (parenQ) {
-		(*outp) << ")";
-	}
-
-	if (idQ && idstart) {
-		idstream << ends;
-		(*outp) << " ID:" << idstream.str();
-	}
-
 	if (attackQ && (attackcount == n)) {
 		return retroline;
 	} else if ((countm>1) && (count == n)) {
@@ -1282,7 +1453,7 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 	} else if (n == 0) {
 		return retroline;
 	} else {
-		// did not print the required number of modules.
+		// did not find the required number of modules.
 		return 0;
 	}
 
@@ -1291,6 +1462,120 @@ int Tool_cint::printCombinationModule(ostream& out, const string& filename,
 
 
 
+//////////////////////////////
+//
+// Tool_cint::getModuleCodes -- Convert the sonorities of a module from
+//      getModuleIndexes() into a list of interval codes, in the order
+//      in which they are printed: for each sonority after the first,
+//      the bottom and/or top melodic intervals (unless -M), followed by
+//      the harmonic interval of the sonority (unless -H).
+//
+
+void Tool_cint::getModuleCodes(vector<int>& codes,
+		vector<vector<NoteNode> >& notes, vector<int>& indexes, int part1,
+		int part2, int octaveadjust) {
+	codes.clear();
+	for (int i=0; i<(int)indexes.size(); i++) {
+		int index = indexes[i];
+		if ((i > 0) && !nomelodicQ) {
+			int lastindex = indexes[i-1];
+			if (!toponlyQ) {
+				codes.push_back(getIntervalCode(notes[part1][lastindex],
+						notes[part1][index], INTERVAL_MELODIC));
+			}
+			if (topQ || toponlyQ) {
+				codes.push_back(getIntervalCode(notes[part2][lastindex],
+						notes[part2][index], INTERVAL_MELODIC));
+			}
+		}
+		if (!noharmonicQ) {
+			codes.push_back(getIntervalCode(notes[part1][index],
+					notes[part2][index], INTERVAL_HARMONIC, octaveadjust));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printModuleCodes -- Print a module from the interval codes
+//      of getModuleCodes(), for a module with the given number of
+//      sonorities.  Durations (--dur) are only printed if the notes and
+//      indexes of the module are given.
+//
+
+void Tool_cint::printModuleCodes(ostream& out, const vector<int>& codes, int steps,
+		vector<vector<NoteNode> >* notes, vector<int>* indexes, int part1,
+		int part2) {
+	int c = 0;
+	if (parenQ) {
+		out << "(";
+	}
+	for (int i=0; i<steps; i++) {
+		if ((i > 0) && !nomelodicQ) {
+			if (mparenQ) {
+				out << "{";
+			}
+			// bottom melodic interval:
+			if (!toponlyQ) {
+				printIntervalCode(out, codes.at(c++));
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			// top melodic interval:
+			if (topQ || toponlyQ) {
+				if (!toponlyQ) {
+					printSpacer(out);
+				}
+				printIntervalCode(out, codes.at(c++));
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			if (mparenQ) {
+				out << "}";
+			}
+			printSpacer(out);
+		}
+
+		// harmonic interval
+		if (!noharmonicQ) {
+			if (hparenQ) {
+			  out << "[";
+			}
+			printIntervalCode(out, codes.at(c++));
+			if (durationQ && notes && indexes) {
+				int index = indexes->at(i);
+				if ((*notes)[part1][index].isAttack()) {
+					out << "D" << (*notes)[part1][index].duration;
+				}
+				if ((*notes)[part2][index].isAttack()) {
+					out << "d" << (*notes)[part1][index].duration;
+				}
+			}
+			if (hmarkerQ) {
+				out << "h";
+			}
+			if (hparenQ) {
+			  out << "]";
+			}
+		}
+
+		// The spacer after the last harmonic interval is only printed
+		// for --attacks modules.
+		if (((i < steps - 1) || attackQ) && !noharmonicQ) {
+			printSpacer(out);
+		}
+	}
+	if (parenQ) {
+		out << ")";
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::printAsCombination --
@@ -1863,22 +2148,47 @@ int Tool_cint::printLatticeItem(vector<vector<NoteNode> >& notes, int n, int cur
 
 //////////////////////////////
 //
-// Tool_cint::printInterval --
+// Tool_cint::printInterval -- Print the interval between two notes.
+//     Returns true if the harmonic interval is crossed.
 //
 
 int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		int type, int octaveadjust) {
+	printIntervalCode(out, getIntervalCode(note1, note2, type, octaveadjust));
 	if ((note1.b40 == REST) || (note2.b40 == REST)) {
-		out << RESTSTRING;
 		return 0;
 	}
-	int cross = 0;
+	if ((type == INTERVAL_HARMONIC) && (abs(note2.b40) < abs(note1.b40))) {
+		return 1;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getIntervalCode -- Return the interval between two notes
+//     as an integer code, in the units of the display options (base-7,
+//     base-12 or base-40).  The interval is stored in the upper bits of
+//     the code, and the lowest three bits store the sustain/attack state
+//     of the two notes when it is displayed:
+//        bit 2: sustain/attack state is displayed
+//        bit 1: first note is sustained
+//        bit 0: second note is sustained
+//     Rests give RESTCODE.  Use printIntervalCode() to print the code.
+//
+
+int Tool_cint::getIntervalCode(NoteNode& note1, NoteNode& note2, int type,
+		int octaveadjust) {
+	if ((note1.b40 == REST) || (note2.b40 == REST)) {
+		return RESTCODE;
+	}
 	int pitch1 = abs(note1.b40);
 	int pitch2 = abs(note2.b40);
 	int interval = pitch2 - pitch1;
 
 	if ((type == INTERVAL_HARMONIC) && (interval < 0)) {
-		cross = 1;
 		if (uncrossQ) {
 			interval = -interval;
 		}
@@ -1936,6 +2246,35 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		interval = interval + octaveadjust  * 7;
 	}
 
+	int flags = 0;
+	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+		flags |= 4;
+		if (note1.b40 < 0) {
+			flags |= 2;
+		}
+		if (note2.b40 < 0) {
+			flags |= 1;
+		}
+	}
+
+	return interval * 8 + flags;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printIntervalCode -- Print an interval code from
+//     getIntervalCode().
+//
+
+void Tool_cint::printIntervalCode(ostream& out, int code) {
+	if (code == RESTCODE) {
+		out << RESTSTRING;
+		return;
+	}
+	int flags = code & 7;
+	int interval = (code - flags) / 8;
 
 	if (chromaticQ) {
 		out << Convert::base40ToIntervalAbbr(interval);
@@ -1952,21 +2291,11 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		}
 	}
 
-	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+	if (flags & 4) {
 		// print sustain/attack information of intervals.
-		if (note1.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
-		if (note2.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
+		out << ((flags & 2) ? "s" : "x");
+		out << ((flags & 1) ? "s" : "x");
 	}
-
-	return cross;
 }
 
 
@@ -2514,25 +2843,16 @@ void Tool_cint::getAbbreviation(string& abbr, string& name) {
 
 //////////////////////////////
 //
-// Tool_cint::getKernTracks -- return a list of track number for **kern spines.
+// Tool_cint::getKernTracks -- return a list of track number for **kern spines,
+//     including spines which start after the first line of the file.
 //
 
 void Tool_cint::getKernTracks(vector<int>& ktracks, HumdrumFile& infile) {
-	int i, j;
-	ktracks.reserve(infile.getTrackCount()+1);
-	ktracks.resize(0);
-	int track;
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		for (j=0; j<infile[i].getFieldCount(); j++) {
-			if (infile.token(i, j)->isKern()) {
-				track = infile.token(i, j)->getTrack();
-				ktracks.push_back(track);
-			}
-		}
-		break;
+	vector<HTp> kstarts;
+	infile.getSpineStartList(kstarts, "**kern");
+	ktracks.resize(kstarts.size());
+	for (int i=0; i<(int)kstarts.size(); i++) {
+		ktracks[i] = kstarts[i]->getTrack();
 	}
 }
 
@@ -2679,6 +2999,13 @@ void Tool_cint::initialize(void) {
 	uncrossQ     = getBoolean("uncross");
 	locationQ    = getBoolean("location");
 	retroQ       = getBoolean("retrospective");
+	m_pairthreads = getInteger("pair-threads");
+	if (m_pairthreads <= 0) {
+		m_pairthreads = (int)std::thread::hardware_concurrency();
+	}
+	if (m_pairthreads < 1) {
+		m_pairthreads = 1;
+	}
 	NoteMarker   = 0;
 	if (getBoolean("note-marker")) {
 		NoteMarker = getString("note-marker").c_str()[0];
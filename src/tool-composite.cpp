@@ -115,9 +115,9 @@ void Tool_composite::processFile(HumdrumFile& infile) {
 		extract.setModified("s", "0,1-$");
 	}
 
-	vector<HumNum> durations(infile.getLineCount());
+	vector<long long> durations(infile.getLineCount());
 	for (int i=0; i<infile.getLineCount(); i++) {
-		durations[i] = infile[i].getDuration();
+		durations[i] = infile[i].getTickDuration();
 	}
 
 	vector<bool> isRest(infile.getLineCount(), false);
@@ -294,18 +294,18 @@ HumNum Tool_composite::getLineDuration(HumdrumFile& infile, int index, vector<bo
 	if (!infile[index].isData()) {
 		return 0;
 	}
-	HumNum output = infile[index].getDuration();
+	long long ticks = infile[index].getTickDuration();
 	for (int i=index+1; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
 		}
 		if (isNull[i]) {
-			output += infile[i].getDuration();
+			ticks += infile[i].getTickDuration();
 		} else {
 			break;
 		}
 	}
-	return output;
+	return infile.ticksToDuration(ticks);
 }
 
 
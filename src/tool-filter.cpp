@@ -50,6 +50,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 
 using namespace std;
@@ -69,7 +70,7 @@ namespace hum {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE.readString(tool->getHumdrumText());   \
+		updateFromToolOutput(INFILE, tool->getHumdrumText()); \
 	}                                               \
 	delete tool;
 
@@ -110,6 +111,9 @@ namespace hum {
 
 Tool_filter::Tool_filter(void) {
 	define("debug=b", "print debug statement");
+	define("reparse=b", "reparse Humdrum output of each tool rather than updating input file");
+
+	allowParallelSegments();
 }
 
 
@@ -245,6 +249,270 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// Tool_filter::updateFromToolOutput -- Make the input file match the
+//    Humdrum text output of a tool.  Tools often print the input file
+//    after changing some of its tokens (or print changed tokens in place
+//    of the originals).  When the output has the same lines and spine
+//    structure as the input file, the changed tokens are updated directly
+//    in the input file, so that the next tool in the chain does not have
+//    to wait for the entire file to be parsed and analyzed again.  Changes
+//    to null tokens or note durations are repaired locally afterwards with
+//    HumdrumFile::reanalyzeEdits().  If the structure changed, or a change
+//    would affect the spine analysis of the file (comments, spine
+//    manipulators or slurs), the file is re-read from the text instead.
+//
+
+void Tool_filter::updateFromToolOutput(HumdrumFile& infile, const string& text) {
+	if (m_reparseQ) {
+		infile.readString(text);
+		return;
+	}
+
+	const char* ptr = text.data();
+	const char* end = ptr + text.size();
+	int lineindex = 0;
+	bool valid = true;
+	m_rewrittenQ = false;
+	while (ptr < end) {
+		const char* eol = (const char*)memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			eol = end;
+		}
+		int length = (int)(eol - ptr);
+		if ((length > 0) && (ptr[length-1] == '\r')) {
+			length--;
+		}
+		if (lineindex >= infile.getLineCount()) {
+			valid = false;
+			break;
+		}
+		if ((infile[lineindex].getOwner() != &infile) ||
+				(infile[lineindex].getLineIndex() != lineindex)) {
+			// The tool inserted or deleted lines in the input file
+			// without analyzing it again.
+			valid = false;
+			break;
+		}
+		if (!updateLineFromText(infile[lineindex], ptr, length)) {
+			valid = false;
+			break;
+		}
+		lineindex++;
+		ptr = eol + 1;
+	}
+	if (lineindex != infile.getLineCount()) {
+		valid = false;
+	}
+
+	if (!valid) {
+		if (m_debugQ) {
+			cerr << "!! filter: reparsing tool output" << endl;
+		}
+		infile.readString(text);
+		return;
+	}
+	if (m_rewrittenQ) {
+		// Links and other values calculated by content analyses (such as
+		// ties) may refer to the old contents of the rewritten tokens.
+		clearAutoParameters(infile);
+	}
+	if (infile.hasEdits()) {
+		infile.reanalyzeEdits();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::clearAutoParameters -- Remove the parameters in the "auto"
+//    namespace, which are set by content analyses such as slur and tie
+//    linking, from all tokens in the file.  Content analyses which were
+//    already done are done again by reanalyzeEdits() (see
+//    updateLineFromText()).
+//
+
+void Tool_filter::clearAutoParameters(HumdrumFile& infile) {
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			infile.token(i, j)->deleteValues("", "auto");
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::updateLineFromText -- Update the tokens of a line to match
+//    a line of text output from a tool.  Returns false if the line cannot
+//    be updated in place, in which case the file should be re-read.
+//
+
+bool Tool_filter::updateLineFromText(HumdrumLine& line, const char* text,
+		int length) {
+	if ((line.size() == (size_t)length) && (line.compare(0, length, text, length) == 0)) {
+		// Line is unchanged (but check that the tokens were not changed
+		// without updating the line text).
+		if (!line.hasSpines()) {
+			return true;
+		}
+		int tcount = line.getTokenCount();
+		int start = 0;
+		for (int i=0; i<tcount; i++) {
+			HTp token = line.token(i);
+			if (!isAnalyzedToken(line, token, i)) {
+				return false;
+			}
+			int tlen = (int)token->size();
+			if (start + tlen > length) {
+				return false;
+			}
+			if (token->compare(0, tlen, text + start, tlen) != 0) {
+				return false;
+			}
+			start += tlen;
+			if (i < tcount - 1) {
+				if ((start >= length) || (text[start] != '\t')) {
+					return false;
+				}
+				start++;
+			}
+		}
+		return start == length;
+	}
+
+	// Only the contents of data, barline and (non-manipulator)
+	// interpretation lines can be changed in place.
+	if (!(line.isData() || line.isBarline() || line.isInterpretation())) {
+		return false;
+	}
+
+	int tcount = line.getTokenCount();
+	int start = 0;
+	bool changed = false;
+	for (int i=0; i<tcount; i++) {
+		if (start > length) {
+			return false;
+		}
+		const char* tab = (const char*)memchr(text + start, '\t', length - start);
+		int stop = tab ? (int)(tab - text) : length;
+		if ((i < tcount - 1) && (tab == NULL)) {
+			// fewer fields in output
+			return false;
+		}
+		if ((i == tcount - 1) && (tab != NULL)) {
+			// more fields in output
+			return false;
+		}
+		HTp token = line.token(i);
+		if (!isAnalyzedToken(line, token, i)) {
+			return false;
+		}
+		int tlen = stop - start;
+		if ((token->size() != (size_t)tlen) || (token->compare(0, tlen, text + start, tlen) != 0)) {
+			string newtext(text + start, tlen);
+			if (newtext.empty()) {
+				return false;
+			}
+			// The new token must be of the same type as the line.
+			char first = newtext[0];
+			if (line.isData() && ((first == '!') || (first == '*') || (first == '='))) {
+				return false;
+			} else if (line.isBarline() && (first != '=')) {
+				return false;
+			} else if (line.isInterpretation() && (first != '*')) {
+				return false;
+			}
+			if (line.isInterpretation()) {
+				if (token->isManipulator() || token->isExclusiveInterpretation()) {
+					return false;
+				}
+			}
+			bool oldnull = token->isNull();
+			if (getSlurMarkers(*token) != getSlurMarkers(newtext)) {
+				// slur linking would need to be analyzed again
+				return false;
+			}
+			token->setText(newtext);
+			if (line.isInterpretation()) {
+				if (token->isManipulator() || token->isExclusiveInterpretation()) {
+					return false;
+				}
+			}
+			if (line.isData()) {
+				if (token->hasRhythm() && !(token->isKern() || token->isMens())) {
+					return false;
+				}
+			} else if (token->isNull() != oldnull) {
+				return false;
+			}
+			changed = true;
+		}
+		start = stop + 1;
+	}
+
+	if (changed) {
+		line.createLineFromTokens();
+		m_rewrittenQ = true;
+		HumdrumFile* owner = line.getOwner();
+		if (owner && (owner->isAnalyzed(ANALYZE_SLURS) ||
+				owner->isAnalyzed(ANALYZE_TIES) ||
+				owner->isAnalyzed(ANALYZE_ACCIDENTALS))) {
+			// so that reanalyzeEdits() does the content analyses again
+			line.markEdited();
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::isAnalyzedToken -- Returns true if the token was part of
+//    the spine analysis of the file (and not added to the line by the
+//    tool, such as when a tool adds a new spine to the input file).
+//
+
+bool Tool_filter::isAnalyzedToken(HumdrumLine& line, HTp token, int field) {
+	if (token->getOwner() != &line) {
+		return false;
+	}
+	if (token->getFieldIndex() != field) {
+		return false;
+	}
+	return token->getTrack() > 0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_filter::getSlurMarkers -- Return the slur start, slur end and
+//    elision characters in a token, in order.
+//
+
+string Tool_filter::getSlurMarkers(const string& text) {
+	string output;
+	for (int i=0; i<(int)text.size(); i++) {
+		switch (text[i]) {
+			case '(':
+			case ')':
+			case '&':
+				output += text[i];
+		}
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_filter::removeGlobalFilterLines --
@@ -371,6 +639,7 @@ void Tool_filter::getUniversalCommandList(vector<pair<string, string> >& command
 
 void Tool_filter::initialize(HumdrumFile& infile) {
 	m_debugQ = getBoolean("debug");
+	m_reparseQ = getBoolean("reparse");
 }
 
 
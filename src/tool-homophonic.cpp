@@ -40,6 +40,8 @@ Tool_homophonic::Tool_homophonic(void) {
 	define("s|score=d:1.0", "Score assigned to a sonority with three or more attacks");
 	define("m|intermediate-score=d:0.5", "Score to give sonority between two adjacent attack sonoroties");
 	define("l|letter=b", "Display letter scoress before calculations");
+
+	allowParallelSegments();
 }
 
 
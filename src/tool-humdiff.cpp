@@ -13,7 +13,9 @@
 #include "tool-humdiff.h"
 #include "HumRegex.h"
 #include "Convert.h"
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 using namespace std;
 
@@ -165,8 +167,16 @@ void Tool_humdiff::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 
 void Tool_humdiff::compareFiles(HumdrumFileSet& humset) {
 	vector<vector<TimePoint>> timepoints(humset.getSize());;
+	vector<int> tpqs(humset.getSize());
 	for (int i=0; i<humset.getSize(); i++) {
 		extractTimePoints(timepoints.at(i), humset[i]);
+		tpqs.at(i) = humset[i].tpq();
+	}
+
+	// Convert the tick times of each file to a common timebase.  If that
+	// timebase does not fit in 64 bits, compare the HumNum timestamps instead:
+	if (!setCommonTicks(timepoints, tpqs)) {
+		setTimestampTicks(timepoints);
 	}
 
 	if (getBoolean("time-points")) {
@@ -180,6 +190,66 @@ void Tool_humdiff::compareFiles(HumdrumFileSet& humset) {
 
 
 
+//////////////////////////////
+//
+// Tool_humdiff::setCommonTicks -- Scale the tick times of each file to
+//     the LCM of the ticks-per-quarter values of the files.  Returns false
+//     (leaving the timepoints unchanged) if the scaled ticks would overflow.
+//
+
+bool Tool_humdiff::setCommonTicks(vector<vector<TimePoint>>& timepoints,
+		vector<int>& tpqs) {
+	long long tpq = Convert::getLcm64(tpqs);
+	if (tpq <= 0) {
+		return false;
+	}
+	vector<long long> factors(timepoints.size());
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		factors.at(i) = tpq / tpqs.at(i);
+		if (timepoints.at(i).empty()) {
+			continue;
+		}
+		long long maxticks = timepoints.at(i).back().ticks;
+		if (maxticks > std::numeric_limits<long long>::max() / factors.at(i)) {
+			return false;
+		}
+	}
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		for (auto& tp : timepoints.at(i)) {
+			tp.ticks *= factors.at(i);
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::setTimestampTicks -- Replace the tick times with the rank
+//     of each timestamp among all of the timestamps in the files, so that
+//     timepoints are ordered and matched by their HumNum timestamps.
+//
+
+void Tool_humdiff::setTimestampTicks(vector<vector<TimePoint>>& timepoints) {
+	vector<HumNum> timestamps;
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		for (auto& tp : timepoints.at(i)) {
+			timestamps.push_back(tp.timestamp);
+		}
+	}
+	std::sort(timestamps.begin(), timestamps.end());
+	timestamps.erase(std::unique(timestamps.begin(), timestamps.end()), timestamps.end());
+	for (int i=0; i<(int)timepoints.size(); i++) {
+		for (auto& tp : timepoints.at(i)) {
+			tp.ticks = std::lower_bound(timestamps.begin(), timestamps.end(),
+					tp.timestamp) - timestamps.begin();
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_humdiff::printTimePoints --
@@ -202,8 +272,8 @@ ostream& Tool_humdiff::printTimePoints(ostream& out, vector<TimePoint>& timepoin
 
 ostream& Tool_humdiff::compareTimePoints(ostream& out, vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset) {
 	vector<int> indexes(timepoints.size(), 0);
-	HumNum minval;
-	HumNum value;
+	long long minval;
+	long long value;
 	int found;
 
 	vector<int> increment(timepoints.size(), 0);
@@ -220,12 +290,12 @@ ostream& Tool_humdiff::compareTimePoints(ostream& out, vector<vector<TimePoint>>
 		for (int i=1; i<(int)timepoints.size(); i++) {
 			timepoints.at(0).at(indexes.at(0)).index.at(i) = -1;
 		}
-		minval = timepoints.at(0).at(indexes.at(0)).timestamp;
+		minval = timepoints.at(0).at(indexes.at(0)).ticks;
 		for (int i=1; i<(int)timepoints.size(); i++) {
 			if (indexes.at(i) >= (int)timepoints.at(i).size()) {
 				continue;
 			}
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
+			value = timepoints.at(i).at(indexes.at(i)).ticks;
 			if (value < minval) {
 				minval = value;
 			}
@@ -239,7 +309,7 @@ ostream& Tool_humdiff::compareTimePoints(ostream& out, vector<vector<TimePoint>>
 				continue;
 			}
 			found = 1;
-			value = timepoints.at(i).at(indexes.at(i)).timestamp;
+			value = timepoints.at(i).at(indexes.at(i)).ticks;
 
 			if (value == minval) {
 				timepoints.at(0).at(indexes.at(0)).index.at(i) = timepoints.at(i).at(indexes.at(i)).index.at(0);
@@ -311,7 +381,7 @@ void Tool_humdiff::markNote(NotePoint& np) {
 // Tool_humdiff::compareLines --
 //
 
-void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
+void Tool_humdiff::compareLines(long long minval, vector<int>& indexes,
 		vector<vector<TimePoint>>& timepoints, HumdrumFileSet& humset) {
 
 	bool reportQ = getBoolean("report");
@@ -322,7 +392,7 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 		if (indexes.at(i) >= (int)timepoints.at(i).size()) {
 			continue;
 		}
-		if (timepoints.at(i).at(indexes.at(i)).timestamp != minval) {
+		if (timepoints.at(i).at(indexes.at(i)).ticks != minval) {
 			// not at the same time
 			continue;
 		}
@@ -483,7 +553,7 @@ void Tool_humdiff::extractTimePoints(vector<TimePoint>& points, HumdrumFile& inf
 		if (!infile[i].isData()) {
 			continue;
 		}
-		if (infile[i].getDuration() == 0) {
+		if (infile[i].getTickDuration() == 0) {
 			// ignore grace notes for now
 			continue;
 		}
@@ -491,6 +561,7 @@ void Tool_humdiff::extractTimePoints(vector<TimePoint>& points, HumdrumFile& inf
 		tp.file.push_back(&infile);
 		tp.index.push_back(i);
 		tp.timestamp = infile[i].getDurationFromStart();
+		tp.ticks = infile[i].getTicksFromStart();
 		tp.measure = measure;
 		points.push_back(tp);
 	}
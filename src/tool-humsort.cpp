@@ -37,6 +37,8 @@ Tool_humsort::Tool_humsort(void) {
 	define("s|spine=i:1", "Spine to sort (1-indexed)");
 	define("I|do-not-ignore-case=b", "Do not ignore case when sorting alphabetically");
 	define("i|e|x|interp|exclusive-interpretation=s", "Exclusive interpretation to sort");
+
+	allowParallelSegments();
 }
 
 
@@ -79,6 +79,8 @@ Tool_imitation::Tool_imitation(void) {
 	define("a|add=b",             "add inversions, retrograde, etc. if specified to normal search");
 	define("v|inversion=b",       "match inversions");
 	define("g|retrograde=b",      "match retrograde");
+
+	define("no-index=b",          "compare all pairs of notes rather than only notes starting the same intervals");
 }
 
 
@@ -186,6 +188,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 	m_rest    = getBoolean("rest");
 	m_rest2   = getBoolean("rest2");
 	m_single  = getBoolean("single-mark");
+	m_indexQ  = !getBoolean("no-index");
 
 	if (getBoolean("intervals")) {
 		vector<string> values;
@@ -272,6 +275,15 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 		getIntervals(intervals.at(i), attacks.at(i));
 	}
 
+	if (m_indexQ) {
+		m_sources.resize(attacks.size());
+		m_targets.resize(attacks.size());
+		for (int i=0; i<(int)attacks.size(); i++) {
+			buildIndex(m_sources.at(i), attacks.at(i), intervals.at(i), false);
+			buildIndex(m_targets.at(i), attacks.at(i), intervals.at(i), true);
+		}
+	}
+
 	for (int i=0; i<(int)attacks.size(); i++) {
 		for (int j=i+1; j<(int)attacks.size(); j++) {
 			analyzeImitation(results, attacks, intervals, i, j);
@@ -328,26 +340,14 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 	for (int i=0; i<(int)v1i.size() - 1; i++) {
 		count = 0;
 		for (int j=0; j<(int)v2i.size() - 1; j++) {
-			if (m_rest || m_rest2) {
-				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
-					// match initiator must be preceded by a rest (or start of music)
-					continue;
-				}
-			}
-			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
-					// match target must be preceded by a rest (or start of music)
-					continue;
+			if (m_indexQ) {
+				// skip to the next note which could start a match.
+				j = getNextCandidate(attacks, intervals, enum1, enum2, v1, v2, i, j);
+				if (j < 0) {
+					break;
 				}
 			}
-			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
-				// avoid re-matching an existing match as a submatch
-				continue;
-			}
-			count = compareSequences(v1a, v1i, i, v2a, v2i, j);
-			if ((count >= min) && (m_intervals.size() > 0)) {
-				count = checkForIntervalSequence(m_intervals, v1i, i, count);
-			}
+			count = getMatchCount(attacks, intervals, enum1, enum2, v1, v2, i, j);
 			if (count < min) {
 				j += count;
 				continue;
@@ -633,6 +633,200 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 
 
 
+//////////////////////////////
+//
+// Tool_imitation::getMatchCount -- Return the number of notes that match
+//     between the sequences starting at note i in voice v1 and note j in
+//     voice v2, or 0 if a match is not allowed to start at those notes.
+//
+
+int Tool_imitation::getMatchCount(vector<vector<NoteCell*>>& attacks,
+		vector<vector<double>>& intervals, vector<int>& enum1,
+		vector<int>& enum2, int v1, int v2, int i, int j) {
+	if (m_rest || m_rest2) {
+		if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
+			// match initiator must be preceded by a rest (or start of music)
+			return 0;
+		}
+	}
+	if (m_rest2) {
+		if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+			// match target must be preceded by a rest (or start of music)
+			return 0;
+		}
+	}
+	if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
+		// avoid re-matching an existing match as a submatch
+		return 0;
+	}
+	int count = compareSequences(attacks.at(v1), intervals.at(v1), i,
+			attacks.at(v2), intervals.at(v2), j);
+	if ((count >= m_threshold - 1) && (m_intervals.size() > 0)) {
+		count = checkForIntervalSequence(m_intervals, intervals.at(v1), i, count);
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::buildIndex -- Calculate the keys of the notes in a voice
+//     and the hashes of the runs of m_threshold - 2 keys which a match
+//     must start with.  For the second voice of a voice pair (target),
+//     also list the notes starting with each key and run hash.  Inverted
+//     intervals are used for the target when matching inversions.
+//
+
+void Tool_imitation::buildIndex(ImitationIndex& index,
+		vector<NoteCell*>& attacks, vector<double>& intervals, bool target) {
+	index.clear();
+	int size = (int)intervals.size();
+	index.keys.resize(size);
+	for (int i=0; i<size; i++) {
+		// 0 = interval to/from a rest.
+		unsigned long long key = 0;
+		if (!Convert::isNaN(intervals.at(i))) {
+			int interval = (int)intervals.at(i);
+			if (target && m_inversion) {
+				interval = -interval;
+			}
+			key = (unsigned long long)(interval + 1000);
+		}
+		if (m_duration) {
+			HumNum duration = attacks.at(i)->getDuration();
+			key = key * 1000003ULL + (unsigned long long)duration.getNumerator();
+			key = key * 1000003ULL + (unsigned long long)duration.getDenominator();
+		}
+		index.keys[i] = key;
+	}
+
+	int length = m_threshold - 2;
+	if (size >= length) {
+		index.hashes.resize(size - length + 1);
+	}
+	for (int i=0; i<(int)index.hashes.size(); i++) {
+		unsigned long long hash = 0;
+		for (int k=0; k<length; k++) {
+			hash = hash * 0x100000001b3ULL + index.keys[i+k];
+		}
+		index.hashes[i] = hash;
+	}
+
+	if (!target) {
+		return;
+	}
+	for (int i=0; i<size; i++) {
+		if (Convert::isNaN(intervals.at(i))) {
+			// sequences cannot start with rests
+			continue;
+		}
+		index.firsts[index.keys[i]].push_back(i);
+		if (i < (int)index.hashes.size()) {
+			index.runs[index.hashes[i]].push_back(i);
+		}
+	}
+
+	// A note is a sync point if the previous note with the same key is at
+	// least m_threshold - 1 notes before it: no partial match starting
+	// before it can extend past it.
+	int min = m_threshold - 1;
+	for (auto& it : index.firsts) {
+		vector<int>& list = it.second;
+		vector<int>& sync = index.lastsync[it.first];
+		sync.resize(list.size());
+		for (int k=0; k<(int)list.size(); k++) {
+			if ((k == 0) || (list[k] - list[k-1] >= min)) {
+				sync[k] = k;
+			} else {
+				sync[k] = sync[k-1];
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::getNextCandidate -- Return the next note in voice v2,
+//     starting at note j, which the comparison loop in analyzeImitation()
+//     would reach and which starts the same run of intervals as note i in
+//     voice v1.  Returns -1 if there are no more such notes.  A match
+//     cannot start on any other note, but notes which start with the
+//     same interval can still have partial matches which cause the loop
+//     to skip notes.  These are compared as the loop would, starting from
+//     the last sync point before the candidate.
+//
+
+int Tool_imitation::getNextCandidate(vector<vector<NoteCell*>>& attacks,
+		vector<vector<double>>& intervals, vector<int>& enum1,
+		vector<int>& enum2, int v1, int v2, int i, int j) {
+	ImitationIndex& source = m_sources.at(v1);
+	ImitationIndex& target = m_targets.at(v2);
+	int jmax = (int)intervals.at(v2).size() - 1;
+	if (Convert::isNaN(intervals.at(v1).at(i))) {
+		// sequences cannot start with rests
+		return -1;
+	}
+	if (i >= (int)source.hashes.size()) {
+		return -1;
+	}
+	auto rit = target.runs.find(source.hashes[i]);
+	if (rit == target.runs.end()) {
+		return -1;
+	}
+	vector<int>& runs = rit->second;
+
+	vector<int>* firsts = NULL;
+	vector<int>* lastsync = NULL;
+	auto fit = target.firsts.find(source.keys[i]);
+	if (fit != target.firsts.end()) {
+		firsts = &fit->second;
+		lastsync = &target.lastsync[fit->first];
+	}
+
+	int pos = j;
+	while (true) {
+		auto cit = lower_bound(runs.begin(), runs.end(), pos);
+		if ((cit == runs.end()) || (*cit >= jmax)) {
+			return -1;
+		}
+		int candidate = *cit;
+		if (!firsts) {
+			return candidate;
+		}
+
+		int k = (int)(upper_bound(firsts->begin(), firsts->end(), candidate)
+				- firsts->begin()) - 1;
+		if (k >= 0) {
+			int sync = firsts->at(lastsync->at(k));
+			if (sync > pos) {
+				pos = sync;
+			}
+		}
+
+		int fsize = (int)firsts->size();
+		k = (int)(lower_bound(firsts->begin(), firsts->end(), pos) - firsts->begin());
+		while (pos < candidate) {
+			if ((k >= fsize) || (firsts->at(k) >= candidate)) {
+				pos = candidate;
+				break;
+			}
+			int start = firsts->at(k);
+			pos = start + getMatchCount(attacks, intervals, enum1, enum2, v1, v2, i, start) + 1;
+			while ((k < fsize) && (firsts->at(k) < pos)) {
+				k++;
+			}
+		}
+		if (pos == candidate) {
+			return candidate;
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_imitation::markedTiedNotes --
@@ -33,6 +33,8 @@ Tool_kern2mens::Tool_kern2mens(void) {
 	define("I|not-invisible=b",       "keep measures visible");
 	define("D|no-double-bar=b",       "keep thick final barlines");
 	define("c|clef=s",                "clef to use in mensural notation");
+
+	allowParallelSegments();
 }
 
 
@@ -32,6 +32,8 @@ Tool_melisma::Tool_melisma(void) {
 	define("a|average|avg=b",  "calculate note-to-syllable ratio");
 	define("w|words=b",        "list words that contain a melisma");
 	define("p|part=b", "also calculate note-to-syllable ratios by part");
+
+	allowParallelSegments();
 }
 
 
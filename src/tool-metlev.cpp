@@ -41,6 +41,8 @@ Tool_metlev::Tool_metlev(void) {
 	define("G|no-grace-notes=b",  "do not mark grace note lines");
 	define("k|kern-spine=i:1",    "analyze only given kern spine");
 	define("e|exinterp=s:blev",   "exclusive interpretation type for output");
+
+	allowParallelSegments();
 }
 
 
@@ -0,0 +1,1071 @@
+//
+// Programmer:    agent <agent@local>
+// Creation Date: Fri Oct 16 14:10:26 PDT 2026
+// Last Modified: Fri Oct 16 18:41:55 PDT 2026
+// Filename:      tool-msearch-index.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-msearch-index.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   n-gram index of a corpus for the msearch tool.  The index
+//                is built from the NoteGrid of each file, and stored as
+//                posting lists sorted by n-gram key so that a query only
+//                needs to read the posting lists of its own n-grams.
+//
+//                Layout of an index file (all numbers are in the byte
+//                order of the computer which wrote the file):
+//                   MSearchIndexHeader
+//                   char names[namesize]   (NUL-terminated file names)
+//                   char sources[sourcesize]  (NUL-terminated segment
+//                                          indexes of the source files)
+//                   MSearchIndexFile files[filecount]
+//                   MSearchIndexKey keys[keycount]  (sorted by key)
+//                   MSearchIndexPosting postings[postingcount]
+//                   char words[wordsize]   (NUL-terminated, sorted)
+//                   MSearchIndexWord wordlists[wordcount]
+//                   MSearchIndexWordPosting wordpostings[wordpostingcount]
+//
+//                n-gram keys are 64-bit hashes of the feature type and
+//                the feature values of the notes.  Two n-grams with the
+//                same hash share a posting list, which only adds extra
+//                candidate files to a search.  Lyric words are stored
+//                in lower case, so text queries are matched against the
+//                list of words rather than against every file.
+//
+//                Each file in the index is a segment of a source file,
+//                which is read again for searching with
+//                HumdrumFileStream::readSegment().  The segment index of
+//                each source file (including its absolute path) is stored
+//                in the msearch index, so searching does not depend on the
+//                current directory or need to scan the source files.
+//
+
+#include "tool-msearch.h"
+#include "Convert.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <regex>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+#define MSEARCH_INDEX_VERSION   3
+#define MSEARCH_INDEX_BYTEORDER 0x01020304
+
+struct MSearchIndexHeader {
+	char      magic[4];      // "MSIX"
+	int       version;       // MSEARCH_INDEX_VERSION
+	int       byteorder;     // MSEARCH_INDEX_BYTEORDER
+	int       gramlength;    // number of notes in each n-gram
+	int       filecount;     // number of file names
+	int       sourcecount;   // number of source files
+	int       keycount;      // number of n-gram keys
+	int       wordcount;     // number of lyric words
+	long long namesize;      // bytes of file names
+	long long sourcesize;    // bytes of source segment indexes
+	long long postingcount;  // total number of postings
+	long long wordsize;      // bytes of lyric words
+	long long wordpostingcount;  // total number of word postings
+};
+
+struct MSearchIndexFile {
+	int       source;        // index of the source file
+	int       segment;       // segment number in the source file
+};
+
+struct MSearchIndexKey {
+	unsigned long long key;  // n-gram hash
+	long long offset;        // index of the first posting for the key
+	long long count;         // number of postings for the key
+};
+
+struct MSearchIndexWord {
+	long long offset;        // index of the first posting for the word
+	long long count;         // number of postings for the word
+};
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::MSearchIndex -- Constructor.
+//
+
+MSearchIndex::MSearchIndex(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::~MSearchIndex -- Deconstructor.
+//
+
+MSearchIndex::~MSearchIndex() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::clear -- Remove all files from the index.
+//
+
+void MSearchIndex::clear(void) {
+	m_files.clear();
+	m_filesources.clear();
+	m_filesegments.clear();
+	m_sources.clear();
+	m_postings.clear();
+	m_keys.clear();
+	m_offsets.clear();
+	m_counts.clear();
+	m_wordpostings.clear();
+	m_words.clear();
+	m_wordoffsets.clear();
+	m_wordcounts.clear();
+	if (m_input.is_open()) {
+		m_input.close();
+	}
+	m_postingstart = 0;
+	m_wordpostingstart = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::setGramLength -- Set the number of notes in each n-gram
+//     (default 4).  Queries need at least this many notes with the same
+//     feature type to use the index.  Should be set before adding files.
+//
+
+void MSearchIndex::setGramLength(int length) {
+	if (length < 1) {
+		length = 1;
+	}
+	m_length = length;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getGramLength --
+//
+
+int MSearchIndex::getGramLength(void) const {
+	return m_length;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileCount -- Number of files in the index.
+//
+
+int MSearchIndex::getFileCount(void) const {
+	return (int)m_files.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileName -- Name of a file in the index.
+//
+
+string MSearchIndex::getFileName(int index) const {
+	if ((index < 0) || (index >= (int)m_files.size())) {
+		return "";
+	}
+	return m_files[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileSource -- Index of the source file which contains
+//     a file in the index, or -1 if the index is out of range.
+//
+
+int MSearchIndex::getFileSource(int index) const {
+	if ((index < 0) || (index >= (int)m_filesources.size())) {
+		return -1;
+	}
+	return m_filesources[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileSegment -- Segment number of a file in its source
+//     file, or -1 if the index is out of range.
+//
+
+int MSearchIndex::getFileSegment(int index) const {
+	if ((index < 0) || (index >= (int)m_filesegments.size())) {
+		return -1;
+	}
+	return m_filesegments[index];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getSourceCount -- Number of source files in the index.
+//
+
+int MSearchIndex::getSourceCount(void) const {
+	return (int)m_sources.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getSourceIndex -- Segment index of a source file, which
+//     can be loaded with HumdrumFileStream::readSegmentIndex().
+//
+
+string MSearchIndex::getSourceIndex(int source) const {
+	if ((source < 0) || (source >= (int)m_sources.size())) {
+		return "";
+	}
+	return m_sources[source];
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addSource -- Add a source file, given by its segment index
+//     (from HumdrumFileStream::writeSegmentIndex()).  Returns the index
+//     number of the source.
+//
+
+int MSearchIndex::addSource(const string& segmentindex) {
+	m_sources.push_back(segmentindex);
+	return (int)m_sources.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addFile -- Add the n-grams of every voice in a NoteGrid
+//     to the index.  The file is the given segment of a source file added
+//     with addSource().  Returns the index number of the file.  The note
+//     features are calculated in the same way as the msearch matcher
+//     compares them.
+//
+
+int MSearchIndex::addFile(const string& name, int source, int segment,
+		NoteGrid& grid) {
+	int file = (int)m_files.size();
+	m_files.push_back(name);
+	m_filesources.push_back(source);
+	m_filesegments.push_back(segment);
+
+	vector<NoteCell*> attacks;
+	vector<int> diatonic;
+	vector<int> chromatic;
+	vector<int> interval;
+	vector<int> numerator;
+	vector<int> denominator;
+	vector<int> none;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		int size = (int)attacks.size();
+		diatonic.resize(size);
+		chromatic.resize(size);
+		interval.resize(size);
+		numerator.resize(size);
+		denominator.resize(size);
+		none.assign(size, 0);
+		for (int i=0; i<size; i++) {
+			NoteCell* note = attacks[i];
+			double pc = note->getAbsDiatonicPitchClass();
+			diatonic[i] = Convert::isNaN(pc) ? 7 : (int)pc;
+			pc = note->getAbsBase40PitchClass();
+			chromatic[i] = Convert::isNaN(pc) ? 40 : (int)pc;
+			HumNum duration = note->getDuration();
+			numerator[i] = duration.getNumerator();
+			denominator[i] = duration.getDenominator();
+			interval[i] = GRAM_NONE;
+			if (i > 0) {
+				double current = note->getAbsMidiPitch();
+				double previous = attacks[i-1]->getAbsMidiPitch();
+				if (current > previous) {
+					interval[i] = GRAM_UP;
+				} else if (current < previous) {
+					interval[i] = GRAM_DOWN;
+				} else if (current == previous) {
+					interval[i] = GRAM_SAME;
+				}
+			}
+		}
+		addGrams(GRAM_DIATONIC, diatonic, none, 0, attacks, file, v);
+		addGrams(GRAM_CHROMATIC, chromatic, none, 0, attacks, file, v);
+		addGrams(GRAM_INTERVAL, interval, none, 1, attacks, file, v);
+		addGrams(GRAM_RHYTHM, numerator, denominator, 0, attacks, file, v);
+	}
+
+	return file;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addGrams -- Add a posting for each n-gram of a feature
+//     in a voice.  The first n-gram starts at the given note.
+//
+
+void MSearchIndex::addGrams(int type, vector<int>& symbols,
+		vector<int>& symbols2, int start, vector<NoteCell*>& attacks,
+		int file, int voice) {
+	MSearchIndexPosting posting;
+	posting.file = file;
+	posting.voice = voice;
+	for (int i=start; i+m_length<=(int)symbols.size(); i++) {
+		posting.slice = attacks[i]->getSliceIndex();
+		m_postings[makeKey(type, symbols, symbols2, i)].push_back(posting);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::makeKey -- Hash the n-gram of a feature starting at the
+//     given note (64-bit FNV-1a hash).
+//
+
+unsigned long long MSearchIndex::makeKey(int type, vector<int>& symbols,
+		vector<int>& symbols2, int start) {
+	unsigned long long key = 0xcbf29ce484222325ULL;
+	auto addValue = [&key](int value) {
+		unsigned int data = (unsigned int)value;
+		for (int b=0; b<4; b++) {
+			key ^= (data >> (b * 8)) & 0xff;
+			key *= 0x100000001b3ULL;
+		}
+	};
+	addValue(type);
+	for (int i=start; i<start+m_length; i++) {
+		addValue(symbols[i]);
+		addValue(symbols2[i]);
+	}
+	return key;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::write -- Save the index.  Posting lists are sorted by
+//     n-gram key.
+//
+
+bool MSearchIndex::write(const string& filename) {
+	std::ofstream output(filename.c_str(), std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	return write(output);
+}
+
+
+bool MSearchIndex::write(ostream& out) {
+	vector<unsigned long long> keys;
+	keys.reserve(m_postings.size());
+	for (auto& it : m_postings) {
+		keys.push_back(it.first);
+	}
+	sort(keys.begin(), keys.end());
+
+	string names;
+	for (int i=0; i<(int)m_files.size(); i++) {
+		names += m_files[i];
+		names += '\0';
+	}
+	string sources;
+	for (int i=0; i<(int)m_sources.size(); i++) {
+		sources += m_sources[i];
+		sources += '\0';
+	}
+	vector<MSearchIndexFile> files(m_files.size());
+	for (int i=0; i<(int)m_files.size(); i++) {
+		files[i].source = m_filesources[i];
+		files[i].segment = m_filesegments[i];
+	}
+
+	MSearchIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "MSIX", 4);
+	header.version = MSEARCH_INDEX_VERSION;
+	header.byteorder = MSEARCH_INDEX_BYTEORDER;
+	header.gramlength = m_length;
+	header.filecount = (int)m_files.size();
+	header.sourcecount = (int)m_sources.size();
+	header.keycount = (int)keys.size();
+	header.namesize = (long long)names.size();
+	header.sourcesize = (long long)sources.size();
+
+	vector<MSearchIndexKey> table(keys.size());
+	long long offset = 0;
+	for (int i=0; i<(int)keys.size(); i++) {
+		table[i].key = keys[i];
+		table[i].offset = offset;
+		table[i].count = (long long)m_postings[keys[i]].size();
+		offset += table[i].count;
+	}
+	header.postingcount = offset;
+
+	sortWords();
+	string words;
+	vector<MSearchIndexWord> wordtable(m_words.size());
+	offset = 0;
+	for (int i=0; i<(int)m_words.size(); i++) {
+		words += m_words[i];
+		words += '\0';
+		wordtable[i].offset = offset;
+		wordtable[i].count = m_wordcounts[i];
+		offset += m_wordcounts[i];
+	}
+	header.wordcount = (int)m_words.size();
+	header.wordsize = (long long)words.size();
+	header.wordpostingcount = offset;
+
+	out.write((const char*)&header, sizeof(header));
+	out.write(names.data(), names.size());
+	out.write(sources.data(), sources.size());
+	if (!files.empty()) {
+		out.write((const char*)files.data(), files.size() * sizeof(MSearchIndexFile));
+	}
+	if (!table.empty()) {
+		out.write((const char*)table.data(), table.size() * sizeof(MSearchIndexKey));
+	}
+	for (int i=0; i<(int)keys.size(); i++) {
+		vector<MSearchIndexPosting>& postings = m_postings[keys[i]];
+		out.write((const char*)postings.data(),
+				postings.size() * sizeof(MSearchIndexPosting));
+	}
+	out.write(words.data(), words.size());
+	if (!wordtable.empty()) {
+		out.write((const char*)wordtable.data(),
+				wordtable.size() * sizeof(MSearchIndexWord));
+	}
+	for (int i=0; i<(int)m_words.size(); i++) {
+		vector<MSearchIndexWordPosting>& postings = m_wordpostings[m_words[i]];
+		out.write((const char*)postings.data(),
+				postings.size() * sizeof(MSearchIndexWordPosting));
+	}
+	out.flush();
+	return out.good();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::read -- Load the file names and n-gram keys of an index
+//     file.  Posting lists are read from the file when they are needed.
+//     Returns false if the file is not an msearch index.
+//
+
+bool MSearchIndex::read(const string& filename) {
+	clear();
+	m_input.open(filename.c_str(), std::ios::binary);
+	if (!m_input.is_open()) {
+		return false;
+	}
+	MSearchIndexHeader header;
+	if (!m_input.read((char*)&header, sizeof(header))) {
+		return false;
+	}
+	if ((memcmp(header.magic, "MSIX", 4) != 0) ||
+			(header.version != MSEARCH_INDEX_VERSION) ||
+			(header.byteorder != MSEARCH_INDEX_BYTEORDER) ||
+			(header.gramlength < 1) || (header.filecount < 0) ||
+			(header.sourcecount < 0) || (header.sourcesize < 0) ||
+			(header.keycount < 0) || (header.namesize < 0) ||
+			(header.postingcount < 0) || (header.wordcount < 0) ||
+			(header.wordsize < 0) || (header.wordpostingcount < 0)) {
+		m_input.close();
+		return false;
+	}
+	m_length = header.gramlength;
+
+	string names(header.namesize, '\0');
+	if (!m_input.read(&names[0], header.namesize)) {
+		m_input.close();
+		return false;
+	}
+	size_t start = 0;
+	for (int i=0; i<header.filecount; i++) {
+		size_t end = names.find('\0', start);
+		if (end == string::npos) {
+			m_input.close();
+			return false;
+		}
+		m_files.push_back(names.substr(start, end - start));
+		start = end + 1;
+	}
+
+	string sources(header.sourcesize, '\0');
+	if (!m_input.read(&sources[0], header.sourcesize)) {
+		m_input.close();
+		return false;
+	}
+	start = 0;
+	for (int i=0; i<header.sourcecount; i++) {
+		size_t end = sources.find('\0', start);
+		if (end == string::npos) {
+			m_input.close();
+			return false;
+		}
+		m_sources.push_back(sources.substr(start, end - start));
+		start = end + 1;
+	}
+
+	vector<MSearchIndexFile> files(header.filecount);
+	if (!files.empty() && !m_input.read((char*)files.data(),
+			files.size() * sizeof(MSearchIndexFile))) {
+		m_input.close();
+		return false;
+	}
+	m_filesources.resize(files.size());
+	m_filesegments.resize(files.size());
+	for (int i=0; i<(int)files.size(); i++) {
+		if ((files[i].source < 0) || (files[i].source >= header.sourcecount)) {
+			m_input.close();
+			return false;
+		}
+		m_filesources[i] = files[i].source;
+		m_filesegments[i] = files[i].segment;
+	}
+
+	vector<MSearchIndexKey> table(header.keycount);
+	if (!table.empty() && !m_input.read((char*)table.data(),
+			table.size() * sizeof(MSearchIndexKey))) {
+		m_input.close();
+		return false;
+	}
+	m_keys.resize(table.size());
+	m_offsets.resize(table.size());
+	m_counts.resize(table.size());
+	for (int i=0; i<(int)table.size(); i++) {
+		m_keys[i] = table[i].key;
+		m_offsets[i] = table[i].offset;
+		m_counts[i] = (int)table[i].count;
+	}
+	m_postingstart = (long long)m_input.tellg();
+
+	// The lyric words follow the n-gram posting lists:
+	m_input.seekg(m_postingstart + header.postingcount *
+			(long long)sizeof(MSearchIndexPosting));
+	string words(header.wordsize, '\0');
+	if (!m_input.read(&words[0], header.wordsize)) {
+		m_input.close();
+		return false;
+	}
+	start = 0;
+	for (int i=0; i<header.wordcount; i++) {
+		size_t end = words.find('\0', start);
+		if (end == string::npos) {
+			m_input.close();
+			return false;
+		}
+		m_words.push_back(words.substr(start, end - start));
+		start = end + 1;
+	}
+	vector<MSearchIndexWord> wordtable(header.wordcount);
+	if (!wordtable.empty() && !m_input.read((char*)wordtable.data(),
+			wordtable.size() * sizeof(MSearchIndexWord))) {
+		m_input.close();
+		return false;
+	}
+	m_wordoffsets.resize(wordtable.size());
+	m_wordcounts.resize(wordtable.size());
+	for (int i=0; i<(int)wordtable.size(); i++) {
+		m_wordoffsets[i] = wordtable[i].offset;
+		m_wordcounts[i] = (int)wordtable[i].count;
+	}
+	m_wordpostingstart = (long long)m_input.tellg();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getPostings -- Return the posting list for an n-gram
+//     key, sorted by file, voice and slice.
+//
+
+void MSearchIndex::getPostings(vector<MSearchIndexPosting>& postings,
+		unsigned long long key) {
+	postings.clear();
+	if (!m_input.is_open()) {
+		auto it = m_postings.find(key);
+		if (it != m_postings.end()) {
+			postings = it->second;
+		}
+		return;
+	}
+	auto it = lower_bound(m_keys.begin(), m_keys.end(), key);
+	if ((it == m_keys.end()) || (*it != key)) {
+		return;
+	}
+	int index = (int)(it - m_keys.begin());
+	postings.resize(m_counts[index]);
+	m_input.clear();
+	m_input.seekg(m_postingstart + m_offsets[index] * (long long)sizeof(MSearchIndexPosting));
+	if (!m_input.read((char*)postings.data(),
+			postings.size() * sizeof(MSearchIndexPosting))) {
+		postings.clear();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getQueryKeys -- Return the keys of the n-grams which
+//     every match of the query must contain.  The note which each query
+//     token refers to is calculated in the same way as in
+//     Tool_msearch::checkForMatchDiatonicPC(): a pitch following an
+//     interval-direction token refers to the same note as the interval.
+//     Direction markers on pitches (^ and v) are not used.
+//
+
+void MSearchIndex::getQueryKeys(vector<unsigned long long>& keys,
+		vector<MSearchQueryToken>& query) {
+	keys.clear();
+	int size = (int)query.size();
+	// -1 = no requirement for the note:
+	vector<int> diatonic(size, -1);
+	vector<int> chromatic(size, -1);
+	vector<int> interval(size, -1);
+	vector<int> numerator(size, -1);
+	vector<int> denominator(size, -1);
+	vector<int> none(size, 0);
+
+	bool lastIsInterval = false;
+	int c = 0;
+	for (int i=0; i<size; i++) {
+		MSearchQueryToken& token = query[i];
+		if (token.anything) {
+			continue;
+		}
+		if (token.base <= 0) {
+			lastIsInterval = true;
+			if (token.direction > 0) {
+				interval[i-c] = GRAM_UP;
+			} else if (token.direction < 0) {
+				interval[i-c] = GRAM_DOWN;
+			} else {
+				interval[i-c] = GRAM_SAME;
+			}
+			continue;
+		}
+		if (lastIsInterval) {
+			c++;
+			lastIsInterval = false;
+		}
+		int p = i - c;
+		if (token.base == 40) {
+			// A base-40 pitch class also fixes the diatonic pitch class:
+			if (Convert::isNaN(token.pc)) {
+				chromatic[p] = 40;
+				diatonic[p] = 7;
+			} else {
+				chromatic[p] = (int)token.pc;
+				diatonic[p] = Convert::base40ToDiatonic(chromatic[p]) % 7;
+			}
+		} else {
+			diatonic[p] = Convert::isNaN(token.pc) ? 7 : (int)token.pc;
+		}
+		if (!token.rhythm.empty()) {
+			numerator[p] = token.duration.getNumerator();
+			denominator[p] = token.duration.getDenominator();
+		}
+	}
+
+	addQueryGrams(keys, GRAM_DIATONIC, diatonic, none);
+	addQueryGrams(keys, GRAM_CHROMATIC, chromatic, none);
+	addQueryGrams(keys, GRAM_INTERVAL, interval, none);
+	addQueryGrams(keys, GRAM_RHYTHM, numerator, denominator);
+
+	sort(keys.begin(), keys.end());
+	keys.erase(unique(keys.begin(), keys.end()), keys.end());
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addQueryGrams -- Add the keys for each run of m_length
+//     notes in the query which all have a requirement for the feature.
+//
+
+void MSearchIndex::addQueryGrams(vector<unsigned long long>& keys, int type,
+		vector<int>& symbols, vector<int>& symbols2) {
+	int run = 0;
+	for (int i=0; i<(int)symbols.size(); i++) {
+		if (symbols[i] < 0) {
+			run = 0;
+			continue;
+		}
+		run++;
+		if (run >= m_length) {
+			keys.push_back(makeKey(type, symbols, symbols2, i - m_length + 1));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getCandidates -- Return the files which have a voice
+//     containing all of the n-grams of the query.  Returns false if the
+//     query does not have any n-grams, in which case every file is a
+//     candidate.
+//
+
+bool MSearchIndex::getCandidates(vector<int>& files,
+		vector<MSearchQueryToken>& query) {
+	files.clear();
+	vector<unsigned long long> keys;
+	getQueryKeys(keys, query);
+	if (keys.empty()) {
+		for (int i=0; i<getFileCount(); i++) {
+			files.push_back(i);
+		}
+		return false;
+	}
+
+	// Intersect the voices containing each n-gram, starting with
+	// the shortest posting list.
+	vector<pair<int, unsigned long long>> order;
+	for (int i=0; i<(int)keys.size(); i++) {
+		int count = 0;
+		if (m_input.is_open()) {
+			auto it = lower_bound(m_keys.begin(), m_keys.end(), keys[i]);
+			if ((it != m_keys.end()) && (*it == keys[i])) {
+				count = m_counts[it - m_keys.begin()];
+			}
+		} else {
+			auto it = m_postings.find(keys[i]);
+			if (it != m_postings.end()) {
+				count = (int)it->second.size();
+			}
+		}
+		if (count == 0) {
+			return true;
+		}
+		order.emplace_back(count, keys[i]);
+	}
+	sort(order.begin(), order.end());
+
+	vector<MSearchIndexPosting> postings;
+	vector<long long> voices;
+	vector<long long> current;
+	vector<long long> common;
+	for (int i=0; i<(int)order.size(); i++) {
+		getPostings(postings, order[i].second);
+		current.clear();
+		for (int j=0; j<(int)postings.size(); j++) {
+			long long voice = ((long long)postings[j].file << 32) | postings[j].voice;
+			if (current.empty() || (current.back() != voice)) {
+				current.push_back(voice);
+			}
+		}
+		if (i == 0) {
+			voices.swap(current);
+		} else {
+			common.resize(std::min(voices.size(), current.size()));
+			auto end = set_intersection(voices.begin(), voices.end(),
+					current.begin(), current.end(), common.begin());
+			common.resize(end - common.begin());
+			voices.swap(common);
+		}
+		if (voices.empty()) {
+			return true;
+		}
+	}
+
+	for (int i=0; i<(int)voices.size(); i++) {
+		int file = (int)(voices[i] >> 32);
+		if (files.empty() || (files.back() != file)) {
+			files.push_back(file);
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addWords -- Add the lyric words of a file (from
+//     Tool_msearch::fillWords()) to the index.
+//
+
+void MSearchIndex::addWords(int file, vector<TextInfo*>& words) {
+	MSearchIndexWordPosting posting;
+	posting.file = file;
+	for (int i=0; i<(int)words.size(); i++) {
+		HTp token = words[i]->starttoken;
+		posting.track = token ? token->getTrack() : 0;
+		posting.line = token ? token->getLineIndex() : -1;
+		posting.word = i;
+		m_wordpostings[normalizeWord(words[i]->fullword)].push_back(posting);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getWordCount -- Number of different lyric words in the
+//     index.
+//
+
+int MSearchIndex::getWordCount(void) {
+	sortWords();
+	return (int)m_words.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::normalizeWord -- Convert a word to lower case.
+//
+
+string MSearchIndex::normalizeWord(const string& word) {
+	string output = word;
+	for (int i=0; i<(int)output.size(); i++) {
+		output[i] = (char)std::tolower((unsigned char)output[i]);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::sortWords -- Make the sorted list of words for an index
+//     which is being built (the list is read from the file otherwise).
+//
+
+void MSearchIndex::sortWords(void) {
+	if (m_input.is_open()) {
+		return;
+	}
+	m_words.clear();
+	m_wordcounts.clear();
+	m_wordoffsets.clear();
+	m_words.reserve(m_wordpostings.size());
+	for (auto& it : m_wordpostings) {
+		m_words.push_back(it.first);
+	}
+	sort(m_words.begin(), m_words.end());
+	for (int i=0; i<(int)m_words.size(); i++) {
+		m_wordcounts.push_back((int)m_wordpostings[m_words[i]].size());
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getMatchingWords -- Return the indexes of the words which
+//     match a term of a text query.  Terms are case-insensitive regular
+//     expressions, as in Tool_msearch::doTextSearch().  Plain words only
+//     need a substring test, and plain words starting with "^" (prefix
+//     queries) are found with a binary search of the sorted words.
+//
+
+void MSearchIndex::getMatchingWords(vector<int>& indexes,
+		const string& term) {
+	indexes.clear();
+	bool prefixQ = (!term.empty()) && (term[0] == '^');
+	string literal = normalizeWord(prefixQ ? term.substr(1) : term);
+	bool literalQ = literal.find_first_of("\\^$.|?*+()[]{}") == string::npos;
+
+	if (literalQ && prefixQ) {
+		auto it = lower_bound(m_words.begin(), m_words.end(), literal);
+		while ((it != m_words.end()) &&
+				(it->compare(0, literal.size(), literal) == 0)) {
+			indexes.push_back((int)(it - m_words.begin()));
+			it++;
+		}
+	} else if (literalQ) {
+		for (int i=0; i<(int)m_words.size(); i++) {
+			if (m_words[i].find(literal) != string::npos) {
+				indexes.push_back(i);
+			}
+		}
+	} else {
+		regex re(term, std::regex_constants::ECMAScript |
+				std::regex_constants::icase);
+		for (int i=0; i<(int)m_words.size(); i++) {
+			if (std::regex_search(m_words[i], re)) {
+				indexes.push_back(i);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getWordPostings -- Return the posting list of a word,
+//     sorted by file and word number.
+//
+
+void MSearchIndex::getWordPostings(vector<MSearchIndexWordPosting>& postings,
+		int index) {
+	postings.clear();
+	if ((index < 0) || (index >= (int)m_words.size())) {
+		return;
+	}
+	if (!m_input.is_open()) {
+		postings = m_wordpostings[m_words[index]];
+		return;
+	}
+	postings.resize(m_wordcounts[index]);
+	m_input.clear();
+	m_input.seekg(m_wordpostingstart + m_wordoffsets[index] *
+			(long long)sizeof(MSearchIndexWordPosting));
+	if (!m_input.read((char*)postings.data(),
+			postings.size() * sizeof(MSearchIndexWordPosting))) {
+		postings.clear();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getTermPostings -- Return the postings of all words
+//     which match a query term, sorted by file and word number.
+//
+
+void MSearchIndex::getTermPostings(vector<MSearchIndexWordPosting>& postings,
+		const string& term) {
+	postings.clear();
+	vector<int> indexes;
+	getMatchingWords(indexes, term);
+	vector<MSearchIndexWordPosting> list;
+	for (int i=0; i<(int)indexes.size(); i++) {
+		getWordPostings(list, indexes[i]);
+		postings.insert(postings.end(), list.begin(), list.end());
+	}
+	sort(postings.begin(), postings.end(),
+			[](const MSearchIndexWordPosting& a, const MSearchIndexWordPosting& b) {
+				if (a.file != b.file) {
+					return a.file < b.file;
+				}
+				return a.word < b.word;
+			});
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getTextMatches -- Return the position of the first word
+//     of every match of a text query, sorted by file and word number.
+//     Words of a quoted phrase must follow each other in the same track.
+//
+
+void MSearchIndex::getTextMatches(vector<MSearchIndexWordPosting>& matches,
+		vector<MSearchTextQuery>& query) {
+	matches.clear();
+	sortWords();
+	auto before = [](const MSearchIndexWordPosting& a,
+			const MSearchIndexWordPosting& b) {
+		if (a.file != b.file) {
+			return a.file < b.file;
+		}
+		return a.word < b.word;
+	};
+
+	vector<MSearchIndexWordPosting> current;
+	vector<MSearchIndexWordPosting> next;
+	vector<MSearchIndexWordPosting> kept;
+	for (int i=0; i<(int)query.size(); i++) {
+		if (query[i].link) {
+			continue;
+		}
+		getTermPostings(current, query[i].word);
+		for (int k=1; (i+k<(int)query.size()) && query[i+k].link; k++) {
+			if (current.empty()) {
+				break;
+			}
+			getTermPostings(next, query[i+k].word);
+			kept.clear();
+			for (int j=0; j<(int)current.size(); j++) {
+				MSearchIndexWordPosting target = current[j];
+				target.word += k;
+				auto it = lower_bound(next.begin(), next.end(), target, before);
+				if ((it != next.end()) && (it->file == target.file) &&
+						(it->word == target.word) && (it->track == target.track)) {
+					kept.push_back(current[j]);
+				}
+			}
+			current.swap(kept);
+		}
+		matches.insert(matches.end(), current.begin(), current.end());
+	}
+	sort(matches.begin(), matches.end(), before);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getTextCandidates -- Return the files which contain a
+//     match for a text query.
+//
+
+void MSearchIndex::getTextCandidates(vector<int>& files,
+		vector<MSearchTextQuery>& query) {
+	files.clear();
+	vector<MSearchIndexWordPosting> matches;
+	getTextMatches(matches, query);
+	for (int i=0; i<(int)matches.size(); i++) {
+		if (files.empty() || (files.back() != matches[i].file)) {
+			files.push_back(matches[i].file);
+		}
+	}
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -14,6 +14,10 @@
 #include "HumRegex.h"
 #include "Convert.h"
 
+#include <stdlib.h>
+
+#include <sstream>
+
 using namespace std;
 
 namespace hum {
@@ -33,6 +37,11 @@ Tool_msearch::Tool_msearch(void) {
 	define("x|cross=b",         "search across parts");
 	define("c|color=s",         "highlight color");
 	define("m|mark|marker=s:@", "marking character");
+
+	define("build-index=s",     "write an n-gram index of the input files");
+	define("index=s",           "search the files in an n-gram index");
+	define("gram-length=i:4",   "number of notes in each n-gram for --build-index");
+	define("l|list=b",          "list the candidate files for --index without searching them");
 }
 
 
@@ -74,6 +83,22 @@ bool Tool_msearch::run(HumdrumFile& infile, ostream& out) {
 }
 
 
+bool Tool_msearch::run(HumdrumFileStream& instream) {
+	if (getBoolean("build-index")) {
+		return buildIndex(instream);
+	} else if (getBoolean("index")) {
+		return searchIndex();
+	}
+	HumdrumFileSet infiles;
+	infiles.read(instream);
+	bool status = run(infiles);
+	for (int i=0; i<infiles.getCount(); i++) {
+		m_humdrum_text << infiles[i];
+	}
+	return status;
+}
+
+
 bool Tool_msearch::run(HumdrumFile& infile) {
 	NoteGrid grid(infile);
 	if (getBoolean("debug")) {
@@ -100,6 +125,171 @@ bool Tool_msearch::run(HumdrumFile& infile) {
 }
 
 
+//////////////////////////////
+//
+// Tool_msearch::hasIndexMode -- Returns true if the tool should be given
+//    the input stream rather than individual files (--build-index or
+//    --index options).
+//
+
+bool Tool_msearch::hasIndexMode(void) {
+	return getBoolean("build-index") || getBoolean("index");
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::buildIndex -- Write an n-gram and lyric index of the
+//    files in the input stream.  Each segment of each input file is
+//    indexed, and is recorded by its source file and segment number so
+//    that searching can read it again with HumdrumFileStream::readSegment().
+//    Standard input and URLs cannot be read again, so they cannot be
+//    indexed.
+//
+
+bool Tool_msearch::buildIndex(HumdrumFileStream& instream) {
+	const vector<string>& filelist = instream.getFileList();
+	if (filelist.empty()) {
+		setError("Error: --build-index needs input files (standard input cannot be indexed)");
+		return false;
+	}
+	MSearchIndex index;
+	index.setGramLength(getInteger("gram-length"));
+	for (int i=0; i<(int)filelist.size(); i++) {
+		if (!addIndexSource(index, filelist[i])) {
+			return false;
+		}
+	}
+	string filename = getString("build-index");
+	if (!index.write(filename)) {
+		setError("Error: cannot write index " + filename);
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::addIndexSource -- Add the segments of an input file to
+//    an index.  The file is stored by its absolute path, so that the
+//    index can be searched from another directory.
+//
+
+bool Tool_msearch::addIndexSource(MSearchIndex& index, const string& filename) {
+	if (filename.find("://") != string::npos) {
+		setError("Error: cannot index URL " + filename);
+		return false;
+	}
+#ifdef _WIN32
+	char* fullpath = _fullpath(NULL, filename.c_str(), 0);
+#else
+	char* fullpath = realpath(filename.c_str(), NULL);
+#endif
+	if (fullpath == NULL) {
+		setError("Error: cannot open " + filename);
+		return false;
+	}
+	string path = fullpath;
+	free(fullpath);
+
+	HumdrumFileStream segments;
+	int count = segments.buildSegmentIndex(path);
+	stringstream segmentindex;
+	segments.writeSegmentIndex(segmentindex);
+	int source = index.addSource(segmentindex.str());
+
+	HumdrumFile infile;
+	vector<TextInfo*> words;
+	for (int i=0; i<count; i++) {
+		if (!segments.readSegment(infile, i)) {
+			setError("Error: cannot read segment " + to_string(i + 1) + " of " + path);
+			return false;
+		}
+		NoteGrid grid(infile);
+		int file = index.addFile(infile.getFilename(), source, i, grid);
+		fillWords(infile, words);
+		index.addWords(file, words);
+		for (int j=0; j<(int)words.size(); j++) {
+			delete words[j];
+		}
+		words.clear();
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::searchIndex -- Search the files in an n-gram index.  Only
+//    the files which contain all of the n-grams of the query (or, for
+//    text queries, the files which contain matching words) are read from
+//    their source files and searched.  Files with matches are printed
+//    (marked as usual), each preceded by a !!!!SEGMENT: record with its
+//    name.
+//
+
+bool Tool_msearch::searchIndex(void) {
+	MSearchIndex index;
+	string filename = getString("index");
+	if (!index.read(filename)) {
+		setError("Error: cannot read index " + filename);
+		return false;
+	}
+
+	vector<int> candidates;
+	if (getBoolean("text")) {
+		vector<MSearchTextQuery> query;
+		fillTextQuery(query, getString("text"));
+		index.getTextCandidates(candidates, query);
+	} else {
+		vector<MSearchQueryToken> query;
+		fillMusicQuery(query, getString("query"));
+		index.getCandidates(candidates, query);
+	}
+
+	if (getBoolean("list")) {
+		for (int i=0; i<(int)candidates.size(); i++) {
+			m_free_text << index.getFileName(candidates[i]) << endl;
+		}
+		return true;
+	}
+
+	bool status = true;
+	HumdrumFileStream segments;
+	int source = -1;
+	for (int i=0; i<(int)candidates.size(); i++) {
+		string name = index.getFileName(candidates[i]);
+		if (index.getFileSource(candidates[i]) != source) {
+			source = index.getFileSource(candidates[i]);
+			stringstream segmentindex(index.getSourceIndex(source));
+			segments.readSegmentIndex(segmentindex);
+		}
+		HumdrumFile infile;
+		if (!segments.readSegment(infile, index.getFileSegment(candidates[i]))) {
+			m_warning_text << "Warning: cannot read " << name << endl;
+			status = false;
+			continue;
+		}
+		run(infile);
+		if (m_matchcount) {
+			// Segments which are labeled in their source file already
+			// start with their !!!!SEGMENT: record.
+			if ((infile.getLineCount() == 0) ||
+					(infile[0].compare(0, 11, "!!!!SEGMENT") != 0)) {
+				m_humdrum_text << "!!!!SEGMENT: " << name << endl;
+			}
+			m_humdrum_text << infile;
+		}
+	}
+	return status;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::initialize --
@@ -188,6 +378,8 @@ void Tool_msearch::fillWordsForTrack(vector<TextInfo*>& words,
 //////////////////////////////
 //
 // Tool_msearch::doTextSearch -- do a basic text search of all parts.
+//    Each query word is a case-insensitive regular expression.  Words
+//    of a quoted phrase must match consecutive words in the same track.
 //
 
 void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
@@ -197,13 +389,38 @@ void Tool_msearch::doTextSearch(HumdrumFile& infile, NoteGrid& grid,
 	words.reserve(10000);
 	fillWords(infile, words);
 	int tcount = 0;
+	m_matchcount = 0;
 
 	HumRegex hre;
 	for (int i=0; i<(int)query.size(); i++) {
-		for (int j=0; j<(int)words.size(); j++) {
-			if (hre.search(words.at(j)->fullword, query.at(i).word, "i")) {
-				tcount++;
-				markTextMatch(infile, *words[j]);
+		if (query[i].link) {
+			continue;
+		}
+		int length = 1;
+		while ((i + length < (int)query.size()) && query[i+length].link) {
+			length++;
+		}
+		for (int j=0; j+length<=(int)words.size(); j++) {
+			int track = words[j]->starttoken->getTrack();
+			bool found = true;
+			for (int k=0; k<length; k++) {
+				TextInfo* word = words[j+k];
+				if ((k > 0) && (word->starttoken->getTrack() != track)) {
+					found = false;
+					break;
+				}
+				if (!hre.search(word->fullword, query[i+k].word, "i")) {
+					found = false;
+					break;
+				}
+			}
+			if (!found) {
+				continue;
+			}
+			tcount++;
+			m_matchcount++;
+			for (int k=0; k<length; k++) {
+				markTextMatch(infile, *words[j+k]);
 			}
 		}
 	}
@@ -263,11 +480,13 @@ void Tool_msearch::doMusicSearch(HumdrumFile& infile, NoteGrid& grid,
 
 	vector<NoteCell*>  match;
 	int mcount = 0;
+	m_matchcount = 0;
 	for (int i=0; i<(int)attacks.size(); i++) {
 		for (int j=0; j<(int)attacks[i].size(); j++) {
 			checkForMatchDiatonicPC(attacks[i], j, query, match);
 			if (!match.empty()) {
 				mcount++;
+				m_matchcount++;
 				markMatch(infile, match);
 				// cerr << "FOUND MATCH AT " << i << ", " << j << endl;
 				// markNotes(attacks[i], j, (int)query.size());
@@ -518,28 +737,32 @@ bool Tool_msearch::checkForMatchDiatonicPC(vector<NoteCell*>& notes, int index,
 
 //////////////////////////////
 //
-// Tool_msearch::fillTextQuery --
+// Tool_msearch::fillTextQuery -- Split a text query into words.  Words
+//    inside of double quotes form a phrase.
 //
 
 void Tool_msearch::fillTextQuery(vector<MSearchTextQuery>& query,
 		const string& input) {
 	query.clear();
 	bool inquote = false;
+	bool phrase = false;  // next word in quotes continues a phrase
+	MSearchTextQuery temp;
 
-	query.resize(1);
-
-	for (int i=0; i<(int)input.size(); i++) {
-		if (input[i] == '"') {
-			inquote = !inquote;
-			query.resize(query.size() + 1);
+	int size = (int)input.size();
+	for (int i=0; i<=size; i++) {
+		if ((i < size) && (input[i] != '"') && !isspace(input[i])) {
+			temp.word.push_back(input[i]);
 			continue;
 		}
-		if (isspace(input[i])) {
-			query.resize(query.size() + 1);
+		if (!temp.word.empty()) {
+			temp.link = inquote && phrase;
+			query.push_back(temp);
+			phrase = inquote;
+			temp.clear();
 		}
-		query.back().word.push_back(input[i]);
-		if (inquote) {
-			query.back().link = true;
+		if ((i < size) && (input[i] == '"')) {
+			inquote = !inquote;
+			phrase = false;
 		}
 	}
 }
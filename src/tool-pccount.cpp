@@ -43,6 +43,8 @@ Tool_pccount::Tool_pccount(void) {
 	define("title=s", "Title for plot");
 	define("t|template|vega-template=b", "display the vega-lite template.");
 	define("w|width=i:400", "width of vega-lite plot");
+
+	allowParallelSegments();
 }
 
 
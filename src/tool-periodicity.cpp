@@ -38,6 +38,8 @@ Tool_periodicity::Tool_periodicity(void) {
 	define("s|svg=b", "output svg image");
 	define("p|power=d:2.0", "scaling power for visual display");
 	define("1|one=b", "composite rhythms are not weighted by attack");
+
+	allowParallelSegments();
 }
 
 
@@ -217,17 +219,18 @@ void Tool_periodicity::printAttackGrid(ostream& out, HumdrumFile& infile, vector
 //
 
 void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy) {
-	HumNum elements = minrhy * infile.getScoreDuration() / 4;
+	// minrhy is four times tpq(), so grid positions are the same as ticks:
+	long long elements = infile.durationToTicks(infile.getScoreDuration());
 
 	for (int t=0; t<(int)grids.size(); t++) {
-		grids[t].resize(elements.getNumerator());
+		grids[t].resize(elements);
 	}
 
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
 		}
-		HumNum position = infile[i].getDurationFromStart() / 4 * minrhy;
+		long long position = infile[i].getTicksFromStart();
 		for (int j=0; j<infile[i].getFieldCount(); j++) {
 			HTp token = infile.token(i, j);
 			if (!token->isKern()) {
@@ -240,7 +243,7 @@ void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double
 				continue;
 			}
 			int track = token->getTrack();
-			grids.at(track).at(position.getNumerator()) += 1;
+			grids.at(track).at(position) += 1;
 		}
 	}
 
@@ -38,6 +38,8 @@ Tool_pnum::Tool_pnum(void) {
 	define("r|rest=s:0",         "representation string for rests");
 	define("R|no-rests=b",       "do not include rests in conversion");
 	define("x|attacks-only=b",   "only mark lines with note attacks");
+
+	allowParallelSegments();
 }
 
 
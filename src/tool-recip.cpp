@@ -43,6 +43,8 @@ Tool_recip::Tool_recip(void) {
 	define("e|exinterp=s:**recip",   "use the given exinterp for data output");
 	define("n|kern-pitch=s:e",       "note to add for '-e kern' option");
 	define("kern=b",                 "equivalent to '-e kern' option");
+
+	allowParallelSegments();
 }
 
 
@@ -220,7 +222,9 @@ void Tool_recip::replaceKernWithRecip(HumdrumFile& infile) {
 					tok->setText(".");
 				}
 			} else {
-				hre.replaceDestructive(*tok, "", expression, "g");
+				string text = *tok;
+				hre.replaceDestructive(text, "", expression, "g");
+				tok->setText(text);
 			}
 			tok = tok->getNextToken();
 		}
@@ -32,6 +32,8 @@ Tool_slurcheck::Tool_slurcheck(void) {
 	define("c|count=b", "count unclosed slur endings");
 	define("Z|no-zeros=b", "do not list files that have zero unclosed slurs in counts");
 	define("f|filename=b", "print filename for list and count options");
+
+	allowParallelSegments();
 }
 
 
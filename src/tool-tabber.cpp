@@ -28,6 +28,8 @@ namespace hum {
 Tool_tabber::Tool_tabber(void) {
 	// do nothing for now.
 	define("r|remove=b",    "remove any extra tabs");
+
+	allowParallelSegments();
 }
 
 
@@ -33,6 +33,8 @@ namespace hum {
 
 Tool_trillspell::Tool_trillspell(void) {
 	define("x=b", "mark trills with x (interpretation)");
+
+	allowParallelSegments();
 }
 
 
@@ -0,0 +1,372 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 22:40:12 PDT 2026
+// Last Modified: Fri Oct 16 22:40:15 PDT 2026
+// Filename:      humbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Parsing and analysis throughput benchmark.  Each file in
+//                a corpus is loaded into memory, and then the parsing
+//                stages of HumdrumFile are run one at a time so that each
+//                can be timed separately.  For each stage the output lists
+//                the time, MB/s and lines/s of input processed, the number
+//                and size of heap allocations done during the stage, and
+//                the peak resident set size of the process at the end of
+//                the stage.  HumdrumLine and HumdrumToken objects come from
+//                HumPool, so the heap columns count the pool's chunks
+//                rather than each line and token.  Output is tab-separated
+//                (or JSON with -j) so that runs on different commits can be
+//                compared.  With -t, the spine-by-spine content analyses
+//                (slurs and accidentals) use the given number of threads.
+//
+// Usage:         humbench [-r repeat] [-t threads] [-e extension] [-j] directory|file ...
+//
+
+#include "humlib.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace hum;
+using namespace std;
+
+
+// Heap allocation counters, updated by the global operator new below.
+// Objects allocated from HumPool are not counted individually: only the
+// chunks that the pool requests from operator new are.  The counters are
+// atomic since the -t worker threads allocate as well.
+static atomic<unsigned long long> Allocs(0);
+static atomic<unsigned long long> AllocBytes(0);
+
+void* operator new(size_t size) {
+	Allocs.fetch_add(1, memory_order_relaxed);
+	AllocBytes.fetch_add(size, memory_order_relaxed);
+	void* output = malloc(size ? size : 1);
+	if (!output) {
+		throw bad_alloc();
+	}
+	return output;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+
+class Stage {
+	public:
+		string name;
+		int    levels      = 0;
+		double seconds     = 0.0;
+		unsigned long long allocs = 0;
+		unsigned long long bytes  = 0;
+		long   peakrss     = 0;
+};
+
+
+class CorpusFile {
+	public:
+		string name;
+		string contents;
+		int    lines = 0;
+};
+
+
+void   getCorpusFiles   (vector<string>& filenames, const string& path,
+                         const string& extension);
+bool   loadFile         (CorpusFile& file, const string& filename);
+void   runStages        (vector<Stage>& stages, const CorpusFile& file,
+                         int threads);
+long   getPeakRss       (void);
+void   printTsv         (vector<Stage>& stages, unsigned long long inbytes,
+                         unsigned long long inlines, int filecount, int repeat);
+void   printJson        (vector<Stage>& stages, unsigned long long inbytes,
+                         unsigned long long inlines, int filecount, int repeat);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("r|repeat=i:1", "number of times to parse each file");
+	options.define("t|threads=i:1", "number of threads for content analysis");
+	options.define("e|extension=s:krn", "file extension to read in directories");
+	options.define("j|json=b", "print results as JSON");
+	options.process(argc, argv);
+
+	int repeat = options.getInteger("repeat");
+	if (repeat < 1) {
+		repeat = 1;
+	}
+	int threads = options.getInteger("threads");
+	string extension = "." + options.getString("extension");
+
+	vector<string> filenames;
+	if (options.getArgCount() == 0) {
+		getCorpusFiles(filenames, "tests/files", extension);
+	}
+	for (int i=0; i<options.getArgCount(); i++) {
+		getCorpusFiles(filenames, options.getArg(i+1), extension);
+	}
+
+	vector<CorpusFile> corpus(filenames.size());
+	unsigned long long inbytes = 0;
+	unsigned long long inlines = 0;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		if (!loadFile(corpus[i], filenames[i])) {
+			cerr << "Error: cannot read " << filenames[i] << endl;
+			return 1;
+		}
+		inbytes += corpus[i].contents.size();
+		inlines += corpus[i].lines;
+	}
+	if (corpus.empty()) {
+		cerr << "Error: no input files" << endl;
+		return 1;
+	}
+
+	vector<Stage> stages(10);
+	stages[0].name = "read";        stages[0].levels = 0;
+	stages[1].name = "tokens";      stages[1].levels = ANALYZE_TOKENS;
+	stages[2].name = "spines";      stages[2].levels = ANALYZE_SPINES;
+	stages[3].name = "links";       stages[3].levels = ANALYZE_LINKS;
+	stages[4].name = "strands";     stages[4].levels = ANALYZE_STRANDS;
+	stages[5].name = "params";      stages[5].levels = ANALYZE_GLOBALPARAMS
+	                                                 | ANALYZE_LOCALPARAMS;
+	stages[6].name = "rhythm";      stages[6].levels = ANALYZE_RHYTHM;
+	stages[7].name = "slurs";       stages[7].levels = ANALYZE_SLURS;
+	stages[8].name = "ties";        stages[8].levels = ANALYZE_TIES;
+	stages[9].name = "accidentals"; stages[9].levels = ANALYZE_ACCIDENTALS;
+
+	for (int r=0; r<repeat; r++) {
+		for (int i=0; i<(int)corpus.size(); i++) {
+			runStages(stages, corpus[i], threads);
+		}
+	}
+
+	if (options.getBoolean("json")) {
+		printJson(stages, inbytes * repeat, inlines * repeat, (int)corpus.size(), repeat);
+	} else {
+		printTsv(stages, inbytes * repeat, inlines * repeat, (int)corpus.size(), repeat);
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// runStages -- Parse a file one analysis stage at a time.  The file
+//     contents are already in memory, so the "read" stage measures
+//     splitting the contents into lines without disk access.
+//
+
+void runStages(vector<Stage>& stages, const CorpusFile& file, int threads) {
+	HumdrumFile infile;
+	infile.setAnalysisLevel(0);
+	infile.setThreadCount(threads);
+	for (int i=0; i<(int)stages.size(); i++) {
+		unsigned long long allocs = Allocs;
+		unsigned long long bytes = AllocBytes;
+		auto start = chrono::steady_clock::now();
+		if (i == 0) {
+			infile.readString(file.contents);
+		} else {
+			infile.analyze(stages[i].levels);
+		}
+		auto stop = chrono::steady_clock::now();
+		stages[i].seconds += chrono::duration<double>(stop - start).count();
+		stages[i].allocs += Allocs - allocs;
+		stages[i].bytes += AllocBytes - bytes;
+		stages[i].peakrss = getPeakRss();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// getCorpusFiles -- Add a file, or the files in a directory (recursively)
+//     which end in the given extension, to the list of files.
+//
+
+void getCorpusFiles(vector<string>& filenames, const string& path,
+		const string& extension) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		cerr << "Warning: cannot find " << path << endl;
+		return;
+	}
+	if (!S_ISDIR(info.st_mode)) {
+		filenames.push_back(path);
+		return;
+	}
+	DIR* dir = opendir(path.c_str());
+	if (!dir) {
+		return;
+	}
+	vector<string> entries;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		string name = entry->d_name;
+		if (name.empty() || (name[0] == '.')) {
+			continue;
+		}
+		entries.push_back(path + "/" + name);
+	}
+	closedir(dir);
+	sort(entries.begin(), entries.end());
+	for (int i=0; i<(int)entries.size(); i++) {
+		if ((stat(entries[i].c_str(), &info) == 0) && S_ISDIR(info.st_mode)) {
+			getCorpusFiles(filenames, entries[i], extension);
+			continue;
+		}
+		if ((entries[i].size() > extension.size()) &&
+				(entries[i].compare(entries[i].size() - extension.size(),
+				extension.size(), extension) == 0)) {
+			filenames.push_back(entries[i]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// loadFile -- Read a file into memory and count its lines.
+//
+
+bool loadFile(CorpusFile& file, const string& filename) {
+	ifstream input(filename, ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	stringstream buffer;
+	buffer << input.rdbuf();
+	file.name = filename;
+	file.contents = buffer.str();
+	file.lines = 0;
+	for (int i=0; i<(int)file.contents.size(); i++) {
+		if (file.contents[i] == '\n') {
+			file.lines++;
+		}
+	}
+	if (!file.contents.empty() && (file.contents.back() != '\n')) {
+		file.lines++;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// getPeakRss -- Peak resident set size of the process in kilobytes.
+//
+
+long getPeakRss(void) {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// printTsv -- Print one line for each stage followed by a total.
+//
+
+void printTsv(vector<Stage>& stages, unsigned long long inbytes,
+		unsigned long long inlines, int filecount, int repeat) {
+	cout << "!!files:\t" << filecount << endl;
+	cout << "!!repeat:\t" << repeat << endl;
+	cout << "!!bytes:\t" << inbytes << endl;
+	cout << "!!lines:\t" << inlines << endl;
+	cout << "**stage\t**sec\t**mbps\t**lps\t**heapallocs\t**heapbytes\t**rsskb" << endl;
+	Stage total;
+	total.name = "total";
+	for (int i=0; i<(int)stages.size() + 1; i++) {
+		Stage& stage = (i < (int)stages.size()) ? stages[i] : total;
+		if (i < (int)stages.size()) {
+			total.seconds += stage.seconds;
+			total.allocs  += stage.allocs;
+			total.bytes   += stage.bytes;
+			total.peakrss  = stage.peakrss;
+		}
+		double seconds = stage.seconds > 0.0 ? stage.seconds : 1.0e-9;
+		cout << stage.name;
+		cout << "\t" << stage.seconds;
+		cout << "\t" << inbytes / seconds / 1.0e6;
+		cout << "\t" << inlines / seconds;
+		cout << "\t" << stage.allocs;
+		cout << "\t" << stage.bytes;
+		cout << "\t" << stage.peakrss;
+		cout << endl;
+	}
+	cout << "*-\t*-\t*-\t*-\t*-\t*-\t*-" << endl;
+}
+
+
+
+//////////////////////////////
+//
+// printJson -- Print the results as a JSON object.
+//
+
+void printJson(vector<Stage>& stages, unsigned long long inbytes,
+		unsigned long long inlines, int filecount, int repeat) {
+	cout << "{\n";
+	cout << "\t\"files\": "  << filecount << ",\n";
+	cout << "\t\"repeat\": " << repeat    << ",\n";
+	cout << "\t\"bytes\": "  << inbytes   << ",\n";
+	cout << "\t\"lines\": "  << inlines   << ",\n";
+	cout << "\t\"stages\": [\n";
+	for (int i=0; i<(int)stages.size(); i++) {
+		double seconds = stages[i].seconds > 0.0 ? stages[i].seconds : 1.0e-9;
+		cout << "\t\t{";
+		cout << "\"stage\": \""   << stages[i].name << "\", ";
+		cout << "\"sec\": "       << stages[i].seconds << ", ";
+		cout << "\"mbps\": "      << inbytes / seconds / 1.0e6 << ", ";
+		cout << "\"lps\": "       << inlines / seconds << ", ";
+		cout << "\"heapallocs\": " << stages[i].allocs << ", ";
+		cout << "\"heapbytes\": "  << stages[i].bytes << ", ";
+		cout << "\"rsskb\": "     << stages[i].peakrss;
+		cout << "}";
+		if (i < (int)stages.size() - 1) {
+			cout << ",";
+		}
+		cout << "\n";
+	}
+	cout << "\t]\n";
+	cout << "}" << endl;
+}
+
+
+
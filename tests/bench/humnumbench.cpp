@@ -0,0 +1,287 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 14:05:21 PDT 2026
+// Last Modified: Sat Oct 17 14:05:24 PDT 2026
+// Filename:      humnumbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Micro-benchmarks for HumNum arithmetic, followed by the
+//                time taken by rhythmic analysis (the main user of HumNum
+//                while parsing) over a corpus.  Each HumNum test cycles
+//                through a table of durations which includes dotted
+//                values and nested tuplets, and prints the average time
+//                per operation.  A checksum of the results is printed so
+//                that the operations cannot be optimized away, and so
+//                that runs on different commits can be checked for equal
+//                results.  (The "accumulate" checksum is different for
+//                versions of HumNum without 64-bit intermediate products,
+//                since the running total overflows there.)
+//
+// Usage:         humnumbench [-n count] [-r repeat] [-e extension] directory|file ...
+//
+
+#include "humlib.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace hum;
+using namespace std;
+
+
+class Result {
+	public:
+		string name;
+		double seconds = 0.0;
+		long long count = 0;
+		long long checksum = 0;
+};
+
+
+void   getCorpusFiles   (vector<string>& filenames, const string& path,
+                         const string& extension);
+void   getDurations     (vector<HumNum>& durations);
+void   runArithmetic    (vector<Result>& results, const vector<HumNum>& durations,
+                         long long count);
+void   runRhythm        (Result& result, const vector<string>& contents,
+                         int repeat);
+void   printResults     (const vector<Result>& results);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:10000000", "number of operations for each HumNum test");
+	options.define("r|repeat=i:5", "number of times to analyze each file");
+	options.define("e|extension=s:krn", "file extension to read in directories");
+	options.process(argc, argv);
+
+	long long count = options.getInteger("count");
+	if (count < 1) {
+		count = 1;
+	}
+	int repeat = options.getInteger("repeat");
+	if (repeat < 1) {
+		repeat = 1;
+	}
+	string extension = "." + options.getString("extension");
+
+	vector<string> filenames;
+	if (options.getArgCount() == 0) {
+		getCorpusFiles(filenames, "tests/files", extension);
+	}
+	for (int i=0; i<options.getArgCount(); i++) {
+		getCorpusFiles(filenames, options.getArg(i+1), extension);
+	}
+	vector<string> contents;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		ifstream input(filenames[i], ios::binary);
+		if (!input.is_open()) {
+			cerr << "Error: cannot read " << filenames[i] << endl;
+			return 1;
+		}
+		stringstream buffer;
+		buffer << input.rdbuf();
+		contents.push_back(buffer.str());
+	}
+
+	vector<HumNum> durations;
+	getDurations(durations);
+
+	vector<Result> results;
+	runArithmetic(results, durations, count);
+	if (!contents.empty()) {
+		results.emplace_back();
+		runRhythm(results.back(), contents, repeat);
+	}
+	printResults(results);
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// getDurations -- Fill a table of durations (in quarter notes) such as
+//     those found in **kern data: plain and dotted values, triplets,
+//     quintuplets, and nested tuplets.
+//
+
+void getDurations(vector<HumNum>& durations) {
+	const char* recips[] = {
+		"4", "8", "16", "2", "4.", "8.", "16", "1", "32", "2.",
+		"12", "6", "24", "3", "48", "10", "20", "40", "5", "7",
+		"14", "28", "9", "18", "36", "24", "72", "60", "15", "30",
+		"11", "22", "13", "26", "120", "144", "3%2", "9%2", "3%5",
+		"35", "70", "105", "231", "1155"
+	};
+	for (int i=0; i<(int)(sizeof(recips) / sizeof(recips[0])); i++) {
+		durations.push_back(Convert::recipToDuration(recips[i]));
+	}
+}
+
+
+
+//////////////////////////////
+//
+// runArithmetic -- Time each HumNum operation.  The durations are
+//     accessed through an index so that the compiler cannot precompute
+//     the results.
+//
+
+void runArithmetic(vector<Result>& results, const vector<HumNum>& durations,
+		long long count) {
+	int size = (int)durations.size();
+	const char* names[] = {
+		"add-same", "add-mixed", "add-int", "sub-mixed", "mul",
+		"div", "compare", "equal", "accumulate"
+	};
+	int tests = (int)(sizeof(names) / sizeof(names[0]));
+	for (int t=0; t<tests; t++) {
+		Result result;
+		result.name = names[t];
+		result.count = count;
+		HumNum sum;
+		long long checksum = 0;
+		int k = 0;
+		auto start = chrono::steady_clock::now();
+		for (long long i=0; i<count; i++) {
+			const HumNum& a = durations[k];
+			const HumNum& b = durations[(k * 7 + 3) % size];
+			switch (t) {
+				case 0: sum = a + a; break;
+				case 1: sum = a + b; break;
+				case 2: sum = a + (int)(i & 7); break;
+				case 3: sum = a - b; break;
+				case 4: sum = a * b; break;
+				case 5: sum = a / b; break;
+				case 6: checksum += (a < b); break;
+				case 7: checksum += (a == b); break;
+				case 8:
+					// Running total, as when timestamps are assigned to lines.
+					sum += a;
+					if (sum > 1000) {
+						sum = 0;
+					}
+					break;
+			}
+			checksum += sum.getNumerator() + sum.getDenominator();
+			if (++k >= size) {
+				k = 0;
+			}
+		}
+		auto stop = chrono::steady_clock::now();
+		result.seconds = chrono::duration<double>(stop - start).count();
+		result.checksum = checksum;
+		results.push_back(result);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// runRhythm -- Time the rhythmic analysis of each file (after the
+//     analyses that it depends on have been done).
+//
+
+void runRhythm(Result& result, const vector<string>& contents, int repeat) {
+	result.name = "analyzeRhythm";
+	int prior = ANALYZE_TOKENS | ANALYZE_SPINES | ANALYZE_LINKS |
+			ANALYZE_STRANDS | ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS;
+	for (int r=0; r<repeat; r++) {
+		for (int i=0; i<(int)contents.size(); i++) {
+			HumdrumFile infile;
+			infile.setAnalysisLevel(0);
+			infile.readString(contents[i]);
+			infile.analyze(prior);
+			auto start = chrono::steady_clock::now();
+			infile.analyze(ANALYZE_RHYTHM);
+			auto stop = chrono::steady_clock::now();
+			result.seconds += chrono::duration<double>(stop - start).count();
+			result.count += infile.getLineCount();
+			result.checksum += infile.getScoreDuration().getNumerator();
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// getCorpusFiles -- Add a file, or the files in a directory (recursively)
+//     which end in the given extension, to the list of files.
+//
+
+void getCorpusFiles(vector<string>& filenames, const string& path,
+		const string& extension) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		cerr << "Warning: cannot find " << path << endl;
+		return;
+	}
+	if (!S_ISDIR(info.st_mode)) {
+		filenames.push_back(path);
+		return;
+	}
+	DIR* dir = opendir(path.c_str());
+	if (!dir) {
+		return;
+	}
+	vector<string> entries;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		string name = entry->d_name;
+		if (name.empty() || (name[0] == '.')) {
+			continue;
+		}
+		entries.push_back(path + "/" + name);
+	}
+	closedir(dir);
+	sort(entries.begin(), entries.end());
+	for (int i=0; i<(int)entries.size(); i++) {
+		if ((stat(entries[i].c_str(), &info) == 0) && S_ISDIR(info.st_mode)) {
+			getCorpusFiles(filenames, entries[i], extension);
+			continue;
+		}
+		if ((entries[i].size() > extension.size()) &&
+				(entries[i].compare(entries[i].size() - extension.size(),
+				extension.size(), extension) == 0)) {
+			filenames.push_back(entries[i]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// printResults -- Print the time per operation for each test.  For the
+//     analyzeRhythm test the count is the number of lines analyzed.
+//
+
+void printResults(const vector<Result>& results) {
+	cout << "**test\t**count\t**sec\t**nsop\t**check" << endl;
+	for (int i=0; i<(int)results.size(); i++) {
+		const Result& result = results[i];
+		double nsop = result.count > 0 ? result.seconds * 1.0e9 / result.count : 0.0;
+		cout << result.name;
+		cout << "\t" << result.count;
+		cout << "\t" << result.seconds;
+		cout << "\t" << nsop;
+		cout << "\t" << result.checksum;
+		cout << endl;
+	}
+	cout << "*-\t*-\t*-\t*-\t*-" << endl;
+}
+
+
+
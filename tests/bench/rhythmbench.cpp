@@ -0,0 +1,205 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 16:32:08 PDT 2026
+// Last Modified: Sat Oct 17 16:32:11 PDT 2026
+// Filename:      rhythmbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Scaling test for rhythmic analysis.  Synthetic scores of
+//                increasing length are generated, in which every part
+//                splits into two sub-spines (*^) in every other measure,
+//                with triplets against quarter notes in the sub-spines,
+//                and then merges again (*v) one part at a time.  For each
+//                score the time taken by analyzeRhythm (after the analyses
+//                that it depends on) is printed along with the time per
+//                token.  For linear scaling, the time per token should stay
+//                about the same as the score length doubles: the "scale"
+//                column is the ratio of the time per token to that of the
+//                smallest score.
+//
+// Usage:         rhythmbench [-p parts] [-m measures] [-s steps] [-r repeat]
+//
+
+#include "humlib.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+using namespace hum;
+using namespace std;
+
+
+void   makeScore   (string& output, int parts, int measures);
+void   addLine     (stringstream& out, const vector<string>& fields);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("p|parts=i:8", "number of parts in each score");
+	options.define("m|measures=i:250", "number of measures in the smallest score");
+	options.define("s|steps=i:5", "number of scores (each twice as long as the previous)");
+	options.define("r|repeat=i:3", "number of times to analyze each score");
+	options.process(argc, argv);
+
+	int parts = options.getInteger("parts");
+	int measures = options.getInteger("measures");
+	int steps = options.getInteger("steps");
+	int repeat = options.getInteger("repeat");
+	if (parts < 1) {
+		parts = 1;
+	}
+	if (measures < 1) {
+		measures = 1;
+	}
+	if (repeat < 1) {
+		repeat = 1;
+	}
+
+	int prior = ANALYZE_TOKENS | ANALYZE_SPINES | ANALYZE_LINKS |
+			ANALYZE_STRANDS | ANALYZE_GLOBALPARAMS | ANALYZE_LOCALPARAMS;
+
+	// Untimed run so that the first score is not timed with a cold heap.
+	string warmup;
+	makeScore(warmup, parts, measures);
+	HumdrumFile warmfile;
+	warmfile.readString(warmup);
+
+	cout << "**measures\t**lines\t**tokens\t**sec\t**nstok\t**scale" << endl;
+	double basens = 0.0;
+	for (int s=0; s<steps; s++) {
+		string contents;
+		makeScore(contents, parts, measures);
+		double seconds = 0.0;
+		int lines = 0;
+		long long tokens = 0;
+		for (int r=0; r<repeat; r++) {
+			HumdrumFile infile;
+			infile.setAnalysisLevel(0);
+			infile.readString(contents);
+			infile.analyze(prior);
+			auto start = chrono::steady_clock::now();
+			bool status = infile.analyze(ANALYZE_RHYTHM);
+			auto stop = chrono::steady_clock::now();
+			if (!status) {
+				cerr << "Error: rhythm analysis failed for " << measures
+				     << " measures" << endl;
+				return 1;
+			}
+			seconds += chrono::duration<double>(stop - start).count();
+			lines = infile.getLineCount();
+			tokens = 0;
+			for (int i=0; i<lines; i++) {
+				tokens += infile[i].getFieldCount();
+			}
+		}
+		seconds /= repeat;
+		double nstok = seconds * 1.0e9 / tokens;
+		if (s == 0) {
+			basens = nstok;
+		}
+		cout << measures;
+		cout << "\t" << lines;
+		cout << "\t" << tokens;
+		cout << "\t" << seconds;
+		cout << "\t" << nstok;
+		cout << "\t" << (basens > 0.0 ? nstok / basens : 1.0);
+		cout << endl;
+		measures *= 2;
+	}
+	cout << "*-\t*-\t*-\t*-\t*-\t*-" << endl;
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Create a **kern score in which every part splits in the
+//     odd-numbered measures.  The first sub-spine has quarter notes and
+//     the second has triplet eighth notes, so most of the tokens in the
+//     first sub-spine are null tokens.
+//
+
+void makeScore(string& output, int parts, int measures) {
+	stringstream out;
+	vector<string> fields;
+
+	fields.assign(parts, "**kern");
+	addLine(out, fields);
+	fields.assign(parts, "*M4/4");
+	addLine(out, fields);
+
+	for (int m=1; m<=measures; m++) {
+		bool split = (m % 2) == 1;
+		if (split) {
+			fields.assign(parts, "*^");
+			addLine(out, fields);
+		}
+		int columns = split ? parts * 2 : parts;
+		fields.assign(columns, "=" + to_string(m));
+		addLine(out, fields);
+		if (split) {
+			for (int i=0; i<12; i++) {
+				for (int p=0; p<parts; p++) {
+					fields[p*2]   = (i % 3 == 0) ? "4c" : ".";
+					fields[p*2+1] = (i % 2 == 0) ? "12e" : "12g";
+				}
+				addLine(out, fields);
+			}
+			// Merge one part per line so that adjacent parts stay separate.
+			for (int p=0; p<parts; p++) {
+				fields.clear();
+				for (int q=0; q<parts; q++) {
+					if (q < p) {
+						fields.push_back("*");
+					} else if (q == p) {
+						fields.push_back("*v");
+						fields.push_back("*v");
+					} else {
+						fields.push_back("*");
+						fields.push_back("*");
+					}
+				}
+				addLine(out, fields);
+			}
+		} else {
+			for (int i=0; i<4; i++) {
+				fields.assign(parts, (i % 2 == 0) ? "4d" : "8f");
+				if (i % 2) {
+					addLine(out, fields);
+				}
+				addLine(out, fields);
+			}
+		}
+	}
+
+	fields.assign(parts, "==");
+	addLine(out, fields);
+	fields.assign(parts, "*-");
+	addLine(out, fields);
+	output = out.str();
+}
+
+
+
+//////////////////////////////
+//
+// addLine -- Print a list of fields as a tab-separated line.
+//
+
+void addLine(stringstream& out, const vector<string>& fields) {
+	for (int i=0; i<(int)fields.size(); i++) {
+		if (i > 0) {
+			out << '\t';
+		}
+		out << fields[i];
+	}
+	out << '\n';
+}
+
+
+
@@ -0,0 +1,134 @@
+// Description: Check that a file written with writeBinary() and loaded
+//              again with readBinaryBuffer() has the same structure and
+//              rhythm analysis as a parse of the original text, and that
+//              a .humb image with corrupted tables is rejected.
+
+#include "humlib.h"
+
+#include <string.h>
+
+using namespace hum;
+
+const string Text =
+   "!!!COM: Test\n"
+   "**kern\t**kern\t**dynam\n"
+   "*M3/4\t*M3/4\t*\n"
+   "=1\t=1\t=1\n"
+   "4c\t4e\tp\n"
+   "*\t*^\t*\n"
+   "8d\t4f\t8a\t.\n"
+   "8e\t.\t8b\t.\n"
+   "4f\t4g\t4cc\t<\n"
+   "*\t*v\t*v\t*\n"
+   "=2\t=2\t=2\n"
+   "4g/ 4b/\t[2c\tf\n"
+   "!\t!LO:TX:t=hi\t!\n"
+   "8qa\t.\t.\n"
+   "4a\t.\t.\n"
+   "4b\t4c]\t.\n"
+   "==\t==\t==\n"
+   "*-\t*-\t*-\n";
+
+int compareFiles(HumdrumFile& binary, HumdrumFile& text) {
+   int errors = 0;
+   if (binary.getLineCount() != text.getLineCount()) {
+      cout << "LINE COUNT: binary " << binary.getLineCount()
+           << " text " << text.getLineCount() << endl;
+      return 1;
+   }
+   if ((binary.tpq() != text.tpq()) ||
+         (binary.getMaxTrack() != text.getMaxTrack()) ||
+         (binary.getStrandCount() != text.getStrandCount()) ||
+         (binary.getBarlineCount() != text.getBarlineCount())) {
+      cout << "FILE: binary tpq " << binary.tpq() << " tracks "
+           << binary.getMaxTrack() << " strands " << binary.getStrandCount()
+           << " barlines " << binary.getBarlineCount() << endl;
+      errors++;
+   }
+   for (int i=0; i<text.getLineCount(); i++) {
+      if (((string)binary[i] != (string)text[i]) ||
+            (binary[i].getFieldCount() != text[i].getFieldCount()) ||
+            (binary[i].getDurationFromStart() != text[i].getDurationFromStart()) ||
+            (binary[i].getDuration() != text[i].getDuration()) ||
+            (binary[i].getDurationFromBarline() != text[i].getDurationFromBarline()) ||
+            (binary[i].getDurationToBarline() != text[i].getDurationToBarline()) ||
+            (binary[i].getTicksFromStart() != text[i].getTicksFromStart())) {
+         cout << "LINE " << i + 1 << ": binary " << binary[i] << "\t"
+              << binary[i].getDurationFromStart() << "/" << binary[i].getDuration()
+              << " text " << text[i] << "\t"
+              << text[i].getDurationFromStart() << "/" << text[i].getDuration()
+              << endl;
+         errors++;
+         continue;
+      }
+      for (int j=0; j<text[i].getFieldCount(); j++) {
+         HTp btok = binary.token(i, j);
+         HTp ttok = text.token(i, j);
+         if ((*btok != *ttok) ||
+               (btok->getDuration() != ttok->getDuration()) ||
+               (btok->getTrack() != ttok->getTrack()) ||
+               (btok->getSubtrack() != ttok->getSubtrack()) ||
+               (btok->getSpineInfo() != ttok->getSpineInfo()) ||
+               (btok->getStrandIndex() != ttok->getStrandIndex()) ||
+               (btok->getNextTokenCount() != ttok->getNextTokenCount()) ||
+               (btok->getPreviousTokenCount() != ttok->getPreviousTokenCount()) ||
+               (*btok->resolveNull() != *ttok->resolveNull()) ||
+               (btok->getValue("LO", "TX", "t") != ttok->getValue("LO", "TX", "t"))) {
+            cout << "TOKEN " << i + 1 << ":" << j + 1 << ": binary "
+                 << *btok << " " << btok->getSpineInfo() << " "
+                 << btok->getDuration() << " text "
+                 << *ttok << " " << ttok->getSpineInfo() << " "
+                 << ttok->getDuration() << endl;
+            errors++;
+         }
+      }
+   }
+   return errors;
+}
+
+int main(int argc, char** argv) {
+   int errors = 0;
+
+   HumdrumFile text;
+   text.readString(Text);
+   text.setFilename("test-binary.krn");
+   stringstream image;
+   if (!text.writeBinary(image)) {
+      cout << "writeBinary failed" << endl;
+      errors++;
+   }
+   string data = image.str();
+
+   HumdrumFile binary;
+   if (!binary.readBinaryBuffer(data.data(), data.size())) {
+      cout << "readBinaryBuffer failed: " << binary.getParseError() << endl;
+      errors++;
+   } else {
+      int count = compareFiles(binary, text);
+      cout << "round trip:\t" << (count ? "differs" : "ok") << endl;
+      errors += count;
+   }
+
+   // Point the first line at a token past the end of the token table
+   // (HumbLine::firsttoken, which follows the 22-int header and the
+   // line's text offset and length).
+   string corrupt = data;
+   int badindex = 0x7fffffff;
+   memcpy(&corrupt[22 * sizeof(int) + 2 * sizeof(int)], &badindex, sizeof(int));
+   HumdrumFile bad;
+   bool status = bad.readBinaryBuffer(corrupt.data(), corrupt.size());
+   if (status || bad.isValid() || (bad.getLineCount() != 0) ||
+         (bad.getParseError().find("test-binary.krn") == string::npos)) {
+      cout << "corrupted tables:\tnot rejected (" << bad.getParseError() << ")" << endl;
+      errors++;
+   } else {
+      cout << "corrupted tables:\tok" << endl;
+   }
+
+   if (errors) {
+      cout << "FAIL: " << errors << " differences" << endl;
+      return 1;
+   }
+   cout << "PASS" << endl;
+   return 0;
+}
@@ -0,0 +1,147 @@
+// Description: Check that the rhythm analysis repaired by reanalyzeEdits()
+//              after inserting, deleting and changing lines and tokens
+//              matches a fresh parse of the edited text.
+
+#include "humlib.h"
+
+using namespace hum;
+
+const string Text =
+   "**kern\t**kern\n"
+   "*M4/4\t*M4/4\n"
+   "=1\t=1\n"
+   "4c\t4e\n4d\t4f\n4e\t4g\n4f\t4a\n"
+   "=2\t=2\n"
+   "4g\t2b\n4a\t.\n!\t!\n2b\t2dd\n"
+   "=3\t=3\n"
+   "1cc\t1ee\n"
+   "*-\t*-\n";
+
+int compareFiles(HumdrumFile& edited, HumdrumFile& fresh) {
+   int errors = 0;
+   if (edited.getLineCount() != fresh.getLineCount()) {
+      cout << "LINE COUNT: edited " << edited.getLineCount()
+           << " fresh " << fresh.getLineCount() << endl;
+      return 1;
+   }
+   if (edited.tpq() != fresh.tpq()) {
+      cout << "TPQ: edited " << edited.tpq() << " fresh " << fresh.tpq() << endl;
+      errors++;
+   }
+   for (int i=0; i<fresh.getLineCount(); i++) {
+      if ((edited[i].getDurationFromStart() != fresh[i].getDurationFromStart()) ||
+            (edited[i].getDuration() != fresh[i].getDuration()) ||
+            (edited[i].getDurationFromBarline() != fresh[i].getDurationFromBarline()) ||
+            (edited[i].getDurationToBarline() != fresh[i].getDurationToBarline()) ||
+            (edited[i].getTicksFromStart() != fresh[i].getTicksFromStart())) {
+         cout << "LINE " << i + 1 << ": edited "
+              << edited[i].getDurationFromStart() << "/" << edited[i].getDuration()
+              << " fresh "
+              << fresh[i].getDurationFromStart() << "/" << fresh[i].getDuration()
+              << "\t" << fresh[i] << endl;
+         errors++;
+      }
+      if (!fresh[i].hasSpines()) {
+         continue;
+      }
+      for (int j=0; j<fresh[i].getFieldCount(); j++) {
+         HTp etok = edited.token(i, j);
+         HTp ftok = fresh.token(i, j);
+         if ((etok->getDuration() != ftok->getDuration()) ||
+               (etok->getStrandIndex() != ftok->getStrandIndex()) ||
+               (*etok->resolveNull() != *ftok->resolveNull())) {
+            cout << "TOKEN " << i + 1 << ":" << j + 1 << ": edited "
+                 << etok->getDuration() << " " << *etok->resolveNull()
+                 << " fresh "
+                 << ftok->getDuration() << " " << *ftok->resolveNull()
+                 << "\t" << *ftok << endl;
+            errors++;
+         }
+      }
+   }
+   return errors;
+}
+
+int checkEdit(HumdrumFile& edited, const string& name) {
+   edited.reanalyzeEdits();
+   stringstream newtext;
+   for (int i=0; i<edited.getLineCount(); i++) {
+      newtext << edited[i] << "\n";
+   }
+   HumdrumFile fresh;
+   fresh.readString(newtext.str());
+   int errors = compareFiles(edited, fresh);
+   if (!edited.isValid() || !fresh.isValid()) {
+      errors++;
+   }
+   cout << name << ":\t" << (errors ? "differs" : "ok") << endl;
+   return errors;
+}
+
+int main(int argc, char** argv) {
+   int errors = 0;
+
+   {
+      // change the rhythm of one token
+      HumdrumFile infile;
+      infile.readString(Text);
+      infile.token(4, 0)->setText("8d");
+      infile.token(4, 1)->setText("8f");
+      infile[4].createLineFromTokens();
+      infile.token(5, 0)->setText("4.e");
+      infile.token(5, 1)->setText("4.g");
+      infile[5].createLineFromTokens();
+      errors += checkEdit(infile, "token rhythm");
+   }
+
+   {
+      // make a note null and extend the previous note
+      HumdrumFile infile;
+      infile.readString(Text);
+      infile.token(3, 1)->setText("2e");
+      infile.token(4, 1)->setText(".");
+      infile[3].createLineFromTokens();
+      infile[4].createLineFromTokens();
+      errors += checkEdit(infile, "token to null");
+   }
+
+   {
+      // split a note into two lines
+      HumdrumFile infile;
+      infile.readString(Text);
+      infile.token(3, 0)->setText("8c");
+      infile.token(3, 1)->setText("8e");
+      infile[3].createLineFromTokens();
+      infile.insertLine(4, "8cc\t8ee");
+      errors += checkEdit(infile, "insert line");
+   }
+
+   {
+      // merge two lines into one
+      HumdrumFile infile;
+      infile.readString(Text);
+      infile.token(5, 0)->setText("2e");
+      infile.token(5, 1)->setText("2g");
+      infile[5].createLineFromTokens();
+      infile.deleteLine(6);
+      errors += checkEdit(infile, "delete line");
+   }
+
+   {
+      // change a null token under a sustained note into a note
+      HumdrumFile infile;
+      infile.readString(Text);
+      infile.token(8, 1)->setText("4b");
+      infile.token(9, 1)->setText("4cc");
+      infile[8].createLineFromTokens();
+      infile[9].createLineFromTokens();
+      errors += checkEdit(infile, "null to token");
+   }
+
+   if (errors) {
+      cout << "FAIL: " << errors << " differences" << endl;
+      return 1;
+   }
+   cout << "PASS" << endl;
+   return 0;
+}
@@ -0,0 +1,72 @@
+// Description: Check that the tick timeline after editing a line and
+//              calling reanalyzeEdits() matches a fresh parse of the
+//              edited text.
+
+#include "humlib.h"
+
+using namespace hum;
+
+int compareTicks(HumdrumFile& edited, HumdrumFile& fresh) {
+   int errors = 0;
+   if (edited.tpq() != fresh.tpq()) {
+      cout << "TPQ: edited " << edited.tpq() << " fresh " << fresh.tpq() << endl;
+      errors++;
+   }
+   for (int i=0; i<fresh.getLineCount(); i++) {
+      if ((edited[i].getTicksFromStart() != fresh[i].getTicksFromStart()) ||
+            (edited[i].getTickDuration() != fresh[i].getTickDuration()) ||
+            (edited[i].getTicksFromBarline() != fresh[i].getTicksFromBarline()) ||
+            (edited[i].getTicksToBarline() != fresh[i].getTicksToBarline())) {
+         cout << "LINE " << i + 1 << ": edited "
+              << edited[i].getTicksFromStart() << "/" << edited[i].getTickDuration()
+              << " fresh "
+              << fresh[i].getTicksFromStart() << "/" << fresh[i].getTickDuration()
+              << "\t" << fresh[i] << endl;
+         errors++;
+      }
+   }
+   return errors;
+}
+
+int main(int argc, char** argv) {
+   string text =
+      "**kern\t**kern\n"
+      "*M4/4\t*M4/4\n"
+      "=1\t=1\n"
+      "4c\t4e\n4d\t4f\n4e\t4g\n4f\t4a\n"
+      "=2\t=2\n"
+      "4g\t4b\n4a\t4cc\n2b\t2dd\n"
+      "=3\t=3\n"
+      "1cc\t1ee\n"
+      "*-\t*-\n";
+
+   // New durations for the second note of each spine:
+   const char* edits[][2] = { {"8d", "8f"}, {"16d", "16f"}, {"8.d", "8.f"} };
+   int errors = 0;
+   for (int k=0; k<3; k++) {
+      HumdrumFile edited;
+      edited.readString(text);
+      edited.tpq();
+      edited[4].token(0)->setText(edits[k][0]);
+      edited[4].token(1)->setText(edits[k][1]);
+      edited[4].createLineFromTokens();
+      edited.reanalyzeEdits();
+
+      stringstream newtext;
+      for (int i=0; i<edited.getLineCount(); i++) {
+         newtext << edited[i] << "\n";
+      }
+      HumdrumFile fresh;
+      fresh.readString(newtext.str());
+
+      cout << "EDIT " << edited[4] << ":\ttpq " << edited.tpq() << endl;
+      errors += compareTicks(edited, fresh);
+   }
+
+   if (errors) {
+      cout << "FAIL: " << errors << " differences" << endl;
+      return 1;
+   }
+   cout << "PASS" << endl;
+   return 0;
+}
@@ -0,0 +1,69 @@
+// Description: Check that the peak memory use of a prefetching
+//              HumdrumFileStream does not grow with the number of
+//              segments in the input.  Segments are parsed on the
+//              prefetch thread and deleted on the main thread.
+
+#include "humlib.h"
+
+#include <sys/resource.h>
+
+using namespace hum;
+
+long getPeakKb(void) {
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_maxrss;
+}
+
+int main(int argc, char** argv) {
+   int segments = 8192;
+   if (argc > 1) {
+      segments = atoi(argv[1]);
+   }
+
+   stringstream segment;
+   segment << "**kern\t**kern\n*M4/4\t*M4/4\n";
+   for (int i=0; i<64; i++) {
+      segment << "=" << i+1 << "\t=" << i+1 << "\n";
+      segment << "4c\t4e\n8d\t8f\n8e\t8g\n4f\t4a\n4g\t4b\n";
+   }
+   segment << "*-\t*-\n";
+   string text;
+   for (int i=0; i<segments; i++) {
+      text += "!!!!SEGMENT: s" + to_string(i) + ".krn\n";
+      text += segment.str();
+   }
+
+   HumdrumFileStream instream;
+   instream.loadString(text);
+   instream.setPrefetch(4, 256 << 20);
+
+   HumdrumFileSet infiles;
+   int count = 0;
+   long startkb = 0;
+   while (instream.readSingleSegment(infiles)) {
+      infiles.clear();
+      count++;
+      if (count == segments / 8) {
+         startkb = getPeakKb();
+      }
+   }
+   long endkb = getPeakKb();
+
+   cout << "SEGMENTS:\t" << count << endl;
+   cout << "PEAK KB AFTER " << segments / 8 << ":\t" << startkb << endl;
+   cout << "PEAK KB AT END:\t" << endkb << endl;
+
+   if (count != segments) {
+      cout << "FAIL: read " << count << " segments" << endl;
+      return 1;
+   }
+   // The remaining 7/8 of the input should not raise the peak by more
+   // than a few megabytes.
+   if (endkb - startkb > 4096) {
+      cout << "FAIL: peak memory grew by " << endkb - startkb << " KB" << endl;
+      return 1;
+   }
+   cout << "PASS" << endl;
+   return 0;
+}